@@ -12,9 +12,10 @@ def get_scientific_arity_test_cases():
     for func, sig in FUNCTION_SIGNATURES.items():
         if func not in scientific_functions or sig.get("variadic", False):
             continue
-        expected_argc = len(sig["arg_types"])
-        yield pytest.param(func, expected_argc - 1, id=f"{func}-too_few")
-        yield pytest.param(func, expected_argc + 1, id=f"{func}-too_many")
+        max_argc = len(sig["arg_types"])
+        min_argc = max_argc - sig.get("optional_args", 0)
+        yield pytest.param(func, min_argc - 1, id=f"{func}-too_few")
+        yield pytest.param(func, max_argc + 1, id=f"{func}-too_many")
 
 
 @pytest.mark.parametrize("func, provided_argc", get_scientific_arity_test_cases())
@@ -30,3 +31,17 @@ def test_scientific_function_arities(func, provided_argc):
     with pytest.raises(ValuaScriptError) as e:
         compile_valuascript(script)
     assert e.value.code == ErrorCode.ARGUMENT_COUNT_MISMATCH
+
+
+@pytest.mark.parametrize("integrator_arg", ["", ', "rk4"'])
+def test_sir_model_integrator_is_optional(integrator_arg):
+    script = BASE_SCRIPT + f"let s, i, r = SirModel(999, 1, 0, 0.3, 0.1, 10, 1{integrator_arg})"
+    recipe = compile_valuascript(script)
+    step = next(step for step in recipe.get("per_trial_steps", []) + recipe.get("pre_trial_steps", []) if step.get("function") == "SirModel")
+    assert len(step["args"]) == (8 if integrator_arg else 7)
+
+
+def test_sir_model_integrator_must_be_a_string():
+    with pytest.raises(ValuaScriptError) as e:
+        compile_valuascript(BASE_SCRIPT + "let s, i, r = SirModel(999, 1, 0, 0.3, 0.1, 10, 1, 4)")
+    assert e.value.code == ErrorCode.ARGUMENT_TYPE_MISMATCH
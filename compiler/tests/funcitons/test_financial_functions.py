@@ -8,7 +8,7 @@ BASE_SCRIPT = "@iterations=1\n@output=result\n"
 
 def get_financial_arity_test_cases():
     """Generates test cases for all non-variadic financial functions."""
-    financial_functions = {"BlackScholes"}
+    financial_functions = {"BlackScholes", "BlackScholesGreeks"}
     for func, sig in FUNCTION_SIGNATURES.items():
         if func not in financial_functions or sig.get("variadic", False):
             continue
@@ -36,3 +36,18 @@ def test_financial_function_arities(func, provided_argc):
     with pytest.raises(ValuaScriptError) as e:
         compile_valuascript(script)
     assert e.value.code == ErrorCode.ARGUMENT_COUNT_MISMATCH
+
+
+def test_black_scholes_returns_vectors_for_vector_arguments():
+    script = '@iterations=1\n@output=total\nlet strikes = [90, 100, 110]\nlet price = BlackScholes(100, strikes, 0.05, 1, 0.2, "put")\nlet total = sum_series(price)'
+    compile_valuascript(script)
+
+    script = '@iterations=1\n@output=deltas\nlet price, deltas, gamma, vega, theta = BlackScholesGreeks(100, [90, 100], 0.05, 1, 0.2, "call")\nlet total = sum_series(deltas)'
+    recipe = compile_valuascript(script)
+    assert "deltas" in recipe["variable_registry"]
+
+
+def test_black_scholes_greeks_are_scalars_for_scalar_arguments():
+    with pytest.raises(ValuaScriptError) as e:
+        compile_valuascript('@iterations=1\n@output=total\nlet price, delta, gamma, vega, theta = BlackScholesGreeks(100, 105, 0.05, 1, 0.2, "call")\nlet total = sum_series(delta)')
+    assert e.value.code == ErrorCode.ARGUMENT_TYPE_MISMATCH
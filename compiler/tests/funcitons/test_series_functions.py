@@ -8,14 +8,15 @@ BASE_SCRIPT = "@iterations=1\n@output=result\n"
 
 def get_series_arity_test_cases():
     """Generates test cases for all non-variadic series functions."""
-    series_functions = {"sum_series", "series_delta", "npv", "compound_series", "get_element", "delete_element", "grow_series", "interpolate_series", "capitalize_expense"}
+    series_functions = {"sum_series", "series_delta", "npv", "irr", "compound_series", "get_element", "delete_element", "grow_series", "interpolate_series", "capitalize_expense"}
     for func, sig in FUNCTION_SIGNATURES.items():
         if func not in series_functions or sig.get("variadic", False):
             continue
-        expected_argc = len(sig["arg_types"])
-        if expected_argc > 0:
-            yield pytest.param(func, expected_argc - 1, id=f"{func}-too_few")
-        yield pytest.param(func, expected_argc + 1, id=f"{func}-too_many")
+        max_argc = len(sig["arg_types"])
+        min_argc = max_argc - sig.get("optional_args", 0)
+        if min_argc > 0:
+            yield pytest.param(func, min_argc - 1, id=f"{func}-too_few")
+        yield pytest.param(func, max_argc + 1, id=f"{func}-too_many")
 
 
 @pytest.mark.parametrize("func, provided_argc", get_series_arity_test_cases())
@@ -30,3 +31,26 @@ def test_series_function_arities(func, provided_argc):
     with pytest.raises(ValuaScriptError) as e:
         compile_valuascript(script)
     assert e.value.code == ErrorCode.ARGUMENT_COUNT_MISMATCH
+
+
+@pytest.mark.parametrize(
+    "expression, expected_type",
+    [
+        ("npv(0.1, [1, 2, 3])", "scalar"),
+        ("npv([0.1, 0.2], grow_series([100, 200], 0.05, 3))", "vector"),
+        ("irr([-100, 60, 60])", "scalar"),
+        ("irr(grow_series([-100, -200], -2, 2), 2)", "vector"),
+        ("compound_series([100, 200], [0.1, 0.2, 0.3, 0.4])", "vector"),
+    ],
+)
+def test_portfolio_forms_return_one_value_per_instrument(expression, expected_type):
+    # sum_series only accepts vectors and log only scalars.
+    wrapper = "sum_series" if expected_type == "vector" else "log"
+    recipe = compile_valuascript(BASE_SCRIPT + f"let result = {wrapper}({expression})")
+    assert "result" in recipe["variable_registry"]
+
+
+def test_npv_of_a_portfolio_is_not_a_scalar():
+    with pytest.raises(ValuaScriptError) as e:
+        compile_valuascript(BASE_SCRIPT + "let result = log(npv([0.1, 0.2], [1, 2, 3, 4]))")
+    assert e.value.code == ErrorCode.ARGUMENT_TYPE_MISMATCH
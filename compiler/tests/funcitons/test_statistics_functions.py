@@ -30,3 +30,46 @@ def test_statistics_function_arities(func, provided_argc):
     with pytest.raises(ValuaScriptError) as e:
         compile_valuascript(script)
     assert e.value.code == ErrorCode.ARGUMENT_COUNT_MISMATCH
+
+
+def test_multivariate_normal_unpacks_into_scalars():
+    """MultivariateNormal gives a vector, or one scalar per variable it is assigned to."""
+    script = """
+    @iterations=1
+    @output=total
+    let draws = MultivariateNormal([1, 2], 0.5, [1, 0.6, 0.6, 1])
+    let a, b, c = MultivariateNormal(0, [1, 2, 3], [1, 0, 0, 0, 1, 0, 0, 0, 1])
+    let total = a + b + c + sum_series(draws)
+    """
+    recipe = compile_valuascript(script)
+    assert recipe is not None
+    assert {"a", "b", "c", "draws"} <= set(recipe["variable_registry"])
+
+
+def test_multivariate_normal_needs_a_vector_correlation():
+    script = BASE_SCRIPT + "let a, b = MultivariateNormal(0, 1, 0.5)\nlet result = a + b"
+    with pytest.raises(ValuaScriptError) as e:
+        compile_valuascript(script)
+    assert e.value.code == ErrorCode.ARGUMENT_TYPE_MISMATCH
+
+
+def test_path_functions_return_vectors_with_an_optional_dt():
+    script = """
+    @iterations=1
+    @output=total
+    let prices = gbm_path(100, 0.05, 0.2, 12, 1 / 12)
+    let rates = ou_path(0.03, 0.04, 0.5, 0.01, 10)
+    let jumps = jump_diffusion_path(100, 0.05, 0.2, 1, -0.1, 0.15, 252, 1 / 252)
+    let total = sum_series(prices) + sum_series(rates) + sum_series(jumps)
+    """
+    recipe = compile_valuascript(script)
+    assert recipe is not None
+    assert {"prices", "rates", "jumps"} <= set(recipe["variable_registry"])
+
+
+@pytest.mark.parametrize("call", ["gbm_path(100, 0.05, 0.2)", "ou_path(0, 0, 1, 1, 10, 1, 1)"])
+def test_path_functions_check_their_arity(call):
+    script = BASE_SCRIPT + f"let path = {call}\nlet result = sum_series(path)"
+    with pytest.raises(ValuaScriptError) as e:
+        compile_valuascript(script)
+    assert e.value.code == ErrorCode.ARGUMENT_COUNT_MISMATCH
@@ -1,6 +1,7 @@
 import subprocess
 import sys
 import os
+import json
 import pytest
 
 
@@ -22,6 +23,24 @@ def test_cli_successful_compilation_and_run(create_manual_test_structure):
     assert os.path.exists(test_dir / "simulation_output.csv")
 
 
+def test_cli_run_with_profile_and_trace(create_manual_test_structure):
+    """
+    Tests that `--profile` and `--trace` reach the engine: the per-step report is
+    printed and the Chrome trace is written where the caller asked.
+    """
+    test_dir = create_manual_test_structure
+    main_script_path = test_dir / "main.vs"
+
+    command = [sys.executable, "-m", "vsc", str(main_script_path), "--run", "--profile", "--trace", "trace.json"]
+
+    result = subprocess.run(command, capture_output=True, text=True, cwd=test_dir)
+
+    assert result.returncode == 0, f"CLI should have succeeded but failed with stderr:\n{result.stderr}"
+    assert "Per-Step Profile" in result.stdout
+    with open(test_dir / "trace.json") as f:
+        assert "traceEvents" in json.load(f)
+
+
 def test_cli_circular_import_error(create_manual_test_structure):
     """
     Tests that the CLI correctly fails and reports a circular import error
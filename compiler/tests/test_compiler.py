@@ -23,6 +23,10 @@ def test_valid_scripts_compile_successfully():
     )
     compile_valuascript("@iterations=1\n@output=x\nlet x = sum_series(grow_series(1, 1, 1))")
     compile_valuascript('@iterations=1\n@output=x\n@output_file="f.csv"\nlet x = 1')
+    compile_valuascript("@iterations=1\n@output=x\n@seed=42\nlet x = Normal(0, 1)")
+    compile_valuascript('@iterations=1\n@output=x\n@sampling="sobol"\nlet x = Normal(0, 1)')
+    compile_valuascript('@iterations=1\n@output=x\n@variance_reduction="antithetic"\nlet x = Normal(0, 1)')
+    compile_valuascript("@iterations=1000\n@output=x\n@target_precision=0.01\n@max_trials=100000\nlet x = Normal(0, 1)")
     compile_valuascript("@iterations=1\n@output=v\nlet my_vec = [1,2,3]\nlet v = delete_element(my_vec, 1)")
     compile_valuascript("@iterations=1\n@output=x\nlet my_vec=[100,200]\nlet x = my_vec[0]")
     compile_valuascript("@iterations=1\n@output=x\nlet my_vec=[100,200]\nlet i=1\nlet x = my_vec[i]")
@@ -97,6 +101,15 @@ def test_structural_integrity_errors(script_body, expected_code):
         ("@iterations=1\n@output=result\nlet v=[1]\nlet result=Normal(1,v)", ErrorCode.ARGUMENT_TYPE_MISMATCH),
         ("@iterations=1\n@output=x\nlet s=1\nlet v=grow_series(s,0,1)\nlet x=log(v)", ErrorCode.ARGUMENT_TYPE_MISMATCH),
         ("@iterations=1\n@output=x\nlet x=1\n@output_file=not_a_string", ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ("@iterations=1\n@output=x\nlet x=1\n@seed=1.5", ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ('@iterations=1\n@output=x\nlet x=1\n@sampling="halton"', ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ("@iterations=1\n@output=x\nlet x=1\n@sampling=sobol", ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ('@iterations=1\n@output=x\nlet x=1\n@variance_reduction="control"', ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ('@iterations=1\n@output=x\nlet x=1\n@sampling="sobol"\n@variance_reduction="lhs"', ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ("@iterations=1\n@output=x\nlet x=1\n@target_precision=0", ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ('@iterations=1\n@output=x\nlet x=1\n@target_precision="small"', ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ("@iterations=1\n@output=x\nlet x=1\n@max_trials=1000", ErrorCode.INVALID_DIRECTIVE_VALUE),
+        ('@iterations=1\n@output=x\nlet x=1\n@target_precision=0.1\n@variance_reduction="lhs"', ErrorCode.INVALID_DIRECTIVE_VALUE),
         ("@iterations=1\n@output=v\nlet s=1\nlet v=delete_element(s, 0)", ErrorCode.ARGUMENT_TYPE_MISMATCH),
         ("@iterations=1\n@output=v\nlet my_vec=[1]\nlet v=delete_element(my_vec, [0])", ErrorCode.ARGUMENT_TYPE_MISMATCH),
         ("@iterations=1\n@output=v\nlet s=1\nlet v=s[0]", ErrorCode.ARGUMENT_TYPE_MISMATCH),
@@ -206,6 +219,23 @@ def test_dead_code_elimination_is_disabled_by_default():
     assert set(recipe["variable_registry"]) == {"live", "dead"}
 
 
+def test_recipe_records_variable_types():
+    """
+    The engine lays out typed storage from `variable_types`, one entry per registry slot.
+    """
+    script = """
+    @iterations=1
+    @output=total
+    let cf = grow_series(100, 0.1, 5)
+    let total = sum_series(cf)
+    let big = total > 500
+    let label = "revenue"
+    """
+    recipe = compile_valuascript(script, optimize=False)
+    types = dict(zip(recipe["variable_registry"], recipe["variable_types"]))
+    assert types == {"cf": "vector", "total": "scalar", "big": "boolean", "label": "string"}
+
+
 @pytest.mark.parametrize(
     "script_body, preview_var, expected_output_var_name, expected_num_trials, expected_remaining_vars",
     [
@@ -0,0 +1,46 @@
+import os
+import sys
+
+import pytest
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
+
+from vsc.compiler import compile_valuascript
+from vsc.native import load_engine_module
+
+engine = load_engine_module()
+pytestmark = pytest.mark.skipif(engine is None, reason="the vse_engine module is not built (-DVSE_BUILD_PYTHON=ON)")
+
+SCRIPT = """
+@iterations = 1000
+@output = total
+let x = Normal(10, 2)
+let growth = grow_series(x, 0.1, 3)
+let total = x * 2
+"""
+
+
+def test_runs_the_linkers_dict_into_numpy_arrays():
+    recipe = compile_valuascript(SCRIPT)
+    plan = engine.compile(recipe)
+    assert plan.output_names == ["total"]
+    results = plan.run(seed=5, trials=2500)
+    total = results["total"]
+    assert total.shape == (2500,)
+    assert total.dtype.name == "float64"
+    assert total.base is not None  # Wraps the engine's buffer rather than a copy.
+    assert abs(total.mean() - 20.0) < 0.5
+    assert (plan.run(seed=5, trials=2500)["total"] == total).all()
+
+
+def test_previews_without_a_process():
+    recipe = compile_valuascript(SCRIPT, preview_variable="growth")
+    preview = engine.preview(recipe)
+    assert preview["status"] == "success"
+    assert preview["type"] == "vector"
+    assert len(preview["value"]) == 3
+
+
+def test_reports_engine_errors():
+    with pytest.raises(engine.EngineError):
+        engine.compile(compile_valuascript(SCRIPT)).run(outputs=["missing"])
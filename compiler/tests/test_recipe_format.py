@@ -0,0 +1,24 @@
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
+from vsc.recipe_format import CBOR_SELF_DESCRIBE, encode_binary_recipe
+
+
+def test_binary_recipe_is_tagged_cbor():
+    assert encode_binary_recipe({"a": 1, "b": [True, None], "c": "x"}) == CBOR_SELF_DESCRIBE + b"\xa3\x61a\x01\x61b\x82\xf5\xf6\x61c\x61x"
+
+
+def test_binary_recipe_encodes_non_integral_floats_as_doubles():
+    assert encode_binary_recipe(0.5) == CBOR_SELF_DESCRIBE + b"\xfb" + struct.pack(">d", 0.5)
+    assert encode_binary_recipe(-3.0) == CBOR_SELF_DESCRIBE + b"\x22"
+
+
+def test_binary_recipe_packs_vector_literals():
+    packed = struct.pack("<3d", 1.0, 2.5, -4.0)
+    encoded = encode_binary_recipe({"type": "vector_literal", "value": [1, 2.5, -4.0]})
+    assert encoded.endswith(b"\x65value\x58\x18" + packed)
+
+    # Other lists, such as result indices, stay arrays.
+    assert encode_binary_recipe({"result": [0, 1]}) == CBOR_SELF_DESCRIBE + b"\xa1\x66result\x82\x00\x01"
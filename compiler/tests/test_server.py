@@ -5,7 +5,7 @@ import os
 
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
 
-from vsc.server import _get_script_analysis
+from vsc.server import _get_script_analysis, _format_distribution
 
 
 def test_script_analysis_with_manual_structure(create_manual_test_structure):
@@ -89,3 +89,13 @@ def test_hover_content_generation():
 This is a test docstring.
 """.strip()
     )
+
+
+def test_hover_distribution_shows_a_sparkline_and_percentiles():
+    distribution = {
+        "min": 1.0,
+        "max": 9.5,
+        "histogram": {"edges": [1.0, 5.25, 9.5], "counts": [30, 10]},
+        "percentiles": {"P1": 1.1, "P5": 2.123456, "P50": 4.5, "P95": 8.0, "P99": 9.0},
+    }
+    assert _format_distribution(distribution) == "**Distribution:**\n```\n1.0 █▃ 9.5\nP5 2.1235  P50 4.5  P95 8.0\n```"
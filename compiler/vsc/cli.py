@@ -1,4 +1,3 @@
-import json
 import argparse
 import sys
 import os
@@ -11,12 +10,14 @@ try:
     from .compiler import compile_valuascript
     from .exceptions import ValuaScriptError
     from .utils import TerminalColors, format_lark_error, find_engine_executable, generate_and_show_plot
+    from .recipe_format import write_recipe
 except ImportError:
 
     sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
     from vsc.compiler import compile_valuascript
     from vsc.exceptions import ValuaScriptError
     from vsc.utils import TerminalColors, format_lark_error, find_engine_executable, generate_and_show_plot
+    from vsc.recipe_format import write_recipe
 
 
 def main():
@@ -25,13 +26,18 @@ def main():
     try:
         parser = argparse.ArgumentParser(description="Compile a .vs file into a .json recipe.")
         parser.add_argument("input_file", nargs="?", default=None, help="The path to the input .vs file. Omit to read from stdin.")
-        parser.add_argument("-o", "--output", dest="output_file", help="The path to the output .json file.")
+        parser.add_argument("-o", "--output", dest="output_file", help="The path to the output recipe file.")
+        parser.add_argument("--binary", action="store_true", help="Write the recipe as CBOR (.vsr), with vector literals packed as doubles, instead of JSON.")
         parser.add_argument("--run", action="store_true", help="Execute the simulation engine after a successful compilation.")
-        parser.add_argument("--plot", action="store_true", help="Generate and display a histogram of the simulation results.")
+        parser.add_argument("--plot", action="store_true", help="Generate and display a histogram of the simulation results (from a summary file when the script sets no @output_file).")
         parser.add_argument("-O", "--optimize", action="store_true", help="Enable aggressive optimizations like Dead Code Elimination.")
         parser.add_argument("-v", "--verbose", action="store_true", help="Enable verbose output during compilation.")
         parser.add_argument("--engine-path", help="Explicit path to the 'vse' executable.")
         parser.add_argument("--lsp", action="store_true", help="Run the language server.")
+        parser.add_argument("--cache-dir", dest="cache_dir", default=None, help="Reuse per-step trial results cached in this directory between runs.")
+        parser.add_argument("--profile", action="store_true", help="With --run, print the time and allocations of every step after the run.")
+        parser.add_argument("--trace", dest="trace_file", default=None, help="With --run, write the thread pool's activity as a Chrome trace to this file.")
+        parser.add_argument("--progress", action="store_true", help="With --run, show a progress bar with trials/s, ETA and the running mean.")
         parser.add_argument("--preview-var", dest="preview_var", default=None, help="Generate a temporary recipe to preview a specific variable's value.")
         args = parser.parse_args()
 
@@ -46,7 +52,8 @@ def main():
         if not args.input_file and sys.stdin.isatty() and not is_preview_mode:
             parser.error("input_file is required when not reading from a pipe or in preview mode.")
 
-        raw_output_path = args.output_file or os.path.splitext(args.input_file)[0] + ".json" if args.input_file else "stdin.json"
+        recipe_extension = ".vsr" if args.binary else ".json"
+        raw_output_path = (args.output_file or os.path.splitext(args.input_file)[0] + recipe_extension) if args.input_file else "stdin" + recipe_extension
         output_file_path = os.path.abspath(raw_output_path)
 
         script_path = args.input_file or "stdin"
@@ -72,10 +79,17 @@ def main():
                 file_path=input_file_path_abs,
             )
 
+            if args.cache_dir and not is_preview_mode:
+                final_recipe["simulation_config"]["cache_dir"] = os.path.abspath(args.cache_dir)
+
+            # Without an @output_file, a plot is drawn from a summary file of a few kilobytes
+            # rather than from every trial.
+            if args.run and args.plot and not is_preview_mode and not final_recipe["simulation_config"].get("output_file"):
+                final_recipe["simulation_config"]["output_file"] = os.path.splitext(os.path.basename(output_file_path))[0] + ".summary.json"
+
             os.makedirs(os.path.dirname(output_file_path), exist_ok=True)
 
-            with open(output_file_path, "w") as f:
-                f.write(json.dumps(final_recipe, indent=2))
+            write_recipe(final_recipe, output_file_path, binary=args.binary)
 
             if not is_preview_mode:
                 print(f"\n{TerminalColors.GREEN}--- Compilation Successful ---{TerminalColors.RESET}")
@@ -95,6 +109,12 @@ def main():
                     proc = subprocess.run(command_args, capture_output=True, text=True, check=True, cwd=engine_cwd)
                     print(proc.stdout, end="")
                 else:
+                    if args.profile:
+                        command_args.insert(1, "--profile")
+                    if args.progress:
+                        command_args.insert(1, "--progress")
+                    if args.trace_file:
+                        command_args[1:1] = ["--trace", os.path.abspath(args.trace_file)]
                     print(f"\n--- Running Simulation ---")
                     subprocess.run(command_args, check=True, cwd=engine_cwd)
                     print(f"{TerminalColors.GREEN}--- Simulation Finished Successfully ---{TerminalColors.RESET}")
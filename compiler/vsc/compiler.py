@@ -106,7 +106,7 @@ def compile_valuascript(script_content: str, optimize=False, verbose=False, prev
 
     if any(d["name"] == "module" for d in main_ast.get("directives", [])):
         validate_semantics(main_ast, all_user_function_defs, is_preview_mode=True, file_path=file_path)
-        return {"simulation_config": {}, "variable_registry": [], "output_variable_index": None, "pre_trial_steps": [], "per_trial_steps": []}
+        return {"simulation_config": {}, "variable_registry": [], "variable_types": [], "output_variable_index": None, "pre_trial_steps": [], "per_trial_steps": []}
 
     inlined_steps, defined_vars, sim_config, output_var = validate_semantics(main_ast, all_user_function_defs, is_preview_mode, file_path=file_path)
 
@@ -125,4 +125,4 @@ def compile_valuascript(script_content: str, optimize=False, verbose=False, prev
         if preview_variable not in final_defined_vars:
             raise ValuaScriptError(ErrorCode.UNDEFINED_VARIABLE, name=preview_variable)
 
-    return link_and_generate_bytecode(pre_trial_steps, per_trial_steps, sim_config, output_var)
+    return link_and_generate_bytecode(pre_trial_steps, per_trial_steps, sim_config, output_var, final_defined_vars)
@@ -28,6 +28,43 @@ DIRECTIVE_CONFIG = {
         "allowed_in_module": False,
         "error_type": 'The value for @output_file must be a string literal (e.g., "path/to/results.csv").',
     },
+    "seed": {
+        "required": False,
+        "value_type": int,
+        "value_allowed": True,
+        "allowed_in_module": False,
+        "error_type": "The value for @seed must be a whole number (e.g., 42).",
+    },
+    "sampling": {
+        "required": False,
+        "value_type": str,
+        "value_allowed": True,
+        "allowed_in_module": False,
+        "allowed_values": ("pseudo", "sobol"),
+        "error_type": 'The value for @sampling must be "pseudo" or "sobol" (e.g., @sampling = "sobol").',
+    },
+    "variance_reduction": {
+        "required": False,
+        "value_type": str,
+        "value_allowed": True,
+        "allowed_in_module": False,
+        "allowed_values": ("lhs", "antithetic"),
+        "error_type": 'The value for @variance_reduction must be "lhs" or "antithetic" (e.g., @variance_reduction = "lhs").',
+    },
+    "target_precision": {
+        "required": False,
+        "value_type": float,
+        "value_allowed": True,
+        "allowed_in_module": False,
+        "error_type": "The value for @target_precision must be a positive number, the standard error to reach (e.g., 0.01).",
+    },
+    "max_trials": {
+        "required": False,
+        "value_type": int,
+        "value_allowed": True,
+        "allowed_in_module": False,
+        "error_type": "The value for @max_trials must be a whole number (e.g., 1000000).",
+    },
     "module": {
         "required": False,
         "value_type": bool,
@@ -5,7 +5,8 @@ Signatures for scientific and simulation models.
 SIGNATURES = {
     "SirModel": {
         "variadic": False,
-        "arg_types": ["scalar", "scalar", "scalar", "scalar", "scalar", "scalar", "scalar"],
+        "arg_types": ["scalar", "scalar", "scalar", "scalar", "scalar", "scalar", "scalar", "string"],
+        "optional_args": 1,
         "return_type": ["vector", "vector", "vector"],
         "is_stochastic": False,
         "doc": {
@@ -18,6 +19,7 @@ SIGNATURES = {
                 {"name": "gamma", "desc": "The recovery rate (1 / duration of infection)."},
                 {"name": "periods", "desc": "The number of time periods to simulate."},
                 {"name": "dt", "desc": "The fraction of a time period per step (e.g., 1.0 for a full day)."},
+                {"name": "integrator", "desc": "Optional. 'euler' (the default) or 'rk4', which stays accurate with a much larger dt."},
             ],
             "returns": "A tuple of three vectors: (susceptible, infected, recovered) over time.",
         },
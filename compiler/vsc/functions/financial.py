@@ -2,23 +2,36 @@
 Signatures for quantitative finance functions.
 """
 
+BLACK_SCHOLES_PARAMS = [
+    {"name": "spot", "desc": "The current spot price of the underlying asset (scalar or vector)."},
+    {"name": "strike", "desc": "The strike price of the option (scalar or vector)."},
+    {"name": "rate", "desc": "The annualized risk-free interest rate (e.g., 0.05 for 5%)."},
+    {"name": "time_to_maturity", "desc": "The time to expiration in years (scalar or vector)."},
+    {"name": "volatility", "desc": "The annualized volatility of the asset's returns (e.g., 0.2 for 20%)."},
+    {"name": "option_type", "desc": "The type of option to price. Must be the string 'call' or 'put'."},
+]
+
 SIGNATURES = {
     "BlackScholes": {
         "variadic": False,
-        "arg_types": ["scalar", "scalar", "scalar", "scalar", "scalar", "string"],
-        "return_type": "scalar",
+        "arg_types": ["any", "any", "any", "any", "any", "string"],
+        "return_type": lambda types: "vector" if "vector" in types else "scalar",
+        "is_stochastic": False,
+        "doc": {
+            "summary": "Calculates the price of a European option using the Black-Scholes model. Vector arguments price one option per element.",
+            "params": BLACK_SCHOLES_PARAMS,
+            "returns": "The theoretical price of the European option: a scalar, or a vector when any argument is a vector.",
+        },
+    },
+    "BlackScholesGreeks": {
+        "variadic": False,
+        "arg_types": ["any", "any", "any", "any", "any", "string"],
+        "return_type": lambda types: ["vector" if "vector" in types else "scalar"] * 5,
         "is_stochastic": False,
         "doc": {
-            "summary": "Calculates the price of a European option using the Black-Scholes model.",
-            "params": [
-                {"name": "spot", "desc": "The current spot price of the underlying asset."},
-                {"name": "strike", "desc": "The strike price of the option."},
-                {"name": "rate", "desc": "The annualized risk-free interest rate (e.g., 0.05 for 5%)."},
-                {"name": "time_to_maturity", "desc": "The time to expiration in years."},
-                {"name": "volatility", "desc": "The annualized volatility of the asset's returns (e.g., 0.2 for 20%)."},
-                {"name": "option_type", "desc": "The type of option to price. Must be the string 'call' or 'put'."},
-            ],
-            "returns": "The theoretical price of the European option as a scalar.",
+            "summary": "Calculates the Black-Scholes price of a European option together with its Greeks.",
+            "params": BLACK_SCHOLES_PARAMS,
+            "returns": "A tuple (price, delta, gamma, vega, theta), with vega per unit of volatility and theta per year; vectors when any argument is a vector.",
         },
     },
 }
@@ -34,24 +34,45 @@ SIGNATURES = {
     },
     "npv": {
         "variadic": False,
-        "arg_types": ["scalar", "vector"],
-        "return_type": "scalar",
+        "arg_types": ["any", "vector"],
+        "return_type": lambda types: "vector" if types[0] == "vector" else "scalar",
+        "is_stochastic": False,
+        "doc": {
+            "summary": "Calculates the Net Present Value (NPV) of a series of cash flows, or of every instrument of a portfolio matrix.",
+            "params": [
+                {"name": "rate", "desc": "The discount rate per period, or a vector of one rate per instrument to value a portfolio matrix."},
+                {"name": "cashflows", "desc": "A vector of cash flows, or a portfolio matrix with one row of instrument cash flows per period."},
+            ],
+            "returns": "The NPV as a scalar, or a vector of one NPV per instrument.",
+        },
+    },
+    "irr": {
+        "variadic": False,
+        "arg_types": ["vector", "scalar"],
+        "optional_args": 1,
+        "return_type": lambda types: "vector" if len(types) == 2 else "scalar",
         "is_stochastic": False,
         "doc": {
-            "summary": "Calculates the Net Present Value (NPV) of a series of cash flows.",
-            "params": [{"name": "rate", "desc": "The discount rate per period."}, {"name": "cashflows", "desc": "A vector of cash flows."}],
-            "returns": "The NPV as a scalar.",
+            "summary": "Calculates the Internal Rate of Return (IRR) of a series of cash flows, or of every instrument of a portfolio matrix.",
+            "params": [
+                {"name": "cashflows", "desc": "A vector of cash flows, or a portfolio matrix with one row of instrument cash flows per period."},
+                {"name": "instruments", "desc": "Optional. The number of instruments (columns) of the portfolio matrix."},
+            ],
+            "returns": "The rate at which the NPV of the cash flows is zero, or a vector of one rate per instrument.",
         },
     },
     "compound_series": {
         "variadic": False,
-        "arg_types": ["scalar", "vector"],
+        "arg_types": ["any", "vector"],
         "return_type": "vector",
         "is_stochastic": False,
         "doc": {
             "summary": "Projects a base value forward using a vector of period-specific growth rates.",
-            "params": [{"name": "base_value", "desc": "The starting scalar value."}, {"name": "rates_vector", "desc": "A vector of growth rates for each period."}],
-            "returns": "A new vector of compounded values.",
+            "params": [
+                {"name": "base_value", "desc": "The starting scalar value, or a vector of one starting value per instrument."},
+                {"name": "rates_vector", "desc": "A vector of growth rates for each period, or a portfolio matrix of one row of instrument rates per period."},
+            ],
+            "returns": "A new vector of compounded values, or a portfolio matrix when the base is a vector.",
         },
     },
     "get_element": {
@@ -78,17 +99,17 @@ SIGNATURES = {
     },
     "grow_series": {
         "variadic": False,
-        "arg_types": ["scalar", "scalar", "scalar"],
+        "arg_types": ["any", "any", "scalar"],
         "return_type": "vector",
         "is_stochastic": False,
         "doc": {
             "summary": "Projects a series by applying a constant growth rate.",
             "params": [
-                {"name": "base_value", "desc": "The starting scalar value."},
-                {"name": "growth_rate", "desc": "The constant growth rate to apply each period (e.g., 0.05 for 5%)."},
+                {"name": "base_value", "desc": "The starting scalar value, or a vector of one starting value per instrument."},
+                {"name": "growth_rate", "desc": "The constant growth rate to apply each period (e.g., 0.05 for 5%), or a vector of one rate per instrument."},
                 {"name": "periods", "desc": "The number of periods to project forward."},
             ],
-            "returns": "A vector of projected values.",
+            "returns": "A vector of projected values, or a portfolio matrix with one row per period when an argument is a vector.",
         },
     },
     "interpolate_series": {
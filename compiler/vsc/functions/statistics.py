@@ -91,4 +91,78 @@ SIGNATURES = {
             "returns": "A random scalar sample.",
         },
     },
+    "MultivariateNormal": {
+        "variadic": False,
+        "arg_types": ["any", "any", "vector"],
+        "return_type": "vector",
+        "unpacks_vector": True,
+        "is_stochastic": True,
+        "doc": {
+            "summary": "Draws correlated samples from a multivariate Normal distribution. Assign it to several variables (`let a, b = MultivariateNormal(...)`) to get one scalar per component.",
+            "params": [
+                {"name": "means", "desc": "The mean of each component, as a vector, or one scalar for all of them."},
+                {"name": "std_devs", "desc": "The standard deviation of each component, as a vector, or one scalar for all of them."},
+                {"name": "correlation", "desc": "The correlation matrix, row by row, as a vector of n * n entries. It must be symmetric and positive definite, with ones on the diagonal."},
+            ],
+            "returns": "A vector with one sample per component, or one scalar per assigned variable.",
+        },
+    },
+    "gbm_path": {
+        "variadic": False,
+        "arg_types": ["scalar", "scalar", "scalar", "scalar", "scalar"],
+        "optional_args": 1,
+        "return_type": "vector",
+        "is_stochastic": True,
+        "doc": {
+            "summary": "Draws a geometric Brownian motion path in one call, such as a stock price path.",
+            "params": [
+                {"name": "start", "desc": "The value at time zero."},
+                {"name": "drift", "desc": "The annual drift rate (e.g., 0.05 for 5%)."},
+                {"name": "volatility", "desc": "The annual volatility (e.g., 0.2 for 20%)."},
+                {"name": "periods", "desc": "The number of periods in the path."},
+                {"name": "dt", "desc": "Optional. The length of one period in years. Defaults to 1."},
+            ],
+            "returns": "A vector with the value after each period.",
+        },
+    },
+    "ou_path": {
+        "variadic": False,
+        "arg_types": ["scalar", "scalar", "scalar", "scalar", "scalar", "scalar"],
+        "optional_args": 1,
+        "return_type": "vector",
+        "is_stochastic": True,
+        "doc": {
+            "summary": "Draws a mean-reverting Ornstein-Uhlenbeck path in one call, such as an interest rate path.",
+            "params": [
+                {"name": "start", "desc": "The value at time zero."},
+                {"name": "mean_level", "desc": "The long-run level the process reverts to."},
+                {"name": "reversion_speed", "desc": "The annual speed of reversion to the mean level. Zero gives arithmetic Brownian motion."},
+                {"name": "volatility", "desc": "The annual volatility, in the units of the value."},
+                {"name": "periods", "desc": "The number of periods in the path."},
+                {"name": "dt", "desc": "Optional. The length of one period in years. Defaults to 1."},
+            ],
+            "returns": "A vector with the value after each period.",
+        },
+    },
+    "jump_diffusion_path": {
+        "variadic": False,
+        "arg_types": ["scalar", "scalar", "scalar", "scalar", "scalar", "scalar", "scalar", "scalar"],
+        "optional_args": 1,
+        "return_type": "vector",
+        "is_stochastic": True,
+        "doc": {
+            "summary": "Draws a Merton jump diffusion path in one call: geometric Brownian motion with random jumps.",
+            "params": [
+                {"name": "start", "desc": "The value at time zero."},
+                {"name": "drift", "desc": "The annual drift rate, including the expected effect of the jumps."},
+                {"name": "volatility", "desc": "The annual volatility of the diffusion."},
+                {"name": "jump_intensity", "desc": "The expected number of jumps per year."},
+                {"name": "jump_mean", "desc": "The mean of the log size of a jump."},
+                {"name": "jump_std_dev", "desc": "The standard deviation of the log size of a jump."},
+                {"name": "periods", "desc": "The number of periods in the path."},
+                {"name": "dt", "desc": "Optional. The length of one period in years. Defaults to 1."},
+            ],
+            "returns": "A vector with the value after each period.",
+        },
+    },
 }
@@ -14,12 +14,17 @@ def _process_arg_for_json(arg):
     return arg
 
 
-def link_and_generate_bytecode(pre_trial_steps, per_trial_steps, sim_config, output_var):
+# Static types the engine lays out storage for; anything else (e.g. "any") is left to run time.
+_ENGINE_VARIABLE_TYPES = {"scalar", "vector", "boolean", "string"}
+
+
+def link_and_generate_bytecode(pre_trial_steps, per_trial_steps, sim_config, output_var, defined_vars=None):
     """
     Performs the final "linking" stage:
     1. Builds the variable registry.
     2. Resolves all variable names to integer indices.
-    3. Generates the final low-level JSON bytecode.
+    3. Records the static type of each variable, when the validator knows it.
+    4. Generates the final low-level JSON bytecode.
     """
     all_steps = pre_trial_steps + per_trial_steps
     all_variable_names = set()
@@ -30,6 +35,12 @@ def link_and_generate_bytecode(pre_trial_steps, per_trial_steps, sim_config, out
     variable_registry_list = sorted(list(all_variable_names))
     name_to_index_map = {name: i for i, name in enumerate(variable_registry_list)}
 
+    def _variable_type(name):
+        var_type = (defined_vars or {}).get(name, {}).get("type")
+        return var_type if var_type in _ENGINE_VARIABLE_TYPES else "any"
+
+    variable_types = [_variable_type(name) for name in variable_registry_list]
+
     output_variable_index = None
     if output_var:
         if output_var not in name_to_index_map:
@@ -94,6 +105,7 @@ def link_and_generate_bytecode(pre_trial_steps, per_trial_steps, sim_config, out
     return {
         "simulation_config": sim_config,
         "variable_registry": variable_registry_list,
+        "variable_types": variable_types,
         "output_variable_index": output_variable_index,
         "pre_trial_steps": bytecode_pre_trial,
         "per_trial_steps": bytecode_per_trial,
@@ -0,0 +1,43 @@
+import importlib
+import os
+import sys
+
+_module = None
+_searched = False
+
+
+def _candidate_dirs():
+    env_path = os.environ.get("VSC_ENGINE_PATH")
+    if env_path:
+        yield os.path.dirname(os.path.abspath(env_path))
+    yield os.path.dirname(os.path.abspath(sys.executable))
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    build_bin = os.path.join(script_dir, "..", "..", "build", "bin")
+    yield os.path.abspath(os.path.join(build_bin, "Release") if sys.platform == "win32" else build_bin)
+
+
+def load_engine_module():
+    """
+    Returns the in-process engine, the `vse_engine` module built with -DVSE_BUILD_PYTHON=ON, or
+    None when it is not installed. It is looked for on sys.path, then next to the `vse`
+    executable in the places find_engine_executable() searches.
+    """
+    global _module, _searched
+    if _searched:
+        return _module
+    _searched = True
+    try:
+        _module = importlib.import_module("vse_engine")
+        return _module
+    except ImportError:
+        pass
+    for directory in _candidate_dirs():
+        if not os.path.isdir(directory):
+            continue
+        sys.path.insert(0, directory)
+        try:
+            _module = importlib.import_module("vse_engine")
+            return _module
+        except ImportError:
+            sys.path.remove(directory)
+    return None
@@ -0,0 +1,79 @@
+"""
+Serialization of linked recipes. JSON stays the readable debug format; the binary format is
+CBOR (RFC 8949) of the same document behind the self-describe tag, with vector literals packed
+as little-endian float64 byte strings so that large models load without parsing number text.
+"""
+
+import json
+import math
+import struct
+
+CBOR_SELF_DESCRIBE = b"\xd9\xd9\xf7"
+
+# Steps and arguments whose "value" is a vector literal.
+_PACKED_VALUE_TYPES = ("vector_literal", "literal_assignment")
+
+
+def _head(major, length):
+    if length < 24:
+        return bytes([major << 5 | length])
+    for info, fmt in ((24, ">B"), (25, ">H"), (26, ">I"), (27, ">Q")):
+        if length < 1 << (8 * struct.calcsize(fmt)):
+            return bytes([major << 5 | info]) + struct.pack(fmt, length)
+    raise ValueError(f"CBOR length {length} is too large.")
+
+
+def _is_number(value):
+    return isinstance(value, (int, float)) and not isinstance(value, bool)
+
+
+def _encode(value, out):
+    if value is None:
+        out.append(b"\xf6")
+    elif value is True:
+        out.append(b"\xf5")
+    elif value is False:
+        out.append(b"\xf4")
+    elif isinstance(value, int):
+        out.append(_head(0, value) if value >= 0 else _head(1, -1 - value))
+    elif isinstance(value, float):
+        if math.isfinite(value) and value == int(value) and abs(value) < 1 << 63:
+            _encode(int(value), out)
+        else:
+            out.append(b"\xfb" + struct.pack(">d", value))
+    elif isinstance(value, str):
+        data = value.encode("utf-8")
+        out.append(_head(3, len(data)) + data)
+    elif isinstance(value, (list, tuple)):
+        out.append(_head(4, len(value)))
+        for item in value:
+            _encode(item, out)
+    elif isinstance(value, dict):
+        out.append(_head(5, len(value)))
+        packs_value = value.get("type") in _PACKED_VALUE_TYPES and isinstance(value.get("value"), list) and all(_is_number(v) for v in value["value"])
+        for key, item in value.items():
+            _encode(str(key), out)
+            if packs_value and key == "value":
+                data = struct.pack(f"<{len(item)}d", *item)
+                out.append(_head(2, len(data)) + data)
+            else:
+                _encode(item, out)
+    else:
+        raise TypeError(f"Cannot encode '{type(value).__name__}' in a binary recipe.")
+
+
+def encode_binary_recipe(recipe):
+    """The binary form of a linked recipe, as bytes."""
+    out = [CBOR_SELF_DESCRIBE]
+    _encode(recipe, out)
+    return b"".join(out)
+
+
+def write_recipe(recipe, path, binary=False):
+    """Writes `recipe` to `path` as indented JSON, or in the binary format."""
+    if binary:
+        with open(path, "wb") as f:
+            f.write(encode_binary_recipe(recipe))
+    else:
+        with open(path, "w") as f:
+            f.write(json.dumps(recipe, indent=2))
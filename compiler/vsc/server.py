@@ -3,7 +3,9 @@ import os
 import sys
 import subprocess
 import json
+import queue
 import tempfile
+import threading
 from collections import deque
 from urllib.parse import urlparse, unquote
 from urllib.request import url2pathname
@@ -38,10 +40,97 @@ from vsc.optimizer import _build_dependency_graph, _find_stochastic_variables
 from vsc.functions import FUNCTION_SIGNATURES
 from vsc.exceptions import ValuaScriptError
 from vsc.utils import format_lark_error, find_engine_executable
+from vsc.native import load_engine_module
 
 server = LanguageServer("valuascript-server", "v1")
 
 
+class _EngineDaemon:
+    """
+    A long-lived `vse --serve` process shared by every hover, so that repeated previews of an
+    unchanged recipe reuse the engine it built instead of starting a new process each time.
+    """
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._proc = None
+        self._engine_path = None
+        self._responses = queue.Queue()
+        self._next_id = 0
+
+    def _start(self, engine_path):
+        self._stop()
+        self._proc = subprocess.Popen([engine_path, "--serve"], stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True, bufsize=1)
+        self._engine_path = engine_path
+        self._responses = queue.Queue()
+        threading.Thread(target=self._read_responses, args=(self._proc, self._responses), daemon=True).start()
+
+    @staticmethod
+    def _read_responses(proc, responses):
+        for line in proc.stdout:
+            responses.put(line)
+        responses.put(None)
+
+    def _stop(self):
+        if self._proc is not None:
+            self._proc.kill()
+            self._proc.wait()
+            self._proc = None
+
+    def request(self, engine_path, payload, timeout=15):
+        """Sends one request and returns the engine's response; raises RuntimeError when the daemon fails."""
+        with self._lock:
+            if self._proc is None or self._proc.poll() is not None or self._engine_path != engine_path:
+                self._start(engine_path)
+            self._next_id += 1
+            request_id = self._next_id
+            try:
+                self._proc.stdin.write(json.dumps(dict(payload, id=request_id)) + "\n")
+                self._proc.stdin.flush()
+                while True:
+                    line = self._responses.get(timeout=timeout)
+                    if line is None:
+                        raise RuntimeError("The engine server exited unexpectedly.")
+                    response = json.loads(line)
+                    if response.get("id") == request_id:
+                        return response
+            except (OSError, ValueError, queue.Empty, RuntimeError) as e:
+                self._stop()
+                raise RuntimeError(f"Engine server request failed: {e}") from e
+
+
+_engine_daemon = _EngineDaemon()
+
+
+def _preview_in_process(recipe):
+    """The preview from the vse_engine module, given the recipe dict as is; None without the module."""
+    engine = load_engine_module()
+    if engine is None:
+        return None
+    return engine.preview(recipe)
+
+
+def _preview_once(engine_path, recipe):
+    """Fallback for engines without --serve: one `vse --preview` process per request."""
+    tmp_recipe_file = None
+    try:
+        with tempfile.NamedTemporaryFile(mode="w", delete=False, suffix=".json") as tmp_recipe_file:
+            json.dump(recipe, tmp_recipe_file)
+        run_proc = subprocess.run([engine_path, "--preview", tmp_recipe_file.name], text=True, capture_output=True, timeout=15)
+        try:
+            result_json = json.loads(run_proc.stdout) if run_proc.stdout else None
+        except json.JSONDecodeError:
+            result_json = None
+        if result_json is not None and (result_json.get("status") == "error" or run_proc.returncode == 0):
+            return result_json
+        if run_proc.returncode != 0:
+            raise RuntimeError(run_proc.stderr.strip() or "Process failed without an error message.")
+        raise RuntimeError("Could not parse preview result from engine.")
+    finally:
+        if tmp_recipe_file and os.path.exists(tmp_recipe_file.name):
+            os.remove(tmp_recipe_file.name)
+
+
 def _uri_to_path(uri: str) -> str:
     """Converts a file URI to a platform-specific file path."""
     parsed = urlparse(uri)
@@ -64,6 +153,19 @@ def _format_number_with_separators(n):
     return n
 
 
+_SPARK_LEVELS = "▁▂▃▄▅▆▇█"
+
+
+def _format_distribution(distribution):
+    """A preview's distribution as hover Markdown: a sparkline of its histogram and its P5 / P50 / P95."""
+    counts = distribution.get("histogram", {}).get("counts", [])
+    peak = max(counts, default=0)
+    sparkline = "".join(_SPARK_LEVELS[min(len(_SPARK_LEVELS) - 1, int(count / peak * len(_SPARK_LEVELS)))] for count in counts) if peak > 0 else ""
+    percentiles = distribution.get("percentiles", {})
+    quantiles = "  ".join(f"{label} {round(percentiles[label], 4)}" for label in ("P5", "P50", "P95") if label in percentiles)
+    return f"**Distribution:**\n```\n{round(distribution['min'], 4)} {sparkline} {round(distribution['max'], 4)}\n{quantiles}\n```"
+
+
 def _validate(ls, params):
     text_doc = ls.workspace.get_text_document(params.text_document.uri)
     source = text_doc.source
@@ -249,33 +351,26 @@ def hover(params):
         is_stochastic = word in stochastic_vars
         kind = "stochastic" if is_stochastic else "deterministic"
         header = f"```valuascript\n(variable) {word}: {var_type} ({kind})\n```"
-        tmp_recipe_file = None
         try:
             recipe = compile_valuascript(source, context="lsp", preview_variable=word, file_path=file_path)
-            engine_path = find_engine_executable(None)
-            if not engine_path:
-                return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n*Error: Simulation engine 'vse' not found.*"))
-            with tempfile.NamedTemporaryFile(mode="w", delete=False, suffix=".json") as tmp_recipe_file:
-                json.dump(recipe, tmp_recipe_file)
-                recipe_path = tmp_recipe_file.name
-            run_proc = subprocess.run([engine_path, "--preview", recipe_path], text=True, capture_output=True, timeout=15)
-            if run_proc.stdout:
+            result_json = _preview_in_process(recipe)
+            if result_json is None:
+                engine_path = find_engine_executable(None)
+                if not engine_path:
+                    return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n*Error: Simulation engine 'vse' not found.*"))
                 try:
-                    result_json = json.loads(run_proc.stdout)
-                    if result_json.get("status") == "error":
-                        message = result_json.get("message", "An unknown error occurred in the engine.")
-                        return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n*Engine Runtime Error:*\n```\n{message}\n```"))
-                except json.JSONDecodeError:
-                    pass
-            if run_proc.returncode != 0:
-                error_output = run_proc.stderr.strip() or "Process failed without an error message."
-                return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n*Error during value preview:*\n```\n{error_output}\n```"))
-            try:
-                result_json = json.loads(run_proc.stdout)
-            except json.JSONDecodeError:
-                return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n*Error: Could not parse preview result from engine.*"))
+                    result_json = _engine_daemon.request(engine_path, {"command": "preview", "recipe": recipe})
+                except RuntimeError:
+                    try:
+                        result_json = _preview_once(engine_path, recipe)
+                    except RuntimeError as e:
+                        return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n*Error during value preview:*\n```\n{e}\n```"))
+            if result_json.get("status") == "error":
+                message = result_json.get("message", "An unknown error occurred in the engine.")
+                return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n*Engine Runtime Error:*\n```\n{message}\n```"))
             value = result_json.get("value")
-            value_label = "Mean Value (5000 trials)" if is_stochastic else "Value"
+            trials = result_json.get("trials")
+            value_label = f"Mean Value ({trials} trials)" if is_stochastic and trials else "Value"
             formatted_value = value
             if isinstance(value, bool):
                 formatted_value = "True" if value is True else "False"
@@ -286,12 +381,11 @@ def hover(params):
             value_str = json.dumps(formatted_value, indent=2)
             clean_value_str = value_str.replace('"', "")
             md_value = f"**{value_label}:**\n```\n{clean_value_str}\n```"
+            if is_stochastic and result_json.get("distribution"):
+                md_value += "\n" + _format_distribution(result_json["distribution"])
             return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n{md_value}"))
         except Exception as e:
             return Hover(contents=MarkupContent(kind=MarkupKind.Markdown, value=f"{header}\n\n---\n*An error occurred while fetching live value: {e}*"))
-        finally:
-            if tmp_recipe_file and os.path.exists(tmp_recipe_file.name):
-                os.remove(tmp_recipe_file.name)
     return None
 
 
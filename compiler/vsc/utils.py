@@ -75,8 +75,44 @@ def find_engine_executable(provided_path):
     return None
 
 
+def read_binary_results(file_path: str):
+    """Maps a binary results file (.bin) written by the engine into a DataFrame without copying the columns."""
+    import numpy as np
+    import pandas as pd
+
+    header = np.fromfile(file_path, dtype=np.uint8, count=64)
+    if header.size < 64 or header[:8].tobytes() != b"VSERES01":
+        raise ValueError(f"'{file_path}' is not a ValuaScript binary results file.")
+    header_size, _dtype = header[8:16].view("<u4")
+    trials, columns, _seed = header[16:40].view("<u8")
+    kind = int(header[40:44].view("<u4")[0])
+    data = np.memmap(file_path, dtype="<f8", mode="r", offset=int(header_size), shape=(int(columns), int(trials)))
+    names = [f"Period_{i + 1}" for i in range(int(columns))] if kind == 1 else ["Result"]
+    return pd.DataFrame({name: data[i] for i, name in enumerate(names)})
+
+
+def read_summary(file_path: str):
+    """Reads a summary file (.json) written by the engine: per output and period, moments, percentiles, a histogram and an ECDF."""
+    import json
+
+    with open(file_path, "r") as f:
+        summary = json.load(f)
+    if summary.get("format") != "vse-summary":
+        raise ValueError(f"'{file_path}' is not a ValuaScript summary file.")
+    return summary
+
+
 def generate_and_show_plot(file_path: str):
-    """Reads a CSV output file and displays a histogram of the results."""
+    """Reads a CSV, binary or summary output file and displays a histogram of the results."""
+    if file_path.endswith(".json"):
+        try:
+            import matplotlib.pyplot as plt
+        except ImportError:
+            print(f"{TerminalColors.RED}Error: Plotting requires 'matplotlib'.\nPlease install it with 'pip install matplotlib'.{TerminalColors.RESET}")
+            return
+        show_summary(read_summary(file_path))
+        return
+
     try:
         import pandas as pd
         import matplotlib.pyplot as plt
@@ -84,7 +120,7 @@ def generate_and_show_plot(file_path: str):
         print(f"{TerminalColors.RED}Error: Plotting requires 'pandas' and 'matplotlib'.\nPlease install them with 'pip install pandas matplotlib'.{TerminalColors.RESET}")
         return
 
-    df = pd.read_csv(file_path)
+    df = read_binary_results(file_path) if file_path.endswith(".bin") else pd.read_csv(file_path)
 
     if df.empty:
         print("Output file is empty. Nothing to plot.")
@@ -99,12 +135,18 @@ def generate_and_show_plot(file_path: str):
         target_column = df.columns[0]
         print(f"{TerminalColors.YELLOW}Warning: Plotting distribution for the first column '{target_column}'.{TerminalColors.RESET}")
 
-    data = df[target_column]
+    show_distribution(df[target_column], target_column)
+
+
+def show_distribution(data, name: str):
+    """Displays a histogram of one output's results: a pandas Series, or a numpy array from the vse_engine module."""
+    import matplotlib.pyplot as plt
+
     mean, std = data.mean(), data.std()
 
     plt.figure(figsize=(10, 6))
     plt.hist(data, bins=50, density=True, alpha=0.7, label="Distribution")
-    plt.title(f'Simulation Output Distribution for "{target_column}"')
+    plt.title(f'Simulation Output Distribution for "{name}"')
     plt.xlabel("Value")
     plt.ylabel("Probability Density")
     plt.axvline(mean, color="r", linestyle="dashed", linewidth=2, label=f"Mean: {mean:.2f}")
@@ -115,3 +157,36 @@ def generate_and_show_plot(file_path: str):
 
     print("Displaying plot. Close the plot window to exit.")
     plt.show()
+
+
+def show_summary(summary):
+    """Displays the histogram of the first output of a summary file, as show_distribution does for raw results."""
+    import matplotlib.pyplot as plt
+
+    output = summary["outputs"][0]
+    if not output["periods"]:
+        print("Summary holds no numeric results. Nothing to plot.")
+        return
+    name = output["name"]
+    if output["type"] == "vector":
+        name = f"{name} (Period_1)"
+        print(f"{TerminalColors.YELLOW}Note: Plotting distribution for 'Period_1'. Vector output detected.{TerminalColors.RESET}")
+    period = output["periods"][0]
+    edges, counts = period["histogram"]["edges"], period["histogram"]["counts"]
+    total = sum(counts)
+    widths = [right - left for left, right in zip(edges, edges[1:])]
+    densities = [count / (total * width) if total and width else 0.0 for count, width in zip(counts, widths)]
+
+    plt.figure(figsize=(10, 6))
+    plt.bar(edges[:-1], densities, width=widths, align="edge", alpha=0.7, label="Distribution")
+    plt.title(f'Simulation Output Distribution for "{name}"')
+    plt.xlabel("Value")
+    plt.ylabel("Probability Density")
+    plt.axvline(period["mean"], color="r", linestyle="dashed", linewidth=2, label=f"Mean: {period['mean']:.2f}")
+    stats_text = f"Std. Dev: {period['stddev']:.2f}\nTrials: {output['trials']}"
+    plt.text(0.05, 0.95, stats_text, transform=plt.gca().transAxes, fontsize=10, verticalalignment="top", bbox=dict(boxstyle="round,pad=0.5", fc="wheat", alpha=0.5))
+    plt.legend()
+    plt.grid(True, alpha=0.3)
+
+    print("Displaying plot. Close the plot window to exit.")
+    plt.show()
@@ -157,18 +157,23 @@ def _infer_expression_type(expression_dict, defined_vars, line_num, current_resu
                             raise ValuaScriptError(ErrorCode.LOGICAL_OPERATOR_TYPE_MISMATCH, line=line_num, op=op_name, provided=actual_type)
                         raise ValuaScriptError(ErrorCode.ARGUMENT_TYPE_MISMATCH, line=line_num, arg_num=i + 1, name=func_name, expected=expected_type, provided=actual_type)
         else:
-            if len(args) != len(signature["arg_types"]):
-                raise ValuaScriptError(ErrorCode.ARGUMENT_COUNT_MISMATCH, line=line_num, name=func_name, expected=len(signature["arg_types"]), provided=len(args))
+            max_args = len(signature["arg_types"])
+            min_args = max_args - signature.get("optional_args", 0)
+            if not min_args <= len(args) <= max_args:
+                expected = max_args if min_args == max_args else f"{min_args} to {max_args}"
+                raise ValuaScriptError(ErrorCode.ARGUMENT_COUNT_MISMATCH, line=line_num, name=func_name, expected=expected, provided=len(args))
             if func_name in ("__eq__", "__neq__") and len(inferred_arg_types) == 2 and inferred_arg_types[0] != inferred_arg_types[1]:
                 raise ValuaScriptError(ErrorCode.COMPARISON_TYPE_MISMATCH, line=line_num, op=func_name.strip("_"), left_type=inferred_arg_types[0], right_type=inferred_arg_types[1])
-            for i, expected_type in enumerate(signature["arg_types"]):
-                actual_type = inferred_arg_types[i]
+            for i, actual_type in enumerate(inferred_arg_types):
+                expected_type = signature["arg_types"][i]
                 if expected_type != "any" and actual_type != expected_type:
                     op_name = func_name.strip("_")
                     if op_name in ("and", "or", "not"):
                         raise ValuaScriptError(ErrorCode.LOGICAL_OPERATOR_TYPE_MISMATCH, line=line_num, op=op_name, provided=actual_type)
                     raise ValuaScriptError(ErrorCode.ARGUMENT_TYPE_MISMATCH, line=line_num, arg_num=i + 1, name=func_name, expected=expected_type, provided=actual_type)
 
+        if expr_type == "multi_assignment" and signature.get("unpacks_vector"):
+            return ["scalar"] * len(expression_dict.get("results", []))
         return_type_rule = signature["return_type"]
         return return_type_rule(inferred_arg_types) if callable(return_type_rule) else return_type_rule
 
@@ -478,9 +483,12 @@ def validate_semantics(main_ast, all_user_functions, is_preview_mode, file_path=
             is_multi_return = isinstance(return_type, list)
 
             if step.get("type") == "multi_assignment":
-                if not is_multi_return:
+                # Functions that unpack their vector into scalars take any number of results;
+                # the engine checks it against the vector's length.
+                unpacks_vector = all_signatures[func_name].get("unpacks_vector", False)
+                if not is_multi_return and not unpacks_vector:
                     raise ValuaScriptError(ErrorCode.ARGUMENT_COUNT_MISMATCH, line=line, name=f"assignment for '{func_name}'", expected=1, provided=len(step["results"]))
-                if len(step["results"]) != len(return_type):
+                if is_multi_return and len(step["results"]) != len(return_type):
                     raise ValuaScriptError(ErrorCode.ARGUMENT_COUNT_MISMATCH, line=line, name=f"assignment for '{func_name}'", expected=len(return_type), provided=len(step["results"]))
             else:
                 if is_multi_return:
@@ -518,12 +526,22 @@ def validate_semantics(main_ast, all_user_functions, is_preview_mode, file_path=
             value = raw_value.value if isinstance(raw_value, _StringLiteral) else (str(raw_value) if isinstance(raw_value, Token) else raw_value)
             if config.get("value_type") is int and not isinstance(value, int):
                 raise ValuaScriptError(ErrorCode.INVALID_DIRECTIVE_VALUE, line=d["line"], error_msg=config["error_type"])
+            if config.get("value_type") is float and (isinstance(value, bool) or not isinstance(value, (int, float)) or value <= 0):
+                raise ValuaScriptError(ErrorCode.INVALID_DIRECTIVE_VALUE, line=d["line"], error_msg=config["error_type"])
             if config.get("value_type") is str:
-                if (name == "output_file" and not isinstance(raw_value, _StringLiteral)) or (name == "output" and not isinstance(raw_value, Token)):
+                if (name in ("output_file", "sampling", "variance_reduction") and not isinstance(raw_value, _StringLiteral)) or (name == "output" and not isinstance(raw_value, Token)):
                     raise ValuaScriptError(ErrorCode.INVALID_DIRECTIVE_VALUE, line=d["line"], error_msg=config["error_type"])
+            if "allowed_values" in config and value not in config["allowed_values"]:
+                raise ValuaScriptError(ErrorCode.INVALID_DIRECTIVE_VALUE, line=d["line"], error_msg=config["error_type"])
 
             if name == "iterations":
                 sim_config["num_trials"] = value
+            elif name == "seed":
+                sim_config["seed"] = value
+            elif name in ("sampling", "variance_reduction", "max_trials"):
+                sim_config[name] = value
+            elif name == "target_precision":
+                sim_config["target_precision"] = {"standard_error": value}
             elif name == "output":
                 output_var = value
             elif name == "output_file":
@@ -533,6 +551,14 @@ def validate_semantics(main_ast, all_user_functions, is_preview_mode, file_path=
                 else:
                     sim_config["output_file"] = value
 
+    if sim_config.get("sampling", "pseudo") != "pseudo" and "variance_reduction" in sim_config:
+        raise ValuaScriptError(ErrorCode.INVALID_DIRECTIVE_VALUE, line=directives["variance_reduction"]["line"], error_msg="@variance_reduction applies to pseudo-random sampling only; remove it or @sampling.")
+
+    if "max_trials" in sim_config and "target_precision" not in sim_config:
+        raise ValuaScriptError(ErrorCode.INVALID_DIRECTIVE_VALUE, line=directives["max_trials"]["line"], error_msg="@max_trials only applies together with @target_precision.")
+    if sim_config.get("variance_reduction") == "lhs" and "target_precision" in sim_config:
+        raise ValuaScriptError(ErrorCode.INVALID_DIRECTIVE_VALUE, line=directives["target_precision"]["line"], error_msg='@target_precision cannot be combined with @variance_reduction = "lhs", which stratifies a fixed number of trials.')
+
     if not is_preview_mode and output_var not in final_defined_vars:
         if output_var not in defined_vars:
             raise ValuaScriptError(ErrorCode.UNDEFINED_VARIABLE, name=output_var)
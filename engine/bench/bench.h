@@ -0,0 +1,27 @@
+#pragma once
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Micro-benchmarks of single calls to every kind of function; see bench_functions.cpp.
+void register_function_benchmarks();
+// Whole runs of synthetic recipes and of the compiled recipes in `recipe_paths`, at several
+// trial and thread counts; see bench_recipes.cpp.
+void register_recipe_benchmarks(const std::vector<std::string> &recipe_paths);
+
+// Swallows what the engine prints to std::cout while it is built, which would otherwise end
+// up in the middle of the console or JSON report.
+class QuietCout
+{
+public:
+    QuietCout() : m_saved(std::cout.rdbuf(m_sink.rdbuf())) {}
+    ~QuietCout() { std::cout.rdbuf(m_saved); }
+
+    QuietCout(const QuietCout &) = delete;
+    QuietCout &operator=(const QuietCout &) = delete;
+
+private:
+    std::ostringstream m_sink;
+    std::streambuf *m_saved;
+};
@@ -0,0 +1,202 @@
+#include "bench/bench.h"
+#include "include/engine/functions/FunctionRegistry.h"
+#include "include/engine/functions/core/operations.h"
+#include "include/engine/functions/series/operations.h"
+#include "include/engine/functions/statistics/samplers.h"
+#include "include/engine/functions/io/operations.h"
+#include "include/engine/functions/financial/financial.h"
+#include "include/engine/functions/epidemiology/epidemiology.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+    constexpr size_t SERIES_LENGTH = 1000;
+    constexpr size_t PORTFOLIO_PERIODS = 30;
+    constexpr size_t LANES = 256;
+
+    // One call of `function`; `items` is how many values it computes, reported as items/s.
+    struct FunctionCase
+    {
+        std::string label;
+        std::string function;
+        std::vector<TrialValue> args;
+        size_t num_results = 1;
+        size_t items = 1;
+    };
+
+    const FunctionRegistry &registry()
+    {
+        static const FunctionRegistry functions = []
+        {
+            FunctionRegistry registry;
+            register_core_functions(registry);
+            register_series_functions(registry);
+            register_statistics_functions(registry);
+            register_io_functions(registry);
+            register_financial_functions(registry);
+            register_epidemiology_functions(registry);
+            return registry;
+        }();
+        return functions;
+    }
+
+    std::unique_ptr<IExecutable> create(const std::string &function)
+    {
+        return registry().get_factory_map().at(function)();
+    }
+
+    std::vector<double> ramp(size_t size, double first, double step)
+    {
+        std::vector<double> values(size);
+        for (size_t i = 0; i < size; ++i)
+            values[i] = first + step * static_cast<double>(i);
+        return values;
+    }
+
+    // Cash flows of SERIES_LENGTH instruments over PORTFOLIO_PERIODS, one row per period: an
+    // investment followed by growing returns.
+    std::vector<double> portfolio_cashflows()
+    {
+        std::vector<double> matrix(PORTFOLIO_PERIODS * SERIES_LENGTH);
+        for (size_t p = 0; p < PORTFOLIO_PERIODS; ++p)
+        {
+            for (size_t j = 0; j < SERIES_LENGTH; ++j)
+                matrix[p * SERIES_LENGTH + j] = p == 0 ? -1000.0 - static_cast<double>(j) : 80.0 + 0.5 * static_cast<double>(p + j % 7);
+        }
+        return matrix;
+    }
+
+    std::string write_csv_fixture()
+    {
+        const std::string path = (std::filesystem::temp_directory_path() / "vse_bench.csv").string();
+        std::ofstream out(path);
+        out << "period,value\n";
+        for (size_t i = 0; i < SERIES_LENGTH; ++i)
+            out << i << ',' << 100.0 + static_cast<double>(i) * 0.25 << '\n';
+        return path;
+    }
+
+    std::vector<FunctionCase> function_cases()
+    {
+        const std::vector<double> series = ramp(SERIES_LENGTH, 100.0, 0.5);
+        const std::vector<double> rates = ramp(SERIES_LENGTH, 0.01, 0.00005);
+        const std::vector<double> strikes = ramp(SERIES_LENGTH, 50.0, 0.1);
+        const std::string csv = write_csv_fixture();
+        return {
+            {"add/scalar", "add", {2.0, 3.0}},
+            {"add/vector", "add", {series, series}, 1, SERIES_LENGTH},
+            {"multiply/scalar", "multiply", {2.0, 3.0}},
+            {"multiply/vector", "multiply", {series, 1.01}, 1, SERIES_LENGTH},
+            {"divide/scalar", "divide", {2.0, 3.0}},
+            {"power/scalar", "power", {1.05, 10.0}},
+            {"log/scalar", "log", {2.5}},
+            {"exp/scalar", "exp", {0.5}},
+            {"gt/scalar", "__gt__", {2.0, 3.0}},
+            {"grow_series/scalar", "grow_series", {100.0, 0.05, static_cast<double>(PORTFOLIO_PERIODS)}, 1, PORTFOLIO_PERIODS},
+            {"grow_series/portfolio", "grow_series", {series, rates, static_cast<double>(PORTFOLIO_PERIODS)}, 1, SERIES_LENGTH * PORTFOLIO_PERIODS},
+            {"compound_series/vector", "compound_series", {100.0, rates}, 1, SERIES_LENGTH},
+            {"sum_series/vector", "sum_series", {series}, 1, SERIES_LENGTH},
+            {"series_delta/vector", "series_delta", {series}, 1, SERIES_LENGTH},
+            {"npv/vector", "npv", {0.08, series}, 1, SERIES_LENGTH},
+            {"npv/portfolio", "npv", {rates, portfolio_cashflows()}, 1, SERIES_LENGTH * PORTFOLIO_PERIODS},
+            {"irr/portfolio", "irr", {portfolio_cashflows(), static_cast<double>(SERIES_LENGTH)}, 1, SERIES_LENGTH * PORTFOLIO_PERIODS},
+            {"Normal/scalar", "Normal", {0.0, 1.0}},
+            {"Lognormal/scalar", "Lognormal", {0.0, 0.5}},
+            {"Beta/scalar", "Beta", {2.0, 5.0}},
+            {"Uniform/scalar", "Uniform", {0.0, 1.0}},
+            {"Bernoulli/scalar", "Bernoulli", {0.3}},
+            {"Pert/scalar", "Pert", {1.0, 2.0, 4.0}},
+            {"Triangular/scalar", "Triangular", {1.0, 2.0, 4.0}},
+            {"gbm_path/daily", "gbm_path", {100.0, 0.05, 0.2, 252.0, 1.0 / 252}, 1, 252},
+            {"ou_path/monthly", "ou_path", {0.03, 0.04, 0.5, 0.01, 120.0, 1.0 / 12}, 1, 120},
+            {"jump_diffusion_path/daily", "jump_diffusion_path", {100.0, 0.05, 0.2, 1.0, -0.1, 0.15, 252.0, 1.0 / 252}, 1, 252},
+            {"BlackScholes/scalar", "BlackScholes", {100.0, 105.0, 0.05, 1.0, 0.2, std::string("call")}},
+            {"BlackScholes/vector", "BlackScholes", {100.0, strikes, 0.05, 1.0, 0.2, std::string("put")}, 1, SERIES_LENGTH},
+            {"BlackScholesGreeks/scalar", "BlackScholesGreeks", {100.0, 105.0, 0.05, 1.0, 0.2, std::string("call")}, 5},
+            {"SirModel/euler", "SirModel", {999.0, 1.0, 0.0, 0.3, 0.1, 100.0, 1.0}, 3, 100},
+            {"SirModel/rk4", "SirModel", {999.0, 1.0, 0.0, 0.3, 0.1, 100.0, 1.0, std::string("rk4")}, 3, 100},
+            {"read_csv_scalar", "read_csv_scalar", {csv, std::string("value"), 500.0}},
+            {"read_csv_vector", "read_csv_vector", {csv, std::string("value")}, 1, SERIES_LENGTH},
+        };
+    }
+
+    // The interpreter's calling convention: arguments by reference, results written in place.
+    void call_function(benchmark::State &state, const FunctionCase &call)
+    {
+        const auto executable = create(call.function);
+        std::vector<const TrialValue *> args;
+        for (const TrialValue &arg : call.args)
+            args.push_back(&arg);
+        std::vector<TrialValue> values(call.num_results);
+        std::vector<TrialValue *> results;
+        for (TrialValue &value : values)
+            results.push_back(&value);
+
+        for (auto _ : state)
+        {
+            executable->execute_into(ArgumentSpan(args.data(), args.size()), ResultSpan(results.data(), results.size()));
+            benchmark::DoNotOptimize(values.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * call.items));
+    }
+
+    // Batched execution of LANES trials at once, with the literals bound first as the planner
+    // does. Null when the function has no lane kernel for these arguments.
+    std::unique_ptr<IExecutable> create_lanes(const FunctionCase &call, std::vector<double> &lane_values)
+    {
+        auto executable = create(call.function);
+        std::vector<const TrialValue *> literals;
+        for (const TrialValue &arg : call.args)
+            literals.push_back(&arg);
+        const std::vector<size_t> bound = executable->bind_literal_arguments(literals);
+        lane_values.clear();
+        for (size_t a = 0; a < call.args.size(); ++a)
+        {
+            if (std::find(bound.begin(), bound.end(), a) != bound.end())
+                continue;
+            const double *value = std::get_if<double>(&call.args[a]);
+            if (!value)
+                return nullptr;
+            lane_values.push_back(*value);
+        }
+        return executable->supports_lanes(lane_values.size()) ? std::move(executable) : nullptr;
+    }
+
+    void call_lanes(benchmark::State &state, const FunctionCase &call)
+    {
+        std::vector<double> lane_values;
+        const auto executable = create_lanes(call, lane_values);
+        // Every lane gets its own copy of each argument, nudged so lanes differ.
+        std::vector<std::vector<double>> columns;
+        std::vector<LaneArgument> args;
+        for (double value : lane_values)
+            columns.push_back(ramp(LANES, value, value * 1e-6));
+        for (const auto &column : columns)
+            args.push_back({column.data(), 1});
+        std::vector<double> out(LANES);
+
+        for (auto _ : state)
+        {
+            executable->execute_lanes(args.data(), args.size(), out.data(), LANES);
+            benchmark::DoNotOptimize(out.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * LANES));
+    }
+}
+
+void register_function_benchmarks()
+{
+    for (const FunctionCase &call : function_cases())
+    {
+        benchmark::RegisterBenchmark(("function/" + call.label).c_str(), call_function, call);
+        std::vector<double> lane_values;
+        if (call.num_results == 1 && create_lanes(call, lane_values))
+            benchmark::RegisterBenchmark(("lanes/" + call.label).c_str(), call_lanes, call);
+    }
+}
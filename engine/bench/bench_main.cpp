@@ -0,0 +1,31 @@
+#include "bench/bench.h"
+#include <benchmark/benchmark.h>
+#include <cstring>
+
+// Usage: vse_bench [--recipe=<compiled_recipe.json>]... [--benchmark_* options]
+// Every --recipe adds macro-benchmarks of that recipe; the remaining arguments go to Google
+// Benchmark, e.g. --benchmark_filter=recipe/ or --benchmark_format=json.
+int main(int argc, char *argv[])
+{
+    const char *const RECIPE_FLAG = "--recipe=";
+    std::vector<std::string> recipe_paths;
+    std::vector<char *> benchmark_args;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], RECIPE_FLAG, std::strlen(RECIPE_FLAG)) == 0)
+            recipe_paths.emplace_back(argv[i] + std::strlen(RECIPE_FLAG));
+        else
+            benchmark_args.push_back(argv[i]);
+    }
+
+    register_function_benchmarks();
+    register_recipe_benchmarks(recipe_paths);
+
+    int benchmark_argc = static_cast<int>(benchmark_args.size());
+    benchmark::Initialize(&benchmark_argc, benchmark_args.data());
+    if (benchmark::ReportUnrecognizedArguments(benchmark_argc, benchmark_args.data()))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
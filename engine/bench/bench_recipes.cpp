@@ -0,0 +1,143 @@
+#include "bench/bench.h"
+#include "include/engine/core/SimulationEngine.h"
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace
+{
+    const std::vector<size_t> STEP_COUNTS = {10, 100, 1000};
+    const std::vector<size_t> TRIAL_COUNTS = {1000, 10000, 100000};
+
+    std::vector<size_t> thread_counts()
+    {
+        const size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+        return hardware > 1 ? std::vector<size_t>{1, hardware} : std::vector<size_t>{1};
+    }
+
+    json variable(size_t slot) { return {{"type", "variable_index"}, {"value", slot}}; }
+    json literal(double value) { return {{"type", "scalar_literal"}, {"value", value}}; }
+
+    // A chain of `steps` scalar steps ending in the output. Every tenth step samples a normal
+    // shock, which the next step adds to the running value; the others alternately scale the
+    // running value and add the latest shock to it again.
+    json synthetic_recipe(size_t steps)
+    {
+        json registry = json::array();
+        json per_trial = json::array();
+        size_t shock = 0;
+        for (size_t i = 0; i < steps; ++i)
+        {
+            registry.push_back("v" + std::to_string(i));
+            json step = {{"type", "execution_assignment"}, {"result", {i}}, {"line", i + 1}};
+            if (i % 10 == 0)
+            {
+                step["function"] = "Normal";
+                step["args"] = {literal(i == 0 ? 100.0 : 0.0), literal(i == 0 ? 10.0 : 1.0)};
+                shock = i;
+            }
+            else if (i % 10 == 1 && i > 1)
+            {
+                step["function"] = "add";
+                step["args"] = {variable(i - 2), variable(shock)};
+            }
+            else if (i % 2 == 1)
+            {
+                step["function"] = "multiply";
+                step["args"] = {variable(i - 1), literal(1.001)};
+            }
+            else
+            {
+                step["function"] = "add";
+                step["args"] = {variable(i - 1), variable(shock)};
+            }
+            per_trial.push_back(step);
+        }
+        return {{"simulation_config", {{"num_trials", 1}, {"seed", 1}}},
+                {"output_variable_index", steps - 1},
+                {"variable_registry", registry},
+                {"pre_trial_steps", json::array()},
+                {"per_trial_steps", per_trial}};
+    }
+
+    // `recipe` with num_trials replaced and anything that would make the run's length vary
+    // removed, in the format it came in.
+    std::string with_trials(const std::string &text, size_t trials)
+    {
+        const bool binary = SimulationEngine::is_binary_recipe(text);
+        json recipe = binary ? json::from_cbor(text, true, true, json::cbor_tag_handler_t::ignore) : json::parse(text);
+        json &config = recipe["simulation_config"];
+        config["num_trials"] = trials;
+        config.erase("cache_dir");
+        config.erase("target_precision");
+        config.erase("max_trials");
+        if (!binary)
+            return recipe.dump();
+        const std::vector<std::uint8_t> cbor = json::to_cbor(recipe);
+        std::string bytes(std::begin(SimulationEngine::BINARY_RECIPE_MAGIC), std::end(SimulationEngine::BINARY_RECIPE_MAGIC));
+        bytes.append(cbor.begin(), cbor.end());
+        return bytes;
+    }
+
+    // Times run() alone; building the engine, pre-trial steps included, happens before.
+    // Reports trials/s and the mean ns per per-trial step.
+    void run_recipe(benchmark::State &state, const std::string &recipe, size_t trials, size_t steps, size_t threads)
+    {
+        std::unique_ptr<SimulationEngine> engine;
+        {
+            QuietCout quiet;
+            engine = SimulationEngine::from_recipe_text(recipe);
+        }
+        SchedulerConfig scheduler = engine->get_scheduler_config();
+        scheduler.threads = threads;
+        engine->set_scheduler_config(scheduler);
+
+        std::chrono::steady_clock::duration elapsed{};
+        for (auto _ : state)
+        {
+            StatisticsSink statistics;
+            const auto start = std::chrono::steady_clock::now();
+            engine->run({&statistics});
+            elapsed += std::chrono::steady_clock::now() - start;
+            benchmark::DoNotOptimize(statistics.trials());
+        }
+        const double trial_count = static_cast<double>(trials);
+        const double step_evaluations = static_cast<double>(state.iterations()) * trial_count * static_cast<double>(std::max<size_t>(steps, 1));
+        state.counters["trials_per_second"] = benchmark::Counter(trial_count, benchmark::Counter::kIsIterationInvariantRate);
+        state.counters["ns_per_step"] = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / step_evaluations;
+    }
+
+    void register_recipe(const std::string &name, const std::string &text, size_t steps)
+    {
+        for (size_t trials : TRIAL_COUNTS)
+        {
+            const std::string recipe = with_trials(text, trials);
+            for (size_t threads : thread_counts())
+            {
+                const std::string label = "recipe/" + name + "/trials:" + std::to_string(trials) + "/threads:" + std::to_string(threads);
+                benchmark::RegisterBenchmark(label.c_str(), run_recipe, recipe, trials, steps, threads)
+                    ->Unit(benchmark::kMillisecond)
+                    ->UseRealTime();
+            }
+        }
+    }
+}
+
+void register_recipe_benchmarks(const std::vector<std::string> &recipe_paths)
+{
+    for (size_t steps : STEP_COUNTS)
+    {
+        register_recipe("synthetic_" + std::to_string(steps), synthetic_recipe(steps).dump(), steps);
+    }
+    for (const std::string &path : recipe_paths)
+    {
+        const std::string text = SimulationEngine::read_recipe_file(path);
+        const json recipe = SimulationEngine::is_binary_recipe(text) ? json::from_cbor(text, true, true, json::cbor_tag_handler_t::ignore) : json::parse(text);
+        register_recipe(std::filesystem::path(path).stem().string(), text, recipe.value("per_trial_steps", json::array()).size());
+    }
+}
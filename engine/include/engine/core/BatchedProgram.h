@@ -0,0 +1,143 @@
+#pragma once
+
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/DeviceProgram.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Per-thread storage for batched execution, reused across blocks.
+struct BatchedFrame
+{
+    std::vector<double> lanes;                     // One block of lane_width doubles per varying value.
+    std::vector<double> scratch;                   // Compacted arguments and results for partial selections.
+    std::vector<LaneArgument> call_args;           // Argument descriptors for the current kernel call.
+    std::vector<double *> call_results;            // Result blocks of the current call with several results.
+    std::vector<std::vector<uint32_t>> selections; // Lane index lists, two per conditional nesting depth.
+    std::vector<const double *> device_inputs;     // Blocks copied to the device by a segment.
+    std::vector<double *> device_outputs;          // Blocks copied back from it.
+    StepProfile *profile = nullptr;                // Set while profiling; see Profiler.h.
+};
+
+// Structure-of-arrays execution of a BytecodeProgram. Every value holds a contiguous block of
+// trials ("lanes") and each instruction runs once per block through IExecutable::execute_lanes.
+// Conditionals split the active lanes and run each branch only on the lanes that take it.
+// A branch made only of a few calls to cheap functions (FunctionCost::Cheap, judged by the
+// `is_cheap` check) is instead predicated: it runs on every active lane, without gathering
+// or scattering them, and its value is blended into the destination with the condition as
+// a mask. Only programs whose values are all scalars or booleans can be batched, except for
+// the arguments of calls with several results (IExecutable::execute_lanes_into), which may be
+// series as long as they are trial-invariant.
+//
+// With a `device`, every maximal run of top-level instructions that have a device form becomes
+// a segment that runs on it (see DeviceProgram.h). A conditional whose branches are both
+// predicated joins the segment as a select. A segment falls back to its host
+// instructions for blocks the device cannot run: under a sampling design, whose uniforms are
+// tables on the host, and when a lane fails, which the host then reports as usual.
+class BatchedProgram
+{
+public:
+    using CostCheck = std::function<bool(const std::string &function_name)>;
+
+    // Returns nullptr when the program uses a value type or function that cannot be batched.
+    static std::unique_ptr<BatchedProgram> compile(const BytecodeProgram &program, const TrialContext &preloaded_context, const std::vector<size_t> &output_indices, size_t lane_width,
+                                                   const DeviceBackend *device = nullptr, const CostCheck &is_cheap = nullptr);
+    static std::unique_ptr<BatchedProgram> compile(const BytecodeProgram &program, const TrialContext &preloaded_context, size_t output_index, size_t lane_width);
+
+    size_t lane_width() const { return m_lane_width; }
+    // Instructions that run on the device, and the segments they form.
+    size_t device_instructions() const { return m_device_instructions; }
+    size_t device_segments() const { return m_segments.size(); }
+    // Branches of conditionals that run on every lane and are blended in.
+    size_t predicated_branches() const { return m_predicated_branches; }
+    BatchedFrame make_frame() const;
+
+    // Runs `lanes` (at most lane_width) trials and writes the values of output k to
+    // results[k * column_stride, k * column_stride + lanes).
+    void execute(size_t lanes, BatchedFrame &frame, TrialValue *results, size_t column_stride = 0) const;
+
+private:
+    enum class LaneType : uint8_t
+    {
+        Scalar,
+        Bool
+    };
+
+    struct LaneValue
+    {
+        bool uniform;   // Trial-invariant: a single value in m_uniforms.
+        uint32_t index; // Into m_uniforms, or the block number inside BatchedFrame::lanes.
+    };
+
+    struct LaneInstruction
+    {
+        enum class Kind : uint8_t
+        {
+            Kernel,
+            Move,
+            Branch,
+            Jump,
+            Device, // Segment first_arg, ending at target; its host instructions follow it.
+            Multi   // Call with several results, m_calls[target]; `result` is the first of them.
+        };
+
+        // Branch: the arms that are predicated. Its arguments are then the condition and the
+        // values of the then and else arms, blended into `result`.
+        static constexpr uint8_t THEN_ARM = 1;
+        static constexpr uint8_t ELSE_ARM = 2;
+
+        Kind kind;
+        uint8_t predicated;
+        const IExecutable *logic;
+        uint32_t first_arg;
+        uint32_t num_args;
+        LaneValue result;
+        uint32_t target;
+        uint32_t site;
+    };
+
+    struct MultiCall
+    {
+        std::vector<TrialValue> args;
+        std::vector<const TrialValue *> arg_refs; // Into args.
+        std::vector<LaneValue> results;
+    };
+
+    struct DeviceSegment
+    {
+        std::unique_ptr<DeviceKernel> kernel;
+        std::vector<uint32_t> inputs;  // Blocks copied in, one per DeviceProgram::inputs.
+        std::vector<uint32_t> outputs; // Blocks copied back, one per DeviceProgram::outputs.
+    };
+
+    BatchedProgram(const BytecodeProgram &program, size_t lane_width);
+
+    void predicate(const std::vector<uint32_t> &costs, const std::vector<bool> &writes_slot);
+    void offload(const DeviceBackend &device);
+    bool run_device(const DeviceSegment &segment, size_t lanes, BatchedFrame &frame) const;
+
+    void run_range(size_t begin, size_t end, const uint32_t *selection, size_t count, size_t depth, BatchedFrame &frame) const;
+    void run_predicated(const LaneInstruction &ins, size_t pc, const uint32_t *selection, size_t count, size_t depth, BatchedFrame &frame) const;
+    void run_kernel(const LaneInstruction &ins, const uint32_t *selection, size_t count, BatchedFrame &frame) const;
+    void run_move(const LaneInstruction &ins, const uint32_t *selection, size_t count, BatchedFrame &frame) const;
+    void run_multi(const LaneInstruction &ins, const uint32_t *selection, size_t count, BatchedFrame &frame) const;
+    double *block(BatchedFrame &frame, uint32_t index) const { return frame.lanes.data() + static_cast<size_t>(index) * m_lane_width; }
+
+    const BytecodeProgram *m_program;
+    size_t m_lane_width;
+    std::vector<LaneInstruction> m_code;
+    std::vector<LaneValue> m_args;
+    std::vector<double> m_uniforms;
+    size_t m_num_varying = 0;
+    size_t m_max_args = 0;
+    std::vector<MultiCall> m_calls;
+    size_t m_max_results = 0;
+    size_t m_max_depth = 0;
+    std::vector<std::pair<LaneValue, LaneType>> m_outputs;
+    std::vector<DeviceSegment> m_segments;
+    size_t m_device_instructions = 0;
+    size_t m_max_device_blocks = 0;
+    size_t m_predicated_branches = 0;
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "include/engine/core/DataStructures.h"
+#include "include/engine/core/IExecutionStep.h"
+#include "include/engine/core/IExecutable.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Where an instruction operand lives at runtime.
+enum class OperandSpace : uint8_t
+{
+    Slot,      // A variable slot written by the program, held in the per-thread scratch context.
+    Invariant, // A slot the program never writes, read from the shared pre-trial context.
+    Constant,  // A literal from the program's constant pool (read-only).
+    Register   // An SSA temporary holding the value of a nested expression.
+};
+
+// Static type of a slot or register. Slot types are declared by the recipe ("variable_types"),
+// register types are inferred from the instructions writing them. Unknown values are checked
+// at run time. The order follows the alternatives of TrialValue.
+enum class ValueType : uint8_t
+{
+    Unknown,
+    Scalar,
+    Series,
+    String,
+    Bool
+};
+
+ValueType value_type_of(const TrialValue &value);
+
+struct Operand
+{
+    OperandSpace space;
+    uint32_t index;
+};
+
+struct Instruction
+{
+    OpCode code;
+    uint32_t first_operand; // Arguments, then results, in BytecodeProgram::m_operands.
+    uint32_t num_args;
+    uint32_t num_results;
+    uint32_t target; // Callable index for calls, jump target for jumps, step index for RUN_STEP.
+    uint32_t site;   // Index into the debug sites, used to rebuild error messages.
+    bool direct_results; // No result operand is also an argument, so calls write results in place.
+    // The operand types were proven at plan time: fast paths skip their variant checks, and
+    // calls of functions with a lanes form go straight to IExecutable::execute_lanes().
+    bool typed = false;
+    ValueType result_type = ValueType::Unknown; // Of a typed instruction's result.
+    bool checks_results = false; // Writes a typed slot with a value of unproven type.
+};
+
+// Source-level context of an instruction. The chain of parents mirrors the nesting of the
+// original step tree so that errors carry exactly the same "In function ..." prefixes.
+struct DebugSite
+{
+    enum class Kind : uint8_t
+    {
+        Function,          // Top-level execution_assignment.
+        NestedFunction,    // Nested execution_assignment argument.
+        Conditional,       // Top-level conditional_assignment.
+        NestedConditional, // Nested conditional_expression argument.
+        Step               // A fallback step that decorates its own errors.
+    };
+
+    Kind kind;
+    std::string function_name;
+    int line_num;
+    int32_t parent;
+};
+
+class StepProfile;
+
+// Per-thread mutable state of the interpreter, reused across trials.
+struct BytecodeFrame
+{
+    std::vector<TrialValue> registers;
+    std::vector<const TrialValue *> call_args; // Arguments of the current call, by reference.
+    std::vector<TrialValue> call_results;      // Results of calls that read their own destination, swapped into place.
+    std::vector<TrialValue *> result_refs;     // Where the current call writes its results.
+    std::vector<double> lane_values;           // Arguments of the current typed call.
+    std::vector<LaneArgument> lane_args;
+    StepProfile *profile = nullptr;            // Set while profiling; see Profiler.h.
+};
+
+class BytecodeProgram
+{
+public:
+    // Runs one trial against a single context holding every slot.
+    void execute(TrialContext &context, BytecodeFrame &frame) const { execute(context, context, frame); }
+
+    // Runs one trial reading trial-invariant slots from the shared, read-only `invariants`
+    // context. Written slots live in `scratch`, a per-thread context from make_scratch()
+    // that is prepared for each trial with begin_trial().
+    void execute(const TrialContext &invariants, TrialContext &scratch, BytecodeFrame &frame) const;
+    TrialContext make_scratch(const TrialContext &invariants) const;
+    void begin_trial(const TrialContext &invariants, TrialContext &scratch) const;
+
+    // True when the slot is never written by the program, so its value lives in the
+    // invariant context rather than in the scratch context.
+    bool is_invariant_slot(size_t index) const;
+
+    BytecodeFrame make_frame() const;
+
+    size_t instruction_count() const { return m_code.size(); }
+    size_t register_count() const { return m_num_registers; }
+    size_t lowered_step_count() const { return m_lowered_steps; }
+    size_t fallback_step_count() const { return m_fallback_steps.size(); }
+    size_t typed_instruction_count() const;
+
+    // Read-only view for backends that re-compile the program (e.g. BatchedProgram).
+    const std::vector<Instruction> &code() const { return m_code; }
+    const std::vector<Operand> &operands() const { return m_operands; }
+    const std::vector<TrialValue> &constants() const { return m_constants; }
+    const std::vector<const IExecutable *> &callables() const { return m_callables; }
+    const std::vector<DebugSite> &sites() const { return m_sites; }
+
+    // Rethrows the in-flight exception decorated with the context of the given site.
+    // Must be called from inside a catch block.
+    [[noreturn]] void rethrow_with_context(uint32_t site_index) const;
+
+private:
+    friend class BytecodeBuilder;
+
+    void classify_slots(size_t num_slots);
+    void bind_types(std::vector<ValueType> slot_types, const TrialContext &initial_values);
+    void check_result_types(const Instruction &ins, const TrialValue *slots) const;
+
+    std::vector<Instruction> m_code;
+    std::vector<Operand> m_operands;
+    std::vector<TrialValue> m_constants;
+    std::vector<const IExecutable *> m_callables;
+    std::vector<const IExecutionStep *> m_fallback_steps;
+    std::vector<DebugSite> m_sites;
+    size_t m_num_registers = 0;
+    size_t m_lowered_steps = 0;
+    std::vector<bool> m_written_slots;   // Empty when fallback steps need the whole context.
+    std::vector<uint32_t> m_reset_slots; // Written slots that a trial may read before assigning.
+    std::vector<ValueType> m_slot_types; // Empty when no types were declared.
+    std::vector<ValueType> m_register_types;
+};
+
+// Flattens IExecutionStep trees into a BytecodeProgram. Steps describe themselves through
+// IExecutionStep::lower(); a step that cannot be lowered is kept as a RUN_STEP instruction
+// that executes the original tree.
+class BytecodeBuilder
+{
+public:
+    explicit BytecodeBuilder(size_t num_slots);
+
+    void add_step(const IExecutionStep &step);
+    BytecodeProgram finish();
+
+    // Declared types of the slots, and the values they hold before a trial (the pre-trial
+    // context). finish() then binds every instruction whose operand types follow from them;
+    // a slot that starts a trial with a value of another type is left untyped.
+    void set_slot_types(std::vector<ValueType> types, const TrialContext &initial_values);
+
+    // --- Emission API used by IExecutionStep::lower implementations ---
+    std::optional<Operand> slot(size_t index) const;
+    Operand constant(const TrialValue &value);
+    Operand new_register();
+
+    void open_site(DebugSite::Kind kind, const std::string &function_name, int line_num);
+    void close_site();
+
+    void emit_call(const IExecutable &logic, const std::string &function_name, const std::vector<Operand> &args, const std::vector<Operand> &results);
+    void emit_call(const IExecutable &logic, OpCode code, const std::vector<Operand> &args, const std::vector<Operand> &results);
+    void emit_move(Operand source, Operand destination);
+    size_t emit_jump_if_false(Operand condition);
+    size_t emit_jump();
+    void patch_jump_to_here(size_t instruction_index);
+
+private:
+    uint32_t emit(OpCode code, const std::vector<Operand> &args, const std::vector<Operand> &results, uint32_t target);
+
+    size_t m_num_slots;
+    std::vector<ValueType> m_slot_types;
+    const TrialContext *m_initial_values = nullptr;
+    BytecodeProgram m_program;
+    std::vector<int32_t> m_site_stack;
+};
+
+OpCode opcode_for_function(const std::string &function_name);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "include/engine/core/SimulationEngine.h"
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// A recipe compiled once for embedding applications: parsed, its registry built, its pre-trial
+// phase run and its per-trial steps lowered. A plan never changes after compile(), so any number
+// of threads may run it at once, each with its own seed, trial count and outputs; the runs share
+// its program and pre-trial values and keep their scratch state to themselves. A run that finds
+// the thread pool's workers busy with another run works through its chunks on the calling thread
+// until they are free; a run started from a sink on a worker does so throughout (see
+// ThreadPool::parallel_for).
+class CompiledPlan
+{
+public:
+    // `recipe` is the contents of a recipe, JSON or binary, as SimulationEngine::from_recipe_text()
+    // takes it; the plan keeps none of it. Messages while compiling go to `log`, or nowhere
+    // when it is empty; warnings of later runs go there too.
+    static std::shared_ptr<const CompiledPlan> compile(std::string_view recipe, LogCallback log = LogCallback());
+    // The same from a recipe document already in memory, such as the Python bindings' dicts.
+    static std::shared_ptr<const CompiledPlan> compile_document(const nlohmann::json &recipe, LogCallback log = LogCallback());
+
+    const SimulationEngine &engine() const { return *m_engine; }
+    const std::vector<std::string> &output_names() const { return m_engine->get_output_names(); }
+
+private:
+    explicit CompiledPlan(std::unique_ptr<const SimulationEngine> engine) : m_engine(std::move(engine)) {}
+
+    std::unique_ptr<const SimulationEngine> m_engine;
+};
+
+// Streams one run of `plan` into `sinks`; see SimulationEngine::run(options, sinks).
+RunReport run(const CompiledPlan &plan, const RunOptions &options, const std::vector<ResultSink *> &sinks);
+RunReport run(const CompiledPlan &plan, const RunOptions &options, ResultSink &sink);
+// The results of one run of `plan`, one column per selected output.
+std::vector<std::vector<TrialValue>> run_outputs(const CompiledPlan &plan, const RunOptions &options);
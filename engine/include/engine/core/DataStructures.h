@@ -45,5 +45,11 @@ enum class OpCode
     CAPITALIZE_EXPENSE,
     DELETE_ELEMENT,
     // Core
-    IDENTITY // For variable-to-variable assignment
+    IDENTITY, // For variable-to-variable assignment
+    // Bytecode control flow
+    CALL,          // Generic IExecutable invocation
+    FUSED,         // Fused element-wise expression tree (FusedExpression)
+    JUMP,          // Unconditional branch
+    JUMP_IF_FALSE, // Branch when a boolean condition is false
+    RUN_STEP       // Fallback to a non-lowered IExecutionStep
 };
\ No newline at end of file
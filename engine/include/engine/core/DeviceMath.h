@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Arithmetic shared by the CPU kernels and the device backends (see DeviceProgram.h). Everything
+// here compiles as host and device code, so a GPU draws the same random numbers as the CPU and
+// only differs from it in the rounding of its math library.
+#if defined(__CUDACC__)
+#define VSE_HOST_DEVICE __host__ __device__
+#else
+#define VSE_HOST_DEVICE
+#endif
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"): replaces
+// `counter` with the output block of (counter, key).
+VSE_HOST_DEVICE inline void philox4x32_block(uint32_t *counter, uint32_t key0, uint32_t key1)
+{
+    constexpr uint32_t M0 = 0xD2511F53u;
+    constexpr uint32_t M1 = 0xCD9E8D57u;
+    constexpr uint32_t W0 = 0x9E3779B9u;
+    constexpr uint32_t W1 = 0xBB67AE85u;
+    for (int round = 0; round < 10; ++round)
+    {
+        const uint64_t p0 = static_cast<uint64_t>(M0) * counter[0];
+        const uint64_t p1 = static_cast<uint64_t>(M1) * counter[2];
+        const uint32_t c1 = counter[1];
+        const uint32_t c3 = counter[3];
+        counter[0] = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ key0;
+        counter[1] = static_cast<uint32_t>(p1);
+        counter[2] = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ key1;
+        counter[3] = static_cast<uint32_t>(p0);
+        key0 += W0;
+        key1 += W1;
+    }
+}
+
+// Uniform double in [0, 1) with 53 random bits from two consecutive 32-bit draws.
+VSE_HOST_DEVICE inline double uniform_from_bits(uint32_t high, uint32_t low)
+{
+    return static_cast<double>(((static_cast<uint64_t>(high) << 32) | low) >> 11) * 0x1.0p-53;
+}
+
+// The first block of the stream of RandomStream(seed, trial, site), whose first two uniforms are
+// uniform_from_bits(block[0], block[1]) and uniform_from_bits(block[2], block[3]).
+VSE_HOST_DEVICE inline void first_stream_block(uint64_t seed, uint64_t trial, uint32_t site, uint32_t *block)
+{
+    block[0] = 0;
+    block[1] = site;
+    block[2] = static_cast<uint32_t>(trial);
+    block[3] = static_cast<uint32_t>(trial >> 32);
+    philox4x32_block(block, static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32));
+}
+
+// Box–Muller transform of two uniforms in [0, 1); 1 - u1 keeps the logarithm finite.
+VSE_HOST_DEVICE inline double box_muller(double u1, double u2)
+{
+    constexpr double TWO_PI = 6.28318530717958647692;
+    return std::sqrt(-2.0 * std::log(1.0 - u1)) * std::cos(TWO_PI * u2);
+}
+
+// Standard normal distribution function, accurate to double precision (Hart's rational
+// approximation as given by W. J. West, "Better approximations to cumulative normal functions",
+// 2004). Both branches of the original are evaluated and one selected, so loops over it vectorize.
+VSE_HOST_DEVICE inline double normal_cdf(double x)
+{
+    const double z = std::fabs(x);
+    const double e = std::exp(-0.5 * z * z);
+
+    double numerator = 3.52624965998911e-02 * z + 0.700383064443688;
+    numerator = numerator * z + 6.37396220353165;
+    numerator = numerator * z + 33.912866078383;
+    numerator = numerator * z + 112.079291497871;
+    numerator = numerator * z + 221.213596169931;
+    numerator = numerator * z + 220.206867912376;
+    double denominator = 8.83883476483184e-02 * z + 1.75566716318264;
+    denominator = denominator * z + 16.064177579207;
+    denominator = denominator * z + 86.7807322029461;
+    denominator = denominator * z + 296.564248779674;
+    denominator = denominator * z + 637.333633378831;
+    denominator = denominator * z + 793.826512519948;
+    denominator = denominator * z + 440.413735824752;
+    const double rational = e * numerator / denominator;
+
+    // Continued fraction for the far tail.
+    double fraction = z + 0.65;
+    fraction = z + 4.0 / fraction;
+    fraction = z + 3.0 / fraction;
+    fraction = z + 2.0 / fraction;
+    fraction = z + 1.0 / fraction;
+    const double tail = e / fraction / 2.506628274631;
+
+    const double lower = z < 7.07106781186547 ? rational : (z < 37.0 ? tail : 0.0);
+    return x > 0.0 ? 1.0 - lower : lower;
+}
+
+// Intermediates of a Black-Scholes price; `sign` is 1 for a call and -1 for a put, which is a
+// call with the signs of d1, d2 and the payoff flipped.
+struct BlackScholesTerms
+{
+    double sqrt_t;
+    double v_sqrt_t;
+    double d1;
+    double discounted_strike;
+    double n1; // N(sign * d1)
+    double n2; // N(sign * d2)
+    double price;
+};
+
+VSE_HOST_DEVICE inline BlackScholesTerms black_scholes_terms(double S, double K, double r, double T, double v, double sign)
+{
+    BlackScholesTerms terms;
+    terms.sqrt_t = std::sqrt(T);
+    terms.v_sqrt_t = v * terms.sqrt_t;
+    terms.d1 = (std::log(S / K) + (r + (v * v) / 2.0) * T) / terms.v_sqrt_t;
+    const double d2 = terms.d1 - terms.v_sqrt_t;
+    terms.discounted_strike = K * std::exp(-r * T);
+    terms.n1 = normal_cdf(sign * terms.d1);
+    terms.n2 = normal_cdf(sign * d2);
+    terms.price = sign * (S * terms.n1 - terms.discounted_strike * terms.n2);
+    return terms;
+}
+
+// Spot, strike, time and volatility must be positive.
+VSE_HOST_DEVICE inline bool valid_black_scholes_inputs(double S, double K, double T, double v)
+{
+    return S > 0 && K > 0 && T > 0 && v > 0;
+}
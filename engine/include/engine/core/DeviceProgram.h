@@ -0,0 +1,260 @@
+#pragma once
+
+#include "include/engine/core/DeviceMath.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Offload of batched programs to an accelerator (simulation_config "device", or `vse --device`).
+//
+// Runs of consecutive top-level instructions of a BatchedProgram whose functions have a device
+// form (IExecutable::lower_to_device) are compiled into a DeviceProgram: a small register
+// machine that one GPU thread runs per trial. Samplers draw on the device from the same
+// counter-based streams as on the CPU, so nothing random is transferred. Only the values the
+// run reads from earlier host steps are copied in, and only those read later (or output) are
+// copied back. Everything else, and every block on which a device run reports an error, runs
+// on the CPU as before.
+
+enum class DeviceOp : uint8_t
+{
+    // Operands folded from the left, as the variadic operations do.
+    Add,
+    Subtract,
+    Multiply,
+    Divide, // Fails the lane when a divisor is zero.
+    Power,
+    And,
+    Or,
+    // One operand.
+    Log,
+    Log10,
+    Exp,
+    Sin,
+    Cos,
+    Tan,
+    Not,
+    Move,
+    // Two operands, 1.0 for true and 0.0 for false.
+    Eq,
+    Neq,
+    Gt,
+    Lt,
+    Gte,
+    Lte,
+    // Three operands: the second where the first is true (non-zero), else the third.
+    Select,
+    // Samplers: the parameters, drawing from the stream of (seed, trial, site).
+    Normal,
+    Uniform,
+    Bernoulli,
+    Lognormal,
+    // Spot, strike, rate, time and volatility; fails the lane for invalid inputs.
+    BlackScholesCall,
+    BlackScholesPut
+};
+
+enum class OpCode; // DataStructures.h
+
+// The device op of an arithmetic, unary math, comparison or logical OpCode; false for others.
+bool device_op_for(OpCode code, DeviceOp &op);
+
+struct DeviceInstruction
+{
+    DeviceOp op;
+    uint32_t first_operand; // Into DeviceProgram::operands.
+    uint32_t num_operands;
+    uint32_t result; // A register.
+    uint32_t site;   // Call site of a sampler.
+};
+
+// Operands with this bit set index DeviceProgram::constants; the others are registers.
+constexpr uint32_t DEVICE_CONSTANT = 0x80000000u;
+
+struct DeviceProgram
+{
+    std::vector<DeviceInstruction> code;
+    std::vector<uint32_t> operands;
+    std::vector<double> constants;
+    uint32_t num_registers = 0;
+    std::vector<uint32_t> inputs;  // Registers set from the host before a run.
+    std::vector<uint32_t> outputs; // Registers copied back to the host after it.
+};
+
+// Builds the code of a DeviceProgram; see IExecutable::lower_to_device.
+class DeviceLowering
+{
+public:
+    explicit DeviceLowering(DeviceProgram &program) : m_program(program) {}
+
+    uint32_t temporary() { return m_program.num_registers++; }
+    void emit(DeviceOp op, const uint32_t *operands, size_t num_operands, uint32_t result, uint32_t site = 0);
+
+private:
+    DeviceProgram &m_program;
+};
+
+// The trials of one device run: lane i is trial first_trial + i.
+struct DeviceLaunch
+{
+    uint64_t seed;
+    uint64_t first_trial;
+    size_t lanes;
+};
+
+// A DeviceProgram prepared for one backend. run() may be called from several threads at once.
+class DeviceKernel
+{
+public:
+    virtual ~DeviceKernel() = default;
+
+    // Sets register program.inputs[k] of every lane from inputs[k] (launch.lanes values), runs
+    // the program and copies register program.outputs[k] to outputs[k]. Returns false when a
+    // lane failed, in which case the outputs are unspecified.
+    virtual bool run(const DeviceLaunch &launch, const double *const *inputs, double *const *outputs) const = 0;
+};
+
+class DeviceBackend
+{
+public:
+    virtual ~DeviceBackend() = default;
+    virtual const char *name() const = 0;
+    virtual std::unique_ptr<DeviceKernel> prepare(const DeviceProgram &program) const = 0;
+    // Trials per launch unless the recipe sets "lane_width"; GPUs need many per launch.
+    virtual size_t preferred_lane_width() const { return 16384; }
+};
+
+// "host" runs device programs on the calling thread, lane by lane through the same code as the
+// GPU backends; it is the reference they are tested against. "jit" compiles each program to
+// native code and needs a build with -DVSE_ENABLE_LLVM=ON; "cuda" needs a build with
+// -DVSE_ENABLE_CUDA=ON and a GPU. Returns null for "cpu"; throws EngineException for other names.
+std::unique_ptr<DeviceBackend> make_device_backend(const std::string &name);
+
+// Runs `code` for one lane. Register r of the lane is registers[r * pitch + lane]. Returns false
+// when the lane fails: the host then reruns the block to report the error as it always does.
+VSE_HOST_DEVICE inline bool run_device_lane(const DeviceInstruction *code, size_t code_size, const uint32_t *operands, const double *constants, double *registers, size_t pitch, size_t lane, uint64_t seed, uint64_t trial)
+{
+    for (size_t pc = 0; pc < code_size; ++pc)
+    {
+        const DeviceInstruction &ins = code[pc];
+        const uint32_t *args = operands + ins.first_operand;
+        auto arg = [&](uint32_t k)
+        {
+            const uint32_t operand = args[k];
+            return (operand & DEVICE_CONSTANT) ? constants[operand & ~DEVICE_CONSTANT] : registers[operand * pitch + lane];
+        };
+        double value = arg(0);
+        switch (ins.op)
+        {
+        case DeviceOp::Add:
+            for (uint32_t k = 1; k < ins.num_operands; ++k)
+                value = value + arg(k);
+            break;
+        case DeviceOp::Subtract:
+            for (uint32_t k = 1; k < ins.num_operands; ++k)
+                value = value - arg(k);
+            break;
+        case DeviceOp::Multiply:
+            for (uint32_t k = 1; k < ins.num_operands; ++k)
+                value = value * arg(k);
+            break;
+        case DeviceOp::Divide:
+            for (uint32_t k = 1; k < ins.num_operands; ++k)
+            {
+                const double divisor = arg(k);
+                if (divisor == 0.0)
+                    return false;
+                value = value / divisor;
+            }
+            break;
+        case DeviceOp::Power:
+            for (uint32_t k = 1; k < ins.num_operands; ++k)
+                value = std::pow(value, arg(k));
+            break;
+        case DeviceOp::And:
+            for (uint32_t k = 1; k < ins.num_operands; ++k)
+                value = (value != 0.0 && arg(k) != 0.0) ? 1.0 : 0.0;
+            break;
+        case DeviceOp::Or:
+            for (uint32_t k = 1; k < ins.num_operands; ++k)
+                value = (value != 0.0 || arg(k) != 0.0) ? 1.0 : 0.0;
+            break;
+        case DeviceOp::Log:
+            value = std::log(value);
+            break;
+        case DeviceOp::Log10:
+            value = std::log10(value);
+            break;
+        case DeviceOp::Exp:
+            value = std::exp(value);
+            break;
+        case DeviceOp::Sin:
+            value = std::sin(value);
+            break;
+        case DeviceOp::Cos:
+            value = std::cos(value);
+            break;
+        case DeviceOp::Tan:
+            value = std::tan(value);
+            break;
+        case DeviceOp::Not:
+            value = value != 0.0 ? 0.0 : 1.0;
+            break;
+        case DeviceOp::Move:
+            break;
+        case DeviceOp::Eq:
+            value = value == arg(1) ? 1.0 : 0.0;
+            break;
+        case DeviceOp::Neq:
+            value = value != arg(1) ? 1.0 : 0.0;
+            break;
+        case DeviceOp::Gt:
+            value = value > arg(1) ? 1.0 : 0.0;
+            break;
+        case DeviceOp::Lt:
+            value = value < arg(1) ? 1.0 : 0.0;
+            break;
+        case DeviceOp::Gte:
+            value = value >= arg(1) ? 1.0 : 0.0;
+            break;
+        case DeviceOp::Lte:
+            value = value <= arg(1) ? 1.0 : 0.0;
+            break;
+        case DeviceOp::Select:
+            value = value != 0.0 ? arg(1) : arg(2);
+            break;
+        case DeviceOp::Normal:
+        case DeviceOp::Lognormal:
+        {
+            uint32_t block[4];
+            first_stream_block(seed, trial, ins.site, block);
+            const double z = box_muller(uniform_from_bits(block[0], block[1]), uniform_from_bits(block[2], block[3]));
+            value = value + arg(1) * z;
+            if (ins.op == DeviceOp::Lognormal)
+                value = std::exp(value);
+            break;
+        }
+        case DeviceOp::Uniform:
+        case DeviceOp::Bernoulli:
+        {
+            uint32_t block[4];
+            first_stream_block(seed, trial, ins.site, block);
+            const double u = uniform_from_bits(block[0], block[1]);
+            value = ins.op == DeviceOp::Uniform ? value + (arg(1) - value) * u : (u < value ? 1.0 : 0.0);
+            break;
+        }
+        case DeviceOp::BlackScholesCall:
+        case DeviceOp::BlackScholesPut:
+        {
+            const double K = arg(1), r = arg(2), T = arg(3), v = arg(4);
+            if (!valid_black_scholes_inputs(value, K, T, v))
+                return false;
+            value = black_scholes_terms(value, K, r, T, v, ins.op == DeviceOp::BlackScholesCall ? 1.0 : -1.0).price;
+            break;
+        }
+        }
+        registers[static_cast<size_t>(ins.result) * pitch + lane] = value;
+    }
+    return true;
+}
@@ -2,12 +2,19 @@
 
 #include "include/engine/core/IExecutionStep.h"
 #include "include/engine/core/IExecutable.h"
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/SmallVector.h"
+#include <functional>
+#include <optional>
+
+class InvariantHoister;
 
 class LiteralAssignmentStep : public IExecutionStep
 {
 public:
     LiteralAssignmentStep(size_t result_index, TrialValue value);
     void execute(TrialContext &context) const override;
+    bool lower(BytecodeBuilder &builder) const override;
 
 private:
     size_t m_result_index;
@@ -18,8 +25,9 @@ struct ArgumentPlanner
 {
     struct NestedFunctionCall;
     struct NestedConditional;
+    struct HoistedExpression;
 
-    using ResolvedArgument = std::variant<TrialValue, size_t, std::unique_ptr<NestedFunctionCall>, std::unique_ptr<NestedConditional>>;
+    using ResolvedArgument = std::variant<TrialValue, size_t, std::unique_ptr<NestedFunctionCall>, std::unique_ptr<NestedConditional>, std::unique_ptr<HoistedExpression>>;
     using ExecutableFactory = std::unordered_map<std::string, std::function<std::unique_ptr<IExecutable>()>>;
 
     struct NestedFunctionCall
@@ -28,6 +36,7 @@ struct ArgumentPlanner
         std::vector<ResolvedArgument> args;
         std::string function_name;
         int line_num;
+        bool decorates_errors = false; // Set for fused trees, which prefix their own errors.
     };
 
     struct NestedConditional
@@ -38,9 +47,85 @@ struct ArgumentPlanner
         int line_num;
     };
 
-    static ResolvedArgument build_argument_plan(const nlohmann::json &arg, const ExecutableFactory &factory);
+    // A trial-invariant nested call taken out of a per-trial step; see InvariantHoister. Once
+    // evaluated, `value` stands in for the call. Until then, or if the evaluation failed, the
+    // call runs on every trial as before, so its results and errors are unchanged.
+    struct HoistedExpression
+    {
+        ResolvedArgument plan;
+        std::optional<TrialValue> value;
+    };
+
+    // Builds the plan of one argument. Nested trees of element-wise operations are fused into
+    // a single FusedExpression call whose arguments are the leaves of the tree.
+    // With a `hoister`, trial-invariant calls are hoisted before fusion.
+    static ResolvedArgument build_argument_plan(const nlohmann::json &arg, const ExecutableFactory &factory, InvariantHoister *hoister = nullptr);
+    static ResolvedArgument build_unfused_plan(const nlohmann::json &arg, const ExecutableFactory &factory);
+
+    // The value of a vector literal: an array of numbers, or in binary recipes a byte string of
+    // packed little-endian doubles.
+    static std::vector<double> vector_literal_values(const nlohmann::json &value, int line_num = -1);
+
+    // Lets `logic` bind its literal arguments (see IExecutable::bind_literal_arguments) and
+    // drops the ones it took over from `args`.
+    static void bind_literals(IExecutable &logic, std::vector<ResolvedArgument> &args);
+
+    // Fuses every maximal element-wise tree inside `arg`.
+    static void fuse_expressions(ResolvedArgument &arg);
+
+    // Fuses a call to `function_name` with its element-wise nested arguments when the tree has
+    // more than one operation. On success `logic` becomes the FusedExpression, `args` its leaves,
+    // and true is returned. With `decorate_root`, errors of the root operation are prefixed as
+    // a nested call would prefix them.
+    static bool fuse_call(std::unique_ptr<IExecutable> &logic, std::vector<ResolvedArgument> &args,
+                          const std::string &function_name, int line_num, bool decorate_root);
+
+    // Evaluates `arg` in a trial. Levels of the tree do not catch errors: `site` is set to each
+    // nested call or conditional just before it can fail, and on failure the step passes it to
+    // rethrow_from_site(), which formats the "In nested ..." prefixes of the levels around it.
+    static TrialValue resolve_runtime_value(const ResolvedArgument &arg, const TrialContext &context, const void *&site);
+
+    // The arguments of a call in a trial, by reference: variables, literals and hoisted values
+    // where they are, the others evaluated into `values`. Short calls need no heap.
+    using ArgumentValues = SmallVector<TrialValue, 8>;
+    using ArgumentRefs = SmallVector<const TrialValue *, 8>;
+    static void resolve_arguments(const std::vector<ResolvedArgument> &plans, const TrialContext &context, const void *&site, ArgumentValues &values, ArgumentRefs &args);
+
+    // Rethrows the in-flight exception of a step whose arguments are `roots`, decorated by the
+    // levels around `site` and then by `prefix` at `line_num`. With `index_errors`, a
+    // std::out_of_range raised by the step itself reports a bad variable index. Must be called
+    // from inside a catch block.
+    [[noreturn]] static void rethrow_from_site(const std::vector<const ResolvedArgument *> &roots, const void *site, const std::string &prefix, int line_num, bool index_errors);
+
+    static std::optional<Operand> lower_argument(const ResolvedArgument &arg, BytecodeBuilder &builder);
+};
+
+// Finds the nested calls of per-trial steps whose value is the same on every trial: calls to
+// pure functions whose leaves are literals or slots that no per-trial step assigns. The engine
+// evaluates them once, after the pre-trial phase.
+class InvariantHoister
+{
+public:
+    using PurityCheck = std::function<bool(const std::string &function_name)>;
+
+    // `per_trial_slots[i]` is true when a per-trial step assigns slot i.
+    InvariantHoister(std::vector<bool> per_trial_slots, PurityCheck is_pure);
+
+    // Replaces every maximal invariant nested call inside `arg` with a HoistedExpression.
+    void hoist(ArgumentPlanner::ResolvedArgument &arg);
 
-    static TrialValue resolve_runtime_value(const ResolvedArgument &arg, const TrialContext &context);
+    // Evaluates the hoisted calls against the pre-trial context. Calls that fail are left to
+    // run per trial, where they report their error as usual. Returns the number evaluated.
+    size_t evaluate(const TrialContext &context);
+
+    size_t num_hoisted() const { return m_hoisted.size(); }
+
+private:
+    bool is_invariant(const ArgumentPlanner::ResolvedArgument &arg) const;
+
+    std::vector<bool> m_per_trial_slots;
+    PurityCheck m_is_pure;
+    std::vector<ArgumentPlanner::HoistedExpression *> m_hoisted;
 };
 
 class ExecutionAssignmentStep : public IExecutionStep
@@ -52,9 +137,11 @@ public:
         int line_num,
         std::unique_ptr<IExecutable> logic,
         const nlohmann::json &args,
-        const ArgumentPlanner::ExecutableFactory &factory);
+        const ArgumentPlanner::ExecutableFactory &factory,
+        InvariantHoister *hoister = nullptr);
 
     void execute(TrialContext &context) const override;
+    bool lower(BytecodeBuilder &builder) const override;
 
 private:
     std::vector<size_t> m_result_indices;
@@ -62,6 +149,7 @@ private:
     int m_line_num;
     std::unique_ptr<IExecutable> m_logic;
     std::vector<ArgumentPlanner::ResolvedArgument> m_resolved_args;
+    bool m_fused = false; // m_logic is a FusedExpression over the leaves in m_resolved_args.
 };
 
 class ConditionalAssignmentStep : public IExecutionStep
@@ -73,14 +161,25 @@ public:
         const nlohmann::json &condition,
         const nlohmann::json &then_expr,
         const nlohmann::json &else_expr,
-        const ArgumentPlanner::ExecutableFactory &factory);
+        const ArgumentPlanner::ExecutableFactory &factory,
+        InvariantHoister *hoister = nullptr);
 
     void execute(TrialContext &context) const override;
+    bool lower(BytecodeBuilder &builder) const override;
+
+    // Runs `step` only when the given branch is taken, just before its expression. Deferred
+    // steps run in the order they were added and report their errors as top-level steps do.
+    void defer_step(bool then_branch, const IExecutionStep &step);
 
 private:
+    bool lower_branch(BytecodeBuilder &builder, const std::vector<const IExecutionStep *> &deferred,
+                      const ArgumentPlanner::ResolvedArgument &plan, Operand destination) const;
+
     size_t m_result_index;
     int m_line_num;
     ArgumentPlanner::ResolvedArgument m_condition_plan;
     ArgumentPlanner::ResolvedArgument m_then_plan;
     ArgumentPlanner::ResolvedArgument m_else_plan;
+    std::vector<const IExecutionStep *> m_deferred_then;
+    std::vector<const IExecutionStep *> m_deferred_else;
 };
\ No newline at end of file
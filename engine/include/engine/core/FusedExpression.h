@@ -0,0 +1,73 @@
+#pragma once
+
+#include "include/engine/core/DataStructures.h"
+#include "include/engine/core/IExecutable.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A tree of element-wise operations (arithmetic, unary math, and a comparison at the root)
+// compiled into one callable. Series are evaluated in cache-sized tiles, node by node, so the
+// tree never materialises a full-length temporary per level. The arguments are the leaves of
+// the tree in order.
+//
+// Whenever the fused loop would raise an error (division by zero, mismatched lengths, values
+// of the wrong type) the call is replayed through the original functions, which reproduces
+// their results and error messages exactly.
+class FusedExpression : public InPlaceExecutable<1>
+{
+public:
+    struct Node
+    {
+        OpCode code;                        // IDENTITY for a leaf.
+        uint32_t num_args;                  // Operands taken from the evaluation stack.
+        uint32_t leaf;                      // Argument index of a leaf.
+        std::unique_ptr<IExecutable> logic; // The original function of an operation node.
+        std::string function_name;
+        int line_num;
+        bool decorates_errors; // Prefix errors with "In nested function", as a nested call would.
+    };
+
+    // `nodes` is the tree in postfix order.
+    explicit FusedExpression(std::vector<Node> nodes);
+
+    // True when a call to `function_name` with `num_args` arguments can be part of a fused tree;
+    // `as_root` also admits comparisons, whose boolean result cannot feed another operation.
+    static bool can_fuse(const std::string &function_name, size_t num_args, bool as_root);
+
+    // True when `accept` admits the function of every operation node.
+    bool calls_only(const std::function<bool(const std::string &function_name)> &accept) const;
+
+    bool returns_bool() const { return m_returns_bool; }
+    size_t num_leaves() const { return m_num_leaves; }
+    size_t num_operations() const { return m_nodes.size() - m_num_leaves; }
+
+    bool supports_lanes(size_t num_args) const override { return num_args == m_num_leaves; }
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+
+private:
+    struct Leaf
+    {
+        const double *data; // Null for uniform leaves.
+        double value;
+    };
+
+    static constexpr size_t TILE = 256;
+
+    // Evaluates `count` consecutive elements starting at `offset` into `out`. Returns the index
+    // of the node that would divide by zero, or m_nodes.size() on success.
+    size_t run_tile(const Leaf *leaves, size_t offset, size_t count, double *out) const;
+    void evaluate_unfused(ArgumentSpan args, TrialValue *const *results) const;
+    [[noreturn]] void throw_division_by_zero(size_t node) const;
+
+    std::vector<Node> m_nodes;
+    size_t m_num_leaves = 0;
+    size_t m_max_depth = 0;
+    bool m_returns_bool = false;
+    bool m_scalar_only = false; // Unary math and comparisons only accept scalars.
+};
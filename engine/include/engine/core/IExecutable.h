@@ -1,10 +1,145 @@
 #pragma once
 #include "DataStructures.h"
+#include "SmallVector.h"
+#include "Span.h"
+#include <stdexcept>
 #include <vector>
 
+// Arguments are read by reference; results are caller-owned slots written in place.
+using ArgumentSpan = Span<const TrialValue *const>;
+using ResultSpan = Span<TrialValue *const>;
+
+// One argument of a batched call: lane i reads data[i * stride]. Uniform (trial-invariant)
+// arguments have a stride of zero.
+struct LaneArgument
+{
+    const double *data;
+    size_t stride;
+
+    double operator[](size_t lane) const { return data[lane * stride]; }
+};
+
+class DeviceLowering; // DeviceProgram.h
+
 class IExecutable
 {
 public:
     virtual ~IExecutable() = default;
     virtual std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const = 0;
-};
\ No newline at end of file
+
+    // Allocation-free calling convention used by the bytecode interpreter. Returns the number
+    // of values the function produces; `results` is only written when that number equals
+    // results.size(), otherwise the caller reports the mismatch. Results never alias arguments.
+    // The default adapter forwards to execute().
+    virtual size_t execute_into(ArgumentSpan args, ResultSpan results) const
+    {
+        std::vector<TrialValue> arg_values;
+        arg_values.reserve(args.size());
+        for (const TrialValue *arg : args)
+        {
+            arg_values.push_back(*arg);
+        }
+        std::vector<TrialValue> values = execute(arg_values);
+        if (values.size() == results.size())
+        {
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                *results[i] = std::move(values[i]);
+            }
+        }
+        return values.size();
+    }
+
+    // Plan-time specialisation, called once per call site before any trial runs, with each
+    // argument that is a literal (null for the others). A function may resolve literals here
+    // instead of on every call; it returns the positions of the arguments it has taken over,
+    // which are then left out of every call, so `args` only holds the others.
+    virtual std::vector<size_t> bind_literal_arguments(const std::vector<const TrialValue *> & /*literals*/) { return {}; }
+
+    // Structure-of-arrays entry point used by batched ("trial lanes") execution. Functions that
+    // map scalar arguments to a single scalar result can compute `lanes` trials in one call.
+    // Booleans are passed and returned as 0.0/1.0.
+    virtual bool supports_lanes(size_t /*num_args*/) const { return false; }
+    virtual void execute_lanes(const LaneArgument * /*args*/, size_t /*num_args*/, double * /*out*/, size_t /*lanes*/) const
+    {
+        throw std::logic_error("Function does not support batched execution.");
+    }
+
+    // Batched form of a call with several scalar results whose arguments are all trial-invariant
+    // (and may be series): result r of lane i is written to out[r][i].
+    virtual bool supports_lane_results(ArgumentSpan /*args*/, size_t /*num_results*/) const { return false; }
+    virtual void execute_lanes_into(ArgumentSpan /*args*/, double *const * /*out*/, size_t /*num_results*/, size_t /*lanes*/) const
+    {
+        throw std::logic_error("Function does not support batched execution with several results.");
+    }
+
+    // Device form of a batched call (see DeviceProgram.h): emits instructions that compute the
+    // call from the operands `args` into the register `result`, and returns true. Functions
+    // without one return false, and their calls run on the host.
+    virtual bool lower_to_device(DeviceLowering & /*lowering*/, const uint32_t * /*args*/, size_t /*num_args*/, uint32_t /*result*/) const { return false; }
+};
+
+// Base for functions implemented natively on execute_into() that produce a fixed number of
+// results; execute() is derived from it. Subclasses implement evaluate().
+template <size_t NumResults = 1>
+class InPlaceExecutable : public IExecutable
+{
+public:
+    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override
+    {
+        SmallVector<const TrialValue *, 8> arg_refs;
+        for (const TrialValue &arg : args)
+        {
+            arg_refs.push_back(&arg);
+        }
+        std::vector<TrialValue> values(NumResults);
+        TrialValue *result_refs[NumResults];
+        for (size_t i = 0; i < NumResults; ++i)
+        {
+            result_refs[i] = &values[i];
+        }
+        evaluate(ArgumentSpan(arg_refs.data(), arg_refs.size()), result_refs);
+        return values;
+    }
+
+    size_t execute_into(ArgumentSpan args, ResultSpan results) const override
+    {
+        if (results.size() != NumResults)
+        {
+            // Validate the arguments exactly as execute() would before reporting the mismatch.
+            return IExecutable::execute_into(args, ResultSpan());
+        }
+        evaluate(args, results.data());
+        return NumResults;
+    }
+
+protected:
+    virtual void evaluate(ArgumentSpan args, TrialValue *const *results) const = 0;
+};
+
+// Returns the series held by `slot` resized to `size`, reusing its storage when possible.
+inline std::vector<double> &assign_series(TrialValue &slot, size_t size)
+{
+    if (auto *series = std::get_if<std::vector<double>>(&slot))
+    {
+        series->resize(size);
+        return *series;
+    }
+    return slot.emplace<std::vector<double>>(size);
+}
+
+// Element `i` of an argument that is either a series or a scalar repeated for every element.
+struct Broadcast
+{
+    const double *data;
+    size_t stride;
+    double operator[](size_t i) const { return data[i * stride]; }
+};
+
+// `value` must hold a scalar or a series.
+inline Broadcast broadcast_series(const TrialValue &value)
+{
+    if (const auto *series = std::get_if<std::vector<double>>(&value))
+        return {series->data(), 1};
+    return {&std::get<double>(value), 0};
+}
@@ -5,10 +5,15 @@
 
 using TrialContext = std::vector<TrialValue>;
 
+class BytecodeBuilder;
+
 class IExecutionStep
 {
 public:
     virtual ~IExecutionStep() = default;
 
     virtual void execute(TrialContext &context) const = 0;
+
+    // Emits the step as flat bytecode. Returning false keeps the step on the tree path.
+    virtual bool lower(BytecodeBuilder &) const { return false; }
 };
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+enum class LogLevel
+{
+    Info,
+    Warning
+};
+
+// Receives the messages the engine reports while it builds and runs, one line each without a
+// line ending. Engines call it from the thread that built or runs them.
+using LogCallback = std::function<void(LogLevel level, const std::string &message)>;
+
+// What vse does with them: messages go to std::cout and warnings to std::cerr.
+void log_to_console(LogLevel level, const std::string &message);
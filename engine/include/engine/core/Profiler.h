@@ -0,0 +1,84 @@
+#pragma once
+
+#include "include/engine/core/Bytecode.h"
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+// Heap allocations made so far by the calling thread. They are counted by the global operator
+// new of src/allocation_counter.cpp, which only the vse executable links: a library or module
+// embedding engine_core keeps its own allocator, and its counts stay zero.
+uint64_t thread_allocation_count();
+// Whether the process links the counting operator new.
+bool counts_allocations();
+// Called by the counting operator new.
+void record_allocation() noexcept;
+void enable_allocation_counting() noexcept;
+
+// Cost of one top-level step, summed over trials.
+struct StepTiming
+{
+    uint64_t nanoseconds = 0;
+    uint64_t allocations = 0;
+    uint64_t runs = 0; // Trials in the scalar interpreter, blocks of lanes in batched mode.
+};
+
+// One chunk of trials run by a worker of the thread pool.
+struct ChunkSpan
+{
+    size_t worker = 0;
+    size_t first_trial = 0;
+    size_t trials = 0;
+    std::chrono::steady_clock::time_point begin;
+    std::chrono::steady_clock::time_point end;
+};
+
+// Where the time of a run goes, per top-level per-trial step. Every instruction belongs to the
+// step of its outermost debug site; the interpreters call enter() before each instruction they
+// run, and the profile charges the time and allocations since the previous change of step to
+// the step that was running. Each worker fills its own profile, merged once the run is over.
+class StepProfile
+{
+public:
+    StepProfile() = default;
+    // `sites` must outlive the profile.
+    explicit StepProfile(const std::vector<DebugSite> &sites);
+
+    void enter(uint32_t site)
+    {
+        const uint32_t step = m_step_of_site[site];
+        if (step != m_current)
+            switch_to(step);
+    }
+    // Charges the running step; called when the interpreter leaves the program.
+    void stop() { switch_to(NO_STEP); }
+
+    void record_chunk(const ChunkSpan &chunk) { m_chunks.push_back(chunk); }
+    // Adds another worker's profile of the same program.
+    void merge(const StepProfile &other);
+
+    // Indexed by the debug site that opens each step; other entries stay zero.
+    const std::vector<StepTiming> &timings() const { return m_timings; }
+    const std::vector<ChunkSpan> &chunks() const { return m_chunks; }
+    uint64_t total_nanoseconds() const;
+
+    // A table of the steps that ran, most expensive first.
+    void print_report(std::ostream &out) const;
+    // The chunks as complete ("X") events of the Chrome trace event format, one thread per
+    // worker, for chrome://tracing or https://ui.perfetto.dev.
+    void write_chrome_trace(std::ostream &out) const;
+
+private:
+    static constexpr uint32_t NO_STEP = UINT32_MAX;
+
+    void switch_to(uint32_t step);
+
+    const std::vector<DebugSite> *m_sites = nullptr;
+    std::vector<uint32_t> m_step_of_site;
+    std::vector<StepTiming> m_timings;
+    std::vector<ChunkSpan> m_chunks;
+    uint32_t m_current = NO_STEP;
+    std::chrono::steady_clock::time_point m_since;
+    uint64_t m_allocations_since = 0;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "include/engine/core/DeviceMath.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+// Philox4x32-10: the output block of (counter, key); see philox4x32_block().
+inline std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key)
+{
+    philox4x32_block(counter.data(), key[0], key[1]);
+    return counter;
+}
+
+// The random numbers of one sampler call. Draws are keyed by (seed, trial index, call site),
+// so a trial produces the same values whichever thread runs it and can be recomputed alone.
+// Satisfies UniformRandomBitGenerator.
+class RandomStream
+{
+public:
+    using result_type = uint32_t;
+
+    RandomStream() : RandomStream(0, 0, 0) {}
+    RandomStream(uint64_t seed, uint64_t trial, uint32_t site)
+        : m_key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+          m_counter{0, site, static_cast<uint32_t>(trial), static_cast<uint32_t>(trial >> 32)} {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()()
+    {
+        if (m_index == m_block.size())
+        {
+            m_block = philox4x32(m_counter, m_key);
+            ++m_counter[0];
+            m_index = 0;
+        }
+        return m_block[m_index++];
+    }
+
+    // Uniform double in [0, 1) with 53 random bits.
+    double uniform()
+    {
+        const uint32_t high = (*this)();
+        const uint32_t low = (*this)();
+        return uniform_from_bits(high, low);
+    }
+
+private:
+    std::array<uint32_t, 2> m_key;
+    std::array<uint32_t, 4> m_counter;
+    std::array<uint32_t, 4> m_block{};
+    size_t m_index = 4;
+};
+
+// Uniforms that replace the random streams of runs sampling by inverse transform
+// (simulation_config "sampling"): one value in (0, 1) per sampler call site and trial.
+class UniformDesign
+{
+public:
+    virtual ~UniformDesign() = default;
+    virtual double uniform(uint64_t trial, uint32_t site) const = 0;
+    // Whether `site` draws from the design; the others keep drawing from their streams.
+    virtual bool covers(uint32_t /*site*/) const { return true; }
+    // Whether trial 2k + 1 mirrors the draws of trial 2k (antithetic variates). Samplers that
+    // draw from their streams mirror those instead.
+    virtual bool mirrors_pairs() const { return false; }
+};
+
+// The trials the current thread is evaluating, set by the engine around every trial (or block
+// of trial lanes). Outside of a run each call gets a fresh, unkeyed stream.
+struct TrialRandomState
+{
+    uint64_t seed = 0;
+    uint64_t first_trial = 0;
+    const uint32_t *lane_offsets = nullptr; // Offset from first_trial per lane; null when lanes are contiguous.
+    const UniformDesign *design = nullptr;  // Set when samplers draw from a design rather than their streams.
+    bool active = false;
+};
+
+// Trial index used for draws made by pre-trial steps.
+constexpr uint64_t PRE_TRIAL_INDEX = std::numeric_limits<uint64_t>::max();
+
+inline TrialRandomState &thread_random_state()
+{
+    static thread_local TrialRandomState state;
+    return state;
+}
+
+// Trial index of a lane of the active state.
+inline uint64_t lane_trial(const TrialRandomState &state, size_t lane)
+{
+    return state.first_trial + (state.lane_offsets ? state.lane_offsets[lane] : lane);
+}
+
+// The design samplers draw from on this thread, or null when they use their random streams.
+inline const UniformDesign *active_uniform_design()
+{
+    const TrialRandomState &state = thread_random_state();
+    return state.active ? state.design : nullptr;
+}
+
+inline RandomStream random_stream(uint32_t site, size_t lane = 0)
+{
+    const TrialRandomState &state = thread_random_state();
+    if (state.active)
+    {
+        return RandomStream(state.seed, lane_trial(state, lane), site);
+    }
+    static thread_local const uint64_t unkeyed_seed = (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+    static thread_local uint64_t unkeyed_calls = 0;
+    return RandomStream(unkeyed_seed, unkeyed_calls++, site);
+}
+
+// Installs a TrialRandomState for the current thread and restores the previous one on exit.
+class TrialRandomScope
+{
+public:
+    explicit TrialRandomScope(const TrialRandomState &state) : m_saved(thread_random_state()) { thread_random_state() = state; }
+    ~TrialRandomScope() { thread_random_state() = m_saved; }
+
+    TrialRandomScope(const TrialRandomScope &) = delete;
+    TrialRandomScope &operator=(const TrialRandomScope &) = delete;
+
+private:
+    TrialRandomState m_saved;
+};
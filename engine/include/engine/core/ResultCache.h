@@ -0,0 +1,146 @@
+#pragma once
+
+#include "include/engine/core/DataStructures.h"
+#include "include/engine/core/IExecutable.h"
+#include "include/engine/core/IExecutionStep.h"
+#include "include/engine/core/Log.h"
+#include "include/engine/io/ResultSink.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 128-bit content hash (two FNV-1a lanes finished with a bit mixer) naming cache entries.
+class ContentHasher
+{
+public:
+    ContentHasher &add(std::string_view bytes);
+    ContentHasher &add(uint64_t value);
+    ContentHasher &add(const TrialValue &value);
+    std::string hex() const; // 32 hex digits.
+
+private:
+    uint64_t m_low = 0xCBF29CE484222325ull;
+    uint64_t m_high = 0x84222325CBF29CE4ull;
+};
+
+// The per-trial results of one slot, as stored in the cache.
+struct CachedColumn
+{
+    enum class Kind : uint32_t
+    {
+        Scalar,
+        Vector,
+        Bool
+    };
+
+    Kind kind = Kind::Scalar;
+    size_t trials = 0;
+    std::vector<double> values;    // One per trial, or every element of every vector in trial order.
+    std::vector<uint64_t> offsets; // Vectors only: trial t is values[offsets[t], offsets[t + 1]).
+
+    TrialValue value(size_t trial) const;
+};
+
+// simulation_config "cache_dir": results of per-trial steps kept on disk between runs, one file
+// per slot a step assigns, named after the step's content hash. A step's hash covers its JSON
+// (without line numbers), its sampler call sites, the seed and sampling mode, and the hashes of
+// whatever it reads: the steps assigning those slots, or the pre-trial values. An unchanged hash
+// therefore means unchanged results for every trial, and a rerun loads them instead of
+// recomputing. Entries are never evicted; delete the directory to clear the cache.
+//
+// Column file, in native byte order since the cache stays on one machine: a 32-byte header
+// (magic "VSECOL01", trials u64, kind u32, reserved u32, number of values u64), the values as
+// float64, and for vectors the trials + 1 offsets as u64.
+class ResultCache
+{
+public:
+    explicit ResultCache(std::string directory);
+
+    const std::string &directory() const { return m_directory; }
+    std::string column_path(const std::string &key, size_t column) const;
+
+    // True when every one of the `columns` columns of `key` holds at least `trials` trials.
+    bool contains(const std::string &key, size_t columns, size_t trials) const;
+    // The column, or null when it is missing or damaged.
+    std::shared_ptr<const CachedColumn> load(const std::string &key, size_t column) const;
+
+private:
+    std::string m_directory;
+};
+
+// Writes the results of freshly computed steps into the cache. Receives the run's result
+// columns from `first_column` on, one per (key, column) entry, in trial order. Files are written
+// under temporary names and renamed once complete; a column whose values are neither scalars,
+// booleans nor vectors, or change kind between trials, is dropped.
+class ResultCacheWriter : public ResultSink
+{
+public:
+    struct Entry
+    {
+        std::string key;
+        size_t column;
+    };
+
+    ResultCacheWriter(const ResultCache &cache, std::vector<Entry> entries, size_t first_column, LogCallback log = log_to_console);
+    ~ResultCacheWriter() override;
+
+    void begin(size_t num_trials) override;
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override;
+    void consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count) override;
+    bool ordered() const override { return true; }
+    void finish() override;
+
+private:
+    struct File
+    {
+        std::string path;
+        std::string temporary_path;
+        std::ofstream stream;
+        bool started = false;
+        bool failed = false;
+        CachedColumn::Kind kind = CachedColumn::Kind::Scalar;
+        uint64_t num_values = 0;
+        std::vector<uint64_t> offsets;
+    };
+
+    void append(File &file, const TrialValue &value);
+    void discard(File &file);
+
+    std::vector<File> m_files;
+    size_t m_first_column;
+    LogCallback m_log;
+    size_t m_trials = 0;
+};
+
+// Stands in for a per-trial step whose results come from the cache: assigns `slot` the value
+// of the current trial, taken from the thread's random state like the samplers' draws.
+class CachedColumnStep : public IExecutionStep
+{
+public:
+    CachedColumnStep(size_t slot, std::shared_ptr<const CachedColumn> column);
+
+    void execute(TrialContext &context) const override;
+    bool lower(BytecodeBuilder &builder) const override;
+
+private:
+    // Lowered as a call without arguments; scalar columns also run in batched lanes.
+    class Lookup : public IExecutable
+    {
+    public:
+        explicit Lookup(std::shared_ptr<const CachedColumn> column) : m_column(std::move(column)) {}
+
+        std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+        size_t execute_into(ArgumentSpan args, ResultSpan results) const override;
+        bool supports_lanes(size_t num_args) const override;
+        void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+
+    private:
+        std::shared_ptr<const CachedColumn> m_column;
+    };
+
+    size_t m_slot;
+    Lookup m_lookup;
+};
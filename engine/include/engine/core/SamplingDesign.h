@@ -0,0 +1,124 @@
+#pragma once
+
+#include "include/engine/core/Random.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// simulation_config "sampling" and "variance_reduction": how samplers turn trials into draws.
+// Every mode but Pseudo samples by inverse transform from a UniformDesign.
+enum class SamplingMode
+{
+    Pseudo,         // Each call site's Philox stream (the default).
+    Sobol,          // One dimension of a scrambled Sobol sequence per call site.
+    LatinHypercube, // Each call site's uniforms stratified across the trial budget.
+    Antithetic      // Trials in pairs, the second drawing 1 - u wherever the first drew u.
+};
+
+// `sampling` is "pseudo" or "sobol"; `variance_reduction` is "lhs" or "antithetic" and applies
+// to pseudo-random sampling only. Empty strings take the defaults.
+SamplingMode parse_sampling_mode(const std::string &sampling, const std::string &variance_reduction = std::string());
+
+// Sobol sequence (Bratley & Fox) with Owen scrambling, in 32-bit precision. Dimension d is
+// call site d and the sequence index is the trial index, so every trial's point is computed
+// on its own, whichever thread runs it. The first 2^m trials of every dimension are then
+// stratified: each interval [k / 2^m, (k + 1) / 2^m) holds exactly one of them.
+//
+// Dimension 0 is the van der Corput sequence. The others use primitive polynomials over GF(2)
+// in order of degree, found by search. Dimensions 1 to 20 take their initial direction numbers
+// from Joe & Kuo's new-joe-kuo-6.21201 table; later ones use odd numbers derived from splitmix64
+// of the dimension, fixed across runs. The nested uniform scramble (Burley, "Practical
+// Hash-based Owen Scrambling", 2020) is keyed by the run's seed and the dimension, so different
+// seeds give independent randomised point sets.
+class SobolDesign : public UniformDesign
+{
+public:
+    static constexpr uint32_t BITS = 32;
+
+    SobolDesign(uint32_t dimensions, uint64_t seed);
+
+    uint32_t dimensions() const { return m_dimensions; }
+    // Unscrambled point of `index` in `dimension`, as a 32-bit binary fraction.
+    uint32_t point(uint32_t index, uint32_t dimension) const;
+    double uniform(uint64_t trial, uint32_t site) const override;
+
+private:
+    uint32_t m_dimensions;
+    std::vector<uint32_t> m_directions; // BITS direction numbers per dimension.
+    std::vector<uint32_t> m_scrambles;  // Scramble seed per dimension.
+};
+
+// Latin hypercube sampling (McKay, Beckman & Conover): the trial budget splits [0, 1) into
+// `trials` equal strata, and each call site visits every stratum once, in its own random order,
+// at a random point within it. The order is a keyed Feistel permutation of the trial indices,
+// so no per-site table is stored. Trials past the budget wrap around.
+class LatinHypercubeDesign : public UniformDesign
+{
+public:
+    LatinHypercubeDesign(uint64_t trials, uint64_t seed);
+    double uniform(uint64_t trial, uint32_t site) const override;
+
+private:
+    uint64_t permute(uint64_t index, uint32_t site) const;
+
+    uint64_t m_trials;
+    uint64_t m_seed;
+    unsigned m_half_bits; // Each Feistel half covers this many bits of the index.
+};
+
+// Antithetic variates: trials 2k and 2k + 1 share the draws of pair k, mirrored in the second.
+class AntitheticDesign : public UniformDesign
+{
+public:
+    explicit AntitheticDesign(uint64_t seed) : m_seed(seed) {}
+    double uniform(uint64_t trial, uint32_t site) const override;
+    bool mirrors_pairs() const override { return true; }
+
+private:
+    uint64_t m_seed;
+};
+
+// simulation_config "rank_correlations": Spearman rank correlations between the draws of
+// sampler call sites, imposed through normal scores as in Iman & Conover's method, trial by
+// trial. The uniforms the correlated sites would draw are turned into normal scores, mixed
+// by the Cholesky factor of the matching Pearson correlations 2 sin(pi r / 6), and mapped back
+// to uniforms; samplers then draw by inverse transform as under any design, so every marginal
+// is unchanged. Other sites draw what `base` gives them or, without one, from their streams.
+class RankCorrelatedDesign : public UniformDesign
+{
+public:
+    struct Group
+    {
+        std::vector<uint32_t> sites;
+        std::vector<double> correlation; // Rank correlations, sites.size() squared, row-major.
+    };
+
+    // Throws EngineException when a matrix is not a valid correlation matrix.
+    RankCorrelatedDesign(std::unique_ptr<UniformDesign> base, uint64_t seed, uint32_t sites, const std::vector<Group> &groups);
+    double uniform(uint64_t trial, uint32_t site) const override;
+    bool covers(uint32_t site) const override { return m_base || (site < m_group_of.size() && m_group_of[site] != UNCORRELATED); }
+    bool mirrors_pairs() const override { return m_base && m_base->mirrors_pairs(); }
+
+private:
+    static constexpr uint32_t UNCORRELATED = UINT32_MAX;
+
+    double base_uniform(uint64_t trial, uint32_t site) const;
+
+    std::unique_ptr<UniformDesign> m_base;
+    uint64_t m_seed;
+    std::vector<uint32_t> m_group_of; // Per site: its group, or UNCORRELATED.
+    std::vector<uint32_t> m_row_of;   // Per site: its row in the group's factor.
+    std::vector<std::vector<uint32_t>> m_sites;
+    std::vector<std::vector<double>> m_factors; // Lower Cholesky factors, row-major.
+};
+
+// The design of `mode` for a run of `trials` trials and `sites` sampler call sites, or null for Pseudo.
+std::unique_ptr<UniformDesign> make_uniform_design(SamplingMode mode, uint32_t sites, uint64_t trials, uint64_t seed);
+
+// Inverse of the standard normal distribution function, for p in (0, 1).
+double inverse_normal_cdf(double p);
+
+// Writes the lower Cholesky factor of the symmetric n x n row-major `matrix` to `lower` (same
+// layout, zeros above the diagonal). Returns false when the matrix is not positive definite.
+bool cholesky_factor(const double *matrix, size_t n, double *lower);
@@ -3,30 +3,311 @@
 #include "include/engine/core/DataStructures.h"
 #include "include/engine/core/IExecutionStep.h"
 #include "include/engine/core/IExecutable.h"
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/ExecutionSteps.h"
+#include "include/engine/core/BatchedProgram.h"
+#include "include/engine/core/ThreadPool.h"
+#include "include/engine/core/SamplingDesign.h"
+#include "include/engine/core/ResultCache.h"
+#include "include/engine/core/Log.h"
+#include "include/engine/core/Profiler.h"
 #include "include/engine/functions/FunctionRegistry.h"
+#include "include/engine/io/ResultSink.h"
+#include <nlohmann/json_fwd.hpp>
+#include <cmath>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <memory>
 #include <functional>
 
+// Trial budget of SimulationEngine::preview().
+struct PreviewOptions
+{
+    size_t max_trials = 2000; // Capped by the recipe's num_trials.
+    size_t min_trials = 100;
+    // Stop once the 95% confidence interval of the mean is narrower than this fraction of |mean|.
+    double relative_ci_width = 0.01;
+};
+
+struct PreviewResult
+{
+    std::optional<TrialValue> value; // Empty when the recipe runs no trials.
+    size_t trials = 0;               // 0 when the output cannot vary between trials.
+    bool converged = false;          // False when the budget ran out first.
+    // Of the trials run for scalar outputs that vary between them; `value` is its mean.
+    std::optional<OutputStatistics> distribution;
+};
+
+// simulation_config "target_precision": run(sinks) adds rounds of trials until the first output
+// is estimated precisely enough or "max_trials" (by default 100 x num_trials) is reached;
+// "num_trials" is the size of the first round. A number is a standard_error target; an object
+// sets any of the fields below, which must then all hold. Vector outputs must meet them in
+// every period. Standard errors assume independent trials, so they overstate the error of
+// sobol and antithetic runs.
+struct PrecisionTarget
+{
+    double standard_error = 0.0;    // Of the mean; 0 when unused.
+    double relative_error = 0.0;    // Standard error of the mean over |mean|.
+    double quantile = 0.5;          // Quantile whose 95% confidence interval quantile_ci_width bounds.
+    double quantile_ci_width = 0.0; // "ci_width" in the recipe.
+    size_t max_trials = 0;
+
+    bool enabled() const { return standard_error > 0.0 || relative_error > 0.0 || quantile_ci_width > 0.0; }
+};
+
+// What run(sinks) did. The precision fields are the worst over periods of the first output,
+// measured after the last round; they stay 0 for runs without a precision target.
+struct RunReport
+{
+    size_t trials = 0;
+    size_t rounds = 0;
+    bool converged = false; // The precision target was met within max_trials.
+    double standard_error = 0.0;
+    double relative_error = 0.0;
+    double quantile_ci_width = 0.0;
+};
+
+// Trials [first, first + count) of a run.
+struct TrialRange
+{
+    size_t first = 0;
+    size_t count = 0;
+};
+
+// What the const run() may change per run without rebuilding the engine; unset fields keep the
+// recipe's. Pre-trial steps ran once when the engine was built, so their draws always come from
+// the recipe's seed.
+struct RunOptions
+{
+    std::optional<uint64_t> seed;
+    std::optional<size_t> num_trials; // The first round's, with a precision target.
+    // Names from get_output_names(), in the order the sinks receive them; empty for every output.
+    std::vector<std::string> outputs;
+    std::optional<SchedulerConfig> scheduler;
+    // Runs only these trials of the num_trials, e.g. one shard of a run spread over machines
+    // (see Shard.h). Trials keep their index in the whole run, and with it their draws, while the
+    // sinks number them from 0. Runs with a precision target cannot be split.
+    std::optional<TrialRange> range;
+};
+
+// simulation_config "sensitivity": the inputs of run_sensitivity(), each a slot ("slot", or
+// "variable" by name) with the "low" and "high" values it is held at in turn.
+struct SensitivityInput
+{
+    size_t slot = 0;
+    double low = 0.0;
+    double high = 0.0;
+};
+
+// One bar of a tornado chart: the first output with one input held at either end of its range.
+struct SensitivityBar
+{
+    SensitivityInput input;
+    std::string name;
+    OutputStatistics at_low;
+    OutputStatistics at_high;
+
+    double swing() const { return std::abs(at_high.moments.mean - at_low.moments.mean); }
+};
+
+struct SensitivityReport
+{
+    size_t trials = 0;
+    OutputStatistics base;            // The recipe as written.
+    std::vector<SensitivityBar> bars; // Widest swing first.
+};
+
 class SimulationEngine
 {
 public:
-    explicit SimulationEngine(const std::string &json_recipe_path, bool is_preview = false);
+    // Messages go to `log`, or to the console when it is empty; previews build quietly.
+    explicit SimulationEngine(const std::string &json_recipe_path, bool is_preview = false, LogCallback log = LogCallback());
+    // Builds from the contents of a recipe rather than from a file, as `vse --serve` receives them.
+    static std::unique_ptr<SimulationEngine> from_recipe_text(std::string_view recipe, bool is_preview = false, LogCallback log = LogCallback());
+    // Builds from a recipe document already in memory, as the Python bindings receive it.
+    static std::unique_ptr<SimulationEngine> from_recipe(const nlohmann::json &recipe, bool is_preview = false, LogCallback log = LogCallback());
+    // The contents of a recipe file; throws RecipeFileNotFound when it cannot be opened.
+    static std::string read_recipe_file(const std::string &path);
+
+    // Recipes come as JSON or, from `vsc --binary`, as CBOR (RFC 8949) of the same document,
+    // recognised by its self-describe tag. Both are decoded into the same document and built
+    // alike; CBOR recipes only save parsing number text, by storing vector literals as byte
+    // strings of packed little-endian doubles (see ArgumentPlanner::vector_literal_values()).
+    static constexpr unsigned char BINARY_RECIPE_MAGIC[] = {0xD9, 0xD9, 0xF7};
+    static bool is_binary_recipe(std::string_view recipe);
+
+    // Results of the first output.
     std::vector<TrialValue> run();
+    // Results of every output, in the order of get_output_variable_indices().
+    std::vector<std::vector<TrialValue>> run_outputs();
+    // Streams the results into `sinks` instead of materialising them; see ResultSink.
+    RunReport run(const std::vector<ResultSink *> &sinks);
+    // The same with per-run settings, leaving the engine untouched, so that any number of threads
+    // may run it at once; see CompiledPlan. These runs are never profiled, and they read the
+    // result cache but do not add to it. Engines that load cached results only run them with the
+    // recipe's seed and trial count, which the cached columns were computed for.
+    RunReport run(const RunOptions &options, const std::vector<ResultSink *> &sinks) const;
+    // One-at-a-time sensitivity of the first output, which must be scalar, to every
+    // "sensitivity" input. Every trial runs once as written and then once per input and end of
+    // its range, recomputing only the steps downstream of that input from the trial's own
+    // results, so all variants share the trial's random numbers.
+    SensitivityReport run_sensitivity();
+    bool has_sensitivity_inputs() const { return !m_sensitivity.empty(); }
+    // A quick estimate of the first output on the calling thread, without the thread pool: the
+    // mean of scalar results, sampled until the confidence interval is narrow enough, and the
+    // first trial's value otherwise. Outputs that cannot vary between trials are computed once
+    // from the pre-trial values without running any trials.
+    PreviewResult preview(const PreviewOptions &options = PreviewOptions()) const;
     std::string get_output_file_path() const;
 
+    // "output_variable_indices", or the single "output_variable_index", and their names in the
+    // variable registry. Every trial produces one value per output, all from the same draws.
+    const std::vector<size_t> &get_output_variable_indices() const { return m_output_variable_indices; }
+    const std::vector<std::string> &get_output_names() const { return m_output_names; }
+    // simulation_config "output_format" ("csv", "binary" or "summary"), else inferred from the file extension.
+    OutputFormat get_output_format() const { return m_output_format; }
+    // simulation_config "summary_bins": the resolution of summary output files; see ResultSink.h.
+    size_t get_summary_bins() const { return m_summary_bins; }
+
+    // Scheduling comes from simulation_config; callers such as the CLI may override it.
+    const SchedulerConfig &get_scheduler_config() const { return m_scheduler_config; }
+    void set_scheduler_config(const SchedulerConfig &config) { m_scheduler_config = config; }
+
+    // simulation_config "device": "cpu" (the default), "host" or "cuda"; see DeviceProgram.h.
+    // Batched programs then run their supported steps there, in blocks of 16384 trials unless
+    // the recipe sets "lane_width". Throws EngineException for devices this build cannot use.
+    void set_device(const std::string &name);
+    const DeviceBackend *get_device() const { return m_device.get(); }
+    // Batched instructions that run on the device: 0 without one, or when nothing is batched.
+    size_t get_device_instruction_count() const { return m_batched_program ? m_batched_program->device_instructions() : 0; }
+    // Branches of conditionals the batched program runs on every lane and blends in; see BatchedProgram.h.
+    size_t get_predicated_branch_count() const { return m_batched_program ? m_batched_program->predicated_branches() : 0; }
+
+    // Per-trial instructions bound to typed operands at plan time, from the recipe's
+    // "variable_types"; 0 when the recipe declares none.
+    size_t get_typed_instruction_count() const { return m_per_trial_program.typed_instruction_count(); }
+
+    // Seed of the random streams: simulation_config "seed", or drawn at construction when absent.
+    uint64_t get_seed() const { return m_seed; }
+    // Whether the seed came from the recipe, so that other processes reproduce its draws.
+    bool has_fixed_seed() const { return m_fixed_seed; }
+    // simulation_config "num_trials".
+    size_t get_num_trials() const { return m_num_trials > 0 ? static_cast<size_t>(m_num_trials) : 0; }
+    // simulation_config "sampling" ("pseudo", the default, or "sobol") and "variance_reduction"
+    // ("lhs" or "antithetic").
+    SamplingMode get_sampling_mode() const { return m_sampling_mode; }
+
+    const PrecisionTarget &get_precision_target() const { return m_precision_target; }
+    void set_precision_target(const PrecisionTarget &target) { m_precision_target = target; }
+
+    // simulation_config "cache_dir": per-trial steps whose results are cached there are loaded
+    // rather than run; see ResultCache. Caching needs a "seed", and is off in previews, with a
+    // precision target and with sensitivity inputs, whose trial counts or slot values differ
+    // from the recipe's.
+    bool uses_result_cache() const { return m_result_cache != nullptr; }
+    size_t get_cached_step_count() const { return m_cached_step_count; }
+
+    // Off by default. While on, run() times every top-level per-trial step and the chunks of
+    // every worker; get_profile() then holds what the last run measured, and is null otherwise.
+    // Previews and sensitivity runs are not profiled.
+    void set_profiling(bool enabled) { m_profiling = enabled; }
+    const StepProfile *get_profile() const { return m_profiling ? &m_profile : nullptr; }
+
 private:
+    struct RecipeText
+    {
+        std::string_view data;
+    };
+    SimulationEngine(const RecipeText &recipe, bool is_preview, LogCallback log);
+    SimulationEngine(const nlohmann::json &recipe, bool is_preview, LogCallback log);
+
     void build_function_registry();
-    void parse_and_build(const std::string &path);
+    static nlohmann::json parse_recipe(std::string_view recipe);
+    void parse_and_build(const nlohmann::json &recipe_json);
+    void log(const std::string &message) const;
+    // The design samplers draw from in a run of `num_trials` trials, or null when they use their streams.
+    std::unique_ptr<UniformDesign> make_design(uint64_t num_trials, uint64_t seed) const;
+    // Warns when the sampling mode asks for a design that some samplers cannot draw from.
+    void warn_about_uncovered_samplers() const;
     void run_pre_trial_phase();
-    void run_batch(int num_trials, std::vector<TrialValue> &results, std::exception_ptr &out_exception);
+    void prepare_result_cache();
+    void lower_per_trial_steps();
+    void build_batched_program();
+    struct TrialWorker;
+    struct RunState;
+    using ChunkCallback = std::function<void(size_t worker, size_t begin, size_t end)>;
+    void run_trials(TrialWorker &worker, size_t first_trial, size_t num_trials, TrialValue *results, size_t column_stride) const;
+    RunState prepare_run(size_t num_trials, uint64_t seed, const SchedulerConfig &scheduler, bool profiling) const;
+    size_t chunk_size_for(size_t num_trials, const RunState &state) const;
+    bool measure_precision(const StatisticsSink &statistics, RunReport &report) const;
+    std::unique_ptr<ResultCacheWriter> make_cache_writer() const;
+    void run_window(RunState &state, size_t first_trial, size_t num_trials, TrialValue *results, size_t column_stride, const ChunkCallback &on_chunk, const ChunkCallback &on_failure = ChunkCallback()) const;
+    void collect_profile(const RunState &state);
+    // Both run(sinks) overloads: `columns` picks the outputs the sinks receive, by position in
+    // m_output_variable_indices; the cache writer, when given, also receives the cached columns.
+    RunReport stream(RunState &state, size_t num_trials, const std::vector<size_t> &columns, const std::vector<ResultSink *> &sinks, ResultCacheWriter *cache_writer) const;
+
+    // What changes when a sensitivity input is overridden. Pre-trial steps are rerun once per
+    // variant; per-trial steps every trial, on top of the trial's results as written.
+    struct SensitivityPlan
+    {
+        SensitivityInput input;
+        std::string name;
+        std::vector<const IExecutionStep *> pre_trial_steps;
+        std::vector<size_t> changed_slots; // The input, then the results of pre_trial_steps.
+        std::vector<const IExecutionStep *> per_trial_steps;
+        std::vector<size_t> touched_slots; // Every slot a variant writes, restored after it.
+        BytecodeProgram program;           // per_trial_steps, lowered with the per-trial program.
+    };
+
+    // What identifies a per-trial step in the result cache, gathered while parsing it.
+    struct CacheKeySource
+    {
+        std::string content;       // Step JSON without line numbers; reads and results replaced by their order.
+        std::vector<size_t> reads; // Slots read, in placeholder order.
+        std::vector<size_t> writes;
+        uint32_t first_call_site = 0; // Sampler call sites of the step: [first, end).
+        uint32_t end_call_site = 0;
+        bool literal = false;
+        bool live = false;
+        std::optional<size_t> deferred_into; // The conditional step it runs inside of.
+    };
 
     int m_num_trials;
-    size_t m_output_variable_index;
+    std::vector<size_t> m_output_variable_indices;
+    std::vector<std::string> m_output_names;
     std::string m_output_file_path;
+    OutputFormat m_output_format = OutputFormat::Csv;
+    size_t m_summary_bins = DEFAULT_SUMMARY_BINS;
     bool m_is_preview;
+    LogCallback m_log;
+    bool m_first_output_varies = true; // Some live step of the first output calls an impure function.
+    size_t m_lane_width;
+    bool m_lane_width_configured = false;
+    std::unique_ptr<DeviceBackend> m_device; // Null on the CPU.
+    SchedulerConfig m_scheduler_config;
+    uint64_t m_seed;
+    bool m_fixed_seed = false;
+    uint32_t m_next_call_site = 0;
+    SamplingMode m_sampling_mode = SamplingMode::Pseudo;
+    std::unique_ptr<UniformDesign> m_uniform_design; // Null for pseudo-random sampling without rank correlations.
+    std::vector<bool> m_site_uses_design; // Per call site: Sampler::uses_design().
+    std::vector<std::string> m_stream_samplers;     // Functions whose draws no design covers.
+    std::vector<std::string> m_unmirrored_samplers; // Of those, the ones not mirroring antithetic pairs.
+    std::vector<RankCorrelatedDesign::Group> m_rank_correlations;
+    std::string m_rank_correlation_key; // The recipe's "rank_correlations", for result cache keys.
+    PrecisionTarget m_precision_target;
+    std::vector<SensitivityPlan> m_sensitivity;
+    std::unique_ptr<ResultCache> m_result_cache;
+    std::vector<CacheKeySource> m_cache_keys;              // One per per-trial step when caching.
+    std::vector<std::unique_ptr<IExecutionStep>> m_cached_steps; // Loaded in place of cache hits.
+    std::vector<ResultCacheWriter::Entry> m_cache_entries; // Result columns past the outputs, to be cached.
+    size_t m_cached_step_count = 0;
+    std::vector<size_t> m_result_slots; // The outputs, then the slots of m_cache_entries.
 
     std::unique_ptr<FunctionRegistry> m_function_registry;
     const std::unordered_map<std::string, FunctionRegistry::FactoryFunc> *m_executable_factory;
@@ -34,4 +315,11 @@ private:
     std::vector<TrialValue> m_preloaded_context_vector;
     std::vector<std::unique_ptr<IExecutionStep>> m_pre_trial_steps;
     std::vector<std::unique_ptr<IExecutionStep>> m_per_trial_steps;
+    std::vector<const IExecutionStep *> m_scheduled_steps; // Live per-trial steps outside of any branch, in order.
+    std::unique_ptr<InvariantHoister> m_invariant_hoister;
+    std::vector<ValueType> m_slot_types; // "variable_types"; empty when absent.
+    BytecodeProgram m_per_trial_program;
+    std::unique_ptr<BatchedProgram> m_batched_program; // Null when the program needs the scalar interpreter.
+    bool m_profiling = false;
+    StepProfile m_profile;
 };
\ No newline at end of file
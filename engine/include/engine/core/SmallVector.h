@@ -0,0 +1,99 @@
+#pragma once
+#include "Span.h"
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Growable array that keeps its first N elements inline and moves to the heap only past them,
+// for the short buffers of a single call, such as the arguments of a function. It stays where
+// it was built: it can be neither copied nor moved.
+template <typename T, size_t N>
+class SmallVector
+{
+    static_assert(N > 0);
+
+public:
+    SmallVector() = default;
+    SmallVector(const SmallVector &) = delete;
+    SmallVector &operator=(const SmallVector &) = delete;
+    ~SmallVector()
+    {
+        clear();
+        if (m_data != inline_data())
+            ::operator delete(m_data);
+    }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+    // Whether the elements still live in the inline storage.
+    bool is_inline() const { return m_data == inline_data(); }
+
+    T *data() { return m_data; }
+    const T *data() const { return m_data; }
+    T &operator[](size_t index) { return m_data[index]; }
+    const T &operator[](size_t index) const { return m_data[index]; }
+    T *begin() { return m_data; }
+    T *end() { return m_data + m_size; }
+    const T *begin() const { return m_data; }
+    const T *end() const { return m_data + m_size; }
+    T &back() { return m_data[m_size - 1]; }
+    Span<T> span() { return Span<T>(m_data, m_size); }
+
+    template <typename... Args>
+    T &emplace_back(Args &&...args)
+    {
+        if (m_size == m_capacity)
+            grow(2 * m_capacity);
+        T *element = ::new (static_cast<void *>(m_data + m_size)) T(std::forward<Args>(args)...);
+        ++m_size;
+        return *element;
+    }
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity > m_capacity)
+            grow(capacity);
+    }
+
+    // New elements are value-initialised.
+    void resize(size_t size)
+    {
+        reserve(size);
+        while (m_size > size)
+            m_data[--m_size].~T();
+        while (m_size < size)
+            emplace_back();
+    }
+
+    void clear()
+    {
+        while (m_size > 0)
+            m_data[--m_size].~T();
+    }
+
+private:
+    T *inline_data() { return reinterpret_cast<T *>(m_inline); }
+    const T *inline_data() const { return reinterpret_cast<const T *>(m_inline); }
+
+    void grow(size_t capacity)
+    {
+        T *data = static_cast<T *>(::operator new(capacity * sizeof(T)));
+        for (size_t i = 0; i < m_size; ++i)
+        {
+            ::new (static_cast<void *>(data + i)) T(std::move(m_data[i]));
+            m_data[i].~T();
+        }
+        if (m_data != inline_data())
+            ::operator delete(m_data);
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+    alignas(T) std::byte m_inline[N * sizeof(T)];
+    T *m_data = inline_data();
+    size_t m_size = 0;
+    size_t m_capacity = N;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+
+// Non-owning view over a contiguous array (a minimal stand-in for C++20 std::span).
+template <typename T>
+class Span
+{
+public:
+    constexpr Span() = default;
+    constexpr Span(T *data, size_t size) : m_data(data), m_size(size) {}
+
+    constexpr T *data() const { return m_data; }
+    constexpr size_t size() const { return m_size; }
+    constexpr bool empty() const { return m_size == 0; }
+
+    constexpr T &operator[](size_t index) const { return m_data[index]; }
+    constexpr T *begin() const { return m_data; }
+    constexpr T *end() const { return m_data + m_size; }
+
+private:
+    T *m_data = nullptr;
+    size_t m_size = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Streaming moments of a sample: count, mean, population variance, skewness, excess kurtosis,
+// min and max. Accumulators of disjoint parts of a sample merge exactly (up to rounding), so
+// each thread can summarise its own trials and the parts are combined at the end.
+struct RunningStatistics
+{
+    size_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0; // Sums of powers of deviations from the mean.
+    double m3 = 0.0;
+    double m4 = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+
+    void add(double value);
+    void merge(const RunningStatistics &other);
+
+    double variance() const;
+    double stddev() const;
+    double skewness() const;
+    double kurtosis() const; // Excess kurtosis: 0 for a normal distribution.
+    double standard_error() const; // Of the mean.
+};
+
+// Merging t-digest (Dunning & Ertl) for approximate quantiles in bounded memory. Centroids are
+// kept small near the tails, so extreme percentiles such as P1 and P99 stay accurate.
+class QuantileSketch
+{
+public:
+    struct Centroid
+    {
+        double mean;
+        double weight;
+    };
+
+    explicit QuantileSketch(double compression = 200.0);
+    // A sketch as centroids() and the other accessors below described it, e.g. when read back
+    // from a shard file; merging it continues as if it had never been written out.
+    static QuantileSketch from_centroids(std::vector<Centroid> centroids, double min, double max, double compression);
+
+    void add(double value, double weight = 1.0);
+    void merge(const QuantileSketch &other);
+
+    // Value at quantile q in [0, 1]; 0 for an empty sketch.
+    double quantile(double q) const;
+    // Fraction of the weight at or below `value`: the inverse of quantile(), 0 below min() and
+    // 1 from max() on.
+    double cdf(double value) const;
+    // Width of the distribution-free 95% confidence interval of quantile q: the values at the
+    // ranks q +- 1.96 sqrt(q (1 - q) / n), with n the total weight.
+    double confidence_width(double q) const;
+    double total_weight() const;
+    size_t num_centroids() const;
+    const std::vector<Centroid> &centroids() const; // Sorted by mean.
+    double min() const { return m_min; }
+    double max() const { return m_max; }
+    double compression() const { return m_compression; }
+
+private:
+    void compress() const;
+
+    double m_compression;
+    // Pending points are folded into the centroids lazily, which is why these are mutable.
+    mutable std::vector<Centroid> m_centroids; // Sorted by mean once compressed.
+    mutable std::vector<Centroid> m_buffer;
+    mutable double m_total_weight = 0.0;
+    double m_min = 0.0;
+    double m_max = 0.0;
+};
+
+// Moments plus quantiles of one output (or one period of a vector output).
+struct OutputStatistics
+{
+    RunningStatistics moments;
+    QuantileSketch quantiles;
+
+    void add(double value)
+    {
+        moments.add(value);
+        quantiles.add(value);
+    }
+    void merge(const OutputStatistics &other)
+    {
+        moments.merge(other.moments);
+        quantiles.merge(other.quantiles);
+    }
+};
+
+// The percentiles reported in risk summaries.
+constexpr double REPORTED_PERCENTILES[] = {0.01, 0.05, 0.50, 0.95, 0.99};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Data flow between the per-trial steps of a recipe, read from their JSON. Every per-trial
+// slot starts each trial from its pre-trial value, so dependencies never cross trials.
+class StepGraph
+{
+public:
+    // A step that only feeds one branch of a later conditional step, and so can run inside
+    // that branch instead of on every trial.
+    struct Deferral
+    {
+        size_t conditional; // Index of the conditional_assignment step.
+        bool then_branch;
+    };
+
+    struct Schedule
+    {
+        std::vector<bool> live;                       // Steps the outputs depend on.
+        std::vector<std::optional<Deferral>> deferred; // Live steps moved into a branch.
+    };
+
+    explicit StepGraph(const nlohmann::json &per_trial_steps);
+
+    size_t num_steps() const { return m_nodes.size(); }
+
+    // The steps needed to compute the slots in `outputs`, and which of them can be deferred.
+    Schedule schedule(const std::vector<size_t> &outputs) const;
+
+    // Steps whose results change when the slots in `changed` do: those reading them, directly or
+    // through other such steps, in step order. Their results are appended to `changed`.
+    std::vector<bool> downstream(std::vector<size_t> &changed) const;
+
+    // Slots step `step` assigns.
+    const std::vector<size_t> &writes(size_t step) const { return m_nodes[step].writes; }
+
+    // True when a step marked in `steps` calls a function that `is_pure` rejects, such as a
+    // sampler, so that its results can differ between trials.
+    bool calls_impure(const std::vector<bool> &steps, const std::function<bool(const std::string &)> &is_pure) const;
+
+private:
+    struct Node
+    {
+        std::vector<size_t> writes;
+        std::vector<size_t> reads; // Everything read, branches included.
+        std::vector<std::string> functions; // Every function called, nested calls included.
+        bool conditional = false;
+        // Split reads of a conditional step.
+        std::vector<size_t> condition_reads;
+        std::vector<size_t> then_reads;
+        std::vector<size_t> else_reads;
+    };
+
+    bool can_defer(const Schedule &schedule, size_t step, size_t conditional, bool then_branch, const std::vector<size_t> &outputs) const;
+
+    std::vector<Node> m_nodes;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// How trials are scheduled across threads. Zero means "choose automatically".
+struct SchedulerConfig
+{
+    size_t threads = 0;            // Worker count, including the calling thread.
+    size_t chunk_size = 0;         // Trials handed out per scheduling step.
+    bool pin_threads = false;      // Bind each pool thread to one CPU where the platform allows it.
+    bool replicate_inputs = false; // With pinned threads, copy the pre-trial values to each NUMA node.
+};
+
+// The CPUs of each NUMA node that the process may run on. On Linux they come from
+// /sys/devices/system/node and the process's affinity mask; elsewhere, or when the topology
+// cannot be read, there is a single node with every CPU.
+struct NumaTopology
+{
+    std::vector<std::vector<unsigned>> nodes;
+
+    static const NumaTopology &system();
+    // Parses a kernel CPU list such as "0-3,8,10-11".
+    static std::vector<unsigned> parse_cpu_list(const std::string &list);
+};
+
+// Persistent pool of worker threads that runs index ranges in chunks. Every worker starts
+// with a contiguous share of the chunks, takes its own from the front and, once it runs dry,
+// steals single chunks from the back of the other workers' shares, those on its own NUMA node
+// first.
+//
+// Workers are spread over the nodes in proportion to their CPUs, in contiguous blocks, so each
+// node runs a contiguous part of every parallel_for. Pinned workers are bound to CPUs of their
+// node; memory they allocate and first touch then stays on it.
+class ThreadPool
+{
+public:
+    using ChunkBody = std::function<void(size_t worker, size_t begin, size_t end)>;
+
+    ThreadPool(size_t num_threads, bool pin_threads, const NumaTopology &topology = NumaTopology::system());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of workers, including the thread that calls parallel_for.
+    size_t size() const { return m_queues.size(); }
+    bool pins_threads() const { return m_pin_threads; }
+    size_t num_nodes() const { return m_node_begin.size() - 1; }
+    // The NUMA node of a worker. The calling thread, worker 0, is never pinned.
+    size_t node_of(size_t worker) const { return m_worker_node[worker]; }
+
+    // Runs body(worker, begin, end) over [0, count) in chunks of effective_chunk_size() and
+    // blocks until every chunk has run. The calling thread takes part as worker 0. When chunks
+    // throw, the remaining chunks are skipped and the exception of the lowest failing chunk is
+    // rethrown.
+    //
+    // The workers run one caller's chunks at a time. Other callers do not wait for them: they
+    // run their chunks on their own thread, as worker 0, until the workers are free, and then
+    // hand them the rest. Calls from inside a chunk of this pool run all their chunks that way.
+    void parallel_for(size_t count, size_t chunk_size, const ChunkBody &body);
+
+    // Chunk indices are packed into 32 bits, so a parallel_for has at most MAX_CHUNKS chunks.
+    static constexpr size_t MAX_CHUNKS = UINT32_MAX;
+    // The chunk size parallel_for uses: `chunk_size` (at least 1), multiplied by the smallest
+    // factor that brings `count` within MAX_CHUNKS chunks. Multiples keep chunks aligned to
+    // whatever the caller rounded `chunk_size` to, such as a lane width.
+    static size_t effective_chunk_size(size_t count, size_t chunk_size);
+
+    // Process-wide pool reused across runs; it is only rebuilt when the configuration changes.
+    static std::shared_ptr<ThreadPool> shared(size_t num_threads, bool pin_threads);
+
+private:
+    // Remaining chunks of one worker, packed as (begin << 32 | end) so that the owner and
+    // thieves can claim chunks with a single compare-and-swap.
+    struct ChunkQueue
+    {
+        std::atomic<uint64_t> range{0};
+        char padding[64 - sizeof(std::atomic<uint64_t>)]; // Keeps queues on separate cache lines.
+    };
+
+    struct Job
+    {
+        const ChunkBody *body = nullptr;
+        size_t first = 0; // Chunks cover [first, count).
+        size_t count = 0;
+        size_t chunk_size = 0;
+        std::atomic<bool> failed{false};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        size_t error_chunk = 0;
+    };
+
+    void run_job(size_t first, size_t count, size_t chunk_size, const ChunkBody &body);
+    void worker_main(size_t worker);
+    void work(size_t worker, Job &job);
+    bool pop_front(size_t worker, uint64_t &chunk);
+    bool steal(size_t thief, uint64_t &chunk);
+    bool steal_from(size_t victim, uint64_t &chunk);
+
+    std::vector<ChunkQueue> m_queues;
+    std::vector<std::thread> m_threads;
+    bool m_pin_threads;
+    std::vector<size_t> m_worker_node;
+    std::vector<size_t> m_node_begin; // Workers of node n: [m_node_begin[n], m_node_begin[n + 1]).
+
+    std::mutex m_submit_mutex; // Held by the caller whose job the workers run.
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation = 0;
+    size_t m_pending = 0;
+    bool m_stop = false;
+    Job *m_job = nullptr;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "include/engine/core/Span.h"
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for the temporaries of series functions. Memory is handed out in order from
+// blocks that are kept for reuse, and given back all at once when the Scope that took it ends.
+// Each thread has its own arena (trial_arena()): once its blocks have grown to what a trial
+// needs, trials take nothing from the global heap and threads never contend for it.
+class TrialArena
+{
+public:
+    // Gives back everything allocated from the arena while it was alive, also on exceptions.
+    class Scope
+    {
+    public:
+        explicit Scope(TrialArena &arena) : m_arena(arena), m_block(arena.m_block), m_offset(arena.m_offset) {}
+        ~Scope() { m_arena.rewind(m_block, m_offset); }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        TrialArena &m_arena;
+        size_t m_block;
+        size_t m_offset;
+    };
+
+    TrialArena() = default;
+    TrialArena(const TrialArena &) = delete;
+    TrialArena &operator=(const TrialArena &) = delete;
+
+    // `count` uninitialised values, valid until the innermost enclosing Scope ends.
+    template <typename T>
+    Span<T> allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "The arena never runs destructors.");
+        return Span<T>(static_cast<T *>(allocate_bytes(count * sizeof(T), alignof(T))), count);
+    }
+
+    // Bytes held across all blocks.
+    size_t capacity() const;
+    size_t block_count() const { return m_blocks.size(); }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> memory;
+        size_t size;
+    };
+
+    void *allocate_bytes(size_t bytes, size_t alignment);
+    void rewind(size_t block, size_t offset);
+
+    std::vector<Block> m_blocks;
+    size_t m_block = 0;  // Block the next allocation is taken from.
+    size_t m_offset = 0; // Bytes of it already handed out.
+};
+
+// The calling thread's arena.
+TrialArena &trial_arena();
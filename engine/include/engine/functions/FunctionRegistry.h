@@ -3,18 +3,45 @@
 #include "include/engine/core/IExecutable.h"
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <memory>
 
+// Pure functions always return the same results for the same arguments and have no side
+// effects, so the engine may evaluate a trial-invariant call to one once instead of per trial.
+enum class FunctionPurity
+{
+    Impure,
+    Pure
+};
+
+// Cheap functions never fail and cost about as much per lane as a select, so a batched
+// conditional evaluates a branch made only of them on every lane and blends the result in,
+// instead of running it on the compacted lanes that take it. See BatchedProgram.h.
+enum class FunctionCost
+{
+    Expensive,
+    Cheap
+};
+
 class FunctionRegistry
 {
 public:
     using FactoryFunc = std::function<std::unique_ptr<IExecutable>()>;
+    using CreationHook = std::function<void(const std::string &name, IExecutable &)>;
+
+    void register_function(const std::string &name, FactoryFunc factory, FunctionPurity purity = FunctionPurity::Impure, FunctionCost cost = FunctionCost::Expensive);
+    bool is_pure(const std::string &name) const;
+    bool is_cheap(const std::string &name) const;
 
-    void register_function(const std::string &name, FactoryFunc factory);
+    // Runs `hook` on every executable the registered factories create from now on, with the
+    // name the function was registered under.
+    void set_creation_hook(CreationHook hook);
 
     const std::unordered_map<std::string, FactoryFunc> &get_factory_map() const;
 
 private:
     std::unordered_map<std::string, FactoryFunc> m_factory_map;
+    std::unordered_set<std::string> m_pure_functions;
+    std::unordered_set<std::string> m_cheap_functions;
 };
\ No newline at end of file
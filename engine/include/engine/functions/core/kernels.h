@@ -0,0 +1,39 @@
+#pragma once
+#include "include/engine/core/DataStructures.h"
+#include <cstddef>
+
+// Instruction sets the element-wise kernels are specialised for.
+enum class SimdLevel
+{
+    Scalar,
+    AVX2,
+    AVX512,
+    NEON
+};
+
+// In-place element-wise arithmetic, specialised per OpCode at compile time so no loop ever
+// switches on the operation. Division kernels never throw: callers check the divisors with
+// any_zero() afterwards and raise their own error.
+struct ElementwiseKernels
+{
+    using VectorKernel = void (*)(double *acc, const double *rhs, size_t n); // acc[i] = acc[i] op rhs[i]
+    using ScalarKernel = void (*)(double *acc, double rhs, size_t n);        // acc[i] = acc[i] op rhs
+
+    SimdLevel level;
+    VectorKernel vector[5]; // Indexed by kernel_index(): ADD, SUBTRACT, MULTIPLY, DIVIDE, POWER.
+    ScalarKernel scalar[5];
+    bool (*any_zero)(const double *values, size_t n);
+};
+
+// Position of an arithmetic OpCode in the kernel tables; throws for other codes.
+size_t kernel_index(OpCode code);
+
+// The widest instruction set this CPU supports, detected once. Setting the environment
+// variable VSE_SIMD to "scalar", "avx2", "avx512" or "neon" caps it.
+SimdLevel best_simd_level();
+bool simd_level_supported(SimdLevel level);
+const char *simd_level_name(SimdLevel level);
+
+// Kernels for the best level, or for a specific one (unsupported levels fall back to scalar).
+const ElementwiseKernels &elementwise_kernels();
+const ElementwiseKernels &elementwise_kernels(SimdLevel level);
@@ -4,21 +4,31 @@
 
 void register_core_functions(FunctionRegistry &registry);
 
-class VariadicBaseOperation : public IExecutable
+class VariadicBaseOperation : public InPlaceExecutable<>
 {
 public:
     explicit VariadicBaseOperation(OpCode code);
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 
 private:
     OpCode m_code;
 };
 
-class ComparisonBaseOperation : public IExecutable
+class ComparisonBaseOperation : public InPlaceExecutable<>
 {
 public:
     explicit ComparisonBaseOperation(OpCode code);
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 
 private:
     OpCode m_code;
@@ -50,40 +60,75 @@ public:
     PowerOperation();
 };
 
-class LogOperation : public IExecutable
+class LogOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class Log10Operation : public IExecutable
+class Log10Operation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class ExpOperation : public IExecutable
+class ExpOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class SinOperation : public IExecutable
+class SinOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class CosOperation : public IExecutable
+class CosOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class TanOperation : public IExecutable
+class TanOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class IdentityOperation : public IExecutable
+class IdentityOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
 
 class EqualsOperation : public ComparisonBaseOperation
@@ -117,18 +162,33 @@ public:
     LessOrEqualOperation();
 };
 
-class AndOperation : public IExecutable
+class AndOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class OrOperation : public IExecutable
+class OrOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class NotOperation : public IExecutable
+class NotOperation : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 #include "include/engine/core/IExecutable.h"
 
-class SirModelOperation : public IExecutable
+// Returns the S, I and R series, written into the result slots so their storage is reused.
+// An optional eighth argument picks the integrator: "euler" (the default) or "rk4", whose
+// fourth-order steps stay accurate at a much larger dt, so fewer periods cover the same time.
+class SirModelOperation : public InPlaceExecutable<3>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
\ No newline at end of file
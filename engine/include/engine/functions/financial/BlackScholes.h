@@ -1,8 +1,43 @@
 #pragma once
+#include "include/engine/core/DeviceMath.h"
 #include "include/engine/core/IExecutable.h"
+#include <cstdint>
+#include <optional>
 
-class BlackScholesOperation : public IExecutable
+enum class OptionType : uint8_t
+{
+    Call,
+    Put
+};
+
+// European options under Black-Scholes (see black_scholes_terms() in DeviceMath.h): spot,
+// strike, rate, time_to_maturity, volatility and option_type ('call' or 'put'). Any of the
+// numeric arguments may be a vector, all of one length, to price one option per element in a
+// single call; the result is then a vector too. A literal option_type is resolved once when the
+// step is planned and no longer passed, which also lets scalar calls run in batched lanes.
+template <size_t NumResults>
+class BlackScholesBase : public InPlaceExecutable<NumResults>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
-};
\ No newline at end of file
+    std::vector<size_t> bind_literal_arguments(const std::vector<const TrialValue *> &literals) override;
+    bool supports_lanes(size_t num_args) const override { return m_option_type && num_args == 5 && NumResults == 1; }
+    void execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+
+private:
+    std::optional<OptionType> m_option_type; // Set when the option type was a literal.
+};
+
+// BlackScholes: the option price.
+class BlackScholesOperation : public BlackScholesBase<1>
+{
+};
+
+// BlackScholesGreeks: price, delta, gamma, vega and theta, from the same intermediates. Vega is
+// per unit of volatility and theta per year.
+class BlackScholesGreeksOperation : public BlackScholesBase<5>
+{
+};
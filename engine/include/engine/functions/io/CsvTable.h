@@ -0,0 +1,71 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A CSV file parsed into typed, contiguous columns. Tables are immutable once loaded and
+// shared between every reader, so that reads from any worker thread need neither locks nor
+// copies of the parsed data.
+//
+// Files are memory-mapped and split on line boundaries into chunks that are parsed in
+// parallel, and only the columns asked for are materialised. Files with quoted fields go
+// through csv-parser instead, since quotes may hide separators and line breaks. Large files
+// also get a binary sidecar, "<file>.vsecache", from which later runs load their columns
+// without parsing the text again.
+class CsvTable
+{
+public:
+    struct Column
+    {
+        std::string name;
+        std::vector<double> values;      // Each cell parsed as std::stod would; 0 where it is not a number.
+        std::vector<size_t> invalid_rows; // Rows whose cell is not a number, in ascending order.
+        // Columns with cells that are not numbers keep their text as indices into a dictionary
+        // of the distinct values; both are empty for numeric columns.
+        std::vector<std::string> dictionary;
+        std::vector<uint32_t> codes;
+
+        bool is_numeric() const { return invalid_rows.empty(); }
+        bool is_number(size_t row) const;
+        // Text of a cell of a column that holds text.
+        const std::string &text(size_t row) const { return dictionary[codes[row]]; }
+    };
+
+    // The table of `path` with at least `columns` loaded (all columns for the first overload).
+    // Tables are cached, thread-safely, under the file's path, modification time and size, so
+    // that a file edited between runs is read again. Names missing from the header are
+    // ignored. Throws CsvFileNotFound when the file cannot be read or parsed.
+    static std::shared_ptr<const CsvTable> load(const std::string &path);
+    static std::shared_ptr<const CsvTable> load(const std::string &path, const std::vector<std::string> &columns);
+
+    // Loads, with one pass per file, the columns that read_csv_* calls anywhere in `recipe`
+    // name through literal arguments. Best effort: files that fail to load are left for the
+    // calls themselves to report.
+    static void preload(const nlohmann::json &recipe);
+
+    // Files of at least this many bytes get a .vsecache sidecar; 64 MiB by default.
+    static void set_sidecar_threshold(uint64_t bytes);
+
+    // Null when the column is not in the header, or was not among those loaded.
+    const Column *find_column(const std::string &name) const;
+    bool has_column(const std::string &name) const;
+    size_t num_rows() const { return m_num_rows; }
+    const std::vector<std::string> &header() const { return m_header; }
+
+private:
+    struct Source;
+
+    static std::shared_ptr<const CsvTable> load(const std::string &path, const std::vector<std::string> &columns, bool all_columns);
+    // A copy of `table` (null for none yet) sharing its columns, with the missing ones added.
+    static std::shared_ptr<const CsvTable> extend(const std::shared_ptr<const CsvTable> &table, const Source &source,
+                                                  const std::vector<std::string> &columns, bool all_columns);
+
+    std::vector<std::string> m_header;
+    size_t m_num_rows = 0;
+    std::unordered_map<std::string, std::shared_ptr<const Column>> m_columns; // Loaded columns.
+};
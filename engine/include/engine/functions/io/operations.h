@@ -4,13 +4,14 @@
 
 void register_io_functions(FunctionRegistry &registry);
 
-class ReadCsvVectorOperation : public IExecutable
+// Both read from the shared CsvTable of the file, which is parsed once.
+class ReadCsvVectorOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class ReadCsvScalarOperation : public IExecutable
+class ReadCsvScalarOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
-};
\ No newline at end of file
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+};
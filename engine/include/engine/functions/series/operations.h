@@ -4,53 +4,64 @@
 
 void register_series_functions(FunctionRegistry &registry);
 
-class GrowSeriesOperation : public IExecutable
+// grow_series, compound_series, npv and irr also value a portfolio in one call. A portfolio
+// is a matrix held in a series with one row per period and one column per instrument, so
+// element (period, instrument) is at period * instruments + instrument, and the kernels sweep
+// each row with unit stride. The instrument count comes from the per-instrument argument:
+// the vector base or rate of grow_series, the base of compound_series, the rate of npv and
+// the second argument of irr.
+class GrowSeriesOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class CompoundSeriesOperation : public IExecutable
+class CompoundSeriesOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class NpvOperation : public IExecutable
+class NpvOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class SumSeriesOperation : public IExecutable
+class IrrOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class GetElementOperation : public IExecutable
+class SumSeriesOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class DeleteElementOperation : public IExecutable
+class GetElementOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class SeriesDeltaOperation : public IExecutable
+class DeleteElementOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class ComposeVectorOperation : public IExecutable
+class SeriesDeltaOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class InterpolateSeriesOperation : public IExecutable
+class ComposeVectorOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class CapitalizeExpenseOperation : public IExecutable
+class InterpolateSeriesOperation : public InPlaceExecutable<>
 {
-public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+};
+class CapitalizeExpenseOperation : public InPlaceExecutable<2>
+{
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
\ No newline at end of file
@@ -1,41 +1,171 @@
 #pragma once
 #include "include/engine/core/IExecutable.h"
+#include "include/engine/core/Random.h"
 #include "include/engine/functions/FunctionRegistry.h"
 
 void register_statistics_functions(FunctionRegistry &registry);
 
-class NormalSampler : public IExecutable
+// Base of all samplers. Each sampler instance is one call site of the recipe and draws from the
+// stream keyed by (seed, trial, call site); the engine numbers call sites in recipe order.
+// Sampling happens in bulk through fill(); scalar calls are a fill of one lane, so both paths
+// produce the same draws. Runs with a UniformDesign (see SamplingDesign.h) take one uniform per
+// call and trial from the design instead and map it through the inverse distribution function.
+class Sampler : public InPlaceExecutable<>
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    void set_call_site(uint32_t site) { m_call_site = site; }
+    uint32_t call_site() const { return m_call_site; }
+
+    // Writes one sample per trial lane to `out`; params[k][i] is parameter k of lane i.
+    virtual void fill(double *out, size_t lanes, const LaneArgument *params) const = 0;
+
+    void execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const override { fill(out, lanes, args); }
+
+    // Whether draws under a UniformDesign come from it, one uniform per call and trial.
+    virtual bool uses_design() const { return true; }
+    // Whether the draws of the two trials of a pair mirror each other under antithetic variates.
+    virtual bool mirrors_antithetic_pairs() const { return uses_design(); }
+
+protected:
+    // Draws the single sample of a scalar call from its (already arity-checked) arguments.
+    double draw(ArgumentSpan args) const;
+
+private:
+    uint32_t m_call_site = 0;
+};
+class NormalSampler : public Sampler
+{
+public:
+    bool supports_lanes(size_t num_args) const override;
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class UniformSampler : public IExecutable
+class UniformSampler : public Sampler
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class BernoulliSampler : public IExecutable
+class BernoulliSampler : public Sampler
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class LognormalSampler : public IExecutable
+class LognormalSampler : public Sampler
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+    bool lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class BetaSampler : public IExecutable
+class BetaSampler : public Sampler
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class PertSampler : public IExecutable
+class PertSampler : public Sampler
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
+    bool supports_lanes(size_t num_args) const override;
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
 };
-class TriangularSampler : public IExecutable
+class TriangularSampler : public Sampler
 {
 public:
-    std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override;
-};
\ No newline at end of file
+    bool supports_lanes(size_t num_args) const override;
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+};// MultivariateNormal(means, std_devs, correlation): n correlated normal draws per trial,
+// means + std_devs * (L z), where L is the Cholesky factor of the n x n correlation matrix (a
+// series of n * n entries, row by row) and z holds n independent draws from the call's stream.
+// Means and standard deviations are series of n, or scalars shared by all components. Assigned
+// to one variable the draw is a series; assigned to n variables, each takes one component, and
+// calls with trial-invariant arguments then run batched. Each thread factors a matrix once per
+// call site. The draws always come from the stream, also under a UniformDesign.
+class MultivariateNormalSampler : public Sampler
+{
+public:
+    size_t execute_into(ArgumentSpan args, ResultSpan results) const override;
+    bool supports_lane_results(ArgumentSpan args, size_t num_results) const override;
+    void execute_lanes_into(ArgumentSpan args, double *const *out, size_t num_results, size_t lanes) const override;
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+    bool uses_design() const override { return false; }
+
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+
+private:
+    struct Parameters
+    {
+        size_t size;
+        Broadcast means;
+        Broadcast std_devs;
+        const double *factor; // Lower-triangular, row by row.
+    };
+
+    Parameters parameters(ArgumentSpan args) const;
+    void sample(const Parameters &params, double *const *out, size_t lanes) const;
+};
+
+// Base of the path samplers, which draw a whole series per trial: the value after each of
+// `periods` periods, the start value excluded (as with grow_series). A call draws all the normal
+// scores of its path from its stream in one pass, also under a UniformDesign, and then steps
+// the path over them in place, reusing the storage of the series its result already holds.
+// Under antithetic variates the second trial of each pair reads the stream of the first and
+// mirrors it: normal scores change sign and uniforms u become 1 - u. The optional last argument
+// `dt` is the length of a period in years (default 1).
+class PathSampler : public Sampler
+{
+public:
+    void fill(double *out, size_t lanes, const LaneArgument *params) const override;
+    bool uses_design() const override { return false; }
+    bool mirrors_antithetic_pairs() const override { return true; }
+};
+// gbm_path(start, drift, volatility, periods[, dt]): geometric Brownian motion, stepped with its
+// exact lognormal transition S_t = S_{t-1} exp((drift - volatility^2 / 2) dt + volatility sqrt(dt) z_t).
+class GbmPathSampler : public PathSampler
+{
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+};
+// ou_path(start, mean_level, reversion_speed, volatility, periods[, dt]): Ornstein–Uhlenbeck
+// process, stepped with its exact Gaussian transition, so any dt is unbiased. A reversion speed
+// of zero gives arithmetic Brownian motion.
+class OuPathSampler : public PathSampler
+{
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+};
+// jump_diffusion_path(start, drift, volatility, jump_intensity, jump_mean, jump_std_dev, periods[, dt]):
+// Merton jump diffusion. Each period adds Poisson(jump_intensity dt) jumps, with log sizes drawn
+// from N(jump_mean, jump_std_dev^2), to the gbm_path step. The drift is compensated for the jumps,
+// so E[S_t] = start exp(drift t) as for gbm_path, and with no jumps the path is gbm_path's.
+class JumpDiffusionPathSampler : public PathSampler
+{
+protected:
+    void evaluate(ArgumentSpan args, TrialValue *const *results) const override;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "include/engine/core/SimulationEngine.h"
+#include "include/engine/io/ResultSink.h"
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Histogram bins of the distribution in previews.
+constexpr size_t PREVIEW_BINS = 20;
+
+// The `vse --preview` result object: {"status", "trials", "type", "value"}, with numbers
+// rounded to four decimals. Previews of scalars that vary between trials add the
+// distribution_to_json of their trials as "distribution", with `bins` bins.
+nlohmann::json preview_to_json(const PreviewResult &preview, size_t bins = PREVIEW_BINS);
+
+// A SensitivityReport as {"trials", "base": {"mean", ...}, "bars": [{"name", "slot", "low",
+// "high", "mean_low", "mean_high", "swing"}, ...]}, widest swing first.
+nlohmann::json sensitivity_to_json(const SensitivityReport &report);
+
+// Runs `engine` into one StatisticsSink per output and into the recipe's output file, if any,
+// as well as into `extra_sinks`. `report`, when given, receives the trial count and precision
+// reached.
+std::vector<StatisticsSink> run_with_statistics(SimulationEngine &engine, RunReport *report = nullptr, const std::vector<ResultSink *> &extra_sinks = {});
+
+// `vse --serve`: a long-lived engine for the language server and scripts. Requests and
+// responses are single lines of JSON:
+//   {"id": 1, "command": "preview", "recipe": {...}}     -> the --preview object
+//   {"id": 2, "command": "run", "recipe_path": "r.json"} -> {"outputs": [...]}, per-output statistics,
+//                                                            and "precision" with a target_precision
+// Both take an optional "bins": the preview's histogram bins, and for a run the bins of the
+// "distributions" (one distribution_to_json per period) then added to every output.
+//   {"id": 3, "command": "sensitivity", "recipe": {...}} -> the sensitivity_to_json object
+//   {"id": 4, "command": "clear_cache"}
+//   {"id": 5, "command": "shutdown"}
+// Responses echo "id" and carry "status" ("success" or "error", with "message"); recipe
+// commands also report whether the engine came from the cache in "cached".
+//
+// Built engines are kept in a least-recently-used cache keyed by the recipe text, so asking
+// again for the same recipe skips parsing and the pre-trial phase, CSV loads included. Data
+// files are not watched: clear_cache drops the engines after they change. Recipes without a
+// seed keep the one drawn when their engine was built.
+class EngineServer
+{
+public:
+    using Configure = std::function<void(SimulationEngine &)>;
+
+    // `configure` is applied to every engine once it is built, e.g. for scheduler overrides.
+    explicit EngineServer(Configure configure = Configure(), size_t cache_capacity = 16);
+
+    // Answers requests from `in`, one line each, until end of input or a shutdown request.
+    void serve(std::istream &in, std::ostream &out);
+
+    // The response to one request; errors are reported in the response rather than thrown.
+    nlohmann::json handle(const nlohmann::json &request);
+
+    size_t cache_size() const { return m_cache.size(); }
+    bool shutdown_requested() const { return m_shutdown; }
+
+private:
+    struct CacheEntry
+    {
+        size_t hash;
+        std::string recipe;
+        std::shared_ptr<SimulationEngine> engine;
+    };
+
+    std::shared_ptr<SimulationEngine> engine_for(const nlohmann::json &request, bool &cached);
+
+    Configure m_configure;
+    size_t m_cache_capacity;
+    std::list<CacheEntry> m_cache; // Most recently used first.
+    bool m_shutdown = false;
+};
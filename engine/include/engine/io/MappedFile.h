@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file: memory-mapped where the platform allows, read into memory
+// otherwise. The view stays valid for the lifetime of the object.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // False when the file cannot be opened or read.
+    bool open(const std::string &path);
+
+    const char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+
+private:
+    void close();
+
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::string m_buffer; // Contents of files that could not be mapped, e.g. empty ones.
+};
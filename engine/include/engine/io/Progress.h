@@ -0,0 +1,87 @@
+#pragma once
+
+#include "include/engine/core/Statistics.h"
+#include "include/engine/io/ResultSink.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Where a run stands, as ProgressSink::snapshot() sees it.
+struct ProgressSnapshot
+{
+    size_t trials = 0;       // Trials whose results have arrived.
+    size_t total_trials = 0; // Grows between the rounds of a run with a precision target.
+    size_t errors = 0;       // Chunks that threw.
+    double elapsed_seconds = 0.0;
+    bool finished = false;
+    // Of the first output, when it is scalar; count is 0 otherwise.
+    RunningStatistics statistics;
+
+    double trials_per_second() const { return elapsed_seconds > 0.0 ? static_cast<double>(trials) / elapsed_seconds : 0.0; }
+    // Seconds left at the current rate; negative while there is no rate to go by.
+    double eta_seconds() const;
+};
+
+// Counts the trials of a run as the workers finish their chunks. The counters are atomics that
+// the workers bump without locking; the running statistics of each chunk are summed up by the
+// worker and merged under a lock held once per chunk. snapshot() may be called from any thread
+// at any time, e.g. by a ProgressReporter.
+class ProgressSink : public ResultSink
+{
+public:
+    void begin(size_t num_trials) override;
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override;
+    void fail(size_t first_trial, size_t count) override;
+    void extend(size_t num_trials) override { m_total_trials.store(num_trials, std::memory_order_relaxed); }
+    void finish() override { m_finished.store(true, std::memory_order_release); }
+
+    ProgressSnapshot snapshot() const;
+
+private:
+    std::atomic<size_t> m_trials{0};
+    std::atomic<size_t> m_total_trials{0};
+    std::atomic<size_t> m_errors{0};
+    std::atomic<bool> m_finished{false};
+    mutable std::mutex m_mutex; // Guards the two members below.
+    std::chrono::steady_clock::time_point m_started = std::chrono::steady_clock::now();
+    RunningStatistics m_statistics;
+};
+
+// Publishes snapshots of a ProgressSink from a thread of its own every `interval`, and once
+// more, with `last` set, when it is stopped or destroyed.
+class ProgressReporter
+{
+public:
+    using Publish = std::function<void(const ProgressSnapshot &snapshot, bool last)>;
+
+    ProgressReporter(const ProgressSink &sink, std::chrono::milliseconds interval, Publish publish);
+    ~ProgressReporter() { stop(); }
+
+    ProgressReporter(const ProgressReporter &) = delete;
+    ProgressReporter &operator=(const ProgressReporter &) = delete;
+
+    void stop();
+
+private:
+    const ProgressSink &m_sink;
+    Publish m_publish;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+// One line of a terminal progress bar, without a line ending:
+//   [##########----------]  50.0%  5000/10000 trials  12345 trials/s  ETA 0:00:01  mean 1.23 ± 0.01
+// The statistics are the mean of the first output and its standard error, when it is scalar.
+std::string format_progress_bar(const ProgressSnapshot &snapshot);
+
+// A snapshot as one JSON object: {"event": "progress" or "finished", "trials", "total_trials",
+// "errors", "elapsed", "trials_per_second", "eta"} and, for scalar first outputs, "mean",
+// "stddev", "standard_error", "min" and "max". "eta" is null while it is unknown.
+nlohmann::json progress_to_json(const ProgressSnapshot &snapshot);
@@ -0,0 +1,357 @@
+#pragma once
+
+#include "include/engine/core/DataStructures.h"
+#include "include/engine/core/Statistics.h"
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Consumer of trial results during SimulationEngine::run(sinks). Results arrive in chunks,
+// each tagged with the index of its first trial, so no sink ever needs the full result set.
+class ResultSink
+{
+public:
+    virtual ~ResultSink() = default;
+
+    // Called once, before begin(), with the names of the outputs every trial produces.
+    virtual void set_outputs(const std::vector<std::string> &names) { (void)names; }
+
+    // Called once, before any chunk, with the number of trials the run will produce.
+    virtual void begin(size_t num_trials) { (void)num_trials; }
+
+    // Receives the results of trials [first_trial, first_trial + count). Unordered sinks are
+    // called from the worker threads as chunks finish, concurrently and in any order; ordered
+    // sinks are called from the thread running the simulation, in trial order.
+    virtual void consume(size_t first_trial, const TrialValue *results, size_t count) = 0;
+
+    // The same for every output at once: columns[k] holds the `count` results of output k.
+    // By default a sink only sees the first output.
+    virtual void consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count)
+    {
+        consume(first_trial, columns[0], count);
+    }
+
+    virtual bool ordered() const { return false; }
+
+    // Called on unordered sinks, from the worker thread, when the chunk of trials
+    // [first_trial, first_trial + count) throws; the run then stops and rethrows the error.
+    virtual void fail(size_t first_trial, size_t count)
+    {
+        (void)first_trial;
+        (void)count;
+    }
+
+    // Called between the rounds of a run with a precision target, when it goes on past the
+    // trials announced so far: `num_trials` is the new total. No chunk is in flight then.
+    virtual void extend(size_t num_trials) { (void)num_trials; }
+
+    // Called once after the last chunk.
+    virtual void finish() {}
+};
+
+// Passes one output of a multi-output run on to a single-output sink.
+class OutputColumnSink : public ResultSink
+{
+public:
+    OutputColumnSink(ResultSink &sink, size_t output) : m_sink(sink), m_output(output) {}
+
+    void begin(size_t num_trials) override { m_sink.begin(num_trials); }
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override { m_sink.consume(first_trial, results, count); }
+    void consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count) override
+    {
+        m_sink.consume(first_trial, columns[m_output], count);
+    }
+    bool ordered() const override { return m_sink.ordered(); }
+    void fail(size_t first_trial, size_t count) override { m_sink.fail(first_trial, count); }
+    void extend(size_t num_trials) override { m_sink.extend(num_trials); }
+    void finish() override { m_sink.finish(); }
+
+private:
+    ResultSink &m_sink;
+    size_t m_output;
+};
+
+// Keeps every result in memory, in trial order. This is what SimulationEngine::run() returns.
+class ResultCollector : public ResultSink
+{
+public:
+    void begin(size_t num_trials) override;
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override;
+    void extend(size_t num_trials) override;
+
+    const std::vector<TrialValue> &results() const { return m_results; }
+    std::vector<TrialValue> take_results() { return std::move(m_results); }
+
+private:
+    std::vector<TrialValue> m_results;
+};
+
+// Packs every output into a dense array of doubles, in trial order: one value per trial for
+// scalar and boolean outputs, and one row per trial for vector outputs, as wide as the first
+// trial's vector. As in BinaryResultWriter, booleans are stored as 0.0 / 1.0, and strings and
+// vectors of another length as NaN. take_arrays() hands the buffers over without copying them,
+// which is how the Python bindings return numpy arrays.
+class ArrayResultSink : public ResultSink
+{
+public:
+    enum class Kind
+    {
+        Scalar,
+        Vector,
+        Boolean
+    };
+
+    struct Array
+    {
+        std::string name;
+        Kind kind = Kind::Scalar; // Of the first trial.
+        size_t width = 1;         // Values per trial.
+        size_t trials = 0;
+        std::vector<double> values; // Row-major: trials x width.
+    };
+
+    void set_outputs(const std::vector<std::string> &names) override;
+    void begin(size_t num_trials) override { m_reserved = num_trials; }
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override;
+    void consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count) override;
+    bool ordered() const override { return true; }
+    void extend(size_t num_trials) override;
+
+    std::vector<Array> take_arrays() { return std::move(m_arrays); }
+
+private:
+    void append(Array &array, const TrialValue *results, size_t count);
+
+    std::vector<Array> m_arrays = std::vector<Array>(1);
+    size_t m_reserved = 0;
+};
+
+// Online statistics of the output: moments and quantiles of scalar outputs, or of every period
+// of vector outputs. Each thread accumulates its own chunks without locking; the per-thread
+// accumulators are merged in finish(). finish() may also be called between chunks, while no
+// chunk is in flight, to read the statistics so far; later calls merge what arrived since.
+class StatisticsSink : public ResultSink
+{
+public:
+    enum class Kind
+    {
+        Empty,
+        Scalar,
+        Vector,
+        Other // Booleans and strings are counted but not summarised.
+    };
+
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override;
+    void finish() override;
+    // Adds the finished statistics of another part of the same run, e.g. of a shard; see
+    // Shard.h. Parts whose shape differs from the first one merged count as skipped trials.
+    void merge(Kind kind, size_t trials, size_t skipped, const std::vector<OutputStatistics> &periods);
+
+    Kind kind() const { return m_kind; }
+    size_t trials() const { return m_trials; }
+    size_t skipped_trials() const { return m_skipped; }
+    // Merged statistics, available after finish().
+    const std::vector<OutputStatistics> &periods() const { return m_periods; }
+
+private:
+    struct Partial
+    {
+        std::vector<OutputStatistics> periods;
+        size_t trials = 0;
+        size_t skipped = 0;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<Partial>> m_partials;
+    Kind m_kind = Kind::Empty;
+    size_t m_num_periods = 0;
+    size_t m_trials = 0;
+    size_t m_skipped = 0; // Vector trials whose length differs from the first one seen.
+    std::vector<OutputStatistics> m_periods;
+};
+
+// Streams results to a CSV file. Numbers are formatted with std::to_chars (shortest round-trip
+// form) into a large buffer that is written out in blocks. The header is taken from the first
+// trial; vector trials whose length differs from it are skipped, as before. Several outputs
+// are written side by side, each column named after its output.
+class CsvResultWriter : public ResultSink
+{
+public:
+    explicit CsvResultWriter(std::string path);
+
+    void set_outputs(const std::vector<std::string> &names) override;
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override;
+    void consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count) override;
+    bool ordered() const override { return true; }
+    void finish() override;
+
+private:
+    bool open(const TrialValue *const *columns);
+    bool append_row(const TrialValue *const *columns, size_t trial);
+    void append(const char *text, size_t size);
+    void append_number(double value);
+    void flush_pending();
+
+    std::string m_path;
+    std::ofstream m_file;
+    std::vector<char> m_pending;
+    std::vector<std::string> m_names;
+    std::vector<size_t> m_periods; // Per output; 0 for scalars and booleans.
+    bool m_started = false;
+    bool m_failed = false;
+    size_t m_trials = 0;
+};
+
+// Binary columnar results, readable zero-copy (e.g. numpy.memmap). A 64-byte little-endian
+// header is followed by one contiguous float64 column per period:
+//
+//   offset  size  field
+//        0     8  magic "VSERES01"
+//        8     4  header size (64)
+//       12     4  dtype (1 = float64)
+//       16     8  number of trials (rows)
+//       24     8  number of columns (1 for scalar and boolean outputs, periods for vectors)
+//       32     8  random seed of the run
+//       40     4  output kind (0 = scalar, 1 = vector, 2 = boolean) of the first output
+//       44     4  number of outputs when there are several, otherwise 0
+//       48    16  reserved (zero)
+//
+// With several outputs the header grows by 16 bytes per output, each holding its kind (4 bytes),
+// 4 reserved bytes and its number of columns (8 bytes); the columns of the outputs follow one
+// another. Column c starts at header size + c * trials * 8. Booleans are stored as 0.0 / 1.0,
+// and vector trials whose length differs from the first trial are stored as NaN.
+class BinaryResultWriter : public ResultSink
+{
+public:
+    static constexpr char MAGIC[8] = {'V', 'S', 'E', 'R', 'E', 'S', '0', '1'};
+    static constexpr size_t HEADER_SIZE = 64;
+    static constexpr size_t OUTPUT_DESCRIPTOR_SIZE = 16;
+
+    BinaryResultWriter(std::string path, uint64_t seed);
+
+    void set_outputs(const std::vector<std::string> &names) override;
+    void begin(size_t num_trials) override;
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override;
+    void consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count) override;
+    bool ordered() const override { return true; }
+    // Moves the columns written so far apart to their places for the new trial count.
+    void extend(size_t num_trials) override;
+    void finish() override;
+
+private:
+    struct Output
+    {
+        uint32_t kind;
+        size_t first_column;
+        size_t columns;
+    };
+
+    bool open(const TrialValue *const *columns);
+
+    std::string m_path;
+    uint64_t m_seed;
+    std::unique_ptr<char[]> m_buffer; // Declared before m_file, which flushes into it on destruction.
+    std::fstream m_file;              // Read back only when extend() moves columns.
+    std::vector<double> m_column;
+    std::vector<Output> m_outputs;
+    size_t m_num_outputs = 1;
+    size_t m_header_size = HEADER_SIZE;
+    bool m_started = false;
+    bool m_failed = false;
+    size_t m_num_trials = 0;
+    size_t m_trials = 0;
+};
+
+// Reads back what BinaryResultWriter wrote, a window of trials at a time, as `vse merge` does
+// with the results of shards. Throws EngineException when the file cannot be opened or is not
+// such a file.
+class BinaryResultReader
+{
+public:
+    explicit BinaryResultReader(const std::string &path);
+
+    size_t num_trials() const { return m_num_trials; }
+    size_t num_outputs() const { return m_outputs.size(); }
+    uint64_t seed() const { return m_seed; }
+
+    // Resizes `columns` to one column per output and fills it with the results of trials
+    // [first_trial, first_trial + count): numbers, booleans or vectors, as they were written.
+    void read(size_t first_trial, size_t count, std::vector<std::vector<TrialValue>> &columns);
+
+private:
+    struct Output
+    {
+        uint32_t kind;
+        size_t first_column;
+        size_t columns;
+    };
+
+    std::string m_path;
+    std::ifstream m_file;
+    std::vector<Output> m_outputs;
+    std::vector<double> m_column;
+    size_t m_header_size = BinaryResultWriter::HEADER_SIZE;
+    size_t m_num_trials = 0;
+    uint64_t m_seed = 0;
+};
+
+// Bins of the histograms and points of the ECDFs in distribution summaries, unless the recipe
+// sets simulation_config "summary_bins".
+constexpr size_t DEFAULT_SUMMARY_BINS = 50;
+
+// The distribution of one output, or one period of a vector output, in a size set by `bins`
+// rather than by the number of trials: {"mean", "stddev", "skewness", "kurtosis", "min", "max",
+// "percentiles": {"P1", ...}, "histogram": {"edges": [bins + 1], "counts": [bins]},
+// "ecdf": {"values": [bins + 1], "probabilities": [bins + 1]}}. The histogram has equal bins
+// from min to max, with counts read off the quantile sketch, so they are approximate; the ECDF
+// holds the quantiles at probabilities 0, 1 / bins, ..., 1.
+nlohmann::json distribution_to_json(const OutputStatistics &statistics, size_t bins);
+
+// The summary file of a run: {"format": "vse-summary", "version": 1, "seed", "trials",
+// "outputs": [{"name", "type" ("scalar", "vector", "other" or "empty"), "trials", "skipped",
+// "periods": [distribution_to_json, one per period; one for scalars]}, ...]}.
+nlohmann::json summary_to_json(const std::vector<std::string> &names, const std::vector<StatisticsSink> &statistics, uint64_t seed, size_t bins);
+
+// Writes distribution summaries instead of trial results, so the file stays a few kilobytes per
+// output and period whatever the number of trials. Each output goes into a StatisticsSink,
+// filled by the worker threads as chunks finish, and finish() writes summary_to_json.
+class SummaryResultWriter : public ResultSink
+{
+public:
+    SummaryResultWriter(std::string path, uint64_t seed, size_t bins = DEFAULT_SUMMARY_BINS);
+
+    void set_outputs(const std::vector<std::string> &names) override;
+    void consume(size_t first_trial, const TrialValue *results, size_t count) override;
+    void consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count) override;
+    void finish() override;
+
+private:
+    std::string m_path;
+    uint64_t m_seed;
+    size_t m_bins;
+    std::vector<std::string> m_names = {"Result"};
+    std::vector<StatisticsSink> m_statistics = std::vector<StatisticsSink>(1);
+};
+
+// Writes summary_to_json to `path`; throws EngineException when the file cannot be written.
+void write_summary(const std::string &path, const std::vector<std::string> &names, const std::vector<StatisticsSink> &statistics, uint64_t seed, size_t bins);
+
+// Output file formats. An empty format name picks binary for ".bin" files, a summary for
+// ".json" files and CSV otherwise.
+enum class OutputFormat
+{
+    Csv,
+    Binary,
+    Summary
+};
+
+OutputFormat parse_output_format(const std::string &format, const std::string &path);
+const char *output_format_name(OutputFormat format);
+std::unique_ptr<ResultSink> make_result_writer(const std::string &path, OutputFormat format, uint64_t seed, size_t summary_bins = DEFAULT_SUMMARY_BINS);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "include/engine/core/SimulationEngine.h"
+#include "include/engine/io/ResultSink.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// `vse --shard i/N` runs one of N slices of a recipe's trials, e.g. on one of N machines, and
+// `vse merge` combines the slices into what a single run would have produced. Every trial draws
+// from streams keyed by its index in the whole run, so a shard's trials are exactly those of a
+// single run with the same seed; see RunOptions::range.
+//
+// A shard writes a shard file of JSON:
+//   {"format": "vse-shard", "version": 1, "recipe": <content hash of the recipe>, "seed",
+//    "num_trials", "shard", "shards", "first_trial", "trials", "outputs": [names],
+//    "output_file", "output_format", "summary_bins", "results": <file name, or null>,
+//    "statistics": [one per output: {"kind", "trials", "skipped", "periods": [{"moments":
+//      {"count", "mean", "m2", "m3", "m4", "min", "max"}, "quantiles": {"compression", "min",
+//      "max", "centroids": [[mean, weight], ...]}}, ...]}, ...]}
+// and, when the recipe has an output_file, the shard's results next to it in the format of
+// BinaryResultWriter. Merged moments are those of a single run up to rounding, and merged
+// quantile sketches are combined as the per-thread sketches of a single run are; results are
+// copied as they are. Summary output files are written from the merged statistics, so their
+// shards keep no results.
+
+struct ShardSpec
+{
+    size_t index = 0;
+    size_t count = 1;
+};
+
+// "i/N" with 0 <= i < N, else nullopt.
+std::optional<ShardSpec> parse_shard_spec(const std::string &text);
+// The trials of a shard: N contiguous ranges in shard order, whose sizes differ by at most one.
+TrialRange shard_range(const ShardSpec &shard, size_t num_trials);
+
+// Where a shard file sits in its run.
+struct ShardManifest
+{
+    std::string recipe_hash;
+    uint64_t seed = 0;
+    size_t num_trials = 0; // Of the whole run.
+    ShardSpec shard;
+    TrialRange range;
+    std::vector<std::string> outputs;
+    std::string output_file; // The recipe's, which `vse merge` writes; empty when it has none.
+    OutputFormat output_format = OutputFormat::Csv;
+    size_t summary_bins = DEFAULT_SUMMARY_BINS;
+    std::string results_file; // Next to the shard file; empty when no results were written.
+};
+
+// Runs `shard` of `engine`, built from `recipe`, into one StatisticsSink per output, which are
+// returned, and into `extra_sinks`, then writes the shard file at `path`. The results go to the
+// path with its extension replaced by ".bin". The recipe must set its "seed", which every shard
+// has to share.
+std::vector<StatisticsSink> run_shard(const SimulationEngine &engine, std::string_view recipe, const ShardSpec &shard, const std::string &path, const std::vector<ResultSink *> &extra_sinks = {});
+
+struct MergedShards
+{
+    ShardManifest run; // Covering every trial.
+    std::vector<StatisticsSink> statistics;
+};
+
+// Combines the shard files of one run, which must hold each of its shards once, and writes the
+// recipe's output file from their results. Throws EngineException for files that are missing,
+// malformed, or from other runs.
+MergedShards merge_shards(const std::vector<std::string> &paths);
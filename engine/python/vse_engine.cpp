@@ -0,0 +1,228 @@
+// The vse_engine Python module: CompiledPlan for Python callers, with results returned as numpy
+// arrays that take over the engine's result buffers instead of copying them.
+//
+//   import vse_engine
+//   plan = vse_engine.compile(recipe)              # the linker's dict, JSON text or a binary recipe
+//   results = plan.run(seed=7, trials=100_000)     # {output name: numpy.ndarray}
+//   vse_engine.preview(recipe)                     # what `vse --serve` answers to "preview"
+
+#include "include/engine/core/CompiledPlan.h"
+#include "include/engine/core/EngineException.h"
+#include "include/engine/io/EngineServer.h"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <nlohmann/json.hpp>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+using json = nlohmann::json;
+
+namespace
+{
+    // Walks a recipe dict as it comes from the linker, without serialising it.
+    json to_json(py::handle object)
+    {
+        if (object.is_none())
+            return nullptr;
+        if (py::isinstance<py::bool_>(object))
+            return object.cast<bool>();
+        if (py::isinstance<py::int_>(object))
+        {
+            try
+            {
+                return object.cast<int64_t>();
+            }
+            catch (const py::cast_error &)
+            {
+                return object.cast<uint64_t>();
+            }
+        }
+        if (py::isinstance<py::float_>(object))
+            return object.cast<double>();
+        if (py::isinstance<py::str>(object))
+            return object.cast<std::string>();
+        if (py::isinstance<py::bytes>(object))
+        {
+            const std::string bytes = object.cast<std::string>();
+            return json::binary_t(std::vector<std::uint8_t>(bytes.begin(), bytes.end()));
+        }
+        if (py::isinstance<py::dict>(object))
+        {
+            json document = json::object();
+            for (const auto &item : object.cast<py::dict>())
+            {
+                document[py::str(item.first).cast<std::string>()] = to_json(item.second);
+            }
+            return document;
+        }
+        if (py::isinstance<py::list>(object) || py::isinstance<py::tuple>(object))
+        {
+            json items = json::array();
+            for (py::handle item : object)
+            {
+                items.push_back(to_json(item));
+            }
+            return items;
+        }
+        throw py::type_error("Recipes hold dicts, lists, strings, numbers, booleans and None, not " + py::str(py::type::of(object)).cast<std::string>() + ".");
+    }
+
+    py::object to_python(const json &value)
+    {
+        switch (value.type())
+        {
+        case json::value_t::null:
+            return py::none();
+        case json::value_t::boolean:
+            return py::bool_(value.get<bool>());
+        case json::value_t::number_integer:
+            return py::int_(value.get<int64_t>());
+        case json::value_t::number_unsigned:
+            return py::int_(value.get<uint64_t>());
+        case json::value_t::number_float:
+            return py::float_(value.get<double>());
+        case json::value_t::string:
+            return py::str(value.get<std::string>());
+        case json::value_t::array:
+        {
+            py::list items;
+            for (const json &item : value)
+                items.append(to_python(item));
+            return items;
+        }
+        case json::value_t::object:
+        {
+            py::dict document;
+            for (const auto &item : value.items())
+                document[py::str(item.key())] = to_python(item.value());
+            return document;
+        }
+        default:
+            return py::none();
+        }
+    }
+
+    // The array's buffer becomes the numpy array's, owned by a capsule that frees it with the array.
+    py::array to_numpy(ArrayResultSink::Array &&array)
+    {
+        auto *values = new std::vector<double>(std::move(array.values));
+        py::capsule owner(values, [](void *buffer)
+                          { delete static_cast<std::vector<double> *>(buffer); });
+        std::vector<py::ssize_t> shape{static_cast<py::ssize_t>(array.trials)};
+        if (array.kind == ArrayResultSink::Kind::Vector)
+        {
+            shape.push_back(static_cast<py::ssize_t>(array.width));
+        }
+        return py::array_t<double>(shape, values->data(), owner);
+    }
+
+    // Log messages reach a Python callable as (level, message), level being "info" or "warning".
+    // The callable is only touched with the GIL held, including when the plan lets go of it.
+    LogCallback python_log(const py::object &log)
+    {
+        if (log.is_none())
+            return LogCallback();
+        std::shared_ptr<py::object> callable(new py::object(log), [](py::object *object)
+                                             {
+            py::gil_scoped_acquire gil;
+            delete object; });
+        return [callable](LogLevel level, const std::string &message)
+        {
+            py::gil_scoped_acquire gil;
+            (*callable)(level == LogLevel::Warning ? "warning" : "info", message);
+        };
+    }
+
+    struct Plan
+    {
+        std::shared_ptr<const CompiledPlan> plan;
+    };
+
+    Plan compile(const py::object &recipe, const py::object &log)
+    {
+        LogCallback callback = python_log(log);
+        if (py::isinstance<py::str>(recipe) || py::isinstance<py::bytes>(recipe))
+        {
+            const std::string text = recipe.cast<std::string>();
+            py::gil_scoped_release release;
+            return Plan{CompiledPlan::compile(std::string_view(text), std::move(callback))};
+        }
+        const json document = to_json(recipe);
+        py::gil_scoped_release release;
+        return Plan{CompiledPlan::compile_document(document, std::move(callback))};
+    }
+
+    py::dict run_plan(const Plan &plan, std::optional<uint64_t> seed, std::optional<size_t> trials, std::optional<std::vector<std::string>> outputs, size_t threads, size_t chunk_size)
+    {
+        RunOptions options;
+        options.seed = seed;
+        options.num_trials = trials;
+        options.outputs = outputs.value_or(std::vector<std::string>());
+        if (threads > 0 || chunk_size > 0)
+        {
+            SchedulerConfig scheduler = plan.plan->engine().get_scheduler_config();
+            scheduler.threads = threads > 0 ? threads : scheduler.threads;
+            scheduler.chunk_size = chunk_size > 0 ? chunk_size : scheduler.chunk_size;
+            options.scheduler = scheduler;
+        }
+        ArrayResultSink sink;
+        {
+            py::gil_scoped_release release;
+            run(*plan.plan, options, sink);
+        }
+        py::dict results;
+        for (ArrayResultSink::Array &array : sink.take_arrays())
+        {
+            const std::string name = array.name;
+            results[py::str(name)] = to_numpy(std::move(array));
+        }
+        return results;
+    }
+
+    py::object preview(const py::object &recipe, size_t max_trials)
+    {
+        const json document = py::isinstance<py::dict>(recipe) ? to_json(recipe) : json::parse(recipe.cast<std::string>());
+        json response;
+        {
+            py::gil_scoped_release release;
+            PreviewOptions options;
+            options.max_trials = max_trials;
+            try
+            {
+                response = preview_to_json(SimulationEngine::from_recipe(document, true)->preview(options));
+            }
+            catch (const std::exception &e)
+            {
+                response = {{"status", "error"}, {"message", e.what()}};
+            }
+        }
+        return to_python(response);
+    }
+}
+
+PYBIND11_MODULE(vse_engine, module)
+{
+    module.doc() = "The ValuaScript simulation engine, in process.";
+    py::register_exception<EngineException>(module, "EngineError", PyExc_RuntimeError);
+
+    py::class_<Plan>(module, "Plan", "A compiled recipe; runs may share it from any number of threads.")
+        .def_property_readonly("output_names", [](const Plan &plan)
+                               { return plan.plan->output_names(); })
+        .def_property_readonly("seed", [](const Plan &plan)
+                               { return plan.plan->engine().get_seed(); })
+        .def_property_readonly("num_trials", [](const Plan &plan)
+                               { return plan.plan->engine().get_num_trials(); })
+        .def("run", &run_plan, py::arg("seed") = py::none(), py::arg("trials") = py::none(), py::arg("outputs") = py::none(), py::arg("threads") = 0, py::arg("chunk_size") = 0,
+             "Runs the plan and returns {output name: numpy array}: one value per trial for scalar and boolean outputs, "
+             "one row per trial for vector outputs. Unset arguments keep the recipe's.");
+
+    module.def("compile", &compile, py::arg("recipe"), py::arg("log") = py::none(),
+               "Compiles a recipe: the linker's dict, JSON text, or the bytes of a binary recipe. "
+               "`log(level, message)` receives the engine's messages; they are dropped without it.");
+    module.def("preview", &preview, py::arg("recipe"), py::arg("max_trials") = PreviewOptions().max_trials,
+               "The preview of a recipe's first output, as `vse --preview` prints it.");
+}
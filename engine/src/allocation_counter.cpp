@@ -0,0 +1,46 @@
+#include "include/engine/core/Profiler.h"
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete to count heap allocations for --profile. Linked
+// into the vse executable only, never into engine_core, so hosts embedding the engine keep their
+// own allocator and pay nothing for it.
+namespace
+{
+    [[maybe_unused]] const bool g_registered = (enable_allocation_counting(), true);
+
+    void *allocate(std::size_t size)
+    {
+        record_allocation();
+        if (size == 0)
+            size = 1;
+        for (;;)
+        {
+            if (void *memory = std::malloc(size))
+                return memory;
+            const std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+}
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::size_t) noexcept { std::free(memory); }
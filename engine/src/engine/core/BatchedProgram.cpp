@@ -0,0 +1,887 @@
+#include "include/engine/core/BatchedProgram.h"
+#include "include/engine/core/FusedExpression.h"
+#include "include/engine/core/Profiler.h"
+#include "include/engine/core/Random.h"
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace
+{
+    // Most instructions a predicated branch may run on lanes that do not take it; a fused
+    // call counts one per operation.
+    constexpr uint32_t PREDICATION_BUDGET = 8;
+    constexpr uint32_t NOT_CHEAP = UINT32_MAX;
+
+    bool is_lane_type(const TrialValue &value)
+    {
+        return std::holds_alternative<double>(value) || std::holds_alternative<bool>(value);
+    }
+
+    double lane_scalar(const TrialValue &value)
+    {
+        if (const bool *b = std::get_if<bool>(&value))
+        {
+            return *b ? 1.0 : 0.0;
+        }
+        return std::get<double>(value);
+    }
+}
+
+BatchedProgram::BatchedProgram(const BytecodeProgram &program, size_t lane_width)
+    : m_program(&program), m_lane_width(lane_width) {}
+
+std::unique_ptr<BatchedProgram> BatchedProgram::compile(const BytecodeProgram &program, const TrialContext &preloaded_context, size_t output_index, size_t lane_width)
+{
+    return compile(program, preloaded_context, std::vector<size_t>{output_index}, lane_width);
+}
+
+std::unique_ptr<BatchedProgram> BatchedProgram::compile(const BytecodeProgram &program, const TrialContext &preloaded_context, const std::vector<size_t> &output_indices, size_t lane_width,
+                                                        const DeviceBackend *device, const CostCheck &is_cheap)
+{
+    if (lane_width == 0 || output_indices.empty() ||
+        std::any_of(output_indices.begin(), output_indices.end(), [&](size_t index)
+                    { return index >= preloaded_context.size(); }))
+    {
+        return nullptr;
+    }
+
+    const auto &code = program.code();
+    const auto &operands = program.operands();
+    const auto &constants = program.constants();
+    const auto &callables = program.callables();
+    const auto &sites = program.sites();
+
+    using Typed = std::pair<LaneValue, LaneType>;
+    std::unique_ptr<BatchedProgram> batched(new BatchedProgram(program, lane_width));
+
+    for (const Instruction &ins : code)
+    {
+        if (ins.code == OpCode::RUN_STEP)
+        {
+            return nullptr;
+        }
+    }
+
+    std::vector<std::optional<Typed>> slots(preloaded_context.size());
+    std::vector<std::optional<Typed>> registers(program.register_count());
+    std::vector<std::optional<Typed>> constant_values(constants.size());
+
+    auto make_uniform = [&](const TrialValue &value) -> std::optional<Typed>
+    {
+        if (!is_lane_type(value))
+        {
+            return std::nullopt;
+        }
+        batched->m_uniforms.push_back(lane_scalar(value));
+        const LaneType type = std::holds_alternative<bool>(value) ? LaneType::Bool : LaneType::Scalar;
+        return Typed{LaneValue{true, static_cast<uint32_t>(batched->m_uniforms.size() - 1)}, type};
+    };
+
+    auto read = [&](const Operand &op) -> std::optional<Typed>
+    {
+        switch (op.space)
+        {
+        case OperandSpace::Constant:
+            if (!constant_values[op.index])
+            {
+                constant_values[op.index] = make_uniform(constants[op.index]);
+            }
+            return constant_values[op.index];
+        case OperandSpace::Invariant:
+            if (!slots[op.index])
+            {
+                slots[op.index] = make_uniform(preloaded_context[op.index]);
+            }
+            return slots[op.index];
+        case OperandSpace::Slot:
+            // A written slot read before its first assignment would observe the
+            // pre-trial value; leave such programs to the scalar interpreter.
+            return slots[op.index];
+        case OperandSpace::Register:
+            return registers[op.index];
+        }
+        return std::nullopt;
+    };
+
+    // Both branches of a conditional assign the same destination, so a second write must
+    // reuse the block (and type) of the first.
+    auto write = [&](const Operand &op, LaneType type) -> std::optional<LaneValue>
+    {
+        auto &entry = op.space == OperandSpace::Slot ? slots[op.index] : registers[op.index];
+        if (entry)
+        {
+            if (entry->first.uniform || entry->second != type)
+            {
+                return std::nullopt;
+            }
+            return entry->first;
+        }
+        entry = Typed{LaneValue{false, static_cast<uint32_t>(batched->m_num_varying++)}, type};
+        return entry->first;
+    };
+
+    // Per lowered instruction: its cost on lanes that do not need it, and whether it assigns a slot.
+    std::vector<uint32_t> costs;
+    std::vector<bool> writes_slot;
+
+    size_t depth = 0;
+    std::vector<uint32_t> open_branches;
+    for (uint32_t pc = 0; pc < code.size(); ++pc)
+    {
+        while (!open_branches.empty() && open_branches.back() == pc)
+        {
+            open_branches.pop_back();
+        }
+
+        const Instruction &ins = code[pc];
+        const Operand *args = operands.data() + ins.first_operand;
+        LaneInstruction lowered{};
+        lowered.first_arg = static_cast<uint32_t>(batched->m_args.size());
+        lowered.num_args = ins.num_args;
+        lowered.target = ins.target;
+        lowered.site = ins.site;
+
+        if (ins.num_results > 1 && ins.code != OpCode::IDENTITY)
+        {
+            // A call with several results runs batched only when all its arguments are
+            // trial-invariant; they are passed whole, so they may be series.
+            MultiCall call;
+            for (uint32_t a = 0; a < ins.num_args; ++a)
+            {
+                if (args[a].space == OperandSpace::Constant)
+                    call.args.push_back(constants[args[a].index]);
+                else if (args[a].space == OperandSpace::Invariant)
+                    call.args.push_back(preloaded_context[args[a].index]);
+                else
+                    return nullptr;
+            }
+            for (const TrialValue &value : call.args)
+                call.arg_refs.push_back(&value);
+            const IExecutable *logic = callables[ins.target];
+            if (!logic->supports_lane_results(ArgumentSpan(call.arg_refs.data(), call.arg_refs.size()), ins.num_results))
+                return nullptr;
+            bool assigns_slot = false;
+            for (uint32_t r = 0; r < ins.num_results; ++r)
+            {
+                const Operand &destination = args[ins.num_args + r];
+                std::optional<LaneValue> result = write(destination, LaneType::Scalar);
+                if (!result)
+                    return nullptr;
+                call.results.push_back(*result);
+                assigns_slot = assigns_slot || destination.space == OperandSpace::Slot;
+            }
+            lowered.kind = LaneInstruction::Kind::Multi;
+            lowered.logic = logic;
+            lowered.num_args = 0;
+            lowered.result = call.results[0];
+            lowered.target = static_cast<uint32_t>(batched->m_calls.size());
+            batched->m_max_results = std::max<size_t>(batched->m_max_results, ins.num_results);
+            batched->m_calls.push_back(std::move(call));
+            batched->m_code.push_back(lowered);
+            costs.push_back(NOT_CHEAP);
+            writes_slot.push_back(assigns_slot);
+            continue;
+        }
+
+        std::vector<LaneType> arg_types;
+        for (uint32_t a = 0; a < ins.num_args; ++a)
+        {
+            std::optional<Typed> value = read(args[a]);
+            if (!value)
+            {
+                return nullptr;
+            }
+            batched->m_args.push_back(value->first);
+            arg_types.push_back(value->second);
+        }
+
+        if (ins.code == OpCode::JUMP)
+        {
+            lowered.kind = LaneInstruction::Kind::Jump;
+            batched->m_code.push_back(lowered);
+            costs.push_back(NOT_CHEAP);
+            writes_slot.push_back(false);
+            continue;
+        }
+        if (ins.code == OpCode::JUMP_IF_FALSE)
+        {
+            if (arg_types.size() != 1 || arg_types[0] != LaneType::Bool)
+            {
+                return nullptr;
+            }
+            // Layout emitted by the lowering: [then ..., JUMP end] [else ...] end.
+            const uint32_t end = code[ins.target - 1].target;
+            open_branches.push_back(end);
+            depth = std::max(depth, open_branches.size());
+            lowered.kind = LaneInstruction::Kind::Branch;
+            batched->m_code.push_back(lowered);
+            costs.push_back(NOT_CHEAP);
+            writes_slot.push_back(false);
+            continue;
+        }
+
+        if (ins.num_results != 1 || ins.num_args == 0)
+        {
+            return nullptr;
+        }
+
+        LaneType result_type = LaneType::Scalar;
+        uint32_t cost = 0;
+        auto all_args = [&](LaneType type)
+        {
+            return std::all_of(arg_types.begin(), arg_types.end(), [type](LaneType t)
+                               { return t == type; });
+        };
+
+        if (ins.code == OpCode::IDENTITY && ins.num_args == 1)
+        {
+            // Register moves and calls to 'identity' both copy their argument.
+            lowered.kind = LaneInstruction::Kind::Move;
+            result_type = arg_types[0];
+        }
+        else
+        {
+            const IExecutable *logic = callables[ins.target];
+            if (!logic->supports_lanes(ins.num_args))
+            {
+                return nullptr;
+            }
+            switch (ins.code)
+            {
+            case OpCode::EQ:
+            case OpCode::NEQ:
+                if (!all_args(LaneType::Scalar) && !all_args(LaneType::Bool))
+                {
+                    return nullptr;
+                }
+                result_type = LaneType::Bool;
+                break;
+            case OpCode::GT:
+            case OpCode::LT:
+            case OpCode::GTE:
+            case OpCode::LTE:
+                if (!all_args(LaneType::Scalar))
+                {
+                    return nullptr;
+                }
+                result_type = LaneType::Bool;
+                break;
+            case OpCode::AND:
+            case OpCode::OR:
+            case OpCode::NOT:
+                if (!all_args(LaneType::Bool))
+                {
+                    return nullptr;
+                }
+                result_type = LaneType::Bool;
+                break;
+            case OpCode::FUSED:
+                if (!all_args(LaneType::Scalar))
+                {
+                    return nullptr;
+                }
+                result_type = static_cast<const FusedExpression *>(logic)->returns_bool() ? LaneType::Bool : LaneType::Scalar;
+                break;
+            default:
+                if (!all_args(LaneType::Scalar))
+                {
+                    return nullptr;
+                }
+                break;
+            }
+            lowered.kind = LaneInstruction::Kind::Kernel;
+            lowered.logic = logic;
+
+            cost = NOT_CHEAP;
+            if (is_cheap && ins.code == OpCode::FUSED)
+            {
+                const auto *fused = static_cast<const FusedExpression *>(logic);
+                if (fused->calls_only(is_cheap))
+                    cost = static_cast<uint32_t>(fused->num_operations());
+            }
+            else if (is_cheap && ins.site < sites.size() && is_cheap(sites[ins.site].function_name))
+            {
+                cost = 1;
+            }
+        }
+
+        std::optional<LaneValue> result = write(args[ins.num_args], result_type);
+        if (!result)
+        {
+            return nullptr;
+        }
+        lowered.result = *result;
+        batched->m_max_args = std::max<size_t>(batched->m_max_args, ins.num_args);
+        batched->m_code.push_back(lowered);
+        costs.push_back(cost);
+        writes_slot.push_back(args[ins.num_args].space == OperandSpace::Slot);
+    }
+
+    for (size_t output_index : output_indices)
+    {
+        const OperandSpace output_space = program.is_invariant_slot(output_index) ? OperandSpace::Invariant : OperandSpace::Slot;
+        std::optional<Typed> output = read(Operand{output_space, static_cast<uint32_t>(output_index)});
+        if (!output)
+        {
+            return nullptr;
+        }
+        batched->m_outputs.push_back(*output);
+    }
+    batched->m_max_depth = depth;
+    if (is_cheap)
+    {
+        batched->predicate(costs, writes_slot);
+    }
+    if (device)
+    {
+        batched->offload(*device);
+    }
+    return batched;
+}
+
+// An arm of a conditional is predicated when it is a straight run of cheap calls and moves
+// within PREDICATION_BUDGET, and the value it assigns last is the only slot it writes. That
+// last instruction is redirected to a block of its own, so that running the arm on every lane
+// leaves the destination alone until the branch blends the value in.
+void BatchedProgram::predicate(const std::vector<uint32_t> &costs, const std::vector<bool> &writes_slot)
+{
+    for (uint32_t pc = 0; pc < m_code.size(); ++pc)
+    {
+        LaneInstruction &branch = m_code[pc];
+        // A uniform condition runs one arm unchanged.
+        if (branch.kind != LaneInstruction::Kind::Branch || m_args[branch.first_arg].uniform)
+            continue;
+
+        const uint32_t then_end = branch.target - 1;
+        const uint32_t else_end = m_code[then_end].target;
+        const LaneValue destination = m_code[then_end - 1].result;
+        auto is_cheap_arm = [&](uint32_t begin, uint32_t end)
+        {
+            const LaneValue &value = m_code[end - 1].result;
+            if (begin == end || value.uniform || value.index != destination.index)
+                return false;
+            uint32_t cost = 0;
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                if (costs[i] == NOT_CHEAP || (writes_slot[i] && i + 1 != end))
+                    return false;
+                cost += costs[i];
+            }
+            return cost <= PREDICATION_BUDGET;
+        };
+
+        uint8_t arms = 0;
+        LaneValue values[2] = {destination, destination};
+        const uint32_t arm_ends[2] = {then_end, else_end};
+        if (is_cheap_arm(pc + 1, then_end))
+            arms |= LaneInstruction::THEN_ARM;
+        if (is_cheap_arm(branch.target, else_end))
+            arms |= LaneInstruction::ELSE_ARM;
+        for (int arm = 0; arm < 2; ++arm)
+        {
+            if (arms & (1 << arm))
+            {
+                values[arm] = LaneValue{false, static_cast<uint32_t>(m_num_varying++)};
+                m_code[arm_ends[arm] - 1].result = values[arm];
+                ++m_predicated_branches;
+            }
+        }
+        if (arms == 0)
+            continue;
+
+        const LaneValue condition = m_args[branch.first_arg];
+        branch.first_arg = static_cast<uint32_t>(m_args.size());
+        branch.num_args = 3;
+        m_args.push_back(condition);
+        m_args.push_back(values[0]);
+        m_args.push_back(values[1]);
+        branch.result = destination;
+        branch.predicated = arms;
+    }
+}
+
+void BatchedProgram::offload(const DeviceBackend &device)
+{
+    constexpr uint32_t NONE = UINT32_MAX;
+    const size_t size = m_code.size();
+
+    // One past the last instruction reading each block; a segment copies back the blocks it
+    // writes that are read after it.
+    std::vector<size_t> read_until(m_num_varying, 0);
+    for (size_t pc = 0; pc < size; ++pc)
+    {
+        const LaneInstruction &ins = m_code[pc];
+        for (uint32_t a = 0; a < ins.num_args; ++a)
+        {
+            const LaneValue &arg = m_args[ins.first_arg + a];
+            if (!arg.uniform)
+                read_until[arg.index] = pc + 1;
+        }
+    }
+    for (const auto &output : m_outputs)
+    {
+        if (!output.first.uniform)
+            read_until[output.first.index] = SIZE_MAX;
+    }
+
+    std::vector<LaneInstruction> code;
+    std::vector<uint32_t> entry(size + 1); // Where the code that ran old instruction pc starts.
+    auto keep = [&](size_t pc)
+    {
+        entry[pc] = static_cast<uint32_t>(code.size());
+        code.push_back(m_code[pc]);
+    };
+
+    size_t pc = 0;
+    while (pc < size)
+    {
+        DeviceProgram program;
+        program.constants = m_uniforms;
+        DeviceLowering lowering(program);
+        DeviceSegment segment;
+        std::vector<uint32_t> registers(m_num_varying, NONE);
+        std::vector<bool> written(m_num_varying, false);
+        std::vector<uint32_t> assigned; // Blocks given a register by the current instruction.
+        auto register_of = [&](uint32_t index)
+        {
+            if (registers[index] == NONE)
+            {
+                registers[index] = lowering.temporary();
+                assigned.push_back(index);
+            }
+            return registers[index];
+        };
+
+        size_t end = pc;
+        std::vector<uint32_t> operands;
+        std::vector<uint32_t> wrote; // Blocks first written by the current instruction.
+        auto lower = [&](const LaneInstruction &ins)
+        {
+            operands.clear();
+            for (uint32_t a = 0; a < ins.num_args; ++a)
+            {
+                const LaneValue &arg = m_args[ins.first_arg + a];
+                if (arg.uniform)
+                {
+                    operands.push_back(DEVICE_CONSTANT | arg.index);
+                    continue;
+                }
+                if (registers[arg.index] == NONE && !written[arg.index])
+                {
+                    program.inputs.push_back(register_of(arg.index));
+                    segment.inputs.push_back(arg.index);
+                }
+                operands.push_back(register_of(arg.index));
+            }
+            const uint32_t result = register_of(ins.result.index);
+            bool lowered = true;
+            if (ins.kind == LaneInstruction::Kind::Move)
+                lowering.emit(DeviceOp::Move, operands.data(), operands.size(), result);
+            else if (ins.kind == LaneInstruction::Kind::Kernel)
+                lowered = ins.logic->lower_to_device(lowering, operands.data(), operands.size(), result);
+            else if (ins.kind == LaneInstruction::Kind::Branch && ins.predicated == (LaneInstruction::THEN_ARM | LaneInstruction::ELSE_ARM))
+                lowering.emit(DeviceOp::Select, operands.data(), operands.size(), result);
+            else
+                lowered = false;
+            if (lowered && !written[ins.result.index])
+            {
+                written[ins.result.index] = true;
+                wrote.push_back(ins.result.index);
+            }
+            return lowered;
+        };
+        while (end < size)
+        {
+            const LaneInstruction &ins = m_code[end];
+            const size_t code_size = program.code.size();
+            const size_t operands_size = program.operands.size();
+            const size_t inputs_size = program.inputs.size();
+            assigned.clear();
+            wrote.clear();
+            size_t next = end + 1;
+            bool lowered = true;
+            if (ins.kind == LaneInstruction::Kind::Branch && ins.predicated == (LaneInstruction::THEN_ARM | LaneInstruction::ELSE_ARM))
+            {
+                // Both arms run on every lane, so the device runs them too and selects.
+                const size_t then_end = ins.target - 1;
+                next = m_code[then_end].target;
+                for (size_t arm = end + 1; lowered && arm < next; ++arm)
+                {
+                    if (arm != then_end)
+                        lowered = lower(m_code[arm]);
+                }
+            }
+            if (!lowered || !lower(ins))
+            {
+                program.code.resize(code_size);
+                program.operands.resize(operands_size);
+                program.inputs.resize(inputs_size);
+                segment.inputs.resize(inputs_size);
+                for (uint32_t index : assigned)
+                    registers[index] = NONE;
+                for (uint32_t index : wrote)
+                    written[index] = false;
+                break;
+            }
+            end = next;
+        }
+        if (end == pc && m_code[pc].kind == LaneInstruction::Kind::Branch)
+        {
+            // Conditionals that split the lanes stay on the host.
+            const size_t branch_end = m_code[m_code[pc].target - 1].target;
+            for (; pc < branch_end; ++pc)
+                keep(pc);
+            continue;
+        }
+        if (end == pc)
+        {
+            keep(pc++);
+            continue;
+        }
+
+        for (uint32_t index = 0; index < m_num_varying; ++index)
+        {
+            if (written[index] && read_until[index] > end)
+            {
+                program.outputs.push_back(registers[index]);
+                segment.outputs.push_back(index);
+            }
+        }
+        m_max_device_blocks = std::max({m_max_device_blocks, segment.inputs.size(), segment.outputs.size()});
+        m_device_instructions += end - pc;
+        segment.kernel = device.prepare(program);
+
+        LaneInstruction run{};
+        run.kind = LaneInstruction::Kind::Device;
+        run.first_arg = static_cast<uint32_t>(m_segments.size());
+        run.target = static_cast<uint32_t>(end);
+        run.site = m_code[pc].site;
+        m_segments.push_back(std::move(segment));
+        entry[pc] = static_cast<uint32_t>(code.size());
+        code.push_back(run);
+        for (size_t host = pc; host < end; ++host)
+        {
+            if (host != pc)
+                entry[host] = static_cast<uint32_t>(code.size());
+            code.push_back(m_code[host]);
+        }
+        pc = end;
+    }
+    entry[size] = static_cast<uint32_t>(code.size());
+
+    for (LaneInstruction &ins : code)
+    {
+        if (ins.kind == LaneInstruction::Kind::Branch || ins.kind == LaneInstruction::Kind::Jump || ins.kind == LaneInstruction::Kind::Device)
+            ins.target = entry[ins.target];
+    }
+    m_code = std::move(code);
+}
+
+BatchedFrame BatchedProgram::make_frame() const
+{
+    BatchedFrame frame;
+    frame.lanes.assign(m_num_varying * m_lane_width, 0.0);
+    frame.scratch.assign(std::max(m_max_args + 1, m_max_results) * m_lane_width, 0.0);
+    frame.call_args.resize(m_max_args);
+    frame.call_results.resize(m_max_results);
+    frame.device_inputs.resize(m_max_device_blocks);
+    frame.device_outputs.resize(m_max_device_blocks);
+    frame.selections.resize(2 * m_max_depth);
+    for (auto &selection : frame.selections)
+    {
+        selection.reserve(m_lane_width);
+    }
+    return frame;
+}
+
+void BatchedProgram::execute(size_t lanes, BatchedFrame &frame, TrialValue *results, size_t column_stride) const
+{
+    run_range(0, m_code.size(), nullptr, lanes, 0, frame);
+    if (frame.profile)
+        frame.profile->stop();
+
+    for (size_t k = 0; k < m_outputs.size(); ++k)
+    {
+        const LaneValue &output = m_outputs[k].first;
+        const double *values = output.uniform ? &m_uniforms[output.index] : block(frame, output.index);
+        const size_t stride = output.uniform ? 0 : 1;
+        TrialValue *column = results + k * column_stride;
+        if (m_outputs[k].second == LaneType::Bool)
+        {
+            for (size_t i = 0; i < lanes; ++i)
+            {
+                column[i] = values[i * stride] != 0.0;
+            }
+            continue;
+        }
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            column[i] = values[i * stride];
+        }
+    }
+}
+
+// `selection` lists the active lanes, or is null when the first `count` lanes are all active.
+void BatchedProgram::run_range(size_t begin, size_t end, const uint32_t *selection, size_t count, size_t depth, BatchedFrame &frame) const
+{
+    StepProfile *const profile = frame.profile;
+    size_t pc = begin;
+    while (pc < end)
+    {
+        const LaneInstruction &ins = m_code[pc];
+        if (profile)
+            profile->enter(ins.site);
+        switch (ins.kind)
+        {
+        case LaneInstruction::Kind::Kernel:
+            run_kernel(ins, selection, count, frame);
+            break;
+        case LaneInstruction::Kind::Move:
+            run_move(ins, selection, count, frame);
+            break;
+        case LaneInstruction::Kind::Multi:
+            run_multi(ins, selection, count, frame);
+            break;
+        case LaneInstruction::Kind::Jump:
+            pc = ins.target;
+            continue;
+        case LaneInstruction::Kind::Device:
+            if (run_device(m_segments[ins.first_arg], count, frame))
+            {
+                pc = ins.target;
+                continue;
+            }
+            break; // Its host instructions follow it.
+        case LaneInstruction::Kind::Branch:
+        {
+            const size_t then_begin = pc + 1;
+            const size_t else_begin = ins.target;
+            const size_t then_end = else_begin - 1;
+            const size_t branch_end = m_code[then_end].target;
+            const LaneValue &condition = m_args[ins.first_arg];
+            if (condition.uniform)
+            {
+                if (m_uniforms[condition.index] != 0.0)
+                    run_range(then_begin, then_end, selection, count, depth, frame);
+                else
+                    run_range(else_begin, branch_end, selection, count, depth, frame);
+            }
+            else if (ins.predicated)
+            {
+                run_predicated(ins, pc, selection, count, depth, frame);
+            }
+            else
+            {
+                const double *mask = block(frame, condition.index);
+                auto &taken = frame.selections[2 * depth];
+                auto &not_taken = frame.selections[2 * depth + 1];
+                taken.clear();
+                not_taken.clear();
+                for (size_t j = 0; j < count; ++j)
+                {
+                    const uint32_t lane = selection ? selection[j] : static_cast<uint32_t>(j);
+                    (mask[lane] != 0.0 ? taken : not_taken).push_back(lane);
+                }
+                if (!taken.empty())
+                    run_range(then_begin, then_end, taken.data(), taken.size(), depth + 1, frame);
+                if (!not_taken.empty())
+                    run_range(else_begin, branch_end, not_taken.data(), not_taken.size(), depth + 1, frame);
+            }
+            pc = branch_end;
+            continue;
+        }
+        }
+        ++pc;
+    }
+}
+
+// Runs the predicated arms of a branch on every active lane and the other arm, if any, on the
+// lanes that take it, then selects each lane's value by the condition. The value of an arm
+// that is not predicated is already in the destination.
+void BatchedProgram::run_predicated(const LaneInstruction &ins, size_t pc, const uint32_t *selection, size_t count, size_t depth, BatchedFrame &frame) const
+{
+    const size_t then_begin = pc + 1;
+    const size_t else_begin = ins.target;
+    const size_t then_end = else_begin - 1;
+    const size_t branch_end = m_code[then_end].target;
+    const LaneValue *args = &m_args[ins.first_arg];
+    const double *mask = block(frame, args[0].index);
+
+    if (ins.predicated & LaneInstruction::THEN_ARM)
+        run_range(then_begin, then_end, selection, count, depth, frame);
+    if (ins.predicated & LaneInstruction::ELSE_ARM)
+        run_range(else_begin, branch_end, selection, count, depth, frame);
+    if (ins.predicated != (LaneInstruction::THEN_ARM | LaneInstruction::ELSE_ARM))
+    {
+        const bool then_taken = !(ins.predicated & LaneInstruction::THEN_ARM);
+        auto &taken = frame.selections[2 * depth];
+        taken.clear();
+        for (size_t j = 0; j < count; ++j)
+        {
+            const uint32_t lane = selection ? selection[j] : static_cast<uint32_t>(j);
+            if ((mask[lane] != 0.0) == then_taken)
+                taken.push_back(lane);
+        }
+        if (!taken.empty())
+        {
+            if (then_taken)
+                run_range(then_begin, then_end, taken.data(), taken.size(), depth + 1, frame);
+            else
+                run_range(else_begin, branch_end, taken.data(), taken.size(), depth + 1, frame);
+        }
+    }
+
+    double *result = block(frame, ins.result.index);
+    const double *then_values = block(frame, args[1].index);
+    const double *else_values = block(frame, args[2].index);
+    if (!selection)
+    {
+        for (size_t lane = 0; lane < count; ++lane)
+            result[lane] = mask[lane] != 0.0 ? then_values[lane] : else_values[lane];
+        return;
+    }
+    for (size_t j = 0; j < count; ++j)
+    {
+        const uint32_t lane = selection[j];
+        result[lane] = mask[lane] != 0.0 ? then_values[lane] : else_values[lane];
+    }
+}
+
+bool BatchedProgram::run_device(const DeviceSegment &segment, size_t lanes, BatchedFrame &frame) const
+{
+    const TrialRandomState &random = thread_random_state();
+    if (!random.active || random.design)
+    {
+        return false;
+    }
+    for (size_t k = 0; k < segment.inputs.size(); ++k)
+    {
+        frame.device_inputs[k] = block(frame, segment.inputs[k]);
+    }
+    for (size_t k = 0; k < segment.outputs.size(); ++k)
+    {
+        frame.device_outputs[k] = block(frame, segment.outputs[k]);
+    }
+    return segment.kernel->run(DeviceLaunch{random.seed, random.first_trial, lanes}, frame.device_inputs.data(), frame.device_outputs.data());
+}
+
+void BatchedProgram::run_kernel(const LaneInstruction &ins, const uint32_t *selection, size_t count, BatchedFrame &frame) const
+{
+    LaneArgument *call_args = frame.call_args.data();
+    double *result = block(frame, ins.result.index);
+    double *out = result;
+    for (uint32_t a = 0; a < ins.num_args; ++a)
+    {
+        const LaneValue &arg = m_args[ins.first_arg + a];
+        if (arg.uniform)
+        {
+            call_args[a] = LaneArgument{&m_uniforms[arg.index], 0};
+        }
+        else if (!selection)
+        {
+            call_args[a] = LaneArgument{block(frame, arg.index), 1};
+        }
+        else
+        {
+            // Gather the active lanes so kernels only ever see contiguous input.
+            double *dense = frame.scratch.data() + a * m_lane_width;
+            const double *source = block(frame, arg.index);
+            for (size_t j = 0; j < count; ++j)
+            {
+                dense[j] = source[selection[j]];
+            }
+            call_args[a] = LaneArgument{dense, 1};
+        }
+    }
+    if (selection)
+    {
+        out = frame.scratch.data() + m_max_args * m_lane_width;
+    }
+
+    // Samplers key their draws by trial, so they need to know which trial each dense lane is.
+    TrialRandomState &random = thread_random_state();
+    const uint32_t *saved_offsets = random.lane_offsets;
+    random.lane_offsets = selection;
+    try
+    {
+        ins.logic->execute_lanes(call_args, ins.num_args, out, count);
+    }
+    catch (...)
+    {
+        random.lane_offsets = saved_offsets;
+        m_program->rethrow_with_context(ins.site);
+    }
+    random.lane_offsets = saved_offsets;
+
+    if (selection)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            result[selection[j]] = out[j];
+        }
+    }
+}
+
+void BatchedProgram::run_multi(const LaneInstruction &ins, const uint32_t *selection, size_t count, BatchedFrame &frame) const
+{
+    const MultiCall &call = m_calls[ins.target];
+    const size_t num_results = call.results.size();
+    double **out = frame.call_results.data();
+    for (size_t r = 0; r < num_results; ++r)
+    {
+        out[r] = selection ? frame.scratch.data() + r * m_lane_width : block(frame, call.results[r].index);
+    }
+
+    TrialRandomState &random = thread_random_state();
+    const uint32_t *saved_offsets = random.lane_offsets;
+    random.lane_offsets = selection;
+    try
+    {
+        ins.logic->execute_lanes_into(ArgumentSpan(call.arg_refs.data(), call.arg_refs.size()), out, num_results, count);
+    }
+    catch (...)
+    {
+        random.lane_offsets = saved_offsets;
+        m_program->rethrow_with_context(ins.site);
+    }
+    random.lane_offsets = saved_offsets;
+
+    if (selection)
+    {
+        for (size_t r = 0; r < num_results; ++r)
+        {
+            double *result = block(frame, call.results[r].index);
+            for (size_t j = 0; j < count; ++j)
+            {
+                result[selection[j]] = out[r][j];
+            }
+        }
+    }
+}
+
+void BatchedProgram::run_move(const LaneInstruction &ins, const uint32_t *selection, size_t count, BatchedFrame &frame) const
+{
+    const LaneValue &source = m_args[ins.first_arg];
+    double *result = block(frame, ins.result.index);
+    if (source.uniform)
+    {
+        const double value = m_uniforms[source.index];
+        for (size_t j = 0; j < count; ++j)
+        {
+            result[selection ? selection[j] : j] = value;
+        }
+        return;
+    }
+    const double *values = block(frame, source.index);
+    if (!selection)
+    {
+        std::copy(values, values + count, result);
+        return;
+    }
+    for (size_t j = 0; j < count; ++j)
+    {
+        result[selection[j]] = values[selection[j]];
+    }
+}
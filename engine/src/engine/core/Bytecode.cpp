@@ -0,0 +1,903 @@
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/EngineException.h"
+#include "include/engine/core/FusedExpression.h"
+#include "include/engine/core/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    constexpr uint32_t NO_TARGET = std::numeric_limits<uint32_t>::max();
+
+    // Base pointers of every operand space for one execution.
+    struct OperandSpaces
+    {
+        TrialValue *slots;
+        const TrialValue *invariants;
+        TrialValue *registers;
+        const TrialValue *constants;
+    };
+
+    const TrialValue &read_operand(const Operand &op, const OperandSpaces &spaces)
+    {
+        switch (op.space)
+        {
+        case OperandSpace::Slot:
+            return spaces.slots[op.index];
+        case OperandSpace::Invariant:
+            return spaces.invariants[op.index];
+        case OperandSpace::Constant:
+            return spaces.constants[op.index];
+        case OperandSpace::Register:
+        default:
+            return spaces.registers[op.index];
+        }
+    }
+
+    TrialValue &write_operand(const Operand &op, const OperandSpaces &spaces)
+    {
+        return op.space == OperandSpace::Slot ? spaces.slots[op.index] : spaces.registers[op.index];
+    }
+
+    // The alternative of a value whose type is already known, from a check just made or from a
+    // plan-time proof (Instruction::typed): no second check, no throwing path.
+    template <typename T>
+    const T &known(const TrialValue &value)
+    {
+        const T *alternative = std::get_if<T>(&value);
+#if defined(_MSC_VER) && !defined(__clang__)
+        __assume(alternative != nullptr);
+#else
+        if (!alternative)
+            __builtin_unreachable();
+#endif
+        return *alternative;
+    }
+
+    const char *type_name(ValueType type)
+    {
+        switch (type)
+        {
+        case ValueType::Scalar:
+            return "scalar";
+        case ValueType::Series:
+            return "vector";
+        case ValueType::String:
+            return "string";
+        case ValueType::Bool:
+            return "boolean";
+        case ValueType::Unknown:
+        default:
+            return "value";
+        }
+    }
+
+    // A value of the type, for registers that are read before any trial writes them.
+    TrialValue zero_of(ValueType type)
+    {
+        switch (type)
+        {
+        case ValueType::Series:
+            return std::vector<double>();
+        case ValueType::String:
+            return std::string();
+        case ValueType::Bool:
+            return false;
+        default:
+            return 0.0;
+        }
+    }
+
+    // Moves a call result into its destination. When both hold series the buffers are swapped,
+    // handing the destination's previous storage back to the frame for the next call.
+    void hand_over(TrialValue &result, TrialValue &destination)
+    {
+        auto *result_series = std::get_if<std::vector<double>>(&result);
+        auto *destination_series = std::get_if<std::vector<double>>(&destination);
+        if (result_series && destination_series)
+        {
+            result_series->swap(*destination_series);
+            return;
+        }
+        destination = std::move(result);
+    }
+}
+
+ValueType value_type_of(const TrialValue &value)
+{
+    return static_cast<ValueType>(value.index() + 1);
+}
+
+OpCode opcode_for_function(const std::string &function_name)
+{
+    static const std::unordered_map<std::string, OpCode> opcodes = {
+        {"add", OpCode::ADD},
+        {"multiply", OpCode::MULTIPLY},
+        {"subtract", OpCode::SUBTRACT},
+        {"divide", OpCode::DIVIDE},
+        {"power", OpCode::POWER},
+        {"log", OpCode::LOG},
+        {"log10", OpCode::LOG10},
+        {"exp", OpCode::EXP},
+        {"sin", OpCode::SIN},
+        {"cos", OpCode::COS},
+        {"tan", OpCode::TAN},
+        {"__eq__", OpCode::EQ},
+        {"__neq__", OpCode::NEQ},
+        {"__gt__", OpCode::GT},
+        {"__lt__", OpCode::LT},
+        {"__gte__", OpCode::GTE},
+        {"__lte__", OpCode::LTE},
+        {"__and__", OpCode::AND},
+        {"__or__", OpCode::OR},
+        {"__not__", OpCode::NOT},
+        {"grow_series", OpCode::GROW_SERIES},
+        {"npv", OpCode::NPV},
+        {"sum_series", OpCode::SUM_SERIES},
+        {"get_element", OpCode::GET_ELEMENT},
+        {"series_delta", OpCode::SERIES_DELTA},
+        {"compound_series", OpCode::COMPOUND_SERIES},
+        {"compose_vector", OpCode::COMPOSE_VECTOR},
+        {"interpolate_series", OpCode::INTERPOLATE_SERIES},
+        {"capitalize_expense", OpCode::CAPITALIZE_EXPENSE},
+        {"delete_element", OpCode::DELETE_ELEMENT},
+        {"identity", OpCode::IDENTITY},
+    };
+    auto it = opcodes.find(function_name);
+    return it == opcodes.end() ? OpCode::CALL : it->second;
+}
+
+// --- BytecodeBuilder ---
+
+BytecodeBuilder::BytecodeBuilder(size_t num_slots) : m_num_slots(num_slots) {}
+
+void BytecodeBuilder::add_step(const IExecutionStep &step)
+{
+    const size_t code_mark = m_program.m_code.size();
+    const size_t operand_mark = m_program.m_operands.size();
+    const size_t constant_mark = m_program.m_constants.size();
+    const size_t callable_mark = m_program.m_callables.size();
+    const size_t site_mark = m_program.m_sites.size();
+    const size_t register_mark = m_program.m_num_registers;
+
+    m_site_stack.clear();
+    if (step.lower(*this))
+    {
+        m_program.m_lowered_steps++;
+        return;
+    }
+
+    // Roll back whatever the step emitted before it gave up and keep the tree instead.
+    m_program.m_code.resize(code_mark);
+    m_program.m_operands.resize(operand_mark);
+    m_program.m_constants.resize(constant_mark);
+    m_program.m_callables.resize(callable_mark);
+    m_program.m_sites.resize(site_mark);
+    m_program.m_num_registers = register_mark;
+    m_site_stack.clear();
+
+    open_site(DebugSite::Kind::Step, "", -1);
+    emit(OpCode::RUN_STEP, {}, {}, static_cast<uint32_t>(m_program.m_fallback_steps.size()));
+    m_program.m_fallback_steps.push_back(&step);
+    close_site();
+}
+
+void BytecodeBuilder::set_slot_types(std::vector<ValueType> types, const TrialContext &initial_values)
+{
+    m_slot_types = std::move(types);
+    m_initial_values = &initial_values;
+}
+
+BytecodeProgram BytecodeBuilder::finish()
+{
+    m_program.classify_slots(m_num_slots);
+    if (!m_slot_types.empty())
+    {
+        m_program.bind_types(std::move(m_slot_types), *m_initial_values);
+    }
+    return std::move(m_program);
+}
+
+std::optional<Operand> BytecodeBuilder::slot(size_t index) const
+{
+    if (index >= m_num_slots)
+    {
+        return std::nullopt;
+    }
+    return Operand{OperandSpace::Slot, static_cast<uint32_t>(index)};
+}
+
+Operand BytecodeBuilder::constant(const TrialValue &value)
+{
+    m_program.m_constants.push_back(value);
+    return Operand{OperandSpace::Constant, static_cast<uint32_t>(m_program.m_constants.size() - 1)};
+}
+
+Operand BytecodeBuilder::new_register()
+{
+    return Operand{OperandSpace::Register, static_cast<uint32_t>(m_program.m_num_registers++)};
+}
+
+void BytecodeBuilder::open_site(DebugSite::Kind kind, const std::string &function_name, int line_num)
+{
+    const int32_t parent = m_site_stack.empty() ? -1 : m_site_stack.back();
+    m_program.m_sites.push_back(DebugSite{kind, function_name, line_num, parent});
+    m_site_stack.push_back(static_cast<int32_t>(m_program.m_sites.size() - 1));
+}
+
+void BytecodeBuilder::close_site()
+{
+    m_site_stack.pop_back();
+}
+
+uint32_t BytecodeBuilder::emit(OpCode code, const std::vector<Operand> &args, const std::vector<Operand> &results, uint32_t target)
+{
+    Instruction ins;
+    ins.code = code;
+    ins.first_operand = static_cast<uint32_t>(m_program.m_operands.size());
+    ins.num_args = static_cast<uint32_t>(args.size());
+    ins.num_results = static_cast<uint32_t>(results.size());
+    ins.target = target;
+    ins.site = static_cast<uint32_t>(m_site_stack.back());
+    // Writing straight into the destinations lets every slot and register keep (and reuse) its
+    // own series storage from trial to trial.
+    ins.direct_results = std::none_of(results.begin(), results.end(), [&](const Operand &result)
+                                      { return std::any_of(args.begin(), args.end(), [&](const Operand &arg)
+                                                           { return arg.space == result.space && arg.index == result.index; }); });
+    m_program.m_operands.insert(m_program.m_operands.end(), args.begin(), args.end());
+    m_program.m_operands.insert(m_program.m_operands.end(), results.begin(), results.end());
+    m_program.m_code.push_back(ins);
+    return static_cast<uint32_t>(m_program.m_code.size() - 1);
+}
+
+void BytecodeBuilder::emit_call(const IExecutable &logic, const std::string &function_name, const std::vector<Operand> &args, const std::vector<Operand> &results)
+{
+    emit_call(logic, opcode_for_function(function_name), args, results);
+}
+
+void BytecodeBuilder::emit_call(const IExecutable &logic, OpCode code, const std::vector<Operand> &args, const std::vector<Operand> &results)
+{
+    const uint32_t callable = static_cast<uint32_t>(m_program.m_callables.size());
+    m_program.m_callables.push_back(&logic);
+    emit(code, args, results, callable);
+}
+
+void BytecodeBuilder::emit_move(Operand source, Operand destination)
+{
+    emit(OpCode::IDENTITY, {source}, {destination}, NO_TARGET);
+}
+
+size_t BytecodeBuilder::emit_jump_if_false(Operand condition)
+{
+    return emit(OpCode::JUMP_IF_FALSE, {condition}, {}, NO_TARGET);
+}
+
+size_t BytecodeBuilder::emit_jump()
+{
+    return emit(OpCode::JUMP, {}, {}, NO_TARGET);
+}
+
+void BytecodeBuilder::patch_jump_to_here(size_t instruction_index)
+{
+    m_program.m_code[instruction_index].target = static_cast<uint32_t>(m_program.m_code.size());
+}
+
+// --- BytecodeProgram ---
+
+void BytecodeProgram::classify_slots(size_t num_slots)
+{
+    // Fallback steps read and write arbitrary slots of a complete context.
+    if (!m_fallback_steps.empty())
+    {
+        return;
+    }
+
+    m_written_slots.assign(num_slots, false);
+    for (const Instruction &ins : m_code)
+    {
+        for (uint32_t r = 0; r < ins.num_results; ++r)
+        {
+            const Operand &out = m_operands[ins.first_operand + ins.num_args + r];
+            if (out.space == OperandSpace::Slot)
+            {
+                m_written_slots[out.index] = true;
+            }
+        }
+    }
+
+    // A slot counts as assigned only once it is written outside every conditional branch;
+    // reads of slots that are not yet assigned must see the pre-trial value.
+    std::vector<bool> assigned(num_slots, false);
+    std::vector<bool> needs_reset(num_slots, false);
+    std::vector<uint32_t> open_branches;
+    for (uint32_t pc = 0; pc < m_code.size(); ++pc)
+    {
+        while (!open_branches.empty() && open_branches.back() == pc)
+        {
+            open_branches.pop_back();
+        }
+        const Instruction &ins = m_code[pc];
+        for (uint32_t a = 0; a < ins.num_args; ++a)
+        {
+            Operand &arg = m_operands[ins.first_operand + a];
+            if (arg.space != OperandSpace::Slot)
+            {
+                continue;
+            }
+            if (!m_written_slots[arg.index])
+            {
+                arg.space = OperandSpace::Invariant;
+            }
+            else if (!assigned[arg.index])
+            {
+                needs_reset[arg.index] = true;
+            }
+        }
+        if (ins.code == OpCode::JUMP_IF_FALSE)
+        {
+            // Layout emitted by the lowering: [then ..., JUMP end] [else ...] end.
+            open_branches.push_back(m_code[ins.target - 1].target);
+        }
+        for (uint32_t r = 0; r < ins.num_results && open_branches.empty(); ++r)
+        {
+            const Operand &out = m_operands[ins.first_operand + ins.num_args + r];
+            if (out.space == OperandSpace::Slot)
+            {
+                assigned[out.index] = true;
+            }
+        }
+    }
+    for (uint32_t index = 0; index < num_slots; ++index)
+    {
+        if (needs_reset[index])
+        {
+            m_reset_slots.push_back(index);
+        }
+    }
+}
+
+// Proves the types of operands from the declared slot types, so that the interpreter can skip
+// its variant checks. Register types are the join of every instruction writing the register,
+// found by iterating to a fixpoint; the binding follows the rules BatchedProgram::compile uses
+// to run calls in lanes.
+void BytecodeProgram::bind_types(std::vector<ValueType> slot_types, const TrialContext &initial_values)
+{
+    // Fallback steps write slots with values of any type.
+    if (!m_fallback_steps.empty())
+    {
+        return;
+    }
+    slot_types.resize(m_written_slots.size(), ValueType::Unknown);
+    for (size_t index = 0; index < slot_types.size(); ++index)
+    {
+        const bool starts_trial = !m_written_slots[index] || std::binary_search(m_reset_slots.begin(), m_reset_slots.end(), static_cast<uint32_t>(index));
+        if (starts_trial && (index >= initial_values.size() || value_type_of(initial_values[index]) != slot_types[index]))
+        {
+            slot_types[index] = ValueType::Unknown;
+        }
+    }
+    m_slot_types = std::move(slot_types);
+
+    std::vector<ValueType> &registers = m_register_types;
+    registers.assign(m_num_registers, ValueType::Unknown);
+    std::vector<bool> assigned(m_num_registers, false);
+    auto type_of = [&](const Operand &op)
+    {
+        switch (op.space)
+        {
+        case OperandSpace::Slot:
+        case OperandSpace::Invariant:
+            return m_slot_types[op.index];
+        case OperandSpace::Constant:
+            return value_type_of(m_constants[op.index]);
+        case OperandSpace::Register:
+        default:
+            return registers[op.index];
+        }
+    };
+    // Whether the instruction's fast path (or lanes form) applies to the current operand types,
+    // and the type of its result when it does.
+    auto infer = [&](const Instruction &ins, ValueType &result)
+    {
+        const Operand *args = m_operands.data() + ins.first_operand;
+        auto all_args = [&](ValueType type)
+        {
+            return std::all_of(args, args + ins.num_args, [&](const Operand &arg)
+                               { return type_of(arg) == type; });
+        };
+        const bool unary = ins.num_args == 1 && ins.num_results == 1;
+        switch (ins.code)
+        {
+        case OpCode::ADD:
+        case OpCode::SUBTRACT:
+        case OpCode::MULTIPLY:
+        case OpCode::DIVIDE:
+        case OpCode::POWER:
+            result = ValueType::Scalar;
+            return ins.num_args > 0 && ins.num_results == 1 && all_args(ValueType::Scalar);
+        case OpCode::LOG:
+        case OpCode::LOG10:
+        case OpCode::EXP:
+        case OpCode::SIN:
+        case OpCode::COS:
+        case OpCode::TAN:
+            result = ValueType::Scalar;
+            return unary && all_args(ValueType::Scalar);
+        case OpCode::EQ:
+        case OpCode::NEQ:
+        case OpCode::GT:
+        case OpCode::LT:
+        case OpCode::GTE:
+        case OpCode::LTE:
+            result = ValueType::Bool;
+            return ins.num_args == 2 && ins.num_results == 1 && all_args(ValueType::Scalar);
+        case OpCode::NOT:
+            result = ValueType::Bool;
+            return unary && all_args(ValueType::Bool);
+        case OpCode::IDENTITY:
+            result = unary ? type_of(args[0]) : ValueType::Unknown;
+            return unary && result != ValueType::Unknown;
+        case OpCode::JUMP_IF_FALSE:
+            return all_args(ValueType::Bool);
+        case OpCode::JUMP:
+        case OpCode::RUN_STEP:
+            return false;
+        default:
+            break;
+        }
+        if (ins.num_results != 1 || ins.num_args == 0 || !m_callables[ins.target]->supports_lanes(ins.num_args))
+        {
+            return false;
+        }
+        if (ins.code == OpCode::AND || ins.code == OpCode::OR)
+        {
+            result = ValueType::Bool;
+            return all_args(ValueType::Bool);
+        }
+        result = ins.code == OpCode::FUSED && static_cast<const FusedExpression *>(m_callables[ins.target])->returns_bool() ? ValueType::Bool : ValueType::Scalar;
+        return all_args(ValueType::Scalar);
+    };
+
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (const Instruction &ins : m_code)
+        {
+            ValueType result = ValueType::Unknown;
+            if (!infer(ins, result))
+            {
+                result = ValueType::Unknown;
+            }
+            for (uint32_t r = 0; r < ins.num_results; ++r)
+            {
+                const Operand &out = m_operands[ins.first_operand + ins.num_args + r];
+                if (out.space != OperandSpace::Register)
+                {
+                    continue;
+                }
+                const ValueType joined = !assigned[out.index] || registers[out.index] == result ? result : ValueType::Unknown;
+                changed = changed || !assigned[out.index] || registers[out.index] != joined;
+                assigned[out.index] = true;
+                registers[out.index] = joined;
+            }
+        }
+    }
+
+    for (Instruction &ins : m_code)
+    {
+        ValueType result = ValueType::Unknown;
+        ins.typed = infer(ins, result);
+        ins.result_type = ins.typed ? result : ValueType::Unknown;
+        for (uint32_t r = 0; r < ins.num_results; ++r)
+        {
+            const Operand &out = m_operands[ins.first_operand + ins.num_args + r];
+            const ValueType declared = out.space == OperandSpace::Slot ? m_slot_types[out.index] : ValueType::Unknown;
+            ins.checks_results = ins.checks_results || (declared != ValueType::Unknown && declared != ins.result_type);
+        }
+    }
+}
+
+size_t BytecodeProgram::typed_instruction_count() const
+{
+    return static_cast<size_t>(std::count_if(m_code.begin(), m_code.end(), [](const Instruction &ins)
+                                             { return ins.typed; }));
+}
+
+void BytecodeProgram::check_result_types(const Instruction &ins, const TrialValue *slots) const
+{
+    const Operand *outs = m_operands.data() + ins.first_operand + ins.num_args;
+    for (uint32_t r = 0; r < ins.num_results; ++r)
+    {
+        if (outs[r].space != OperandSpace::Slot || m_slot_types[outs[r].index] == ValueType::Unknown)
+        {
+            continue;
+        }
+        const ValueType actual = value_type_of(slots[outs[r].index]);
+        if (actual != m_slot_types[outs[r].index])
+        {
+            throw EngineException(EngineErrc::MismatchedArgumentType, std::string("The recipe declares variable ") + std::to_string(outs[r].index) + " a " +
+                                                                          type_name(m_slot_types[outs[r].index]) + ", but it was assigned a " + type_name(actual) + ".");
+        }
+    }
+}
+
+bool BytecodeProgram::is_invariant_slot(size_t index) const
+{
+    return index < m_written_slots.size() && !m_written_slots[index];
+}
+
+TrialContext BytecodeProgram::make_scratch(const TrialContext &invariants) const
+{
+    if (m_written_slots.empty())
+    {
+        return invariants;
+    }
+    TrialContext scratch(invariants.size());
+    for (size_t index = 0; index < scratch.size() && index < m_written_slots.size(); ++index)
+    {
+        if (m_written_slots[index])
+        {
+            scratch[index] = invariants[index];
+        }
+    }
+    return scratch;
+}
+
+void BytecodeProgram::begin_trial(const TrialContext &invariants, TrialContext &scratch) const
+{
+    if (m_written_slots.empty())
+    {
+        scratch = invariants;
+        return;
+    }
+    for (uint32_t index : m_reset_slots)
+    {
+        scratch[index] = invariants[index];
+    }
+}
+
+BytecodeFrame BytecodeProgram::make_frame() const
+{
+    BytecodeFrame frame;
+    frame.registers.resize(m_num_registers);
+    for (size_t index = 0; index < m_register_types.size(); ++index)
+    {
+        frame.registers[index] = zero_of(m_register_types[index]);
+    }
+    size_t max_args = 0;
+    size_t max_results = 0;
+    for (const Instruction &ins : m_code)
+    {
+        max_args = std::max<size_t>(max_args, ins.num_args);
+        max_results = std::max<size_t>(max_results, ins.num_results);
+    }
+    frame.call_args.resize(max_args);
+    frame.call_results.resize(max_results);
+    frame.result_refs.resize(max_results);
+    frame.lane_values.resize(max_args);
+    frame.lane_args.resize(max_args);
+    return frame;
+}
+
+void BytecodeProgram::rethrow_with_context(uint32_t site_index) const
+{
+    EngineErrc code = EngineErrc::UnknownError;
+    std::string message;
+    bool is_out_of_range = false;
+    try
+    {
+        throw;
+    }
+    catch (const EngineException &e)
+    {
+        code = e.code();
+        message = e.what();
+    }
+    catch (const std::out_of_range &e)
+    {
+        is_out_of_range = true;
+        message = e.what();
+    }
+    catch (const std::exception &e)
+    {
+        message = e.what();
+    }
+
+    const DebugSite *site = &m_sites[site_index];
+    if (site->kind == DebugSite::Kind::Step)
+    {
+        throw;
+    }
+
+    // Re-apply the prefix of every enclosing tree level, innermost first.
+    for (int32_t index = static_cast<int32_t>(site_index);;)
+    {
+        site = &m_sites[index];
+        std::string prefix;
+        switch (site->kind)
+        {
+        case DebugSite::Kind::Function:
+            if (is_out_of_range)
+            {
+                code = EngineErrc::IndexOutOfBounds;
+                message = "Variable index out of bounds.";
+            }
+            prefix = "In function '" + site->function_name + "': ";
+            break;
+        case DebugSite::Kind::NestedFunction:
+            prefix = "In nested function '" + site->function_name + "': ";
+            break;
+        case DebugSite::Kind::Conditional:
+            prefix = "In conditional expression: ";
+            break;
+        case DebugSite::Kind::NestedConditional:
+            prefix = "In nested conditional expression: ";
+            break;
+        case DebugSite::Kind::Step:
+            break;
+        }
+        is_out_of_range = false;
+        if (site->parent < 0)
+        {
+            throw EngineException(code, prefix + message, site->line_num);
+        }
+        message = EngineException(code, prefix + message, site->line_num).what();
+        index = site->parent;
+    }
+}
+
+void BytecodeProgram::execute(const TrialContext &invariants, TrialContext &scratch, BytecodeFrame &frame) const
+{
+    const OperandSpaces spaces{scratch.data(), invariants.data(), frame.registers.data(), m_constants.data()};
+    const Operand *operands = m_operands.data();
+    const size_t code_size = m_code.size();
+    StepProfile *const profile = frame.profile;
+    size_t pc = 0;
+
+    try
+    {
+        while (pc < code_size)
+        {
+            const Instruction &ins = m_code[pc];
+            const Operand *args = operands + ins.first_operand;
+            if (profile)
+                profile->enter(ins.site);
+
+            switch (ins.code)
+            {
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::POWER:
+            {
+                if (!ins.typed)
+                {
+                    bool all_scalar = ins.num_args > 0 && ins.num_results == 1;
+                    for (uint32_t i = 0; i < ins.num_args && all_scalar; ++i)
+                    {
+                        all_scalar = std::holds_alternative<double>(read_operand(args[i], spaces));
+                    }
+                    if (!all_scalar)
+                    {
+                        goto generic_call;
+                    }
+                }
+                double acc = known<double>(read_operand(args[0], spaces));
+                for (uint32_t i = 1; i < ins.num_args; ++i)
+                {
+                    const double val = known<double>(read_operand(args[i], spaces));
+                    switch (ins.code)
+                    {
+                    case OpCode::ADD:
+                        acc += val;
+                        break;
+                    case OpCode::SUBTRACT:
+                        acc -= val;
+                        break;
+                    case OpCode::MULTIPLY:
+                        acc *= val;
+                        break;
+                    case OpCode::DIVIDE:
+                        if (val == 0.0)
+                            throw EngineException(EngineErrc::DivisionByZero, "Division by zero");
+                        acc /= val;
+                        break;
+                    default:
+                        acc = std::pow(acc, val);
+                        break;
+                    }
+                }
+                write_operand(args[ins.num_args], spaces) = acc;
+                break;
+            }
+            case OpCode::LOG:
+            case OpCode::LOG10:
+            case OpCode::EXP:
+            case OpCode::SIN:
+            case OpCode::COS:
+            case OpCode::TAN:
+            {
+                if (!ins.typed && (ins.num_args != 1 || ins.num_results != 1 || !std::holds_alternative<double>(read_operand(args[0], spaces))))
+                {
+                    goto generic_call;
+                }
+                const double x = known<double>(read_operand(args[0], spaces));
+                double result;
+                switch (ins.code)
+                {
+                case OpCode::LOG:
+                    result = std::log(x);
+                    break;
+                case OpCode::LOG10:
+                    result = std::log10(x);
+                    break;
+                case OpCode::EXP:
+                    result = std::exp(x);
+                    break;
+                case OpCode::SIN:
+                    result = std::sin(x);
+                    break;
+                case OpCode::COS:
+                    result = std::cos(x);
+                    break;
+                default:
+                    result = std::tan(x);
+                    break;
+                }
+                write_operand(args[1], spaces) = result;
+                break;
+            }
+            case OpCode::EQ:
+            case OpCode::NEQ:
+            case OpCode::GT:
+            case OpCode::LT:
+            case OpCode::GTE:
+            case OpCode::LTE:
+            {
+                if (!ins.typed && (ins.num_args != 2 || ins.num_results != 1 || !std::holds_alternative<double>(read_operand(args[0], spaces)) ||
+                                   !std::holds_alternative<double>(read_operand(args[1], spaces))))
+                {
+                    goto generic_call;
+                }
+                const double l = known<double>(read_operand(args[0], spaces));
+                const double r = known<double>(read_operand(args[1], spaces));
+                bool result;
+                switch (ins.code)
+                {
+                case OpCode::EQ:
+                    result = l == r;
+                    break;
+                case OpCode::NEQ:
+                    result = l != r;
+                    break;
+                case OpCode::GT:
+                    result = l > r;
+                    break;
+                case OpCode::LT:
+                    result = l < r;
+                    break;
+                case OpCode::GTE:
+                    result = l >= r;
+                    break;
+                default:
+                    result = l <= r;
+                    break;
+                }
+                write_operand(args[2], spaces) = result;
+                break;
+            }
+            case OpCode::NOT:
+            {
+                if (!ins.typed && (ins.num_args != 1 || ins.num_results != 1 || !std::holds_alternative<bool>(read_operand(args[0], spaces))))
+                {
+                    goto generic_call;
+                }
+                write_operand(args[1], spaces) = !known<bool>(read_operand(args[0], spaces));
+                break;
+            }
+            case OpCode::IDENTITY:
+            {
+                if (ins.num_args != 1 || ins.num_results != 1)
+                {
+                    goto generic_call;
+                }
+                write_operand(args[1], spaces) = read_operand(args[0], spaces);
+                break;
+            }
+            case OpCode::JUMP:
+                pc = ins.target;
+                continue;
+            case OpCode::JUMP_IF_FALSE:
+            {
+                const TrialValue &condition = read_operand(args[0], spaces);
+                if (!ins.typed && !std::holds_alternative<bool>(condition))
+                {
+                    throw EngineException(EngineErrc::ConditionNotBoolean, "The 'if' condition did not evaluate to a boolean value.");
+                }
+                if (!known<bool>(condition))
+                {
+                    pc = ins.target;
+                    continue;
+                }
+                break;
+            }
+            case OpCode::RUN_STEP:
+                m_fallback_steps[ins.target]->execute(scratch);
+                break;
+            default:
+            generic_call:
+            {
+                if (ins.typed)
+                {
+                    // Bound at plan time to the function's lanes form, one lane wide.
+                    const bool logical = ins.code == OpCode::AND || ins.code == OpCode::OR;
+                    double *values = frame.lane_values.data();
+                    LaneArgument *lane_args = frame.lane_args.data();
+                    for (uint32_t i = 0; i < ins.num_args; ++i)
+                    {
+                        const TrialValue &arg = read_operand(args[i], spaces);
+                        values[i] = logical ? (known<bool>(arg) ? 1.0 : 0.0) : known<double>(arg);
+                        lane_args[i] = LaneArgument{values + i, 0};
+                    }
+                    double result;
+                    m_callables[ins.target]->execute_lanes(lane_args, ins.num_args, &result, 1);
+                    TrialValue &destination = write_operand(args[ins.num_args], spaces);
+                    if (ins.result_type == ValueType::Bool)
+                        destination = result != 0.0;
+                    else
+                        destination = result;
+                    break;
+                }
+                const TrialValue **call_args = frame.call_args.data();
+                for (uint32_t i = 0; i < ins.num_args; ++i)
+                {
+                    call_args[i] = &read_operand(args[i], spaces);
+                }
+                const Operand *outs = args + ins.num_args;
+                TrialValue **result_refs = frame.result_refs.data();
+                for (uint32_t i = 0; i < ins.num_results; ++i)
+                {
+                    result_refs[i] = ins.direct_results ? &write_operand(outs[i], spaces) : &frame.call_results[i];
+                }
+                const size_t produced = m_callables[ins.target]->execute_into(
+                    ArgumentSpan(call_args, ins.num_args), ResultSpan(result_refs, ins.num_results));
+                if (produced != ins.num_results)
+                {
+                    const DebugSite &site = m_sites[ins.site];
+                    if (site.kind == DebugSite::Kind::NestedFunction)
+                    {
+                        throw EngineException(EngineErrc::MismatchedArgumentType, "Nested function '" + site.function_name + "' used in an expression must return exactly one value, but it returned " + std::to_string(produced) + ".", site.line_num);
+                    }
+                    throw EngineException(
+                        EngineErrc::IncorrectArgumentCount,
+                        "Function '" + site.function_name + "' returned " + std::to_string(produced) +
+                            " values, but " + std::to_string(ins.num_results) + " were expected for assignment.");
+                }
+                if (!ins.direct_results)
+                {
+                    for (uint32_t i = 0; i < ins.num_results; ++i)
+                    {
+                        hand_over(frame.call_results[i], write_operand(outs[i], spaces));
+                    }
+                }
+                break;
+            }
+            }
+            if (ins.checks_results)
+                check_result_types(ins, spaces.slots);
+            ++pc;
+        }
+    }
+    catch (...)
+    {
+        if (profile)
+            profile->stop();
+        rethrow_with_context(m_code[pc].site);
+    }
+    if (profile)
+        profile->stop();
+}
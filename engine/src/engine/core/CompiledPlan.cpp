@@ -0,0 +1,56 @@
+#include "include/engine/core/CompiledPlan.h"
+
+namespace
+{
+    LogCallback or_silent(LogCallback log)
+    {
+        if (!log)
+        {
+            log = [](LogLevel, const std::string &) {};
+        }
+        return log;
+    }
+}
+
+std::shared_ptr<const CompiledPlan> CompiledPlan::compile(std::string_view recipe, LogCallback log)
+{
+    return std::shared_ptr<const CompiledPlan>(new CompiledPlan(SimulationEngine::from_recipe_text(recipe, false, or_silent(std::move(log)))));
+}
+
+std::shared_ptr<const CompiledPlan> CompiledPlan::compile_document(const nlohmann::json &recipe, LogCallback log)
+{
+    return std::shared_ptr<const CompiledPlan>(new CompiledPlan(SimulationEngine::from_recipe(recipe, false, or_silent(std::move(log)))));
+}
+
+RunReport run(const CompiledPlan &plan, const RunOptions &options, const std::vector<ResultSink *> &sinks)
+{
+    return plan.engine().run(options, sinks);
+}
+
+RunReport run(const CompiledPlan &plan, const RunOptions &options, ResultSink &sink)
+{
+    return plan.engine().run(options, {&sink});
+}
+
+std::vector<std::vector<TrialValue>> run_outputs(const CompiledPlan &plan, const RunOptions &options)
+{
+    const size_t num_outputs = options.outputs.empty() ? plan.output_names().size() : options.outputs.size();
+    std::vector<ResultCollector> collectors(num_outputs);
+    std::vector<OutputColumnSink> columns;
+    std::vector<ResultSink *> sinks;
+    for (size_t k = 0; k < num_outputs; ++k)
+    {
+        columns.emplace_back(collectors[k], k);
+    }
+    for (OutputColumnSink &column : columns)
+    {
+        sinks.push_back(&column);
+    }
+    plan.engine().run(options, sinks);
+    std::vector<std::vector<TrialValue>> results(num_outputs);
+    for (size_t k = 0; k < num_outputs; ++k)
+    {
+        results[k] = collectors[k].take_results();
+    }
+    return results;
+}
@@ -0,0 +1,139 @@
+// The "cuda" device backend, built with -DVSE_ENABLE_CUDA=ON. One GPU thread runs one trial lane
+// through run_device_lane(); see DeviceProgram.h.
+#include "include/engine/core/DeviceProgram.h"
+#include "include/engine/core/EngineException.h"
+#include <cuda_runtime.h>
+#include <string>
+
+std::unique_ptr<DeviceBackend> make_cuda_backend();
+
+namespace
+{
+    constexpr unsigned THREADS_PER_BLOCK = 256;
+
+    void check(cudaError_t status)
+    {
+        if (status != cudaSuccess)
+            throw EngineException(EngineErrc::UnknownError, std::string("CUDA error: ") + cudaGetErrorString(status));
+    }
+
+    template <typename T>
+    T *upload(const std::vector<T> &values)
+    {
+        T *device = nullptr;
+        // cudaMalloc of zero bytes may return null, which the kernel never dereferences.
+        check(cudaMalloc(&device, values.size() * sizeof(T)));
+        check(cudaMemcpy(device, values.data(), values.size() * sizeof(T), cudaMemcpyHostToDevice));
+        return device;
+    }
+
+    __global__ void run_lanes(const DeviceInstruction *code, size_t code_size, const uint32_t *operands, const double *constants,
+                              double *registers, size_t lanes, uint64_t seed, uint64_t first_trial, int *failed)
+    {
+        const size_t lane = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+        if (lane >= lanes)
+            return;
+        if (!run_device_lane(code, code_size, operands, constants, registers, lanes, lane, seed, first_trial + lane))
+            *failed = 1;
+    }
+
+    // Device memory and a stream per host thread, grown to the largest run and reused; each engine
+    // worker thread keeps its own so that workers overlap their transfers and kernels.
+    struct Workspace
+    {
+        cudaStream_t stream = nullptr;
+        double *registers = nullptr;
+        size_t capacity = 0; // In doubles.
+        int *failed = nullptr;
+        int *host_failed = nullptr; // Pinned.
+
+        ~Workspace()
+        {
+            // Errors are ignored: the CUDA runtime may already be shut down at thread exit.
+            cudaFree(registers);
+            cudaFree(failed);
+            cudaFreeHost(host_failed);
+            if (stream)
+                cudaStreamDestroy(stream);
+        }
+
+        void reserve(size_t doubles)
+        {
+            if (!stream)
+            {
+                check(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+                check(cudaMalloc(&failed, sizeof(int)));
+                check(cudaMallocHost(&host_failed, sizeof(int)));
+            }
+            if (doubles > capacity)
+            {
+                check(cudaFree(registers));
+                registers = nullptr;
+                check(cudaMalloc(&registers, doubles * sizeof(double)));
+                capacity = doubles;
+            }
+        }
+    };
+
+    class CudaKernel : public DeviceKernel
+    {
+    public:
+        explicit CudaKernel(const DeviceProgram &program)
+            : m_inputs(program.inputs), m_outputs(program.outputs), m_num_registers(program.num_registers), m_code_size(program.code.size()),
+              m_code(upload(program.code)), m_operands(upload(program.operands)), m_constants(upload(program.constants)) {}
+
+        ~CudaKernel() override
+        {
+            cudaFree(m_code);
+            cudaFree(m_operands);
+            cudaFree(m_constants);
+        }
+
+        bool run(const DeviceLaunch &launch, const double *const *inputs, double *const *outputs) const override
+        {
+            static thread_local Workspace workspace;
+            const size_t lanes = launch.lanes;
+            workspace.reserve(static_cast<size_t>(m_num_registers) * lanes);
+            cudaStream_t stream = workspace.stream;
+            for (size_t k = 0; k < m_inputs.size(); ++k)
+            {
+                check(cudaMemcpyAsync(workspace.registers + m_inputs[k] * lanes, inputs[k], lanes * sizeof(double), cudaMemcpyHostToDevice, stream));
+            }
+            check(cudaMemsetAsync(workspace.failed, 0, sizeof(int), stream));
+            const unsigned blocks = static_cast<unsigned>((lanes + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK);
+            run_lanes<<<blocks, THREADS_PER_BLOCK, 0, stream>>>(m_code, m_code_size, m_operands, m_constants, workspace.registers, lanes, launch.seed, launch.first_trial, workspace.failed);
+            check(cudaGetLastError());
+            for (size_t k = 0; k < m_outputs.size(); ++k)
+            {
+                check(cudaMemcpyAsync(outputs[k], workspace.registers + m_outputs[k] * lanes, lanes * sizeof(double), cudaMemcpyDeviceToHost, stream));
+            }
+            check(cudaMemcpyAsync(workspace.host_failed, workspace.failed, sizeof(int), cudaMemcpyDeviceToHost, stream));
+            check(cudaStreamSynchronize(stream));
+            return *workspace.host_failed == 0;
+        }
+
+    private:
+        std::vector<uint32_t> m_inputs;
+        std::vector<uint32_t> m_outputs;
+        uint32_t m_num_registers;
+        size_t m_code_size;
+        DeviceInstruction *m_code;
+        uint32_t *m_operands;
+        double *m_constants;
+    };
+
+    class CudaBackend : public DeviceBackend
+    {
+    public:
+        const char *name() const override { return "cuda"; }
+        std::unique_ptr<DeviceKernel> prepare(const DeviceProgram &program) const override { return std::make_unique<CudaKernel>(program); }
+    };
+}
+
+std::unique_ptr<DeviceBackend> make_cuda_backend()
+{
+    int devices = 0;
+    if (cudaGetDeviceCount(&devices) != cudaSuccess || devices == 0)
+        return nullptr;
+    return std::make_unique<CudaBackend>();
+}
@@ -0,0 +1,161 @@
+#include "include/engine/core/DeviceProgram.h"
+#include "include/engine/core/DataStructures.h"
+#include "include/engine/core/EngineException.h"
+#include <algorithm>
+
+#if defined(VSE_HAVE_CUDA)
+// CudaBackend.cu; null when no GPU is present.
+std::unique_ptr<DeviceBackend> make_cuda_backend();
+#endif
+#if defined(VSE_HAVE_LLVM)
+// JitBackend.cpp.
+std::unique_ptr<DeviceBackend> make_jit_backend();
+#endif
+
+bool device_op_for(OpCode code, DeviceOp &op)
+{
+    switch (code)
+    {
+    case OpCode::ADD:
+        op = DeviceOp::Add;
+        return true;
+    case OpCode::SUBTRACT:
+        op = DeviceOp::Subtract;
+        return true;
+    case OpCode::MULTIPLY:
+        op = DeviceOp::Multiply;
+        return true;
+    case OpCode::DIVIDE:
+        op = DeviceOp::Divide;
+        return true;
+    case OpCode::POWER:
+        op = DeviceOp::Power;
+        return true;
+    case OpCode::LOG:
+        op = DeviceOp::Log;
+        return true;
+    case OpCode::LOG10:
+        op = DeviceOp::Log10;
+        return true;
+    case OpCode::EXP:
+        op = DeviceOp::Exp;
+        return true;
+    case OpCode::SIN:
+        op = DeviceOp::Sin;
+        return true;
+    case OpCode::COS:
+        op = DeviceOp::Cos;
+        return true;
+    case OpCode::TAN:
+        op = DeviceOp::Tan;
+        return true;
+    case OpCode::EQ:
+        op = DeviceOp::Eq;
+        return true;
+    case OpCode::NEQ:
+        op = DeviceOp::Neq;
+        return true;
+    case OpCode::GT:
+        op = DeviceOp::Gt;
+        return true;
+    case OpCode::LT:
+        op = DeviceOp::Lt;
+        return true;
+    case OpCode::GTE:
+        op = DeviceOp::Gte;
+        return true;
+    case OpCode::LTE:
+        op = DeviceOp::Lte;
+        return true;
+    case OpCode::AND:
+        op = DeviceOp::And;
+        return true;
+    case OpCode::OR:
+        op = DeviceOp::Or;
+        return true;
+    case OpCode::NOT:
+        op = DeviceOp::Not;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void DeviceLowering::emit(DeviceOp op, const uint32_t *operands, size_t num_operands, uint32_t result, uint32_t site)
+{
+    const uint32_t first = static_cast<uint32_t>(m_program.operands.size());
+    m_program.operands.insert(m_program.operands.end(), operands, operands + num_operands);
+    m_program.code.push_back(DeviceInstruction{op, first, static_cast<uint32_t>(num_operands), result, site});
+}
+
+namespace
+{
+    class HostKernel : public DeviceKernel
+    {
+    public:
+        explicit HostKernel(const DeviceProgram &program) : m_program(program) {}
+
+        bool run(const DeviceLaunch &launch, const double *const *inputs, double *const *outputs) const override
+        {
+            // Per-thread registers, reused across runs.
+            static thread_local std::vector<double> registers;
+            const size_t lanes = launch.lanes;
+            registers.resize(static_cast<size_t>(m_program.num_registers) * lanes);
+            for (size_t k = 0; k < m_program.inputs.size(); ++k)
+            {
+                std::copy(inputs[k], inputs[k] + lanes, registers.data() + m_program.inputs[k] * lanes);
+            }
+            for (size_t lane = 0; lane < lanes; ++lane)
+            {
+                if (!run_device_lane(m_program.code.data(), m_program.code.size(), m_program.operands.data(), m_program.constants.data(),
+                                     registers.data(), lanes, lane, launch.seed, launch.first_trial + lane))
+                {
+                    return false;
+                }
+            }
+            for (size_t k = 0; k < m_program.outputs.size(); ++k)
+            {
+                const double *values = registers.data() + m_program.outputs[k] * lanes;
+                std::copy(values, values + lanes, outputs[k]);
+            }
+            return true;
+        }
+
+    private:
+        DeviceProgram m_program;
+    };
+
+    class HostBackend : public DeviceBackend
+    {
+    public:
+        const char *name() const override { return "host"; }
+        std::unique_ptr<DeviceKernel> prepare(const DeviceProgram &program) const override { return std::make_unique<HostKernel>(program); }
+    };
+}
+
+std::unique_ptr<DeviceBackend> make_device_backend(const std::string &name)
+{
+    if (name == "cpu")
+        return nullptr;
+    if (name == "host")
+        return std::make_unique<HostBackend>();
+    if (name == "cuda")
+    {
+#if defined(VSE_HAVE_CUDA)
+        if (std::unique_ptr<DeviceBackend> backend = make_cuda_backend())
+            return backend;
+        throw EngineException(EngineErrc::RecipeConfigError, "Device 'cuda' was requested, but no CUDA GPU is available.");
+#else
+        throw EngineException(EngineErrc::RecipeConfigError, "Device 'cuda' was requested, but this engine was built without CUDA (-DVSE_ENABLE_CUDA=ON).");
+#endif
+    }
+    if (name == "jit")
+    {
+#if defined(VSE_HAVE_LLVM)
+        return make_jit_backend();
+#else
+        throw EngineException(EngineErrc::RecipeConfigError, "Device 'jit' was requested, but this engine was built without LLVM (-DVSE_ENABLE_LLVM=ON).");
+#endif
+    }
+    throw EngineException(EngineErrc::RecipeConfigError, "Unknown device '" + name + "'. Expected 'cpu', 'host', 'jit' or 'cuda'.");
+}
@@ -1,5 +1,9 @@
 #include "include/engine/core/ExecutionSteps.h"
 #include "include/engine/core/EngineException.h"
+#include "include/engine/core/FusedExpression.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
 #include <nlohmann/json.hpp>
 
@@ -13,7 +17,31 @@ void LiteralAssignmentStep::execute(TrialContext &context) const
     context[m_result_index] = m_value;
 }
 
-TrialValue ArgumentPlanner::resolve_runtime_value(const ResolvedArgument &arg, const TrialContext &context)
+std::vector<double> ArgumentPlanner::vector_literal_values(const json &value, int line_num)
+{
+    if (!value.is_binary())
+    {
+        return value.get<std::vector<double>>();
+    }
+    const auto &bytes = value.get_binary();
+    if (bytes.size() % sizeof(double) != 0)
+    {
+        throw EngineException(EngineErrc::RecipeParseError, "Packed vector literal of " + std::to_string(bytes.size()) + " bytes is not a whole number of doubles.", line_num);
+    }
+    std::vector<double> values(bytes.size() / sizeof(double));
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        uint64_t bits = 0;
+        for (size_t b = 0; b < sizeof(double); ++b)
+        {
+            bits |= static_cast<uint64_t>(bytes[i * sizeof(double) + b]) << (8 * b);
+        }
+        std::memcpy(&values[i], &bits, sizeof(double));
+    }
+    return values;
+}
+
+TrialValue ArgumentPlanner::resolve_runtime_value(const ResolvedArgument &arg, const TrialContext &context, const void *&site)
 {
     return std::visit(
         [&](auto &&plan) -> TrialValue
@@ -25,68 +53,170 @@ TrialValue ArgumentPlanner::resolve_runtime_value(const ResolvedArgument &arg, c
             }
             else if constexpr (std::is_same_v<T, size_t>)
             {
-                return context.at(plan);
+                // Indices were checked against the registry when the recipe was loaded.
+                return context[plan];
             }
             else if constexpr (std::is_same_v<T, std::unique_ptr<NestedFunctionCall>>)
             {
                 const auto &nested_call = *plan;
-                std::vector<TrialValue> nested_final_args;
-                nested_final_args.reserve(nested_call.args.size());
-                for (const auto &nested_arg_plan : nested_call.args)
-                {
-                    nested_final_args.push_back(resolve_runtime_value(nested_arg_plan, context));
-                }
-                try
-                {
-                    std::vector<TrialValue> result_vec = nested_call.logic->execute(nested_final_args);
-                    if (result_vec.size() != 1)
-                    {
-                        throw EngineException(EngineErrc::MismatchedArgumentType, "Nested function '" + nested_call.function_name + "' used in an expression must return exactly one value, but it returned " + std::to_string(result_vec.size()) + ".", nested_call.line_num);
-                    }
-                    return result_vec[0];
-                }
-                catch (const EngineException &e)
+                ArgumentValues values;
+                ArgumentRefs args;
+                resolve_arguments(nested_call.args, context, site, values, args);
+                site = &nested_call;
+                TrialValue result;
+                TrialValue *const result_ref = &result;
+                const size_t produced = nested_call.logic->execute_into(ArgumentSpan(args.data(), args.size()), ResultSpan(&result_ref, 1));
+                if (produced != 1 && !nested_call.decorates_errors)
                 {
-                    throw EngineException(e.code(), std::string("In nested function '") + nested_call.function_name + "': " + e.what(), nested_call.line_num);
-                }
-                catch (const std::exception &e)
-                {
-                    throw EngineException(EngineErrc::UnknownError, std::string("In nested function '") + nested_call.function_name + "': " + e.what(), nested_call.line_num);
+                    throw EngineException(EngineErrc::MismatchedArgumentType, "Nested function '" + nested_call.function_name + "' used in an expression must return exactly one value, but it returned " + std::to_string(produced) + ".", nested_call.line_num);
                 }
+                return result;
             }
             else if constexpr (std::is_same_v<T, std::unique_ptr<NestedConditional>>)
             {
                 const auto &nested_cond = *plan;
-                try
-                {
-                    TrialValue condition_result = resolve_runtime_value(nested_cond.condition, context);
-                    if (!std::holds_alternative<bool>(condition_result))
-                    {
-                        throw EngineException(EngineErrc::ConditionNotBoolean, "The 'if' condition did not evaluate to a boolean value.");
-                    }
-                    if (std::get<bool>(condition_result))
-                    {
-                        return resolve_runtime_value(nested_cond.then_expr, context);
-                    }
-                    else
-                    {
-                        return resolve_runtime_value(nested_cond.else_expr, context);
-                    }
-                }
-                catch (const EngineException &e)
+                TrialValue condition_result = resolve_runtime_value(nested_cond.condition, context, site);
+                site = &nested_cond;
+                if (!std::holds_alternative<bool>(condition_result))
                 {
-                    throw EngineException(e.code(), std::string("In nested conditional expression: ") + e.what(), nested_cond.line_num);
+                    throw EngineException(EngineErrc::ConditionNotBoolean, "The 'if' condition did not evaluate to a boolean value.");
                 }
-                catch (const std::exception &e)
+                return resolve_runtime_value(std::get<bool>(condition_result) ? nested_cond.then_expr : nested_cond.else_expr, context, site);
+            }
+            else if constexpr (std::is_same_v<T, std::unique_ptr<HoistedExpression>>)
+            {
+                if (plan->value)
                 {
-                    throw EngineException(EngineErrc::UnknownError, std::string("In nested conditional expression: ") + e.what(), nested_cond.line_num);
+                    return *plan->value;
                 }
+                return resolve_runtime_value(plan->plan, context, site);
             }
         },
         arg);
 }
 
+void ArgumentPlanner::resolve_arguments(const std::vector<ResolvedArgument> &plans, const TrialContext &context, const void *&site, ArgumentValues &values, ArgumentRefs &args)
+{
+    // Reserved up front, so that the references into `values` stay valid.
+    values.reserve(plans.size());
+    args.reserve(plans.size());
+    for (const ResolvedArgument &plan : plans)
+    {
+        const TrialValue *value = nullptr;
+        if (const auto *literal = std::get_if<TrialValue>(&plan))
+            value = literal;
+        else if (const auto *index = std::get_if<size_t>(&plan))
+            value = &context[*index];
+        else if (const auto *hoisted = std::get_if<std::unique_ptr<HoistedExpression>>(&plan); hoisted && (*hoisted)->value)
+            value = &*(*hoisted)->value;
+        args.push_back(value ? value : &values.emplace_back(resolve_runtime_value(plan, context, site)));
+    }
+}
+
+namespace
+{
+    struct ErrorLevel
+    {
+        std::string prefix;
+        int line_num;
+    };
+
+    // Collects, innermost first, the levels of `arg` that decorate an error raised at `site`:
+    // the nested call that raised it, unless it decorates its own, and every enclosing
+    // conditional. A call does not decorate the errors of its arguments.
+    bool collect_levels(const ArgumentPlanner::ResolvedArgument &arg, const void *site, std::vector<ErrorLevel> &levels)
+    {
+        if (const auto *call = std::get_if<std::unique_ptr<ArgumentPlanner::NestedFunctionCall>>(&arg))
+        {
+            const ArgumentPlanner::NestedFunctionCall &nested = **call;
+            if (&nested == site)
+            {
+                if (!nested.decorates_errors)
+                    levels.push_back({"In nested function '" + nested.function_name + "': ", nested.line_num});
+                return true;
+            }
+            return std::any_of(nested.args.begin(), nested.args.end(), [&](const ArgumentPlanner::ResolvedArgument &nested_arg)
+                               { return collect_levels(nested_arg, site, levels); });
+        }
+        if (const auto *cond = std::get_if<std::unique_ptr<ArgumentPlanner::NestedConditional>>(&arg))
+        {
+            const ArgumentPlanner::NestedConditional &nested = **cond;
+            if (&nested == site || collect_levels(nested.condition, site, levels) || collect_levels(nested.then_expr, site, levels) ||
+                collect_levels(nested.else_expr, site, levels))
+            {
+                levels.push_back({"In nested conditional expression: ", nested.line_num});
+                return true;
+            }
+            return false;
+        }
+        if (const auto *hoisted = std::get_if<std::unique_ptr<ArgumentPlanner::HoistedExpression>>(&arg))
+        {
+            return collect_levels((*hoisted)->plan, site, levels);
+        }
+        return false;
+    }
+}
+
+void ArgumentPlanner::rethrow_from_site(const std::vector<const ResolvedArgument *> &roots, const void *site, const std::string &prefix, int line_num, bool index_errors)
+{
+    EngineErrc code = EngineErrc::UnknownError;
+    std::string message;
+    bool is_out_of_range = false;
+    try
+    {
+        throw;
+    }
+    catch (const EngineException &e)
+    {
+        code = e.code();
+        message = e.what();
+    }
+    catch (const std::out_of_range &e)
+    {
+        is_out_of_range = true;
+        message = e.what();
+    }
+    catch (const std::exception &e)
+    {
+        message = e.what();
+    }
+
+    std::vector<ErrorLevel> levels;
+    if (site)
+    {
+        for (const ResolvedArgument *root : roots)
+        {
+            if (collect_levels(*root, site, levels))
+                break;
+        }
+    }
+    if (levels.empty() && is_out_of_range && index_errors)
+    {
+        code = EngineErrc::IndexOutOfBounds;
+        message = "Variable index out of bounds.";
+    }
+    for (const ErrorLevel &level : levels)
+    {
+        message = EngineException(code, level.prefix + message, level.line_num).what();
+    }
+    throw EngineException(code, prefix + message, line_num);
+}
+
 ArgumentPlanner::ResolvedArgument ArgumentPlanner::build_argument_plan(
+    const json &arg,
+    const ExecutableFactory &factory,
+    InvariantHoister *hoister)
+{
+    ResolvedArgument plan = build_unfused_plan(arg, factory);
+    if (hoister)
+    {
+        hoister->hoist(plan);
+    }
+    fuse_expressions(plan);
+    return plan;
+}
+
+ArgumentPlanner::ResolvedArgument ArgumentPlanner::build_unfused_plan(
     const json &arg,
     const ExecutableFactory &factory)
 {
@@ -107,7 +237,7 @@ ArgumentPlanner::ResolvedArgument ArgumentPlanner::build_argument_plan(
     }
     if (type == "vector_literal")
     {
-        return TrialValue(arg.at("value").get<std::vector<double>>());
+        return TrialValue(vector_literal_values(arg.at("value"), arg.value("line", -1)));
     }
     if (type == "string_literal")
     {
@@ -132,29 +262,194 @@ ArgumentPlanner::ResolvedArgument ArgumentPlanner::build_argument_plan(
         nested_call->args.reserve(nested_args_json.size());
         for (const auto &nested_arg_json : nested_args_json)
         {
-            nested_call->args.push_back(build_argument_plan(nested_arg_json, factory));
+            nested_call->args.push_back(build_unfused_plan(nested_arg_json, factory));
         }
+        bind_literals(*nested_call->logic, nested_call->args);
         return nested_call;
     }
     if (type == "conditional_expression")
     {
         auto nested_cond = std::make_unique<NestedConditional>();
         nested_cond->line_num = arg.value("line", -1);
-        nested_cond->condition = build_argument_plan(arg.at("condition"), factory);
-        nested_cond->then_expr = build_argument_plan(arg.at("then_expr"), factory);
-        nested_cond->else_expr = build_argument_plan(arg.at("else_expr"), factory);
+        nested_cond->condition = build_unfused_plan(arg.at("condition"), factory);
+        nested_cond->then_expr = build_unfused_plan(arg.at("then_expr"), factory);
+        nested_cond->else_expr = build_unfused_plan(arg.at("else_expr"), factory);
         return nested_cond;
     }
     throw EngineException(EngineErrc::RecipeParseError, "Invalid argument type in bytecode: '" + type + "'.");
 }
 
+void ArgumentPlanner::bind_literals(IExecutable &logic, std::vector<ResolvedArgument> &args)
+{
+    std::vector<const TrialValue *> literals(args.size(), nullptr);
+    for (size_t i = 0; i < args.size(); ++i)
+    {
+        literals[i] = std::get_if<TrialValue>(&args[i]);
+    }
+    std::vector<size_t> bound = logic.bind_literal_arguments(literals);
+    std::sort(bound.begin(), bound.end());
+    for (auto it = bound.rbegin(); it != bound.rend(); ++it)
+    {
+        if (*it < args.size())
+            args.erase(args.begin() + static_cast<std::ptrdiff_t>(*it));
+    }
+}
+
+namespace
+{
+    using ResolvedArgument = ArgumentPlanner::ResolvedArgument;
+    using NestedFunctionCall = ArgumentPlanner::NestedFunctionCall;
+
+    const NestedFunctionCall *fusable_child(const ResolvedArgument &arg)
+    {
+        const auto *call = std::get_if<std::unique_ptr<NestedFunctionCall>>(&arg);
+        if (call && FusedExpression::can_fuse((*call)->function_name, (*call)->args.size(), false))
+        {
+            return call->get();
+        }
+        return nullptr;
+    }
+
+    // Appends the postfix nodes of one operation; non-fusable arguments become leaves.
+    void flatten(std::unique_ptr<IExecutable> logic, std::vector<ResolvedArgument> &args, const std::string &function_name,
+                 int line_num, bool decorates_errors, std::vector<FusedExpression::Node> &nodes, std::vector<ResolvedArgument> &leaves)
+    {
+        const uint32_t num_args = static_cast<uint32_t>(args.size());
+        for (ResolvedArgument &arg : args)
+        {
+            if (fusable_child(arg))
+            {
+                NestedFunctionCall &child = *std::get<std::unique_ptr<NestedFunctionCall>>(arg);
+                flatten(std::move(child.logic), child.args, child.function_name, child.line_num, true, nodes, leaves);
+            }
+            else
+            {
+                nodes.push_back(FusedExpression::Node{OpCode::IDENTITY, 0, static_cast<uint32_t>(leaves.size()), nullptr, "", -1, false});
+                leaves.push_back(std::move(arg));
+            }
+        }
+        nodes.push_back(FusedExpression::Node{opcode_for_function(function_name), num_args, 0, std::move(logic), function_name, line_num, decorates_errors});
+    }
+}
+
+bool ArgumentPlanner::fuse_call(std::unique_ptr<IExecutable> &logic, std::vector<ResolvedArgument> &args,
+                                const std::string &function_name, int line_num, bool decorate_root)
+{
+    if (!FusedExpression::can_fuse(function_name, args.size(), true) ||
+        std::none_of(args.begin(), args.end(), [](const ResolvedArgument &arg)
+                     { return fusable_child(arg) != nullptr; }))
+    {
+        return false;
+    }
+    std::vector<FusedExpression::Node> nodes;
+    std::vector<ResolvedArgument> leaves;
+    flatten(std::move(logic), args, function_name, line_num, decorate_root, nodes, leaves);
+    logic = std::make_unique<FusedExpression>(std::move(nodes));
+    args = std::move(leaves);
+    return true;
+}
+
+void ArgumentPlanner::fuse_expressions(ResolvedArgument &arg)
+{
+    if (auto *call = std::get_if<std::unique_ptr<NestedFunctionCall>>(&arg))
+    {
+        NestedFunctionCall &nested = **call;
+        if (fuse_call(nested.logic, nested.args, nested.function_name, nested.line_num, true))
+        {
+            nested.decorates_errors = true;
+        }
+        for (ResolvedArgument &nested_arg : nested.args)
+        {
+            fuse_expressions(nested_arg);
+        }
+    }
+    else if (auto *cond = std::get_if<std::unique_ptr<NestedConditional>>(&arg))
+    {
+        fuse_expressions((*cond)->condition);
+        fuse_expressions((*cond)->then_expr);
+        fuse_expressions((*cond)->else_expr);
+    }
+    else if (auto *hoisted = std::get_if<std::unique_ptr<HoistedExpression>>(&arg))
+    {
+        fuse_expressions((*hoisted)->plan);
+    }
+}
+
+InvariantHoister::InvariantHoister(std::vector<bool> per_trial_slots, PurityCheck is_pure)
+    : m_per_trial_slots(std::move(per_trial_slots)), m_is_pure(std::move(is_pure)) {}
+
+bool InvariantHoister::is_invariant(const ResolvedArgument &arg) const
+{
+    if (const auto *slot = std::get_if<size_t>(&arg))
+    {
+        // Out-of-range indices stay on the per-trial path, which reports them.
+        return *slot < m_per_trial_slots.size() && !m_per_trial_slots[*slot];
+    }
+    if (const auto *call = std::get_if<std::unique_ptr<NestedFunctionCall>>(&arg))
+    {
+        return m_is_pure((*call)->function_name) &&
+               std::all_of((*call)->args.begin(), (*call)->args.end(), [this](const ResolvedArgument &nested_arg)
+                           { return is_invariant(nested_arg); });
+    }
+    if (const auto *cond = std::get_if<std::unique_ptr<ArgumentPlanner::NestedConditional>>(&arg))
+    {
+        return is_invariant((*cond)->condition) && is_invariant((*cond)->then_expr) && is_invariant((*cond)->else_expr);
+    }
+    return true; // Literals and already hoisted calls.
+}
+
+void InvariantHoister::hoist(ResolvedArgument &arg)
+{
+    if (auto *call = std::get_if<std::unique_ptr<NestedFunctionCall>>(&arg))
+    {
+        if (is_invariant(arg))
+        {
+            auto hoisted = std::make_unique<ArgumentPlanner::HoistedExpression>();
+            hoisted->plan = std::move(arg);
+            m_hoisted.push_back(hoisted.get());
+            arg = std::move(hoisted);
+            return;
+        }
+        for (ResolvedArgument &nested_arg : (*call)->args)
+        {
+            hoist(nested_arg);
+        }
+    }
+    else if (auto *cond = std::get_if<std::unique_ptr<ArgumentPlanner::NestedConditional>>(&arg))
+    {
+        hoist((*cond)->condition);
+        hoist((*cond)->then_expr);
+        hoist((*cond)->else_expr);
+    }
+}
+
+size_t InvariantHoister::evaluate(const TrialContext &context)
+{
+    size_t evaluated = 0;
+    for (ArgumentPlanner::HoistedExpression *hoisted : m_hoisted)
+    {
+        try
+        {
+            const void *site = nullptr;
+            hoisted->value = ArgumentPlanner::resolve_runtime_value(hoisted->plan, context, site);
+            ++evaluated;
+        }
+        catch (const std::exception &)
+        {
+            hoisted->value.reset();
+        }
+    }
+    return evaluated;
+}
+
 ExecutionAssignmentStep::ExecutionAssignmentStep(
     std::vector<size_t> result_indices,
     std::string function_name,
     int line_num,
     std::unique_ptr<IExecutable> logic,
     const json &args,
-    const ArgumentPlanner::ExecutableFactory &factory)
+    const ArgumentPlanner::ExecutableFactory &factory,
+    InvariantHoister *hoister)
     : m_result_indices(std::move(result_indices)),
       m_function_name(std::move(function_name)),
       m_line_num(line_num),
@@ -163,47 +458,71 @@ ExecutionAssignmentStep::ExecutionAssignmentStep(
     m_resolved_args.reserve(args.size());
     for (const auto &arg_json : args)
     {
-        m_resolved_args.push_back(ArgumentPlanner::build_argument_plan(arg_json, factory));
+        m_resolved_args.push_back(ArgumentPlanner::build_unfused_plan(arg_json, factory));
+        if (hoister)
+        {
+            hoister->hoist(m_resolved_args.back());
+        }
+    }
+    ArgumentPlanner::bind_literals(*m_logic, m_resolved_args);
+    m_fused = m_result_indices.size() == 1 &&
+              ArgumentPlanner::fuse_call(m_logic, m_resolved_args, m_function_name, m_line_num, false);
+    for (auto &arg_plan : m_resolved_args)
+    {
+        ArgumentPlanner::fuse_expressions(arg_plan);
     }
 }
 
 void ExecutionAssignmentStep::execute(TrialContext &context) const
 {
+    const void *site = nullptr;
     try
     {
-        std::vector<TrialValue> final_args;
-        final_args.reserve(m_resolved_args.size());
-        for (const auto &arg_plan : m_resolved_args)
+        ArgumentPlanner::ArgumentValues values;
+        ArgumentPlanner::ArgumentRefs args;
+        ArgumentPlanner::resolve_arguments(m_resolved_args, context, site, values, args);
+
+        // Results are written into their slots, keeping their storage, unless the call reads
+        // one of those slots.
+        SmallVector<TrialValue *, 4> results;
+        SmallVector<TrialValue, 4> staged;
+        bool reads_results = false;
+        for (size_t index : m_result_indices)
         {
-            final_args.push_back(ArgumentPlanner::resolve_runtime_value(arg_plan, context));
+            results.push_back(&context[index]);
+            reads_results = reads_results || std::find(args.begin(), args.end(), results.back()) != args.end();
+        }
+        if (reads_results)
+        {
+            staged.resize(results.size());
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                results[i] = &staged[i];
+            }
         }
 
-        std::vector<TrialValue> results = m_logic->execute(final_args);
-
-        if (results.size() != m_result_indices.size())
+        site = nullptr;
+        const size_t produced = m_logic->execute_into(ArgumentSpan(args.data(), args.size()), ResultSpan(results.data(), results.size()));
+        if (produced != m_result_indices.size())
         {
             throw EngineException(
                 EngineErrc::IncorrectArgumentCount,
-                "Function '" + m_function_name + "' returned " + std::to_string(results.size()) +
+                "Function '" + m_function_name + "' returned " + std::to_string(produced) +
                     " values, but " + std::to_string(m_result_indices.size()) + " were expected for assignment.");
         }
-
-        for (size_t i = 0; i < results.size(); ++i)
+        for (size_t i = 0; i < staged.size(); ++i)
         {
-            context[m_result_indices[i]] = results[i];
+            context[m_result_indices[i]] = std::move(staged[i]);
         }
     }
-    catch (const std::out_of_range &)
-    {
-        throw EngineException(EngineErrc::IndexOutOfBounds, std::string("In function '") + m_function_name + "': " + "Variable index out of bounds.", m_line_num);
-    }
-    catch (const EngineException &e)
-    {
-        throw EngineException(e.code(), std::string("In function '") + m_function_name + "': " + e.what(), m_line_num);
-    }
-    catch (const std::exception &e)
+    catch (...)
     {
-        throw EngineException(EngineErrc::UnknownError, std::string("In function '") + m_function_name + "': " + e.what(), m_line_num);
+        std::vector<const ArgumentPlanner::ResolvedArgument *> roots;
+        for (const auto &arg_plan : m_resolved_args)
+        {
+            roots.push_back(&arg_plan);
+        }
+        ArgumentPlanner::rethrow_from_site(roots, site, "In function '" + m_function_name + "': ", m_line_num, true);
     }
 }
 
@@ -213,41 +532,207 @@ ConditionalAssignmentStep::ConditionalAssignmentStep(
     const json &condition,
     const json &then_expr,
     const json &else_expr,
-    const ArgumentPlanner::ExecutableFactory &factory)
+    const ArgumentPlanner::ExecutableFactory &factory,
+    InvariantHoister *hoister)
     : m_result_index(result_index),
       m_line_num(line_num)
 {
-    m_condition_plan = ArgumentPlanner::build_argument_plan(condition, factory);
-    m_then_plan = ArgumentPlanner::build_argument_plan(then_expr, factory);
-    m_else_plan = ArgumentPlanner::build_argument_plan(else_expr, factory);
+    m_condition_plan = ArgumentPlanner::build_argument_plan(condition, factory, hoister);
+    m_then_plan = ArgumentPlanner::build_argument_plan(then_expr, factory, hoister);
+    m_else_plan = ArgumentPlanner::build_argument_plan(else_expr, factory, hoister);
+}
+
+void ConditionalAssignmentStep::defer_step(bool then_branch, const IExecutionStep &step)
+{
+    (then_branch ? m_deferred_then : m_deferred_else).push_back(&step);
 }
 
 void ConditionalAssignmentStep::execute(TrialContext &context) const
 {
+    const void *site = nullptr;
+    bool take_then = false;
     try
     {
-        TrialValue condition_result = ArgumentPlanner::resolve_runtime_value(m_condition_plan, context);
-
+        TrialValue condition_result = ArgumentPlanner::resolve_runtime_value(m_condition_plan, context, site);
+        site = nullptr;
         if (!std::holds_alternative<bool>(condition_result))
         {
             throw EngineException(EngineErrc::ConditionNotBoolean, "The 'if' condition did not evaluate to a boolean value.");
         }
+        take_then = std::get<bool>(condition_result);
+    }
+    catch (...)
+    {
+        ArgumentPlanner::rethrow_from_site({&m_condition_plan}, site, "In conditional expression: ", m_line_num, false);
+    }
 
-        if (std::get<bool>(condition_result))
-        {
-            context[m_result_index] = ArgumentPlanner::resolve_runtime_value(m_then_plan, context);
-        }
-        else
+    for (const IExecutionStep *step : take_then ? m_deferred_then : m_deferred_else)
+    {
+        step->execute(context);
+    }
+
+    const ArgumentPlanner::ResolvedArgument &branch = take_then ? m_then_plan : m_else_plan;
+    site = nullptr;
+    try
+    {
+        context[m_result_index] = ArgumentPlanner::resolve_runtime_value(branch, context, site);
+    }
+    catch (...)
+    {
+        ArgumentPlanner::rethrow_from_site({&branch}, site, "In conditional expression: ", m_line_num, false);
+    }
+}
+// --- Bytecode lowering ---
+
+std::optional<Operand> ArgumentPlanner::lower_argument(const ResolvedArgument &arg, BytecodeBuilder &builder)
+{
+    return std::visit(
+        [&](auto &&plan) -> std::optional<Operand>
         {
-            context[m_result_index] = ArgumentPlanner::resolve_runtime_value(m_else_plan, context);
-        }
+            using T = std::decay_t<decltype(plan)>;
+            if constexpr (std::is_same_v<T, TrialValue>)
+            {
+                return builder.constant(plan);
+            }
+            else if constexpr (std::is_same_v<T, size_t>)
+            {
+                return builder.slot(plan);
+            }
+            else if constexpr (std::is_same_v<T, std::unique_ptr<NestedFunctionCall>>)
+            {
+                // Arguments are resolved outside of the nested call's error scope, exactly as in
+                // resolve_runtime_value, so they are lowered before its site is opened.
+                std::vector<Operand> args;
+                args.reserve(plan->args.size());
+                for (const auto &nested_arg_plan : plan->args)
+                {
+                    auto op = lower_argument(nested_arg_plan, builder);
+                    if (!op)
+                        return std::nullopt;
+                    args.push_back(*op);
+                }
+                Operand result = builder.new_register();
+                if (plan->decorates_errors)
+                {
+                    builder.emit_call(*plan->logic, OpCode::FUSED, args, {result});
+                    return result;
+                }
+                builder.open_site(DebugSite::Kind::NestedFunction, plan->function_name, plan->line_num);
+                builder.emit_call(*plan->logic, plan->function_name, args, {result});
+                builder.close_site();
+                return result;
+            }
+            else if constexpr (std::is_same_v<T, std::unique_ptr<NestedConditional>>)
+            {
+                Operand result = builder.new_register();
+                builder.open_site(DebugSite::Kind::NestedConditional, "", plan->line_num);
+                auto condition = lower_argument(plan->condition, builder);
+                if (!condition)
+                    return std::nullopt;
+                const size_t jump_to_else = builder.emit_jump_if_false(*condition);
+                auto then_value = lower_argument(plan->then_expr, builder);
+                if (!then_value)
+                    return std::nullopt;
+                builder.emit_move(*then_value, result);
+                const size_t jump_to_end = builder.emit_jump();
+                builder.patch_jump_to_here(jump_to_else);
+                auto else_value = lower_argument(plan->else_expr, builder);
+                if (!else_value)
+                    return std::nullopt;
+                builder.emit_move(*else_value, result);
+                builder.patch_jump_to_here(jump_to_end);
+                builder.close_site();
+                return result;
+            }
+            else if constexpr (std::is_same_v<T, std::unique_ptr<HoistedExpression>>)
+            {
+                if (plan->value)
+                {
+                    return builder.constant(*plan->value);
+                }
+                return lower_argument(plan->plan, builder);
+            }
+        },
+        arg);
+}
+
+bool LiteralAssignmentStep::lower(BytecodeBuilder &builder) const
+{
+    auto destination = builder.slot(m_result_index);
+    if (!destination)
+        return false;
+    builder.open_site(DebugSite::Kind::Step, "", -1);
+    builder.emit_move(builder.constant(m_value), *destination);
+    builder.close_site();
+    return true;
+}
+
+bool ExecutionAssignmentStep::lower(BytecodeBuilder &builder) const
+{
+    builder.open_site(DebugSite::Kind::Function, m_function_name, m_line_num);
+    std::vector<Operand> args;
+    args.reserve(m_resolved_args.size());
+    for (const auto &arg_plan : m_resolved_args)
+    {
+        auto op = ArgumentPlanner::lower_argument(arg_plan, builder);
+        if (!op)
+            return false;
+        args.push_back(*op);
     }
-    catch (const EngineException &e)
+    std::vector<Operand> results;
+    results.reserve(m_result_indices.size());
+    for (size_t index : m_result_indices)
     {
-        throw EngineException(e.code(), std::string("In conditional expression: ") + e.what(), m_line_num);
+        auto destination = builder.slot(index);
+        if (!destination)
+            return false;
+        results.push_back(*destination);
     }
-    catch (const std::exception &e)
+    if (m_fused)
+        builder.emit_call(*m_logic, OpCode::FUSED, args, results);
+    else
+        builder.emit_call(*m_logic, m_function_name, args, results);
+    builder.close_site();
+    return true;
+}
+
+bool ConditionalAssignmentStep::lower(BytecodeBuilder &builder) const
+{
+    auto destination = builder.slot(m_result_index);
+    if (!destination)
+        return false;
+    builder.open_site(DebugSite::Kind::Conditional, "", m_line_num);
+    auto condition = ArgumentPlanner::lower_argument(m_condition_plan, builder);
+    if (!condition)
+        return false;
+    const size_t jump_to_else = builder.emit_jump_if_false(*condition);
+    builder.close_site();
+    if (!lower_branch(builder, m_deferred_then, m_then_plan, *destination))
+        return false;
+    const size_t jump_to_end = builder.emit_jump();
+    builder.close_site();
+    builder.patch_jump_to_here(jump_to_else);
+    if (!lower_branch(builder, m_deferred_else, m_else_plan, *destination))
+        return false;
+    builder.close_site();
+    builder.patch_jump_to_here(jump_to_end);
+    return true;
+}
+
+// Deferred steps are lowered outside of the conditional's site, so their errors carry the
+// same prefixes as when they ran before it. Leaves the site of the branch open.
+bool ConditionalAssignmentStep::lower_branch(BytecodeBuilder &builder, const std::vector<const IExecutionStep *> &deferred,
+                                             const ArgumentPlanner::ResolvedArgument &plan, Operand destination) const
+{
+    for (const IExecutionStep *step : deferred)
     {
-        throw EngineException(EngineErrc::UnknownError, std::string("In conditional expression: ") + e.what(), m_line_num);
+        if (!step->lower(builder))
+            return false;
     }
+    builder.open_site(DebugSite::Kind::Conditional, "", m_line_num);
+    auto value = ArgumentPlanner::lower_argument(plan, builder);
+    if (!value)
+        return false;
+    builder.emit_move(*value, destination);
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,409 @@
+#include "include/engine/core/FusedExpression.h"
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/DeviceProgram.h"
+#include "include/engine/core/EngineException.h"
+#include "include/engine/functions/core/kernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    struct StackEntry
+    {
+        const double *data; // Null for uniform values.
+        double value;
+    };
+
+    // Tile buffers and the evaluation stack, reused by every fused call on this thread.
+    struct Workspace
+    {
+        std::vector<double> buffers;
+        std::vector<StackEntry> stack;
+    };
+
+    bool is_arithmetic(OpCode code)
+    {
+        return code == OpCode::ADD || code == OpCode::SUBTRACT || code == OpCode::MULTIPLY || code == OpCode::DIVIDE || code == OpCode::POWER;
+    }
+
+    bool is_unary(OpCode code)
+    {
+        return code == OpCode::LOG || code == OpCode::LOG10 || code == OpCode::EXP || code == OpCode::SIN || code == OpCode::COS || code == OpCode::TAN;
+    }
+
+    bool is_comparison(OpCode code)
+    {
+        return code == OpCode::EQ || code == OpCode::NEQ || code == OpCode::GT || code == OpCode::LT || code == OpCode::GTE || code == OpCode::LTE;
+    }
+
+    double apply_arithmetic(OpCode code, double left, double right)
+    {
+        switch (code)
+        {
+        case OpCode::ADD:
+            return left + right;
+        case OpCode::SUBTRACT:
+            return left - right;
+        case OpCode::MULTIPLY:
+            return left * right;
+        case OpCode::DIVIDE:
+            return left / right;
+        default:
+            return std::pow(left, right);
+        }
+    }
+
+    template <typename Fn>
+    void map_tile(const double *in, double *out, size_t count, Fn fn)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = fn(in[i]);
+        }
+    }
+
+    void apply_unary(OpCode code, const double *in, double *out, size_t count)
+    {
+        switch (code)
+        {
+        case OpCode::LOG:
+            return map_tile(in, out, count, [](double x)
+                            { return std::log(x); });
+        case OpCode::LOG10:
+            return map_tile(in, out, count, [](double x)
+                            { return std::log10(x); });
+        case OpCode::EXP:
+            return map_tile(in, out, count, [](double x)
+                            { return std::exp(x); });
+        case OpCode::SIN:
+            return map_tile(in, out, count, [](double x)
+                            { return std::sin(x); });
+        case OpCode::COS:
+            return map_tile(in, out, count, [](double x)
+                            { return std::cos(x); });
+        default:
+            return map_tile(in, out, count, [](double x)
+                            { return std::tan(x); });
+        }
+    }
+
+    template <typename Pred>
+    void compare_tile(const StackEntry &left, const StackEntry &right, double *out, size_t count, Pred pred)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double l = left.data ? left.data[i] : left.value;
+            const double r = right.data ? right.data[i] : right.value;
+            out[i] = pred(l, r) ? 1.0 : 0.0;
+        }
+    }
+
+    void apply_comparison(OpCode code, const StackEntry &left, const StackEntry &right, double *out, size_t count)
+    {
+        switch (code)
+        {
+        case OpCode::EQ:
+            return compare_tile(left, right, out, count, [](double l, double r)
+                                { return l == r; });
+        case OpCode::NEQ:
+            return compare_tile(left, right, out, count, [](double l, double r)
+                                { return l != r; });
+        case OpCode::GT:
+            return compare_tile(left, right, out, count, [](double l, double r)
+                                { return l > r; });
+        case OpCode::LT:
+            return compare_tile(left, right, out, count, [](double l, double r)
+                                { return l < r; });
+        case OpCode::GTE:
+            return compare_tile(left, right, out, count, [](double l, double r)
+                                { return l >= r; });
+        default:
+            return compare_tile(left, right, out, count, [](double l, double r)
+                                { return l <= r; });
+        }
+    }
+}
+
+FusedExpression::FusedExpression(std::vector<Node> nodes) : m_nodes(std::move(nodes))
+{
+    size_t depth = 0;
+    for (const Node &node : m_nodes)
+    {
+        if (node.code == OpCode::IDENTITY)
+        {
+            ++m_num_leaves;
+            ++depth;
+        }
+        else
+        {
+            depth = depth - node.num_args + 1;
+            m_scalar_only |= !is_arithmetic(node.code);
+        }
+        m_max_depth = std::max(m_max_depth, depth);
+    }
+    m_returns_bool = !m_nodes.empty() && is_comparison(m_nodes.back().code);
+}
+
+bool FusedExpression::can_fuse(const std::string &function_name, size_t num_args, bool as_root)
+{
+    const OpCode code = opcode_for_function(function_name);
+    if (is_arithmetic(code))
+        return num_args >= 1;
+    if (is_unary(code))
+        return num_args == 1;
+    if (is_comparison(code))
+        return as_root && num_args == 2;
+    return false;
+}
+
+bool FusedExpression::calls_only(const std::function<bool(const std::string &function_name)> &accept) const
+{
+    return std::all_of(m_nodes.begin(), m_nodes.end(), [&](const Node &node)
+                       { return node.code == OpCode::IDENTITY || accept(node.function_name); });
+}
+
+size_t FusedExpression::run_tile(const Leaf *leaves, size_t offset, size_t count, double *out) const
+{
+    thread_local Workspace workspace;
+    if (workspace.stack.size() < m_max_depth)
+    {
+        workspace.stack.resize(m_max_depth);
+        workspace.buffers.resize(m_max_depth * TILE);
+    }
+    const ElementwiseKernels &kernels = elementwise_kernels();
+    StackEntry *stack = workspace.stack.data();
+    size_t depth = 0;
+
+    for (size_t n = 0; n < m_nodes.size(); ++n)
+    {
+        const Node &node = m_nodes[n];
+        if (node.code == OpCode::IDENTITY)
+        {
+            const Leaf &leaf = leaves[node.leaf];
+            stack[depth++] = leaf.data ? StackEntry{leaf.data + offset, 0.0} : StackEntry{nullptr, leaf.value};
+            continue;
+        }
+
+        const size_t base = depth - node.num_args;
+        const StackEntry *operands = stack + base;
+        const bool uniform = std::all_of(operands, operands + node.num_args, [](const StackEntry &e)
+                                         { return e.data == nullptr; });
+        depth = base + 1;
+
+        if (uniform)
+        {
+            double value = operands[0].value;
+            if (is_arithmetic(node.code))
+            {
+                for (uint32_t j = 1; j < node.num_args; ++j)
+                {
+                    if (node.code == OpCode::DIVIDE && operands[j].value == 0.0)
+                        return n;
+                    value = apply_arithmetic(node.code, value, operands[j].value);
+                }
+            }
+            else if (is_unary(node.code))
+            {
+                apply_unary(node.code, &operands[0].value, &value, 1);
+            }
+            else
+            {
+                apply_comparison(node.code, operands[0], operands[1], &value, 1);
+            }
+            stack[base] = StackEntry{nullptr, value};
+            continue;
+        }
+
+        // Only the entry at stack position `base` can live in buffer `base`, so the operands to
+        // the right of it are never overwritten while the node is evaluated.
+        double *dest = n + 1 == m_nodes.size() ? out : workspace.buffers.data() + base * TILE;
+        if (is_arithmetic(node.code))
+        {
+            if (node.code == OpCode::DIVIDE)
+            {
+                for (uint32_t j = 1; j < node.num_args; ++j)
+                {
+                    const bool zero = operands[j].data ? kernels.any_zero(operands[j].data, count) : operands[j].value == 0.0;
+                    if (zero)
+                        return n;
+                }
+            }
+            if (!operands[0].data)
+                std::fill(dest, dest + count, operands[0].value);
+            else if (operands[0].data != dest)
+                std::copy(operands[0].data, operands[0].data + count, dest);
+            const size_t op = kernel_index(node.code);
+            for (uint32_t j = 1; j < node.num_args; ++j)
+            {
+                if (operands[j].data)
+                    kernels.vector[op](dest, operands[j].data, count);
+                else
+                    kernels.scalar[op](dest, operands[j].value, count);
+            }
+        }
+        else if (is_unary(node.code))
+        {
+            apply_unary(node.code, operands[0].data, dest, count);
+        }
+        else
+        {
+            apply_comparison(node.code, operands[0], operands[1], dest, count);
+        }
+        stack[base] = StackEntry{dest, 0.0};
+    }
+
+    const StackEntry &result = stack[0];
+    if (!result.data)
+        std::fill(out, out + count, result.value);
+    else if (result.data != out)
+        std::copy(result.data, result.data + count, out);
+    return m_nodes.size();
+}
+
+// One device instruction per operation node, each into a register of its own but the root.
+bool FusedExpression::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const
+{
+    if (num_args != m_num_leaves)
+        return false;
+    std::vector<uint32_t> stack;
+    for (size_t n = 0; n < m_nodes.size(); ++n)
+    {
+        const Node &node = m_nodes[n];
+        if (node.code == OpCode::IDENTITY)
+        {
+            stack.push_back(args[node.leaf]);
+            continue;
+        }
+        DeviceOp op;
+        if (!device_op_for(node.code, op))
+            return false;
+        const size_t base = stack.size() - node.num_args;
+        const uint32_t dest = n + 1 == m_nodes.size() ? result : lowering.temporary();
+        lowering.emit(op, stack.data() + base, node.num_args, dest);
+        stack.resize(base);
+        stack.push_back(dest);
+    }
+    if (stack.back() != result)
+        lowering.emit(DeviceOp::Move, &stack.back(), 1, result);
+    return true;
+}
+
+void FusedExpression::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    thread_local std::vector<Leaf> leaves;
+    leaves.resize(m_num_leaves);
+    size_t length = 0;
+    bool has_series = false;
+    for (size_t k = 0; k < m_num_leaves; ++k)
+    {
+        if (const double *scalar = std::get_if<double>(args[k]))
+        {
+            leaves[k] = Leaf{nullptr, *scalar};
+        }
+        else if (const auto *series = std::get_if<std::vector<double>>(args[k]))
+        {
+            if (has_series && series->size() != length)
+                return evaluate_unfused(args, results);
+            has_series = true;
+            length = series->size();
+            leaves[k] = Leaf{series->data(), 0.0};
+        }
+        else
+        {
+            return evaluate_unfused(args, results);
+        }
+    }
+
+    if (!has_series)
+    {
+        double value = 0.0;
+        if (run_tile(leaves.data(), 0, 1, &value) != m_nodes.size())
+            return evaluate_unfused(args, results);
+        if (m_returns_bool)
+            *results[0] = value != 0.0;
+        else
+            *results[0] = value;
+        return;
+    }
+    if (m_scalar_only || length == 0)
+        return evaluate_unfused(args, results);
+
+    auto &series = assign_series(*results[0], length);
+    for (size_t offset = 0; offset < length; offset += TILE)
+    {
+        const size_t count = std::min(TILE, length - offset);
+        if (run_tile(leaves.data(), offset, count, series.data() + offset) != m_nodes.size())
+            return evaluate_unfused(args, results);
+    }
+}
+
+// Replays the tree through the original functions with the error decoration the unfused
+// argument plan would have applied.
+void FusedExpression::evaluate_unfused(ArgumentSpan args, TrialValue *const *results) const
+{
+    std::vector<TrialValue> stack;
+    stack.reserve(m_max_depth);
+    std::vector<const TrialValue *> operands;
+    for (const Node &node : m_nodes)
+    {
+        if (node.code == OpCode::IDENTITY)
+        {
+            stack.push_back(*args[node.leaf]);
+            continue;
+        }
+        const size_t base = stack.size() - node.num_args;
+        operands.clear();
+        for (size_t j = base; j < stack.size(); ++j)
+        {
+            operands.push_back(&stack[j]);
+        }
+        TrialValue value;
+        TrialValue *value_ref = &value;
+        try
+        {
+            node.logic->execute_into(ArgumentSpan(operands.data(), operands.size()), ResultSpan(&value_ref, 1));
+        }
+        catch (const EngineException &e)
+        {
+            if (!node.decorates_errors)
+                throw;
+            throw EngineException(e.code(), std::string("In nested function '") + node.function_name + "': " + e.what(), node.line_num);
+        }
+        catch (const std::exception &e)
+        {
+            if (!node.decorates_errors)
+                throw;
+            throw EngineException(EngineErrc::UnknownError, std::string("In nested function '") + node.function_name + "': " + e.what(), node.line_num);
+        }
+        stack.resize(base);
+        stack.push_back(std::move(value));
+    }
+    *results[0] = std::move(stack.back());
+}
+
+void FusedExpression::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    thread_local std::vector<Leaf> leaves;
+    leaves.resize(m_num_leaves);
+    for (size_t k = 0; k < m_num_leaves; ++k)
+    {
+        leaves[k] = args[k].stride == 0 ? Leaf{nullptr, args[k].data[0]} : Leaf{args[k].data, 0.0};
+    }
+    for (size_t offset = 0; offset < lanes; offset += TILE)
+    {
+        const size_t count = std::min(TILE, lanes - offset);
+        const size_t failed = run_tile(leaves.data(), offset, count, out + offset);
+        if (failed != m_nodes.size())
+            throw_division_by_zero(failed);
+    }
+}
+
+void FusedExpression::throw_division_by_zero(size_t node_index) const
+{
+    const Node &node = m_nodes[node_index];
+    if (node.decorates_errors)
+    {
+        throw EngineException(EngineErrc::DivisionByZero, "In nested function '" + node.function_name + "': Division by zero", node.line_num);
+    }
+    throw EngineException(EngineErrc::DivisionByZero, "Division by zero");
+}
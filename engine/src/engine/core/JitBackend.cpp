@@ -0,0 +1,510 @@
+// The "jit" device backend, built with -DVSE_ENABLE_LLVM=ON (`vse --jit`). Each DeviceProgram is
+// compiled through LLVM's ORC JIT into one native function that runs the program over every
+// lane of a block: arithmetic, comparisons and selects are inlined, and samplers and
+// Black-Scholes call the same code as run_device_lane(), so results match the "host" device
+// bit for bit. Lane failures set a flag instead of leaving the loop, which keeps the loop
+// vectorizable.
+//
+// Compiled objects are named after a hash of the program, the LLVM version and the host CPU.
+// They are kept for the life of the process and, unless VSE_JIT_CACHE is set to an empty
+// string, in VSE_JIT_CACHE (default $XDG_CACHE_HOME/vse/jit or ~/.cache/vse/jit) between runs.
+#include "include/engine/core/DeviceProgram.h"
+#include "include/engine/core/EngineException.h"
+#include "include/engine/core/ResultCache.h"
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+std::unique_ptr<DeviceBackend> make_jit_backend();
+
+namespace
+{
+    // Bump whenever the generated code changes, so that cached objects are not reused.
+    constexpr uint64_t JIT_FORMAT = 1;
+
+    using SegmentFunction = int32_t (*)(const double *const *inputs, double *const *outputs, uint64_t seed, uint64_t first_trial, uint64_t lanes);
+
+    // Called by the generated code; each matches its case of run_device_lane().
+    double jit_normal(uint64_t seed, uint64_t trial, uint32_t site, double mean, double sd)
+    {
+        uint32_t block[4];
+        first_stream_block(seed, trial, site, block);
+        return mean + sd * box_muller(uniform_from_bits(block[0], block[1]), uniform_from_bits(block[2], block[3]));
+    }
+
+    double jit_lognormal(uint64_t seed, uint64_t trial, uint32_t site, double mu, double sigma)
+    {
+        return std::exp(jit_normal(seed, trial, site, mu, sigma));
+    }
+
+    double jit_uniform(uint64_t seed, uint64_t trial, uint32_t site, double low, double high)
+    {
+        uint32_t block[4];
+        first_stream_block(seed, trial, site, block);
+        return low + (high - low) * uniform_from_bits(block[0], block[1]);
+    }
+
+    double jit_bernoulli(uint64_t seed, uint64_t trial, uint32_t site, double p)
+    {
+        uint32_t block[4];
+        first_stream_block(seed, trial, site, block);
+        return uniform_from_bits(block[0], block[1]) < p ? 1.0 : 0.0;
+    }
+
+    double jit_black_scholes(double S, double K, double r, double T, double v, double sign, int32_t *failed)
+    {
+        if (!valid_black_scholes_inputs(S, K, T, v))
+        {
+            *failed = 1;
+            return 0.0;
+        }
+        return black_scholes_terms(S, K, r, T, v, sign).price;
+    }
+
+    [[noreturn]] void fail(const std::string &what, llvm::Error error)
+    {
+        throw EngineException(EngineErrc::UnknownError, "JIT: " + what + ": " + llvm::toString(std::move(error)));
+    }
+
+    template <typename T>
+    T check(llvm::Expected<T> value, const std::string &what)
+    {
+        if (!value)
+            fail(what, value.takeError());
+        return std::move(*value);
+    }
+
+    std::string cache_directory()
+    {
+        if (const char *directory = std::getenv("VSE_JIT_CACHE"))
+            return directory;
+        if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+            return std::string(xdg) + "/vse/jit";
+        if (const char *home = std::getenv("HOME"); home && *home)
+            return std::string(home) + "/.cache/vse/jit";
+        return "";
+    }
+
+    // Generates the IR of `program` as the function `name`. Register values live in SSA
+    // values; the loop runs one lane per iteration.
+    class SegmentCodegen
+    {
+    public:
+        SegmentCodegen(const DeviceProgram &program, llvm::Module &module)
+            : m_program(program), m_module(module), m_context(module.getContext()), m_builder(m_context) {}
+
+        void emit(const std::string &name)
+        {
+            llvm::Type *f64 = m_builder.getDoubleTy();
+            llvm::Type *i64 = m_builder.getInt64Ty();
+            llvm::Type *f64_ptr = llvm::PointerType::getUnqual(f64);
+            llvm::Type *f64_ptr_ptr = llvm::PointerType::getUnqual(f64_ptr);
+            auto *type = llvm::FunctionType::get(m_builder.getInt32Ty(), {f64_ptr_ptr, f64_ptr_ptr, i64, i64, i64}, false);
+            m_function = llvm::Function::Create(type, llvm::Function::ExternalLinkage, name, m_module);
+            llvm::Argument *inputs = m_function->getArg(0);
+            llvm::Argument *outputs = m_function->getArg(1);
+            m_seed = m_function->getArg(2);
+            llvm::Argument *first_trial = m_function->getArg(3);
+            llvm::Argument *lanes = m_function->getArg(4);
+            for (llvm::Argument &argument : m_function->args())
+            {
+                if (argument.getType()->isPointerTy())
+                    argument.addAttr(llvm::Attribute::NoAlias);
+            }
+
+            auto *entry = llvm::BasicBlock::Create(m_context, "entry", m_function);
+            auto *loop = llvm::BasicBlock::Create(m_context, "lane", m_function);
+            auto *exit = llvm::BasicBlock::Create(m_context, "exit", m_function);
+
+            m_builder.SetInsertPoint(entry);
+            m_failed = m_builder.CreateAlloca(m_builder.getInt32Ty(), nullptr, "failed");
+            m_builder.CreateStore(m_builder.getInt32(0), m_failed);
+            std::vector<llvm::Value *> input_blocks, output_blocks;
+            for (size_t k = 0; k < m_program.inputs.size(); ++k)
+                input_blocks.push_back(m_builder.CreateLoad(f64_ptr, m_builder.CreateConstGEP1_64(f64_ptr, inputs, k)));
+            for (size_t k = 0; k < m_program.outputs.size(); ++k)
+                output_blocks.push_back(m_builder.CreateLoad(f64_ptr, m_builder.CreateConstGEP1_64(f64_ptr, outputs, k)));
+            m_builder.CreateCondBr(m_builder.CreateICmpEQ(lanes, m_builder.getInt64(0)), exit, loop);
+
+            m_builder.SetInsertPoint(loop);
+            llvm::PHINode *lane = m_builder.CreatePHI(i64, 2, "lane");
+            lane->addIncoming(m_builder.getInt64(0), entry);
+            m_trial = m_builder.CreateAdd(first_trial, lane);
+            m_registers.assign(m_program.num_registers, nullptr);
+            for (size_t k = 0; k < m_program.inputs.size(); ++k)
+                m_registers[m_program.inputs[k]] = m_builder.CreateLoad(f64, m_builder.CreateGEP(f64, input_blocks[k], lane));
+            for (const DeviceInstruction &ins : m_program.code)
+                m_registers[ins.result] = instruction(ins);
+            for (size_t k = 0; k < m_program.outputs.size(); ++k)
+                m_builder.CreateStore(value_of(m_program.outputs[k]), m_builder.CreateGEP(f64, output_blocks[k], lane));
+            llvm::Value *next = m_builder.CreateAdd(lane, m_builder.getInt64(1));
+            lane->addIncoming(next, m_builder.GetInsertBlock());
+            m_builder.CreateCondBr(m_builder.CreateICmpULT(next, lanes), loop, exit);
+
+            m_builder.SetInsertPoint(exit);
+            m_builder.CreateRet(m_builder.CreateZExt(m_builder.CreateICmpEQ(m_builder.CreateLoad(m_builder.getInt32Ty(), m_failed), m_builder.getInt32(0)), m_builder.getInt32Ty()));
+        }
+
+    private:
+        llvm::Value *value_of(uint32_t operand)
+        {
+            if (operand & DEVICE_CONSTANT)
+                return llvm::ConstantFP::get(m_builder.getDoubleTy(), m_program.constants[operand & ~DEVICE_CONSTANT]);
+            llvm::Value *value = m_registers[operand];
+            return value ? value : llvm::ConstantFP::get(m_builder.getDoubleTy(), 0.0);
+        }
+
+        llvm::Value *boolean(llvm::Value *condition)
+        {
+            return m_builder.CreateSelect(condition, llvm::ConstantFP::get(m_builder.getDoubleTy(), 1.0), llvm::ConstantFP::get(m_builder.getDoubleTy(), 0.0));
+        }
+
+        llvm::Value *is_true(llvm::Value *value)
+        {
+            return m_builder.CreateFCmpUNE(value, llvm::ConstantFP::get(m_builder.getDoubleTy(), 0.0));
+        }
+
+        void set_failed_if(llvm::Value *condition)
+        {
+            llvm::Value *failed = m_builder.CreateLoad(m_builder.getInt32Ty(), m_failed);
+            m_builder.CreateStore(m_builder.CreateOr(failed, m_builder.CreateZExt(condition, m_builder.getInt32Ty())), m_failed);
+        }
+
+        llvm::Value *intrinsic(llvm::Intrinsic::ID id, std::initializer_list<llvm::Value *> args)
+        {
+            llvm::Function *function = llvm::Intrinsic::getDeclaration(&m_module, id, {m_builder.getDoubleTy()});
+            return m_builder.CreateCall(function, args);
+        }
+
+        llvm::Value *call(const char *name, llvm::Type *result, std::vector<llvm::Type *> types, std::vector<llvm::Value *> args)
+        {
+            llvm::FunctionCallee callee = m_module.getOrInsertFunction(name, llvm::FunctionType::get(result, types, false));
+            return m_builder.CreateCall(callee, args);
+        }
+
+        llvm::Value *sampler(const char *name, const DeviceInstruction &ins, const uint32_t *args)
+        {
+            llvm::Type *f64 = m_builder.getDoubleTy();
+            std::vector<llvm::Type *> types = {m_builder.getInt64Ty(), m_builder.getInt64Ty(), m_builder.getInt32Ty()};
+            std::vector<llvm::Value *> values = {m_seed, m_trial, m_builder.getInt32(ins.site)};
+            for (uint32_t k = 0; k < ins.num_operands; ++k)
+            {
+                types.push_back(f64);
+                values.push_back(value_of(args[k]));
+            }
+            return call(name, f64, types, values);
+        }
+
+        llvm::Value *instruction(const DeviceInstruction &ins)
+        {
+            const uint32_t *args = m_program.operands.data() + ins.first_operand;
+            auto arg = [&](uint32_t k)
+            { return value_of(args[k]); };
+            llvm::Value *value = arg(0);
+            switch (ins.op)
+            {
+            case DeviceOp::Add:
+                for (uint32_t k = 1; k < ins.num_operands; ++k)
+                    value = m_builder.CreateFAdd(value, arg(k));
+                return value;
+            case DeviceOp::Subtract:
+                for (uint32_t k = 1; k < ins.num_operands; ++k)
+                    value = m_builder.CreateFSub(value, arg(k));
+                return value;
+            case DeviceOp::Multiply:
+                for (uint32_t k = 1; k < ins.num_operands; ++k)
+                    value = m_builder.CreateFMul(value, arg(k));
+                return value;
+            case DeviceOp::Divide:
+                for (uint32_t k = 1; k < ins.num_operands; ++k)
+                {
+                    llvm::Value *divisor = arg(k);
+                    set_failed_if(m_builder.CreateFCmpOEQ(divisor, llvm::ConstantFP::get(m_builder.getDoubleTy(), 0.0)));
+                    value = m_builder.CreateFDiv(value, divisor);
+                }
+                return value;
+            case DeviceOp::Power:
+                for (uint32_t k = 1; k < ins.num_operands; ++k)
+                    value = intrinsic(llvm::Intrinsic::pow, {value, arg(k)});
+                return value;
+            case DeviceOp::And:
+                for (uint32_t k = 1; k < ins.num_operands; ++k)
+                    value = boolean(m_builder.CreateAnd(is_true(value), is_true(arg(k))));
+                return value;
+            case DeviceOp::Or:
+                for (uint32_t k = 1; k < ins.num_operands; ++k)
+                    value = boolean(m_builder.CreateOr(is_true(value), is_true(arg(k))));
+                return value;
+            case DeviceOp::Log:
+                return intrinsic(llvm::Intrinsic::log, {value});
+            case DeviceOp::Log10:
+                return intrinsic(llvm::Intrinsic::log10, {value});
+            case DeviceOp::Exp:
+                return intrinsic(llvm::Intrinsic::exp, {value});
+            case DeviceOp::Sin:
+                return intrinsic(llvm::Intrinsic::sin, {value});
+            case DeviceOp::Cos:
+                return intrinsic(llvm::Intrinsic::cos, {value});
+            case DeviceOp::Tan:
+                return call("tan", m_builder.getDoubleTy(), {m_builder.getDoubleTy()}, {value});
+            case DeviceOp::Not:
+                return boolean(m_builder.CreateNot(is_true(value)));
+            case DeviceOp::Move:
+                return value;
+            case DeviceOp::Eq:
+                return boolean(m_builder.CreateFCmpOEQ(value, arg(1)));
+            case DeviceOp::Neq:
+                return boolean(m_builder.CreateFCmpUNE(value, arg(1)));
+            case DeviceOp::Gt:
+                return boolean(m_builder.CreateFCmpOGT(value, arg(1)));
+            case DeviceOp::Lt:
+                return boolean(m_builder.CreateFCmpOLT(value, arg(1)));
+            case DeviceOp::Gte:
+                return boolean(m_builder.CreateFCmpOGE(value, arg(1)));
+            case DeviceOp::Lte:
+                return boolean(m_builder.CreateFCmpOLE(value, arg(1)));
+            case DeviceOp::Select:
+                return m_builder.CreateSelect(is_true(value), arg(1), arg(2));
+            case DeviceOp::Normal:
+                return sampler("vse_jit_normal", ins, args);
+            case DeviceOp::Lognormal:
+                return sampler("vse_jit_lognormal", ins, args);
+            case DeviceOp::Uniform:
+                return sampler("vse_jit_uniform", ins, args);
+            case DeviceOp::Bernoulli:
+                return sampler("vse_jit_bernoulli", ins, args);
+            case DeviceOp::BlackScholesCall:
+            case DeviceOp::BlackScholesPut:
+            {
+                llvm::Type *f64 = m_builder.getDoubleTy();
+                const double sign = ins.op == DeviceOp::BlackScholesCall ? 1.0 : -1.0;
+                return call("vse_jit_black_scholes", f64, {f64, f64, f64, f64, f64, f64, m_failed->getType()},
+                            {value, arg(1), arg(2), arg(3), arg(4), llvm::ConstantFP::get(f64, sign), m_failed});
+            }
+            }
+            return value;
+        }
+
+        const DeviceProgram &m_program;
+        llvm::Module &m_module;
+        llvm::LLVMContext &m_context;
+        llvm::IRBuilder<> m_builder;
+        llvm::Function *m_function = nullptr;
+        llvm::Value *m_seed = nullptr;
+        llvm::Value *m_trial = nullptr;
+        llvm::AllocaInst *m_failed = nullptr;
+        std::vector<llvm::Value *> m_registers;
+    };
+
+    // One JIT for the process. Segments already compiled, by this engine or an earlier one, are
+    // looked up by their hash.
+    class Compiler
+    {
+    public:
+        static Compiler &instance()
+        {
+            static Compiler compiler;
+            return compiler;
+        }
+
+        SegmentFunction compile(const DeviceProgram &program)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const std::string key = hash(program);
+            auto found = m_functions.find(key);
+            if (found != m_functions.end())
+                return found->second;
+
+            const std::string name = "vse_segment_" + key;
+            const std::string directory = cache_directory();
+            std::unique_ptr<llvm::MemoryBuffer> object = load_cached(directory, key);
+            if (!object)
+            {
+                object = generate(program, name);
+                store_cached(directory, key, *object);
+            }
+            if (llvm::Error error = m_jit->addObjectFile(std::move(object)))
+                fail("cannot load the compiled segment", std::move(error));
+            const llvm::JITEvaluatedSymbol symbol = check(m_jit->lookup(name), "cannot find the compiled segment");
+            const auto function = reinterpret_cast<SegmentFunction>(static_cast<uintptr_t>(symbol.getAddress()));
+            m_functions.emplace(key, function);
+            return function;
+        }
+
+    private:
+        Compiler()
+        {
+            llvm::InitializeNativeTarget();
+            llvm::InitializeNativeTargetAsmPrinter();
+            llvm::orc::JITTargetMachineBuilder machine = check(llvm::orc::JITTargetMachineBuilder::detectHost(), "cannot detect the host");
+            machine.getOptions().AllowFPOpFusion = llvm::FPOpFusion::Strict; // Same rounding as the host.
+            m_target = check(machine.createTargetMachine(), "cannot create a target machine");
+            m_jit = check(llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(machine)).create(), "cannot create the JIT");
+
+            llvm::orc::JITDylib &library = m_jit->getMainJITDylib();
+            llvm::orc::SymbolMap helpers;
+            auto define = [&](const char *name, auto *function)
+            {
+                helpers[m_jit->mangleAndIntern(name)] = llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(function), llvm::JITSymbolFlags::Exported);
+            };
+            define("vse_jit_normal", &jit_normal);
+            define("vse_jit_lognormal", &jit_lognormal);
+            define("vse_jit_uniform", &jit_uniform);
+            define("vse_jit_bernoulli", &jit_bernoulli);
+            define("vse_jit_black_scholes", &jit_black_scholes);
+            if (llvm::Error error = library.define(llvm::orc::absoluteSymbols(std::move(helpers))))
+                fail("cannot define the runtime functions", std::move(error));
+            // The math library, for the calls LLVM emits for pow, exp, log and the like.
+            library.addGenerator(check(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(m_jit->getDataLayout().getGlobalPrefix()),
+                                       "cannot search the process for symbols"));
+        }
+
+        std::string hash(const DeviceProgram &program) const
+        {
+            ContentHasher hasher;
+            hasher.add(JIT_FORMAT).add(std::string_view(LLVM_VERSION_STRING)).add(std::string_view(m_target->getTargetTriple().str()));
+            hasher.add(std::string_view(m_target->getTargetCPU())).add(std::string_view(m_target->getTargetFeatureString()));
+            for (const DeviceInstruction &ins : program.code)
+            {
+                hasher.add(static_cast<uint64_t>(ins.op)).add(static_cast<uint64_t>(ins.first_operand)).add(static_cast<uint64_t>(ins.num_operands));
+                hasher.add(static_cast<uint64_t>(ins.result)).add(static_cast<uint64_t>(ins.site));
+            }
+            for (const auto *list : {&program.operands, &program.inputs, &program.outputs})
+            {
+                hasher.add(static_cast<uint64_t>(list->size()));
+                for (uint32_t value : *list)
+                    hasher.add(static_cast<uint64_t>(value));
+            }
+            hasher.add(static_cast<uint64_t>(program.constants.size()));
+            for (double constant : program.constants)
+            {
+                uint64_t bits;
+                std::memcpy(&bits, &constant, sizeof(bits));
+                hasher.add(bits);
+            }
+            return hasher.add(static_cast<uint64_t>(program.num_registers)).hex();
+        }
+
+        std::unique_ptr<llvm::MemoryBuffer> generate(const DeviceProgram &program, const std::string &name) const
+        {
+            llvm::LLVMContext context;
+            llvm::Module module(name, context);
+            module.setTargetTriple(m_target->getTargetTriple().str());
+            module.setDataLayout(m_target->createDataLayout());
+            SegmentCodegen(program, module).emit(name);
+            std::string problems;
+            llvm::raw_string_ostream stream(problems);
+            if (llvm::verifyModule(module, &stream))
+                throw EngineException(EngineErrc::UnknownError, "JIT: invalid code generated for a segment: " + stream.str());
+
+            // -O2, which vectorizes the lane loop where the program allows it.
+            llvm::LoopAnalysisManager loops;
+            llvm::FunctionAnalysisManager functions;
+            llvm::CGSCCAnalysisManager cgscc;
+            llvm::ModuleAnalysisManager modules;
+            llvm::PassBuilder passes(m_target.get());
+            passes.registerModuleAnalyses(modules);
+            passes.registerCGSCCAnalyses(cgscc);
+            passes.registerFunctionAnalyses(functions);
+            passes.registerLoopAnalyses(loops);
+            passes.crossRegisterProxies(loops, functions, cgscc, modules);
+            passes.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2).run(module, modules);
+
+            llvm::SmallVector<char, 0> buffer;
+            llvm::raw_svector_ostream object(buffer);
+            llvm::legacy::PassManager emit;
+            if (m_target->addPassesToEmitFile(emit, object, nullptr, llvm::CGFT_ObjectFile))
+                throw EngineException(EngineErrc::UnknownError, "JIT: the target cannot emit object files.");
+            emit.run(module);
+            return llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(buffer.data(), buffer.size()), name);
+        }
+
+        static std::string cache_path(const std::string &directory, const std::string &key) { return directory + "/" + key + ".o"; }
+
+        static std::unique_ptr<llvm::MemoryBuffer> load_cached(const std::string &directory, const std::string &key)
+        {
+            if (directory.empty())
+                return nullptr;
+            auto buffer = llvm::MemoryBuffer::getFile(cache_path(directory, key));
+            return buffer ? std::move(*buffer) : nullptr;
+        }
+
+        // Written under a temporary name and renamed, so that concurrent runs never read a
+        // partial object. A cache that cannot be written is skipped.
+        static void store_cached(const std::string &directory, const std::string &key, const llvm::MemoryBuffer &object)
+        {
+            if (directory.empty())
+                return;
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+            const std::string path = cache_path(directory, key);
+            const std::string temporary = path + ".tmp" + std::to_string(std::random_device()());
+            {
+                std::ofstream file(temporary, std::ios::binary);
+                file.write(object.getBufferStart(), static_cast<std::streamsize>(object.getBufferSize()));
+                if (!file)
+                {
+                    std::filesystem::remove(temporary, error);
+                    return;
+                }
+            }
+            std::filesystem::rename(temporary, path, error);
+            if (error)
+                std::filesystem::remove(temporary, error);
+        }
+
+        std::mutex m_mutex;
+        std::unique_ptr<llvm::TargetMachine> m_target;
+        std::unique_ptr<llvm::orc::LLJIT> m_jit;
+        std::unordered_map<std::string, SegmentFunction> m_functions;
+    };
+
+    class JitKernel : public DeviceKernel
+    {
+    public:
+        explicit JitKernel(SegmentFunction function) : m_function(function) {}
+
+        bool run(const DeviceLaunch &launch, const double *const *inputs, double *const *outputs) const override
+        {
+            return m_function(inputs, outputs, launch.seed, launch.first_trial, launch.lanes) != 0;
+        }
+
+    private:
+        SegmentFunction m_function;
+    };
+
+    class JitBackend : public DeviceBackend
+    {
+    public:
+        const char *name() const override { return "jit"; }
+        size_t preferred_lane_width() const override { return 1024; }
+        std::unique_ptr<DeviceKernel> prepare(const DeviceProgram &program) const override
+        {
+            return std::make_unique<JitKernel>(Compiler::instance().compile(program));
+        }
+    };
+}
+
+std::unique_ptr<DeviceBackend> make_jit_backend()
+{
+    return std::make_unique<JitBackend>();
+}
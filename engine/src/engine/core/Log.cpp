@@ -0,0 +1,7 @@
+#include "include/engine/core/Log.h"
+#include <iostream>
+
+void log_to_console(LogLevel level, const std::string &message)
+{
+    (level == LogLevel::Warning ? std::cerr : std::cout) << message << std::endl;
+}
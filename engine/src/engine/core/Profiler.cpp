@@ -0,0 +1,179 @@
+#include "include/engine/core/Profiler.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+namespace
+{
+    thread_local uint64_t t_allocations = 0;
+    bool g_counts_allocations = false;
+
+    std::string step_label(const DebugSite &site)
+    {
+        switch (site.kind)
+        {
+        case DebugSite::Kind::Function:
+            return site.function_name;
+        case DebugSite::Kind::Conditional:
+            return "if";
+        default:
+            return "(step)"; // Literals, cached columns and steps the interpreter runs as trees.
+        }
+    }
+}
+
+void record_allocation() noexcept
+{
+    ++t_allocations;
+}
+
+void enable_allocation_counting() noexcept
+{
+    g_counts_allocations = true;
+}
+
+bool counts_allocations()
+{
+    return g_counts_allocations;
+}
+
+uint64_t thread_allocation_count()
+{
+    return t_allocations;
+}
+
+StepProfile::StepProfile(const std::vector<DebugSite> &sites)
+    : m_sites(&sites), m_step_of_site(sites.size()), m_timings(sites.size())
+{
+    // Parents always come before their children. A conditional opens a top-level site for its
+    // condition and one for each branch, all on its line; they count as a single step.
+    uint32_t last_conditional = NO_STEP;
+    for (size_t i = 0; i < sites.size(); ++i)
+    {
+        const DebugSite &site = sites[i];
+        if (site.parent >= 0)
+        {
+            m_step_of_site[i] = m_step_of_site[static_cast<size_t>(site.parent)];
+            continue;
+        }
+        m_step_of_site[i] = static_cast<uint32_t>(i);
+        if (site.kind != DebugSite::Kind::Conditional)
+            continue;
+        if (last_conditional != NO_STEP && sites[last_conditional].line_num == site.line_num)
+            m_step_of_site[i] = last_conditional;
+        else
+            last_conditional = static_cast<uint32_t>(i);
+    }
+}
+
+void StepProfile::switch_to(uint32_t step)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const uint64_t allocations = thread_allocation_count();
+    if (m_current != NO_STEP)
+    {
+        StepTiming &timing = m_timings[m_current];
+        timing.nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_since).count());
+        timing.allocations += allocations - m_allocations_since;
+    }
+    if (step != NO_STEP)
+        ++m_timings[step].runs;
+    m_current = step;
+    m_since = now;
+    m_allocations_since = allocations;
+}
+
+void StepProfile::merge(const StepProfile &other)
+{
+    for (size_t i = 0; i < m_timings.size() && i < other.m_timings.size(); ++i)
+    {
+        m_timings[i].nanoseconds += other.m_timings[i].nanoseconds;
+        m_timings[i].allocations += other.m_timings[i].allocations;
+        m_timings[i].runs += other.m_timings[i].runs;
+    }
+    m_chunks.insert(m_chunks.end(), other.m_chunks.begin(), other.m_chunks.end());
+}
+
+uint64_t StepProfile::total_nanoseconds() const
+{
+    uint64_t total = 0;
+    for (const StepTiming &timing : m_timings)
+        total += timing.nanoseconds;
+    return total;
+}
+
+void StepProfile::print_report(std::ostream &out) const
+{
+    std::vector<size_t> steps;
+    for (size_t i = 0; i < m_timings.size(); ++i)
+    {
+        if (m_timings[i].runs > 0)
+            steps.push_back(i);
+    }
+    std::stable_sort(steps.begin(), steps.end(), [&](size_t a, size_t b)
+                     { return m_timings[a].nanoseconds > m_timings[b].nanoseconds; });
+
+    const uint64_t total = total_nanoseconds();
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << "\n--- Per-Step Profile (all threads) ---" << std::endl;
+    out << std::setw(12) << "time (ms)" << std::setw(8) << "share" << std::setw(12) << "runs"
+        << std::setw(12) << "allocs" << std::setw(7) << "line" << "  step" << std::endl;
+    out << std::fixed;
+    for (size_t step : steps)
+    {
+        const StepTiming &timing = m_timings[step];
+        const DebugSite &site = (*m_sites)[step];
+        const double share = total > 0 ? 100.0 * static_cast<double>(timing.nanoseconds) / static_cast<double>(total) : 0.0;
+        out << std::setw(12) << std::setprecision(3) << static_cast<double>(timing.nanoseconds) / 1e6
+            << std::setw(7) << std::setprecision(1) << share << '%'
+            << std::setw(12) << timing.runs << std::setw(12) << (counts_allocations() ? std::to_string(timing.allocations) : "-")
+            << std::setw(7) << (site.line_num > 0 ? std::to_string(site.line_num) : "-")
+            << "  " << step_label(site) << std::endl;
+    }
+    out << std::setprecision(3) << "Total: " << static_cast<double>(total) / 1e6 << " ms in " << steps.size() << " step(s)";
+    if (!m_chunks.empty())
+    {
+        size_t workers = 0;
+        for (const ChunkSpan &chunk : m_chunks)
+            workers = std::max(workers, chunk.worker + 1);
+        out << ", " << m_chunks.size() << " chunk(s) on " << workers << " worker(s)";
+    }
+    out << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void StepProfile::write_chrome_trace(std::ostream &out) const
+{
+    using json = nlohmann::json;
+    json events = json::array();
+    if (!m_chunks.empty())
+    {
+        const auto origin = std::min_element(m_chunks.begin(), m_chunks.end(), [](const ChunkSpan &a, const ChunkSpan &b)
+                                             { return a.begin < b.begin; })
+                                ->begin;
+        auto microseconds = [](std::chrono::steady_clock::duration duration)
+        { return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) / 1e3; };
+        size_t workers = 0;
+        for (const ChunkSpan &chunk : m_chunks)
+        {
+            workers = std::max(workers, chunk.worker + 1);
+            events.push_back({{"name", "trials " + std::to_string(chunk.first_trial) + "-" + std::to_string(chunk.first_trial + chunk.trials - 1)},
+                              {"cat", "chunk"},
+                              {"ph", "X"},
+                              {"pid", 1},
+                              {"tid", chunk.worker},
+                              {"ts", microseconds(chunk.begin - origin)},
+                              {"dur", microseconds(chunk.end - chunk.begin)},
+                              {"args", {{"first_trial", chunk.first_trial}, {"trials", chunk.trials}}}});
+        }
+        for (size_t worker = 0; worker < workers; ++worker)
+        {
+            events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", worker}, {"args", {{"name", "worker " + std::to_string(worker)}}}});
+        }
+    }
+    out << json{{"traceEvents", events}, {"displayTimeUnit", "ms"}}.dump() << std::endl;
+}
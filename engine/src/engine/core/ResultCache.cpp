@@ -0,0 +1,355 @@
+#include "include/engine/core/ResultCache.h"
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/Random.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <type_traits>
+
+namespace
+{
+    constexpr char COLUMN_MAGIC[8] = {'V', 'S', 'E', 'C', 'O', 'L', '0', '1'};
+    constexpr size_t COLUMN_HEADER_SIZE = 32;
+
+    uint64_t mix64(uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    struct ColumnHeader
+    {
+        uint64_t trials = 0;
+        uint32_t kind = 0;
+        uint64_t num_values = 0;
+    };
+
+    void write_header(std::ostream &out, const ColumnHeader &header)
+    {
+        char bytes[COLUMN_HEADER_SIZE] = {};
+        std::memcpy(bytes, COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+        std::memcpy(bytes + 8, &header.trials, 8);
+        std::memcpy(bytes + 16, &header.kind, 4);
+        std::memcpy(bytes + 24, &header.num_values, 8);
+        out.write(bytes, sizeof(bytes));
+    }
+
+    bool read_header(std::istream &in, ColumnHeader &header)
+    {
+        char bytes[COLUMN_HEADER_SIZE];
+        if (!in.read(bytes, sizeof(bytes)) || std::memcmp(bytes, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) != 0)
+            return false;
+        std::memcpy(&header.trials, bytes + 8, 8);
+        std::memcpy(&header.kind, bytes + 16, 4);
+        std::memcpy(&header.num_values, bytes + 24, 8);
+        return header.kind <= static_cast<uint32_t>(CachedColumn::Kind::Bool);
+    }
+}
+
+// --- ContentHasher ---
+
+ContentHasher &ContentHasher::add(std::string_view bytes)
+{
+    add(static_cast<uint64_t>(bytes.size()));
+    for (unsigned char byte : bytes)
+    {
+        m_low = (m_low ^ byte) * 0x100000001B3ull;
+        m_high = (m_high ^ byte) * 0x100000001B3ull;
+        m_high ^= m_high >> 29;
+    }
+    return *this;
+}
+
+ContentHasher &ContentHasher::add(uint64_t value)
+{
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        const unsigned char byte = static_cast<unsigned char>(value >> shift);
+        m_low = (m_low ^ byte) * 0x100000001B3ull;
+        m_high = (m_high ^ byte) * 0x100000001B3ull;
+        m_high ^= m_high >> 29;
+    }
+    return *this;
+}
+
+ContentHasher &ContentHasher::add(const TrialValue &value)
+{
+    add(static_cast<uint64_t>(value.index()));
+    std::visit([this](const auto &v)
+               {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, double>)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            add(bits);
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            add(static_cast<uint64_t>(v));
+        }
+        else if constexpr (std::is_same_v<T, std::string>)
+        {
+            add(std::string_view(v));
+        }
+        else
+        {
+            add(std::string_view(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(double)));
+        } },
+               value);
+    return *this;
+}
+
+std::string ContentHasher::hex() const
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string text;
+    for (uint64_t word : {mix64(m_low ^ mix64(m_high)), mix64(m_high + 0x9E3779B97F4A7C15ull)})
+    {
+        for (int shift = 60; shift >= 0; shift -= 4)
+            text.push_back(digits[(word >> shift) & 0xF]);
+    }
+    return text;
+}
+
+// --- CachedColumn ---
+
+TrialValue CachedColumn::value(size_t trial) const
+{
+    switch (kind)
+    {
+    case Kind::Scalar:
+        return values[trial];
+    case Kind::Bool:
+        return values[trial] != 0.0;
+    case Kind::Vector:
+        return std::vector<double>(values.begin() + static_cast<std::ptrdiff_t>(offsets[trial]), values.begin() + static_cast<std::ptrdiff_t>(offsets[trial + 1]));
+    }
+    return TrialValue();
+}
+
+// --- ResultCache ---
+
+ResultCache::ResultCache(std::string directory) : m_directory(std::move(directory))
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+}
+
+std::string ResultCache::column_path(const std::string &key, size_t column) const
+{
+    return (std::filesystem::path(m_directory) / (key + "-" + std::to_string(column) + ".col")).string();
+}
+
+bool ResultCache::contains(const std::string &key, size_t columns, size_t trials) const
+{
+    for (size_t c = 0; c < columns; ++c)
+    {
+        std::ifstream in(column_path(key, c), std::ios::binary);
+        ColumnHeader header;
+        if (!in || !read_header(in, header) || header.trials < trials)
+            return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const CachedColumn> ResultCache::load(const std::string &key, size_t column) const
+{
+    std::ifstream in(column_path(key, column), std::ios::binary);
+    ColumnHeader header;
+    if (!in || !read_header(in, header))
+        return nullptr;
+    auto loaded = std::make_shared<CachedColumn>();
+    loaded->kind = static_cast<CachedColumn::Kind>(header.kind);
+    loaded->trials = header.trials;
+    const bool is_vector = loaded->kind == CachedColumn::Kind::Vector;
+    if (!is_vector && header.num_values != header.trials)
+        return nullptr;
+    loaded->values.resize(header.num_values);
+    in.read(reinterpret_cast<char *>(loaded->values.data()), static_cast<std::streamsize>(header.num_values * sizeof(double)));
+    if (is_vector)
+    {
+        loaded->offsets.resize(header.trials + 1);
+        in.read(reinterpret_cast<char *>(loaded->offsets.data()), static_cast<std::streamsize>(loaded->offsets.size() * sizeof(uint64_t)));
+        if (in && (loaded->offsets.front() != 0 || loaded->offsets.back() != header.num_values))
+            return nullptr;
+    }
+    return in ? loaded : nullptr;
+}
+
+// --- ResultCacheWriter ---
+
+ResultCacheWriter::ResultCacheWriter(const ResultCache &cache, std::vector<Entry> entries, size_t first_column, LogCallback log)
+    : m_files(entries.size()), m_first_column(first_column), m_log(std::move(log))
+{
+    std::random_device device;
+    const std::string suffix = ".tmp" + std::to_string(device());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        m_files[i].path = cache.column_path(entries[i].key, entries[i].column);
+        m_files[i].temporary_path = m_files[i].path + suffix;
+    }
+}
+
+ResultCacheWriter::~ResultCacheWriter()
+{
+    for (File &file : m_files)
+    {
+        if (file.stream.is_open())
+            discard(file);
+    }
+}
+
+void ResultCacheWriter::begin(size_t)
+{
+    m_trials = 0;
+}
+
+void ResultCacheWriter::consume(size_t first_trial, const TrialValue *results, size_t count)
+{
+    const TrialValue *columns[] = {results};
+    consume_outputs(first_trial, columns, count);
+}
+
+void ResultCacheWriter::consume_outputs(size_t, const TrialValue *const *columns, size_t count)
+{
+    for (size_t i = 0; i < m_files.size(); ++i)
+    {
+        File &file = m_files[i];
+        const TrialValue *values = columns[m_first_column + i];
+        for (size_t t = 0; t < count && !file.failed; ++t)
+        {
+            append(file, values[t]);
+        }
+    }
+    m_trials += count;
+}
+
+void ResultCacheWriter::append(File &file, const TrialValue &value)
+{
+    CachedColumn::Kind kind;
+    if (std::holds_alternative<double>(value))
+        kind = CachedColumn::Kind::Scalar;
+    else if (std::holds_alternative<bool>(value))
+        kind = CachedColumn::Kind::Bool;
+    else if (std::holds_alternative<std::vector<double>>(value))
+        kind = CachedColumn::Kind::Vector;
+    else
+        return discard(file);
+
+    if (!file.started)
+    {
+        file.started = true;
+        file.kind = kind;
+        file.stream.open(file.temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file.stream)
+            return discard(file);
+        write_header(file.stream, ColumnHeader());
+        file.offsets.push_back(0);
+    }
+    if (kind != file.kind)
+        return discard(file);
+
+    if (const auto *vec = std::get_if<std::vector<double>>(&value))
+    {
+        file.stream.write(reinterpret_cast<const char *>(vec->data()), static_cast<std::streamsize>(vec->size() * sizeof(double)));
+        file.num_values += vec->size();
+        file.offsets.push_back(file.num_values);
+        return;
+    }
+    const double number = kind == CachedColumn::Kind::Bool ? (std::get<bool>(value) ? 1.0 : 0.0) : std::get<double>(value);
+    file.stream.write(reinterpret_cast<const char *>(&number), sizeof(number));
+    ++file.num_values;
+}
+
+void ResultCacheWriter::discard(File &file)
+{
+    file.failed = true;
+    file.offsets.clear();
+    file.offsets.shrink_to_fit();
+    if (file.stream.is_open())
+    {
+        file.stream.close();
+        std::remove(file.temporary_path.c_str());
+    }
+}
+
+void ResultCacheWriter::finish()
+{
+    for (File &file : m_files)
+    {
+        if (!file.started || file.failed)
+            continue;
+        if (file.kind == CachedColumn::Kind::Vector)
+        {
+            file.stream.write(reinterpret_cast<const char *>(file.offsets.data()), static_cast<std::streamsize>(file.offsets.size() * sizeof(uint64_t)));
+        }
+        file.stream.seekp(0);
+        write_header(file.stream, ColumnHeader{m_trials, static_cast<uint32_t>(file.kind), file.num_values});
+        file.stream.close();
+        std::error_code error;
+        if (!file.stream)
+        {
+            std::remove(file.temporary_path.c_str());
+            continue;
+        }
+        std::filesystem::rename(file.temporary_path, file.path, error);
+        if (error)
+        {
+            m_log(LogLevel::Warning, "Warning: Could not store cached results in '" + file.path + "'.");
+            std::remove(file.temporary_path.c_str());
+        }
+    }
+}
+
+// --- CachedColumnStep ---
+
+CachedColumnStep::CachedColumnStep(size_t slot, std::shared_ptr<const CachedColumn> column)
+    : m_slot(slot), m_lookup(std::move(column)) {}
+
+void CachedColumnStep::execute(TrialContext &context) const
+{
+    TrialValue *result = &context[m_slot];
+    m_lookup.execute_into(ArgumentSpan(), ResultSpan(&result, 1));
+}
+
+bool CachedColumnStep::lower(BytecodeBuilder &builder) const
+{
+    auto destination = builder.slot(m_slot);
+    if (!destination)
+        return false;
+    builder.open_site(DebugSite::Kind::Step, "", -1);
+    builder.emit_call(m_lookup, OpCode::CALL, {}, {*destination});
+    builder.close_site();
+    return true;
+}
+
+std::vector<TrialValue> CachedColumnStep::Lookup::execute(const std::vector<TrialValue> &) const
+{
+    return {m_column->value(thread_random_state().first_trial)};
+}
+
+size_t CachedColumnStep::Lookup::execute_into(ArgumentSpan, ResultSpan results) const
+{
+    if (results.size() == 1)
+    {
+        *results[0] = m_column->value(thread_random_state().first_trial);
+    }
+    return 1;
+}
+
+bool CachedColumnStep::Lookup::supports_lanes(size_t num_args) const
+{
+    return num_args == 0 && m_column->kind == CachedColumn::Kind::Scalar;
+}
+
+void CachedColumnStep::Lookup::execute_lanes(const LaneArgument *, size_t, double *out, size_t lanes) const
+{
+    const TrialRandomState &state = thread_random_state();
+    for (size_t i = 0; i < lanes; ++i)
+    {
+        out[i] = m_column->values[lane_trial(state, i)];
+    }
+}
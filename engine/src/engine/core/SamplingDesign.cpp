@@ -0,0 +1,428 @@
+#include "include/engine/core/SamplingDesign.h"
+#include "include/engine/core/EngineException.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    uint64_t splitmix64(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // --- Polynomials over GF(2), as bit masks with bit i the coefficient of x^i ---
+
+    // a * b modulo `poly` of degree `degree`; `a` must already be reduced.
+    uint64_t multiply_mod(uint64_t a, uint64_t b, uint64_t poly, unsigned degree)
+    {
+        uint64_t product = 0;
+        for (; b; b >>= 1)
+        {
+            if (b & 1)
+                product ^= a;
+            a <<= 1;
+            if ((a >> degree) & 1)
+                a ^= poly;
+        }
+        return product;
+    }
+
+    // x^exponent modulo `poly`.
+    uint64_t power_of_x_mod(uint64_t exponent, uint64_t poly, unsigned degree)
+    {
+        uint64_t base = (degree == 1) ? 1 : 2;
+        uint64_t result = 1;
+        for (; exponent; exponent >>= 1)
+        {
+            if (exponent & 1)
+                result = multiply_mod(result, base, poly, degree);
+            base = multiply_mod(base, base, poly, degree);
+        }
+        return result;
+    }
+
+    std::vector<uint64_t> prime_factors(uint64_t n)
+    {
+        std::vector<uint64_t> factors;
+        for (uint64_t p = 2; p * p <= n; ++p)
+        {
+            if (n % p != 0)
+                continue;
+            factors.push_back(p);
+            while (n % p == 0)
+                n /= p;
+        }
+        if (n > 1)
+            factors.push_back(n);
+        return factors;
+    }
+
+    // A polynomial of degree s is primitive when x has order 2^s - 1 modulo it.
+    bool is_primitive(uint64_t poly, unsigned degree, const std::vector<uint64_t> &order_factors)
+    {
+        const uint64_t order = (uint64_t{1} << degree) - 1;
+        if (power_of_x_mod(order, poly, degree) != 1)
+            return false;
+        return std::none_of(order_factors.begin(), order_factors.end(), [&](uint64_t q)
+                            { return power_of_x_mod(order / q, poly, degree) == 1; });
+    }
+
+    // The first `count` primitive polynomials, by degree and then by value.
+    std::vector<uint64_t> primitive_polynomials(size_t count)
+    {
+        std::vector<uint64_t> polys;
+        for (unsigned degree = 1; polys.size() < count && degree < 63; ++degree)
+        {
+            const std::vector<uint64_t> factors = prime_factors((uint64_t{1} << degree) - 1);
+            for (uint64_t poly = (uint64_t{1} << degree) | 1; polys.size() < count && poly < (uint64_t{2} << degree); poly += 2)
+            {
+                if (is_primitive(poly, degree, factors))
+                    polys.push_back(poly);
+            }
+        }
+        return polys;
+    }
+
+    unsigned degree_of(uint64_t poly)
+    {
+        unsigned degree = 0;
+        while (poly >>= 1)
+            ++degree;
+        return degree;
+    }
+
+    // Initial direction numbers m_1..m_s of dimensions 1 to 20, from Joe & Kuo's
+    // new-joe-kuo-6.21201 table, whose polynomials are the first ones primitive_polynomials() finds.
+    const std::vector<std::vector<uint32_t>> JOE_KUO_INITIAL = {
+        {1},
+        {1, 3},
+        {1, 3, 1},
+        {1, 1, 1},
+        {1, 1, 3, 3},
+        {1, 3, 5, 13},
+        {1, 1, 5, 5, 17},
+        {1, 1, 5, 5, 5},
+        {1, 1, 7, 11, 19},
+        {1, 1, 5, 1, 1},
+        {1, 1, 1, 3, 11},
+        {1, 3, 5, 5, 31},
+        {1, 3, 3, 9, 7, 49},
+        {1, 1, 1, 15, 21, 21},
+        {1, 3, 1, 13, 27, 49},
+        {1, 1, 1, 15, 7, 5},
+        {1, 3, 1, 15, 13, 25},
+        {1, 1, 5, 5, 19, 61},
+        {1, 3, 7, 11, 23, 15, 103},
+        {1, 3, 7, 13, 13, 15, 69},
+    };
+
+    uint32_t reverse_bits(uint32_t x)
+    {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+        x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Laine–Karras hash: every output bit depends only on the input bits below it.
+    uint32_t laine_karras_permutation(uint32_t x, uint32_t seed)
+    {
+        x += seed;
+        x ^= x * 0x6C50B47Cu;
+        x ^= x * 0xB82F1E52u;
+        x ^= x * 0xC7AFE638u;
+        x ^= x * 0x8D22F6E6u;
+        return x;
+    }
+
+    // Owen scrambling: on the reversed fraction, each digit is flipped depending on the digits
+    // above it only.
+    uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+    {
+        return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+    }
+
+    // Uniform in (0, 1) from a stream: the midpoint of one of 2^53 cells, never 0 or 1.
+    double open_uniform(RandomStream &stream)
+    {
+        const uint64_t high = stream();
+        const uint64_t low = stream();
+        return (static_cast<double>(((high << 32) | low) >> 11) + 0.5) * 0x1.0p-53;
+    }
+}
+
+SamplingMode parse_sampling_mode(const std::string &sampling, const std::string &variance_reduction)
+{
+    SamplingMode mode;
+    if (sampling.empty() || sampling == "pseudo")
+    {
+        mode = SamplingMode::Pseudo;
+    }
+    else if (sampling == "sobol")
+    {
+        mode = SamplingMode::Sobol;
+    }
+    else
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "Unknown sampling '" + sampling + "'. Expected 'pseudo' or 'sobol'.");
+    }
+    if (variance_reduction.empty() || variance_reduction == "none")
+    {
+        return mode;
+    }
+    if (mode != SamplingMode::Pseudo)
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "variance_reduction '" + variance_reduction + "' cannot be combined with sampling '" + sampling + "'.");
+    }
+    if (variance_reduction == "lhs")
+    {
+        return SamplingMode::LatinHypercube;
+    }
+    if (variance_reduction == "antithetic")
+    {
+        return SamplingMode::Antithetic;
+    }
+    throw EngineException(EngineErrc::RecipeConfigError, "Unknown variance_reduction '" + variance_reduction + "'. Expected 'lhs' or 'antithetic'.");
+}
+
+SobolDesign::SobolDesign(uint32_t dimensions, uint64_t seed)
+    : m_dimensions(dimensions), m_directions(static_cast<size_t>(dimensions) * BITS), m_scrambles(dimensions)
+{
+    const std::vector<uint64_t> polys = primitive_polynomials(dimensions > 0 ? dimensions - 1 : 0);
+    for (uint32_t d = 0; d < dimensions; ++d)
+    {
+        uint32_t *v = m_directions.data() + static_cast<size_t>(d) * BITS;
+        m_scrambles[d] = static_cast<uint32_t>(splitmix64(seed ^ splitmix64(d)));
+        if (d == 0)
+        {
+            for (uint32_t k = 0; k < BITS; ++k)
+                v[k] = uint32_t{1} << (BITS - 1 - k);
+            continue;
+        }
+        // m[k] is odd and below 2^k; the first `degree` are free, the rest follow the recurrence.
+        // Past the table the free ones are fixed pseudo-random numbers; scrambling evens them out.
+        const uint64_t poly = polys[d - 1];
+        const unsigned degree = degree_of(poly);
+        uint64_t m[BITS + 1] = {};
+        for (unsigned k = 1; k <= BITS; ++k)
+        {
+            if (k <= degree)
+            {
+                if (d <= JOE_KUO_INITIAL.size())
+                {
+                    m[k] = JOE_KUO_INITIAL[d - 1][k - 1];
+                    continue;
+                }
+                const uint64_t free_bits = splitmix64((uint64_t{d} << 8) | k) & ((uint64_t{1} << (k - 1)) - 1);
+                m[k] = (free_bits << 1) | 1;
+                continue;
+            }
+            m[k] = m[k - degree] ^ (m[k - degree] << degree);
+            for (unsigned j = 1; j < degree; ++j)
+            {
+                if ((poly >> (degree - j)) & 1)
+                    m[k] ^= m[k - j] << j;
+            }
+        }
+        for (unsigned k = 1; k <= BITS; ++k)
+            v[k - 1] = static_cast<uint32_t>(m[k] << (BITS - k));
+    }
+}
+
+uint32_t SobolDesign::point(uint32_t index, uint32_t dimension) const
+{
+    const uint32_t *v = m_directions.data() + static_cast<size_t>(dimension) * BITS;
+    uint32_t x = 0;
+    for (; index; index >>= 1, ++v)
+    {
+        if (index & 1)
+            x ^= *v;
+    }
+    return x;
+}
+
+// Trial indices wrap every 2^32 trials. Midpoints of the 2^-32 cells keep values off 0 and 1,
+// where inverse distribution functions diverge.
+double SobolDesign::uniform(uint64_t trial, uint32_t site) const
+{
+    const uint32_t x = nested_uniform_scramble(point(static_cast<uint32_t>(trial), site), m_scrambles[site]);
+    return (static_cast<double>(x) + 0.5) * 0x1.0p-32;
+}
+
+LatinHypercubeDesign::LatinHypercubeDesign(uint64_t trials, uint64_t seed)
+    : m_trials(std::max<uint64_t>(trials, 1)), m_seed(seed), m_half_bits(1)
+{
+    while ((uint64_t{1} << (2 * m_half_bits)) < m_trials)
+        ++m_half_bits;
+}
+
+// Cycle walking keeps the permutation inside [0, trials): the Feistel domain is less than four
+// times larger, so the walk takes few steps.
+uint64_t LatinHypercubeDesign::permute(uint64_t index, uint32_t site) const
+{
+    const uint64_t mask = (uint64_t{1} << m_half_bits) - 1;
+    const uint64_t key = splitmix64(m_seed ^ splitmix64(site));
+    do
+    {
+        uint64_t left = index >> m_half_bits;
+        uint64_t right = index & mask;
+        for (uint64_t round = 0; round < 4; ++round)
+        {
+            const uint64_t next = left ^ (splitmix64(right ^ key ^ (round << 56)) & mask);
+            left = right;
+            right = next;
+        }
+        index = (left << m_half_bits) | right;
+    } while (index >= m_trials);
+    return index;
+}
+
+double LatinHypercubeDesign::uniform(uint64_t trial, uint32_t site) const
+{
+    const uint64_t index = trial % m_trials;
+    RandomStream stream(m_seed, index, site);
+    return (static_cast<double>(permute(index, site)) + open_uniform(stream)) / static_cast<double>(m_trials);
+}
+
+double AntitheticDesign::uniform(uint64_t trial, uint32_t site) const
+{
+    RandomStream stream(m_seed, trial / 2, site);
+    const double u = open_uniform(stream);
+    return (trial & 1) ? 1.0 - u : u;
+}
+
+RankCorrelatedDesign::RankCorrelatedDesign(std::unique_ptr<UniformDesign> base, uint64_t seed, uint32_t sites, const std::vector<Group> &groups)
+    : m_base(std::move(base)), m_seed(seed), m_group_of(sites, UNCORRELATED), m_row_of(sites, 0)
+{
+    constexpr double PI = 3.14159265358979323846;
+    for (const Group &group : groups)
+    {
+        const size_t n = group.sites.size();
+        if (group.correlation.size() != n * n)
+            throw EngineException(EngineErrc::RecipeConfigError, "rank_correlations: a matrix of " + std::to_string(n) + " variables needs " + std::to_string(n * n) + " entries.");
+        std::vector<double> pearson(n * n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                const double r = group.correlation[i * n + j];
+                if (!(std::abs(r) <= 1.0) || r != group.correlation[j * n + i] || (i == j && r != 1.0))
+                    throw EngineException(EngineErrc::RecipeConfigError, "rank_correlations: matrices must be symmetric, with ones on the diagonal and entries in [-1, 1].");
+                pearson[i * n + j] = i == j ? 1.0 : 2.0 * std::sin(PI * r / 6.0);
+            }
+        }
+        std::vector<double> factor(n * n);
+        if (!cholesky_factor(pearson.data(), n, factor.data()))
+            throw EngineException(EngineErrc::RecipeConfigError, "rank_correlations: the correlation matrix is not positive definite.");
+
+        const uint32_t index = static_cast<uint32_t>(m_sites.size());
+        for (size_t row = 0; row < n; ++row)
+        {
+            const uint32_t site = group.sites[row];
+            if (site >= sites || m_group_of[site] != UNCORRELATED)
+                throw EngineException(EngineErrc::RecipeConfigError, "rank_correlations: a variable can only be correlated once.");
+            m_group_of[site] = index;
+            m_row_of[site] = static_cast<uint32_t>(row);
+        }
+        m_sites.push_back(group.sites);
+        m_factors.push_back(std::move(factor));
+    }
+}
+
+double RankCorrelatedDesign::base_uniform(uint64_t trial, uint32_t site) const
+{
+    if (m_base)
+        return m_base->uniform(trial, site);
+    RandomStream stream(m_seed, trial, site);
+    return open_uniform(stream);
+}
+
+double RankCorrelatedDesign::uniform(uint64_t trial, uint32_t site) const
+{
+    if (site >= m_group_of.size() || m_group_of[site] == UNCORRELATED)
+        return base_uniform(trial, site);
+    // Row `row` of the factor only mixes the scores of the group's first row + 1 sites.
+    const uint32_t group = m_group_of[site];
+    const uint32_t row = m_row_of[site];
+    const std::vector<uint32_t> &sites = m_sites[group];
+    const double *weights = m_factors[group].data() + static_cast<size_t>(row) * sites.size();
+    double score = 0.0;
+    for (uint32_t k = 0; k <= row; ++k)
+        score += weights[k] * inverse_normal_cdf(base_uniform(trial, sites[k]));
+    const double u = 0.5 * std::erfc(-score / std::sqrt(2.0));
+    return std::min(std::max(u, 0x1.0p-54), 1.0 - 0x1.0p-53);
+}
+
+std::unique_ptr<UniformDesign> make_uniform_design(SamplingMode mode, uint32_t sites, uint64_t trials, uint64_t seed)
+{
+    switch (mode)
+    {
+    case SamplingMode::Pseudo:
+        return nullptr;
+    case SamplingMode::Sobol:
+        return std::make_unique<SobolDesign>(sites, seed);
+    case SamplingMode::LatinHypercube:
+        return std::make_unique<LatinHypercubeDesign>(trials, seed);
+    case SamplingMode::Antithetic:
+        return std::make_unique<AntitheticDesign>(seed);
+    }
+    return nullptr;
+}
+
+double inverse_normal_cdf(double p)
+{
+    // Acklam's rational approximation, polished by one Halley step on erfc to full precision.
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00};
+    constexpr double P_LOW = 0.02425;
+    constexpr double TWO_PI = 6.28318530717958647692;
+    double x;
+    if (p < P_LOW || p > 1.0 - P_LOW)
+    {
+        const double q = std::sqrt(-2.0 * std::log(p < P_LOW ? p : 1.0 - p));
+        x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+        if (p > 1.0 - P_LOW)
+            x = -x;
+    }
+    else
+    {
+        const double q = p - 0.5;
+        const double r = q * q;
+        x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+    }
+    const double e = 0.5 * std::erfc(-x / std::sqrt(2.0)) - p;
+    const double u = e * std::sqrt(TWO_PI) * std::exp(0.5 * x * x);
+    return x - u / (1.0 + 0.5 * x * u);
+}
+
+bool cholesky_factor(const double *matrix, size_t n, double *lower)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j <= i; ++j)
+        {
+            double sum = matrix[i * n + j];
+            for (size_t k = 0; k < j; ++k)
+                sum -= lower[i * n + k] * lower[j * n + k];
+            if (i == j)
+            {
+                if (!(sum > 0.0))
+                    return false;
+                lower[i * n + i] = std::sqrt(sum);
+            }
+            else
+            {
+                lower[i * n + j] = sum / lower[j * n + j];
+            }
+        }
+        for (size_t j = i + 1; j < n; ++j)
+            lower[i * n + j] = 0.0;
+    }
+    return true;
+}
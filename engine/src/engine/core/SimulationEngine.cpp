@@ -1,30 +1,356 @@
 #include "include/engine/core/SimulationEngine.h"
 #include "include/engine/core/ExecutionSteps.h"
 #include "include/engine/core/EngineException.h"
+#include "include/engine/core/Random.h"
+#include "include/engine/core/Statistics.h"
+#include "include/engine/core/StepGraph.h"
+#include "include/engine/io/MappedFile.h"
 
 // Include all the domain registration headers
 #include "include/engine/functions/core/operations.h"
 #include "include/engine/functions/series/operations.h"
 #include "include/engine/functions/statistics/samplers.h"
 #include "include/engine/functions/io/operations.h"
+#include "include/engine/functions/io/CsvTable.h"
 #include "include/engine/functions/financial/financial.h"
 #include "include/engine/functions/epidemiology/epidemiology.h"
 
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
 #include <stdexcept>
-#include <iostream>
+#include <random>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 using json = nlohmann::json;
 
-SimulationEngine::SimulationEngine(const std::string &json_recipe_path, bool is_preview)
-    : m_is_preview(is_preview), m_executable_factory(nullptr)
+namespace
+{
+    // "variable_types": the compiler's static type of each registry entry; "any" is left untyped.
+    std::vector<ValueType> parse_variable_types(const json &types, size_t num_variables)
+    {
+        if (!types.is_array() || types.size() != num_variables)
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "'variable_types' must list one type per entry of the variable registry.");
+        }
+        static const std::unordered_map<std::string, ValueType> names = {
+            {"scalar", ValueType::Scalar},
+            {"vector", ValueType::Series},
+            {"string", ValueType::String},
+            {"boolean", ValueType::Bool},
+            {"any", ValueType::Unknown},
+        };
+        std::vector<ValueType> result;
+        result.reserve(num_variables);
+        for (const json &type : types)
+        {
+            const auto it = type.is_string() ? names.find(type.get<std::string>()) : names.end();
+            if (it == names.end())
+            {
+                throw EngineException(EngineErrc::RecipeConfigError, "Unknown variable type " + type.dump() + " in 'variable_types'.");
+            }
+            result.push_back(it->second);
+        }
+        return result;
+    }
+
+    MappedFile map_recipe_file(const std::string &path)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            throw EngineException(EngineErrc::RecipeFileNotFound, "Failed to open recipe file: " + path);
+        }
+        return file;
+    }
+
+    SensitivityInput parse_sensitivity_input(const json &entry, const json &variable_registry)
+    {
+        SensitivityInput input;
+        if (entry.contains("variable"))
+        {
+            const std::string name = entry.at("variable").get<std::string>();
+            const auto it = std::find(variable_registry.begin(), variable_registry.end(), name);
+            if (it == variable_registry.end())
+            {
+                throw EngineException(EngineErrc::RecipeConfigError, "Unknown sensitivity variable '" + name + "'.");
+            }
+            input.slot = static_cast<size_t>(it - variable_registry.begin());
+        }
+        else
+        {
+            input.slot = entry.at("slot").get<size_t>();
+            if (input.slot >= variable_registry.size())
+            {
+                throw EngineException(EngineErrc::IndexOutOfBounds, "Sensitivity slot " + std::to_string(input.slot) + " is out of bounds of the variable registry.");
+            }
+        }
+        input.low = entry.at("low").get<double>();
+        input.high = entry.at("high").get<double>();
+        return input;
+    }
+
+    // Every slot a step reads or writes must be in the registry, so that steps index their
+    // context unchecked at run time. Reported with the prefix the step reports its errors with.
+    void check_variable_indices(const json &node, size_t num_variables, const std::string &prefix, int line)
+    {
+        if (node.is_array())
+        {
+            for (const auto &item : node)
+                check_variable_indices(item, num_variables, prefix, line);
+            return;
+        }
+        if (!node.is_object())
+            return;
+        const auto type_it = node.find("type");
+        const auto value_it = node.find("value");
+        if (type_it != node.end() && *type_it == "variable_index" && value_it != node.end() && value_it->is_number_unsigned() &&
+            value_it->get<size_t>() >= num_variables)
+        {
+            throw EngineException(EngineErrc::IndexOutOfBounds, prefix + "Variable index " + std::to_string(value_it->get<size_t>()) + " is out of bounds of the variable registry.", line);
+        }
+        for (const auto &item : node.items())
+        {
+            if (item.key() != "value")
+                check_variable_indices(item.value(), num_variables, prefix, line);
+        }
+    }
+
+    void check_step_indices(const json &step_json, size_t num_variables)
+    {
+        const std::string type = step_json.value("type", "");
+        const int line = step_json.value("line", -1);
+        std::string prefix;
+        if (type == "execution_assignment")
+            prefix = "In function '" + step_json.value("function", "") + "': ";
+        else if (type == "conditional_assignment")
+            prefix = "In conditional expression: ";
+        const auto result_it = step_json.find("result");
+        if (result_it != step_json.end())
+        {
+            for (const auto &index : result_it->is_array() ? *result_it : json::array({*result_it}))
+            {
+                if (index.is_number_unsigned() && index.get<size_t>() >= num_variables)
+                {
+                    throw EngineException(EngineErrc::IndexOutOfBounds, prefix + "Result index " + std::to_string(index.get<size_t>()) + " is out of bounds of the variable registry.", line);
+                }
+            }
+        }
+        for (const char *key : {"args", "condition", "then_expr", "else_expr"})
+        {
+            if (step_json.contains(key))
+                check_variable_indices(step_json.at(key), num_variables, prefix, line);
+        }
+    }
+
+    // The step as hashed for the result cache: line numbers dropped, and each variable read
+    // replaced by its position in `reads`, so that renumbering slots keeps the step's identity.
+    json cache_content(const json &node, std::vector<size_t> &reads)
+    {
+        if (node.is_array())
+        {
+            json items = json::array();
+            for (const auto &item : node)
+                items.push_back(cache_content(item, reads));
+            return items;
+        }
+        if (!node.is_object())
+            return node;
+        const auto type_it = node.find("type");
+        const auto value_it = node.find("value");
+        if (type_it != node.end() && *type_it == "variable_index" && value_it != node.end() && value_it->is_number_unsigned())
+        {
+            reads.push_back(value_it->get<size_t>());
+            return json{{"type", "variable_index"}, {"value", reads.size() - 1}};
+        }
+        json object = json::object();
+        for (const auto &item : node.items())
+        {
+            if (item.key() != "line")
+                object[item.key()] = cache_content(item.value(), reads);
+        }
+        return object;
+    }
+
+    // Size and modification time of every file a string in the step names, such as a CSV file
+    // the step reads, so that editing the file invalidates the step's cached results.
+    void append_file_stamps(const json &node, std::string &content)
+    {
+        if (node.is_string())
+        {
+            std::error_code error;
+            const std::string &path = node.get_ref<const std::string &>();
+            if (path.empty() || !std::filesystem::is_regular_file(path, error))
+                return;
+            const auto size = std::filesystem::file_size(path, error);
+            const auto modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+            if (!error)
+                content += "\n" + path + ":" + std::to_string(size) + ":" + std::to_string(modified);
+            return;
+        }
+        if (node.is_structured())
+        {
+            for (const auto &item : node)
+                append_file_stamps(item, content);
+        }
+    }
+
+    // simulation_config "rank_correlations": [{"variables": [...], "matrix": [[...], ...]}], with
+    // each variable named or given by its slot. The call sites of the groups are filled in once
+    // the per-trial steps are built; the slots are returned in `slots`.
+    std::vector<RankCorrelatedDesign::Group> parse_rank_correlations(const json &entries, const json &variable_registry, std::vector<std::vector<size_t>> &slots)
+    {
+        std::vector<RankCorrelatedDesign::Group> groups;
+        for (const auto &entry : entries)
+        {
+            std::vector<size_t> group_slots;
+            for (const auto &variable : entry.at("variables"))
+            {
+                size_t slot;
+                if (variable.is_string())
+                {
+                    const auto it = std::find(variable_registry.begin(), variable_registry.end(), variable);
+                    if (it == variable_registry.end())
+                        throw EngineException(EngineErrc::RecipeConfigError, "Unknown rank_correlations variable '" + variable.get<std::string>() + "'.");
+                    slot = static_cast<size_t>(it - variable_registry.begin());
+                }
+                else
+                {
+                    slot = variable.get<size_t>();
+                    if (slot >= variable_registry.size())
+                        throw EngineException(EngineErrc::IndexOutOfBounds, "rank_correlations slot " + std::to_string(slot) + " is out of bounds of the variable registry.");
+                }
+                group_slots.push_back(slot);
+            }
+            RankCorrelatedDesign::Group group;
+            for (const auto &row : entry.at("matrix"))
+            {
+                if (row.size() != group_slots.size())
+                    throw EngineException(EngineErrc::RecipeConfigError, "rank_correlations: each row of the matrix needs one entry per variable.");
+                for (const auto &value : row)
+                    group.correlation.push_back(value.get<double>());
+            }
+            slots.push_back(std::move(group_slots));
+            groups.push_back(std::move(group));
+        }
+        return groups;
+    }
+
+    PrecisionTarget parse_precision_target(const json &target)
+    {
+        PrecisionTarget precision;
+        if (target.is_number())
+        {
+            precision.standard_error = target.get<double>();
+        }
+        else
+        {
+            precision.standard_error = target.value("standard_error", 0.0);
+            precision.relative_error = target.value("relative_error", 0.0);
+            precision.quantile = target.value("quantile", precision.quantile);
+            precision.quantile_ci_width = target.value("ci_width", 0.0);
+        }
+        const bool valid = precision.standard_error >= 0.0 && precision.relative_error >= 0.0 && precision.quantile_ci_width >= 0.0 &&
+                           precision.quantile > 0.0 && precision.quantile < 1.0;
+        if (!valid || !precision.enabled())
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "'target_precision' needs a positive standard_error, relative_error or ci_width, and a quantile between 0 and 1.");
+        }
+        return precision;
+    }
+
+    // Results of a window of trials, one column of `stride` values per output. The workers
+    // construct the values of the chunks they start out with, so on NUMA machines each one's
+    // share of the window is first touched, and so placed, on its own node.
+    class ResultWindow
+    {
+    public:
+        ResultWindow() = default;
+        ResultWindow(const ResultWindow &) = delete;
+        ResultWindow &operator=(const ResultWindow &) = delete;
+        ~ResultWindow() { release(); }
+
+        TrialValue *data() { return m_values; }
+
+        // Keeps the storage when it holds at least `columns` columns of `stride` values.
+        void reserve(ThreadPool &pool, size_t stride, size_t columns, size_t chunk_size)
+        {
+            if (stride * columns <= m_size)
+                return;
+            release();
+            m_values = static_cast<TrialValue *>(::operator new(stride * columns * sizeof(TrialValue)));
+            pool.parallel_for(stride, chunk_size, [&](size_t, size_t begin, size_t end)
+                              {
+                for (size_t k = 0; k < columns; ++k)
+                {
+                    std::uninitialized_value_construct(m_values + k * stride + begin, m_values + k * stride + end);
+                } });
+            m_size = stride * columns;
+        }
+
+    private:
+        void release()
+        {
+            std::destroy(m_values, m_values + m_size);
+            ::operator delete(m_values);
+            m_values = nullptr;
+            m_size = 0;
+        }
+
+        TrialValue *m_values = nullptr;
+        size_t m_size = 0;
+    };
+}
+
+// The mapping lives until the delegated constructor returns, which is as long as parsing needs it.
+SimulationEngine::SimulationEngine(const std::string &json_recipe_path, bool is_preview, LogCallback log)
+    : SimulationEngine(RecipeText{map_recipe_file(json_recipe_path).view()}, is_preview, std::move(log))
+{
+}
+
+SimulationEngine::SimulationEngine(const RecipeText &recipe, bool is_preview, LogCallback log)
+    : SimulationEngine(parse_recipe(recipe.data), is_preview, std::move(log))
+{
+}
+
+SimulationEngine::SimulationEngine(const json &recipe, bool is_preview, LogCallback log)
+    : m_is_preview(is_preview), m_log(log ? std::move(log) : LogCallback(log_to_console)), m_lane_width(256), m_seed(0), m_executable_factory(nullptr)
 {
     build_function_registry();
-    parse_and_build(json_recipe_path);
+    parse_and_build(recipe);
     run_pre_trial_phase();
+    prepare_result_cache();
+    lower_per_trial_steps();
+    build_batched_program();
+}
+
+std::unique_ptr<SimulationEngine> SimulationEngine::from_recipe_text(std::string_view recipe, bool is_preview, LogCallback log)
+{
+    return std::unique_ptr<SimulationEngine>(new SimulationEngine(RecipeText{recipe}, is_preview, std::move(log)));
+}
+
+std::unique_ptr<SimulationEngine> SimulationEngine::from_recipe(const json &recipe, bool is_preview, LogCallback log)
+{
+    return std::unique_ptr<SimulationEngine>(new SimulationEngine(recipe, is_preview, std::move(log)));
+}
+
+std::string SimulationEngine::read_recipe_file(const std::string &path)
+{
+    return std::string(map_recipe_file(path).view());
+}
+
+bool SimulationEngine::is_binary_recipe(std::string_view recipe)
+{
+    return recipe.size() >= sizeof(BINARY_RECIPE_MAGIC) && std::equal(std::begin(BINARY_RECIPE_MAGIC), std::end(BINARY_RECIPE_MAGIC), recipe.begin(), [](unsigned char expected, char actual)
+                                                                                                  { return expected == static_cast<unsigned char>(actual); });
 }
 
 void SimulationEngine::build_function_registry()
@@ -39,6 +365,19 @@ void SimulationEngine::build_function_registry()
     register_financial_functions(*m_function_registry);
     register_epidemiology_functions(*m_function_registry);
 
+    // Number sampler call sites in recipe order so that their random streams are reproducible.
+    m_function_registry->set_creation_hook([this](const std::string &name, IExecutable &executable)
+                                           {
+        if (auto *sampler = dynamic_cast<Sampler *>(&executable))
+        {
+            sampler->set_call_site(m_next_call_site++);
+            m_site_uses_design.push_back(sampler->uses_design());
+            if (!sampler->uses_design() && std::find(m_stream_samplers.begin(), m_stream_samplers.end(), name) == m_stream_samplers.end())
+                m_stream_samplers.push_back(name);
+            if (!sampler->mirrors_antithetic_pairs() && std::find(m_unmirrored_samplers.begin(), m_unmirrored_samplers.end(), name) == m_unmirrored_samplers.end())
+                m_unmirrored_samplers.push_back(name);
+        } });
+
     // Get a pointer to the factory map for use during parsing
     m_executable_factory = &m_function_registry->get_factory_map();
 }
@@ -48,53 +387,145 @@ std::string SimulationEngine::get_output_file_path() const
     return m_output_file_path;
 }
 
-void SimulationEngine::parse_and_build(const std::string &path)
+json SimulationEngine::parse_recipe(std::string_view recipe)
 {
-    std::ifstream file_stream(path);
-    if (!file_stream.is_open())
-    {
-        throw EngineException(EngineErrc::RecipeFileNotFound, "Failed to open recipe file: " + path);
-    }
     json recipe_json;
+    const bool binary = is_binary_recipe(recipe);
     try
     {
-        recipe_json = json::parse(file_stream);
+        if (binary)
+            recipe_json = json::from_cbor(recipe.begin(), recipe.end(), true, true, json::cbor_tag_handler_t::ignore);
+        else
+            recipe_json = json::parse(recipe.begin(), recipe.end());
     }
     catch (const json::parse_error &e)
     {
-        throw EngineException(EngineErrc::RecipeParseError, "Failed to parse JSON recipe: " + std::string(e.what()));
+        throw EngineException(EngineErrc::RecipeParseError, std::string(binary ? "Failed to parse binary recipe: " : "Failed to parse JSON recipe: ") + e.what());
     }
+    return recipe_json;
+}
 
+void SimulationEngine::parse_and_build(const json &recipe_json)
+{
     try
     {
         const auto &config = recipe_json.at("simulation_config");
         m_num_trials = config.at("num_trials");
-        m_output_variable_index = recipe_json.at("output_variable_index");
+        if (recipe_json.contains("output_variable_indices"))
+        {
+            m_output_variable_indices = recipe_json.at("output_variable_indices").get<std::vector<size_t>>();
+            if (m_output_variable_indices.empty())
+            {
+                throw EngineException(EngineErrc::RecipeConfigError, "'output_variable_indices' must list at least one variable.");
+            }
+        }
+        else
+        {
+            m_output_variable_indices = {recipe_json.at("output_variable_index").get<size_t>()};
+        }
         if (config.contains("output_file") && config.at("output_file").is_string())
         {
             m_output_file_path = config.at("output_file").get<std::string>();
         }
+        m_output_format = parse_output_format(config.value("output_format", std::string()), m_output_file_path);
+        m_summary_bins = config.value("summary_bins", DEFAULT_SUMMARY_BINS);
+        if (m_summary_bins == 0)
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "'summary_bins' must be positive.");
+        }
+        if (config.contains("lane_width"))
+        {
+            m_lane_width = config.at("lane_width").get<size_t>();
+            m_lane_width_configured = true;
+        }
+        if (config.contains("device"))
+        {
+            m_device = make_device_backend(config.at("device").get<std::string>());
+            if (m_device && !m_lane_width_configured)
+            {
+                m_lane_width = m_device->preferred_lane_width();
+            }
+        }
+        if (config.contains("seed"))
+        {
+            m_seed = config.at("seed").get<uint64_t>();
+            m_fixed_seed = true;
+        }
+        else
+        {
+            std::random_device device;
+            m_seed = (static_cast<uint64_t>(device()) << 32) | device();
+        }
+        m_sampling_mode = parse_sampling_mode(config.value("sampling", std::string()), config.value("variance_reduction", std::string()));
+        if (config.contains("target_precision"))
+        {
+            m_precision_target = parse_precision_target(config.at("target_precision"));
+            m_precision_target.max_trials = config.value("max_trials", 100 * static_cast<size_t>(std::max(m_num_trials, 1)));
+            if (m_sampling_mode == SamplingMode::LatinHypercube)
+            {
+                throw EngineException(EngineErrc::RecipeConfigError, "variance_reduction 'lhs' stratifies a fixed number of trials and cannot be combined with target_precision.");
+            }
+        }
+        m_scheduler_config.threads = config.value("threads", m_scheduler_config.threads);
+        m_scheduler_config.chunk_size = config.value("chunk_size", m_scheduler_config.chunk_size);
+        m_scheduler_config.pin_threads = config.value("pin_threads", m_scheduler_config.pin_threads);
+        m_scheduler_config.replicate_inputs = config.value("replicate_inputs", m_scheduler_config.replicate_inputs);
 
-        const size_t num_variables = recipe_json.at("variable_registry").size();
-        if (m_output_variable_index >= num_variables && num_variables > 0)
+        const auto &variable_registry = recipe_json.at("variable_registry");
+        const size_t num_variables = variable_registry.size();
+        for (size_t index : m_output_variable_indices)
+        {
+            if (index >= num_variables && num_variables > 0)
+            {
+                throw EngineException(EngineErrc::IndexOutOfBounds, "Output variable index is out of bounds of the variable registry.");
+            }
+            m_output_names.push_back(index < num_variables && variable_registry[index].is_string() ? variable_registry[index].get<std::string>() : "output_" + std::to_string(index));
+        }
+        if (config.contains("sensitivity"))
+        {
+            for (const auto &entry : config.at("sensitivity"))
+            {
+                SensitivityPlan plan;
+                plan.input = parse_sensitivity_input(entry, variable_registry);
+                const json &name = variable_registry[plan.input.slot];
+                plan.name = name.is_string() ? name.get<std::string>() : "slot_" + std::to_string(plan.input.slot);
+                m_sensitivity.push_back(std::move(plan));
+            }
+        }
+        std::vector<std::vector<size_t>> correlated_slots;
+        if (config.contains("rank_correlations"))
         {
-            throw EngineException(EngineErrc::IndexOutOfBounds, "Output variable index is out of bounds of the variable registry.");
+            m_rank_correlations = parse_rank_correlations(config.at("rank_correlations"), variable_registry, correlated_slots);
+            m_rank_correlation_key = config.at("rank_correlations").dump();
+        }
+        // A seed drawn at random would never match a cached key.
+        const std::string cache_dir = config.value("cache_dir", std::string());
+        if (!cache_dir.empty() && config.contains("seed") && !m_is_preview && !m_precision_target.enabled() && m_sensitivity.empty())
+        {
+            m_result_cache = std::make_unique<ResultCache>(cache_dir);
         }
         m_preloaded_context_vector.resize(num_variables);
+        if (recipe_json.contains("variable_types"))
+        {
+            m_slot_types = parse_variable_types(recipe_json.at("variable_types"), num_variables);
+        }
+        // Every column a file is read for comes from one pass over it, not one per read.
+        CsvTable::preload(recipe_json);
 
-        auto build_step_from_json = [&](const json &step_json) -> std::unique_ptr<IExecutionStep>
+        auto build_step_from_json = [&](const json &step_json, InvariantHoister *hoister) -> std::unique_ptr<IExecutionStep>
         {
             std::string type = step_json.at("type");
             int line = step_json.value("line", -1);
+            check_step_indices(step_json, num_variables);
 
             if (type == "literal_assignment")
             {
                 size_t result_index = step_json.at("result");
                 const auto &val_json = step_json.at("value");
                 TrialValue value;
-                if (val_json.is_array())
+                if (val_json.is_array() || val_json.is_binary())
                 {
-                    value = val_json.get<std::vector<double>>();
+                    value = ArgumentPlanner::vector_literal_values(val_json, line);
                 }
                 else if (val_json.is_number())
                 {
@@ -131,7 +562,7 @@ void SimulationEngine::parse_and_build(const std::string &path)
                 auto executable_logic = factory_it->second();
                 return std::make_unique<ExecutionAssignmentStep>(
                     result_indices, function_name, line,
-                    std::move(executable_logic), step_json.at("args"), *m_executable_factory);
+                    std::move(executable_logic), step_json.at("args"), *m_executable_factory, hoister);
             }
             else if (type == "conditional_assignment")
             {
@@ -139,7 +570,7 @@ void SimulationEngine::parse_and_build(const std::string &path)
                 return std::make_unique<ConditionalAssignmentStep>(
                     result_index, line,
                     step_json.at("condition"), step_json.at("then_expr"), step_json.at("else_expr"),
-                    *m_executable_factory);
+                    *m_executable_factory, hoister);
             }
             else
             {
@@ -151,15 +582,159 @@ void SimulationEngine::parse_and_build(const std::string &path)
         {
             for (const auto &step_json : recipe_json["pre_trial_steps"])
             {
-                m_pre_trial_steps.push_back(build_step_from_json(step_json));
+                m_pre_trial_steps.push_back(build_step_from_json(step_json, nullptr));
             }
         }
+        // Sensitivity inputs change their slot and the results of the pre-trial steps downstream,
+        // except those of the steps assigning the input itself, which the override replaces.
+        if (!m_sensitivity.empty())
+        {
+            const StepGraph pre_trial_graph(recipe_json.value("pre_trial_steps", json::array()));
+            for (SensitivityPlan &plan : m_sensitivity)
+            {
+                plan.changed_slots = {plan.input.slot};
+                const std::vector<bool> affected = pre_trial_graph.downstream(plan.changed_slots);
+                plan.touched_slots = plan.changed_slots;
+                for (size_t i = 0; i < affected.size(); ++i)
+                {
+                    const std::vector<size_t> &writes = pre_trial_graph.writes(i);
+                    if (affected[i] && std::find(writes.begin(), writes.end(), plan.input.slot) == writes.end())
+                        plan.pre_trial_steps.push_back(m_pre_trial_steps[i].get());
+                }
+            }
+        }
+        // Per slot, the call site of the lone sampler call drawing it, for rank_correlations.
+        constexpr uint32_t NOT_DRAWN = UINT32_MAX, NOT_A_DRAW = UINT32_MAX - 1;
+        std::vector<uint32_t> drawn_at(num_variables, NOT_DRAWN);
         if (recipe_json.contains("per_trial_steps"))
         {
+            // Nested calls that only read slots no per-trial step assigns are hoisted out of
+            // the trial loop; the pre-trial phase evaluates them.
+            std::vector<bool> per_trial_slots(num_variables, false);
+            for (const auto &step_json : recipe_json["per_trial_steps"])
+            {
+                // Malformed results are left for build_step_from_json to report.
+                const auto result_it = step_json.find("result");
+                if (result_it == step_json.end())
+                    continue;
+                const json results = result_it->is_array() ? *result_it : json::array({*result_it});
+                for (const auto &index : results)
+                {
+                    if (index.is_number_unsigned() && index.get<size_t>() < num_variables)
+                        per_trial_slots[index.get<size_t>()] = true;
+                }
+            }
+            // Nothing that a sensitivity input changes may be folded into a constant.
+            for (const SensitivityPlan &plan : m_sensitivity)
+            {
+                for (size_t slot : plan.changed_slots)
+                {
+                    if (slot < num_variables)
+                        per_trial_slots[slot] = true;
+                }
+            }
+            m_invariant_hoister = std::make_unique<InvariantHoister>(
+                std::move(per_trial_slots), [registry = m_function_registry.get()](const std::string &name)
+                { return registry->is_pure(name); });
+
             for (const auto &step_json : recipe_json["per_trial_steps"])
             {
-                m_per_trial_steps.push_back(build_step_from_json(step_json));
+                const uint32_t first_call_site = m_next_call_site;
+                m_per_trial_steps.push_back(build_step_from_json(step_json, m_invariant_hoister.get()));
+                if (!m_rank_correlations.empty() && step_json.contains("result"))
+                {
+                    const json results = step_json.at("result").is_array() ? step_json.at("result") : json::array({step_json.at("result")});
+                    const json args = step_json.value("args", json::array());
+                    const bool lone_draw = results.size() == 1 && m_next_call_site == first_call_site + 1 && m_site_uses_design[first_call_site] &&
+                                           step_json.value("type", std::string()) == "execution_assignment" &&
+                                           std::none_of(args.begin(), args.end(), [](const json &arg)
+                                                        { return arg.contains("function") || arg.contains("condition"); });
+                    for (const auto &slot : results)
+                    {
+                        uint32_t &site = drawn_at[slot.get<size_t>()];
+                        site = lone_draw && site == NOT_DRAWN ? first_call_site : NOT_A_DRAW;
+                    }
+                }
+                if (m_result_cache)
+                {
+                    CacheKeySource key;
+                    json content = cache_content(step_json, key.reads);
+                    const auto result_it = step_json.find("result");
+                    if (result_it != step_json.end())
+                    {
+                        const json results = result_it->is_array() ? *result_it : json::array({*result_it});
+                        key.writes = results.get<std::vector<size_t>>();
+                        content["result"] = key.writes.size();
+                    }
+                    key.content = content.dump();
+                    append_file_stamps(step_json, key.content);
+                    key.literal = step_json.value("type", std::string()) == "literal_assignment";
+                    key.first_call_site = first_call_site;
+                    key.end_call_site = m_next_call_site;
+                    m_cache_keys.push_back(std::move(key));
+                }
+            }
+            for (size_t g = 0; g < m_rank_correlations.size(); ++g)
+            {
+                for (size_t slot : correlated_slots[g])
+                {
+                    if (drawn_at[slot] >= NOT_A_DRAW)
+                    {
+                        const json &name = variable_registry[slot];
+                        throw EngineException(EngineErrc::RecipeConfigError, "rank_correlations: variable '" + (name.is_string() ? name.get<std::string>() : std::to_string(slot)) +
+                                                                                 "' must be drawn by a single per-trial call to a sampler such as Normal or Pert, with no calls in its arguments.");
+                    }
+                    m_rank_correlations[g].sites.push_back(drawn_at[slot]);
+                }
+            }
+
+            // Only the steps the output depends on run, and helpers of a single conditional
+            // branch run inside it.
+            // Sensitivity inputs assigned per trial are scheduled like outputs, so that the steps
+            // assigning them are never deferred into a branch that a variant reruns.
+            const StepGraph graph(recipe_json["per_trial_steps"]);
+            std::vector<size_t> scheduled_slots = m_output_variable_indices;
+            for (const SensitivityPlan &plan : m_sensitivity)
+            {
+                scheduled_slots.push_back(plan.input.slot);
+            }
+            const StepGraph::Schedule schedule = graph.schedule(scheduled_slots);
+            for (size_t i = 0; i < m_per_trial_steps.size(); ++i)
+            {
+                if (!schedule.live[i])
+                    continue;
+                if (const auto &deferral = schedule.deferred[i])
+                {
+                    static_cast<ConditionalAssignmentStep &>(*m_per_trial_steps[deferral->conditional]).defer_step(deferral->then_branch, *m_per_trial_steps[i]);
+                    continue;
+                }
+                m_scheduled_steps.push_back(m_per_trial_steps[i].get());
+            }
+            for (size_t i = 0; i < m_cache_keys.size(); ++i)
+            {
+                m_cache_keys[i].live = schedule.live[i];
+                if (const auto &deferral = schedule.deferred[i])
+                    m_cache_keys[i].deferred_into = deferral->conditional;
             }
+            for (SensitivityPlan &plan : m_sensitivity)
+            {
+                std::vector<size_t> changed = plan.changed_slots;
+                const std::vector<bool> affected = graph.downstream(changed);
+                plan.touched_slots = changed;
+                for (size_t i = 0; i < affected.size(); ++i)
+                {
+                    const std::vector<size_t> &writes = graph.writes(i);
+                    const bool reruns = schedule.live[i] && (affected[i] || (schedule.deferred[i] && affected[schedule.deferred[i]->conditional]));
+                    if (reruns)
+                        plan.touched_slots.insert(plan.touched_slots.end(), writes.begin(), writes.end());
+                    if (affected[i] && schedule.live[i] && !schedule.deferred[i] && std::find(writes.begin(), writes.end(), plan.input.slot) == writes.end())
+                        plan.per_trial_steps.push_back(m_per_trial_steps[i].get());
+                }
+                std::sort(plan.touched_slots.begin(), plan.touched_slots.end());
+                plan.touched_slots.erase(std::unique(plan.touched_slots.begin(), plan.touched_slots.end()), plan.touched_slots.end());
+            }
+            m_first_output_varies = graph.calls_impure(graph.schedule({m_output_variable_indices.front()}).live, [registry = m_function_registry.get()](const std::string &name)
+                                                       { return registry->is_pure(name); });
         }
     }
     catch (const json::out_of_range &e)
@@ -170,84 +745,926 @@ void SimulationEngine::parse_and_build(const std::string &path)
     {
         throw EngineException(EngineErrc::RecipeConfigError, "Incorrect type for key in recipe file: " + std::string(e.what()));
     }
+    // Every sampler call site is numbered by now: one dimension of the design each.
+    m_uniform_design = make_design(m_num_trials > 0 ? static_cast<uint64_t>(m_num_trials) : 0, m_seed);
+    warn_about_uncovered_samplers();
 }
 
-void SimulationEngine::run_pre_trial_phase()
+std::unique_ptr<UniformDesign> SimulationEngine::make_design(uint64_t num_trials, uint64_t seed) const
+{
+    std::unique_ptr<UniformDesign> design = make_uniform_design(m_sampling_mode, m_next_call_site, num_trials, seed);
+    if (m_rank_correlations.empty())
+        return design;
+    return std::make_unique<RankCorrelatedDesign>(std::move(design), seed, m_next_call_site, m_rank_correlations);
+}
+
+void SimulationEngine::warn_about_uncovered_samplers() const
+{
+    if (m_is_preview)
+        return;
+    const std::vector<std::string> *uncovered = nullptr;
+    if (m_sampling_mode == SamplingMode::Sobol || m_sampling_mode == SamplingMode::LatinHypercube)
+        uncovered = &m_stream_samplers;
+    else if (m_sampling_mode == SamplingMode::Antithetic)
+        uncovered = &m_unmirrored_samplers;
+    if (uncovered == nullptr || uncovered->empty())
+        return;
+    std::string names;
+    for (const std::string &name : *uncovered)
+    {
+        names += (names.empty() ? "'" : ", '") + name + "'";
+    }
+    m_log(LogLevel::Warning, "Warning: The calls of " + names + " draw from their random streams, not from the sampling design.");
+}
+
+void SimulationEngine::log(const std::string &message) const
 {
     if (!m_is_preview)
     {
-        std::cout << "\n--- Running Pre-Trial Phase ---" << std::endl;
+        m_log(LogLevel::Info, message);
     }
+}
+
+void SimulationEngine::run_pre_trial_phase()
+{
+    log("--- Running Pre-Trial Phase ---");
+    log("Random seed: " + std::to_string(m_seed));
+    // Pre-trial draws are made once, not per trial, so they come from the streams in every sampling mode.
+    TrialRandomState random;
+    random.seed = m_seed;
+    random.first_trial = PRE_TRIAL_INDEX;
+    random.active = true;
+    TrialRandomScope scope(random);
     for (const auto &step : m_pre_trial_steps)
     {
         step->execute(m_preloaded_context_vector);
     }
-    if (!m_is_preview)
+    if (m_invariant_hoister)
     {
-        std::cout << "Pre-trial phase complete. " << m_preloaded_context_vector.size() << " variable slots allocated." << std::endl;
+        m_invariant_hoister->evaluate(m_preloaded_context_vector);
     }
+    log("Pre-trial phase complete. " + std::to_string(m_preloaded_context_vector.size()) + " variable slots allocated.");
 }
 
-void SimulationEngine::run_batch(int num_trials, std::vector<TrialValue> &results, std::exception_ptr &out_exception)
+// Keys every per-trial step by content hash, then walks the schedule backwards from the
+// outputs: steps whose results are needed load them from the cache when it has them and run
+// otherwise, and only the running steps' reads are needed further up. The results of cacheable
+// steps that run become extra result columns, stored by make_cache_writer()'s sink.
+void SimulationEngine::prepare_result_cache()
 {
-    try
+    m_result_slots = m_output_variable_indices;
+    if (!m_result_cache)
+        return;
+
+    // Bumped whenever the meaning of a cached column changes.
+    static constexpr std::string_view CACHE_FORMAT = "vse-result-cache-1";
+    const size_t num_slots = m_preloaded_context_vector.size();
+    const size_t num_steps = m_cache_keys.size();
+    const size_t num_trials = m_num_trials > 0 ? static_cast<size_t>(m_num_trials) : 0;
+
+    // A slot's source is the key column of the last step assigning it so far, or its pre-trial value.
+    std::vector<std::string> sources(num_slots);
+    auto source_of = [&](size_t slot) -> std::string
+    {
+        if (slot >= num_slots)
+            return std::string();
+        if (sources[slot].empty())
+            sources[slot] = ContentHasher().add(std::string_view("pre-trial")).add(m_preloaded_context_vector[slot]).hex();
+        return sources[slot];
+    };
+    std::vector<std::string> keys(num_steps);
+    std::vector<size_t> last_writer(num_slots, num_steps);
+    for (size_t i = 0; i < num_steps; ++i)
     {
-        results.reserve(num_trials);
-        for (int i = 0; i < num_trials; ++i)
+        const CacheKeySource &source = m_cache_keys[i];
+        ContentHasher hasher;
+        hasher.add(CACHE_FORMAT).add(std::string_view(source.content)).add(m_seed).add(static_cast<uint64_t>(m_sampling_mode));
+        if (!m_rank_correlation_key.empty())
+            hasher.add(std::string_view(m_rank_correlation_key));
+        if (m_sampling_mode == SamplingMode::LatinHypercube)
+            hasher.add(static_cast<uint64_t>(num_trials));
+        hasher.add(static_cast<uint64_t>(source.first_call_site)).add(static_cast<uint64_t>(source.end_call_site));
+        for (size_t slot : source.reads)
+            hasher.add(std::string_view(source_of(slot)));
+        keys[i] = hasher.hex();
+        for (size_t k = 0; k < source.writes.size(); ++k)
         {
-            TrialContext trial_context = m_preloaded_context_vector;
-            for (const auto &step : m_per_trial_steps)
+            if (source.writes[k] >= num_slots)
+                continue;
+            sources[source.writes[k]] = keys[i] + "-" + std::to_string(k);
+            if (source.live)
+                last_writer[source.writes[k]] = i;
+        }
+    }
+
+    // Only a step's final values reach the result columns, so a cached step must be the last to
+    // assign each of its slots. Literals are cheaper to assign than to load.
+    std::unordered_map<const IExecutionStep *, size_t> step_index;
+    std::vector<std::vector<size_t>> runs_inside(num_steps); // Deferred steps, by outermost conditional.
+    for (size_t i = 0; i < num_steps; ++i)
+    {
+        step_index[m_per_trial_steps[i].get()] = i;
+        size_t root = i;
+        while (m_cache_keys[root].deferred_into)
+            root = *m_cache_keys[root].deferred_into;
+        runs_inside[root].push_back(i);
+    }
+    auto cacheable = [&](size_t i)
+    {
+        const CacheKeySource &source = m_cache_keys[i];
+        return !source.literal && !source.deferred_into &&
+               std::all_of(source.writes.begin(), source.writes.end(), [&](size_t slot)
+                           { return slot < num_slots && last_writer[slot] == i; });
+    };
+
+    std::vector<bool> needed(num_slots, false);
+    for (size_t slot : m_output_variable_indices)
+    {
+        if (slot < num_slots)
+            needed[slot] = true;
+    }
+    std::vector<const IExecutionStep *> steps;
+    for (auto it = m_scheduled_steps.rbegin(); it != m_scheduled_steps.rend(); ++it)
+    {
+        const size_t i = step_index.at(*it);
+        const std::vector<size_t> &writes = m_cache_keys[i].writes;
+        if (std::none_of(writes.begin(), writes.end(), [&](size_t slot)
+                         { return slot < num_slots && needed[slot]; }))
+            continue;
+        for (size_t slot : writes)
+        {
+            if (slot < num_slots)
+                needed[slot] = false;
+        }
+        if (cacheable(i) && m_result_cache->contains(keys[i], writes.size(), num_trials))
+        {
+            std::vector<std::shared_ptr<const CachedColumn>> columns;
+            for (size_t k = 0; k < writes.size(); ++k)
+            {
+                if (auto column = m_result_cache->load(keys[i], k))
+                    columns.push_back(std::move(column));
+            }
+            if (columns.size() == writes.size())
             {
-                step->execute(trial_context);
+                for (size_t k = 0; k < writes.size(); ++k)
+                {
+                    m_cached_steps.push_back(std::make_unique<CachedColumnStep>(writes[k], std::move(columns[k])));
+                    steps.push_back(m_cached_steps.back().get());
+                }
+                ++m_cached_step_count;
+                continue;
             }
-            if (m_output_variable_index >= trial_context.size())
+        }
+        steps.push_back(*it);
+        for (size_t inside : runs_inside[i])
+        {
+            for (size_t slot : m_cache_keys[inside].reads)
+            {
+                if (slot < num_slots)
+                    needed[slot] = true;
+            }
+        }
+        if (cacheable(i))
+        {
+            for (size_t k = 0; k < writes.size(); ++k)
+            {
+                m_result_slots.push_back(writes[k]);
+                m_cache_entries.push_back({keys[i], k});
+            }
+        }
+    }
+    m_scheduled_steps.assign(steps.rbegin(), steps.rend());
+    log("Result cache: " + std::to_string(m_cached_step_count) + " step(s) loaded from '" + m_result_cache->directory() + "', " +
+        std::to_string(m_scheduled_steps.size() - m_cached_steps.size()) + " to run.");
+}
+
+std::unique_ptr<ResultCacheWriter> SimulationEngine::make_cache_writer() const
+{
+    if (m_cache_entries.empty())
+        return nullptr;
+    return std::make_unique<ResultCacheWriter>(*m_result_cache, m_cache_entries, m_output_variable_indices.size(), m_log);
+}
+
+// Lowering: flatten the per-trial step trees into register-based bytecode. This follows the
+// pre-trial phase so that hoisted calls are lowered as the constants they evaluated to.
+void SimulationEngine::lower_per_trial_steps()
+{
+    BytecodeBuilder builder(m_preloaded_context_vector.size());
+    if (!m_slot_types.empty())
+    {
+        builder.set_slot_types(m_slot_types, m_preloaded_context_vector);
+    }
+    for (const IExecutionStep *step : m_scheduled_steps)
+    {
+        builder.add_step(*step);
+    }
+    m_per_trial_program = builder.finish();
+    for (SensitivityPlan &plan : m_sensitivity)
+    {
+        BytecodeBuilder variant(m_preloaded_context_vector.size());
+        for (const IExecutionStep *step : plan.per_trial_steps)
+        {
+            variant.add_step(*step);
+        }
+        plan.program = variant.finish();
+    }
+    if (!m_slot_types.empty())
+    {
+        log("Typed slots: " + std::to_string(m_per_trial_program.typed_instruction_count()) + " of " +
+            std::to_string(m_per_trial_program.instruction_count()) + " instruction(s) bound at plan time.");
+    }
+}
+
+// Batching is decided after the pre-trial phase, once the types of trial-invariant slots are known.
+void SimulationEngine::build_batched_program()
+{
+    m_batched_program = nullptr;
+    if (m_lane_width > 1)
+    {
+        m_batched_program = BatchedProgram::compile(m_per_trial_program, m_preloaded_context_vector, m_result_slots, m_lane_width, m_device.get(),
+                                                     [registry = m_function_registry.get()](const std::string &name)
+                                                     { return registry->is_cheap(name); });
+    }
+    if (!m_device)
+    {
+        return;
+    }
+    if (!m_batched_program)
+    {
+        log(std::string("Device '") + m_device->name() + "' is not used: the per-trial steps cannot run in batched lanes.");
+        return;
+    }
+    log(std::string("Device '") + m_device->name() + "': " + std::to_string(m_batched_program->device_instructions()) + " instruction(s) in " +
+        std::to_string(m_batched_program->device_segments()) + " segment(s), " + std::to_string(m_lane_width) + " trials per launch.");
+}
+
+void SimulationEngine::set_device(const std::string &name)
+{
+    m_device = make_device_backend(name);
+    if (!m_lane_width_configured)
+    {
+        m_lane_width = m_device ? m_device->preferred_lane_width() : 256;
+    }
+    build_batched_program();
+}
+
+// Per-worker execution state, created on a worker's first chunk and reused for the rest.
+struct SimulationEngine::TrialWorker
+{
+    uint64_t seed = 0;
+    const UniformDesign *design = nullptr;
+    const TrialContext *inputs = nullptr; // Pre-trial values when not the engine's own: a copy on the worker's node.
+    BytecodeFrame frame;
+    TrialContext scratch;
+    BatchedFrame lanes;
+    StepProfile profile; // Only filled while profiling.
+};
+
+void SimulationEngine::run_trials(TrialWorker &worker, size_t first_trial, size_t num_trials, TrialValue *results, size_t column_stride) const
+{
+    TrialRandomState random;
+    random.seed = worker.seed;
+    random.design = worker.design;
+    random.active = true;
+    TrialRandomScope scope(random);
+    TrialRandomState &current = thread_random_state();
+    const TrialContext &inputs = worker.inputs ? *worker.inputs : m_preloaded_context_vector;
+    if (m_batched_program)
+    {
+        const size_t width = m_batched_program->lane_width();
+        for (size_t done = 0; done < num_trials; done += width)
+        {
+            current.first_trial = first_trial + done;
+            m_batched_program->execute(std::min(width, num_trials - done), worker.lanes, results + done, column_stride);
+        }
+        return;
+    }
+    // Pre-trial slots are shared read-only; only the slots the trial writes are per-worker.
+    for (size_t i = 0; i < num_trials; ++i)
+    {
+        current.first_trial = first_trial + i;
+        m_per_trial_program.begin_trial(inputs, worker.scratch);
+        m_per_trial_program.execute(inputs, worker.scratch, worker.frame);
+        for (size_t k = 0; k < m_result_slots.size(); ++k)
+        {
+            const size_t index = m_result_slots[k];
+            if (index >= worker.scratch.size())
             {
                 throw EngineException(EngineErrc::IndexOutOfBounds, "Output variable index is out of bounds. This may indicate an incomplete simulation run.");
             }
-            results.push_back(trial_context.at(m_output_variable_index));
+            results[k * column_stride + i] = m_per_trial_program.is_invariant_slot(index) ? inputs[index] : worker.scratch[index];
         }
     }
-    catch (...)
+}
+
+// Shared by the run() overloads: sizes the pool and the chunks, and keeps the per-worker state.
+struct SimulationEngine::RunState
+{
+    std::shared_ptr<ThreadPool> pool;
+    SchedulerConfig scheduler;
+    size_t chunk_size = 1;
+    uint64_t seed = 0;
+    const UniformDesign *design = nullptr;
+    std::unique_ptr<UniformDesign> own_design; // When the seed or trial count differ from the recipe's.
+    size_t first_trial = 0;                    // Index in the whole run of the sinks' trial 0.
+    bool profiling = false;
+    std::vector<std::unique_ptr<TrialWorker>> workers;
+
+    // With replicate_inputs: the pre-trial values once per NUMA node, each copied by the first
+    // pinned worker of its node, so that they are read from local memory.
+    struct NodeInputs
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<TrialContext>> copies;
+    };
+    std::unique_ptr<NodeInputs> node_inputs;
+};
+
+SimulationEngine::RunState SimulationEngine::prepare_run(size_t num_trials, uint64_t seed, const SchedulerConfig &scheduler, bool profiling) const
+{
+    RunState state;
+    state.scheduler = scheduler;
+    state.seed = seed;
+    state.profiling = profiling;
+    state.design = m_uniform_design.get();
+    if (m_uniform_design && (seed != m_seed || static_cast<int64_t>(num_trials) != m_num_trials))
+    {
+        state.own_design = make_design(num_trials, seed);
+        state.design = state.own_design.get();
+    }
+    const size_t num_threads = scheduler.threads > 0 ? scheduler.threads : std::max(1u, std::thread::hardware_concurrency());
+    state.pool = ThreadPool::shared(num_threads, scheduler.pin_threads);
+    state.chunk_size = chunk_size_for(num_trials, state);
+    state.workers.resize(state.pool->size());
+    if (scheduler.replicate_inputs && state.pool->pins_threads() && state.pool->size() > 1)
+    {
+        state.node_inputs = std::make_unique<RunState::NodeInputs>();
+        state.node_inputs->copies.resize(state.pool->num_nodes());
+    }
+    return state;
+}
+
+size_t SimulationEngine::chunk_size_for(size_t num_trials, const RunState &state) const
+{
+    // Small chunks balance uneven trial costs; the default aims for ~16 chunks per worker.
+    size_t chunk_size = state.scheduler.chunk_size;
+    if (chunk_size == 0)
+    {
+        chunk_size = std::clamp<size_t>(num_trials / (state.pool->size() * 16), 1, 4096);
+    }
+    if (m_batched_program)
+    {
+        const size_t width = m_batched_program->lane_width();
+        chunk_size = (chunk_size + width - 1) / width * width;
+    }
+    return chunk_size;
+}
+
+// `results` holds one column of `column_stride` values per output.
+void SimulationEngine::run_window(RunState &state, size_t first_trial, size_t num_trials, TrialValue *results, size_t column_stride, const ChunkCallback &on_chunk, const ChunkCallback &on_failure) const
+{
+    state.pool->parallel_for(num_trials, state.chunk_size, [&](size_t worker_index, size_t begin, size_t end)
+                             {
+        auto &worker = state.workers[worker_index];
+        if (!worker)
+        {
+            worker = std::make_unique<TrialWorker>();
+            worker->seed = state.seed;
+            worker->design = state.design;
+            // The calling thread, worker 0, is not pinned and keeps the engine's values.
+            if (state.node_inputs && worker_index > 0)
+            {
+                std::lock_guard<std::mutex> lock(state.node_inputs->mutex);
+                auto &copy = state.node_inputs->copies[state.pool->node_of(worker_index)];
+                if (!copy)
+                {
+                    copy = std::make_unique<TrialContext>(m_preloaded_context_vector);
+                }
+                worker->inputs = copy.get();
+            }
+            worker->frame = m_per_trial_program.make_frame();
+            worker->scratch = m_per_trial_program.make_scratch(worker->inputs ? *worker->inputs : m_preloaded_context_vector);
+            if (m_batched_program)
+            {
+                worker->lanes = m_batched_program->make_frame();
+            }
+            if (state.profiling)
+            {
+                worker->profile = StepProfile(m_per_trial_program.sites());
+                worker->frame.profile = &worker->profile;
+                worker->lanes.profile = &worker->profile;
+            }
+        }
+        const auto chunk_begin = state.profiling ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        try
+        {
+            run_trials(*worker, state.first_trial + first_trial + begin, end - begin, results + begin, column_stride);
+        }
+        catch (...)
+        {
+            if (on_failure)
+            {
+                on_failure(worker_index, begin, end);
+            }
+            throw;
+        }
+        if (state.profiling)
+        {
+            worker->profile.record_chunk({worker_index, state.first_trial + first_trial + begin, end - begin, chunk_begin, std::chrono::steady_clock::now()});
+        }
+        if (on_chunk)
+        {
+            on_chunk(worker_index, begin, end);
+        } });
+}
+
+// Merges the profiles of the run's workers into the one get_profile() returns.
+void SimulationEngine::collect_profile(const RunState &state)
+{
+    if (!state.profiling)
+        return;
+    m_profile = StepProfile(m_per_trial_program.sites());
+    for (const auto &worker : state.workers)
     {
-        out_exception = std::current_exception();
+        if (worker)
+            m_profile.merge(worker->profile);
     }
 }
 
 std::vector<TrialValue> SimulationEngine::run()
 {
-    const unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
-    const int trials_per_thread = m_num_trials / num_threads;
-    const int remainder_trials = m_num_trials % num_threads;
+    return std::move(run_outputs().front());
+}
 
-    std::vector<std::thread> threads;
-    std::vector<std::vector<TrialValue>> thread_results(num_threads);
-    std::vector<std::exception_ptr> thread_exceptions(num_threads, nullptr);
+std::vector<std::vector<TrialValue>> SimulationEngine::run_outputs()
+{
+    std::vector<std::vector<TrialValue>> results(m_output_variable_indices.size());
+    if (m_precision_target.enabled())
+    {
+        // The trial count is only known at the end, so results grow through collectors.
+        std::vector<ResultCollector> collectors(results.size());
+        std::vector<OutputColumnSink> columns;
+        std::vector<ResultSink *> sinks;
+        for (size_t k = 0; k < results.size(); ++k)
+        {
+            columns.emplace_back(collectors[k], k);
+        }
+        for (OutputColumnSink &column : columns)
+        {
+            sinks.push_back(&column);
+        }
+        run(sinks);
+        for (size_t k = 0; k < results.size(); ++k)
+        {
+            results[k] = collectors[k].take_results();
+        }
+        return results;
+    }
+
+    const size_t num_trials = m_num_trials > 0 ? static_cast<size_t>(m_num_trials) : 0;
+    RunState state = prepare_run(num_trials, m_seed, m_scheduler_config, m_profiling);
 
-    for (unsigned int i = 0; i < num_threads; ++i)
+    // Every chunk writes straight into its slice of the final result arrays.
+    std::vector<TrialValue> columns(num_trials * m_result_slots.size());
+    run_window(state, 0, num_trials, columns.data(), num_trials, ChunkCallback());
+    collect_profile(state);
+    if (auto writer = make_cache_writer())
     {
-        int trials_for_this_thread = trials_per_thread + (i == 0 ? remainder_trials : 0);
-        if (trials_for_this_thread > 0)
+        std::vector<const TrialValue *> column_starts(m_result_slots.size());
+        for (size_t k = 0; k < column_starts.size(); ++k)
         {
-            threads.emplace_back(&SimulationEngine::run_batch, this, trials_for_this_thread, std::ref(thread_results[i]), std::ref(thread_exceptions[i]));
+            column_starts[k] = columns.data() + k * num_trials;
         }
+        writer->begin(num_trials);
+        writer->consume_outputs(0, column_starts.data(), num_trials);
+        writer->finish();
     }
-    for (auto &t : threads)
+    for (size_t k = 0; k < results.size(); ++k)
     {
-        t.join();
+        const auto column = columns.begin() + static_cast<std::ptrdiff_t>(k * num_trials);
+        results[k].assign(std::make_move_iterator(column), std::make_move_iterator(column + static_cast<std::ptrdiff_t>(num_trials)));
     }
-    for (const auto &ex_ptr : thread_exceptions)
+    return results;
+}
+
+SensitivityReport SimulationEngine::run_sensitivity()
+{
+    const size_t num_trials = m_num_trials > 0 ? static_cast<size_t>(m_num_trials) : 0;
+    const size_t output = m_output_variable_indices.front();
+    const size_t num_variants = 1 + 2 * m_sensitivity.size();
+    if (output >= m_preloaded_context_vector.size())
     {
-        if (ex_ptr)
+        throw EngineException(EngineErrc::IndexOutOfBounds, "Output variable index is out of bounds of the variable registry.");
+    }
+
+    // Values of the changed slots per variant: variant 2i + 1 holds input i low, 2i + 2 high.
+    // The pre-trial steps downstream rerun with the pre-trial random streams, as in the run.
+    std::vector<std::vector<TrialValue>> changed_values(num_variants);
+    {
+        TrialRandomState random;
+        random.seed = m_seed;
+        random.first_trial = PRE_TRIAL_INDEX;
+        random.active = true;
+        TrialRandomScope scope(random);
+        for (size_t v = 1; v < num_variants; ++v)
         {
-            std::rethrow_exception(ex_ptr);
+            const SensitivityPlan &plan = m_sensitivity[(v - 1) / 2];
+            TrialContext context = m_preloaded_context_vector;
+            context[plan.input.slot] = (v % 2 == 1) ? plan.input.low : plan.input.high;
+            for (const IExecutionStep *step : plan.pre_trial_steps)
+            {
+                step->execute(context);
+            }
+            for (size_t slot : plan.changed_slots)
+            {
+                changed_values[v].push_back(context[slot]);
+            }
         }
     }
 
-    std::vector<TrialValue> final_results;
-    final_results.reserve(m_num_trials);
-    for (const auto &partial_results : thread_results)
+    RunState state = prepare_run(num_trials, m_seed, m_scheduler_config, false);
+    std::vector<StatisticsSink> statistics(num_variants);
+    // The trial as written runs on the per-trial program; each variant then runs its plan's
+    // program over the same scratch, which holds every slot so that the variant reads the
+    // trial's values and the pre-trial ones alike.
+    struct SensitivityWorker
     {
-        final_results.insert(final_results.end(), partial_results.begin(), partial_results.end());
+        TrialContext scratch;
+        BytecodeFrame frame;
+        std::vector<BytecodeFrame> variant_frames;
+        std::vector<TrialValue> saved;
+        std::vector<TrialValue> results;
+    };
+    std::vector<std::unique_ptr<SensitivityWorker>> workers(state.pool->size());
+    state.pool->parallel_for(num_trials, state.chunk_size, [&](size_t worker_index, size_t begin, size_t end)
+                             {
+        auto &worker = workers[worker_index];
+        if (!worker)
+        {
+            worker = std::make_unique<SensitivityWorker>();
+            worker->scratch = m_preloaded_context_vector;
+            worker->frame = m_per_trial_program.make_frame();
+            for (const SensitivityPlan &plan : m_sensitivity)
+            {
+                worker->variant_frames.push_back(plan.program.make_frame());
+            }
+        }
+        const size_t count = end - begin;
+        worker->results.resize(num_variants * count);
+        TrialRandomState random;
+        random.seed = m_seed;
+        random.design = m_uniform_design.get();
+        random.active = true;
+        TrialRandomScope scope(random);
+        TrialRandomState &current = thread_random_state();
+        TrialContext &scratch = worker->scratch;
+        for (size_t i = 0; i < count; ++i)
+        {
+            current.first_trial = begin + i;
+            m_per_trial_program.begin_trial(m_preloaded_context_vector, scratch);
+            m_per_trial_program.execute(m_preloaded_context_vector, scratch, worker->frame);
+            worker->results[i] = scratch[output];
+            // Each variant overlays its changed slots, reruns what depends on them and puts
+            // back every slot it wrote.
+            for (size_t v = 1; v < num_variants; ++v)
+            {
+                const size_t p = (v - 1) / 2;
+                const SensitivityPlan &plan = m_sensitivity[p];
+                worker->saved.clear();
+                for (size_t slot : plan.touched_slots)
+                {
+                    worker->saved.push_back(scratch[slot]);
+                }
+                for (size_t c = 0; c < plan.changed_slots.size(); ++c)
+                {
+                    scratch[plan.changed_slots[c]] = changed_values[v][c];
+                }
+                plan.program.execute(scratch, scratch, worker->variant_frames[p]);
+                worker->results[v * count + i] = scratch[output];
+                for (size_t t = 0; t < plan.touched_slots.size(); ++t)
+                {
+                    scratch[plan.touched_slots[t]] = std::move(worker->saved[t]);
+                }
+            }
+        }
+        for (size_t v = 0; v < num_variants; ++v)
+        {
+            statistics[v].consume(begin, worker->results.data() + v * count, count);
+        } });
+
+    SensitivityReport report;
+    report.trials = num_trials;
+    for (StatisticsSink &variant : statistics)
+    {
+        variant.finish();
+        if (num_trials > 0 && variant.kind() != StatisticsSink::Kind::Scalar)
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "Sensitivity analysis needs a scalar first output.");
+        }
+    }
+    auto statistics_of = [&](size_t v)
+    { return statistics[v].periods().empty() ? OutputStatistics() : statistics[v].periods()[0]; };
+    report.base = statistics_of(0);
+    for (size_t i = 0; i < m_sensitivity.size(); ++i)
+    {
+        report.bars.push_back({m_sensitivity[i].input, m_sensitivity[i].name, statistics_of(2 * i + 1), statistics_of(2 * i + 2)});
+    }
+    std::stable_sort(report.bars.begin(), report.bars.end(), [](const SensitivityBar &a, const SensitivityBar &b)
+                     { return a.swing() > b.swing(); });
+    return report;
+}
+
+PreviewResult SimulationEngine::preview(const PreviewOptions &options) const
+{
+    PreviewResult preview;
+    const size_t output = m_output_variable_indices.front();
+    if (output < m_preloaded_context_vector.size() && m_per_trial_program.is_invariant_slot(output))
+    {
+        preview.value = m_preloaded_context_vector[output];
+        preview.converged = true;
+        return preview;
+    }
+    if (!m_first_output_varies && output < m_preloaded_context_vector.size())
+    {
+        // Pure steps give every trial the same value, so evaluate them once in place of a trial.
+        TrialContext context = m_preloaded_context_vector;
+        for (const IExecutionStep *step : m_scheduled_steps)
+        {
+            step->execute(context);
+        }
+        preview.value = std::move(context[output]);
+        preview.converged = true;
+        return preview;
+    }
+
+    const size_t budget = std::min(options.max_trials, m_num_trials > 0 ? static_cast<size_t>(m_num_trials) : 0);
+    if (budget == 0)
+        return preview;
+
+    TrialWorker worker;
+    worker.seed = m_seed;
+    worker.design = m_uniform_design.get();
+    worker.frame = m_per_trial_program.make_frame();
+    worker.scratch = m_per_trial_program.make_scratch(m_preloaded_context_vector);
+    if (m_batched_program)
+    {
+        worker.lanes = m_batched_program->make_frame();
     }
-    return final_results;
-}
\ No newline at end of file
+    const size_t block = m_batched_program ? m_batched_program->lane_width() : 64;
+    std::vector<TrialValue> results(block * m_result_slots.size());
+
+    // The first trial tells the type; only scalar outputs need more.
+    run_trials(worker, 0, 1, results.data(), 1);
+    preview.trials = 1;
+    const double *first = std::get_if<double>(&results[0]);
+    if (!first)
+    {
+        preview.value = std::move(results[0]);
+        preview.converged = true;
+        return preview;
+    }
+
+    OutputStatistics statistics;
+    statistics.add(*first);
+    while (preview.trials < budget)
+    {
+        const size_t count = std::min(block, budget - preview.trials);
+        run_trials(worker, preview.trials, count, results.data(), count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (const double *value = std::get_if<double>(&results[i]))
+                statistics.add(*value);
+        }
+        preview.trials += count;
+        const RunningStatistics &moments = statistics.moments;
+        const double ci_width = 2.0 * 1.96 * moments.stddev() / std::sqrt(static_cast<double>(moments.count));
+        if (preview.trials >= options.min_trials && ci_width <= options.relative_ci_width * std::abs(moments.mean))
+        {
+            preview.converged = true;
+            break;
+        }
+    }
+    preview.value = statistics.moments.mean;
+    preview.distribution = std::move(statistics);
+    return preview;
+}
+
+// Fills in the precision of the first output's statistics so far; true once the target is met.
+bool SimulationEngine::measure_precision(const StatisticsSink &statistics, RunReport &report) const
+{
+    const PrecisionTarget &target = m_precision_target;
+    report.standard_error = report.relative_error = report.quantile_ci_width = 0.0;
+    for (const OutputStatistics &period : statistics.periods())
+    {
+        const double standard_error = period.moments.standard_error();
+        const double mean = std::abs(period.moments.mean);
+        report.standard_error = std::max(report.standard_error, standard_error);
+        if (standard_error > 0.0)
+        {
+            report.relative_error = std::max(report.relative_error, mean > 0.0 ? standard_error / mean : HUGE_VAL);
+        }
+        if (target.quantile_ci_width > 0.0)
+        {
+            report.quantile_ci_width = std::max(report.quantile_ci_width, period.quantiles.confidence_width(target.quantile));
+        }
+    }
+    return (target.standard_error == 0.0 || report.standard_error <= target.standard_error) &&
+           (target.relative_error == 0.0 || report.relative_error <= target.relative_error) &&
+           (target.quantile_ci_width == 0.0 || report.quantile_ci_width <= target.quantile_ci_width);
+}
+
+RunReport SimulationEngine::run(const std::vector<ResultSink *> &sinks)
+{
+    const size_t num_trials = m_num_trials > 0 ? static_cast<size_t>(m_num_trials) : 0;
+    RunState state = prepare_run(num_trials, m_seed, m_scheduler_config, m_profiling);
+    std::vector<size_t> columns(m_output_variable_indices.size());
+    std::iota(columns.begin(), columns.end(), size_t{0});
+    const std::unique_ptr<ResultCacheWriter> cache_writer = m_precision_target.enabled() ? nullptr : make_cache_writer();
+    const RunReport report = stream(state, num_trials, columns, sinks, cache_writer.get());
+    collect_profile(state);
+    return report;
+}
+
+RunReport SimulationEngine::run(const RunOptions &options, const std::vector<ResultSink *> &sinks) const
+{
+    const size_t recipe_trials = m_num_trials > 0 ? static_cast<size_t>(m_num_trials) : 0;
+    const uint64_t seed = options.seed.value_or(m_seed);
+    const size_t num_trials = options.num_trials.value_or(recipe_trials);
+    if (m_cached_step_count > 0 && (seed != m_seed || num_trials != recipe_trials))
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "Runs of a recipe that loads cached results cannot change its seed or num_trials.");
+    }
+    std::vector<size_t> columns;
+    for (const std::string &name : options.outputs)
+    {
+        const auto it = std::find(m_output_names.begin(), m_output_names.end(), name);
+        if (it == m_output_names.end())
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "Unknown output '" + name + "'.");
+        }
+        columns.push_back(static_cast<size_t>(it - m_output_names.begin()));
+    }
+    if (options.outputs.empty())
+    {
+        columns.resize(m_output_variable_indices.size());
+        std::iota(columns.begin(), columns.end(), size_t{0});
+    }
+    RunState state = prepare_run(num_trials, seed, options.scheduler.value_or(m_scheduler_config), false);
+    if (!options.range)
+    {
+        return stream(state, num_trials, columns, sinks, nullptr);
+    }
+    const TrialRange &range = *options.range;
+    if (range.first > num_trials || range.count > num_trials - range.first)
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "Trials " + std::to_string(range.first) + " to " + std::to_string(range.first + range.count) +
+                                                                 " are not within the run's " + std::to_string(num_trials) + " trials.");
+    }
+    if (m_precision_target.enabled())
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "Runs with a target_precision cannot be split into ranges of trials.");
+    }
+    // The design stays that of the whole run, so each trial draws what it would there.
+    state.first_trial = range.first;
+    state.chunk_size = chunk_size_for(range.count, state);
+    return stream(state, range.count, columns, sinks, nullptr);
+}
+
+RunReport SimulationEngine::stream(RunState &state, size_t num_trials, const std::vector<size_t> &columns, const std::vector<ResultSink *> &sinks, ResultCacheWriter *cache_writer) const
+{
+    const bool adaptive = m_precision_target.enabled();
+    // Cached columns are only known to cover num_trials trials.
+    const size_t max_trials = adaptive && m_cached_step_count == 0 ? std::max(num_trials, m_precision_target.max_trials) : num_trials;
+
+    // With a precision target, the first output is also summarised per round to measure it.
+    StatisticsSink monitor;
+    std::vector<ResultSink *> ordered;
+    std::vector<ResultSink *> unordered;
+    std::vector<ResultSink *> all_sinks = sinks;
+    if (cache_writer)
+    {
+        all_sinks.push_back(cache_writer);
+    }
+    std::vector<std::string> names;
+    for (size_t column : columns)
+    {
+        names.push_back(m_output_names[column]);
+    }
+    for (ResultSink *sink : all_sinks)
+    {
+        (sink->ordered() ? ordered : unordered).push_back(sink);
+        sink->set_outputs(names);
+        sink->begin(num_trials);
+    }
+
+    // Trials run in windows of a few chunks per worker through one reused buffer, so memory does
+    // not grow with num_trials. Unordered sinks see each chunk as soon as it is done; ordered
+    // sinks see each window once all of it is done.
+    // The buffer holds one column per output, so every output reaches the sinks contiguously,
+    // followed by the columns the result cache stores. The sinks receive the selected outputs,
+    // then the cached columns when there is a cache writer to store them.
+    std::vector<size_t> sources = columns;
+    if (cache_writer)
+    {
+        for (size_t k = m_output_variable_indices.size(); k < m_result_slots.size(); ++k)
+        {
+            sources.push_back(k);
+        }
+    }
+    const size_t num_outputs = m_result_slots.size();
+    ResultWindow buffer;
+    std::vector<const TrialValue *> sink_columns(sources.size());
+    // Each worker's view of the chunk it hands to the unordered sinks.
+    std::vector<std::vector<const TrialValue *>> chunk_columns(unordered.empty() ? 0 : state.pool->size(), std::vector<const TrialValue *>(sources.size()));
+    RunReport report;
+    size_t window = 0;
+    size_t first = 0;
+    ChunkCallback on_chunk;
+    ChunkCallback on_failure;
+    if (!unordered.empty() || adaptive)
+    {
+        on_failure = [&](size_t, size_t begin, size_t end)
+        {
+            for (ResultSink *sink : unordered)
+            {
+                sink->fail(first + begin, end - begin);
+            }
+        };
+        on_chunk = [&](size_t worker, size_t begin, size_t end)
+        {
+            if (adaptive)
+            {
+                monitor.consume(first + begin, buffer.data() + begin, end - begin);
+            }
+            if (unordered.empty())
+            {
+                return;
+            }
+            std::vector<const TrialValue *> &chunk = chunk_columns[worker];
+            for (size_t k = 0; k < sources.size(); ++k)
+            {
+                chunk[k] = buffer.data() + sources[k] * window + begin;
+            }
+            for (ResultSink *sink : unordered)
+            {
+                sink->consume_outputs(first + begin, chunk.data(), end - begin);
+            }
+        };
+    }
+    size_t done = 0;
+    for (size_t total = num_trials;;)
+    {
+        window = std::min(total - done, state.chunk_size * state.pool->size() * 8);
+        buffer.reserve(*state.pool, window, num_outputs, state.chunk_size);
+        for (first = done; first < total; first += window)
+        {
+            const size_t count = std::min(window, total - first);
+            run_window(state, first, count, buffer.data(), window, on_chunk, on_failure);
+            for (size_t k = 0; k < sources.size(); ++k)
+            {
+                sink_columns[k] = buffer.data() + sources[k] * window;
+            }
+            for (ResultSink *sink : ordered)
+            {
+                sink->consume_outputs(first, sink_columns.data(), count);
+            }
+        }
+        done = total;
+        ++report.rounds;
+        if (!adaptive)
+            break;
+
+        monitor.finish();
+        const bool measurable = monitor.kind() == StatisticsSink::Kind::Scalar || monitor.kind() == StatisticsSink::Kind::Vector;
+        report.converged = measurable && measure_precision(monitor, report);
+        if (report.converged || !measurable || done >= max_trials)
+            break;
+
+        // Errors shrink with the square root of the trial count: aim a little past the projected
+        // total, but at most quadruple the trials per round, since early estimates are noisy.
+        double ratio = 1.0;
+        const PrecisionTarget &target = m_precision_target;
+        if (target.standard_error > 0.0)
+            ratio = std::max(ratio, report.standard_error / target.standard_error);
+        if (target.relative_error > 0.0)
+            ratio = std::max(ratio, report.relative_error / target.relative_error);
+        if (target.quantile_ci_width > 0.0)
+            ratio = std::max(ratio, report.quantile_ci_width / target.quantile_ci_width);
+        const double projected = 1.1 * static_cast<double>(done) * ratio * ratio;
+        const size_t minimum_round = state.chunk_size * state.pool->size();
+        const size_t next = std::clamp<size_t>(static_cast<size_t>(std::min(projected, 4.0 * static_cast<double>(done))), done + minimum_round, std::max<size_t>(4 * done, done + minimum_round));
+        total = std::min(next, max_trials);
+        state.chunk_size = chunk_size_for(total - done, state);
+        for (ResultSink *sink : sinks)
+        {
+            sink->extend(total);
+        }
+    }
+    report.trials = done;
+
+    for (ResultSink *sink : all_sinks)
+    {
+        sink->finish();
+    }
+    return report;
+}
@@ -0,0 +1,305 @@
+#include "include/engine/core/Statistics.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Welford's update extended to the third and fourth moments (Terriberry).
+void RunningStatistics::add(double value)
+{
+    if (count == 0)
+    {
+        min = max = value;
+    }
+    else
+    {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    const double n1 = static_cast<double>(count);
+    ++count;
+    const double n = static_cast<double>(count);
+    const double delta = value - mean;
+    const double delta_n = delta / n;
+    const double delta_n2 = delta_n * delta_n;
+    const double term = delta * delta_n * n1;
+    mean += delta_n;
+    m4 += term * delta_n2 * (n * n - 3.0 * n + 3.0) + 6.0 * delta_n2 * m2 - 4.0 * delta_n * m3;
+    m3 += term * delta_n * (n - 2.0) - 3.0 * delta_n * m2;
+    m2 += term;
+}
+
+// Pébay's pairwise update of the central moments ("Formulas for robust, one-pass parallel
+// computation of covariances and arbitrary-order statistical moments", 2008).
+void RunningStatistics::merge(const RunningStatistics &other)
+{
+    if (other.count == 0)
+    {
+        return;
+    }
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+    const double n_a = static_cast<double>(count);
+    const double n_b = static_cast<double>(other.count);
+    const double n = n_a + n_b;
+    const double delta = other.mean - mean;
+    const double delta_n = delta / n;
+    const double delta_n2 = delta_n * delta_n;
+
+    m4 += other.m4 + delta * delta_n * delta_n2 * n_a * n_b * (n_a * n_a - n_a * n_b + n_b * n_b) +
+          6.0 * delta_n2 * (n_a * n_a * other.m2 + n_b * n_b * m2) + 4.0 * delta_n * (n_a * other.m3 - n_b * m3);
+    m3 += other.m3 + delta * delta_n2 * n_a * n_b * (n_a - n_b) + 3.0 * delta_n * (n_a * other.m2 - n_b * m2);
+    m2 += other.m2 + delta * delta_n * n_a * n_b;
+    mean += delta_n * n_b;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    count += other.count;
+}
+
+double RunningStatistics::variance() const
+{
+    return count > 0 ? m2 / static_cast<double>(count) : 0.0;
+}
+
+double RunningStatistics::stddev() const
+{
+    return std::sqrt(variance());
+}
+
+double RunningStatistics::standard_error() const
+{
+    return count > 0 ? std::sqrt(variance() / static_cast<double>(count)) : 0.0;
+}
+
+double RunningStatistics::skewness() const
+{
+    if (count == 0 || m2 == 0.0)
+    {
+        return 0.0;
+    }
+    return std::sqrt(static_cast<double>(count)) * m3 / std::pow(m2, 1.5);
+}
+
+double RunningStatistics::kurtosis() const
+{
+    if (count == 0 || m2 == 0.0)
+    {
+        return 0.0;
+    }
+    return static_cast<double>(count) * m4 / (m2 * m2) - 3.0;
+}
+
+namespace
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    // The k1 scale function of the t-digest and its inverse.
+    double scale(double q, double compression) { return compression / (2.0 * PI) * std::asin(2.0 * q - 1.0); }
+    double inverse_scale(double k, double compression) { return (std::sin(k * 2.0 * PI / compression) + 1.0) / 2.0; }
+}
+
+QuantileSketch::QuantileSketch(double compression) : m_compression(compression) {}
+
+QuantileSketch QuantileSketch::from_centroids(std::vector<Centroid> centroids, double min, double max, double compression)
+{
+    QuantileSketch sketch(compression);
+    std::sort(centroids.begin(), centroids.end(), [](const Centroid &a, const Centroid &b)
+              { return a.mean < b.mean; });
+    for (const Centroid &c : centroids)
+    {
+        sketch.m_total_weight += c.weight;
+    }
+    sketch.m_centroids = std::move(centroids);
+    sketch.m_min = min;
+    sketch.m_max = max;
+    return sketch;
+}
+
+void QuantileSketch::add(double value, double weight)
+{
+    if (m_total_weight == 0.0 && m_buffer.empty())
+    {
+        m_min = m_max = value;
+    }
+    else
+    {
+        m_min = std::min(m_min, value);
+        m_max = std::max(m_max, value);
+    }
+    m_buffer.push_back(Centroid{value, weight});
+    if (m_buffer.size() >= static_cast<size_t>(5.0 * m_compression))
+    {
+        compress();
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    other.compress();
+    if (other.m_centroids.empty())
+    {
+        return;
+    }
+    if (m_total_weight == 0.0 && m_buffer.empty())
+    {
+        m_min = other.m_min;
+        m_max = other.m_max;
+    }
+    else
+    {
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+    }
+    m_buffer.insert(m_buffer.end(), other.m_centroids.begin(), other.m_centroids.end());
+    compress();
+}
+
+// Folds the pending points into the centroids: all of them are sorted by mean and neighbours are
+// merged greedily while the merged centroid stays within one unit of the scale function.
+void QuantileSketch::compress() const
+{
+    if (m_buffer.empty())
+    {
+        return;
+    }
+    m_buffer.insert(m_buffer.end(), m_centroids.begin(), m_centroids.end());
+    std::sort(m_buffer.begin(), m_buffer.end(), [](const Centroid &a, const Centroid &b)
+              { return a.mean < b.mean; });
+
+    double total = 0.0;
+    for (const Centroid &c : m_buffer)
+    {
+        total += c.weight;
+    }
+
+    m_centroids.clear();
+    Centroid current = m_buffer.front();
+    double weight_so_far = 0.0;
+    double weight_limit = total * inverse_scale(scale(0.0, m_compression) + 1.0, m_compression);
+    for (size_t i = 1; i < m_buffer.size(); ++i)
+    {
+        const Centroid &next = m_buffer[i];
+        if (weight_so_far + current.weight + next.weight <= weight_limit)
+        {
+            current.mean += (next.mean - current.mean) * next.weight / (current.weight + next.weight);
+            current.weight += next.weight;
+        }
+        else
+        {
+            weight_so_far += current.weight;
+            m_centroids.push_back(current);
+            weight_limit = total * inverse_scale(scale(weight_so_far / total, m_compression) + 1.0, m_compression);
+            current = next;
+        }
+    }
+    m_centroids.push_back(current);
+    m_buffer.clear();
+    m_total_weight = total;
+}
+
+double QuantileSketch::quantile(double q) const
+{
+    compress();
+    if (m_centroids.empty())
+    {
+        return 0.0;
+    }
+    if (m_centroids.size() == 1)
+    {
+        return m_centroids.front().mean;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    const double target = q * m_total_weight;
+
+    // Each centroid's mean sits at the middle of its weight; interpolate between neighbouring
+    // centres, and between the outer centres and the exact min and max.
+    const Centroid &first = m_centroids.front();
+    if (target < first.weight / 2.0)
+    {
+        return m_min + (first.mean - m_min) * target / (first.weight / 2.0);
+    }
+    double cumulative = first.weight / 2.0;
+    for (size_t i = 0; i + 1 < m_centroids.size(); ++i)
+    {
+        const Centroid &left = m_centroids[i];
+        const Centroid &right = m_centroids[i + 1];
+        const double gap = (left.weight + right.weight) / 2.0;
+        if (target < cumulative + gap)
+        {
+            return left.mean + (right.mean - left.mean) * (target - cumulative) / gap;
+        }
+        cumulative += gap;
+    }
+    const Centroid &last = m_centroids.back();
+    const double tail = last.weight / 2.0;
+    return last.mean + (m_max - last.mean) * std::min(1.0, (target - cumulative) / tail);
+}
+
+double QuantileSketch::cdf(double value) const
+{
+    compress();
+    if (m_centroids.empty() || value < m_min)
+    {
+        return 0.0;
+    }
+    if (value >= m_max)
+    {
+        return 1.0;
+    }
+    if (m_centroids.size() == 1)
+    {
+        return value < m_centroids.front().mean ? 0.0 : 1.0;
+    }
+
+    // The same piecewise-linear interpolation as quantile(), read the other way.
+    const Centroid &first = m_centroids.front();
+    if (value < first.mean)
+    {
+        return first.weight / 2.0 * (value - m_min) / (first.mean - m_min) / m_total_weight;
+    }
+    double cumulative = first.weight / 2.0;
+    for (size_t i = 0; i + 1 < m_centroids.size(); ++i)
+    {
+        const Centroid &left = m_centroids[i];
+        const Centroid &right = m_centroids[i + 1];
+        const double gap = (left.weight + right.weight) / 2.0;
+        if (value < right.mean)
+        {
+            return (cumulative + gap * (value - left.mean) / (right.mean - left.mean)) / m_total_weight;
+        }
+        cumulative += gap;
+    }
+    const Centroid &last = m_centroids.back();
+    return std::min(1.0, (cumulative + last.weight / 2.0 * (value - last.mean) / (m_max - last.mean)) / m_total_weight);
+}
+
+double QuantileSketch::confidence_width(double q) const
+{
+    const double n = total_weight();
+    if (n == 0.0)
+    {
+        return 0.0;
+    }
+    const double half_width = 1.96 * std::sqrt(q * (1.0 - q) / n);
+    return quantile(std::min(1.0, q + half_width)) - quantile(std::max(0.0, q - half_width));
+}
+
+double QuantileSketch::total_weight() const
+{
+    compress();
+    return m_total_weight;
+}
+
+size_t QuantileSketch::num_centroids() const
+{
+    compress();
+    return m_centroids.size();
+}
+
+const std::vector<QuantileSketch::Centroid> &QuantileSketch::centroids() const
+{
+    compress();
+    return m_centroids;
+}
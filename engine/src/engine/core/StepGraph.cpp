@@ -0,0 +1,230 @@
+#include "include/engine/core/StepGraph.h"
+#include <algorithm>
+
+using json = nlohmann::json;
+
+namespace
+{
+    void collect_reads(const json &node, std::vector<size_t> &reads)
+    {
+        if (node.is_object())
+        {
+            const auto type_it = node.find("type");
+            if (type_it != node.end() && type_it->is_string() && *type_it == "variable_index")
+            {
+                const auto value_it = node.find("value");
+                if (value_it != node.end() && value_it->is_number_unsigned())
+                {
+                    reads.push_back(value_it->get<size_t>());
+                }
+                return;
+            }
+            for (const auto &item : node.items())
+            {
+                collect_reads(item.value(), reads);
+            }
+        }
+        else if (node.is_array())
+        {
+            for (const auto &item : node)
+            {
+                collect_reads(item, reads);
+            }
+        }
+    }
+
+    void collect_functions(const json &node, std::vector<std::string> &functions)
+    {
+        if (node.is_object())
+        {
+            const auto function_it = node.find("function");
+            if (function_it != node.end() && function_it->is_string())
+            {
+                functions.push_back(function_it->get<std::string>());
+            }
+            for (const auto &item : node.items())
+            {
+                collect_functions(item.value(), functions);
+            }
+        }
+        else if (node.is_array())
+        {
+            for (const auto &item : node)
+            {
+                collect_functions(item, functions);
+            }
+        }
+    }
+
+    bool contains(const std::vector<size_t> &values, size_t value)
+    {
+        return std::find(values.begin(), values.end(), value) != values.end();
+    }
+
+    bool intersects(const std::vector<size_t> &a, const std::vector<size_t> &b)
+    {
+        return std::any_of(a.begin(), a.end(), [&](size_t value)
+                           { return contains(b, value); });
+    }
+}
+
+StepGraph::StepGraph(const json &per_trial_steps)
+{
+    for (const auto &step : per_trial_steps)
+    {
+        Node node;
+        const auto result_it = step.find("result");
+        if (result_it != step.end())
+        {
+            const json results = result_it->is_array() ? *result_it : json::array({*result_it});
+            for (const auto &index : results)
+            {
+                if (index.is_number_unsigned())
+                {
+                    node.writes.push_back(index.get<size_t>());
+                }
+            }
+        }
+        if (step.value("type", std::string()) == "conditional_assignment")
+        {
+            node.conditional = true;
+            if (step.contains("condition"))
+                collect_reads(step.at("condition"), node.condition_reads);
+            if (step.contains("then_expr"))
+                collect_reads(step.at("then_expr"), node.then_reads);
+            if (step.contains("else_expr"))
+                collect_reads(step.at("else_expr"), node.else_reads);
+        }
+        collect_reads(step, node.reads);
+        collect_functions(step, node.functions);
+        m_nodes.push_back(std::move(node));
+    }
+}
+
+StepGraph::Schedule StepGraph::schedule(const std::vector<size_t> &outputs) const
+{
+    Schedule schedule;
+    schedule.live.assign(m_nodes.size(), false);
+    schedule.deferred.assign(m_nodes.size(), std::nullopt);
+
+    // Backwards liveness: a step is live when it writes a slot that is still needed.
+    std::vector<size_t> needed = outputs;
+    for (size_t i = m_nodes.size(); i-- > 0;)
+    {
+        const Node &node = m_nodes[i];
+        // Steps without a well-formed result are kept so that the engine reports them.
+        if (!node.writes.empty() && !intersects(node.writes, needed))
+            continue;
+        schedule.live[i] = true;
+        needed.erase(std::remove_if(needed.begin(), needed.end(), [&](size_t slot)
+                                    { return contains(node.writes, slot); }),
+                     needed.end());
+        needed.insert(needed.end(), node.reads.begin(), node.reads.end());
+    }
+
+    // Later conditionals first, and later helpers before earlier ones, so that chains of
+    // helpers feeding a branch are deferred together.
+    for (size_t c = m_nodes.size(); c-- > 0;)
+    {
+        if (!schedule.live[c] || !m_nodes[c].conditional || schedule.deferred[c])
+            continue;
+        for (size_t i = c; i-- > 0;)
+        {
+            for (bool then_branch : {true, false})
+            {
+                if (can_defer(schedule, i, c, then_branch, outputs))
+                {
+                    schedule.deferred[i] = Deferral{c, then_branch};
+                    break;
+                }
+            }
+        }
+    }
+    return schedule;
+}
+
+std::vector<bool> StepGraph::downstream(std::vector<size_t> &changed) const
+{
+    std::vector<bool> affected(m_nodes.size(), false);
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        const Node &node = m_nodes[i];
+        if (!intersects(node.reads, changed))
+            continue;
+        affected[i] = true;
+        for (size_t slot : node.writes)
+        {
+            if (!contains(changed, slot))
+                changed.push_back(slot);
+        }
+    }
+    return affected;
+}
+
+bool StepGraph::calls_impure(const std::vector<bool> &steps, const std::function<bool(const std::string &)> &is_pure) const
+{
+    for (size_t i = 0; i < m_nodes.size() && i < steps.size(); ++i)
+    {
+        if (steps[i] && !std::all_of(m_nodes[i].functions.begin(), m_nodes[i].functions.end(), is_pure))
+            return true;
+    }
+    return false;
+}
+
+bool StepGraph::can_defer(const Schedule &schedule, size_t step, size_t conditional, bool then_branch, const std::vector<size_t> &outputs) const
+{
+    const Node &node = m_nodes[step];
+    if (!schedule.live[step] || schedule.deferred[step] || node.writes.empty() || intersects(node.writes, outputs))
+        return false;
+    // Steps that host deferred steps stay where they are.
+    for (const auto &deferral : schedule.deferred)
+    {
+        if (deferral && deferral->conditional == step)
+            return false;
+    }
+
+    const Node &host = m_nodes[conditional];
+    const std::vector<size_t> &branch_reads = then_branch ? host.then_reads : host.else_reads;
+    const std::vector<size_t> &other_reads = then_branch ? host.else_reads : host.then_reads;
+    auto in_same_branch = [&](size_t j)
+    {
+        const auto &deferral = schedule.deferred[j];
+        return deferral && deferral->conditional == conditional && deferral->then_branch == then_branch;
+    };
+
+    bool feeds_branch = false;
+    for (size_t j = step + 1; j < m_nodes.size(); ++j)
+    {
+        if (!schedule.live[j])
+            continue;
+        const Node &other = m_nodes[j];
+        // The step's results may only be consumed by the branch or by its other helpers.
+        for (size_t slot : node.writes)
+        {
+            if (j < conditional && contains(other.writes, slot))
+                return false;
+            if (!contains(other.reads, slot))
+                continue;
+            if (in_same_branch(j))
+                continue;
+            if (j == conditional && contains(branch_reads, slot) && !contains(other_reads, slot) && !contains(host.condition_reads, slot))
+            {
+                feeds_branch = true;
+                continue;
+            }
+            return false;
+        }
+        // Its inputs must not change between its original position and the branch.
+        if (j < conditional && !in_same_branch(j) && intersects(other.writes, node.reads))
+            return false;
+    }
+    if (feeds_branch)
+        return true;
+    // Otherwise it only feeds helpers already deferred into the same branch.
+    for (size_t j = step + 1; j < conditional; ++j)
+    {
+        if (in_same_branch(j) && intersects(m_nodes[j].reads, node.writes))
+            return true;
+    }
+    return false;
+}
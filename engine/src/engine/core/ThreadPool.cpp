@@ -0,0 +1,350 @@
+#include "include/engine/core/ThreadPool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+    uint64_t pack(uint64_t begin, uint64_t end) { return (begin << 32) | end; }
+    uint64_t range_begin(uint64_t range) { return range >> 32; }
+    uint64_t range_end(uint64_t range) { return range & 0xFFFFFFFFu; }
+
+    // The pool whose job the current thread is running chunks of, if any.
+    thread_local const ThreadPool *t_pool = nullptr;
+
+    // Best effort: platforms without an affinity API (e.g. macOS) leave threads unpinned.
+    void pin_to_cpu(std::thread &thread, size_t cpu)
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(static_cast<int>(cpu % CPU_SETSIZE), &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#elif defined(_WIN32)
+        SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << (cpu % (sizeof(DWORD_PTR) * 8)));
+#else
+        (void)thread;
+        (void)cpu;
+#endif
+    }
+}
+
+const NumaTopology &NumaTopology::system()
+{
+    static const NumaTopology topology = []
+    {
+        NumaTopology detected;
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        const bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string nodes;
+        std::getline(online, nodes);
+        for (unsigned node : parse_cpu_list(nodes))
+        {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            std::vector<unsigned> cpus;
+            for (unsigned cpu : parse_cpu_list(list))
+            {
+                if (!masked || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+                    cpus.push_back(cpu);
+            }
+            if (!cpus.empty())
+                detected.nodes.push_back(std::move(cpus));
+        }
+#endif
+        if (detected.nodes.empty())
+        {
+            detected.nodes.emplace_back(std::max(1u, std::thread::hardware_concurrency()));
+            for (unsigned cpu = 0; cpu < detected.nodes[0].size(); ++cpu)
+                detected.nodes[0][cpu] = cpu;
+        }
+        return detected;
+    }();
+    return topology;
+}
+
+std::vector<unsigned> NumaTopology::parse_cpu_list(const std::string &list)
+{
+    std::vector<unsigned> cpus;
+    const char *text = list.c_str();
+    while (*text)
+    {
+        char *end = nullptr;
+        const unsigned long first = std::strtoul(text, &end, 10);
+        if (end == text)
+            break;
+        unsigned long last = first;
+        text = end;
+        if (*text == '-')
+        {
+            last = std::strtoul(text + 1, &end, 10);
+            if (end == text + 1)
+                break;
+            text = end;
+        }
+        for (unsigned long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(static_cast<unsigned>(cpu));
+        if (*text != ',')
+            break;
+        ++text;
+    }
+    return cpus;
+}
+
+ThreadPool::ThreadPool(size_t num_threads, bool pin_threads, const NumaTopology &topology)
+    : m_queues(std::max<size_t>(1, num_threads)), m_pin_threads(pin_threads)
+{
+    // Node n takes the workers [W * c / C, W * (c + c_n) / C), where c counts the CPUs of the
+    // nodes before it, c_n its own and C all of them.
+    const size_t workers = m_queues.size();
+    size_t total_cpus = 0;
+    for (const auto &cpus : topology.nodes)
+        total_cpus += cpus.size();
+    m_node_begin.push_back(0);
+    size_t cpus_before = 0;
+    for (const auto &cpus : topology.nodes)
+    {
+        cpus_before += cpus.size();
+        m_node_begin.push_back(total_cpus > 0 ? workers * cpus_before / total_cpus : 0);
+    }
+    if (m_node_begin.size() == 1)
+        m_node_begin.push_back(workers);
+    m_node_begin.back() = workers;
+    m_worker_node.resize(workers);
+    for (size_t node = 0; node + 1 < m_node_begin.size(); ++node)
+    {
+        std::fill(m_worker_node.begin() + m_node_begin[node], m_worker_node.begin() + m_node_begin[node + 1], node);
+    }
+
+    m_threads.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; ++worker)
+    {
+        m_threads.emplace_back(&ThreadPool::worker_main, this, worker);
+        const size_t node = m_worker_node[worker];
+        if (pin_threads && node < topology.nodes.size() && !topology.nodes[node].empty())
+        {
+            const auto &cpus = topology.nodes[node];
+            pin_to_cpu(m_threads.back(), cpus[(worker - m_node_begin[node]) % cpus.size()]);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::shared(size_t num_threads, bool pin_threads)
+{
+    static std::mutex mutex;
+    static std::shared_ptr<ThreadPool> pool;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pool || pool->size() != std::max<size_t>(1, num_threads) || pool->pins_threads() != pin_threads)
+    {
+        pool = std::make_shared<ThreadPool>(num_threads, pin_threads);
+    }
+    return pool;
+}
+
+size_t ThreadPool::effective_chunk_size(size_t count, size_t chunk_size)
+{
+    chunk_size = std::max<size_t>(1, chunk_size);
+    const size_t num_chunks = count / chunk_size + (count % chunk_size != 0);
+    if (num_chunks <= MAX_CHUNKS)
+        return chunk_size;
+    const size_t factor = num_chunks / MAX_CHUNKS + (num_chunks % MAX_CHUNKS != 0);
+    return chunk_size * factor;
+}
+
+void ThreadPool::parallel_for(size_t count, size_t chunk_size, const ChunkBody &body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    chunk_size = effective_chunk_size(count, chunk_size);
+    // Called from a chunk of this pool's job, the workers stay busy until that chunk returns.
+    const bool nested = t_pool == this;
+    size_t begin = 0;
+    while (begin < count)
+    {
+        if (!nested && size() > 1 && count - begin > chunk_size)
+        {
+            std::unique_lock<std::mutex> submit(m_submit_mutex, std::try_to_lock);
+            if (submit.owns_lock())
+            {
+                run_job(begin, count, chunk_size, body);
+                return;
+            }
+        }
+        // The workers run another caller's job: take one chunk on this thread, then try again.
+        const size_t end = std::min(count, begin + chunk_size);
+        body(0, begin, end);
+        begin = end;
+    }
+}
+
+void ThreadPool::run_job(size_t first, size_t count, size_t chunk_size, const ChunkBody &body)
+{
+    Job job;
+    job.body = &body;
+    job.first = first;
+    job.count = count;
+    job.chunk_size = chunk_size;
+
+    const size_t num_chunks = (count - first) / chunk_size + ((count - first) % chunk_size != 0);
+    const size_t workers = size();
+    for (size_t worker = 0; worker < workers; ++worker)
+    {
+        m_queues[worker].range.store(pack(num_chunks * worker / workers, num_chunks * (worker + 1) / workers), std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_pending = workers - 1;
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    const ThreadPool *caller_pool = t_pool;
+    t_pool = this;
+    work(0, job);
+    t_pool = caller_pool;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]
+                    { return m_pending == 0; });
+        m_job = nullptr;
+    }
+
+    if (job.error)
+    {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void ThreadPool::worker_main(size_t worker)
+{
+    t_pool = this;
+    uint64_t seen_generation = 0;
+    for (;;)
+    {
+        Job *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]
+                        { return m_stop || m_generation != seen_generation; });
+            if (m_stop)
+            {
+                return;
+            }
+            seen_generation = m_generation;
+            job = m_job;
+        }
+
+        work(worker, *job);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_pending == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::work(size_t worker, Job &job)
+{
+    uint64_t chunk = 0;
+    while (!job.failed.load(std::memory_order_relaxed) && (pop_front(worker, chunk) || steal(worker, chunk)))
+    {
+        const size_t begin = job.first + static_cast<size_t>(chunk) * job.chunk_size;
+        const size_t end = std::min(job.count, begin + job.chunk_size);
+        try
+        {
+            (*job.body)(worker, begin, end);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(job.error_mutex);
+            if (!job.error || chunk < job.error_chunk)
+            {
+                job.error = std::current_exception();
+                job.error_chunk = static_cast<size_t>(chunk);
+            }
+            job.failed.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool ThreadPool::pop_front(size_t worker, uint64_t &chunk)
+{
+    auto &range = m_queues[worker].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (range_begin(current) < range_end(current))
+    {
+        if (range.compare_exchange_weak(current, pack(range_begin(current) + 1, range_end(current)), std::memory_order_acq_rel))
+        {
+            chunk = range_begin(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::steal(size_t thief, uint64_t &chunk)
+{
+    // The thief's own node first, then the other workers in order.
+    const size_t node = m_worker_node[thief];
+    const size_t node_begin = m_node_begin[node];
+    const size_t node_size = m_node_begin[node + 1] - node_begin;
+    for (size_t offset = 1; offset < node_size; ++offset)
+    {
+        if (steal_from(node_begin + (thief - node_begin + offset) % node_size, chunk))
+            return true;
+    }
+    for (size_t offset = 1; offset < m_queues.size(); ++offset)
+    {
+        const size_t victim = (thief + offset) % m_queues.size();
+        if (m_worker_node[victim] != node && steal_from(victim, chunk))
+            return true;
+    }
+    return false;
+}
+
+bool ThreadPool::steal_from(size_t victim, uint64_t &chunk)
+{
+    auto &range = m_queues[victim].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (range_begin(current) < range_end(current))
+    {
+        if (range.compare_exchange_weak(current, pack(range_begin(current), range_end(current) - 1), std::memory_order_acq_rel))
+        {
+            chunk = range_end(current) - 1;
+            return true;
+        }
+    }
+    return false;
+}
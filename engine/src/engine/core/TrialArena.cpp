@@ -0,0 +1,58 @@
+#include "include/engine/core/TrialArena.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t MIN_BLOCK_BYTES = 4096;
+}
+
+size_t TrialArena::capacity() const
+{
+    size_t bytes = 0;
+    for (const Block &block : m_blocks)
+    {
+        bytes += block.size;
+    }
+    return bytes;
+}
+
+void *TrialArena::allocate_bytes(size_t bytes, size_t alignment)
+{
+    // Blocks come from operator new[], aligned for any fundamental type.
+    static_assert(alignof(std::max_align_t) >= alignof(double));
+    for (; m_block < m_blocks.size(); ++m_block, m_offset = 0)
+    {
+        Block &block = m_blocks[m_block];
+        const size_t start = (m_offset + alignment - 1) / alignment * alignment;
+        if (start <= block.size && bytes <= block.size - start)
+        {
+            m_offset = start + bytes;
+            return block.memory.get() + start;
+        }
+    }
+    const size_t size = std::max({bytes, MIN_BLOCK_BYTES, m_blocks.empty() ? size_t{0} : 2 * m_blocks.back().size});
+    m_blocks.push_back({std::make_unique<std::byte[]>(size), size});
+    m_block = m_blocks.size() - 1;
+    m_offset = bytes;
+    return m_blocks.back().memory.get();
+}
+
+void TrialArena::rewind(size_t block, size_t offset)
+{
+    m_block = block;
+    m_offset = offset;
+    // Once nothing is held, the blocks a trial needed are merged into one, so that the next
+    // trial fits in a single block and allocates nothing.
+    if (block == 0 && offset == 0 && m_blocks.size() > 1)
+    {
+        const size_t size = capacity();
+        m_blocks.clear();
+        m_blocks.push_back({std::make_unique<std::byte[]>(size), size});
+    }
+}
+
+TrialArena &trial_arena()
+{
+    static thread_local TrialArena arena;
+    return arena;
+}
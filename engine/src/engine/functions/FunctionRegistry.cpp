@@ -1,13 +1,45 @@
 #include "include/engine/functions/FunctionRegistry.h"
 #include "include/engine/core/EngineException.h"
 
-void FunctionRegistry::register_function(const std::string &name, FactoryFunc factory)
+void FunctionRegistry::register_function(const std::string &name, FactoryFunc factory, FunctionPurity purity, FunctionCost cost)
 {
     if (m_factory_map.count(name) > 0)
     {
         throw std::runtime_error("Developer error: Function '" + name + "' is already registered.");
     }
     m_factory_map[name] = std::move(factory);
+    if (purity == FunctionPurity::Pure)
+    {
+        m_pure_functions.insert(name);
+    }
+    if (cost == FunctionCost::Cheap)
+    {
+        m_cheap_functions.insert(name);
+    }
+}
+
+bool FunctionRegistry::is_pure(const std::string &name) const
+{
+    return m_pure_functions.count(name) > 0;
+}
+
+bool FunctionRegistry::is_cheap(const std::string &name) const
+{
+    return m_cheap_functions.count(name) > 0;
+}
+
+void FunctionRegistry::set_creation_hook(CreationHook hook)
+{
+    auto shared_hook = std::make_shared<CreationHook>(std::move(hook));
+    for (auto &entry : m_factory_map)
+    {
+        entry.second = [name = entry.first, factory = std::move(entry.second), shared_hook]
+        {
+            std::unique_ptr<IExecutable> executable = factory();
+            (*shared_hook)(name, *executable);
+            return executable;
+        };
+    }
 }
 
 const std::unordered_map<std::string, FunctionRegistry::FactoryFunc> &FunctionRegistry::get_factory_map() const
@@ -1,282 +1,60 @@
 #include "include/engine/functions/core/operations.h"
+#include "include/engine/functions/core/kernels.h"
+#include "include/engine/core/DeviceProgram.h"
 #include "include/engine/core/EngineException.h"
 #include <vector>
 #include <numeric>
 #include <cmath>
+#include <algorithm>
 
 void register_core_functions(FunctionRegistry &registry)
 {
 
     registry.register_function("add", []
-                               { return std::make_unique<AddOperation>(); });
+                               { return std::make_unique<AddOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("subtract", []
-                               { return std::make_unique<SubtractOperation>(); });
+                               { return std::make_unique<SubtractOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("multiply", []
-                               { return std::make_unique<MultiplyOperation>(); });
+                               { return std::make_unique<MultiplyOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("divide", []
-                               { return std::make_unique<DivideOperation>(); });
+                               { return std::make_unique<DivideOperation>(); }, FunctionPurity::Pure);
     registry.register_function("power", []
-                               { return std::make_unique<PowerOperation>(); });
+                               { return std::make_unique<PowerOperation>(); }, FunctionPurity::Pure);
     registry.register_function("log", []
-                               { return std::make_unique<LogOperation>(); });
+                               { return std::make_unique<LogOperation>(); }, FunctionPurity::Pure);
     registry.register_function("log10", []
-                               { return std::make_unique<Log10Operation>(); });
+                               { return std::make_unique<Log10Operation>(); }, FunctionPurity::Pure);
     registry.register_function("exp", []
-                               { return std::make_unique<ExpOperation>(); });
+                               { return std::make_unique<ExpOperation>(); }, FunctionPurity::Pure);
     registry.register_function("sin", []
-                               { return std::make_unique<SinOperation>(); });
+                               { return std::make_unique<SinOperation>(); }, FunctionPurity::Pure);
     registry.register_function("cos", []
-                               { return std::make_unique<CosOperation>(); });
+                               { return std::make_unique<CosOperation>(); }, FunctionPurity::Pure);
     registry.register_function("tan", []
-                               { return std::make_unique<TanOperation>(); });
+                               { return std::make_unique<TanOperation>(); }, FunctionPurity::Pure);
     registry.register_function("identity", []
-                               { return std::make_unique<IdentityOperation>(); });
+                               { return std::make_unique<IdentityOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
 
     registry.register_function("__eq__", []
-                               { return std::make_unique<EqualsOperation>(); });
+                               { return std::make_unique<EqualsOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("__neq__", []
-                               { return std::make_unique<NotEqualsOperation>(); });
+                               { return std::make_unique<NotEqualsOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("__gt__", []
-                               { return std::make_unique<GreaterThanOperation>(); });
+                               { return std::make_unique<GreaterThanOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("__lt__", []
-                               { return std::make_unique<LessThanOperation>(); });
+                               { return std::make_unique<LessThanOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("__gte__", []
-                               { return std::make_unique<GreaterOrEqualOperation>(); });
+                               { return std::make_unique<GreaterOrEqualOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("__lte__", []
-                               { return std::make_unique<LessOrEqualOperation>(); });
+                               { return std::make_unique<LessOrEqualOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("__and__", []
-                               { return std::make_unique<AndOperation>(); });
+                               { return std::make_unique<AndOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("__or__", []
-                               { return std::make_unique<OrOperation>(); });
+                               { return std::make_unique<OrOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
     registry.register_function("__not__", []
-                               { return std::make_unique<NotOperation>(); });
+                               { return std::make_unique<NotOperation>(); }, FunctionPurity::Pure, FunctionCost::Cheap);
 }
 
-inline std::vector<double> add_vectors_simd(const std::vector<double> &left, const std::vector<double> &right)
-{
-    std::vector<double> result(left.size());
-    for (size_t i = 0; i < left.size(); ++i)
-    {
-        result[i] = left[i] + right[i];
-    }
-    return result;
-}
-inline std::vector<double> subtract_vectors_simd(const std::vector<double> &left, const std::vector<double> &right)
-{
-    std::vector<double> result(left.size());
-    for (size_t i = 0; i < left.size(); ++i)
-    {
-        result[i] = left[i] - right[i];
-    }
-    return result;
-}
-inline std::vector<double> multiply_vectors_simd(const std::vector<double> &left, const std::vector<double> &right)
-{
-    std::vector<double> result(left.size());
-    for (size_t i = 0; i < left.size(); ++i)
-    {
-        result[i] = left[i] * right[i];
-    }
-    return result;
-}
-inline std::vector<double> divide_vectors_simd(const std::vector<double> &left, const std::vector<double> &right)
-{
-    std::vector<double> result(left.size());
-    for (size_t i = 0; i < left.size(); ++i)
-    {
-        if (right[i] == 0.0)
-            throw EngineException(EngineErrc::DivisionByZero, "Division by zero in vector operation.");
-        result[i] = left[i] / right[i];
-    }
-    return result;
-}
-inline std::vector<double> power_vectors_simd(const std::vector<double> &left, const std::vector<double> &right)
-{
-    std::vector<double> result(left.size());
-    for (size_t i = 0; i < left.size(); ++i)
-    {
-        result[i] = std::pow(left[i], right[i]);
-    }
-    return result;
-}
-
-inline std::vector<double> add_vector_scalar_simd(const std::vector<double> &vec, double scalar)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = vec[i] + scalar;
-    }
-    return result;
-}
-inline std::vector<double> subtract_vector_scalar_simd(const std::vector<double> &vec, double scalar)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = vec[i] - scalar;
-    }
-    return result;
-}
-inline std::vector<double> multiply_vector_scalar_simd(const std::vector<double> &vec, double scalar)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = vec[i] * scalar;
-    }
-    return result;
-}
-inline std::vector<double> divide_vector_scalar_simd(const std::vector<double> &vec, double scalar)
-{
-    if (scalar == 0.0)
-        throw EngineException(EngineErrc::DivisionByZero, "Division by zero.");
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = vec[i] / scalar;
-    }
-    return result;
-}
-inline std::vector<double> power_vector_scalar_simd(const std::vector<double> &vec, double scalar)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = std::pow(vec[i], scalar);
-    }
-    return result;
-}
-
-inline std::vector<double> add_scalar_vector_simd(double scalar, const std::vector<double> &vec)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = scalar + vec[i];
-    }
-    return result;
-}
-inline std::vector<double> subtract_scalar_vector_simd(double scalar, const std::vector<double> &vec)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = scalar - vec[i];
-    }
-    return result;
-}
-inline std::vector<double> multiply_scalar_vector_simd(double scalar, const std::vector<double> &vec)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = scalar * vec[i];
-    }
-    return result;
-}
-inline std::vector<double> divide_scalar_vector_simd(double scalar, const std::vector<double> &vec)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        if (vec[i] == 0.0)
-            throw EngineException(EngineErrc::DivisionByZero, "Division by zero.");
-        result[i] = scalar / vec[i];
-    }
-    return result;
-}
-inline std::vector<double> power_scalar_vector_simd(double scalar, const std::vector<double> &vec)
-{
-    std::vector<double> result(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        result[i] = std::pow(scalar, vec[i]);
-    }
-    return result;
-}
-
-inline double perform_variadic_op(OpCode code, const std::vector<double> &values)
-{
-    if (values.empty())
-        throw EngineException(EngineErrc::EmptyVectorOperation, "Cannot perform operation on an empty list of values.");
-    double accumulator = values[0];
-    for (size_t i = 1; i < values.size(); ++i)
-    {
-        switch (code)
-        {
-        case OpCode::ADD:
-            accumulator += values[i];
-            break;
-        case OpCode::SUBTRACT:
-            accumulator -= values[i];
-            break;
-        case OpCode::MULTIPLY:
-            accumulator *= values[i];
-            break;
-        case OpCode::DIVIDE:
-            if (values[i] == 0.0)
-                throw EngineException(EngineErrc::DivisionByZero, "Division by zero");
-            accumulator /= values[i];
-            break;
-        case OpCode::POWER:
-            accumulator = std::pow(accumulator, values[i]);
-            break;
-        default:
-            throw EngineException(EngineErrc::UnknownError, "Unsupported variadic op code.");
-        }
-    }
-    return accumulator;
-}
-
-struct ElementWiseVisitor
-{
-    OpCode code;
-
-    TrialValue operator()(double left, double right) const { return perform_variadic_op(code, {left, right}); }
-
-    TrialValue operator()(const std::vector<double> &vec, double scalar) const
-    {
-        std::vector<double> result;
-        result.reserve(vec.size());
-        for (double val : vec)
-        {
-            result.push_back(perform_variadic_op(code, {val, scalar}));
-        }
-        return result;
-    }
-
-    TrialValue operator()(double scalar, const std::vector<double> &vec) const
-    {
-        std::vector<double> result;
-        result.reserve(vec.size());
-        for (double val : vec)
-        {
-            result.push_back(perform_variadic_op(code, {scalar, val}));
-        }
-        return result;
-    }
-
-    TrialValue operator()(const std::vector<double> &vec_left, const std::vector<double> &vec_right) const
-    {
-        if (vec_left.size() != vec_right.size())
-            throw EngineException(EngineErrc::VectorSizeMismatch, "Vector size mismatch: element-wise operation requires vectors of the same length, but got sizes " + std::to_string(vec_left.size()) + " and " + std::to_string(vec_right.size()) + ".");
-        std::vector<double> result;
-        result.reserve(vec_left.size());
-        for (size_t i = 0; i < vec_left.size(); ++i)
-        {
-            result.push_back(perform_variadic_op(code, {vec_left[i], vec_right[i]}));
-        }
-        return result;
-    }
-
-    template <typename T1, typename T2>
-    TrialValue operator()(const T1 &, const T2 &) const
-    {
-        throw EngineException(EngineErrc::MismatchedArgumentType, "Unsupported argument types for mathematical operation.");
-    }
-};
-
 VariadicBaseOperation::VariadicBaseOperation(OpCode code) : m_code(code) {}
 
 struct InPlaceVisitor
@@ -289,61 +67,18 @@ struct InPlaceVisitor
         auto &acc_vec = std::get<std::vector<double>>(accumulator);
         if (acc_vec.size() != right.size())
             throw EngineException(EngineErrc::VectorSizeMismatch, "Vector size mismatch for in-place operation.");
-        for (size_t i = 0; i < acc_vec.size(); ++i)
-        {
-            switch (code)
-            {
-            case OpCode::ADD:
-                acc_vec[i] += right[i];
-                break;
-            case OpCode::SUBTRACT:
-                acc_vec[i] -= right[i];
-                break;
-            case OpCode::MULTIPLY:
-                acc_vec[i] *= right[i];
-                break;
-            case OpCode::DIVIDE:
-                if (right[i] == 0.0)
-                    throw EngineException(EngineErrc::DivisionByZero, "Division by zero.");
-                acc_vec[i] /= right[i];
-                break;
-            case OpCode::POWER:
-                acc_vec[i] = std::pow(acc_vec[i], right[i]);
-                break;
-            default:
-                throw EngineException(EngineErrc::UnknownError, "Unsupported in-place op code.");
-            }
-        }
+        const ElementwiseKernels &kernels = elementwise_kernels();
+        if (code == OpCode::DIVIDE && kernels.any_zero(right.data(), right.size()))
+            throw EngineException(EngineErrc::DivisionByZero, "Division by zero.");
+        kernels.vector[kernel_index(code)](acc_vec.data(), right.data(), acc_vec.size());
     }
 
     void operator()(double right) const
     {
         auto &acc_vec = std::get<std::vector<double>>(accumulator);
-        for (size_t i = 0; i < acc_vec.size(); ++i)
-        {
-            switch (code)
-            {
-            case OpCode::ADD:
-                acc_vec[i] += right;
-                break;
-            case OpCode::SUBTRACT:
-                acc_vec[i] -= right;
-                break;
-            case OpCode::MULTIPLY:
-                acc_vec[i] *= right;
-                break;
-            case OpCode::DIVIDE:
-                if (right == 0.0)
-                    throw EngineException(EngineErrc::DivisionByZero, "Division by zero.");
-                acc_vec[i] /= right;
-                break;
-            case OpCode::POWER:
-                acc_vec[i] = std::pow(acc_vec[i], right);
-                break;
-            default:
-                throw EngineException(EngineErrc::UnknownError, "Unsupported in-place op code.");
-            }
-        }
+        if (code == OpCode::DIVIDE && right == 0.0)
+            throw EngineException(EngineErrc::DivisionByZero, "Division by zero.");
+        elementwise_kernels().scalar[kernel_index(code)](acc_vec.data(), right, acc_vec.size());
     }
 
     template <typename T>
@@ -353,23 +88,21 @@ struct InPlaceVisitor
     }
 };
 
-std::vector<TrialValue> VariadicBaseOperation::execute(const std::vector<TrialValue> &args) const
+void VariadicBaseOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.empty())
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Operation requires at least one argument.");
 
-    TrialValue accumulator = args[0];
-
-    bool has_vector = std::any_of(args.begin(), args.end(), [](const TrialValue &v)
-                                  { return std::holds_alternative<std::vector<double>>(v); });
+    bool has_vector = std::any_of(args.begin(), args.end(), [](const TrialValue *v)
+                                  { return std::holds_alternative<std::vector<double>>(*v); });
 
     if (!has_vector)
     {
 
-        double result = std::get<double>(accumulator);
+        double result = std::get<double>(*args[0]);
         for (size_t i = 1; i < args.size(); ++i)
         {
-            double val = std::get<double>(args[i]);
+            double val = std::get<double>(*args[i]);
             switch (m_code)
             {
             case OpCode::ADD:
@@ -393,33 +126,39 @@ std::vector<TrialValue> VariadicBaseOperation::execute(const std::vector<TrialVa
                 throw EngineException(EngineErrc::UnknownError, "Unsupported variadic op code.");
             }
         }
-        return {result};
+        *results[0] = result;
+        return;
     }
 
-    if (std::holds_alternative<double>(accumulator))
+    // The result slot doubles as the accumulator, reusing the storage of its previous series.
+    TrialValue &accumulator = *results[0];
+    if (const double *scalar = std::get_if<double>(args[0]))
     {
-        double scalar_val = std::get<double>(accumulator);
+        const double scalar_val = *scalar;
 
         size_t vector_size = 0;
-        for (const auto &arg : args)
+        for (const TrialValue *arg : args)
         {
-            if (std::holds_alternative<std::vector<double>>(arg))
+            if (const auto *series = std::get_if<std::vector<double>>(arg))
             {
-                vector_size = std::get<std::vector<double>>(arg).size();
+                vector_size = series->size();
                 break;
             }
         }
 
-        accumulator = std::vector<double>(vector_size, scalar_val);
+        auto &broadcast = assign_series(accumulator, vector_size);
+        std::fill(broadcast.begin(), broadcast.end(), scalar_val);
+    }
+    else
+    {
+        accumulator = *args[0];
     }
 
     for (size_t i = 1; i < args.size(); ++i)
     {
 
-        std::visit(InPlaceVisitor{m_code, accumulator}, args[i]);
+        std::visit(InPlaceVisitor{m_code, accumulator}, *args[i]);
     }
-
-    return {accumulator};
 }
 
 AddOperation::AddOperation() : VariadicBaseOperation(OpCode::ADD) {}
@@ -428,52 +167,52 @@ MultiplyOperation::MultiplyOperation() : VariadicBaseOperation(OpCode::MULTIPLY)
 DivideOperation::DivideOperation() : VariadicBaseOperation(OpCode::DIVIDE) {}
 PowerOperation::PowerOperation() : VariadicBaseOperation(OpCode::POWER) {}
 
-std::vector<TrialValue> LogOperation::execute(const std::vector<TrialValue> &args) const
+void LogOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'log' requires 1 argument.");
-    return {std::log(std::get<double>(args[0]))};
+    *results[0] = std::log(std::get<double>(*args[0]));
 }
-std::vector<TrialValue> Log10Operation::execute(const std::vector<TrialValue> &args) const
+void Log10Operation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'log10' requires 1 argument.");
-    return {std::log10(std::get<double>(args[0]))};
+    *results[0] = std::log10(std::get<double>(*args[0]));
 }
-std::vector<TrialValue> ExpOperation::execute(const std::vector<TrialValue> &args) const
+void ExpOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'exp' requires 1 argument.");
-    return {std::exp(std::get<double>(args[0]))};
+    *results[0] = std::exp(std::get<double>(*args[0]));
 }
-std::vector<TrialValue> SinOperation::execute(const std::vector<TrialValue> &args) const
+void SinOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'sin' requires 1 argument.");
-    return {std::sin(std::get<double>(args[0]))};
+    *results[0] = std::sin(std::get<double>(*args[0]));
 }
-std::vector<TrialValue> CosOperation::execute(const std::vector<TrialValue> &args) const
+void CosOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'cos' requires 1 argument.");
-    return {std::cos(std::get<double>(args[0]))};
+    *results[0] = std::cos(std::get<double>(*args[0]));
 }
-std::vector<TrialValue> TanOperation::execute(const std::vector<TrialValue> &args) const
+void TanOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'tan' requires 1 argument.");
-    return {std::tan(std::get<double>(args[0]))};
+    *results[0] = std::tan(std::get<double>(*args[0]));
 }
-std::vector<TrialValue> IdentityOperation::execute(const std::vector<TrialValue> &args) const
+void IdentityOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'identity' requires exactly 1 argument.");
-    return {args[0]};
+    *results[0] = *args[0];
 }
 
 ComparisonBaseOperation::ComparisonBaseOperation(OpCode code) : m_code(code) {}
 
-std::vector<TrialValue> ComparisonBaseOperation::execute(const std::vector<TrialValue> &args) const
+void ComparisonBaseOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Comparison operator requires 2 arguments.");
@@ -506,8 +245,8 @@ std::vector<TrialValue> ComparisonBaseOperation::execute(const std::vector<Trial
                 default: throw EngineException(EngineErrc::MismatchedArgumentType, "Unsupported types for this comparison.");
             }
         } },
-                                   args[0], args[1]);
-    return {result};
+                                   *args[0], *args[1]);
+    *results[0] = result;
 }
 
 EqualsOperation::EqualsOperation() : ComparisonBaseOperation(OpCode::EQ) {}
@@ -517,39 +256,262 @@ LessThanOperation::LessThanOperation() : ComparisonBaseOperation(OpCode::LT) {}
 GreaterOrEqualOperation::GreaterOrEqualOperation() : ComparisonBaseOperation(OpCode::GTE) {}
 LessOrEqualOperation::LessOrEqualOperation() : ComparisonBaseOperation(OpCode::LTE) {}
 
-std::vector<TrialValue> AndOperation::execute(const std::vector<TrialValue> &args) const
+void AndOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.empty())
         throw EngineException(EngineErrc::IncorrectArgumentCount, "'and' operator requires at least one argument.");
-    for (const auto &arg : args)
+    for (const TrialValue *arg : args)
     {
-        if (!std::holds_alternative<bool>(arg))
+        if (!std::holds_alternative<bool>(*arg))
             throw EngineException(EngineErrc::LogicalOperatorRequiresBoolean, "'and' operator requires a boolean argument.");
-        if (!std::get<bool>(arg))
-            return {false};
+        if (!std::get<bool>(*arg))
+        {
+            *results[0] = false;
+            return;
+        }
     }
-    return {true};
+    *results[0] = true;
 }
 
-std::vector<TrialValue> OrOperation::execute(const std::vector<TrialValue> &args) const
+void OrOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.empty())
         throw EngineException(EngineErrc::IncorrectArgumentCount, "'or' operator requires at least one argument.");
-    for (const auto &arg : args)
+    for (const TrialValue *arg : args)
     {
-        if (!std::holds_alternative<bool>(arg))
+        if (!std::holds_alternative<bool>(*arg))
             throw EngineException(EngineErrc::LogicalOperatorRequiresBoolean, "'or' operator requires a boolean argument.");
-        if (std::get<bool>(arg))
-            return {true};
+        if (std::get<bool>(*arg))
+        {
+            *results[0] = true;
+            return;
+        }
     }
-    return {false};
+    *results[0] = false;
 }
 
-std::vector<TrialValue> NotOperation::execute(const std::vector<TrialValue> &args) const
+void NotOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "'not' operator requires 1 argument.");
-    if (!std::holds_alternative<bool>(args[0]))
+    if (!std::holds_alternative<bool>(*args[0]))
         throw EngineException(EngineErrc::LogicalOperatorRequiresBoolean, "'not' operator requires a boolean argument.");
-    return {!std::get<bool>(args[0])};
-}
\ No newline at end of file
+    *results[0] = !std::get<bool>(*args[0]);
+}
+// --- Batched ("trial lanes") kernels ---
+
+namespace
+{
+    // Writes args[0] into every lane of `out`, broadcasting uniform arguments.
+    inline void load_lanes(const LaneArgument &arg, double *out, size_t lanes)
+    {
+        if (arg.stride == 0)
+        {
+            std::fill(out, out + lanes, arg.data[0]);
+        }
+        else if (arg.data != out)
+        {
+            std::copy(arg.data, arg.data + lanes, out);
+        }
+    }
+
+    template <typename Fn>
+    inline void map_lanes(const LaneArgument &arg, double *out, size_t lanes, Fn fn)
+    {
+        if (arg.stride == 0)
+        {
+            std::fill(out, out + lanes, fn(arg.data[0]));
+            return;
+        }
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            out[i] = fn(arg.data[i]);
+        }
+    }
+
+    template <typename Fn>
+    inline void accumulate_lanes(const LaneArgument &arg, double *acc, size_t lanes, Fn fn)
+    {
+        if (arg.stride == 0)
+        {
+            const double value = arg.data[0];
+            for (size_t i = 0; i < lanes; ++i)
+            {
+                acc[i] = fn(acc[i], value);
+            }
+            return;
+        }
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            acc[i] = fn(acc[i], arg.data[i]);
+        }
+    }
+}
+
+bool VariadicBaseOperation::supports_lanes(size_t num_args) const { return num_args > 0; }
+
+void VariadicBaseOperation::execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const
+{
+    load_lanes(args[0], out, lanes);
+    if (num_args < 2)
+        return;
+    // Resolve the kernels once per node; the op never changes between arguments.
+    const ElementwiseKernels &kernels = elementwise_kernels();
+    const size_t op = kernel_index(m_code);
+    for (size_t a = 1; a < num_args; ++a)
+    {
+        const LaneArgument &arg = args[a];
+        if (m_code == OpCode::DIVIDE && kernels.any_zero(arg.data, arg.stride == 0 ? 1 : lanes))
+            throw EngineException(EngineErrc::DivisionByZero, "Division by zero");
+        if (arg.stride == 0)
+            kernels.scalar[op](out, arg.data[0], lanes);
+        else
+            kernels.vector[op](out, arg.data, lanes);
+    }
+}
+
+bool LogOperation::supports_lanes(size_t num_args) const { return num_args == 1; }
+void LogOperation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    map_lanes(args[0], out, lanes, [](double x)
+              { return std::log(x); });
+}
+bool Log10Operation::supports_lanes(size_t num_args) const { return num_args == 1; }
+void Log10Operation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    map_lanes(args[0], out, lanes, [](double x)
+              { return std::log10(x); });
+}
+bool ExpOperation::supports_lanes(size_t num_args) const { return num_args == 1; }
+void ExpOperation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    map_lanes(args[0], out, lanes, [](double x)
+              { return std::exp(x); });
+}
+bool SinOperation::supports_lanes(size_t num_args) const { return num_args == 1; }
+void SinOperation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    map_lanes(args[0], out, lanes, [](double x)
+              { return std::sin(x); });
+}
+bool CosOperation::supports_lanes(size_t num_args) const { return num_args == 1; }
+void CosOperation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    map_lanes(args[0], out, lanes, [](double x)
+              { return std::cos(x); });
+}
+bool TanOperation::supports_lanes(size_t num_args) const { return num_args == 1; }
+void TanOperation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    map_lanes(args[0], out, lanes, [](double x)
+              { return std::tan(x); });
+}
+bool IdentityOperation::supports_lanes(size_t num_args) const { return num_args == 1; }
+void IdentityOperation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    load_lanes(args[0], out, lanes);
+}
+
+bool ComparisonBaseOperation::supports_lanes(size_t num_args) const { return num_args == 2; }
+
+void ComparisonBaseOperation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    const LaneArgument &left = args[0];
+    const LaneArgument &right = args[1];
+    auto compare = [&](auto predicate)
+    {
+        for (size_t i = 0; i < lanes; ++i)
+        {
+            out[i] = predicate(left[i], right[i]) ? 1.0 : 0.0;
+        }
+    };
+    switch (m_code)
+    {
+    case OpCode::EQ:
+        compare([](double l, double r)
+                { return l == r; });
+        break;
+    case OpCode::NEQ:
+        compare([](double l, double r)
+                { return l != r; });
+        break;
+    case OpCode::GT:
+        compare([](double l, double r)
+                { return l > r; });
+        break;
+    case OpCode::LT:
+        compare([](double l, double r)
+                { return l < r; });
+        break;
+    case OpCode::GTE:
+        compare([](double l, double r)
+                { return l >= r; });
+        break;
+    case OpCode::LTE:
+        compare([](double l, double r)
+                { return l <= r; });
+        break;
+    default:
+        throw EngineException(EngineErrc::UnknownError, "Invalid comparison opcode for scalars.");
+    }
+}
+
+bool AndOperation::supports_lanes(size_t num_args) const { return num_args > 0; }
+void AndOperation::execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const
+{
+    load_lanes(args[0], out, lanes);
+    for (size_t a = 1; a < num_args; ++a)
+    {
+        accumulate_lanes(args[a], out, lanes, [](double l, double r)
+                         { return (l != 0.0 && r != 0.0) ? 1.0 : 0.0; });
+    }
+}
+
+bool OrOperation::supports_lanes(size_t num_args) const { return num_args > 0; }
+void OrOperation::execute_lanes(const LaneArgument *args, size_t num_args, double *out, size_t lanes) const
+{
+    load_lanes(args[0], out, lanes);
+    for (size_t a = 1; a < num_args; ++a)
+    {
+        accumulate_lanes(args[a], out, lanes, [](double l, double r)
+                         { return (l != 0.0 || r != 0.0) ? 1.0 : 0.0; });
+    }
+}
+
+bool NotOperation::supports_lanes(size_t num_args) const { return num_args == 1; }
+void NotOperation::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    map_lanes(args[0], out, lanes, [](double x)
+              { return x != 0.0 ? 0.0 : 1.0; });
+}
+
+// --- Device forms (see DeviceProgram.h) ---
+
+namespace
+{
+    bool lower_op(DeviceLowering &lowering, OpCode code, const uint32_t *args, size_t num_args, uint32_t result)
+    {
+        DeviceOp op;
+        if (!device_op_for(code, op))
+            return false;
+        lowering.emit(op, args, num_args, result);
+        return true;
+    }
+}
+
+bool VariadicBaseOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, m_code, args, num_args, result); }
+bool ComparisonBaseOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, m_code, args, num_args, result); }
+bool LogOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::LOG, args, num_args, result); }
+bool Log10Operation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::LOG10, args, num_args, result); }
+bool ExpOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::EXP, args, num_args, result); }
+bool SinOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::SIN, args, num_args, result); }
+bool CosOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::COS, args, num_args, result); }
+bool TanOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::TAN, args, num_args, result); }
+bool AndOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::AND, args, num_args, result); }
+bool OrOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::OR, args, num_args, result); }
+bool NotOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const { return lower_op(lowering, OpCode::NOT, args, num_args, result); }
+bool IdentityOperation::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const
+{
+    lowering.emit(DeviceOp::Move, args, num_args, result);
+    return true;
+}
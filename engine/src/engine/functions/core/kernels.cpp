@@ -0,0 +1,364 @@
+#include "include/engine/functions/core/kernels.h"
+#include "include/engine/core/EngineException.h"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VSE_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define VSE_TARGET_AVX2
+#define VSE_TARGET_AVX512
+#else
+#define VSE_TARGET_AVX2 __attribute__((target("avx2")))
+#define VSE_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VSE_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    template <OpCode Op>
+    inline double apply(double left, double right)
+    {
+        if constexpr (Op == OpCode::ADD)
+            return left + right;
+        else if constexpr (Op == OpCode::SUBTRACT)
+            return left - right;
+        else if constexpr (Op == OpCode::MULTIPLY)
+            return left * right;
+        else if constexpr (Op == OpCode::DIVIDE)
+            return left / right;
+        else
+            return std::pow(left, right);
+    }
+
+    // --- Portable kernels; also the tails of the SIMD kernels and all of POWER ---
+
+    template <OpCode Op>
+    void scalar_vector(double *acc, const double *rhs, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+            acc[i] = apply<Op>(acc[i], rhs[i]);
+    }
+
+    template <OpCode Op>
+    void scalar_broadcast(double *acc, double rhs, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+            acc[i] = apply<Op>(acc[i], rhs);
+    }
+
+    bool scalar_any_zero(const double *values, size_t n)
+    {
+        bool zero = false;
+        for (size_t i = 0; i < n; ++i)
+            zero |= values[i] == 0.0;
+        return zero;
+    }
+
+#if defined(VSE_SIMD_X86)
+    // --- AVX2: 4 doubles per step ---
+
+    template <OpCode Op>
+    VSE_TARGET_AVX2 inline __m256d apply_avx2(__m256d left, __m256d right)
+    {
+        if constexpr (Op == OpCode::ADD)
+            return _mm256_add_pd(left, right);
+        else if constexpr (Op == OpCode::SUBTRACT)
+            return _mm256_sub_pd(left, right);
+        else if constexpr (Op == OpCode::MULTIPLY)
+            return _mm256_mul_pd(left, right);
+        else
+            return _mm256_div_pd(left, right);
+    }
+
+    template <OpCode Op>
+    VSE_TARGET_AVX2 void avx2_vector(double *acc, const double *rhs, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(acc + i, apply_avx2<Op>(_mm256_loadu_pd(acc + i), _mm256_loadu_pd(rhs + i)));
+        scalar_vector<Op>(acc + i, rhs + i, n - i);
+    }
+
+    template <OpCode Op>
+    VSE_TARGET_AVX2 void avx2_broadcast(double *acc, double rhs, size_t n)
+    {
+        const __m256d right = _mm256_set1_pd(rhs);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(acc + i, apply_avx2<Op>(_mm256_loadu_pd(acc + i), right));
+        scalar_broadcast<Op>(acc + i, rhs, n - i);
+    }
+
+    VSE_TARGET_AVX2 bool avx2_any_zero(const double *values, size_t n)
+    {
+        const __m256d zero = _mm256_setzero_pd();
+        __m256d mask = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            mask = _mm256_or_pd(mask, _mm256_cmp_pd(_mm256_loadu_pd(values + i), zero, _CMP_EQ_OQ));
+        return _mm256_movemask_pd(mask) != 0 || scalar_any_zero(values + i, n - i);
+    }
+
+    // --- AVX-512: 8 doubles per step ---
+
+    template <OpCode Op>
+    VSE_TARGET_AVX512 inline __m512d apply_avx512(__m512d left, __m512d right)
+    {
+        if constexpr (Op == OpCode::ADD)
+            return _mm512_add_pd(left, right);
+        else if constexpr (Op == OpCode::SUBTRACT)
+            return _mm512_sub_pd(left, right);
+        else if constexpr (Op == OpCode::MULTIPLY)
+            return _mm512_mul_pd(left, right);
+        else
+            return _mm512_div_pd(left, right);
+    }
+
+    template <OpCode Op>
+    VSE_TARGET_AVX512 void avx512_vector(double *acc, const double *rhs, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(acc + i, apply_avx512<Op>(_mm512_loadu_pd(acc + i), _mm512_loadu_pd(rhs + i)));
+        scalar_vector<Op>(acc + i, rhs + i, n - i);
+    }
+
+    template <OpCode Op>
+    VSE_TARGET_AVX512 void avx512_broadcast(double *acc, double rhs, size_t n)
+    {
+        const __m512d right = _mm512_set1_pd(rhs);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm512_storeu_pd(acc + i, apply_avx512<Op>(_mm512_loadu_pd(acc + i), right));
+        scalar_broadcast<Op>(acc + i, rhs, n - i);
+    }
+
+    VSE_TARGET_AVX512 bool avx512_any_zero(const double *values, size_t n)
+    {
+        const __m512d zero = _mm512_setzero_pd();
+        __mmask8 mask = 0;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            mask |= _mm512_cmp_pd_mask(_mm512_loadu_pd(values + i), zero, _CMP_EQ_OQ);
+        return mask != 0 || scalar_any_zero(values + i, n - i);
+    }
+
+    bool cpu_supports(SimdLevel level)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (!osxsave)
+            return false;
+        const unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if (level == SimdLevel::AVX2)
+            return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+        return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+#else
+        __builtin_cpu_init();
+        if (level == SimdLevel::AVX2)
+            return __builtin_cpu_supports("avx2");
+        return __builtin_cpu_supports("avx512f");
+#endif
+    }
+#endif
+
+#if defined(VSE_SIMD_NEON)
+    // --- NEON: 2 doubles per step ---
+
+    template <OpCode Op>
+    inline float64x2_t apply_neon(float64x2_t left, float64x2_t right)
+    {
+        if constexpr (Op == OpCode::ADD)
+            return vaddq_f64(left, right);
+        else if constexpr (Op == OpCode::SUBTRACT)
+            return vsubq_f64(left, right);
+        else if constexpr (Op == OpCode::MULTIPLY)
+            return vmulq_f64(left, right);
+        else
+            return vdivq_f64(left, right);
+    }
+
+    template <OpCode Op>
+    void neon_vector(double *acc, const double *rhs, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+            vst1q_f64(acc + i, apply_neon<Op>(vld1q_f64(acc + i), vld1q_f64(rhs + i)));
+        scalar_vector<Op>(acc + i, rhs + i, n - i);
+    }
+
+    template <OpCode Op>
+    void neon_broadcast(double *acc, double rhs, size_t n)
+    {
+        const float64x2_t right = vdupq_n_f64(rhs);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+            vst1q_f64(acc + i, apply_neon<Op>(vld1q_f64(acc + i), right));
+        scalar_broadcast<Op>(acc + i, rhs, n - i);
+    }
+
+    bool neon_any_zero(const double *values, size_t n)
+    {
+        uint64x2_t mask = vdupq_n_u64(0);
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+            mask = vorrq_u64(mask, vceqzq_f64(vld1q_f64(values + i)));
+        return (vgetq_lane_u64(mask, 0) | vgetq_lane_u64(mask, 1)) != 0 || scalar_any_zero(values + i, n - i);
+    }
+#endif
+
+    const ElementwiseKernels SCALAR_KERNELS = {
+        SimdLevel::Scalar,
+        {scalar_vector<OpCode::ADD>, scalar_vector<OpCode::SUBTRACT>, scalar_vector<OpCode::MULTIPLY>, scalar_vector<OpCode::DIVIDE>, scalar_vector<OpCode::POWER>},
+        {scalar_broadcast<OpCode::ADD>, scalar_broadcast<OpCode::SUBTRACT>, scalar_broadcast<OpCode::MULTIPLY>, scalar_broadcast<OpCode::DIVIDE>, scalar_broadcast<OpCode::POWER>},
+        scalar_any_zero};
+
+#if defined(VSE_SIMD_X86)
+    const ElementwiseKernels AVX2_KERNELS = {
+        SimdLevel::AVX2,
+        {avx2_vector<OpCode::ADD>, avx2_vector<OpCode::SUBTRACT>, avx2_vector<OpCode::MULTIPLY>, avx2_vector<OpCode::DIVIDE>, scalar_vector<OpCode::POWER>},
+        {avx2_broadcast<OpCode::ADD>, avx2_broadcast<OpCode::SUBTRACT>, avx2_broadcast<OpCode::MULTIPLY>, avx2_broadcast<OpCode::DIVIDE>, scalar_broadcast<OpCode::POWER>},
+        avx2_any_zero};
+
+    const ElementwiseKernels AVX512_KERNELS = {
+        SimdLevel::AVX512,
+        {avx512_vector<OpCode::ADD>, avx512_vector<OpCode::SUBTRACT>, avx512_vector<OpCode::MULTIPLY>, avx512_vector<OpCode::DIVIDE>, scalar_vector<OpCode::POWER>},
+        {avx512_broadcast<OpCode::ADD>, avx512_broadcast<OpCode::SUBTRACT>, avx512_broadcast<OpCode::MULTIPLY>, avx512_broadcast<OpCode::DIVIDE>, scalar_broadcast<OpCode::POWER>},
+        avx512_any_zero};
+#endif
+
+#if defined(VSE_SIMD_NEON)
+    const ElementwiseKernels NEON_KERNELS = {
+        SimdLevel::NEON,
+        {neon_vector<OpCode::ADD>, neon_vector<OpCode::SUBTRACT>, neon_vector<OpCode::MULTIPLY>, neon_vector<OpCode::DIVIDE>, scalar_vector<OpCode::POWER>},
+        {neon_broadcast<OpCode::ADD>, neon_broadcast<OpCode::SUBTRACT>, neon_broadcast<OpCode::MULTIPLY>, neon_broadcast<OpCode::DIVIDE>, scalar_broadcast<OpCode::POWER>},
+        neon_any_zero};
+#endif
+
+    SimdLevel detect_simd_level()
+    {
+        SimdLevel cap = SimdLevel::AVX512;
+        if (const char *requested = std::getenv("VSE_SIMD"))
+        {
+            const std::string name(requested);
+            if (name == "scalar")
+                return SimdLevel::Scalar;
+            if (name == "avx2")
+                cap = SimdLevel::AVX2;
+        }
+#if defined(VSE_SIMD_X86)
+        if (cap == SimdLevel::AVX512 && cpu_supports(SimdLevel::AVX512))
+            return SimdLevel::AVX512;
+        if (cpu_supports(SimdLevel::AVX2))
+            return SimdLevel::AVX2;
+        return SimdLevel::Scalar;
+#elif defined(VSE_SIMD_NEON)
+        (void)cap;
+        return SimdLevel::NEON;
+#else
+        (void)cap;
+        return SimdLevel::Scalar;
+#endif
+    }
+}
+
+size_t kernel_index(OpCode code)
+{
+    switch (code)
+    {
+    case OpCode::ADD:
+        return 0;
+    case OpCode::SUBTRACT:
+        return 1;
+    case OpCode::MULTIPLY:
+        return 2;
+    case OpCode::DIVIDE:
+        return 3;
+    case OpCode::POWER:
+        return 4;
+    default:
+        throw EngineException(EngineErrc::UnknownError, "Unsupported variadic op code.");
+    }
+}
+
+SimdLevel best_simd_level()
+{
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+bool simd_level_supported(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar:
+        return true;
+#if defined(VSE_SIMD_X86)
+    case SimdLevel::AVX2:
+    case SimdLevel::AVX512:
+        return cpu_supports(level);
+#elif defined(VSE_SIMD_NEON)
+    case SimdLevel::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const char *simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar:
+        return "scalar";
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::AVX512:
+        return "avx512";
+    case SimdLevel::NEON:
+        return "neon";
+    }
+    return "scalar";
+}
+
+const ElementwiseKernels &elementwise_kernels()
+{
+    static const ElementwiseKernels &kernels = elementwise_kernels(best_simd_level());
+    return kernels;
+}
+
+const ElementwiseKernels &elementwise_kernels(SimdLevel level)
+{
+    if (!simd_level_supported(level))
+    {
+        return SCALAR_KERNELS;
+    }
+    switch (level)
+    {
+#if defined(VSE_SIMD_X86)
+    case SimdLevel::AVX2:
+        return AVX2_KERNELS;
+    case SimdLevel::AVX512:
+        return AVX512_KERNELS;
+#elif defined(VSE_SIMD_NEON)
+    case SimdLevel::NEON:
+        return NEON_KERNELS;
+#endif
+    default:
+        return SCALAR_KERNELS;
+    }
+}
@@ -5,53 +5,118 @@
 #include <vector>
 #include <numeric>
 #include <algorithm>
+#include <cctype>
 
 void register_sir_model_operation(FunctionRegistry &registry)
 {
     registry.register_function("SirModel", []
-                               { return std::make_unique<SirModelOperation>(); });
+                               { return std::make_unique<SirModelOperation>(); }, FunctionPurity::Pure);
 }
 
-std::vector<TrialValue> SirModelOperation::execute(const std::vector<TrialValue> &args) const
+namespace
 {
-    if (args.size() != 7)
+    enum class SirIntegrator
     {
-        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'SirModel' requires 7 arguments: s0, i0, r0, beta, gamma, periods, dt.");
+        Euler,
+        RungeKutta4
+    };
+
+    bool equals_ignoring_case(const std::string &value, const char *expected)
+    {
+        size_t i = 0;
+        for (; i < value.size() && expected[i] != '\0'; ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(value[i])) != expected[i])
+                return false;
+        }
+        return i == value.size() && expected[i] == '\0';
+    }
+
+    SirIntegrator parse_integrator(const TrialValue &value)
+    {
+        const std::string &name = std::get<std::string>(value);
+        if (equals_ignoring_case(name, "euler"))
+            return SirIntegrator::Euler;
+        if (equals_ignoring_case(name, "rk4"))
+            return SirIntegrator::RungeKutta4;
+        throw EngineException(EngineErrc::MismatchedArgumentType, "Invalid integrator for SirModel. Expected 'euler' or 'rk4', but got '" + name + "'.");
+    }
+}
+
+void SirModelOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    if (args.size() != 7 && args.size() != 8)
+    {
+        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'SirModel' requires 7 arguments: s0, i0, r0, beta, gamma, periods, dt, and an optional integrator ('euler' or 'rk4').");
     }
 
-    const double s0 = std::get<double>(args[0]);
-    const double i0 = std::get<double>(args[1]);
-    const double r0 = std::get<double>(args[2]);
-    const double beta = std::get<double>(args[3]);  // Transmission rate
-    const double gamma = std::get<double>(args[4]); // Recovery rate
-    const int periods = static_cast<int>(std::get<double>(args[5]));
-    const double dt = std::get<double>(args[6]); // Time step (e.g., 1 for 1 day)
+    const double s0 = std::get<double>(*args[0]);
+    const double i0 = std::get<double>(*args[1]);
+    const double r0 = std::get<double>(*args[2]);
+    const double beta = std::get<double>(*args[3]);  // Transmission rate
+    const double gamma = std::get<double>(*args[4]); // Recovery rate
+    const int periods = static_cast<int>(std::get<double>(*args[5]));
+    const double dt = std::get<double>(*args[6]); // Time step (e.g., 1 for 1 day)
+    const SirIntegrator integrator = args.size() == 8 ? parse_integrator(*args[7]) : SirIntegrator::Euler;
 
     if (periods <= 0)
-        return {std::vector<double>{}, std::vector<double>{}, std::vector<double>{}};
+    {
+        for (size_t k = 0; k < 3; ++k)
+            assign_series(*results[k], 0);
+        return;
+    }
 
     const double N = s0 + i0 + r0; // Total population
     if (N == 0)
         throw EngineException(EngineErrc::InvalidSamplerParameters, "Total population in SirModel cannot be zero.");
 
-    std::vector<double> s(periods), i(periods), r(periods);
+    auto &s = assign_series(*results[0], static_cast<size_t>(periods));
+    auto &i = assign_series(*results[1], static_cast<size_t>(periods));
+    auto &r = assign_series(*results[2], static_cast<size_t>(periods));
     s[0] = s0;
     i[0] = i0;
     r[0] = r0;
 
+    if (integrator == SirIntegrator::Euler)
+    {
+        for (int t = 0; t < periods - 1; ++t)
+        {
+            const double s_t = s[t];
+            const double i_t = i[t];
+            const double infections = beta * s_t * i_t / N;
+
+            s[t + 1] = std::max(0.0, s_t - infections * dt);
+            i[t + 1] = std::max(0.0, i_t + (infections - gamma * i_t) * dt);
+            r[t + 1] = std::max(0.0, r[t] + (gamma * i_t) * dt);
+        }
+        return;
+    }
+
+    // Classical fourth-order Runge-Kutta. R never feeds back into S and I, so only they need
+    // intermediate stages; R integrates the recoveries of the I stages.
+    const double half_dt = 0.5 * dt;
+    const double sixth_dt = dt / 6.0;
     for (int t = 0; t < periods - 1; ++t)
     {
-        const double s_t = s[t];
-        const double i_t = i[t];
+        const double s1 = s[t];
+        const double i1 = i[t];
+        const double f1 = beta * s1 * i1 / N;
+        const double ds1 = -f1, di1 = f1 - gamma * i1;
 
-        const double dS = (-beta * s_t * i_t / N) * dt;
-        const double dI = (beta * s_t * i_t / N - gamma * i_t) * dt;
-        const double dR = (gamma * i_t) * dt;
+        const double s2 = s1 + half_dt * ds1, i2 = i1 + half_dt * di1;
+        const double f2 = beta * s2 * i2 / N;
+        const double ds2 = -f2, di2 = f2 - gamma * i2;
 
-        s[t + 1] = std::max(0.0, s_t + dS);
-        i[t + 1] = std::max(0.0, i_t + dI);
-        r[t + 1] = std::max(0.0, r[t] + dR);
-    }
+        const double s3 = s1 + half_dt * ds2, i3 = i1 + half_dt * di2;
+        const double f3 = beta * s3 * i3 / N;
+        const double ds3 = -f3, di3 = f3 - gamma * i3;
+
+        const double s4 = s1 + dt * ds3, i4 = i1 + dt * di3;
+        const double f4 = beta * s4 * i4 / N;
+        const double ds4 = -f4, di4 = f4 - gamma * i4;
 
-    return {TrialValue(s), TrialValue(i), TrialValue(r)};
-}
\ No newline at end of file
+        s[t + 1] = std::max(0.0, s1 + sixth_dt * (ds1 + 2.0 * (ds2 + ds3) + ds4));
+        i[t + 1] = std::max(0.0, i1 + sixth_dt * (di1 + 2.0 * (di2 + di3) + di4));
+        r[t + 1] = std::max(0.0, r[t] + sixth_dt * gamma * (i1 + 2.0 * (i2 + i3) + i4));
+    }
+}
@@ -1,5 +1,6 @@
 #include "include/engine/functions/financial/BlackScholes.h"
 #include "include/engine/functions/FunctionRegistry.h"
+#include "include/engine/core/DeviceProgram.h"
 #include "include/engine/core/EngineException.h"
 #include <cmath>
 #include <string>
@@ -9,52 +10,185 @@
 void register_black_scholes_operation(FunctionRegistry &registry)
 {
     registry.register_function("BlackScholes", []
-                               { return std::make_unique<BlackScholesOperation>(); });
+                               { return std::make_unique<BlackScholesOperation>(); }, FunctionPurity::Pure);
+    registry.register_function("BlackScholesGreeks", []
+                               { return std::make_unique<BlackScholesGreeksOperation>(); }, FunctionPurity::Pure);
 }
 
-double cndf(double x)
+namespace
 {
-    return 0.5 * std::erfc(-x / std::sqrt(2.0));
-}
+    constexpr double INV_SQRT_2PI = 0.39894228040143267794;
 
-std::vector<TrialValue> BlackScholesOperation::execute(const std::vector<TrialValue> &args) const
-{
-    if (args.size() != 6)
+    // Compares without building a lowered copy of the option type on every call.
+    bool equals_ignoring_case(const std::string &value, const char *expected)
+    {
+        size_t i = 0;
+        for (; i < value.size() && expected[i] != '\0'; ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(value[i])) != expected[i])
+                return false;
+        }
+        return i == value.size() && expected[i] == '\0';
+    }
+
+    std::optional<OptionType> parse_option_type(const std::string &name)
     {
-        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'BlackScholes' requires 6 arguments: spot, strike, rate, time_to_maturity, volatility, option_type ('call' or 'put').");
+        if (equals_ignoring_case(name, "call"))
+            return OptionType::Call;
+        if (equals_ignoring_case(name, "put"))
+            return OptionType::Put;
+        return std::nullopt;
     }
 
-    const double S = std::get<double>(args[0]);                   // Spot price
-    const double K = std::get<double>(args[1]);                   // Strike price
-    const double r = std::get<double>(args[2]);                   // Risk-free rate
-    const double T = std::get<double>(args[3]);                   // Time to maturity in years
-    const double v = std::get<double>(args[4]);                   // Volatility
-    std::string option_type_str = std::get<std::string>(args[5]); // Option type
+    [[noreturn]] void throw_invalid_option_type(const std::string &name, const char *function)
+    {
+        std::string lowered = name;
+        std::transform(lowered.begin(), lowered.end(), lowered.begin(),
+                       [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        throw EngineException(EngineErrc::MismatchedArgumentType, "Invalid option_type for " + std::string(function) + ". Expected 'call' or 'put', but got '" + lowered + "'.");
+    }
+
+    void check_inputs(double S, double K, double T, double v)
+    {
+        if (!valid_black_scholes_inputs(S, K, T, v))
+        {
+            throw EngineException(EngineErrc::InvalidSamplerParameters, "Black-Scholes inputs (spot, strike, time, volatility) must be positive.");
+        }
+    }
 
-    if (S <= 0 || K <= 0 || T <= 0 || v <= 0)
+    // Writes the price to out[0] and, when num_outputs is 5, delta, gamma, vega and theta after
+    // it. Inputs must have passed check_inputs().
+    inline void price_option(double S, double K, double r, double T, double v, OptionType type, double *out, size_t num_outputs)
     {
-        throw EngineException(EngineErrc::InvalidSamplerParameters, "Black-Scholes inputs (spot, strike, time, volatility) must be positive.");
+        const double sign = type == OptionType::Call ? 1.0 : -1.0;
+        const BlackScholesTerms terms = black_scholes_terms(S, K, r, T, v, sign);
+        out[0] = terms.price;
+        if (num_outputs == 1)
+            return;
+        const double density = INV_SQRT_2PI * std::exp(-0.5 * terms.d1 * terms.d1);
+        out[1] = sign * terms.n1;
+        out[2] = density / (S * terms.v_sqrt_t);
+        out[3] = S * density * terms.sqrt_t;
+        out[4] = -S * density * v / (2.0 * terms.sqrt_t) - sign * r * terms.discounted_strike * terms.n2;
     }
 
-    std::transform(option_type_str.begin(), option_type_str.end(), option_type_str.begin(),
-                   [](unsigned char c)
-                   { return static_cast<char>(std::tolower(c)); });
+    // Length of the vector arguments, or 0 when all are scalars.
+    size_t option_count(ArgumentSpan args, const char *function)
+    {
+        size_t count = 0;
+        for (size_t a = 0; a < 5; ++a)
+        {
+            if (const auto *vec = std::get_if<std::vector<double>>(args[a]))
+            {
+                if (count != 0 && vec->size() != count)
+                    throw EngineException(EngineErrc::VectorSizeMismatch, "Vector arguments of " + std::string(function) + " must all have the same length.");
+                count = vec->size();
+                if (count == 0)
+                    throw EngineException(EngineErrc::EmptyVectorOperation, "Vector arguments of " + std::string(function) + " cannot be empty.");
+            }
+            else if (!std::holds_alternative<double>(*args[a]))
+            {
+                throw EngineException(EngineErrc::MismatchedArgumentType, "Argument " + std::to_string(a + 1) + " of " + std::string(function) + " must be a scalar or a vector.");
+            }
+        }
+        return count;
+    }
+}
 
-    const double d1 = (std::log(S / K) + (r + (v * v) / 2.0) * T) / (v * std::sqrt(T));
-    const double d2 = d1 - v * std::sqrt(T);
+template <size_t NumResults>
+std::vector<size_t> BlackScholesBase<NumResults>::bind_literal_arguments(const std::vector<const TrialValue *> &literals)
+{
+    if (literals.size() != 6 || !literals[5])
+        return {};
+    const auto *name = std::get_if<std::string>(literals[5]);
+    // An invalid type is left to the call, which reports it like any other argument error.
+    if (!name || !parse_option_type(*name))
+        return {};
+    m_option_type = parse_option_type(*name);
+    return {5};
+}
 
-    if (option_type_str == "call")
+template <size_t NumResults>
+void BlackScholesBase<NumResults>::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    const char *function = NumResults == 1 ? "BlackScholes" : "BlackScholesGreeks";
+    const size_t expected_args = m_option_type ? 5 : 6;
+    if (args.size() != expected_args)
     {
-        const double call_price = S * cndf(d1) - K * std::exp(-r * T) * cndf(d2);
-        return {call_price};
+        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function '" + std::string(function) + "' requires 6 arguments: spot, strike, rate, time_to_maturity, volatility, option_type ('call' or 'put').");
     }
-    else if (option_type_str == "put")
+
+    OptionType type;
+    if (m_option_type)
     {
-        const double put_price = K * std::exp(-r * T) * cndf(-d2) - S * cndf(-d1);
-        return {put_price};
+        type = *m_option_type;
     }
     else
     {
-        throw EngineException(EngineErrc::MismatchedArgumentType, "Invalid option_type for BlackScholes. Expected 'call' or 'put', but got '" + option_type_str + "'.");
+        const std::string &option_type_str = std::get<std::string>(*args[5]);
+        const std::optional<OptionType> parsed = parse_option_type(option_type_str);
+        if (!parsed)
+            throw_invalid_option_type(option_type_str, function);
+        type = *parsed;
+    }
+
+    const size_t count = option_count(args, function);
+    double values[NumResults];
+    if (count == 0)
+    {
+        const double S = std::get<double>(*args[0]); // Spot price
+        const double K = std::get<double>(*args[1]); // Strike price
+        const double r = std::get<double>(*args[2]); // Risk-free rate
+        const double T = std::get<double>(*args[3]); // Time to maturity in years
+        const double v = std::get<double>(*args[4]); // Volatility
+        check_inputs(S, K, T, v);
+        price_option(S, K, r, T, v, type, values, NumResults);
+        for (size_t k = 0; k < NumResults; ++k)
+            *results[k] = values[k];
+        return;
     }
-}
\ No newline at end of file
+
+    const Broadcast S = broadcast_series(*args[0]), K = broadcast_series(*args[1]), r = broadcast_series(*args[2]), T = broadcast_series(*args[3]), v = broadcast_series(*args[4]);
+    for (size_t i = 0; i < count; ++i)
+    {
+        check_inputs(S[i], K[i], T[i], v[i]);
+    }
+    double *outputs[NumResults];
+    for (size_t k = 0; k < NumResults; ++k)
+    {
+        outputs[k] = assign_series(*results[k], count).data();
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        price_option(S[i], K[i], r[i], T[i], v[i], type, values, NumResults);
+        for (size_t k = 0; k < NumResults; ++k)
+            outputs[k][i] = values[k];
+    }
+}
+
+template <size_t NumResults>
+void BlackScholesBase<NumResults>::execute_lanes(const LaneArgument *args, size_t, double *out, size_t lanes) const
+{
+    for (size_t i = 0; i < lanes; ++i)
+    {
+        check_inputs(args[0][i], args[1][i], args[3][i], args[4][i]);
+    }
+    const OptionType type = *m_option_type;
+    for (size_t i = 0; i < lanes; ++i)
+    {
+        price_option(args[0][i], args[1][i], args[2][i], args[3][i], args[4][i], type, out + i, 1);
+    }
+}
+
+template <size_t NumResults>
+bool BlackScholesBase<NumResults>::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const
+{
+    if (!supports_lanes(num_args))
+        return false;
+    lowering.emit(*m_option_type == OptionType::Call ? DeviceOp::BlackScholesCall : DeviceOp::BlackScholesPut, args, num_args, result);
+    return true;
+}
+
+template class BlackScholesBase<1>;
+template class BlackScholesBase<5>;
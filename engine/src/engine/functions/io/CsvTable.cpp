@@ -0,0 +1,706 @@
+#include "include/engine/functions/io/CsvTable.h"
+#include "include/engine/core/EngineException.h"
+#include "include/engine/io/MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// The csv.hpp header from the csv-parser library generates some warnings on MSVC
+// with high warning levels. We will temporarily disable the specific warning (C4127)
+// just for the inclusion of this header.
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4127) // C4127: conditional expression is constant
+#endif
+
+#include "csv.hpp"
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+using json = nlohmann::json;
+
+namespace
+{
+    constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+    constexpr char SIDECAR_MAGIC[8] = {'V', 'S', 'E', 'C', 'S', 'V', '0', '1'};
+    constexpr uint32_t BYTE_ORDER_PROBE = 0x01020304;
+    std::atomic<uint64_t> g_sidecar_threshold{uint64_t(64) << 20};
+
+    // std::stod without the exceptions: whitespace, a numeric prefix, "inf" and "nan" are
+    // accepted, and text without a number or out of the range of double is not. Plain numbers
+    // take the from_chars fast path, which rounds exactly as strtod does.
+    bool parse_number(const char *begin, const char *end, double &value)
+    {
+        const auto result = std::from_chars(begin, end, value);
+        if (result.ec == std::errc() && result.ptr == end)
+            return true;
+        const std::string text(begin, end);
+        char *parsed_end = nullptr;
+        errno = 0;
+        value = std::strtod(text.c_str(), &parsed_end);
+        if (parsed_end != text.c_str() && errno != ERANGE)
+            return true;
+        value = 0.0;
+        return false;
+    }
+
+    // The line starting at `pos`, without its line break; `pos` moves to the next line.
+    std::pair<const char *, const char *> next_line(const char *&pos, const char *end)
+    {
+        const char *begin = pos;
+        const char *newline = static_cast<const char *>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+        const char *line_end = newline ? newline : end;
+        pos = newline ? newline + 1 : end;
+        if (line_end > begin && line_end[-1] == '\r')
+            --line_end;
+        return {begin, line_end};
+    }
+
+    std::vector<std::string> split_fields(const char *begin, const char *end)
+    {
+        std::vector<std::string> fields;
+        const char *field = begin;
+        for (const char *p = begin; p <= end; ++p)
+        {
+            if (p == end || *p == ',')
+            {
+                fields.emplace_back(field, p);
+                field = p + 1;
+            }
+        }
+        return fields;
+    }
+
+    // Calls fn(slot, begin, end) for every field of the line whose column has a slot; fields
+    // missing from short lines are empty.
+    template <typename Fn>
+    void for_each_field(const char *begin, const char *end, const std::vector<int> &slot_of, Fn fn)
+    {
+        size_t index = 0;
+        const char *field = begin;
+        for (const char *p = begin; index < slot_of.size(); ++p)
+        {
+            if (p == end || *p == ',')
+            {
+                if (slot_of[index] >= 0)
+                    fn(static_cast<size_t>(slot_of[index]), field, p);
+                ++index;
+                field = p + 1;
+                if (p == end)
+                    break;
+            }
+        }
+        for (; index < slot_of.size(); ++index)
+        {
+            if (slot_of[index] >= 0)
+                fn(static_cast<size_t>(slot_of[index]), end, end);
+        }
+    }
+
+    struct ParsedFile
+    {
+        std::vector<std::string> header;
+        size_t num_rows = 0;
+        std::vector<CsvTable::Column> columns; // In the order asked for.
+    };
+
+    std::vector<int> slots_of(const std::vector<std::string> &header, const std::vector<std::string> &names)
+    {
+        std::vector<int> slot_of(header.size(), -1);
+        for (size_t i = 0; i < header.size(); ++i)
+        {
+            const auto it = std::find(names.begin(), names.end(), header[i]);
+            if (it != names.end() && slot_of[i] < 0)
+                slot_of[i] = static_cast<int>(it - names.begin());
+        }
+        return slot_of;
+    }
+
+    void add_text(CsvTable::Column &column, std::unordered_map<std::string, uint32_t> &dictionary, std::string cell)
+    {
+        const auto inserted = dictionary.emplace(cell, static_cast<uint32_t>(column.dictionary.size()));
+        if (inserted.second)
+            column.dictionary.push_back(std::move(cell));
+        column.codes.push_back(inserted.first->second);
+    }
+
+    // Mapped files without quotes: newline-aligned chunks parsed on parallel threads.
+    void parse_mapped(const char *data, size_t size, const std::vector<std::string> &names, ParsedFile &file)
+    {
+        const char *const end = data + size;
+        const char *pos = data;
+        if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+            pos += 3;
+        while (pos < end)
+        {
+            const auto line = next_line(pos, end);
+            if (line.first != line.second)
+            {
+                file.header = split_fields(line.first, line.second);
+                break;
+            }
+        }
+        const std::vector<int> slot_of = slots_of(file.header, names);
+
+        const size_t num_chunks = std::clamp<size_t>(static_cast<size_t>(end - pos) / MIN_CHUNK_BYTES, 1, std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<const char *> bounds(num_chunks + 1, end);
+        bounds[0] = pos;
+        for (size_t k = 1; k < num_chunks; ++k)
+        {
+            const char *split = std::max(bounds[k - 1], pos + (end - pos) * static_cast<std::ptrdiff_t>(k) / static_cast<std::ptrdiff_t>(num_chunks));
+            const char *newline = static_cast<const char *>(std::memchr(split, '\n', static_cast<size_t>(end - split)));
+            bounds[k] = newline ? newline + 1 : end;
+        }
+
+        struct Chunk
+        {
+            size_t num_rows = 0;
+            std::vector<std::vector<double>> values;
+            std::vector<std::vector<size_t>> invalid_rows;
+        };
+        std::vector<Chunk> chunks(num_chunks);
+        auto parse_chunk = [&](size_t k)
+        {
+            Chunk &chunk = chunks[k];
+            chunk.values.resize(names.size());
+            chunk.invalid_rows.resize(names.size());
+            const char *p = bounds[k];
+            while (p < bounds[k + 1])
+            {
+                const auto line = next_line(p, bounds[k + 1]);
+                if (line.first == line.second)
+                    continue;
+                const size_t row = chunk.num_rows++;
+                for_each_field(line.first, line.second, slot_of, [&](size_t slot, const char *b, const char *e)
+                               {
+                    double value = 0.0;
+                    if (!parse_number(b, e, value))
+                        chunk.invalid_rows[slot].push_back(row);
+                    chunk.values[slot].push_back(value); });
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t k = 1; k < num_chunks; ++k)
+        {
+            threads.emplace_back(parse_chunk, k);
+        }
+        parse_chunk(0);
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        file.columns.resize(names.size());
+        for (size_t slot = 0; slot < names.size(); ++slot)
+        {
+            file.columns[slot].name = names[slot];
+        }
+        for (const Chunk &chunk : chunks)
+        {
+            for (size_t slot = 0; slot < names.size(); ++slot)
+            {
+                CsvTable::Column &column = file.columns[slot];
+                column.values.insert(column.values.end(), chunk.values[slot].begin(), chunk.values[slot].end());
+                for (size_t row : chunk.invalid_rows[slot])
+                {
+                    column.invalid_rows.push_back(file.num_rows + row);
+                }
+            }
+            file.num_rows += chunk.num_rows;
+        }
+
+        // Text is only kept for the columns that turned out to hold some.
+        std::vector<int> text_slot_of(slot_of.size(), -1);
+        bool any_text = false;
+        for (size_t i = 0; i < slot_of.size(); ++i)
+        {
+            if (slot_of[i] >= 0 && !file.columns[static_cast<size_t>(slot_of[i])].is_numeric())
+            {
+                text_slot_of[i] = slot_of[i];
+                any_text = true;
+            }
+        }
+        if (!any_text)
+            return;
+        std::vector<std::unordered_map<std::string, uint32_t>> dictionaries(names.size());
+        for (const char *p = bounds[0]; p < end;)
+        {
+            const auto line = next_line(p, end);
+            if (line.first == line.second)
+                continue;
+            for_each_field(line.first, line.second, text_slot_of, [&](size_t slot, const char *b, const char *e)
+                           { add_text(file.columns[slot], dictionaries[slot], std::string(b, e)); });
+        }
+    }
+
+    // Files with quoted fields, through csv-parser.
+    void parse_quoted(const std::string &path, const std::vector<std::string> &names, ParsedFile &file)
+    {
+        csv::CSVReader reader(path);
+        file.header = reader.get_col_names();
+        std::vector<std::string> present;
+        for (const std::string &name : names)
+        {
+            if (std::find(file.header.begin(), file.header.end(), name) != file.header.end())
+                present.push_back(name);
+        }
+        file.columns.resize(names.size());
+        for (size_t slot = 0; slot < names.size(); ++slot)
+        {
+            file.columns[slot].name = names[slot];
+        }
+        std::vector<std::unordered_map<std::string, uint32_t>> dictionaries(names.size());
+        std::vector<std::vector<std::string>> cells(names.size());
+        for (const auto &row : reader)
+        {
+            const size_t r = file.num_rows++;
+            for (size_t slot = 0; slot < names.size(); ++slot)
+            {
+                if (std::find(present.begin(), present.end(), names[slot]) == present.end())
+                    continue;
+                CsvTable::Column &column = file.columns[slot];
+                std::string cell = row[names[slot]].get<>();
+                double value = 0.0;
+                if (!parse_number(cell.data(), cell.data() + cell.size(), value))
+                    column.invalid_rows.push_back(r);
+                column.values.push_back(value);
+                cells[slot].push_back(std::move(cell));
+            }
+        }
+        for (size_t slot = 0; slot < names.size(); ++slot)
+        {
+            if (file.columns[slot].is_numeric())
+                continue;
+            for (std::string &cell : cells[slot])
+            {
+                add_text(file.columns[slot], dictionaries[slot], std::move(cell));
+            }
+        }
+    }
+
+    // Sidecar cache: native byte order, checked through a probe, since it never leaves the
+    // machine that wrote it.
+    class SidecarWriter
+    {
+    public:
+        explicit SidecarWriter(std::ofstream &out) : m_out(out) {}
+        template <typename T>
+        void put(const T &value) { m_out.write(reinterpret_cast<const char *>(&value), sizeof(T)); }
+        template <typename T>
+        void put_array(const std::vector<T> &values)
+        {
+            put<uint64_t>(values.size());
+            m_out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+        }
+        void put_string(const std::string &text)
+        {
+            put<uint64_t>(text.size());
+            m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+
+    private:
+        std::ofstream &m_out;
+    };
+
+    class SidecarReader
+    {
+    public:
+        SidecarReader(const char *data, size_t size) : m_pos(data), m_end(data + size) {}
+        bool ok() const { return m_ok; }
+        template <typename T>
+        T get()
+        {
+            T value{};
+            if (!take(sizeof(T)))
+                return value;
+            std::memcpy(&value, m_pos - sizeof(T), sizeof(T));
+            return value;
+        }
+        template <typename T>
+        std::vector<T> get_array()
+        {
+            const uint64_t count = get<uint64_t>();
+            std::vector<T> values;
+            if (!m_ok || count > static_cast<uint64_t>(m_end - m_pos) / sizeof(T) || !take(count * sizeof(T)))
+            {
+                m_ok = false;
+                return values;
+            }
+            values.resize(count);
+            std::memcpy(values.data(), m_pos - count * sizeof(T), count * sizeof(T));
+            return values;
+        }
+        std::string get_string()
+        {
+            const uint64_t length = get<uint64_t>();
+            if (!m_ok || length > static_cast<uint64_t>(m_end - m_pos) || !take(length))
+            {
+                m_ok = false;
+                return std::string();
+            }
+            return std::string(m_pos - length, length);
+        }
+
+    private:
+        bool take(size_t bytes)
+        {
+            if (!m_ok || static_cast<size_t>(m_end - m_pos) < bytes)
+            {
+                m_ok = false;
+                return false;
+            }
+            m_pos += bytes;
+            return true;
+        }
+
+        const char *m_pos;
+        const char *m_end;
+        bool m_ok = true;
+    };
+
+    std::string sidecar_path(const std::string &path)
+    {
+        return path + ".vsecache";
+    }
+}
+
+struct CsvTable::Source
+{
+    std::string path;
+    std::filesystem::file_time_type modified;
+    uint64_t size;
+
+    int64_t modified_ticks() const { return static_cast<int64_t>(modified.time_since_epoch().count()); }
+    bool wants_sidecar() const { return size >= g_sidecar_threshold.load(); }
+};
+
+namespace
+{
+    struct CacheEntry
+    {
+        std::filesystem::file_time_type modified;
+        uint64_t size;
+        std::shared_ptr<const CsvTable> table;
+    };
+
+    struct Sidecar
+    {
+        std::vector<std::string> header;
+        size_t num_rows = 0;
+        std::map<std::string, std::shared_ptr<const CsvTable::Column>> columns;
+    };
+
+    bool read_sidecar(const std::string &path, uint64_t source_size, int64_t source_ticks, Sidecar &sidecar)
+    {
+        MappedFile file;
+        if (!file.open(sidecar_path(path)) || file.size() < sizeof(SIDECAR_MAGIC) || std::memcmp(file.data(), SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC)) != 0)
+            return false;
+        SidecarReader in(file.data() + sizeof(SIDECAR_MAGIC), file.size() - sizeof(SIDECAR_MAGIC));
+        if (in.get<uint32_t>() != BYTE_ORDER_PROBE || (in.get<uint32_t>(), in.get<uint64_t>()) != source_size || in.get<int64_t>() != source_ticks)
+            return false;
+        sidecar.num_rows = static_cast<size_t>(in.get<uint64_t>());
+        const uint64_t num_header = in.get<uint64_t>();
+        for (uint64_t i = 0; in.ok() && i < num_header; ++i)
+        {
+            sidecar.header.push_back(in.get_string());
+        }
+        const uint64_t num_columns = in.get<uint64_t>();
+        for (uint64_t i = 0; in.ok() && i < num_columns; ++i)
+        {
+            auto column = std::make_shared<CsvTable::Column>();
+            column->name = in.get_string();
+            column->values = in.get_array<double>();
+            for (uint64_t row : in.get_array<uint64_t>())
+            {
+                column->invalid_rows.push_back(static_cast<size_t>(row));
+            }
+            const uint64_t num_words = in.get<uint64_t>();
+            for (uint64_t w = 0; in.ok() && w < num_words; ++w)
+            {
+                column->dictionary.push_back(in.get_string());
+            }
+            column->codes = in.get_array<uint32_t>();
+            if (column->values.size() != sidecar.num_rows || (!column->codes.empty() && column->codes.size() != sidecar.num_rows))
+                return false;
+            sidecar.columns[column->name] = std::move(column);
+        }
+        return in.ok();
+    }
+
+    // Written to a temporary file and renamed, so that readers never see a partial sidecar.
+    // Failures, e.g. in read-only directories, only cost the cache.
+    void write_sidecar(const std::string &path, uint64_t source_size, int64_t source_ticks, const Sidecar &sidecar)
+    {
+        const std::string final_path = sidecar_path(path);
+        const std::string temp_path = final_path + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return;
+            SidecarWriter writer(out);
+            out.write(SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+            writer.put<uint32_t>(BYTE_ORDER_PROBE);
+            writer.put<uint32_t>(0);
+            writer.put<uint64_t>(source_size);
+            writer.put<int64_t>(source_ticks);
+            writer.put<uint64_t>(sidecar.num_rows);
+            writer.put<uint64_t>(sidecar.header.size());
+            for (const std::string &name : sidecar.header)
+            {
+                writer.put_string(name);
+            }
+            writer.put<uint64_t>(sidecar.columns.size());
+            for (const auto &entry : sidecar.columns)
+            {
+                const CsvTable::Column &column = *entry.second;
+                writer.put_string(column.name);
+                writer.put_array(column.values);
+                writer.put_array(std::vector<uint64_t>(column.invalid_rows.begin(), column.invalid_rows.end()));
+                writer.put<uint64_t>(column.dictionary.size());
+                for (const std::string &word : column.dictionary)
+                {
+                    writer.put_string(word);
+                }
+                writer.put_array(column.codes);
+            }
+            if (!out)
+            {
+                out.close();
+                std::remove(temp_path.c_str());
+                return;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temp_path, final_path, error);
+        if (error)
+            std::remove(temp_path.c_str());
+    }
+
+    void collect_csv_reads(const json &node, std::map<std::string, std::set<std::string>> &reads)
+    {
+        if (node.is_object())
+        {
+            const auto function_it = node.find("function");
+            const auto args_it = node.find("args");
+            if (function_it != node.end() && function_it->is_string() && args_it != node.end() && args_it->is_array() && args_it->size() >= 2 &&
+                (*function_it == "read_csv_vector" || *function_it == "read_csv_scalar"))
+            {
+                const json &path = (*args_it)[0];
+                const json &column = (*args_it)[1];
+                if (path.value("type", std::string()) == "string_literal" && column.value("type", std::string()) == "string_literal" &&
+                    path.contains("value") && path["value"].is_string() && column.contains("value") && column["value"].is_string())
+                {
+                    reads[path["value"].get<std::string>()].insert(column["value"].get<std::string>());
+                }
+            }
+            for (const auto &item : node.items())
+            {
+                collect_csv_reads(item.value(), reads);
+            }
+        }
+        else if (node.is_array())
+        {
+            for (const auto &item : node)
+            {
+                collect_csv_reads(item, reads);
+            }
+        }
+    }
+}
+
+bool CsvTable::Column::is_number(size_t row) const
+{
+    return !std::binary_search(invalid_rows.begin(), invalid_rows.end(), row);
+}
+
+std::shared_ptr<const CsvTable> CsvTable::load(const std::string &path)
+{
+    return load(path, {}, true);
+}
+
+std::shared_ptr<const CsvTable> CsvTable::load(const std::string &path, const std::vector<std::string> &columns)
+{
+    return load(path, columns, false);
+}
+
+std::shared_ptr<const CsvTable> CsvTable::load(const std::string &path, const std::vector<std::string> &columns, bool all_columns)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, CacheEntry> cache;
+
+    std::error_code error;
+    Source source{path, std::filesystem::last_write_time(path, error), 0};
+    if (!error)
+        source.size = static_cast<uint64_t>(std::filesystem::file_size(path, error));
+    if (error)
+    {
+        throw EngineException(EngineErrc::CsvFileNotFound, "Failed to read or parse CSV file '" + path + "'. Error: " + error.message());
+    }
+
+    // Loading happens under the lock, so concurrent first reads of a file parse it only once.
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const CsvTable> table;
+    // Keyed by absolute path: the same relative name names another file after a change of directory.
+    const std::string key = std::filesystem::absolute(path, error).string();
+    const auto it = cache.find(key);
+    if (it != cache.end() && it->second.modified == source.modified && it->second.size == source.size)
+    {
+        table = it->second.table;
+    }
+    if (table)
+    {
+        const std::vector<std::string> &wanted = all_columns ? table->m_header : columns;
+        if (std::all_of(wanted.begin(), wanted.end(), [&](const std::string &name)
+                        { return table->has_column(name) || std::find(table->m_header.begin(), table->m_header.end(), name) == table->m_header.end(); }))
+        {
+            return table;
+        }
+    }
+    table = extend(table, source, columns, all_columns);
+    cache[key] = CacheEntry{source.modified, source.size, table};
+    return table;
+}
+
+std::shared_ptr<const CsvTable> CsvTable::extend(const std::shared_ptr<const CsvTable> &table, const Source &source, const std::vector<std::string> &columns, bool all_columns)
+{
+    auto extended = std::make_shared<CsvTable>();
+    if (table)
+        *extended = *table;
+
+    Sidecar sidecar;
+    const bool has_sidecar = source.wants_sidecar() && read_sidecar(source.path, source.size, source.modified_ticks(), sidecar);
+    if (!table && has_sidecar)
+    {
+        extended->m_header = sidecar.header;
+        extended->m_num_rows = sidecar.num_rows;
+    }
+    const bool knows_header = table || has_sidecar;
+
+    // Columns still to materialise, taken from the sidecar where it has them.
+    std::vector<std::string> missing;
+    auto want = [&](const std::string &name)
+    {
+        if (extended->has_column(name) || std::find(missing.begin(), missing.end(), name) != missing.end())
+            return;
+        if (knows_header && std::find(extended->m_header.begin(), extended->m_header.end(), name) == extended->m_header.end())
+            return;
+        const auto cached = sidecar.columns.find(name);
+        if (has_sidecar && cached != sidecar.columns.end())
+            extended->m_columns[name] = cached->second;
+        else
+            missing.push_back(name);
+    };
+    for (const std::string &name : all_columns && knows_header ? extended->m_header : columns)
+    {
+        want(name);
+    }
+
+    if (!missing.empty() || !knows_header)
+    {
+        ParsedFile file;
+        try
+        {
+            MappedFile mapped;
+            if (!mapped.open(source.path))
+            {
+                throw std::runtime_error("Cannot open file " + source.path);
+            }
+            if (std::memchr(mapped.data(), '"', mapped.size()))
+            {
+                mapped = MappedFile();
+                if (all_columns && !knows_header)
+                    missing = csv::CSVReader(source.path).get_col_names();
+                parse_quoted(source.path, missing, file);
+            }
+            else
+            {
+                if (all_columns && !knows_header)
+                {
+                    // The header decides which columns there are.
+                    const char *pos = mapped.data();
+                    const char *end = pos + mapped.size();
+                    if (mapped.size() >= 3 && std::memcmp(pos, "\xEF\xBB\xBF", 3) == 0)
+                        pos += 3;
+                    while (pos < end && missing.empty())
+                    {
+                        const auto line = next_line(pos, end);
+                        if (line.first != line.second)
+                            missing = split_fields(line.first, line.second);
+                    }
+                }
+                parse_mapped(mapped.data(), mapped.size(), missing, file);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            throw EngineException(EngineErrc::CsvFileNotFound, "Failed to read or parse CSV file '" + source.path + "'. Error: " + e.what());
+        }
+        extended->m_header = file.header;
+        extended->m_num_rows = file.num_rows;
+        for (CsvTable::Column &column : file.columns)
+        {
+            if (std::find(file.header.begin(), file.header.end(), column.name) == file.header.end())
+                continue;
+            const std::string name = column.name;
+            extended->m_columns[name] = std::make_shared<const Column>(std::move(column));
+        }
+
+        if (source.wants_sidecar())
+        {
+            sidecar.header = extended->m_header;
+            sidecar.num_rows = extended->m_num_rows;
+            if (!has_sidecar)
+                sidecar.columns.clear();
+            for (const auto &entry : extended->m_columns)
+            {
+                sidecar.columns[entry.first] = entry.second;
+            }
+            write_sidecar(source.path, source.size, source.modified_ticks(), sidecar);
+        }
+    }
+    return extended;
+}
+
+void CsvTable::preload(const json &recipe)
+{
+    std::map<std::string, std::set<std::string>> reads;
+    collect_csv_reads(recipe, reads);
+    for (const auto &entry : reads)
+    {
+        try
+        {
+            load(entry.first, std::vector<std::string>(entry.second.begin(), entry.second.end()));
+        }
+        catch (const std::exception &)
+        {
+            // Reported by the read itself, with its line number.
+        }
+    }
+}
+
+void CsvTable::set_sidecar_threshold(uint64_t bytes)
+{
+    g_sidecar_threshold = bytes;
+}
+
+const CsvTable::Column *CsvTable::find_column(const std::string &name) const
+{
+    const auto it = m_columns.find(name);
+    return it == m_columns.end() ? nullptr : it->second.get();
+}
+
+bool CsvTable::has_column(const std::string &name) const
+{
+    return m_columns.count(name) != 0;
+}
@@ -1,103 +1,287 @@
 #include "include/engine/functions/series/operations.h"
 #include "include/engine/core/EngineException.h"
-#include <vector>
+#include "include/engine/core/TrialArena.h"
+#include <algorithm>
+#include <cmath>
 #include <numeric>
+#include <string>
+#include <vector>
 
 void register_series_functions(FunctionRegistry &registry)
 {
     registry.register_function("grow_series", []
-                               { return std::make_unique<GrowSeriesOperation>(); });
+                               { return std::make_unique<GrowSeriesOperation>(); }, FunctionPurity::Pure);
     registry.register_function("compound_series", []
-                               { return std::make_unique<CompoundSeriesOperation>(); });
+                               { return std::make_unique<CompoundSeriesOperation>(); }, FunctionPurity::Pure);
     registry.register_function("npv", []
-                               { return std::make_unique<NpvOperation>(); });
+                               { return std::make_unique<NpvOperation>(); }, FunctionPurity::Pure);
+    registry.register_function("irr", []
+                               { return std::make_unique<IrrOperation>(); }, FunctionPurity::Pure);
     registry.register_function("sum_series", []
-                               { return std::make_unique<SumSeriesOperation>(); });
+                               { return std::make_unique<SumSeriesOperation>(); }, FunctionPurity::Pure);
     registry.register_function("get_element", []
-                               { return std::make_unique<GetElementOperation>(); });
+                               { return std::make_unique<GetElementOperation>(); }, FunctionPurity::Pure);
     registry.register_function("delete_element", []
-                               { return std::make_unique<DeleteElementOperation>(); });
+                               { return std::make_unique<DeleteElementOperation>(); }, FunctionPurity::Pure);
     registry.register_function("series_delta", []
-                               { return std::make_unique<SeriesDeltaOperation>(); });
+                               { return std::make_unique<SeriesDeltaOperation>(); }, FunctionPurity::Pure);
     registry.register_function("compose_vector", []
-                               { return std::make_unique<ComposeVectorOperation>(); });
+                               { return std::make_unique<ComposeVectorOperation>(); }, FunctionPurity::Pure);
     registry.register_function("interpolate_series", []
-                               { return std::make_unique<InterpolateSeriesOperation>(); });
+                               { return std::make_unique<InterpolateSeriesOperation>(); }, FunctionPurity::Pure);
     registry.register_function("capitalize_expense", []
-                               { return std::make_unique<CapitalizeExpenseOperation>(); });
+                               { return std::make_unique<CapitalizeExpenseOperation>(); }, FunctionPurity::Pure);
 }
 
-inline std::vector<double> interpolate_series_simd(double start_value, double end_value, int num_steps)
+namespace
 {
-    if (num_steps < 1)
-        return {};
-    if (num_steps == 1)
-        return {end_value};
+    // The common length of the series among args[0, count), each of which must be a scalar or a
+    // series; 0 when all are scalars.
+    size_t instrument_count(ArgumentSpan args, size_t count, const char *function)
+    {
+        size_t instruments = 0;
+        for (size_t a = 0; a < count; ++a)
+        {
+            if (const auto *series = std::get_if<std::vector<double>>(args[a]))
+            {
+                if (series->empty())
+                    throw EngineException(EngineErrc::EmptyVectorOperation, "Per-instrument arguments of '" + std::string(function) + "' cannot be empty.");
+                if (instruments != 0 && series->size() != instruments)
+                    throw EngineException(EngineErrc::VectorSizeMismatch, "Per-instrument arguments of '" + std::string(function) + "' must all have the same length.");
+                instruments = series->size();
+            }
+            else if (!std::holds_alternative<double>(*args[a]))
+            {
+                throw EngineException(EngineErrc::MismatchedArgumentType, "Argument " + std::to_string(a + 1) + " of '" + std::string(function) + "' must be a scalar or a vector.");
+            }
+        }
+        return instruments;
+    }
 
-    std::vector<double> series(num_steps);
-    double total_diff = end_value - start_value;
-    double step = total_diff / (num_steps - 1);
-    for (int i = 0; i < num_steps; ++i)
+    // Periods of a portfolio matrix of `instruments` columns.
+    size_t period_count(const std::vector<double> &matrix, size_t instruments, const char *function)
     {
-        series[i] = start_value + i * step;
+        if (matrix.size() % instruments != 0)
+            throw EngineException(EngineErrc::VectorSizeMismatch, "The matrix passed to '" + std::string(function) + "' must hold " + std::to_string(instruments) + " values per period.");
+        return matrix.size() / instruments;
     }
-    return series;
-}
 
-inline std::vector<double> series_delta_simd(const std::vector<double> &series)
-{
-    if (series.size() < 2)
-        return {};
+    // 1 + rate for every instrument, taken from the thread's arena; the discount factors of npv
+    // must not be zero.
+    Span<double> growth_factors(Broadcast rates, size_t instruments, bool discounting)
+    {
+        const Span<double> factors = trial_arena().allocate<double>(instruments);
+        for (size_t j = 0; j < instruments; ++j)
+        {
+            factors[j] = 1.0 + rates[j];
+            if (discounting && factors[j] == 0.0)
+                throw EngineException(EngineErrc::InvalidSamplerParameters, "Discount rate cannot be -100% (-1.0).");
+        }
+        return factors;
+    }
 
-    std::vector<double> delta_series(series.size() - 1);
-    for (size_t i = 0; i < delta_series.size(); ++i)
+    // Internal rates of return of the columns of a periods x instruments matrix, solved for the
+    // discount factor d = 1 / (1 + rate), in which the NPV is the polynomial sum_p c_p d^p.
+    // Newton's method runs on every instrument at once, a row of the matrix at a time; the few
+    // columns it does not settle are bracketed and bisected one by one.
+    void solve_irr(const double *cashflows, size_t periods, size_t instruments, double *rates)
     {
-        delta_series[i] = series[i + 1] - series[i];
+        constexpr int MAX_NEWTON_STEPS = 50;
+        constexpr double TOLERANCE = 1e-13;
+
+        TrialArena &arena = trial_arena();
+        const TrialArena::Scope scope(arena);
+        const Span<double> d = arena.allocate<double>(instruments);
+        const Span<double> value = arena.allocate<double>(instruments);
+        const Span<double> slope = arena.allocate<double>(instruments);
+        const Span<unsigned char> pending = arena.allocate<unsigned char>(instruments);
+        std::fill(d.begin(), d.end(), 1.0 / 1.1);
+        std::fill(pending.begin(), pending.end(), 1);
+        size_t num_pending = instruments;
+        for (int step = 0; step < MAX_NEWTON_STEPS && num_pending > 0; ++step)
+        {
+            // Horner's rule from the last period, with the derivative alongside.
+            std::fill(value.begin(), value.end(), 0.0);
+            std::fill(slope.begin(), slope.end(), 0.0);
+            for (size_t p = periods; p-- > 0;)
+            {
+                const double *row = cashflows + p * instruments;
+                for (size_t j = 0; j < instruments; ++j)
+                {
+                    slope[j] = slope[j] * d[j] + value[j];
+                    value[j] = value[j] * d[j] + row[j];
+                }
+            }
+            for (size_t j = 0; j < instruments; ++j)
+            {
+                if (!pending[j])
+                    continue;
+                const double next = d[j] - value[j] / slope[j];
+                if (!std::isfinite(next))
+                {
+                    d[j] = -1.0; // Left to the bisection.
+                    pending[j] = 0;
+                    --num_pending;
+                    continue;
+                }
+                const bool converged = std::abs(next - d[j]) <= TOLERANCE * d[j];
+                // Newton may overshoot past d = 0, where the rate is -100%.
+                d[j] = next > 0.0 ? next : d[j] / 2.0;
+                if (converged)
+                {
+                    pending[j] = 0;
+                    --num_pending;
+                }
+            }
+        }
+
+        for (size_t j = 0; j < instruments; ++j)
+        {
+            if (d[j] > 0.0 && !pending[j])
+            {
+                rates[j] = 1.0 / d[j] - 1.0;
+                continue;
+            }
+            const auto npv_at = [&](double factor)
+            {
+                double npv = 0.0;
+                for (size_t p = periods; p-- > 0;)
+                    npv = npv * factor + cashflows[p * instruments + j];
+                return npv;
+            };
+            // Scan discount factors from 2^30 down to 2^-30, rates from just above -100% to 1e9, for a sign change.
+            double low = std::ldexp(1.0, 30), high = low, npv_low = npv_at(low);
+            bool bracketed = false;
+            for (int e = 29; e >= -30 && !bracketed; --e)
+            {
+                high = low;
+                low = std::ldexp(1.0, e);
+                const double npv_high = npv_low;
+                npv_low = npv_at(low);
+                bracketed = (npv_low < 0.0) != (npv_high < 0.0) && npv_low != 0.0 && npv_high != 0.0;
+            }
+            if (!bracketed)
+                throw EngineException(EngineErrc::InvalidSamplerParameters, "The cash flows passed to 'irr' have no internal rate of return.");
+            for (int i = 0; i < 200 && high - low > TOLERANCE * low; ++i)
+            {
+                const double mid = 0.5 * (low + high);
+                const double npv_mid = npv_at(mid);
+                if ((npv_mid < 0.0) == (npv_low < 0.0))
+                {
+                    low = mid;
+                    npv_low = npv_mid;
+                }
+                else
+                {
+                    high = mid;
+                }
+            }
+            rates[j] = 2.0 / (low + high) - 1.0;
+        }
     }
-    return delta_series;
 }
 
-std::vector<TrialValue> GrowSeriesOperation::execute(const std::vector<TrialValue> &args) const
+void GrowSeriesOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 3)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'grow_series' requires 3 arguments.");
-    double base_val = std::get<double>(args[0]);
-    double growth_rate = std::get<double>(args[1]);
-    int num_years = static_cast<int>(std::get<double>(args[2]));
-    std::vector<double> series;
-    if (num_years < 1)
-        return {series};
-    series.reserve(num_years);
-    double current_val = base_val;
-    double growth_factor = 1.0 + growth_rate;
-    for (int i = 0; i < num_years; ++i)
+    int num_years = static_cast<int>(std::get<double>(*args[2]));
+    const size_t periods = num_years < 1 ? 0 : static_cast<size_t>(num_years);
+    const size_t instruments = instrument_count(args, 2, "grow_series");
+    if (instruments == 0)
     {
-        current_val *= growth_factor;
-        series.push_back(current_val);
+        double base_val = std::get<double>(*args[0]);
+        double growth_rate = std::get<double>(*args[1]);
+        auto &series = assign_series(*results[0], periods);
+        double current_val = base_val;
+        double growth_factor = 1.0 + growth_rate;
+        for (double &value : series)
+        {
+            current_val *= growth_factor;
+            value = current_val;
+        }
+        return;
+    }
+
+    const Broadcast base = broadcast_series(*args[0]);
+    const TrialArena::Scope scope(trial_arena());
+    const Span<double> factors = growth_factors(broadcast_series(*args[1]), instruments, false);
+    auto &matrix = assign_series(*results[0], periods * instruments);
+    if (periods == 0)
+        return;
+    for (size_t j = 0; j < instruments; ++j)
+    {
+        matrix[j] = base[j] * factors[j];
+    }
+    for (size_t p = 1; p < periods; ++p)
+    {
+        const double *previous = matrix.data() + (p - 1) * instruments;
+        double *row = matrix.data() + p * instruments;
+        for (size_t j = 0; j < instruments; ++j)
+        {
+            row[j] = previous[j] * factors[j];
+        }
     }
-    return {series};
 }
-std::vector<TrialValue> CompoundSeriesOperation::execute(const std::vector<TrialValue> &args) const
+void CompoundSeriesOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'compound_series' requires 2 arguments.");
-    double base_val = std::get<double>(args[0]);
-    const auto &growth_rates = std::get<std::vector<double>>(args[1]);
-    std::vector<double> series(growth_rates.size());
+    const auto &growth_rates = std::get<std::vector<double>>(*args[1]);
+    if (const auto *bases = std::get_if<std::vector<double>>(args[0]))
+    {
+        const size_t instruments = instrument_count(args, 1, "compound_series");
+        const size_t periods = period_count(growth_rates, instruments, "compound_series");
+        auto &matrix = assign_series(*results[0], growth_rates.size());
+        const double *previous = bases->data();
+        for (size_t p = 0; p < periods; ++p)
+        {
+            const double *rates = growth_rates.data() + p * instruments;
+            double *row = matrix.data() + p * instruments;
+            for (size_t j = 0; j < instruments; ++j)
+            {
+                row[j] = previous[j] * (1.0 + rates[j]);
+            }
+            previous = row;
+        }
+        return;
+    }
+    double base_val = std::get<double>(*args[0]);
+    auto &series = assign_series(*results[0], growth_rates.size());
     double current_val = base_val;
     for (size_t i = 0; i < growth_rates.size(); ++i)
     {
         current_val *= (1.0 + growth_rates[i]);
         series[i] = current_val;
     }
-    return {series};
 }
-std::vector<TrialValue> NpvOperation::execute(const std::vector<TrialValue> &args) const
+void NpvOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'npv' requires 2 arguments.");
-    double rate = std::get<double>(args[0]);
-    const auto &cashflows = std::get<std::vector<double>>(args[1]);
+    const auto &cashflows = std::get<std::vector<double>>(*args[1]);
+    if (std::holds_alternative<std::vector<double>>(*args[0]))
+    {
+        const size_t instruments = instrument_count(args, 1, "npv");
+        const size_t periods = period_count(cashflows, instruments, "npv");
+        const TrialArena::Scope scope(trial_arena());
+        const Span<double> factors = growth_factors(broadcast_series(*args[0]), instruments, true);
+        const Span<double> discount_factors = trial_arena().allocate<double>(instruments);
+        std::copy(factors.begin(), factors.end(), discount_factors.begin());
+        auto &npvs = assign_series(*results[0], instruments);
+        std::fill(npvs.begin(), npvs.end(), 0.0);
+        for (size_t p = 0; p < periods; ++p)
+        {
+            const double *row = cashflows.data() + p * instruments;
+            for (size_t j = 0; j < instruments; ++j)
+            {
+                npvs[j] += row[j] / discount_factors[j];
+                discount_factors[j] *= factors[j];
+            }
+        }
+        return;
+    }
+    double rate = std::get<double>(*args[0]);
     double npv = 0.0;
     double discount_factor = 1.0 + rate;
     if (discount_factor == 0.0)
@@ -107,35 +291,57 @@ std::vector<TrialValue> NpvOperation::execute(const std::vector<TrialValue> &arg
         npv += cashflow / discount_factor;
         discount_factor *= (1.0 + rate);
     }
-    return {npv};
+    *results[0] = npv;
 }
-std::vector<TrialValue> SumSeriesOperation::execute(const std::vector<TrialValue> &args) const
+void IrrOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    if (args.size() != 1 && args.size() != 2)
+        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'irr' requires 1 or 2 arguments.");
+    const auto &cashflows = std::get<std::vector<double>>(*args[0]);
+    if (cashflows.empty())
+        throw EngineException(EngineErrc::EmptyVectorOperation, "Cannot compute the internal rate of return of an empty series.");
+    if (args.size() == 1)
+    {
+        double rate;
+        solve_irr(cashflows.data(), cashflows.size(), 1, &rate);
+        *results[0] = rate;
+        return;
+    }
+    const double count = std::get<double>(*args[1]);
+    if (!(count >= 1.0) || count != std::floor(count))
+        throw EngineException(EngineErrc::InvalidSamplerParameters, "The instrument count of 'irr' must be a positive integer.");
+    const size_t instruments = static_cast<size_t>(count);
+    const size_t periods = period_count(cashflows, instruments, "irr");
+    auto &rates = assign_series(*results[0], instruments);
+    solve_irr(cashflows.data(), periods, instruments, rates.data());
+}
+void SumSeriesOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'sum_series' requires 1 argument.");
-    const auto &series = std::get<std::vector<double>>(args[0]);
-    return {std::reduce(series.begin(), series.end(), 0.0)};
+    const auto &series = std::get<std::vector<double>>(*args[0]);
+    *results[0] = std::reduce(series.begin(), series.end(), 0.0);
 }
-std::vector<TrialValue> GetElementOperation::execute(const std::vector<TrialValue> &args) const
+void GetElementOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'get_element' requires 2 arguments.");
-    const auto &series = std::get<std::vector<double>>(args[0]);
-    int index = static_cast<int>(std::get<double>(args[1]));
+    const auto &series = std::get<std::vector<double>>(*args[0]);
+    int index = static_cast<int>(std::get<double>(*args[1]));
     if (series.empty())
         throw EngineException(EngineErrc::EmptyVectorOperation, "Cannot get element from empty series.");
     if (index < 0)
         index = static_cast<int>(series.size()) + index;
     if (index < 0 || static_cast<size_t>(index) >= series.size())
         throw EngineException(EngineErrc::IndexOutOfBounds, "Index out of bounds.");
-    return {series[static_cast<size_t>(index)]};
+    *results[0] = series[static_cast<size_t>(index)];
 }
-std::vector<TrialValue> DeleteElementOperation::execute(const std::vector<TrialValue> &args) const
+void DeleteElementOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'delete_element' requires 2 arguments.");
-    const auto &input_vector = std::get<std::vector<double>>(args[0]);
-    int index_to_delete = static_cast<int>(std::get<double>(args[1]));
+    const auto &input_vector = std::get<std::vector<double>>(*args[0]);
+    int index_to_delete = static_cast<int>(std::get<double>(*args[1]));
     if (input_vector.empty())
         throw EngineException(EngineErrc::EmptyVectorOperation, "Cannot delete element from an empty vector.");
     if (index_to_delete < 0)
@@ -144,67 +350,74 @@ std::vector<TrialValue> DeleteElementOperation::execute(const std::vector<TrialV
     }
     if (index_to_delete < 0 || static_cast<size_t>(index_to_delete) >= input_vector.size())
         throw EngineException(EngineErrc::IndexOutOfBounds, "Index out of bounds for delete_element operation.");
-    std::vector<double> result_vector;
-    result_vector.reserve(input_vector.size() - 1);
-    for (size_t i = 0; i < input_vector.size(); ++i)
-    {
-        if (static_cast<int>(i) != index_to_delete)
-        {
-            result_vector.push_back(input_vector[i]);
-        }
-    }
-    return {result_vector};
+    auto &result_vector = assign_series(*results[0], input_vector.size() - 1);
+    const auto split = input_vector.begin() + index_to_delete;
+    std::copy(input_vector.begin(), split, result_vector.begin());
+    std::copy(split + 1, input_vector.end(), result_vector.begin() + index_to_delete);
 }
-std::vector<TrialValue> SeriesDeltaOperation::execute(const std::vector<TrialValue> &args) const
+void SeriesDeltaOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'series_delta' requires 1 argument.");
-    const auto &series = std::get<std::vector<double>>(args[0]);
-    return {series_delta_simd(series)};
+    const auto &series = std::get<std::vector<double>>(*args[0]);
+    auto &delta_series = assign_series(*results[0], series.size() < 2 ? 0 : series.size() - 1);
+    for (size_t i = 0; i < delta_series.size(); ++i)
+    {
+        delta_series[i] = series[i + 1] - series[i];
+    }
 }
-std::vector<TrialValue> ComposeVectorOperation::execute(const std::vector<TrialValue> &args) const
+void ComposeVectorOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
-    std::vector<double> composed_vector;
+    size_t total_size = 0;
+    for (const TrialValue *arg : args)
+    {
+        if (std::holds_alternative<double>(*arg))
+            total_size += 1;
+        else if (const auto *series = std::get_if<std::vector<double>>(arg))
+            total_size += series->size();
+        else
+            throw EngineException(EngineErrc::MismatchedArgumentType, "Function 'compose_vector' can only accept scalars and vectors.");
+    }
 
-    for (const auto &arg_variant : args)
+    auto &composed_vector = assign_series(*results[0], total_size);
+    auto out = composed_vector.begin();
+    for (const TrialValue *arg : args)
     {
-        std::visit(
-            [&composed_vector](auto &&arg)
-            {
-                using T = std::decay_t<decltype(arg)>;
-                if constexpr (std::is_same_v<T, double>)
-                {
-                    composed_vector.push_back(arg);
-                }
-                else if constexpr (std::is_same_v<T, std::vector<double>>)
-                {
-                    composed_vector.insert(composed_vector.end(), arg.begin(), arg.end());
-                }
-                else
-                {
-                    throw EngineException(EngineErrc::MismatchedArgumentType, "Function 'compose_vector' can only accept scalars and vectors.");
-                }
-            },
-            arg_variant);
+        if (const double *scalar = std::get_if<double>(arg))
+            *out++ = *scalar;
+        else
+        {
+            const auto &series = std::get<std::vector<double>>(*arg);
+            out = std::copy(series.begin(), series.end(), out);
+        }
     }
-    return {composed_vector};
 }
-std::vector<TrialValue> InterpolateSeriesOperation::execute(const std::vector<TrialValue> &args) const
+void InterpolateSeriesOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 3)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'interpolate_series' requires 3 arguments.");
-    double start_value = std::get<double>(args[0]);
-    double end_value = std::get<double>(args[1]);
-    int num_years = static_cast<int>(std::get<double>(args[2]));
-    return {interpolate_series_simd(start_value, end_value, num_years)};
+    double start_value = std::get<double>(*args[0]);
+    double end_value = std::get<double>(*args[1]);
+    int num_steps = static_cast<int>(std::get<double>(*args[2]));
+    auto &series = assign_series(*results[0], num_steps < 1 ? 0 : static_cast<size_t>(num_steps));
+    if (num_steps == 1)
+    {
+        series[0] = end_value;
+        return;
+    }
+    double step = (end_value - start_value) / (num_steps - 1);
+    for (int i = 0; i < num_steps; ++i)
+    {
+        series[i] = start_value + i * step;
+    }
 }
-std::vector<TrialValue> CapitalizeExpenseOperation::execute(const std::vector<TrialValue> &args) const
+void CapitalizeExpenseOperation::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 3)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'capitalize_expense' requires 3 arguments.");
-    double current_expense = std::get<double>(args[0]);
-    const auto &past_expenses = std::get<std::vector<double>>(args[1]);
-    int period = static_cast<int>(std::get<double>(args[2]));
+    double current_expense = std::get<double>(*args[0]);
+    const auto &past_expenses = std::get<std::vector<double>>(*args[1]);
+    int period = static_cast<int>(std::get<double>(*args[2]));
     if (period <= 0)
         throw EngineException(EngineErrc::InvalidSamplerParameters, "Amortization period must be positive.");
     double research_asset = 0.0;
@@ -226,7 +439,6 @@ std::vector<TrialValue> CapitalizeExpenseOperation::execute(const std::vector<Tr
             amortization_this_year += past_expenses[i] / period;
         }
     }
-    return {
-        TrialValue(research_asset),
-        TrialValue(amortization_this_year)};
+    *results[0] = research_asset;
+    *results[1] = amortization_this_year;
 }
\ No newline at end of file
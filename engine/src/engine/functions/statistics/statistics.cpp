@@ -1,7 +1,10 @@
 #include "include/engine/functions/statistics/samplers.h"
+#include "include/engine/core/DeviceProgram.h"
 #include "include/engine/core/EngineException.h"
-#include <random>
+#include "include/engine/core/SamplingDesign.h"
+#include <algorithm>
 #include <stdexcept>
+#include <string>
 #include <cmath>
 
 void register_statistics_functions(FunctionRegistry &registry)
@@ -20,128 +23,798 @@ void register_statistics_functions(FunctionRegistry &registry)
                                { return std::make_unique<PertSampler>(); });
     registry.register_function("Triangular", []
                                { return std::make_unique<TriangularSampler>(); });
+    registry.register_function("MultivariateNormal", []
+                               { return std::make_unique<MultivariateNormalSampler>(); });
+    registry.register_function("gbm_path", []
+                               { return std::make_unique<GbmPathSampler>(); });
+    registry.register_function("ou_path", []
+                               { return std::make_unique<OuPathSampler>(); });
+    registry.register_function("jump_diffusion_path", []
+                               { return std::make_unique<JumpDiffusionPathSampler>(); });
 }
 
-inline std::mt19937 &get_thread_local_generator()
+// --- Bulk sampling ---
+//
+// Lanes are processed in tiles: the per-lane random streams are drawn first into small arrays,
+// then the transforms run as plain loops over those arrays, which the compiler can vectorise.
+namespace
 {
-    static thread_local std::mt19937 generator(std::random_device{}());
-    return generator;
+    constexpr size_t TILE = 64;
+
+    inline double draw_normal(RandomStream &stream)
+    {
+        const double u1 = stream.uniform();
+        const double u2 = stream.uniform();
+        return box_muller(u1, u2);
+    }
+
+    template <typename Body>
+    void for_each_tile(size_t lanes, Body body)
+    {
+        for (size_t first = 0; first < lanes; first += TILE)
+        {
+            body(first, std::min(TILE, lanes - first));
+        }
+    }
+
+    // Remaining Marsaglia–Tsang attempts of one lane after its first proposal was rejected.
+    double gamma_retry(RandomStream &stream, double d, double c)
+    {
+        for (;;)
+        {
+            const double z = draw_normal(stream);
+            const double u = stream.uniform();
+            const double x = 1.0 + c * z;
+            if (x <= 0.0)
+                continue;
+            const double v = x * x * x;
+            if (std::log(u) < 0.5 * z * z + d - d * v + d * std::log(v))
+                return d * v;
+        }
+    }
+
+    // Gamma(shape, 1) draws for up to TILE lanes with Marsaglia–Tsang. Every lane makes its first
+    // proposal together with the others; the few rejected lanes retry on their own. Shapes below
+    // one sample Gamma(shape + 1) and are scaled by U^(1 / shape).
+    void fill_gamma(RandomStream *streams, const double *shape, double *out, size_t count)
+    {
+        double d[TILE], c[TILE], z[TILE], u[TILE];
+        for (size_t i = 0; i < count; ++i)
+        {
+            d[i] = (shape[i] < 1.0 ? shape[i] + 1.0 : shape[i]) - 1.0 / 3.0;
+            c[i] = 1.0 / std::sqrt(9.0 * d[i]);
+            z[i] = draw_normal(streams[i]);
+            u[i] = streams[i].uniform();
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double x = 1.0 + c[i] * z[i];
+            const double v = x * x * x;
+            const bool accepted = x > 0.0 && std::log(u[i]) < 0.5 * z[i] * z[i] + d[i] - d[i] * v + d[i] * std::log(v);
+            out[i] = accepted ? d[i] * v : gamma_retry(streams[i], d[i], c[i]);
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (shape[i] < 1.0)
+            {
+                out[i] *= std::pow(streams[i].uniform(), 1.0 / shape[i]);
+            }
+        }
+    }
+
+    // Beta(alpha, beta) as G1 / (G1 + G2), both gammas drawn from each lane's stream.
+    void fill_beta(RandomStream *streams, const double *alpha, const double *beta, double *out, size_t count)
+    {
+        double g1[TILE], g2[TILE];
+        fill_gamma(streams, alpha, g1, count);
+        fill_gamma(streams, beta, g2, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = (g1[i] + g2[i] == 0.0) ? 0.0 : g1[i] / (g1[i] + g2[i]);
+        }
+    }
+
+    // --- Inverse transforms, for runs that draw from a UniformDesign ---
+
+    // Continued fraction of the regularized incomplete beta function (modified Lentz).
+    double incomplete_beta_fraction(double a, double b, double x)
+    {
+        constexpr double TINY = 1e-300;
+        const double qab = a + b, qap = a + 1.0, qam = a - 1.0;
+        double c = 1.0;
+        double d = 1.0 - qab * x / qap;
+        d = 1.0 / (std::abs(d) < TINY ? TINY : d);
+        double h = d;
+        for (int m = 1; m <= 300; ++m)
+        {
+            const double m2 = 2.0 * m;
+            for (const double aa : {m * (b - m) * x / ((qam + m2) * (a + m2)), -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))})
+            {
+                d = 1.0 + aa * d;
+                d = 1.0 / (std::abs(d) < TINY ? TINY : d);
+                c = 1.0 + aa / c;
+                c = std::abs(c) < TINY ? TINY : c;
+                h *= d * c;
+            }
+            if (std::abs(d * c - 1.0) < 1e-15)
+                break;
+        }
+        return h;
+    }
+
+    // I_x(a, b), given log B(a, b).
+    double incomplete_beta(double a, double b, double x, double log_beta)
+    {
+        if (x <= 0.0)
+            return 0.0;
+        if (x >= 1.0)
+            return 1.0;
+        const double front = std::exp(a * std::log(x) + b * std::log1p(-x) - log_beta);
+        return x < (a + 1.0) / (a + b + 2.0) ? front * incomplete_beta_fraction(a, b, x) / a
+                                             : 1.0 - front * incomplete_beta_fraction(b, a, 1.0 - x) / b;
+    }
+
+    // Newton's method on I_x(a, b) = p, falling back to bisection when a step leaves the bracket.
+    double inverse_beta_cdf(double p, double a, double b)
+    {
+        const double log_beta = std::lgamma(a) + std::lgamma(b) - std::lgamma(a + b);
+        double low = 0.0, high = 1.0;
+        double x = a / (a + b);
+        for (int iteration = 0; iteration < 100; ++iteration)
+        {
+            const double error = incomplete_beta(a, b, x, log_beta) - p;
+            (error < 0.0 ? low : high) = x;
+            const double density = std::exp((a - 1.0) * std::log(x) + (b - 1.0) * std::log1p(-x) - log_beta);
+            double next = density > 0.0 ? x - error / density : 0.5 * (low + high);
+            if (!(next > low && next < high))
+                next = 0.5 * (low + high);
+            if (std::abs(next - x) < 1e-14 * std::max(x, 1e-300))
+                return next;
+            x = next;
+        }
+        return x;
+    }
+
+    // Uniforms of the lanes from the active design; false when samplers use their streams.
+    bool fill_design_uniforms(const Sampler &sampler, size_t first, size_t count, double *u)
+    {
+        const UniformDesign *design = active_uniform_design();
+        if (!design || !design->covers(sampler.call_site()))
+            return false;
+        const TrialRandomState &state = thread_random_state();
+        for (size_t i = 0; i < count; ++i)
+        {
+            u[i] = design->uniform(lane_trial(state, first + i), sampler.call_site());
+        }
+        return true;
+    }
+
+    void open_streams(const Sampler &sampler, size_t first, size_t count, RandomStream *streams)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            streams[i] = random_stream(sampler.call_site(), first + i);
+        }
+    }
+
+    // One uniform per lane from that lane's stream.
+    void fill_uniforms(const Sampler &sampler, size_t first, size_t count, double *u)
+    {
+        if (fill_design_uniforms(sampler, first, count, u))
+            return;
+        for (size_t i = 0; i < count; ++i)
+        {
+            u[i] = random_stream(sampler.call_site(), first + i).uniform();
+        }
+    }
+
+    void fill_normals(const Sampler &sampler, size_t first, size_t count, double *z)
+    {
+        double u1[TILE], u2[TILE];
+        if (fill_design_uniforms(sampler, first, count, u1))
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                z[i] = inverse_normal_cdf(u1[i]);
+            }
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            RandomStream stream = random_stream(sampler.call_site(), first + i);
+            u1[i] = stream.uniform();
+            u2[i] = stream.uniform();
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            z[i] = box_muller(u1[i], u2[i]);
+        }
+    }
+
+    void check_beta(double alpha, double beta)
+    {
+        if (alpha <= 0 || beta <= 0)
+            throw EngineException(EngineErrc::InvalidSamplerParameters, "Beta distribution parameters must be positive.");
+    }
+
+    void check_pert(double min, double mostLikely, double max)
+    {
+        if (min > mostLikely || mostLikely > max || min == max)
+        {
+            throw EngineException(EngineErrc::InvalidSamplerParameters, "Invalid PERT parameters: must be min <= mostLikely <= max and min != max.");
+        }
+    }
+
+    void check_triangular(double min, double mostLikely, double max)
+    {
+        if (min > mostLikely || mostLikely > max)
+        {
+            throw EngineException(EngineErrc::InvalidSamplerParameters, "Invalid Triangular parameters: must be min <= mostLikely <= max.");
+        }
+    }
+
+    struct CorrelationFactor
+    {
+        std::vector<double> matrix;
+        std::vector<double> lower;
+    };
+
+    // Cholesky factor of a MultivariateNormal correlation matrix, recomputed only when the
+    // matrix of the call site changes.
+    const double *correlation_factor(uint32_t site, const std::vector<double> &matrix, size_t n)
+    {
+        static thread_local std::vector<CorrelationFactor> cache;
+        if (cache.size() <= site)
+            cache.resize(site + 1);
+        CorrelationFactor &entry = cache[site];
+        if (entry.matrix == matrix)
+            return entry.lower.data();
+
+        entry.matrix.clear();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (matrix[i * n + i] != 1.0)
+                throw EngineException(EngineErrc::InvalidSamplerParameters, "MultivariateNormal correlation matrix must have ones on its diagonal.");
+            for (size_t j = 0; j < i; ++j)
+            {
+                if (matrix[i * n + j] != matrix[j * n + i])
+                    throw EngineException(EngineErrc::InvalidSamplerParameters, "MultivariateNormal correlation matrix must be symmetric.");
+            }
+        }
+        entry.lower.resize(n * n);
+        if (!cholesky_factor(matrix.data(), n, entry.lower.data()))
+            throw EngineException(EngineErrc::InvalidSamplerParameters, "MultivariateNormal correlation matrix must be positive definite.");
+        entry.matrix = matrix;
+        return entry.lower.data();
+    }
+
+    // Side of the square matrix held by `series`, or 0 when it is not square.
+    size_t matrix_size(const std::vector<double> &series)
+    {
+        const size_t n = static_cast<size_t>(std::llround(std::sqrt(static_cast<double>(series.size()))));
+        return n * n == series.size() ? n : 0;
+    }
+
+    bool is_broadcast_of(const TrialValue &value, size_t n)
+    {
+        if (const auto *series = std::get_if<std::vector<double>>(&value))
+            return series->size() == n;
+        return std::holds_alternative<double>(value);
+    }
+
+    // The draws of a path sampler's call. Under antithetic variates, the second trial of each
+    // pair reads the stream of the first and mirrors every draw.
+    class PathDraws
+    {
+    public:
+        explicit PathDraws(const Sampler &sampler)
+        {
+            const TrialRandomState &state = thread_random_state();
+            const UniformDesign *design = active_uniform_design();
+            const uint64_t trial = lane_trial(state, 0);
+            m_mirrored = design && design->mirrors_pairs() && (trial & 1);
+            m_stream = m_mirrored ? RandomStream(state.seed, trial - 1, sampler.call_site()) : random_stream(sampler.call_site());
+        }
+
+        // Fills `z` with n standard normal scores, the same values as n calls of normal(): a
+        // tile of uniforms is drawn first, then transformed as a whole.
+        void normals(double *z, size_t n)
+        {
+            const double sign = m_mirrored ? -1.0 : 1.0;
+            for_each_tile(n, [&](size_t first, size_t count)
+                          {
+                double u1[TILE], u2[TILE];
+                for (size_t i = 0; i < count; ++i)
+                {
+                    u1[i] = m_stream.uniform();
+                    u2[i] = m_stream.uniform();
+                }
+                for (size_t i = 0; i < count; ++i)
+                {
+                    z[first + i] = sign * box_muller(u1[i], u2[i]);
+                } });
+        }
+
+        double normal()
+        {
+            const double z = draw_normal(m_stream);
+            return m_mirrored ? -z : z;
+        }
+
+        double uniform()
+        {
+            const double u = m_stream.uniform();
+            return m_mirrored ? 1.0 - u : u;
+        }
+
+    private:
+        RandomStream m_stream;
+        bool m_mirrored = false;
+    };
+
+    struct PathShape
+    {
+        size_t periods;
+        double dt;
+    };
+
+    // Checks the arity of the path sampler `name`, whose `periods` argument at `periods_index` is
+    // followed by the optional `dt`, and reads both. Periods are truncated as by grow_series.
+    PathShape path_shape(ArgumentSpan args, size_t periods_index, const char *name, const char *params)
+    {
+        if (args.size() != periods_index + 1 && args.size() != periods_index + 2)
+        {
+            throw EngineException(EngineErrc::IncorrectArgumentCount, "Function '" + std::string(name) + "' requires " + std::to_string(periods_index + 1) + " or " +
+                                                                          std::to_string(periods_index + 2) + " arguments: " + params + ".");
+        }
+        const int num_periods = static_cast<int>(std::get<double>(*args[periods_index]));
+        const double dt = args.size() > periods_index + 1 ? std::get<double>(*args[periods_index + 1]) : 1.0;
+        if (!(dt > 0.0))
+            throw EngineException(EngineErrc::InvalidSamplerParameters, "Function '" + std::string(name) + "' requires a positive time step dt.");
+        return {num_periods < 1 ? 0 : static_cast<size_t>(num_periods), dt};
+    }
+
+    void check_non_negative(double value, const char *what)
+    {
+        if (!(value >= 0.0))
+            throw EngineException(EngineErrc::InvalidSamplerParameters, std::string(what) + " must be non-negative.");
+    }
+
+    // Turns the scores in `path` into the log increments drift_dt + vol_sqrt_dt * z.
+    void log_increments(double *path, size_t periods, double drift_dt, double vol_sqrt_dt)
+    {
+        for (size_t t = 0; t < periods; ++t)
+        {
+            path[t] = drift_dt + vol_sqrt_dt * path[t];
+        }
+    }
+
+    // Turns the log increments in `path` into the levels start * exp(running sum of the increments).
+    void exponentiate_path(double *path, size_t periods, double start)
+    {
+        double log_level = 0.0;
+        for (size_t t = 0; t < periods; ++t)
+        {
+            log_level += path[t];
+            path[t] = log_level;
+        }
+        for (size_t t = 0; t < periods; ++t)
+        {
+            path[t] = start * std::exp(path[t]);
+        }
+    }
 }
 
-std::vector<TrialValue> NormalSampler::execute(const std::vector<TrialValue> &args) const
+double Sampler::draw(ArgumentSpan args) const
+{
+    LaneArgument params[3]{};
+    for (size_t k = 0; k < args.size(); ++k)
+    {
+        params[k] = LaneArgument{&std::get<double>(*args[k]), 0};
+    }
+    double value = 0.0;
+    fill(&value, 1, params);
+    return value;
+}
+
+bool NormalSampler::supports_lanes(size_t num_args) const { return num_args == 2; }
+void NormalSampler::fill(double *out, size_t lanes, const LaneArgument *params) const
+{
+    for_each_tile(lanes, [&](size_t first, size_t count)
+                  {
+        double z[TILE];
+        fill_normals(*this, first, count, z);
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[first + i] = params[0][first + i] + params[1][first + i] * z[i];
+        } });
+}
+
+bool NormalSampler::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const
+{
+    lowering.emit(DeviceOp::Normal, args, num_args, result, call_site());
+    return true;
+}
+
+void NormalSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Normal' requires 2 arguments: mean, stddev.");
-    double mean = std::get<double>(args[0]);
-    double stddev = std::get<double>(args[1]);
-    std::normal_distribution<> dist(mean, stddev);
-    return {dist(get_thread_local_generator())};
+    *results[0] = draw(args);
+}
+
+bool UniformSampler::supports_lanes(size_t num_args) const { return num_args == 2; }
+void UniformSampler::fill(double *out, size_t lanes, const LaneArgument *params) const
+{
+    for_each_tile(lanes, [&](size_t first, size_t count)
+                  {
+        double u[TILE];
+        fill_uniforms(*this, first, count, u);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double min = params[0][first + i];
+            out[first + i] = min + (params[1][first + i] - min) * u[i];
+        } });
+}
+
+bool UniformSampler::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const
+{
+    lowering.emit(DeviceOp::Uniform, args, num_args, result, call_site());
+    return true;
 }
 
-std::vector<TrialValue> UniformSampler::execute(const std::vector<TrialValue> &args) const
+void UniformSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Uniform' requires 2 arguments: min, max.");
-    double min = std::get<double>(args[0]);
-    double max = std::get<double>(args[1]);
-    std::uniform_real_distribution<> dist(min, max);
-    return {dist(get_thread_local_generator())};
+    *results[0] = draw(args);
+}
+
+bool BernoulliSampler::supports_lanes(size_t num_args) const { return num_args == 1; }
+void BernoulliSampler::fill(double *out, size_t lanes, const LaneArgument *params) const
+{
+    for_each_tile(lanes, [&](size_t first, size_t count)
+                  {
+        double u[TILE];
+        fill_uniforms(*this, first, count, u);
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[first + i] = u[i] < params[0][first + i] ? 1.0 : 0.0;
+        } });
 }
 
-std::vector<TrialValue> BernoulliSampler::execute(const std::vector<TrialValue> &args) const
+bool BernoulliSampler::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const
+{
+    lowering.emit(DeviceOp::Bernoulli, args, num_args, result, call_site());
+    return true;
+}
+
+void BernoulliSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 1)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Bernoulli' requires 1 argument: p.");
-    double p = std::get<double>(args[0]);
-    std::bernoulli_distribution dist(p);
-    return {static_cast<double>(dist(get_thread_local_generator()))};
+    *results[0] = draw(args);
+}
+
+bool LognormalSampler::supports_lanes(size_t num_args) const { return num_args == 2; }
+void LognormalSampler::fill(double *out, size_t lanes, const LaneArgument *params) const
+{
+    for_each_tile(lanes, [&](size_t first, size_t count)
+                  {
+        double z[TILE];
+        fill_normals(*this, first, count, z);
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[first + i] = std::exp(params[0][first + i] + params[1][first + i] * z[i]);
+        } });
 }
 
-std::vector<TrialValue> LognormalSampler::execute(const std::vector<TrialValue> &args) const
+bool LognormalSampler::lower_to_device(DeviceLowering &lowering, const uint32_t *args, size_t num_args, uint32_t result) const
+{
+    lowering.emit(DeviceOp::Lognormal, args, num_args, result, call_site());
+    return true;
+}
+
+void LognormalSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Lognormal' requires 2 arguments: log_mean, log_stddev.");
-    double log_mean = std::get<double>(args[0]);
-    double log_stddev = std::get<double>(args[1]);
-    std::lognormal_distribution<> dist(log_mean, log_stddev);
-    return {dist(get_thread_local_generator())};
+    *results[0] = draw(args);
 }
 
-std::vector<TrialValue> BetaSampler::execute(const std::vector<TrialValue> &args) const
+bool BetaSampler::supports_lanes(size_t num_args) const { return num_args == 2; }
+void BetaSampler::fill(double *out, size_t lanes, const LaneArgument *params) const
+{
+    for_each_tile(lanes, [&](size_t first, size_t count)
+                  {
+        double alpha[TILE], beta[TILE];
+        for (size_t i = 0; i < count; ++i)
+        {
+            alpha[i] = params[0][first + i];
+            beta[i] = params[1][first + i];
+            check_beta(alpha[i], beta[i]);
+        }
+        double u[TILE];
+        if (fill_design_uniforms(*this, first, count, u))
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                out[first + i] = inverse_beta_cdf(u[i], alpha[i], beta[i]);
+            }
+            return;
+        }
+        RandomStream streams[TILE];
+        open_streams(*this, first, count, streams);
+        fill_beta(streams, alpha, beta, out + first, count); });
+}
+
+void BetaSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
 {
     if (args.size() != 2)
         throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Beta' requires 2 arguments: alpha, beta.");
-    double alpha = std::get<double>(args[0]);
-    double beta = std::get<double>(args[1]);
-    if (alpha <= 0 || beta <= 0)
-        throw EngineException(EngineErrc::InvalidSamplerParameters, "Beta distribution parameters must be positive.");
+    *results[0] = draw(args);
+}
 
-    std::gamma_distribution<> gamma1(alpha, 1.0);
-    std::gamma_distribution<> gamma2(beta, 1.0);
+bool PertSampler::supports_lanes(size_t num_args) const { return num_args == 3; }
+void PertSampler::fill(double *out, size_t lanes, const LaneArgument *params) const
+{
+    const double gamma = 4.0;
+    for_each_tile(lanes, [&](size_t first, size_t count)
+                  {
+        double alpha[TILE], beta[TILE];
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double min = params[0][first + i];
+            const double mostLikely = params[1][first + i];
+            const double max = params[2][first + i];
+            check_pert(min, mostLikely, max);
+            alpha[i] = 1.0 + gamma * (mostLikely - min) / (max - min);
+            beta[i] = 1.0 + gamma * (max - mostLikely) / (max - min);
+        }
+        double b[TILE];
+        if (fill_design_uniforms(*this, first, count, b))
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                b[i] = inverse_beta_cdf(b[i], alpha[i], beta[i]);
+            }
+        }
+        else
+        {
+            RandomStream streams[TILE];
+            open_streams(*this, first, count, streams);
+            fill_beta(streams, alpha, beta, b, count);
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double min = params[0][first + i];
+            out[first + i] = min + b[i] * (params[2][first + i] - min);
+        } });
+}
 
-    double g1 = gamma1(get_thread_local_generator());
-    double g2 = gamma2(get_thread_local_generator());
+void PertSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    if (args.size() != 3)
+        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Pert' requires 3 arguments: min, mostLikely, max.");
+    *results[0] = draw(args);
+}
 
-    if (g1 + g2 == 0.0)
-        return {0.0};
+bool TriangularSampler::supports_lanes(size_t num_args) const { return num_args == 3; }
+void TriangularSampler::fill(double *out, size_t lanes, const LaneArgument *params) const
+{
+    for_each_tile(lanes, [&](size_t first, size_t count)
+                  {
+        for (size_t i = 0; i < count; ++i)
+        {
+            check_triangular(params[0][first + i], params[1][first + i], params[2][first + i]);
+        }
+        double u[TILE];
+        fill_uniforms(*this, first, count, u);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double min = params[0][first + i];
+            const double mostLikely = params[1][first + i];
+            const double max = params[2][first + i];
+            const double fc = (mostLikely - min) / (max - min);
+            out[first + i] = u[i] < fc ? min + std::sqrt(u[i] * (max - min) * (mostLikely - min))
+                                       : max - std::sqrt((1 - u[i]) * (max - min) * (max - mostLikely));
+        } });
+}
 
-    double result = g1 / (g1 + g2);
-    return {result};
+void TriangularSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    if (args.size() != 3)
+        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Triangular' requires 3 arguments: min, mostLikely, max.");
+    *results[0] = draw(args);
 }
 
-std::vector<TrialValue> PertSampler::execute(const std::vector<TrialValue> &args) const
+MultivariateNormalSampler::Parameters MultivariateNormalSampler::parameters(ArgumentSpan args) const
 {
     if (args.size() != 3)
-        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Pert' requires 3 arguments: min, mostLikely, max.");
-    double min = std::get<double>(args[0]);
-    double mostLikely = std::get<double>(args[1]);
-    double max = std::get<double>(args[2]);
+        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'MultivariateNormal' requires 3 arguments: means, std_devs, correlation.");
+    const auto *matrix = std::get_if<std::vector<double>>(args[2]);
+    const size_t n = matrix ? matrix_size(*matrix) : 0;
+    if (n == 0)
+        throw EngineException(EngineErrc::InvalidSamplerParameters, "MultivariateNormal correlation must be a square matrix given as a non-empty vector, row by row.");
+    if (!is_broadcast_of(*args[0], n) || !is_broadcast_of(*args[1], n))
+        throw EngineException(EngineErrc::VectorSizeMismatch, "MultivariateNormal means and std_devs must be scalars or vectors with one entry per row of the correlation matrix.");
+    return {n, broadcast_series(*args[0]), broadcast_series(*args[1]), correlation_factor(call_site(), *matrix, n)};
+}
+
+void MultivariateNormalSampler::sample(const Parameters &params, double *const *out, size_t lanes) const
+{
+    const size_t n = params.size;
+    static thread_local std::vector<double> scores;
+    scores.resize(n * TILE);
+    for_each_tile(lanes, [&](size_t first, size_t count)
+                  {
+        for (size_t i = 0; i < count; ++i)
+        {
+            RandomStream stream = random_stream(call_site(), first + i);
+            for (size_t k = 0; k < n; ++k)
+            {
+                scores[k * TILE + i] = draw_normal(stream);
+            }
+        }
+        // Component r mixes the first r + 1 scores; the lane loops are innermost.
+        double mixed[TILE];
+        for (size_t r = 0; r < n; ++r)
+        {
+            const double *row = params.factor + r * n;
+            for (size_t i = 0; i < count; ++i)
+            {
+                mixed[i] = row[0] * scores[i];
+            }
+            for (size_t k = 1; k <= r; ++k)
+            {
+                const double weight = row[k];
+                const double *z = scores.data() + k * TILE;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    mixed[i] += weight * z[i];
+                }
+            }
+            const double mean = params.means[r];
+            const double std_dev = params.std_devs[r];
+            double *dest = out[r] + first;
+            for (size_t i = 0; i < count; ++i)
+            {
+                dest[i] = mean + std_dev * mixed[i];
+            }
+        } });
+}
 
-    if (min > mostLikely || mostLikely > max || min == max)
+size_t MultivariateNormalSampler::execute_into(ArgumentSpan args, ResultSpan results) const
+{
+    if (results.size() == 1)
     {
-        throw EngineException(EngineErrc::InvalidSamplerParameters, "Invalid PERT parameters: must be min <= mostLikely <= max and min != max.");
+        evaluate(args, results.data());
+        return 1;
     }
+    const Parameters params = parameters(args);
+    if (results.size() != params.size || params.size < 2)
+        return params.size < 2 ? 1 : params.size;
+    static thread_local std::vector<double *> out;
+    out.resize(params.size);
+    for (size_t r = 0; r < params.size; ++r)
+    {
+        out[r] = &results[r]->emplace<double>();
+    }
+    sample(params, out.data(), 1);
+    return params.size;
+}
 
-    const double gamma = 4.0;
-    double alpha = 1.0 + gamma * (mostLikely - min) / (max - min);
-    double beta_param = 1.0 + gamma * (max - mostLikely) / (max - min);
-
-    std::gamma_distribution<> gamma1(alpha, 1.0);
-    std::gamma_distribution<> gamma2(beta_param, 1.0);
-    double g1 = gamma1(get_thread_local_generator());
-    double g2 = gamma2(get_thread_local_generator());
+bool MultivariateNormalSampler::supports_lane_results(ArgumentSpan args, size_t num_results) const
+{
+    if (args.size() != 3 || num_results < 2)
+        return false;
+    const auto *matrix = std::get_if<std::vector<double>>(args[2]);
+    return matrix && matrix_size(*matrix) == num_results && is_broadcast_of(*args[0], num_results) && is_broadcast_of(*args[1], num_results);
+}
 
-    double betaSample = (g1 + g2 == 0.0) ? 0.0 : g1 / (g1 + g2);
-    double result = min + betaSample * (max - min);
-    return {result};
+void MultivariateNormalSampler::execute_lanes_into(ArgumentSpan args, double *const *out, size_t, size_t lanes) const
+{
+    sample(parameters(args), out, lanes);
 }
 
-std::vector<TrialValue> TriangularSampler::execute(const std::vector<TrialValue> &args) const
+void MultivariateNormalSampler::fill(double *, size_t, const LaneArgument *) const
 {
-    if (args.size() != 3)
-        throw EngineException(EngineErrc::IncorrectArgumentCount, "Function 'Triangular' requires 3 arguments: min, mostLikely, max.");
-    double min = std::get<double>(args[0]);
-    double mostLikely = std::get<double>(args[1]);
-    double max = std::get<double>(args[2]);
+    throw std::logic_error("MultivariateNormal draws several values per trial; use execute_lanes_into.");
+}
 
-    if (min > mostLikely || mostLikely > max)
+void MultivariateNormalSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    const Parameters params = parameters(args);
+    std::vector<double> &values = assign_series(*results[0], params.size);
+    static thread_local std::vector<double *> out;
+    out.resize(params.size);
+    for (size_t r = 0; r < params.size; ++r)
     {
-        throw EngineException(EngineErrc::InvalidSamplerParameters, "Invalid Triangular parameters: must be min <= mostLikely <= max.");
+        out[r] = &values[r];
     }
+    sample(params, out.data(), 1);
+}
 
-    std::uniform_real_distribution<> uniform_dist(0.0, 1.0);
-    double u = uniform_dist(get_thread_local_generator());
-    double fc = (mostLikely - min) / (max - min);
-    double result;
+void PathSampler::fill(double *, size_t, const LaneArgument *) const
+{
+    throw std::logic_error("Path samplers draw a series per trial and have no batched form.");
+}
 
-    if (u < fc)
+void GbmPathSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    const PathShape shape = path_shape(args, 3, "gbm_path", "start, drift, volatility, periods[, dt]");
+    const double start = std::get<double>(*args[0]);
+    const double drift = std::get<double>(*args[1]);
+    const double volatility = std::get<double>(*args[2]);
+    check_non_negative(volatility, "gbm_path volatility");
+
+    std::vector<double> &path = assign_series(*results[0], shape.periods);
+    PathDraws draws(*this);
+    draws.normals(path.data(), shape.periods);
+    log_increments(path.data(), shape.periods, (drift - 0.5 * volatility * volatility) * shape.dt, volatility * std::sqrt(shape.dt));
+    exponentiate_path(path.data(), shape.periods, start);
+}
+
+void OuPathSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    const PathShape shape = path_shape(args, 4, "ou_path", "start, mean_level, reversion_speed, volatility, periods[, dt]");
+    const double start = std::get<double>(*args[0]);
+    const double mean_level = std::get<double>(*args[1]);
+    const double speed = std::get<double>(*args[2]);
+    const double volatility = std::get<double>(*args[3]);
+    check_non_negative(speed, "ou_path reversion_speed");
+    check_non_negative(volatility, "ou_path volatility");
+
+    // x_t = mean + (x_{t-1} - mean) e^{-speed dt} + volatility sqrt((1 - e^{-2 speed dt}) / (2 speed)) z_t
+    const double decay = std::exp(-speed * shape.dt);
+    const double step_std_dev = volatility * (speed > 0.0 ? std::sqrt(-std::expm1(-2.0 * speed * shape.dt) / (2.0 * speed)) : std::sqrt(shape.dt));
+    std::vector<double> &path = assign_series(*results[0], shape.periods);
+    PathDraws draws(*this);
+    draws.normals(path.data(), shape.periods);
+    double deviation = start - mean_level;
+    for (double &value : path)
     {
-        result = min + std::sqrt(u * (max - min) * (mostLikely - min));
+        deviation = deviation * decay + step_std_dev * value;
+        value = mean_level + deviation;
     }
-    else
+}
+
+void JumpDiffusionPathSampler::evaluate(ArgumentSpan args, TrialValue *const *results) const
+{
+    const PathShape shape = path_shape(args, 6, "jump_diffusion_path", "start, drift, volatility, jump_intensity, jump_mean, jump_std_dev, periods[, dt]");
+    const double start = std::get<double>(*args[0]);
+    const double drift = std::get<double>(*args[1]);
+    const double volatility = std::get<double>(*args[2]);
+    const double intensity = std::get<double>(*args[3]);
+    const double jump_mean = std::get<double>(*args[4]);
+    const double jump_std_dev = std::get<double>(*args[5]);
+    check_non_negative(volatility, "jump_diffusion_path volatility");
+    check_non_negative(intensity, "jump_diffusion_path jump_intensity");
+    check_non_negative(jump_std_dev, "jump_diffusion_path jump_std_dev");
+
+    // The expected relative jump size, compensated in the drift so that E[S_t] = start e^{drift t}.
+    const double mean_jump = std::expm1(jump_mean + 0.5 * jump_std_dev * jump_std_dev);
+    std::vector<double> &path = assign_series(*results[0], shape.periods);
+    PathDraws draws(*this);
+    draws.normals(path.data(), shape.periods);
+    log_increments(path.data(), shape.periods, (drift - 0.5 * volatility * volatility - intensity * mean_jump) * shape.dt, volatility * std::sqrt(shape.dt));
+    if (intensity > 0.0)
     {
-        result = max - std::sqrt((1 - u) * (max - min) * (max - mostLikely));
+        // Jump counts from exponential inter-arrival times, drawn after the diffusion scores; the
+        // k jumps of a period add a log size of N(k jump_mean, k jump_std_dev^2).
+        for (double &increment : path)
+        {
+            size_t jumps = 0;
+            for (double arrival = -std::log(draws.uniform()) / intensity; arrival < shape.dt; arrival -= std::log(draws.uniform()) / intensity)
+            {
+                ++jumps;
+            }
+            if (jumps > 0)
+            {
+                const double k = static_cast<double>(jumps);
+                increment += k * jump_mean + jump_std_dev * std::sqrt(k) * draws.normal();
+            }
+        }
     }
-
-    return {result};
-}
\ No newline at end of file
+    exponentiate_path(path.data(), shape.periods, start);
+}
@@ -0,0 +1,345 @@
+#include "include/engine/io/EngineServer.h"
+#include "include/engine/core/EngineException.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <variant>
+
+using json = nlohmann::json;
+
+namespace
+{
+    double round4(double value)
+    {
+        return std::round(value * 10000.0) / 10000.0;
+    }
+
+    json error_json(const std::string &message)
+    {
+        json error;
+        error["status"] = "error";
+        error["message"] = message;
+        return error;
+    }
+
+    std::string percentile_label(double q)
+    {
+        return "P" + std::to_string(static_cast<int>(q * 100 + 0.5));
+    }
+
+    json statistics_to_json(const std::string &name, const StatisticsSink &statistics)
+    {
+        json output;
+        output["name"] = name;
+        output["trials"] = statistics.trials();
+        const auto &periods = statistics.periods();
+        switch (statistics.kind())
+        {
+        case StatisticsSink::Kind::Scalar:
+        {
+            const OutputStatistics &period = periods[0];
+            output["type"] = "scalar";
+            output["mean"] = period.moments.mean;
+            output["stddev"] = period.moments.stddev();
+            output["min"] = period.moments.min;
+            output["max"] = period.moments.max;
+            for (double q : REPORTED_PERCENTILES)
+            {
+                output["percentiles"][percentile_label(q)] = period.quantiles.quantile(q);
+            }
+            break;
+        }
+        case StatisticsSink::Kind::Vector:
+            output["type"] = "vector";
+            output["periods"] = json::array();
+            for (const OutputStatistics &period : periods)
+            {
+                output["periods"].push_back({{"mean", period.moments.mean},
+                                             {"stddev", period.moments.stddev()},
+                                             {"P5", period.quantiles.quantile(0.05)},
+                                             {"P50", period.quantiles.quantile(0.50)},
+                                             {"P95", period.quantiles.quantile(0.95)}});
+            }
+            break;
+        case StatisticsSink::Kind::Other:
+            output["type"] = "other";
+            break;
+        case StatisticsSink::Kind::Empty:
+            output["type"] = "empty";
+            break;
+        }
+        return output;
+    }
+}
+
+json preview_to_json(const PreviewResult &preview, size_t bins)
+{
+    if (!preview.value)
+    {
+        return error_json("No results were generated.");
+    }
+
+    json output_json;
+    output_json["status"] = "success";
+    output_json["trials"] = preview.trials;
+    std::visit(
+        [&](auto &&value)
+        {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, double>)
+            {
+                output_json["type"] = "scalar";
+                output_json["value"] = round4(value);
+            }
+            else if constexpr (std::is_same_v<T, std::vector<double>>)
+            {
+                output_json["type"] = "vector";
+                std::vector<double> rounded_vec;
+                rounded_vec.reserve(value.size());
+                for (const auto &val : value)
+                {
+                    rounded_vec.push_back(round4(val));
+                }
+                output_json["value"] = rounded_vec;
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                output_json["type"] = "boolean";
+                output_json["value"] = value;
+            }
+            else if constexpr (std::is_same_v<T, std::string>)
+            {
+                output_json["type"] = "string";
+                output_json["value"] = value;
+            }
+        },
+        *preview.value);
+    if (preview.distribution)
+    {
+        output_json["distribution"] = distribution_to_json(*preview.distribution, bins);
+    }
+    return output_json;
+}
+
+json sensitivity_to_json(const SensitivityReport &report)
+{
+    auto summary = [](const OutputStatistics &statistics)
+    {
+        return json{{"mean", statistics.moments.mean},
+                    {"stddev", statistics.moments.stddev()},
+                    {"P5", statistics.quantiles.quantile(0.05)},
+                    {"P50", statistics.quantiles.quantile(0.50)},
+                    {"P95", statistics.quantiles.quantile(0.95)}};
+    };
+    json output;
+    output["trials"] = report.trials;
+    output["base"] = summary(report.base);
+    output["bars"] = json::array();
+    for (const SensitivityBar &bar : report.bars)
+    {
+        output["bars"].push_back({{"name", bar.name},
+                                  {"slot", bar.input.slot},
+                                  {"low", bar.input.low},
+                                  {"high", bar.input.high},
+                                  {"mean_low", bar.at_low.moments.mean},
+                                  {"mean_high", bar.at_high.moments.mean},
+                                  {"swing", bar.swing()}});
+    }
+    return output;
+}
+
+std::vector<StatisticsSink> run_with_statistics(SimulationEngine &engine, RunReport *report, const std::vector<ResultSink *> &extra_sinks)
+{
+    // Results are streamed into the statistics and the output file; they are never held in full.
+    std::vector<StatisticsSink> statistics(engine.get_output_names().size());
+    std::vector<OutputColumnSink> statistics_columns;
+    std::vector<ResultSink *> sinks;
+    for (size_t k = 0; k < statistics.size(); ++k)
+    {
+        statistics_columns.emplace_back(statistics[k], k);
+    }
+    for (OutputColumnSink &column : statistics_columns)
+    {
+        sinks.push_back(&column);
+    }
+    // A summary output file is written from these statistics rather than gathered a second time.
+    std::unique_ptr<ResultSink> writer;
+    const std::string output_path = engine.get_output_file_path();
+    const bool writes_summary = !output_path.empty() && engine.get_output_format() == OutputFormat::Summary;
+    if (!output_path.empty() && !writes_summary)
+    {
+        writer = make_result_writer(output_path, engine.get_output_format(), engine.get_seed());
+        sinks.push_back(writer.get());
+    }
+    sinks.insert(sinks.end(), extra_sinks.begin(), extra_sinks.end());
+    const RunReport run_report = engine.run(sinks);
+    if (writes_summary)
+    {
+        write_summary(output_path, engine.get_output_names(), statistics, engine.get_seed(), engine.get_summary_bins());
+    }
+    if (report)
+    {
+        *report = run_report;
+    }
+    return statistics;
+}
+
+EngineServer::EngineServer(Configure configure, size_t cache_capacity)
+    : m_configure(std::move(configure)), m_cache_capacity(std::max<size_t>(1, cache_capacity))
+{
+}
+
+void EngineServer::serve(std::istream &in, std::ostream &out)
+{
+    std::string line;
+    while (!m_shutdown && std::getline(in, line))
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        json response;
+        try
+        {
+            response = handle(json::parse(line));
+        }
+        catch (const json::parse_error &e)
+        {
+            response = error_json("Failed to parse request: " + std::string(e.what()));
+        }
+        out << response.dump() << std::endl;
+    }
+}
+
+json EngineServer::handle(const json &request)
+{
+    json response;
+    try
+    {
+        if (!request.is_object())
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "Request must be a JSON object.");
+        }
+        const std::string command = request.value("command", std::string());
+        if (command == "preview")
+        {
+            bool cached = false;
+            const auto engine = engine_for(request, cached);
+            PreviewOptions options;
+            options.max_trials = request.value("max_trials", options.max_trials);
+            options.relative_ci_width = request.value("relative_ci_width", options.relative_ci_width);
+            response = preview_to_json(engine->preview(options), request.value("bins", PREVIEW_BINS));
+            response["cached"] = cached;
+        }
+        else if (command == "run")
+        {
+            bool cached = false;
+            const auto engine = engine_for(request, cached);
+            RunReport report;
+            const std::vector<StatisticsSink> statistics = run_with_statistics(*engine, &report);
+            response["status"] = "success";
+            response["cached"] = cached;
+            response["outputs"] = json::array();
+            const size_t bins = request.value("bins", size_t(0));
+            for (size_t k = 0; k < statistics.size(); ++k)
+            {
+                json output = statistics_to_json(engine->get_output_names()[k], statistics[k]);
+                if (bins > 0)
+                {
+                    output["distributions"] = json::array();
+                    if (statistics[k].kind() == StatisticsSink::Kind::Scalar || statistics[k].kind() == StatisticsSink::Kind::Vector)
+                    {
+                        for (const OutputStatistics &period : statistics[k].periods())
+                            output["distributions"].push_back(distribution_to_json(period, bins));
+                    }
+                }
+                response["outputs"].push_back(std::move(output));
+            }
+            if (engine->get_precision_target().enabled())
+            {
+                response["precision"] = {{"trials", report.trials},
+                                         {"rounds", report.rounds},
+                                         {"converged", report.converged},
+                                         {"standard_error", report.standard_error},
+                                         {"relative_error", report.relative_error},
+                                         {"quantile_ci_width", report.quantile_ci_width}};
+            }
+        }
+        else if (command == "sensitivity")
+        {
+            bool cached = false;
+            const auto engine = engine_for(request, cached);
+            response = sensitivity_to_json(engine->run_sensitivity());
+            response["status"] = "success";
+            response["cached"] = cached;
+        }
+        else if (command == "clear_cache")
+        {
+            m_cache.clear();
+            response["status"] = "success";
+        }
+        else if (command == "shutdown")
+        {
+            m_shutdown = true;
+            response["status"] = "success";
+        }
+        else
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "Unknown server command: '" + command + "'");
+        }
+    }
+    catch (const json::exception &e)
+    {
+        response = error_json("Invalid request: " + std::string(e.what()));
+    }
+    catch (const std::exception &e)
+    {
+        response = error_json(e.what());
+    }
+    if (request.is_object() && request.contains("id"))
+    {
+        response["id"] = request.at("id");
+    }
+    return response;
+}
+
+std::shared_ptr<SimulationEngine> EngineServer::engine_for(const json &request, bool &cached)
+{
+    std::string recipe;
+    if (request.contains("recipe"))
+    {
+        const json &inline_recipe = request.at("recipe");
+        recipe = inline_recipe.is_string() ? inline_recipe.get<std::string>() : inline_recipe.dump();
+    }
+    else if (request.contains("recipe_path"))
+    {
+        recipe = SimulationEngine::read_recipe_file(request.at("recipe_path").get<std::string>());
+    }
+    else
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "Request needs a 'recipe' or a 'recipe_path'.");
+    }
+
+    const size_t hash = std::hash<std::string>()(recipe);
+    for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+    {
+        if (it->hash == hash && it->recipe == recipe)
+        {
+            m_cache.splice(m_cache.begin(), m_cache, it);
+            cached = true;
+            return m_cache.front().engine;
+        }
+    }
+
+    // Engines are quiet so that nothing but responses reaches the protocol stream.
+    std::shared_ptr<SimulationEngine> engine = SimulationEngine::from_recipe_text(recipe, true);
+    if (m_configure)
+    {
+        m_configure(*engine);
+    }
+    m_cache.push_front(CacheEntry{hash, std::move(recipe), engine});
+    if (m_cache.size() > m_cache_capacity)
+    {
+        m_cache.pop_back();
+    }
+    cached = false;
+    return engine;
+}
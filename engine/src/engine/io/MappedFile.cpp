@@ -0,0 +1,119 @@
+#include "include/engine/io/MappedFile.h"
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Maps `path` into memory; null when the platform refuses, so that the caller reads it instead.
+    const char *map_file(const std::string &path, size_t &size)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return nullptr;
+        LARGE_INTEGER file_size;
+        const char *data = nullptr;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+        {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping)
+            {
+                data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                size = static_cast<size_t>(file_size.QuadPart);
+                CloseHandle(mapping); // The view keeps the mapping alive.
+            }
+        }
+        CloseHandle(file);
+        return data;
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+        struct stat info;
+        void *data = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        {
+            data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            size = static_cast<size_t>(info.st_size);
+        }
+        ::close(fd); // The mapping outlives the descriptor.
+        return data == MAP_FAILED ? nullptr : static_cast<const char *>(data);
+#endif
+    }
+
+    void unmap_file(const char *data, size_t size)
+    {
+#if defined(_WIN32)
+        (void)size;
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<char *>(data), size);
+#endif
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        m_mapped = std::exchange(other.m_mapped, false);
+        m_buffer = std::move(other.m_buffer);
+        m_size = std::exchange(other.m_size, 0);
+        m_data = m_mapped ? std::exchange(other.m_data, nullptr) : m_buffer.data();
+        other.m_data = nullptr;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+    size_t size = 0;
+    if (const char *data = map_file(path, size))
+    {
+        m_data = data;
+        m_size = size;
+        m_mapped = true;
+        return true;
+    }
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open())
+        return false;
+    m_buffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_mapped)
+        unmap_file(m_data, m_size);
+    m_mapped = false;
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+}
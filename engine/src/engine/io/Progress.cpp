@@ -0,0 +1,133 @@
+#include "include/engine/io/Progress.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+double ProgressSnapshot::eta_seconds() const
+{
+    const double rate = trials_per_second();
+    if (finished)
+        return 0.0;
+    if (rate <= 0.0)
+        return -1.0;
+    return static_cast<double>(total_trials > trials ? total_trials - trials : 0) / rate;
+}
+
+void ProgressSink::begin(size_t num_trials)
+{
+    m_total_trials.store(num_trials, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_started = std::chrono::steady_clock::now();
+}
+
+void ProgressSink::consume(size_t, const TrialValue *results, size_t count)
+{
+    RunningStatistics chunk;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (const double *value = std::get_if<double>(&results[i]))
+            chunk.add(*value);
+    }
+    if (chunk.count > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_statistics.merge(chunk);
+    }
+    m_trials.fetch_add(count, std::memory_order_relaxed);
+}
+
+void ProgressSink::fail(size_t, size_t)
+{
+    m_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+ProgressSnapshot ProgressSink::snapshot() const
+{
+    ProgressSnapshot snapshot;
+    snapshot.finished = m_finished.load(std::memory_order_acquire);
+    snapshot.trials = m_trials.load(std::memory_order_relaxed);
+    snapshot.total_trials = std::max(snapshot.trials, m_total_trials.load(std::memory_order_relaxed));
+    snapshot.errors = m_errors.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    snapshot.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+    snapshot.statistics = m_statistics;
+    return snapshot;
+}
+
+ProgressReporter::ProgressReporter(const ProgressSink &sink, std::chrono::milliseconds interval, Publish publish)
+    : m_sink(sink), m_publish(std::move(publish))
+{
+    m_thread = std::thread([this, interval]
+                           {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_wake.wait_for(lock, interval, [this] { return m_stopping; }))
+        {
+            m_publish(m_sink.snapshot(), false);
+        } });
+}
+
+void ProgressReporter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping)
+            return;
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+    m_publish(m_sink.snapshot(), true);
+}
+
+namespace
+{
+    std::string format_duration(double seconds)
+    {
+        const long long total = static_cast<long long>(std::llround(seconds));
+        char text[32];
+        std::snprintf(text, sizeof(text), "%lld:%02lld:%02lld", total / 3600, total / 60 % 60, total % 60);
+        return text;
+    }
+}
+
+std::string format_progress_bar(const ProgressSnapshot &snapshot)
+{
+    constexpr size_t WIDTH = 20;
+    const double fraction = snapshot.total_trials > 0 ? static_cast<double>(snapshot.trials) / static_cast<double>(snapshot.total_trials) : 1.0;
+    const size_t filled = std::min(WIDTH, static_cast<size_t>(fraction * WIDTH));
+    char text[160];
+    std::snprintf(text, sizeof(text), "] %5.1f%%  %zu/%zu trials  %.0f trials/s", 100.0 * fraction, snapshot.trials, snapshot.total_trials, snapshot.trials_per_second());
+    std::string line = "[" + std::string(filled, '#') + std::string(WIDTH - filled, '-') + text;
+    const double eta = snapshot.eta_seconds();
+    line += "  ETA " + (eta < 0.0 ? std::string("--:--:--") : format_duration(eta));
+    if (snapshot.errors > 0)
+        line += "  " + std::to_string(snapshot.errors) + " error(s)";
+    if (snapshot.statistics.count > 0)
+    {
+        std::snprintf(text, sizeof(text), "  mean %.6g \xC2\xB1 %.2g", snapshot.statistics.mean, snapshot.statistics.standard_error());
+        line += text;
+    }
+    return line;
+}
+
+nlohmann::json progress_to_json(const ProgressSnapshot &snapshot)
+{
+    nlohmann::json line;
+    line["event"] = snapshot.finished ? "finished" : "progress";
+    line["trials"] = snapshot.trials;
+    line["total_trials"] = snapshot.total_trials;
+    line["errors"] = snapshot.errors;
+    line["elapsed"] = snapshot.elapsed_seconds;
+    line["trials_per_second"] = snapshot.trials_per_second();
+    const double eta = snapshot.eta_seconds();
+    line["eta"] = eta < 0.0 ? nlohmann::json() : nlohmann::json(eta);
+    if (snapshot.statistics.count > 0)
+    {
+        line["mean"] = snapshot.statistics.mean;
+        line["stddev"] = snapshot.statistics.stddev();
+        line["standard_error"] = snapshot.statistics.standard_error();
+        line["min"] = snapshot.statistics.min;
+        line["max"] = snapshot.statistics.max;
+    }
+    return line;
+}
@@ -0,0 +1,825 @@
+#include "include/engine/io/ResultSink.h"
+#include "include/engine/core/EngineException.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <iostream>
+#include <utility>
+#include <variant>
+
+namespace
+{
+    constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+    bool write_json_file(const std::string &path, const nlohmann::json &document)
+    {
+        std::ofstream file(path);
+        return static_cast<bool>(file << document.dump() << '\n');
+    }
+}
+
+void ResultCollector::begin(size_t num_trials)
+{
+    m_results.assign(num_trials, TrialValue());
+}
+
+void ResultCollector::extend(size_t num_trials)
+{
+    m_results.resize(num_trials);
+}
+
+// Chunks cover disjoint trial ranges, so concurrent calls write to disjoint elements.
+void ResultCollector::consume(size_t first_trial, const TrialValue *results, size_t count)
+{
+    std::copy(results, results + count, m_results.begin() + static_cast<std::ptrdiff_t>(first_trial));
+}
+
+void ArrayResultSink::set_outputs(const std::vector<std::string> &names)
+{
+    m_arrays.assign(names.size(), Array());
+    for (size_t k = 0; k < names.size(); ++k)
+    {
+        m_arrays[k].name = names[k];
+    }
+}
+
+void ArrayResultSink::extend(size_t num_trials)
+{
+    m_reserved = num_trials;
+    for (Array &array : m_arrays)
+    {
+        array.values.reserve(num_trials * array.width);
+    }
+}
+
+void ArrayResultSink::consume(size_t, const TrialValue *results, size_t count)
+{
+    append(m_arrays.front(), results, count);
+}
+
+void ArrayResultSink::consume_outputs(size_t, const TrialValue *const *columns, size_t count)
+{
+    for (size_t k = 0; k < m_arrays.size(); ++k)
+    {
+        append(m_arrays[k], columns[k], count);
+    }
+}
+
+void ArrayResultSink::append(Array &array, const TrialValue *results, size_t count)
+{
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+    if (count == 0)
+    {
+        return;
+    }
+    if (array.trials == 0)
+    {
+        if (const auto *vector = std::get_if<std::vector<double>>(&results[0]))
+        {
+            array.kind = Kind::Vector;
+            array.width = vector->size();
+        }
+        else if (std::holds_alternative<bool>(results[0]))
+        {
+            array.kind = Kind::Boolean;
+        }
+        array.values.reserve(std::max(m_reserved, count) * array.width);
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TrialValue &value = results[i];
+        if (array.kind == Kind::Vector)
+        {
+            const auto *vector = std::get_if<std::vector<double>>(&value);
+            if (vector && vector->size() == array.width)
+                array.values.insert(array.values.end(), vector->begin(), vector->end());
+            else
+                array.values.insert(array.values.end(), array.width, NaN);
+        }
+        else if (const double *number = std::get_if<double>(&value))
+        {
+            array.values.push_back(*number);
+        }
+        else if (const bool *flag = std::get_if<bool>(&value))
+        {
+            array.values.push_back(*flag ? 1.0 : 0.0);
+        }
+        else
+        {
+            array.values.push_back(NaN);
+        }
+    }
+    array.trials += count;
+}
+
+void StatisticsSink::consume(size_t, const TrialValue *results, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    Partial *partial = nullptr;
+    Kind kind = Kind::Other;
+    size_t num_periods = 0;
+    {
+        // The first chunk to arrive fixes the shape; later chunks are checked against it.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_kind == Kind::Empty)
+        {
+            m_kind = Kind::Other;
+            if (std::holds_alternative<double>(results[0]))
+            {
+                m_kind = Kind::Scalar;
+                m_num_periods = 1;
+            }
+            else if (const auto *vec = std::get_if<std::vector<double>>(&results[0]))
+            {
+                m_kind = Kind::Vector;
+                m_num_periods = vec->size();
+            }
+        }
+        kind = m_kind;
+        num_periods = m_num_periods;
+        auto &slot = m_partials[std::this_thread::get_id()];
+        if (!slot)
+        {
+            slot = std::make_unique<Partial>();
+            slot->periods.resize(num_periods);
+        }
+        partial = slot.get();
+    }
+
+    partial->trials += count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (kind == Kind::Scalar)
+        {
+            partial->periods[0].add(std::get<double>(results[i]));
+        }
+        else if (kind == Kind::Vector)
+        {
+            const auto &vec = std::get<std::vector<double>>(results[i]);
+            if (vec.size() != num_periods)
+            {
+                ++partial->skipped;
+                continue;
+            }
+            for (size_t p = 0; p < num_periods; ++p)
+            {
+                partial->periods[p].add(vec[p]);
+            }
+        }
+    }
+}
+
+void StatisticsSink::finish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_periods.resize(m_num_periods);
+    for (const auto &entry : m_partials)
+    {
+        const Partial &partial = *entry.second;
+        for (size_t p = 0; p < m_num_periods; ++p)
+        {
+            m_periods[p].merge(partial.periods[p]);
+        }
+        m_trials += partial.trials;
+        m_skipped += partial.skipped;
+    }
+    m_partials.clear();
+}
+
+void StatisticsSink::merge(Kind kind, size_t trials, size_t skipped, const std::vector<OutputStatistics> &periods)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (kind == Kind::Empty)
+    {
+        return;
+    }
+    if (m_kind == Kind::Empty)
+    {
+        m_kind = kind;
+        m_num_periods = periods.size();
+        m_periods.resize(m_num_periods);
+    }
+    m_trials += trials;
+    if (kind != m_kind || periods.size() != m_num_periods)
+    {
+        m_skipped += trials;
+        return;
+    }
+    m_skipped += skipped;
+    for (size_t p = 0; p < m_num_periods; ++p)
+    {
+        m_periods[p].merge(periods[p]);
+    }
+}
+
+CsvResultWriter::CsvResultWriter(std::string path) : m_path(std::move(path)) {}
+
+void CsvResultWriter::set_outputs(const std::vector<std::string> &names)
+{
+    m_names = names;
+}
+
+bool CsvResultWriter::open(const TrialValue *const *columns)
+{
+    m_started = true;
+    m_file.open(m_path, std::ios::binary);
+    if (!m_file.is_open())
+    {
+        std::cerr << "Warning: Could not open output file '" << m_path << "' for writing." << std::endl;
+        m_failed = true;
+        return false;
+    }
+    m_pending.reserve(WRITE_BUFFER_SIZE + 1024);
+
+    std::cout << "\n--- Writing results to " << m_path << " ---" << std::endl;
+    // A single output keeps the historical "Result" / "Period_<n>" header.
+    const bool named = m_names.size() > 1;
+    m_periods.assign(named ? m_names.size() : 1, 0);
+    std::vector<std::string> header;
+    for (size_t k = 0; k < m_periods.size(); ++k)
+    {
+        const TrialValue &first = columns[k][0];
+        if (const auto *vec = std::get_if<std::vector<double>>(&first))
+        {
+            m_periods[k] = vec->size();
+            for (size_t i = 0; i < m_periods[k]; ++i)
+            {
+                header.push_back((named ? m_names[k] + "_" : std::string()) + "Period_" + std::to_string(i + 1));
+            }
+        }
+        else if (named)
+        {
+            header.push_back(m_names[k]);
+        }
+        else if (std::holds_alternative<double>(first) || std::holds_alternative<bool>(first))
+        {
+            header.push_back("Result");
+        }
+    }
+    for (size_t i = 0; i < header.size(); ++i)
+    {
+        append(header[i].data(), header[i].size());
+        m_pending.push_back(i + 1 == header.size() ? '\n' : ',');
+    }
+    return true;
+}
+
+// Appends the row of one trial, or nothing when the trial is skipped.
+bool CsvResultWriter::append_row(const TrialValue *const *columns, size_t trial)
+{
+    const size_t mark = m_pending.size();
+    const bool named = m_periods.size() > 1;
+    bool first_field = true;
+    auto separate = [&]
+    {
+        if (!first_field)
+            m_pending.push_back(',');
+        first_field = false;
+    };
+    for (size_t k = 0; k < m_periods.size(); ++k)
+    {
+        const TrialValue &result = columns[k][trial];
+        if (const double *d = std::get_if<double>(&result))
+        {
+            separate();
+            append_number(*d);
+        }
+        else if (const bool *b = std::get_if<bool>(&result))
+        {
+            separate();
+            *b ? append("true", 4) : append("false", 5);
+        }
+        else if (const auto *vec = std::get_if<std::vector<double>>(&result); vec && vec->size() == m_periods[k] && (named || !vec->empty()))
+        {
+            for (double value : *vec)
+            {
+                separate();
+                append_number(value);
+            }
+        }
+        else if (named && std::holds_alternative<std::string>(result))
+        {
+            separate(); // Strings are left empty.
+        }
+        else
+        {
+            m_pending.resize(mark);
+            return false;
+        }
+    }
+    m_pending.push_back('\n');
+    return true;
+}
+
+void CsvResultWriter::consume(size_t first_trial, const TrialValue *results, size_t count)
+{
+    const TrialValue *columns[] = {results};
+    consume_outputs(first_trial, columns, count);
+}
+
+void CsvResultWriter::consume_outputs(size_t, const TrialValue *const *columns, size_t count)
+{
+    if (count == 0 || m_failed || (!m_started && !open(columns)))
+    {
+        return;
+    }
+    m_trials += count;
+    for (size_t t = 0; t < count; ++t)
+    {
+        append_row(columns, t);
+        if (m_pending.size() >= WRITE_BUFFER_SIZE)
+        {
+            flush_pending();
+        }
+    }
+}
+
+void CsvResultWriter::append(const char *text, size_t size)
+{
+    m_pending.insert(m_pending.end(), text, text + size);
+}
+
+void CsvResultWriter::append_number(double value)
+{
+    char text[32];
+#if defined(__cpp_lib_to_chars)
+    const auto result = std::to_chars(text, text + sizeof(text), value);
+    append(text, static_cast<size_t>(result.ptr - text));
+#else
+    // Standard libraries without floating-point to_chars: %.17g also round-trips.
+    const int size = std::snprintf(text, sizeof(text), "%.17g", value);
+    append(text, static_cast<size_t>(size));
+#endif
+}
+
+void CsvResultWriter::flush_pending()
+{
+    m_file.write(m_pending.data(), static_cast<std::streamsize>(m_pending.size()));
+    m_pending.clear();
+}
+
+void CsvResultWriter::finish()
+{
+    if (!m_started || m_failed)
+    {
+        return;
+    }
+    flush_pending();
+    m_file.flush();
+    std::cout << "Successfully wrote " << m_trials << " trials." << std::endl;
+}
+
+namespace
+{
+    template <typename T>
+    void put_le(unsigned char *out, T value)
+    {
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            out[i] = static_cast<unsigned char>(static_cast<uint64_t>(value) >> (8 * i));
+        }
+    }
+
+    template <typename T>
+    T get_le(const unsigned char *in)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return static_cast<T>(value);
+    }
+
+    bool is_little_endian()
+    {
+        const uint16_t probe = 1;
+        unsigned char first = 0;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+}
+
+BinaryResultWriter::BinaryResultWriter(std::string path, uint64_t seed) : m_path(std::move(path)), m_seed(seed) {}
+
+void BinaryResultWriter::set_outputs(const std::vector<std::string> &names)
+{
+    m_num_outputs = std::max<size_t>(1, names.size());
+}
+
+void BinaryResultWriter::begin(size_t num_trials)
+{
+    m_num_trials = num_trials;
+}
+
+bool BinaryResultWriter::open(const TrialValue *const *columns)
+{
+    m_started = true;
+    size_t total_columns = 0;
+    for (size_t k = 0; k < m_num_outputs; ++k)
+    {
+        const TrialValue &first = columns[k][0];
+        Output output{0, total_columns, 1};
+        if (const auto *vec = std::get_if<std::vector<double>>(&first))
+        {
+            output.kind = 1;
+            output.columns = vec->size();
+        }
+        else if (std::holds_alternative<bool>(first))
+        {
+            output.kind = 2;
+        }
+        else if (!std::holds_alternative<double>(first))
+        {
+            std::cerr << "Warning: String results cannot be written to binary output file '" << m_path << "'." << std::endl;
+            m_failed = true;
+            return false;
+        }
+        total_columns += output.columns;
+        m_outputs.push_back(output);
+    }
+
+    m_buffer.reset(new char[WRITE_BUFFER_SIZE]);
+    m_file.rdbuf()->pubsetbuf(m_buffer.get(), WRITE_BUFFER_SIZE);
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        std::cerr << "Warning: Could not open output file '" << m_path << "' for writing." << std::endl;
+        m_failed = true;
+        return false;
+    }
+
+    std::cout << "\n--- Writing results to " << m_path << " ---" << std::endl;
+    const bool multiple = m_num_outputs > 1;
+    m_header_size = HEADER_SIZE + (multiple ? OUTPUT_DESCRIPTOR_SIZE * m_num_outputs : 0);
+    std::vector<unsigned char> header(m_header_size, 0);
+    std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+    put_le(header.data() + 8, static_cast<uint32_t>(m_header_size));
+    put_le(header.data() + 12, static_cast<uint32_t>(1));
+    put_le(header.data() + 16, static_cast<uint64_t>(m_num_trials));
+    put_le(header.data() + 24, static_cast<uint64_t>(total_columns));
+    put_le(header.data() + 32, m_seed);
+    put_le(header.data() + 40, m_outputs[0].kind);
+    if (multiple)
+    {
+        put_le(header.data() + 44, static_cast<uint32_t>(m_num_outputs));
+        for (size_t k = 0; k < m_num_outputs; ++k)
+        {
+            unsigned char *descriptor = header.data() + HEADER_SIZE + k * OUTPUT_DESCRIPTOR_SIZE;
+            put_le(descriptor, m_outputs[k].kind);
+            put_le(descriptor + 8, static_cast<uint64_t>(m_outputs[k].columns));
+        }
+    }
+    m_file.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+    return true;
+}
+
+void BinaryResultWriter::consume(size_t first_trial, const TrialValue *results, size_t count)
+{
+    const TrialValue *columns[] = {results};
+    consume_outputs(first_trial, columns, count);
+}
+
+// Windows arrive in trial order, so each column is written as one contiguous run per window.
+void BinaryResultWriter::consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count)
+{
+    if (count == 0 || m_failed || (!m_started && !open(columns)))
+    {
+        return;
+    }
+    m_trials += count;
+    m_column.resize(count);
+    for (size_t k = 0; k < m_outputs.size(); ++k)
+    {
+        const Output &output = m_outputs[k];
+        const TrialValue *results = columns[k];
+        for (size_t c = 0; c < output.columns; ++c)
+        {
+            for (size_t t = 0; t < count; ++t)
+            {
+                const TrialValue &result = results[t];
+                if (const double *d = std::get_if<double>(&result))
+                {
+                    m_column[t] = *d;
+                }
+                else if (const bool *b = std::get_if<bool>(&result))
+                {
+                    m_column[t] = *b ? 1.0 : 0.0;
+                }
+                else if (const auto *vec = std::get_if<std::vector<double>>(&result); vec && vec->size() == output.columns)
+                {
+                    m_column[t] = (*vec)[c];
+                }
+                else
+                {
+                    m_column[t] = std::numeric_limits<double>::quiet_NaN();
+                }
+            }
+            if (!is_little_endian())
+            {
+                for (double &value : m_column)
+                {
+                    unsigned char bytes[sizeof(double)];
+                    uint64_t bits = 0;
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    put_le(bytes, bits);
+                    std::memcpy(&value, bytes, sizeof(bytes));
+                }
+            }
+            const uint64_t offset = m_header_size + ((output.first_column + c) * m_num_trials + first_trial) * sizeof(double);
+            m_file.seekp(static_cast<std::streamoff>(offset));
+            m_file.write(reinterpret_cast<const char *>(m_column.data()), static_cast<std::streamsize>(count * sizeof(double)));
+        }
+    }
+}
+
+// Column c moves from c * old to c * new trials past the header. Later columns move further,
+// so they go first, and each is copied from its end so that overlapping ranges stay intact.
+void BinaryResultWriter::extend(size_t num_trials)
+{
+    if (!m_started || m_failed || num_trials <= m_num_trials)
+    {
+        m_num_trials = std::max(m_num_trials, num_trials);
+        return;
+    }
+    const size_t total_columns = m_outputs.back().first_column + m_outputs.back().columns;
+    std::vector<char> block(std::min<size_t>(m_num_trials, WRITE_BUFFER_SIZE / sizeof(double)) * sizeof(double));
+    for (size_t c = total_columns; c-- > 1;)
+    {
+        const uint64_t from = m_header_size + c * m_num_trials * sizeof(double);
+        const uint64_t to = m_header_size + c * num_trials * sizeof(double);
+        for (size_t end = m_trials * sizeof(double); end > 0;)
+        {
+            const size_t size = std::min(block.size(), end);
+            end -= size;
+            m_file.seekg(static_cast<std::streamoff>(from + end));
+            m_file.read(block.data(), static_cast<std::streamsize>(size));
+            m_file.seekp(static_cast<std::streamoff>(to + end));
+            m_file.write(block.data(), static_cast<std::streamsize>(size));
+        }
+    }
+    m_num_trials = num_trials;
+    unsigned char trials[sizeof(uint64_t)];
+    put_le(trials, static_cast<uint64_t>(m_num_trials));
+    m_file.seekp(16);
+    m_file.write(reinterpret_cast<const char *>(trials), sizeof(trials));
+}
+
+void BinaryResultWriter::finish()
+{
+    if (!m_started || m_failed)
+    {
+        return;
+    }
+    m_file.flush();
+    std::cout << "Successfully wrote " << m_trials << " trials." << std::endl;
+}
+
+BinaryResultReader::BinaryResultReader(const std::string &path) : m_path(path)
+{
+    m_file.open(path, std::ios::binary);
+    if (!m_file.is_open())
+    {
+        throw EngineException(EngineErrc::OutputFileWriteFailed, "Could not open results file '" + path + "'.");
+    }
+    unsigned char header[BinaryResultWriter::HEADER_SIZE];
+    m_file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!m_file || std::memcmp(header, BinaryResultWriter::MAGIC, sizeof(BinaryResultWriter::MAGIC)) != 0 || get_le<uint32_t>(header + 12) != 1)
+    {
+        throw EngineException(EngineErrc::OutputFileWriteFailed, "'" + path + "' is not a binary results file.");
+    }
+    m_header_size = get_le<uint32_t>(header + 8);
+    m_num_trials = static_cast<size_t>(get_le<uint64_t>(header + 16));
+    m_seed = get_le<uint64_t>(header + 32);
+    const size_t num_outputs = get_le<uint32_t>(header + 44);
+    if (num_outputs == 0)
+    {
+        m_outputs.push_back({get_le<uint32_t>(header + 40), 0, static_cast<size_t>(get_le<uint64_t>(header + 24))});
+        return;
+    }
+    std::vector<unsigned char> descriptors(num_outputs * BinaryResultWriter::OUTPUT_DESCRIPTOR_SIZE);
+    m_file.read(reinterpret_cast<char *>(descriptors.data()), static_cast<std::streamsize>(descriptors.size()));
+    if (!m_file)
+    {
+        throw EngineException(EngineErrc::OutputFileWriteFailed, "'" + path + "' is not a binary results file.");
+    }
+    size_t first_column = 0;
+    for (size_t k = 0; k < num_outputs; ++k)
+    {
+        const unsigned char *descriptor = descriptors.data() + k * BinaryResultWriter::OUTPUT_DESCRIPTOR_SIZE;
+        const size_t columns = static_cast<size_t>(get_le<uint64_t>(descriptor + 8));
+        m_outputs.push_back({get_le<uint32_t>(descriptor), first_column, columns});
+        first_column += columns;
+    }
+}
+
+void BinaryResultReader::read(size_t first_trial, size_t count, std::vector<std::vector<TrialValue>> &columns)
+{
+    if (first_trial + count > m_num_trials)
+    {
+        throw EngineException(EngineErrc::IndexOutOfBounds, "Trials past the end of results file '" + m_path + "'.");
+    }
+    columns.resize(m_outputs.size());
+    m_column.resize(count);
+    for (size_t k = 0; k < m_outputs.size(); ++k)
+    {
+        const Output &output = m_outputs[k];
+        std::vector<TrialValue> &results = columns[k];
+        results.assign(count, output.kind == 1 ? TrialValue(std::vector<double>(output.columns)) : TrialValue(0.0));
+        for (size_t c = 0; c < output.columns; ++c)
+        {
+            const uint64_t offset = m_header_size + ((output.first_column + c) * m_num_trials + first_trial) * sizeof(double);
+            m_file.seekg(static_cast<std::streamoff>(offset));
+            m_file.read(reinterpret_cast<char *>(m_column.data()), static_cast<std::streamsize>(count * sizeof(double)));
+            if (!m_file)
+            {
+                throw EngineException(EngineErrc::OutputFileWriteFailed, "Results file '" + m_path + "' is truncated.");
+            }
+            if (!is_little_endian())
+            {
+                for (double &value : m_column)
+                {
+                    const uint64_t bits = get_le<uint64_t>(reinterpret_cast<const unsigned char *>(&value));
+                    std::memcpy(&value, &bits, sizeof(bits));
+                }
+            }
+            for (size_t t = 0; t < count; ++t)
+            {
+                if (output.kind == 1)
+                    std::get<std::vector<double>>(results[t])[c] = m_column[t];
+                else if (output.kind == 2)
+                    results[t] = m_column[t] != 0.0;
+                else
+                    results[t] = m_column[t];
+            }
+        }
+    }
+}
+
+nlohmann::json distribution_to_json(const OutputStatistics &statistics, size_t bins)
+{
+    const RunningStatistics &moments = statistics.moments;
+    const QuantileSketch &quantiles = statistics.quantiles;
+    nlohmann::json distribution = {{"mean", moments.mean},
+                                   {"stddev", moments.stddev()},
+                                   {"skewness", moments.skewness()},
+                                   {"kurtosis", moments.kurtosis()},
+                                   {"min", moments.min},
+                                   {"max", moments.max}};
+    for (double q : REPORTED_PERCENTILES)
+    {
+        distribution["percentiles"]["P" + std::to_string(static_cast<int>(q * 100 + 0.5))] = quantiles.quantile(q);
+    }
+
+    bins = std::max<size_t>(bins, 1);
+    std::vector<double> edges(bins + 1), counts(bins), values(bins + 1), probabilities(bins + 1);
+    const double width = (moments.max - moments.min) / static_cast<double>(bins);
+    const double total = quantiles.total_weight();
+    double below = 0.0;
+    for (size_t b = 0; b <= bins; ++b)
+    {
+        edges[b] = b == bins ? moments.max : moments.min + width * static_cast<double>(b);
+        probabilities[b] = static_cast<double>(b) / static_cast<double>(bins);
+        values[b] = quantiles.quantile(probabilities[b]);
+        if (b > 0)
+        {
+            // Every trial lies at or below the last edge, max; a constant output fills the first bin.
+            const double at_or_below = b == bins ? total : total * quantiles.cdf(edges[b]);
+            counts[b - 1] = at_or_below - below;
+            below = at_or_below;
+        }
+    }
+    distribution["histogram"] = {{"edges", edges}, {"counts", counts}};
+    distribution["ecdf"] = {{"values", values}, {"probabilities", probabilities}};
+    return distribution;
+}
+
+nlohmann::json summary_to_json(const std::vector<std::string> &names, const std::vector<StatisticsSink> &statistics, uint64_t seed, size_t bins)
+{
+    nlohmann::json document;
+    document["format"] = "vse-summary";
+    document["version"] = 1;
+    document["seed"] = seed;
+    document["trials"] = statistics.empty() ? 0 : statistics.front().trials();
+    document["outputs"] = nlohmann::json::array();
+    for (size_t k = 0; k < statistics.size(); ++k)
+    {
+        const StatisticsSink &output = statistics[k];
+        static const char *const TYPES[] = {"empty", "scalar", "vector", "other"};
+        nlohmann::json periods = nlohmann::json::array();
+        if (output.kind() == StatisticsSink::Kind::Scalar || output.kind() == StatisticsSink::Kind::Vector)
+        {
+            for (const OutputStatistics &period : output.periods())
+            {
+                periods.push_back(distribution_to_json(period, bins));
+            }
+        }
+        document["outputs"].push_back({{"name", k < names.size() ? names[k] : "Result"},
+                                       {"type", TYPES[static_cast<size_t>(output.kind())]},
+                                       {"trials", output.trials()},
+                                       {"skipped", output.skipped_trials()},
+                                       {"periods", std::move(periods)}});
+    }
+    return document;
+}
+
+void write_summary(const std::string &path, const std::vector<std::string> &names, const std::vector<StatisticsSink> &statistics, uint64_t seed, size_t bins)
+{
+    if (!write_json_file(path, summary_to_json(names, statistics, seed, bins)))
+    {
+        throw EngineException(EngineErrc::OutputFileWriteFailed, "Could not write summary file '" + path + "'.");
+    }
+}
+
+SummaryResultWriter::SummaryResultWriter(std::string path, uint64_t seed, size_t bins) : m_path(std::move(path)), m_seed(seed), m_bins(bins) {}
+
+void SummaryResultWriter::set_outputs(const std::vector<std::string> &names)
+{
+    m_names = names;
+    m_statistics = std::vector<StatisticsSink>(names.size());
+}
+
+void SummaryResultWriter::consume(size_t first_trial, const TrialValue *results, size_t count)
+{
+    m_statistics[0].consume(first_trial, results, count);
+}
+
+void SummaryResultWriter::consume_outputs(size_t first_trial, const TrialValue *const *columns, size_t count)
+{
+    for (size_t k = 0; k < m_statistics.size(); ++k)
+    {
+        m_statistics[k].consume(first_trial, columns[k], count);
+    }
+}
+
+void SummaryResultWriter::finish()
+{
+    for (StatisticsSink &statistics : m_statistics)
+    {
+        statistics.finish();
+    }
+    if (!write_json_file(m_path, summary_to_json(m_names, m_statistics, m_seed, m_bins)))
+    {
+        std::cerr << "Warning: Could not write summary file '" << m_path << "'." << std::endl;
+    }
+}
+
+OutputFormat parse_output_format(const std::string &format, const std::string &path)
+{
+    if (format == "csv")
+    {
+        return OutputFormat::Csv;
+    }
+    if (format == "binary")
+    {
+        return OutputFormat::Binary;
+    }
+    if (format == "summary")
+    {
+        return OutputFormat::Summary;
+    }
+    if (format.empty())
+    {
+        auto ends_with = [&](const char *suffix)
+        {
+            const size_t size = std::strlen(suffix);
+            return path.size() >= size && path.compare(path.size() - size, size, suffix) == 0;
+        };
+        return ends_with(".bin") ? OutputFormat::Binary : ends_with(".json") ? OutputFormat::Summary
+                                                                               : OutputFormat::Csv;
+    }
+    throw EngineException(EngineErrc::RecipeConfigError, "Unknown output_format '" + format + "'. Expected 'csv', 'binary' or 'summary'.");
+}
+
+const char *output_format_name(OutputFormat format)
+{
+    switch (format)
+    {
+    case OutputFormat::Binary:
+        return "binary";
+    case OutputFormat::Summary:
+        return "summary";
+    default:
+        return "csv";
+    }
+}
+
+std::unique_ptr<ResultSink> make_result_writer(const std::string &path, OutputFormat format, uint64_t seed, size_t summary_bins)
+{
+    if (format == OutputFormat::Binary)
+    {
+        return std::make_unique<BinaryResultWriter>(path, seed);
+    }
+    if (format == OutputFormat::Summary)
+    {
+        return std::make_unique<SummaryResultWriter>(path, seed, summary_bins);
+    }
+    return std::make_unique<CsvResultWriter>(path);
+}
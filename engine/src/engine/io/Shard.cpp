@@ -0,0 +1,377 @@
+#include "include/engine/io/Shard.h"
+#include "include/engine/core/EngineException.h"
+#include "include/engine/core/ResultCache.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+using json = nlohmann::json;
+
+namespace
+{
+    constexpr int SHARD_FORMAT_VERSION = 1;
+    constexpr size_t MERGE_WINDOW = 1 << 16; // Trials copied from a shard's results at a time.
+
+    // JSON has no infinities or NaN; they are written as strings.
+    json number_to_json(double value)
+    {
+        if (std::isnan(value))
+            return "nan";
+        if (std::isinf(value))
+            return value > 0 ? "inf" : "-inf";
+        return value;
+    }
+
+    double number_from_json(const json &value)
+    {
+        if (value.is_string())
+        {
+            const std::string text = value.get<std::string>();
+            if (text == "inf")
+                return std::numeric_limits<double>::infinity();
+            if (text == "-inf")
+                return -std::numeric_limits<double>::infinity();
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return value.get<double>();
+    }
+
+    const char *kind_name(StatisticsSink::Kind kind)
+    {
+        switch (kind)
+        {
+        case StatisticsSink::Kind::Scalar:
+            return "scalar";
+        case StatisticsSink::Kind::Vector:
+            return "vector";
+        case StatisticsSink::Kind::Other:
+            return "other";
+        default:
+            return "empty";
+        }
+    }
+
+    StatisticsSink::Kind kind_from_name(const std::string &name)
+    {
+        if (name == "scalar")
+            return StatisticsSink::Kind::Scalar;
+        if (name == "vector")
+            return StatisticsSink::Kind::Vector;
+        if (name == "other")
+            return StatisticsSink::Kind::Other;
+        return StatisticsSink::Kind::Empty;
+    }
+
+    json statistics_to_json(const StatisticsSink &statistics)
+    {
+        json periods = json::array();
+        for (const OutputStatistics &period : statistics.periods())
+        {
+            const RunningStatistics &moments = period.moments;
+            json centroids = json::array();
+            for (const QuantileSketch::Centroid &centroid : period.quantiles.centroids())
+            {
+                centroids.push_back({number_to_json(centroid.mean), centroid.weight});
+            }
+            periods.push_back({{"moments", {{"count", moments.count}, {"mean", number_to_json(moments.mean)}, {"m2", number_to_json(moments.m2)}, {"m3", number_to_json(moments.m3)}, {"m4", number_to_json(moments.m4)}, {"min", number_to_json(moments.min)}, {"max", number_to_json(moments.max)}}},
+                               {"quantiles", {{"compression", period.quantiles.compression()}, {"min", number_to_json(period.quantiles.min())}, {"max", number_to_json(period.quantiles.max())}, {"centroids", std::move(centroids)}}}});
+        }
+        return {{"kind", kind_name(statistics.kind())}, {"trials", statistics.trials()}, {"skipped", statistics.skipped_trials()}, {"periods", std::move(periods)}};
+    }
+
+    void merge_statistics(const json &part, StatisticsSink &into)
+    {
+        std::vector<OutputStatistics> periods;
+        for (const json &period : part.at("periods"))
+        {
+            const json &moments = period.at("moments");
+            const json &quantiles = period.at("quantiles");
+            OutputStatistics statistics;
+            statistics.moments.count = moments.at("count").get<size_t>();
+            statistics.moments.mean = number_from_json(moments.at("mean"));
+            statistics.moments.m2 = number_from_json(moments.at("m2"));
+            statistics.moments.m3 = number_from_json(moments.at("m3"));
+            statistics.moments.m4 = number_from_json(moments.at("m4"));
+            statistics.moments.min = number_from_json(moments.at("min"));
+            statistics.moments.max = number_from_json(moments.at("max"));
+            std::vector<QuantileSketch::Centroid> centroids;
+            for (const json &centroid : quantiles.at("centroids"))
+            {
+                centroids.push_back({number_from_json(centroid.at(0)), centroid.at(1).get<double>()});
+            }
+            statistics.quantiles = QuantileSketch::from_centroids(std::move(centroids), number_from_json(quantiles.at("min")), number_from_json(quantiles.at("max")), quantiles.at("compression").get<double>());
+            periods.push_back(std::move(statistics));
+        }
+        into.merge(kind_from_name(part.at("kind").get<std::string>()), part.at("trials").get<size_t>(), part.at("skipped").get<size_t>(), periods);
+    }
+
+    std::string results_path_for(const std::string &shard_path)
+    {
+        return std::filesystem::path(shard_path).replace_extension(".bin").string();
+    }
+
+    struct ShardFile
+    {
+        std::string path;
+        ShardManifest manifest;
+        json statistics;
+    };
+
+    ShardFile read_shard_file(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            throw EngineException(EngineErrc::RecipeFileNotFound, "Could not open shard file '" + path + "'.");
+        }
+        try
+        {
+            const json document = json::parse(file);
+            if (document.value("format", "") != "vse-shard" || document.value("version", 0) != SHARD_FORMAT_VERSION)
+            {
+                throw EngineException(EngineErrc::RecipeParseError, "'" + path + "' is not a shard file of this version of vse.");
+            }
+            ShardFile shard{path, ShardManifest(), document.at("statistics")};
+            ShardManifest &manifest = shard.manifest;
+            manifest.recipe_hash = document.at("recipe").get<std::string>();
+            manifest.seed = document.at("seed").get<uint64_t>();
+            manifest.num_trials = document.at("num_trials").get<size_t>();
+            manifest.shard = {document.at("shard").get<size_t>(), document.at("shards").get<size_t>()};
+            manifest.range = {document.at("first_trial").get<size_t>(), document.at("trials").get<size_t>()};
+            manifest.outputs = document.at("outputs").get<std::vector<std::string>>();
+            manifest.output_file = document.at("output_file").get<std::string>();
+            manifest.output_format = parse_output_format(document.at("output_format").get<std::string>(), manifest.output_file);
+            manifest.summary_bins = document.value("summary_bins", DEFAULT_SUMMARY_BINS);
+            if (!document.at("results").is_null())
+            {
+                manifest.results_file = (std::filesystem::path(path).parent_path() / document.at("results").get<std::string>()).string();
+            }
+            if (shard.statistics.size() != manifest.outputs.size())
+            {
+                throw EngineException(EngineErrc::RecipeParseError, "Shard file '" + path + "' lacks the statistics of some outputs.");
+            }
+            return shard;
+        }
+        catch (const json::exception &e)
+        {
+            throw EngineException(EngineErrc::RecipeParseError, "Malformed shard file '" + path + "': " + e.what());
+        }
+    }
+
+    // The results of each shard, in trial order, into the recipe's output file.
+    void merge_results(const std::vector<ShardFile> &shards, const ShardManifest &run)
+    {
+        for (const ShardFile &shard : shards)
+        {
+            if (shard.manifest.range.count > 0 && shard.manifest.results_file.empty())
+            {
+                std::cerr << "Warning: Shard " << shard.manifest.shard.index << " wrote no results; not writing '" << run.output_file << "'." << std::endl;
+                return;
+            }
+        }
+        std::unique_ptr<ResultSink> writer = make_result_writer(run.output_file, run.output_format, run.seed);
+        writer->set_outputs(run.outputs);
+        writer->begin(run.num_trials);
+        std::vector<std::vector<TrialValue>> columns;
+        std::vector<const TrialValue *> pointers(run.outputs.size());
+        for (const ShardFile &shard : shards)
+        {
+            const TrialRange &range = shard.manifest.range;
+            if (range.count == 0)
+                continue;
+            BinaryResultReader reader(shard.manifest.results_file);
+            if (reader.num_trials() != range.count || reader.num_outputs() != std::max<size_t>(1, run.outputs.size()))
+            {
+                throw EngineException(EngineErrc::RecipeParseError, "Results file '" + shard.manifest.results_file + "' does not match shard file '" + shard.path + "'.");
+            }
+            for (size_t done = 0; done < range.count; done += MERGE_WINDOW)
+            {
+                const size_t count = std::min(MERGE_WINDOW, range.count - done);
+                reader.read(done, count, columns);
+                for (size_t k = 0; k < pointers.size(); ++k)
+                {
+                    pointers[k] = columns[k].data();
+                }
+                writer->consume_outputs(range.first + done, pointers.data(), count);
+            }
+        }
+        writer->finish();
+    }
+}
+
+std::optional<ShardSpec> parse_shard_spec(const std::string &text)
+{
+    const size_t slash = text.find('/');
+    if (slash == std::string::npos)
+        return std::nullopt;
+    ShardSpec shard;
+    const char *end = text.data() + text.size();
+    const auto index = std::from_chars(text.data(), text.data() + slash, shard.index);
+    const auto count = std::from_chars(text.data() + slash + 1, end, shard.count);
+    if (slash == 0 || index.ec != std::errc() || index.ptr != text.data() + slash || count.ec != std::errc() || count.ptr != end || shard.index >= shard.count)
+        return std::nullopt;
+    return shard;
+}
+
+TrialRange shard_range(const ShardSpec &shard, size_t num_trials)
+{
+    // The first num_trials % count shards take one trial more than the others.
+    const size_t base = num_trials / shard.count;
+    const size_t extra = num_trials % shard.count;
+    return {shard.index * base + std::min(shard.index, extra), base + (shard.index < extra ? 1 : 0)};
+}
+
+std::vector<StatisticsSink> run_shard(const SimulationEngine &engine, std::string_view recipe, const ShardSpec &shard, const std::string &path, const std::vector<ResultSink *> &extra_sinks)
+{
+    if (!engine.has_fixed_seed())
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "Sharded runs need a \"seed\" in the simulation_config, for every shard to draw from the same streams.");
+    }
+    ShardManifest manifest;
+    manifest.recipe_hash = ContentHasher().add(recipe).hex();
+    manifest.seed = engine.get_seed();
+    manifest.num_trials = engine.get_num_trials();
+    manifest.shard = shard;
+    manifest.range = shard_range(shard, manifest.num_trials);
+    manifest.outputs = engine.get_output_names();
+    manifest.output_file = engine.get_output_file_path();
+    manifest.output_format = engine.get_output_format();
+    manifest.summary_bins = engine.get_summary_bins();
+
+    std::vector<StatisticsSink> statistics(manifest.outputs.size());
+    std::vector<OutputColumnSink> statistics_columns;
+    std::vector<ResultSink *> sinks;
+    for (size_t k = 0; k < statistics.size(); ++k)
+    {
+        statistics_columns.emplace_back(statistics[k], k);
+    }
+    for (OutputColumnSink &column : statistics_columns)
+    {
+        sinks.push_back(&column);
+    }
+    // Results always go in binary, whatever the recipe's format; `vse merge` converts them. A
+    // summary is written from the merged statistics, so its shards keep no results.
+    const std::string results_path = results_path_for(path);
+    std::unique_ptr<BinaryResultWriter> writer;
+    if (!manifest.output_file.empty() && manifest.output_format != OutputFormat::Summary)
+    {
+        std::filesystem::remove(results_path);
+        writer = std::make_unique<BinaryResultWriter>(results_path, manifest.seed);
+        sinks.push_back(writer.get());
+    }
+    sinks.insert(sinks.end(), extra_sinks.begin(), extra_sinks.end());
+    RunOptions options;
+    options.range = manifest.range;
+    engine.run(options, sinks);
+    if (writer && std::filesystem::exists(results_path))
+    {
+        manifest.results_file = results_path;
+    }
+
+    json document;
+    document["format"] = "vse-shard";
+    document["version"] = SHARD_FORMAT_VERSION;
+    document["recipe"] = manifest.recipe_hash;
+    document["seed"] = manifest.seed;
+    document["num_trials"] = manifest.num_trials;
+    document["shard"] = shard.index;
+    document["shards"] = shard.count;
+    document["first_trial"] = manifest.range.first;
+    document["trials"] = manifest.range.count;
+    document["outputs"] = manifest.outputs;
+    document["output_file"] = manifest.output_file;
+    document["output_format"] = output_format_name(manifest.output_format);
+    document["summary_bins"] = manifest.summary_bins;
+    document["results"] = manifest.results_file.empty() ? json() : json(std::filesystem::path(results_path).filename().string());
+    document["statistics"] = json::array();
+    for (const StatisticsSink &output : statistics)
+    {
+        document["statistics"].push_back(statistics_to_json(output));
+    }
+    std::ofstream file(path);
+    if (!(file << document.dump() << '\n'))
+    {
+        throw EngineException(EngineErrc::OutputFileWriteFailed, "Could not write shard file '" + path + "'.");
+    }
+    return statistics;
+}
+
+MergedShards merge_shards(const std::vector<std::string> &paths)
+{
+    if (paths.empty())
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "No shard files to merge.");
+    }
+    std::vector<ShardFile> shards;
+    for (const std::string &path : paths)
+    {
+        shards.push_back(read_shard_file(path));
+    }
+    std::sort(shards.begin(), shards.end(), [](const ShardFile &a, const ShardFile &b)
+              { return a.manifest.shard.index < b.manifest.shard.index; });
+
+    MergedShards merged;
+    ShardManifest &run = merged.run;
+    run = shards.front().manifest;
+    run.shard = {0, run.shard.count};
+    run.range = {0, run.num_trials};
+    run.results_file.clear();
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+        const ShardManifest &manifest = shards[i].manifest;
+        if (manifest.recipe_hash != run.recipe_hash || manifest.seed != run.seed || manifest.num_trials != run.num_trials || manifest.shard.count != run.shard.count ||
+            manifest.outputs != run.outputs || manifest.output_file != run.output_file || manifest.output_format != run.output_format)
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "Shard file '" + shards[i].path + "' belongs to another run than '" + shards.front().path + "'.");
+        }
+        if (manifest.shard.index != i)
+        {
+            throw EngineException(EngineErrc::RecipeConfigError, "Shard " + std::to_string(i < manifest.shard.index ? i : manifest.shard.index) + " of " + std::to_string(run.shard.count) +
+                                                                     (i < manifest.shard.index ? " is missing." : " is given more than once."));
+        }
+        const TrialRange expected = shard_range(manifest.shard, run.num_trials);
+        if (manifest.range.first != expected.first || manifest.range.count != expected.count)
+        {
+            throw EngineException(EngineErrc::RecipeParseError, "Shard file '" + shards[i].path + "' covers other trials than shard " + std::to_string(i) + " should.");
+        }
+    }
+    if (shards.size() != run.shard.count)
+    {
+        throw EngineException(EngineErrc::RecipeConfigError, "Shard " + std::to_string(shards.size()) + " of " + std::to_string(run.shard.count) + " is missing.");
+    }
+
+    merged.statistics = std::vector<StatisticsSink>(run.outputs.size());
+    for (const ShardFile &shard : shards)
+    {
+        try
+        {
+            for (size_t k = 0; k < run.outputs.size(); ++k)
+            {
+                merge_statistics(shard.statistics[k], merged.statistics[k]);
+            }
+        }
+        catch (const json::exception &e)
+        {
+            throw EngineException(EngineErrc::RecipeParseError, "Malformed statistics in shard file '" + shard.path + "': " + e.what());
+        }
+    }
+    for (StatisticsSink &statistics : merged.statistics)
+    {
+        statistics.finish();
+    }
+    if (!run.output_file.empty() && run.output_format == OutputFormat::Summary)
+    {
+        write_summary(run.output_file, run.outputs, merged.statistics, run.seed, run.summary_bins);
+    }
+    else if (!run.output_file.empty())
+    {
+        merge_results(shards, run);
+    }
+    return merged;
+}
@@ -1,5 +1,9 @@
 #include "include/engine/core/SimulationEngine.h"
 #include "include/engine/io/io.h"
+#include "include/engine/io/ResultSink.h"
+#include "include/engine/io/EngineServer.h"
+#include "include/engine/io/Progress.h"
+#include "include/engine/io/Shard.h"
 #include "include/engine/core/EngineException.h"
 #include <iostream>
 #include <vector>
@@ -8,10 +12,19 @@
 #include <algorithm>
 #include <cmath>
 #include <variant>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <optional>
+#include <memory>
 
-void print_statistics(const std::vector<TrialValue> &results);
+void print_statistics(const StatisticsSink &statistics);
+void print_sensitivity(const SensitivityReport &report);
+void print_output_statistics(const std::vector<StatisticsSink> &statistics, const std::vector<std::string> &output_names);
 
 struct TrialValueToJsonVisitor
 {
@@ -21,89 +34,235 @@ struct TrialValueToJsonVisitor
     nlohmann::json operator()(bool b) const { return b; }
 };
 
-void run_preview_mode(const std::string &recipe_path)
+std::optional<size_t> parse_count(const std::string &text)
 {
-    SimulationEngine engine(recipe_path, true);
-    std::vector<TrialValue> results = engine.run();
-
-    if (results.empty())
+    size_t value = 0;
+    const char *end = text.data() + text.size();
+    const auto result = std::from_chars(text.data(), end, value);
+    if (result.ec != std::errc() || result.ptr != end)
     {
-        nlohmann::json error_json;
-        error_json["status"] = "error";
-        error_json["message"] = "No results were generated.";
-        std::cout << error_json.dump() << std::endl;
-        return;
+        return std::nullopt;
     }
+    return value;
+}
 
-    nlohmann::json output_json;
-    output_json["status"] = "success";
-
-    std::visit(
-        [&](auto &&first_result)
+// `--progress` redraws a bar on stderr; `--progress-fd N` writes progress_to_json() lines to
+// the already open file descriptor N, e.g. a pipe of the process that started vse.
+std::unique_ptr<ProgressReporter> start_progress_reporter(const ProgressSink &progress, bool bar, std::optional<size_t> fd, std::chrono::milliseconds interval)
+{
+    std::FILE *lines = nullptr;
+    if (fd)
+    {
+#ifdef _WIN32
+        lines = _fdopen(static_cast<int>(*fd), "w");
+#else
+        lines = fdopen(static_cast<int>(*fd), "w");
+#endif
+        if (!lines)
         {
-            using T = std::decay_t<decltype(first_result)>;
-            if constexpr (std::is_same_v<T, double>)
-            {
-                output_json["type"] = "scalar";
-                double sum = 0.0;
-                for (const auto &res : results)
-                {
-                    sum += std::get<double>(res);
-                }
-                output_json["value"] = std::round((sum / results.size()) * 10000.0) / 10000.0;
-            }
-            else if constexpr (std::is_same_v<T, std::vector<double>>)
-            {
-                output_json["type"] = "vector";
-                const auto &original_vec = std::get<std::vector<double>>(results[0]);
-                std::vector<double> rounded_vec;
-                rounded_vec.reserve(original_vec.size());
-                for (const auto &val : original_vec)
-                {
-                    rounded_vec.push_back(std::round(val * 10000.0) / 10000.0);
-                }
-                output_json["value"] = rounded_vec;
-            }
-            else if constexpr (std::is_same_v<T, bool>)
-            {
-                output_json["type"] = "boolean";
-                output_json["value"] = std::get<bool>(results[0]);
-            }
-            else if constexpr (std::is_same_v<T, std::string>)
-            {
-                output_json["type"] = "string";
-                output_json["value"] = std::get<std::string>(results[0]);
-            }
-        },
-        results[0]);
+            throw EngineException(EngineErrc::RecipeConfigError, "Cannot write progress to file descriptor " + std::to_string(*fd) + ".");
+        }
+    }
+    auto width = std::make_shared<size_t>(0);
+    return std::make_unique<ProgressReporter>(progress, interval, [bar, lines, width](const ProgressSnapshot &snapshot, bool last)
+                                              {
+        if (bar)
+        {
+            // Pads over the rest of a longer previous line.
+            std::string line = format_progress_bar(snapshot);
+            const size_t length = line.size();
+            line.resize(std::max(length, *width), ' ');
+            *width = length;
+            std::cerr << '\r' << line << (last ? "\n" : "") << std::flush;
+        }
+        if (lines)
+        {
+            const std::string json_line = progress_to_json(snapshot).dump() + "\n";
+            std::fputs(json_line.c_str(), lines);
+            std::fflush(lines);
+            if (last)
+                std::fclose(lines);
+        } });
+}
 
-    std::cout << output_json.dump() << std::endl;
+// Previews skip the thread pool and stop sampling once the mean has settled; see
+// SimulationEngine::preview().
+void run_preview_mode(const std::string &recipe_path)
+{
+    SimulationEngine engine(recipe_path, true);
+    std::cout << preview_to_json(engine.preview()).dump() << std::endl;
 }
 
-int main(int argc, char *argv[])
+// `vse merge <shard files...>`: the statistics and output file of the run the shards split.
+int run_merge_mode(const std::vector<std::string> &paths)
 {
-    if (argc < 2)
+    try
     {
-        std::cerr << "Usage: " << argv[0] << " [--preview] <path_to_recipe.json>" << std::endl;
+        const MergedShards merged = merge_shards(paths);
+        std::cout << "Merged " << merged.run.shard.count << " shard(s): " << merged.run.num_trials << " trials, seed " << merged.run.seed << "." << std::endl;
+        print_output_statistics(merged.statistics, merged.run.outputs);
+        std::cout << "\nExecution finished." << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "An error occurred: " << e.what() << std::endl;
         return 1;
     }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string usage = std::string("Usage: ") + argv[0] + " [--preview | --sensitivity] [--threads N] [--chunk-size N] [--pin-threads [--replicate-inputs]] [--device cpu|host|jit|cuda | --jit] [--profile] [--trace <trace.json>] [--progress] [--progress-fd N] [--progress-interval MS] [--shard I/N [--shard-file <shard.json>]] <path_to_recipe.json>\n       " + argv[0] + " --serve [--threads N] [--chunk-size N] [--pin-threads [--replicate-inputs]] [--device cpu|host|jit|cuda | --jit]\n       " + argv[0] + " merge <shard.json>...";
+
+    if (argc > 1 && std::string(argv[1]) == "merge")
+    {
+        if (argc == 2)
+        {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+        return run_merge_mode(std::vector<std::string>(argv + 2, argv + argc));
+    }
 
     std::string recipe_path;
     bool preview_mode = false;
+    bool sensitivity_mode = false;
+    bool serve_mode = false;
+    std::optional<size_t> threads_override;
+    std::optional<size_t> chunk_size_override;
+    bool pin_threads = false;
+    bool replicate_inputs = false;
+    bool profile = false;
+    std::string trace_path;
+    bool progress_bar = false;
+    std::optional<size_t> progress_fd;
+    std::optional<size_t> progress_interval;
+    std::optional<ShardSpec> shard;
+    std::string shard_path;
+    std::optional<std::string> device;
 
-    if (argc == 3 && std::string(argv[1]) == "--preview")
+    for (int i = 1; i < argc; ++i)
     {
-        preview_mode = true;
-        recipe_path = argv[2];
+        const std::string arg = argv[i];
+        if (arg == "--preview")
+        {
+            preview_mode = true;
+        }
+        else if (arg == "--sensitivity")
+        {
+            sensitivity_mode = true;
+        }
+        else if (arg == "--serve")
+        {
+            serve_mode = true;
+        }
+        else if ((arg == "--threads" || arg == "--chunk-size" || arg == "--progress-fd" || arg == "--progress-interval") && i + 1 < argc)
+        {
+            const std::optional<size_t> value = parse_count(argv[++i]);
+            if (!value || (arg == "--progress-interval" && *value == 0))
+            {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                return 1;
+            }
+            if (arg == "--threads")
+                threads_override = value;
+            else if (arg == "--chunk-size")
+                chunk_size_override = value;
+            else if (arg == "--progress-fd")
+                progress_fd = value;
+            else
+                progress_interval = value;
+        }
+        else if (arg == "--pin-threads")
+        {
+            pin_threads = true;
+        }
+        else if (arg == "--replicate-inputs")
+        {
+            replicate_inputs = true;
+        }
+        else if (arg == "--progress")
+        {
+            progress_bar = true;
+        }
+        else if (arg == "--profile")
+        {
+            profile = true;
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            trace_path = argv[++i];
+        }
+        else if (arg == "--shard" && i + 1 < argc)
+        {
+            shard = parse_shard_spec(argv[++i]);
+            if (!shard)
+            {
+                std::cerr << "Invalid value for --shard: " << argv[i] << " (expected I/N with 0 <= I < N)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--shard-file" && i + 1 < argc)
+        {
+            shard_path = argv[++i];
+        }
+        else if (arg == "--device" && i + 1 < argc)
+        {
+            device = argv[++i];
+        }
+        else if (arg == "--jit")
+        {
+            device = "jit";
+        }
+        else if (recipe_path.empty() && arg.rfind("--", 0) != 0)
+        {
+            recipe_path = arg;
+        }
+        else
+        {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
     }
-    else if (argc == 2)
+    // Only plain runs are profiled and report their progress.
+    const bool profiling = profile || !trace_path.empty();
+    const bool reports_progress = progress_bar || progress_fd;
+    if ((preview_mode && sensitivity_mode) || (serve_mode ? preview_mode || sensitivity_mode || !recipe_path.empty() : recipe_path.empty()) ||
+        ((profiling || reports_progress) && (preview_mode || sensitivity_mode || serve_mode)) ||
+        (shard && (preview_mode || sensitivity_mode || serve_mode || profiling)) || (!shard && !shard_path.empty()))
     {
-        recipe_path = argv[1];
+        std::cerr << usage << std::endl;
+        return 1;
     }
-    else
+
+    // Command-line scheduling and device options take precedence over the recipe's simulation_config.
+    auto apply_scheduler_overrides = [&](SimulationEngine &engine)
     {
-        std::cerr << "Usage: " << argv[0] << " [--preview] <path_to_recipe.json>" << std::endl;
-        return 1;
+        SchedulerConfig config = engine.get_scheduler_config();
+        if (threads_override)
+            config.threads = *threads_override;
+        if (chunk_size_override)
+            config.chunk_size = *chunk_size_override;
+        if (pin_threads)
+            config.pin_threads = true;
+        if (replicate_inputs)
+            config.replicate_inputs = true;
+        engine.set_scheduler_config(config);
+        if (device)
+            engine.set_device(*device);
+    };
+
+    if (serve_mode)
+    {
+        // Responses are the only output on stdout; progress messages of the engine and the
+        // result writers go to stderr instead.
+        std::ostream responses(std::cout.rdbuf());
+        std::cout.rdbuf(std::cerr.rdbuf());
+        EngineServer server(apply_scheduler_overrides);
+        server.serve(std::cin, responses);
+        std::cout.rdbuf(responses.rdbuf());
+        return 0;
     }
 
     try
@@ -112,16 +271,77 @@ int main(int argc, char *argv[])
         {
             run_preview_mode(recipe_path);
         }
+        else if (sensitivity_mode)
+        {
+            SimulationEngine engine(recipe_path);
+            apply_scheduler_overrides(engine);
+            if (!engine.has_sensitivity_inputs())
+            {
+                std::cerr << "The recipe lists no \"sensitivity\" inputs in its simulation_config." << std::endl;
+                return 1;
+            }
+            print_sensitivity(engine.run_sensitivity());
+            std::cout << "\nExecution finished." << std::endl;
+        }
+        else if (shard)
+        {
+            // Shard files default to "<recipe>.shard-I-of-N.json" in the working directory.
+            if (shard_path.empty())
+            {
+                shard_path = std::filesystem::path(recipe_path).stem().string() + ".shard-" + std::to_string(shard->index) + "-of-" + std::to_string(shard->count) + ".json";
+            }
+            SimulationEngine engine(recipe_path);
+            apply_scheduler_overrides(engine);
+            ProgressSink progress;
+            std::unique_ptr<ProgressReporter> reporter;
+            if (reports_progress)
+            {
+                reporter = start_progress_reporter(progress, progress_bar, progress_fd, std::chrono::milliseconds(progress_interval.value_or(500)));
+            }
+            const std::string recipe = SimulationEngine::read_recipe_file(recipe_path);
+            const std::vector<StatisticsSink> statistics = run_shard(engine, recipe, *shard, shard_path, reporter ? std::vector<ResultSink *>{&progress} : std::vector<ResultSink *>());
+            reporter.reset();
+            const TrialRange range = shard_range(*shard, engine.get_num_trials());
+            std::cout << "\nShard " << shard->index << "/" << shard->count << ": trials " << range.first << " to " << range.first + range.count
+                      << " of " << engine.get_num_trials() << ", written to '" << shard_path << "'." << std::endl;
+            print_output_statistics(statistics, engine.get_output_names());
+            std::cout << "\nExecution finished." << std::endl;
+        }
         else
         {
             SimulationEngine engine(recipe_path);
-            std::vector<TrialValue> results = engine.run();
-            print_statistics(results);
-
-            std::string output_path = engine.get_output_file_path();
-            if (!output_path.empty())
+            apply_scheduler_overrides(engine);
+            engine.set_profiling(profiling);
+            RunReport report;
+            ProgressSink progress;
+            std::unique_ptr<ProgressReporter> reporter;
+            if (reports_progress)
             {
-                write_results_to_csv(output_path, results);
+                reporter = start_progress_reporter(progress, progress_bar, progress_fd, std::chrono::milliseconds(progress_interval.value_or(500)));
+            }
+            const std::vector<StatisticsSink> statistics = run_with_statistics(engine, &report, reporter ? std::vector<ResultSink *>{&progress} : std::vector<ResultSink *>());
+            reporter.reset();
+            if (engine.get_precision_target().enabled())
+            {
+                std::cout << "\nTrials used: " << report.trials << " in " << report.rounds << " round(s); "
+                          << (report.converged ? "precision target met" : "max_trials reached before the precision target")
+                          << " (standard error " << report.standard_error << ")" << std::endl;
+            }
+            print_output_statistics(statistics, engine.get_output_names());
+            if (profile)
+            {
+                engine.get_profile()->print_report(std::cout);
+            }
+            if (!trace_path.empty())
+            {
+                std::ofstream trace(trace_path);
+                if (!trace)
+                {
+                    std::cerr << "Could not write the trace to '" << trace_path << "'." << std::endl;
+                    return 1;
+                }
+                engine.get_profile()->write_chrome_trace(trace);
+                std::cout << "Trace written to '" << trace_path << "'." << std::endl;
             }
             std::cout << "\nExecution finished." << std::endl;
         }
@@ -160,80 +380,78 @@ int main(int argc, char *argv[])
     return 0;
 }
 
-void print_statistics(const std::vector<TrialValue> &results)
+void print_output_statistics(const std::vector<StatisticsSink> &statistics, const std::vector<std::string> &output_names)
+{
+    for (size_t k = 0; k < statistics.size(); ++k)
+    {
+        if (statistics.size() > 1)
+        {
+            std::cout << "\n=== Output: " << output_names[k] << " ===" << std::endl;
+        }
+        print_statistics(statistics[k]);
+    }
+}
+
+void print_statistics(const StatisticsSink &statistics)
 {
-    if (results.empty())
+    if (statistics.trials() == 0)
     {
         std::cout << "No simulation data to analyze." << std::endl;
         return;
     }
 
-    std::visit([&](auto &&first_result)
-               {
-        using T = std::decay_t<decltype(first_result)>;
-        if constexpr (std::is_same_v<T, double>) {
-            std::cout << "\n--- SCALAR Simulation Statistics ---" << std::endl;
-            std::vector<double> scalar_data;
-            scalar_data.reserve(results.size());
-            for(const auto& res : results) {
-                scalar_data.push_back(std::get<double>(res));
-            }
-
-            double sum = std::accumulate(scalar_data.begin(), scalar_data.end(), 0.0);
-            double mean = sum / scalar_data.size();
-            double sum_of_squares = 0.0;
-            for (double val : scalar_data) {
-                sum_of_squares += (val - mean) * (val - mean);
-            }
-            double stddev = std::sqrt(sum_of_squares / scalar_data.size());
-            double min_value = *std::min_element(scalar_data.begin(), scalar_data.end());
-            double max_value = *std::max_element(scalar_data.begin(), scalar_data.end());
-
-            std::cout << "Trials:     " << scalar_data.size() << std::endl;
-            std::cout << "Mean:       " << mean << std::endl;
-            std::cout << "Std. Dev:   " << stddev << std::endl;
-            std::cout << "Min Value:  " << min_value << std::endl;
-            std::cout << "Max Value:  " << max_value << std::endl;
-        }
-        else if constexpr (std::is_same_v<T, std::vector<double>>) {
-            std::cout << "\n--- VECTOR Simulation Statistics ---" << std::endl;
-            if (first_result.empty()) {
-                std::cout << "Result vectors are empty." << std::endl;
-                return;
-            }
-            size_t num_periods = first_result.size();
-            std::vector<double> mean_vector(num_periods, 0.0);
-            std::vector<double> stddev_vector(num_periods, 0.0);
-
-            for (const auto& res_variant : results) {
-                const auto& vec = std::get<std::vector<double>>(res_variant);
-                if (vec.size() != num_periods) {
-                    std::cerr << "Warning: Inconsistent vector sizes in results. Skipping." << std::endl;
-                    continue;
-                }
-                for (size_t i = 0; i < num_periods; ++i) {
-                    mean_vector[i] += vec[i];
-                }
-            }
-            for (size_t i = 0; i < num_periods; ++i) {
-                mean_vector[i] /= results.size();
-            }
-
-            for (const auto& res_variant : results) {
-                const auto& vec = std::get<std::vector<double>>(res_variant);
-                 if (vec.size() != num_periods) continue;
-                for (size_t i = 0; i < num_periods; ++i) {
-                    stddev_vector[i] += (vec[i] - mean_vector[i]) * (vec[i] - mean_vector[i]);
-                }
-            }
-            for (size_t i = 0; i < num_periods; ++i) {
-                stddev_vector[i] = std::sqrt(stddev_vector[i] / results.size());
-            }
+    const auto &periods = statistics.periods();
+    if (statistics.kind() == StatisticsSink::Kind::Scalar)
+    {
+        const RunningStatistics &stats = periods[0].moments;
+        std::cout << "\n--- SCALAR Simulation Statistics ---" << std::endl;
+        std::cout << "Trials:     " << stats.count << std::endl;
+        std::cout << "Mean:       " << stats.mean << std::endl;
+        std::cout << "Std. Dev:   " << stats.stddev() << std::endl;
+        std::cout << "Skewness:   " << stats.skewness() << std::endl;
+        std::cout << "Kurtosis:   " << stats.kurtosis() << std::endl;
+        std::cout << "Min Value:  " << stats.min << std::endl;
+        std::cout << "Max Value:  " << stats.max << std::endl;
+        for (double q : REPORTED_PERCENTILES)
+        {
+            std::string label = "P" + std::to_string(static_cast<int>(q * 100 + 0.5)) + ":";
+            label.resize(12, ' ');
+            std::cout << label << periods[0].quantiles.quantile(q) << std::endl;
+        }
+    }
+    else if (statistics.kind() == StatisticsSink::Kind::Vector)
+    {
+        std::cout << "\n--- VECTOR Simulation Statistics ---" << std::endl;
+        if (periods.empty())
+        {
+            std::cout << "Result vectors are empty." << std::endl;
+            return;
+        }
+        if (statistics.skipped_trials() > 0)
+        {
+            std::cerr << "Warning: Inconsistent vector sizes in results. Skipping." << std::endl;
+        }
+        std::cout << "Trials: " << statistics.trials() << ", Periods per trial: " << periods.size() << std::endl;
+        for (size_t i = 0; i < periods.size(); ++i)
+        {
+            const OutputStatistics &period = periods[i];
+            std::cout << "  Period " << i + 1 << ": Mean = " << period.moments.mean
+                      << ", Std. Dev = " << period.moments.stddev()
+                      << ", P5 = " << period.quantiles.quantile(0.05)
+                      << ", P50 = " << period.quantiles.quantile(0.50)
+                      << ", P95 = " << period.quantiles.quantile(0.95) << std::endl;
+        }
+    }
+}
 
-            std::cout << "Trials: " << results.size() << ", Periods per trial: " << num_periods << std::endl;
-            for (size_t i = 0; i < num_periods; ++i) {
-                std::cout << "  Period " << i + 1 << ": Mean = " << mean_vector[i] 
-                          << ", Std. Dev = " << stddev_vector[i] << std::endl;
-            }
-        } }, results[0]);
-}
\ No newline at end of file
+void print_sensitivity(const SensitivityReport &report)
+{
+    std::cout << "\n--- Sensitivity of the Mean (" << report.trials << " trials per variant) ---" << std::endl;
+    std::cout << "Base mean: " << report.base.moments.mean << std::endl;
+    for (const SensitivityBar &bar : report.bars)
+    {
+        std::cout << "  " << bar.name << " [" << bar.input.low << ", " << bar.input.high << "]: "
+                  << bar.at_low.moments.mean << " .. " << bar.at_high.moments.mean
+                  << " (swing " << bar.swing() << ")" << std::endl;
+    }
+}
@@ -0,0 +1,217 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/BatchedProgram.h"
+#include "include/engine/core/ExecutionSteps.h"
+#include "include/engine/functions/core/operations.h"
+#include "include/engine/functions/series/operations.h"
+
+class BatchedProgramTest : public FileCleanupTest
+{
+protected:
+    void SetUp() override
+    {
+        FileCleanupTest::SetUp();
+        register_core_functions(m_registry);
+        register_series_functions(m_registry);
+    }
+
+    std::unique_ptr<IExecutionStep> make_call(std::vector<size_t> results, const std::string &function, int line, const std::string &args_json)
+    {
+        const auto &factory = m_registry.get_factory_map();
+        return std::make_unique<ExecutionAssignmentStep>(
+            std::move(results), function, line, factory.at(function)(), nlohmann::json::parse(args_json), factory);
+    }
+
+    FunctionRegistry m_registry;
+};
+
+TEST_F(BatchedProgramTest, MatchesScalarInterpreterAcrossPartialBlocks)
+{
+    // lane_width 0 forces the scalar interpreter; 7 does not divide 100 trials evenly.
+    const std::string steps = R"(
+        "variable_registry": ["x", "big", "result"],
+        "per_trial_steps": [
+            {"type": "literal_assignment", "result": 0, "value": 12.5},
+            {"type": "execution_assignment", "result": [1], "function": "__gt__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 10}]},
+            {"type": "conditional_assignment", "result": 2,
+                "condition": {"type": "variable_index", "value": 1},
+                "then_expr": {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "execution_assignment", "function": "log", "args": [{"type": "scalar_literal", "value": 8}]}]},
+                "else_expr": {"type": "scalar_literal", "value": -1}
+            }
+        ]
+    )";
+    create_test_recipe("scalar.json", R"({"simulation_config": {"num_trials": 100, "lane_width": 0}, "output_variable_index": 2,)" + steps + "}");
+    create_test_recipe("batched.json", R"({"simulation_config": {"num_trials": 100, "lane_width": 7}, "output_variable_index": 2,)" + steps + "}");
+
+    auto expected = SimulationEngine("scalar.json").run();
+    auto actual = SimulationEngine("batched.json").run();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        EXPECT_DOUBLE_EQ(std::get<double>(actual[i]), std::get<double>(expected[i]));
+    }
+}
+
+TEST_F(BatchedProgramTest, SplitsLanesAtVaryingConditions)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 2000, "lane_width": 64}, "output_variable_index": 2, "variable_registry": ["u", "high", "result"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+            {"type": "execution_assignment", "result": [1], "function": "__gt__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0.5}]},
+            {"type": "conditional_assignment", "result": 2,
+                "condition": {"type": "variable_index", "value": 1},
+                "then_expr": {"type": "execution_assignment", "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 10}]},
+                "else_expr": {"type": "execution_assignment", "function": "subtract", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 10}]}
+            }
+        ]
+    })";
+    create_test_recipe("recipe.json", recipe);
+    SimulationEngine engine("recipe.json");
+    auto results = engine.run();
+    ASSERT_EQ(results.size(), 2000u);
+    size_t high = 0;
+    for (const auto &result : results)
+    {
+        const double value = std::get<double>(result);
+        if (value > 0)
+        {
+            EXPECT_GT(value, 10.5);
+            EXPECT_LE(value, 11.0);
+            ++high;
+        }
+        else
+        {
+            EXPECT_GE(value, -10.0);
+            EXPECT_LE(value, -9.5);
+        }
+    }
+    EXPECT_GT(high, 800u);
+    EXPECT_LT(high, 1200u);
+}
+
+TEST_F(BatchedProgramTest, PredicatedBranchesMatchTheScalarInterpreter)
+{
+    // 'covenant' has two cheap arms; 'x' has a cheap arm and an expensive one that reads the
+    // destination itself; 'nested' blends inside an expression.
+    const std::string steps = R"(
+        "output_variable_indices": [2, 0, 3], "variable_registry": ["x", "breach", "covenant", "nested"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 2}]},
+            {"type": "execution_assignment", "result": [1], "function": "__gt__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+            {"type": "conditional_assignment", "result": 2, "condition": {"type": "variable_index", "value": 1},
+                "then_expr": {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 3}]},
+                "else_expr": {"type": "execution_assignment", "function": "subtract", "args": [{"type": "scalar_literal", "value": 0.5}, {"type": "variable_index", "value": 0}]}},
+            {"type": "conditional_assignment", "result": 0, "condition": {"type": "variable_index", "value": 1},
+                "then_expr": {"type": "scalar_literal", "value": 1},
+                "else_expr": {"type": "execution_assignment", "function": "exp", "args": [{"type": "variable_index", "value": 0}]}},
+            {"type": "execution_assignment", "result": [3], "function": "add", "args": [
+                {"type": "variable_index", "value": 0},
+                {"type": "conditional_expression", "condition": {"type": "variable_index", "value": 1},
+                    "then_expr": {"type": "execution_assignment", "function": "subtract", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+                    "else_expr": {"type": "execution_assignment", "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]}}]}
+        ]
+    )";
+    create_test_recipe("scalar.json", R"({"simulation_config": {"num_trials": 500, "seed": 5, "lane_width": 0},)" + steps + "}");
+    create_test_recipe("batched.json", R"({"simulation_config": {"num_trials": 500, "seed": 5, "lane_width": 48},)" + steps + "}");
+    SimulationEngine batched("batched.json");
+    EXPECT_EQ(batched.get_predicated_branch_count(), 4u);
+    EXPECT_EQ(batched.run_outputs(), SimulationEngine("scalar.json").run_outputs());
+}
+
+TEST_F(BatchedProgramTest, PredicatesOnlyCheapBranches)
+{
+    auto condition = make_call({1}, "__gt__", 1, R"([{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0}])");
+    const auto &factory = m_registry.get_factory_map();
+    auto conditional = std::make_unique<ConditionalAssignmentStep>(
+        2, 2, nlohmann::json::parse(R"({"type": "variable_index", "value": 1})"),
+        nlohmann::json::parse(R"({"type": "execution_assignment", "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 1}]})"),
+        nlohmann::json::parse(R"({"type": "execution_assignment", "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 0}]})"),
+        factory);
+    BytecodeBuilder builder(3);
+    builder.add_step(*condition);
+    builder.add_step(*conditional);
+    BytecodeProgram program = builder.finish();
+    TrialContext context = {TrialValue(1.0), TrialValue(false), TrialValue(0.0)};
+
+    // 'divide' can fail on the lanes that do not take its branch, so only 'add' runs on every lane.
+    auto batched = BatchedProgram::compile(program, context, {2}, 64, nullptr, [&](const std::string &name)
+                                           { return m_registry.is_cheap(name); });
+    ASSERT_NE(batched, nullptr);
+    EXPECT_EQ(batched->predicated_branches(), 1u);
+    EXPECT_EQ(BatchedProgram::compile(program, context, 2, 64)->predicated_branches(), 0u);
+}
+
+TEST_F(BatchedProgramTest, SkipsErrorsInBranchesNoLaneTakes)
+{
+    // Only lanes with x == 0 would divide by zero; none of them reach the division.
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 50, "lane_width": 16}, "output_variable_index": 1, "variable_registry": ["x", "result"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 2}]},
+            {"type": "conditional_assignment", "result": 1,
+                "condition": {"type": "execution_assignment", "function": "__eq__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0}]},
+                "then_expr": {"type": "execution_assignment", "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 0}]},
+                "else_expr": {"type": "variable_index", "value": 0}
+            }
+        ]
+    })";
+    create_test_recipe("recipe.json", recipe);
+    SimulationEngine engine("recipe.json");
+    auto results = engine.run();
+    ASSERT_EQ(results.size(), 50u);
+    for (const auto &result : results)
+    {
+        EXPECT_GE(std::get<double>(result), 1.0);
+    }
+}
+
+TEST_F(BatchedProgramTest, PreservesErrorContext)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 10}, "output_variable_index": 1, "variable_registry": ["x", "result"],
+        "per_trial_steps": [
+            {"type": "literal_assignment", "result": 0, "value": 0},
+            {"type": "execution_assignment", "line": 4, "result": [1], "function": "add", "args": [
+                {"type": "scalar_literal", "value": 1},
+                {"type": "execution_assignment", "line": 4, "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 0}]}
+            ]}
+        ]
+    })";
+    create_test_recipe("recipe.json", recipe);
+    SimulationEngine engine("recipe.json");
+    try
+    {
+        engine.run();
+        FAIL() << "Expected a division by zero error.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::DivisionByZero);
+        EXPECT_EQ(std::string(e.what()), "L4: In function 'add': L4: In nested function 'divide': Division by zero");
+    }
+}
+
+TEST_F(BatchedProgramTest, DeclinesProgramsWithVectorValues)
+{
+    auto step = make_call({1}, "grow_series", 1, R"([{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0.1}, {"type": "scalar_literal", "value": 3}])");
+    BytecodeBuilder builder(2);
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+
+    TrialContext context = {TrialValue(100.0), TrialValue(0.0)};
+    EXPECT_EQ(BatchedProgram::compile(program, context, 1, 64), nullptr);
+}
+
+TEST_F(BatchedProgramTest, DeclinesReadsBeforeAssignment)
+{
+    // Slot 1 is read by the first step but only assigned by the second.
+    auto first = make_call({0}, "add", 1, R"([{"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 1}])");
+    auto second = make_call({1}, "add", 2, R"([{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 1}])");
+    BytecodeBuilder builder(2);
+    builder.add_step(*first);
+    builder.add_step(*second);
+    BytecodeProgram program = builder.finish();
+
+    TrialContext context = {TrialValue(0.0), TrialValue(0.0)};
+    EXPECT_EQ(BatchedProgram::compile(program, context, 0, 64), nullptr);
+}
@@ -0,0 +1,108 @@
+#include "test/test_helpers.h"
+#include <nlohmann/json.hpp>
+#include <cstring>
+
+using json = nlohmann::json;
+
+class BinaryRecipeTest : public FileCleanupTest
+{
+protected:
+    void TearDown() override
+    {
+        std::remove("recipe.vsr");
+        FileCleanupTest::TearDown();
+    }
+
+    static json::binary_t pack(const std::vector<double> &values)
+    {
+        std::vector<std::uint8_t> bytes;
+        for (double value : values)
+        {
+            uint64_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            for (size_t b = 0; b < sizeof(bits); ++b)
+            {
+                bytes.push_back(static_cast<std::uint8_t>(bits >> (8 * b)));
+            }
+        }
+        return json::binary_t(bytes);
+    }
+
+    static void write_binary_recipe(const std::string &path, const json &recipe, size_t truncate = 0)
+    {
+        std::vector<std::uint8_t> bytes = {0xD9, 0xD9, 0xF7};
+        json::to_cbor(recipe, bytes);
+        bytes.resize(bytes.size() - truncate);
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    // sum_series(base * Normal(1, 0.1)), with the series given as a literal.
+    static json recipe_with(const json &series)
+    {
+        json recipe = json::parse(R"({
+            "simulation_config": {"num_trials": 50, "seed": 3}, "output_variable_index": 2, "variable_registry": ["base", "noise", "total"],
+            "pre_trial_steps": [{"type": "literal_assignment", "result": 0, "line": 1, "value": null}],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [1], "function": "Normal", "args": [{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 0.1}]},
+                {"type": "execution_assignment", "result": [2], "function": "sum_series", "args": [
+                    {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}]}
+                ]}
+            ]
+        })");
+        recipe["pre_trial_steps"][0]["value"] = series;
+        return recipe;
+    }
+};
+
+TEST_F(BinaryRecipeTest, RunsLikeTheJsonRecipe)
+{
+    const std::vector<double> series = {100.0, 0.1, -2.5, 1e-300, 12345.678};
+    create_test_recipe("recipe.json", recipe_with(series).dump());
+    json binary = recipe_with(pack(series));
+    binary["per_trial_steps"][1]["args"][0]["args"][0] = {{"type", "vector_literal"}, {"value", pack({1.0, 2.0, 3.0, 4.0, 5.0})}};
+    write_binary_recipe("recipe.vsr", binary);
+
+    SimulationEngine json_engine("recipe.json");
+    SimulationEngine binary_engine("recipe.vsr");
+    const auto expected = json_engine.run();
+    const auto actual = binary_engine.run();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i)
+    {
+        const double noise = std::get<double>(expected[i]) / (100.0 + 0.1 - 2.5 + 1e-300 + 12345.678);
+        EXPECT_NEAR(std::get<double>(actual[i]), 15.0 * noise, 1e-9);
+    }
+}
+
+TEST_F(BinaryRecipeTest, RejectsTruncatedRecipes)
+{
+    write_binary_recipe("recipe.vsr", recipe_with(pack({1.0, 2.0})), 5);
+    try
+    {
+        SimulationEngine engine("recipe.vsr");
+        FAIL() << "Expected a parse error.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::RecipeParseError);
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("Failed to parse binary recipe"));
+    }
+}
+
+TEST_F(BinaryRecipeTest, RejectsPackedLiteralsOfPartialDoubles)
+{
+    json recipe = recipe_with(pack({1.0}));
+    recipe["pre_trial_steps"][0]["value"] = json::binary_t(std::vector<std::uint8_t>(12, 0));
+    write_binary_recipe("recipe.vsr", recipe);
+    try
+    {
+        SimulationEngine engine("recipe.vsr");
+        FAIL() << "Expected a parse error.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::RecipeParseError);
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("L1: Packed vector literal of 12 bytes"));
+    }
+}
@@ -0,0 +1,283 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/ExecutionSteps.h"
+#include "include/engine/functions/core/operations.h"
+#include "include/engine/functions/series/operations.h"
+
+class BytecodeLoweringTest : public FileCleanupTest
+{
+protected:
+    void SetUp() override
+    {
+        FileCleanupTest::SetUp();
+        register_core_functions(m_registry);
+        register_series_functions(m_registry);
+    }
+
+    std::unique_ptr<IExecutionStep> make_call(std::vector<size_t> results, const std::string &function, int line, const std::string &args_json)
+    {
+        const auto &factory = m_registry.get_factory_map();
+        return std::make_unique<ExecutionAssignmentStep>(
+            std::move(results), function, line, factory.at(function)(), nlohmann::json::parse(args_json), factory);
+    }
+
+    FunctionRegistry m_registry;
+};
+
+TEST_F(BytecodeLoweringTest, FlattensNestedCallsIntoRegisters)
+{
+    // c = (a + 2) * (b - 1), with a = 3 and b = 5
+    auto step = make_call({2}, "multiply", 1, R"([
+        {"type": "execution_assignment", "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]},
+        {"type": "execution_assignment", "function": "subtract", "args": [{"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 1}]}
+    ])");
+
+    BytecodeBuilder builder(3);
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+
+    // The element-wise tree is fused into a single call over its leaves.
+    EXPECT_EQ(program.lowered_step_count(), 1u);
+    EXPECT_EQ(program.fallback_step_count(), 0u);
+    EXPECT_EQ(program.instruction_count(), 1u);
+    EXPECT_EQ(program.register_count(), 0u);
+
+    TrialContext context = {TrialValue(3.0), TrialValue(5.0), TrialValue(0.0)};
+    BytecodeFrame frame = program.make_frame();
+    program.execute(context, frame);
+    EXPECT_DOUBLE_EQ(std::get<double>(context[2]), 20.0);
+}
+
+TEST_F(BytecodeLoweringTest, MatchesTreePathForVectorArguments)
+{
+    auto step = make_call({1}, "add", 1, R"([
+        {"type": "execution_assignment", "function": "grow_series", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0.1}, {"type": "scalar_literal", "value": 3}]},
+        {"type": "scalar_literal", "value": 1}
+    ])");
+
+    TrialContext tree_context = {TrialValue(100.0), TrialValue(0.0)};
+    step->execute(tree_context);
+
+    BytecodeBuilder builder(2);
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+    TrialContext bytecode_context = {TrialValue(100.0), TrialValue(0.0)};
+    BytecodeFrame frame = program.make_frame();
+    program.execute(bytecode_context, frame);
+
+    const auto &expected = std::get<std::vector<double>>(tree_context[1]);
+    const auto &actual = std::get<std::vector<double>>(bytecode_context[1]);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        EXPECT_DOUBLE_EQ(actual[i], expected[i]);
+    }
+}
+
+TEST_F(BytecodeLoweringTest, KeepsTreePathForUnresolvableSlots)
+{
+    auto step = make_call({0}, "identity", 1, R"([{"type": "variable_index", "value": 7}])");
+
+    BytecodeBuilder builder(1);
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+
+    EXPECT_EQ(program.lowered_step_count(), 0u);
+    EXPECT_EQ(program.fallback_step_count(), 1u);
+}
+
+TEST_F(BytecodeLoweringTest, PreservesNestedErrorContext)
+{
+    auto step = make_call({0}, "add", 3, R"([
+        {"type": "scalar_literal", "value": 1},
+        {"type": "execution_assignment", "line": 7, "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 0}]}
+    ])");
+
+    std::string tree_message;
+    try
+    {
+        TrialContext context(1);
+        step->execute(context);
+    }
+    catch (const EngineException &e)
+    {
+        tree_message = e.what();
+    }
+
+    BytecodeBuilder builder(1);
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+    try
+    {
+        TrialContext context(1);
+        BytecodeFrame frame = program.make_frame();
+        program.execute(context, frame);
+        FAIL() << "Expected a division by zero error.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::DivisionByZero);
+        EXPECT_EQ(e.line(), 3);
+        EXPECT_EQ(std::string(e.what()), tree_message);
+        EXPECT_EQ(std::string(e.what()), "L3: In function 'add': L7: In nested function 'divide': Division by zero");
+    }
+}
+
+TEST_F(BytecodeLoweringTest, EvaluatesOnlyTheTakenBranchOfNestedConditionals)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 3}, "output_variable_index": 1, "variable_registry": ["flag", "result"],
+        "per_trial_steps": [
+            {"type": "literal_assignment", "result": 0, "value": false},
+            {"type": "execution_assignment", "result": [1], "function": "add", "args": [
+                {"type": "scalar_literal", "value": 1},
+                {"type": "conditional_expression",
+                    "condition": {"type": "variable_index", "value": 0},
+                    "then_expr": {"type": "execution_assignment", "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 0}]},
+                    "else_expr": {"type": "scalar_literal", "value": 41}
+                }
+            ]}
+        ]
+    })";
+    create_test_recipe("recipe.json", recipe);
+    SimulationEngine engine("recipe.json");
+    auto results = engine.run();
+    ASSERT_EQ(results.size(), 3u);
+    for (const auto &result : results)
+    {
+        EXPECT_EQ(std::get<double>(result), 42.0);
+    }
+}
+
+TEST_F(BytecodeLoweringTest, ReadsInvariantSlotsFromTheSharedContext)
+{
+    auto step = make_call({1}, "sum_series", 1, R"([{"type": "variable_index", "value": 0}])");
+    BytecodeBuilder builder(2);
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+
+    const TrialContext invariants = {TrialValue(std::vector<double>{1.0, 2.0, 3.0}), TrialValue(0.0)};
+    EXPECT_TRUE(program.is_invariant_slot(0));
+    EXPECT_FALSE(program.is_invariant_slot(1));
+
+    // The scratch context never receives a copy of the invariant series.
+    TrialContext scratch = program.make_scratch(invariants);
+    EXPECT_TRUE(std::holds_alternative<double>(scratch[0]));
+
+    BytecodeFrame frame = program.make_frame();
+    program.begin_trial(invariants, scratch);
+    program.execute(invariants, scratch, frame);
+    EXPECT_DOUBLE_EQ(std::get<double>(scratch[1]), 6.0);
+}
+
+TEST_F(BytecodeLoweringTest, ResetsSlotsReadBeforeAssignmentEveryTrial)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 3, "lane_width": 0}, "output_variable_index": 0, "variable_registry": ["x"],
+        "pre_trial_steps": [{"type": "literal_assignment", "result": 0, "value": 10}],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 1}]}
+        ]
+    })";
+    create_test_recipe("recipe.json", recipe);
+    SimulationEngine engine("recipe.json");
+    auto results = engine.run();
+    ASSERT_EQ(results.size(), 3u);
+    for (const auto &result : results)
+    {
+        EXPECT_EQ(std::get<double>(result), 11.0);
+    }
+}
+
+TEST_F(BytecodeLoweringTest, ReusesSeriesStorageAcrossTrials)
+{
+    auto step = make_call({1}, "grow_series", 1, R"([{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0.1}, {"type": "scalar_literal", "value": 64}])");
+    BytecodeBuilder builder(2);
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+
+    const TrialContext invariants = {TrialValue(100.0), TrialValue(0.0)};
+    TrialContext scratch = program.make_scratch(invariants);
+    BytecodeFrame frame = program.make_frame();
+    std::vector<const double *> buffers;
+    for (int trial = 0; trial < 6; ++trial)
+    {
+        program.begin_trial(invariants, scratch);
+        program.execute(invariants, scratch, frame);
+        buffers.push_back(std::get<std::vector<double>>(scratch[1]).data());
+    }
+    // After warm-up the result reuses its storage instead of allocating.
+    EXPECT_EQ(buffers[3], buffers[5]);
+    EXPECT_EQ(buffers[2], buffers[4]);
+}
+
+namespace
+{
+    class TwoValueOperation : public IExecutable
+    {
+    public:
+        std::vector<TrialValue> execute(const std::vector<TrialValue> &args) const override
+        {
+            return {args.at(0), TrialValue(2.0)};
+        }
+    };
+}
+
+TEST(ExecuteIntoAdapterTest, ForwardsToExecuteAndReportsResultCount)
+{
+    TwoValueOperation op;
+    const TrialValue arg(1.0);
+    const TrialValue *args[] = {&arg};
+    TrialValue first, second;
+    TrialValue *results[] = {&first, &second};
+
+    EXPECT_EQ(op.execute_into(ArgumentSpan(args, 1), ResultSpan(results, 2)), 2u);
+    EXPECT_EQ(std::get<double>(first), 1.0);
+    EXPECT_EQ(std::get<double>(second), 2.0);
+
+    TrialValue untouched(7.0);
+    TrialValue *single[] = {&untouched};
+    EXPECT_EQ(op.execute_into(ArgumentSpan(args, 1), ResultSpan(single, 1)), 2u);
+    EXPECT_EQ(std::get<double>(untouched), 7.0);
+}
+
+TEST_F(BytecodeLoweringTest, KeepsOneBufferPerSlotAcrossTrials)
+{
+    // Series of different lengths flow through several slots; once warm, every slot keeps its
+    // own buffer, so later trials do not touch the heap.
+    std::vector<std::unique_ptr<IExecutionStep>> steps;
+    steps.push_back(make_call({1}, "grow_series", 1, R"([{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0.1}, {"type": "scalar_literal", "value": 10}])"));
+    steps.push_back(make_call({2}, "delete_element", 2, R"([{"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 0}])"));
+    steps.push_back(make_call({3}, "compose_vector", 3, R"([{"type": "variable_index", "value": 2}, {"type": "scalar_literal", "value": 5}])"));
+    steps.push_back(make_call({1}, "add", 4, R"([{"type": "variable_index", "value": 3}, {"type": "scalar_literal", "value": 1}])"));
+
+    BytecodeBuilder builder(4);
+    for (const auto &step : steps)
+    {
+        builder.add_step(*step);
+    }
+    BytecodeProgram program = builder.finish();
+    const TrialContext invariants = {TrialValue(100.0), TrialValue(0.0), TrialValue(0.0), TrialValue(0.0)};
+    TrialContext scratch = program.make_scratch(invariants);
+    BytecodeFrame frame = program.make_frame();
+
+    auto buffers = [&]()
+    {
+        std::vector<const double *> data;
+        for (size_t slot = 1; slot < scratch.size(); ++slot)
+        {
+            data.push_back(std::get<std::vector<double>>(scratch[slot]).data());
+        }
+        return data;
+    };
+    program.begin_trial(invariants, scratch);
+    program.execute(invariants, scratch, frame);
+    const auto warm = buffers();
+    for (int trial = 0; trial < 3; ++trial)
+    {
+        program.begin_trial(invariants, scratch);
+        program.execute(invariants, scratch, frame);
+        EXPECT_EQ(buffers(), warm);
+    }
+    EXPECT_EQ(std::get<std::vector<double>>(scratch[1]).size(), 10u);
+}
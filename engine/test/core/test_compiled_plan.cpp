@@ -0,0 +1,271 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/CompiledPlan.h"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // x = Normal(5, 2); y = x * 3, both outputs.
+    std::string two_output_recipe(size_t trials, const std::string &config = "")
+    {
+        return R"({
+            "simulation_config": {"num_trials": )" +
+               std::to_string(trials) + R"(, "seed": 21)" + config + R"(},
+            "output_variable_indices": [0, 1], "variable_registry": ["x", "y"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "line": 1, "function": "Normal", "args": [{"type": "scalar_literal", "value": 5}, {"type": "scalar_literal", "value": 2}]},
+                {"type": "execution_assignment", "result": [1], "line": 2, "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 3}]}
+            ]
+        })";
+    }
+
+    std::vector<double> doubles(const std::vector<TrialValue> &values)
+    {
+        std::vector<double> result;
+        for (const TrialValue &value : values)
+            result.push_back(std::get<double>(value));
+        return result;
+    }
+
+    // Holds up the worker delivering the first chunk until release(), for ten seconds at most.
+    class GateSink : public ResultSink
+    {
+    public:
+        void consume(size_t, const TrialValue *, size_t) override
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_entered)
+                return;
+            m_entered = true;
+            m_changed.notify_all();
+            m_released_in_time = m_changed.wait_for(lock, std::chrono::seconds(10), [this]
+                                                    { return m_released; });
+        }
+
+        void wait_until_entered()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this]
+                           { return m_entered; });
+        }
+
+        void release()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_released = true;
+            m_changed.notify_all();
+        }
+
+        bool released_in_time()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_released_in_time;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        bool m_entered = false;
+        bool m_released = false;
+        bool m_released_in_time = false;
+    };
+}
+
+TEST(CompiledPlanTest, RunsAsTheEngineWithTheRecipesSettings)
+{
+    const std::string recipe = two_output_recipe(500);
+    auto engine = SimulationEngine::from_recipe_text(recipe);
+    const std::vector<std::vector<TrialValue>> expected = engine->run_outputs();
+
+    auto plan = CompiledPlan::compile(recipe);
+    EXPECT_EQ(plan->output_names(), (std::vector<std::string>{"x", "y"}));
+    const std::vector<std::vector<TrialValue>> results = run_outputs(*plan, RunOptions());
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(doubles(results[0]), doubles(expected[0]));
+    EXPECT_EQ(doubles(results[1]), doubles(expected[1]));
+}
+
+TEST(CompiledPlanTest, EachRunHasItsOwnSeedTrialCountAndOutputs)
+{
+    auto plan = CompiledPlan::compile(two_output_recipe(500));
+    RunOptions options;
+    options.seed = 99;
+    options.num_trials = 1234;
+    options.outputs = {"y"};
+    const std::vector<std::vector<TrialValue>> first = run_outputs(*plan, options);
+    ASSERT_EQ(first.size(), 1u);
+    ASSERT_EQ(first[0].size(), 1234u);
+    EXPECT_EQ(doubles(run_outputs(*plan, options)[0]), doubles(first[0]));
+
+    // The same draws as the recipe with that seed, output y alone.
+    const std::vector<double> x = doubles(run_outputs(*plan, RunOptions{99, 1234, {"x"}, std::nullopt, std::nullopt})[0]);
+    for (size_t i = 0; i < x.size(); ++i)
+        EXPECT_DOUBLE_EQ(std::get<double>(first[0][i]), 3.0 * x[i]);
+    EXPECT_NE(doubles(run_outputs(*plan, RunOptions{100, 1234, {"x"}, std::nullopt, std::nullopt})[0]), x);
+
+    options.outputs = {"z"};
+    EXPECT_THROW(run_outputs(*plan, options), EngineException);
+}
+
+TEST(CompiledPlanTest, ConcurrentRunsMatchRunsOneAtATime)
+{
+    SchedulerConfig scheduler;
+    scheduler.threads = 2;
+    scheduler.chunk_size = 64;
+    auto plan = CompiledPlan::compile(two_output_recipe(2000));
+
+    constexpr size_t RUNS = 8;
+    std::vector<std::vector<double>> expected(RUNS);
+    for (size_t r = 0; r < RUNS; ++r)
+        expected[r] = doubles(run_outputs(*plan, RunOptions{r, 1000 + 100 * r, {"y"}, scheduler, std::nullopt})[0]);
+
+    std::vector<std::vector<double>> concurrent(RUNS);
+    std::vector<std::thread> threads;
+    for (size_t r = 0; r < RUNS; ++r)
+    {
+        threads.emplace_back([&, r]
+                             {
+            StatisticsSink statistics;
+            ResultCollector collector;
+            OutputColumnSink y(collector, 0);
+            run(*plan, RunOptions{r, 1000 + 100 * r, {"y"}, scheduler, std::nullopt}, {&statistics, &y});
+            concurrent[r] = doubles(collector.results()); });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    for (size_t r = 0; r < RUNS; ++r)
+        EXPECT_EQ(concurrent[r], expected[r]) << "run " << r;
+}
+
+TEST(CompiledPlanTest, ConcurrentRunsDoNotWaitForEachOther)
+{
+    SchedulerConfig scheduler;
+    scheduler.threads = 2;
+    scheduler.chunk_size = 64;
+    auto plan = CompiledPlan::compile(two_output_recipe(2000));
+    const RunOptions first_options{1, 20000, {"y"}, scheduler, std::nullopt};
+    const RunOptions second_options{2, 5000, {"y"}, scheduler, std::nullopt};
+    const std::vector<double> first_expected = doubles(run_outputs(*plan, first_options)[0]);
+    const std::vector<double> second_expected = doubles(run_outputs(*plan, second_options)[0]);
+
+    // The first run holds the pool's workers until the second one is done.
+    GateSink gate;
+    ResultCollector collector;
+    OutputColumnSink y(collector, 0);
+    std::thread first([&]
+                      { run(*plan, first_options, {&gate, &y}); });
+    gate.wait_until_entered();
+    const std::vector<double> second = doubles(run_outputs(*plan, second_options)[0]);
+    gate.release();
+    first.join();
+
+    EXPECT_TRUE(gate.released_in_time());
+    EXPECT_EQ(second, second_expected);
+    EXPECT_EQ(doubles(collector.results()), first_expected);
+}
+
+TEST(CompiledPlanTest, RunsStartedFromASinkComplete)
+{
+    SchedulerConfig scheduler;
+    scheduler.threads = 3;
+    scheduler.chunk_size = 32;
+    auto plan = CompiledPlan::compile(two_output_recipe(2000));
+    const RunOptions outer_options{3, 4000, {"x"}, scheduler, std::nullopt};
+    const RunOptions inner_options{4, 1000, {"y"}, scheduler, std::nullopt};
+    const std::vector<double> outer_expected = doubles(run_outputs(*plan, outer_options)[0]);
+    const std::vector<double> inner_expected = doubles(run_outputs(*plan, inner_options)[0]);
+
+    // Every chunk's sink call, on whichever worker delivers it, runs the plan again.
+    class NestedRunSink : public ResultSink
+    {
+    public:
+        NestedRunSink(const CompiledPlan &plan, const RunOptions &options) : m_plan(plan), m_options(options) {}
+        void consume(size_t, const TrialValue *, size_t) override
+        {
+            std::vector<double> results = doubles(run_outputs(m_plan, m_options)[0]);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results.push_back(std::move(results));
+        }
+        std::vector<std::vector<double>> m_results;
+
+    private:
+        const CompiledPlan &m_plan;
+        RunOptions m_options;
+        std::mutex m_mutex;
+    };
+
+    NestedRunSink nested(*plan, inner_options);
+    ResultCollector collector;
+    OutputColumnSink x(collector, 0);
+    run(*plan, outer_options, {&nested, &x});
+    EXPECT_EQ(doubles(collector.results()), outer_expected);
+    ASSERT_FALSE(nested.m_results.empty());
+    for (const std::vector<double> &results : nested.m_results)
+        EXPECT_EQ(results, inner_expected);
+}
+
+TEST(CompiledPlanTest, QuasiRandomRunsFollowTheirOwnTrialCount)
+{
+    auto plan = CompiledPlan::compile(two_output_recipe(100, R"(, "sampling": "sobol")"));
+    RunOptions options;
+    options.num_trials = 4096;
+    options.outputs = {"x"};
+    StatisticsSink statistics;
+    run(*plan, options, statistics);
+    ASSERT_EQ(statistics.periods().size(), 1u);
+    EXPECT_EQ(statistics.periods()[0].moments.count, 4096u);
+    EXPECT_NEAR(statistics.periods()[0].moments.mean, 5.0, 0.01);
+}
+
+TEST(CompiledPlanTest, CompilesBinaryRecipesFromMemory)
+{
+    std::vector<std::uint8_t> bytes = {0xD9, 0xD9, 0xF7};
+    nlohmann::json::to_cbor(nlohmann::json::parse(two_output_recipe(300)), bytes);
+    auto plan = CompiledPlan::compile(std::string_view(reinterpret_cast<const char *>(bytes.data()), bytes.size()));
+    auto engine = SimulationEngine::from_recipe_text(two_output_recipe(300));
+    EXPECT_EQ(doubles(run_outputs(*plan, RunOptions())[1]), doubles(engine->run_outputs()[1]));
+}
+
+TEST(CompiledPlanTest, CompilesRecipeDocumentsWithoutText)
+{
+    auto plan = CompiledPlan::compile_document(nlohmann::json::parse(two_output_recipe(300)));
+    EXPECT_EQ(plan->engine().get_num_trials(), 300u);
+    auto engine = SimulationEngine::from_recipe_text(two_output_recipe(300));
+    EXPECT_EQ(doubles(run_outputs(*plan, RunOptions())[0]), doubles(engine->run_outputs()[0]));
+}
+
+TEST(CompiledPlanTest, LogsThroughTheCallback)
+{
+    std::vector<std::string> messages;
+    testing::internal::CaptureStdout();
+    CompiledPlan::compile(two_output_recipe(10), [&](LogLevel level, const std::string &message)
+                          {
+        EXPECT_EQ(level, LogLevel::Info);
+        messages.push_back(message); });
+    CompiledPlan::compile(two_output_recipe(10));
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+    ASSERT_EQ(messages.size(), 3u);
+    EXPECT_EQ(messages[0], "--- Running Pre-Trial Phase ---");
+    EXPECT_EQ(messages[1], "Random seed: 21");
+    EXPECT_THAT(messages[2], ::testing::StartsWith("Pre-trial phase complete."));
+}
+
+TEST(CompiledPlanTest, CachedResultsOnlyHoldForTheRecipesSeedAndTrialCount)
+{
+    const std::string directory = "compiled_plan_cache";
+    std::filesystem::remove_all(directory);
+    const std::string recipe = two_output_recipe(200, R"(, "cache_dir": ")" + directory + R"(")");
+    SimulationEngine::from_recipe_text(recipe)->run_outputs();
+
+    auto plan = CompiledPlan::compile(recipe);
+    ASSERT_GT(plan->engine().get_cached_step_count(), 0u);
+    EXPECT_EQ(run_outputs(*plan, RunOptions())[0].size(), 200u);
+    RunOptions options;
+    options.seed = 5;
+    EXPECT_THROW(run_outputs(*plan, options), EngineException);
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,109 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/DeviceProgram.h"
+
+namespace
+{
+    // Samplers, Black-Scholes, a fused expression, a conditional and a Beta draw, which has no
+    // device form. Outputs price, y, z and w.
+    std::string mixed_recipe(const std::string &config)
+    {
+        return R"({
+            "simulation_config": {"num_trials": 3000, "seed": 7)" +
+               config + R"(},
+            "output_variable_indices": [2, 5, 7, 8], "variable_registry": ["s", "k", "price", "b", "hit", "y", "big", "z", "w"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Lognormal", "args": [{"type": "scalar_literal", "value": 4.6}, {"type": "scalar_literal", "value": 0.2}]},
+                {"type": "execution_assignment", "result": [1], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 90}, {"type": "scalar_literal", "value": 110}]},
+                {"type": "execution_assignment", "result": [2], "function": "BlackScholes", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 0.05}, {"type": "scalar_literal", "value": 1},
+                    {"type": "execution_assignment", "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0.15}, {"type": "scalar_literal", "value": 0.25}]}, {"type": "string_literal", "value": "call"}]},
+                {"type": "execution_assignment", "result": [3], "function": "Beta", "args": [{"type": "scalar_literal", "value": 2}, {"type": "scalar_literal", "value": 5}]},
+                {"type": "execution_assignment", "result": [4], "function": "Bernoulli", "args": [{"type": "scalar_literal", "value": 0.3}]},
+                {"type": "execution_assignment", "result": [5], "function": "add", "args": [
+                    {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 2}, {"type": "scalar_literal", "value": 2}, {"type": "variable_index", "value": 4}]},
+                    {"type": "execution_assignment", "function": "exp", "args": [{"type": "execution_assignment", "function": "divide", "args": [{"type": "variable_index", "value": 3}, {"type": "scalar_literal", "value": 3}]}]},
+                    {"type": "execution_assignment", "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]}]},
+                {"type": "execution_assignment", "result": [6], "function": "__gt__", "args": [{"type": "variable_index", "value": 5}, {"type": "scalar_literal", "value": 20}]},
+                {"type": "conditional_assignment", "result": 7, "condition": {"type": "variable_index", "value": 6},
+                    "then_expr": {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 5}, {"type": "scalar_literal", "value": 2}]},
+                    "else_expr": {"type": "execution_assignment", "function": "subtract", "args": [{"type": "variable_index", "value": 5}, {"type": "variable_index", "value": 3}]}},
+                {"type": "execution_assignment", "result": [8], "function": "multiply", "args": [{"type": "variable_index", "value": 7}, {"type": "variable_index", "value": 0}]}
+            ]
+        })";
+    }
+
+    std::vector<std::vector<double>> doubles(const std::vector<std::vector<TrialValue>> &outputs)
+    {
+        std::vector<std::vector<double>> result;
+        for (const auto &column : outputs)
+        {
+            result.emplace_back();
+            for (const TrialValue &value : column)
+                result.back().push_back(std::get<double>(value));
+        }
+        return result;
+    }
+
+    std::string error_of(const std::string &recipe)
+    {
+        try
+        {
+            SimulationEngine::from_recipe_text(recipe)->run_outputs();
+        }
+        catch (const EngineException &e)
+        {
+            return e.what();
+        }
+        return "";
+    }
+}
+
+TEST(DeviceTest, HostDeviceRunsWhatTheCpuRuns)
+{
+    const auto expected = doubles(SimulationEngine::from_recipe_text(mixed_recipe(""))->run_outputs());
+    for (const std::string config : {R"(, "device": "host")", R"(, "device": "host", "lane_width": 100)"})
+    {
+        auto engine = SimulationEngine::from_recipe_text(mixed_recipe(config));
+        ASSERT_NE(engine->get_device(), nullptr);
+        EXPECT_STREQ(engine->get_device()->name(), "host");
+        EXPECT_GT(engine->get_device_instruction_count(), 0u);
+        EXPECT_EQ(doubles(engine->run_outputs()), expected) << config;
+    }
+}
+
+TEST(DeviceTest, LaneErrorsAreReportedByTheHost)
+{
+    // Some trials divide by zero.
+    const std::string steps = R"(
+        "output_variable_index": 1, "variable_registry": ["hit", "x"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Bernoulli", "args": [{"type": "scalar_literal", "value": 0.5}]},
+            {"type": "execution_assignment", "result": [1], "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 0}]}
+        ]
+    })";
+    const std::string cpu_error = error_of(R"({"simulation_config": {"num_trials": 500, "seed": 3},)" + steps);
+    EXPECT_THAT(cpu_error, ::testing::HasSubstr("Division by zero"));
+    EXPECT_EQ(error_of(R"({"simulation_config": {"num_trials": 500, "seed": 3, "device": "host"},)" + steps), cpu_error);
+}
+
+TEST(DeviceTest, SamplingDesignsRunOnTheHost)
+{
+    const auto expected = doubles(SimulationEngine::from_recipe_text(mixed_recipe(R"(, "sampling": "sobol")"))->run_outputs());
+    auto engine = SimulationEngine::from_recipe_text(mixed_recipe(R"(, "sampling": "sobol", "device": "host")"));
+    EXPECT_EQ(doubles(engine->run_outputs()), expected);
+}
+
+TEST(DeviceTest, SelectsDevicesByName)
+{
+    EXPECT_EQ(make_device_backend("cpu"), nullptr);
+    EXPECT_THROW(make_device_backend("gpu"), EngineException);
+    EXPECT_THROW(SimulationEngine::from_recipe_text(mixed_recipe(R"(, "device": "tpu")")), EngineException);
+
+    auto engine = SimulationEngine::from_recipe_text(mixed_recipe(""));
+    EXPECT_EQ(engine->get_device_instruction_count(), 0u);
+    const auto expected = doubles(engine->run_outputs());
+    engine->set_device("host");
+    EXPECT_GT(engine->get_device_instruction_count(), 0u);
+    EXPECT_EQ(doubles(engine->run_outputs()), expected);
+    engine->set_device("cpu");
+    EXPECT_EQ(engine->get_device_instruction_count(), 0u);
+}
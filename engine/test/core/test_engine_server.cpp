@@ -0,0 +1,158 @@
+#include "test/test_helpers.h"
+#include "include/engine/io/EngineServer.h"
+#include <nlohmann/json.hpp>
+#include <sstream>
+
+using json = nlohmann::json;
+
+class EngineServerTest : public FileCleanupTest
+{
+protected:
+    static json normal_recipe(double mean)
+    {
+        return json::parse(R"({
+            "simulation_config": {"num_trials": 2000, "seed": 5}, "output_variable_indices": [0, 1], "variable_registry": ["x", "twice"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": )" +
+                           std::to_string(mean) + R"(}, {"type": "scalar_literal", "value": 1}]},
+                {"type": "execution_assignment", "result": [1], "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]}
+            ]
+        })");
+    }
+};
+
+TEST_F(EngineServerTest, ReusesEnginesOfRepeatedRecipes)
+{
+    EngineServer server;
+    const json request = {{"id", 1}, {"command", "preview"}, {"recipe", normal_recipe(50.0)}};
+
+    const json first = server.handle(request);
+    EXPECT_EQ(first["status"], "success");
+    EXPECT_EQ(first["id"], 1);
+    EXPECT_FALSE(first["cached"].get<bool>());
+    EXPECT_NEAR(first["value"].get<double>(), 50.0, 0.5);
+
+    const json second = server.handle(request);
+    EXPECT_TRUE(second["cached"].get<bool>());
+    EXPECT_EQ(second["value"], first["value"]);
+    EXPECT_EQ(server.cache_size(), 1u);
+
+    EXPECT_FALSE(server.handle({{"command", "preview"}, {"recipe", normal_recipe(60.0)}})["cached"].get<bool>());
+    EXPECT_EQ(server.cache_size(), 2u);
+    EXPECT_EQ(server.handle({{"command", "clear_cache"}})["status"], "success");
+    EXPECT_EQ(server.cache_size(), 0u);
+}
+
+TEST_F(EngineServerTest, EvictsTheLeastRecentlyUsedEngine)
+{
+    EngineServer server(EngineServer::Configure(), 2);
+    for (double mean : {1.0, 2.0, 1.0, 3.0})
+    {
+        server.handle({{"command", "preview"}, {"recipe", normal_recipe(mean)}});
+    }
+    EXPECT_EQ(server.cache_size(), 2u);
+    EXPECT_TRUE(server.handle({{"command", "preview"}, {"recipe", normal_recipe(1.0)}})["cached"].get<bool>());
+    EXPECT_FALSE(server.handle({{"command", "preview"}, {"recipe", normal_recipe(2.0)}})["cached"].get<bool>());
+}
+
+TEST_F(EngineServerTest, RunsRecipeFilesAndReportsStatisticsPerOutput)
+{
+    create_test_recipe("recipe.json", normal_recipe(10.0).dump());
+    EngineServer server([](SimulationEngine &engine)
+                        {
+        SchedulerConfig config = engine.get_scheduler_config();
+        config.threads = 2;
+        engine.set_scheduler_config(config); });
+    const json response = server.handle({{"command", "run"}, {"recipe_path", "recipe.json"}});
+    ASSERT_EQ(response["status"], "success") << response.dump();
+    ASSERT_EQ(response["outputs"].size(), 2u);
+    EXPECT_EQ(response["outputs"][0]["name"], "x");
+    EXPECT_EQ(response["outputs"][0]["type"], "scalar");
+    EXPECT_EQ(response["outputs"][0]["trials"], 2000);
+    EXPECT_NEAR(response["outputs"][0]["mean"].get<double>(), 10.0, 0.1);
+    EXPECT_NEAR(response["outputs"][1]["mean"].get<double>(), 2.0 * response["outputs"][0]["mean"].get<double>(), 1e-9);
+    EXPECT_TRUE(response["outputs"][1]["percentiles"].contains("P95"));
+}
+
+TEST_F(EngineServerTest, ReportsDistributionsWithTheirBins)
+{
+    EngineServer server;
+    const json preview = server.handle({{"command", "preview"}, {"recipe", normal_recipe(10.0)}, {"bins", 8}});
+    ASSERT_EQ(preview["status"], "success") << preview.dump();
+    const json &distribution = preview["distribution"];
+    EXPECT_NEAR(distribution["mean"].get<double>(), preview["value"].get<double>(), 1e-4);
+    EXPECT_NEAR(distribution["stddev"].get<double>(), 1.0, 0.1);
+    EXPECT_EQ(distribution["histogram"]["counts"].size(), 8u);
+    EXPECT_EQ(distribution["ecdf"]["values"].size(), 9u);
+    EXPECT_EQ(server.handle({{"command", "preview"}, {"recipe", normal_recipe(10.0)}})["distribution"]["histogram"]["counts"].size(), PREVIEW_BINS);
+
+    const json run = server.handle({{"command", "run"}, {"recipe", normal_recipe(10.0)}, {"bins", 4}});
+    ASSERT_EQ(run["status"], "success") << run.dump();
+    for (const json &output : run["outputs"])
+    {
+        ASSERT_EQ(output["distributions"].size(), 1u);
+        EXPECT_EQ(output["distributions"][0]["histogram"]["counts"].size(), 4u);
+        EXPECT_EQ(output["distributions"][0]["mean"], output["mean"]);
+    }
+    EXPECT_FALSE(server.handle({{"command", "run"}, {"recipe", normal_recipe(10.0)}})["outputs"][0].contains("distributions"));
+}
+
+TEST_F(EngineServerTest, RunsSensitivityAnalyses)
+{
+    json recipe = normal_recipe(10.0);
+    recipe["simulation_config"]["sensitivity"] = json::parse(R"([{"variable": "x", "low": 0, "high": 1}])");
+    EngineServer server;
+    const json response = server.handle({{"command", "sensitivity"}, {"recipe", recipe}});
+    ASSERT_EQ(response["status"], "success") << response.dump();
+    EXPECT_EQ(response["trials"], 2000);
+    EXPECT_NEAR(response["base"]["mean"].get<double>(), 10.0, 0.1);
+    ASSERT_EQ(response["bars"].size(), 1u);
+    EXPECT_EQ(response["bars"][0]["name"], "x");
+    EXPECT_DOUBLE_EQ(response["bars"][0]["mean_low"].get<double>(), 0.0);
+    EXPECT_DOUBLE_EQ(response["bars"][0]["mean_high"].get<double>(), 1.0);
+    EXPECT_DOUBLE_EQ(response["bars"][0]["swing"].get<double>(), 1.0);
+}
+
+TEST_F(EngineServerTest, ReportsErrorsInTheResponse)
+{
+    EngineServer server;
+    const json missing = server.handle({{"id", "a"}, {"command", "preview"}, {"recipe_path", "does_not_exist.json"}});
+    EXPECT_EQ(missing["status"], "error");
+    EXPECT_EQ(missing["id"], "a");
+    EXPECT_THAT(missing["message"].get<std::string>(), ::testing::HasSubstr("Failed to open recipe file"));
+
+    const json runtime = server.handle({{"command", "preview"}, {"recipe", json::parse(R"({
+        "simulation_config": {"num_trials": 1}, "output_variable_index": 0, "variable_registry": ["a"],
+        "per_trial_steps": [{"type": "execution_assignment", "line": 3, "result": [0], "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 0}]}]
+    })")}});
+    EXPECT_EQ(runtime["status"], "error");
+    EXPECT_THAT(runtime["message"].get<std::string>(), ::testing::HasSubstr("L3: In function 'divide': Division by zero"));
+
+    EXPECT_EQ(server.handle({{"command", "explode"}})["status"], "error");
+    EXPECT_EQ(server.handle({{"command", "preview"}})["status"], "error");
+}
+
+TEST_F(EngineServerTest, AnswersOneLinePerRequestUntilShutdown)
+{
+    std::istringstream in(json({{"id", 1}, {"command", "preview"}, {"recipe", normal_recipe(5.0)}}).dump() + "\n" +
+                          "\n" +
+                          "not json\n" +
+                          json({{"id", 2}, {"command", "shutdown"}}).dump() + "\n" +
+                          json({{"id", 3}, {"command", "clear_cache"}}).dump() + "\n");
+    std::ostringstream out;
+    EngineServer server;
+    server.serve(in, out);
+    EXPECT_TRUE(server.shutdown_requested());
+
+    std::istringstream lines(out.str());
+    std::vector<json> responses;
+    for (std::string line; std::getline(lines, line);)
+    {
+        responses.push_back(json::parse(line));
+    }
+    ASSERT_EQ(responses.size(), 3u);
+    EXPECT_EQ(responses[0]["id"], 1);
+    EXPECT_EQ(responses[0]["status"], "success");
+    EXPECT_EQ(responses[1]["status"], "error");
+    EXPECT_EQ(responses[2]["id"], 2);
+}
@@ -36,15 +36,16 @@ TEST_F(CoreEngineErrorTest, ThrowsOnStepVariableIndexOutOfBounds)
         ]
     })");
 
-    SimulationEngine engine("err.json");
+    // Indices are checked when the recipe is loaded, not when the step runs.
     try
     {
-        engine.run();
+        SimulationEngine engine("err.json");
         FAIL() << "Expected exception for out-of-bounds variable access in a step.";
     }
     catch (const EngineException &e)
     {
         EXPECT_EQ(e.code(), EngineErrc::IndexOutOfBounds);
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("In function 'identity': Variable index 1 is out of bounds"));
     }
     catch (...)
     {
@@ -0,0 +1,194 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/ExecutionSteps.h"
+#include "include/engine/core/FusedExpression.h"
+#include "include/engine/functions/core/operations.h"
+#include "include/engine/functions/series/operations.h"
+
+class FusedExpressionTest : public FileCleanupTest
+{
+protected:
+    void SetUp() override
+    {
+        FileCleanupTest::SetUp();
+        register_core_functions(m_registry);
+        register_series_functions(m_registry);
+    }
+
+    std::unique_ptr<IExecutionStep> make_call(std::vector<size_t> results, const std::string &function, int line, const std::string &args_json)
+    {
+        const auto &factory = m_registry.get_factory_map();
+        return std::make_unique<ExecutionAssignmentStep>(
+            std::move(results), function, line, factory.at(function)(), nlohmann::json::parse(args_json), factory);
+    }
+
+    // Runs the step through both the tree and the bytecode path and returns the error messages,
+    // checking that they agree.
+    std::string error_of(const IExecutionStep &step, TrialContext context)
+    {
+        std::string tree_message;
+        try
+        {
+            TrialContext tree_context = context;
+            step.execute(tree_context);
+        }
+        catch (const EngineException &e)
+        {
+            tree_message = e.what();
+        }
+
+        BytecodeBuilder builder(context.size());
+        builder.add_step(step);
+        BytecodeProgram program = builder.finish();
+        std::string bytecode_message;
+        try
+        {
+            BytecodeFrame frame = program.make_frame();
+            program.execute(context, frame);
+        }
+        catch (const EngineException &e)
+        {
+            bytecode_message = e.what();
+        }
+        EXPECT_EQ(tree_message, bytecode_message);
+        return tree_message;
+    }
+
+    FunctionRegistry m_registry;
+};
+
+// revenue * (1 - tax) * margin + da over series longer than one tile.
+TEST_F(FusedExpressionTest, EvaluatesSeriesTreesWithoutTemporaries)
+{
+    auto step = make_call({4}, "add", 1, R"([
+        {"type": "execution_assignment", "function": "multiply", "args": [
+            {"type": "variable_index", "value": 0},
+            {"type": "execution_assignment", "function": "subtract", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 1}]},
+            {"type": "variable_index", "value": 2}
+        ]},
+        {"type": "variable_index", "value": 3}
+    ])");
+
+    const size_t n = 1000;
+    std::vector<double> revenue(n), da(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        revenue[i] = 100.0 + static_cast<double>(i);
+        da[i] = 0.5 * static_cast<double>(i % 7);
+    }
+    TrialContext context = {TrialValue(revenue), TrialValue(0.25), TrialValue(0.4), TrialValue(da), TrialValue(0.0)};
+
+    TrialContext tree_context = context;
+    step->execute(tree_context);
+
+    BytecodeBuilder builder(context.size());
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+    EXPECT_EQ(program.instruction_count(), 1u);
+    BytecodeFrame frame = program.make_frame();
+    program.execute(context, frame);
+
+    for (const TrialContext *result : {&tree_context, &context})
+    {
+        const auto &values = std::get<std::vector<double>>((*result)[4]);
+        ASSERT_EQ(values.size(), n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            EXPECT_DOUBLE_EQ(values[i], revenue[i] * (1.0 - 0.25) * 0.4 + da[i]);
+        }
+    }
+}
+
+TEST_F(FusedExpressionTest, FusesTreesNestedInOtherFunctions)
+{
+    // sum_series(a * (1 - t)), where only the argument tree can be fused.
+    auto step = make_call({2}, "sum_series", 1, R"([
+        {"type": "execution_assignment", "function": "multiply", "args": [
+            {"type": "variable_index", "value": 0},
+            {"type": "execution_assignment", "function": "subtract", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 1}]}
+        ]}
+    ])");
+    TrialContext context = {TrialValue(std::vector<double>{10.0, 20.0, 30.0}), TrialValue(0.5), TrialValue(0.0)};
+    step->execute(context);
+    EXPECT_DOUBLE_EQ(std::get<double>(context[2]), 30.0);
+}
+
+TEST_F(FusedExpressionTest, ReturnsBooleansFromComparisonRoots)
+{
+    auto step = make_call({2}, "__gt__", 1, R"([
+        {"type": "execution_assignment", "function": "exp", "args": [{"type": "variable_index", "value": 0}]},
+        {"type": "variable_index", "value": 1}
+    ])");
+    TrialContext context = {TrialValue(1.0), TrialValue(2.5), TrialValue(0.0)};
+    step->execute(context);
+    ASSERT_TRUE(std::holds_alternative<bool>(context[2]));
+    EXPECT_TRUE(std::get<bool>(context[2]));
+}
+
+TEST_F(FusedExpressionTest, ReportsErrorsOfInnerOperations)
+{
+    auto step = make_call({2}, "add", 3, R"([
+        {"type": "scalar_literal", "value": 1},
+        {"type": "execution_assignment", "line": 7, "function": "divide", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}]}
+    ])");
+    TrialContext context = {TrialValue(std::vector<double>{1.0, 2.0, 3.0}), TrialValue(std::vector<double>{1.0, 0.0, 1.0}), TrialValue(0.0)};
+    EXPECT_EQ(error_of(*step, context), "L3: In function 'add': L7: In nested function 'divide': Division by zero.");
+}
+
+TEST_F(FusedExpressionTest, ReportsErrorsOfNestedRoots)
+{
+    auto step = make_call({2}, "sum_series", 2, R"([
+        {"type": "execution_assignment", "line": 4, "function": "add", "args": [
+            {"type": "variable_index", "value": 0},
+            {"type": "execution_assignment", "line": 5, "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}]}
+        ]}
+    ])");
+    TrialContext context = {TrialValue(std::vector<double>{1.0, 2.0}), TrialValue(std::vector<double>{1.0, 2.0, 3.0}), TrialValue(0.0)};
+    EXPECT_EQ(error_of(*step, context), "L2: In function 'sum_series': L5: In nested function 'multiply': Vector size mismatch for in-place operation.");
+
+    context[1] = std::vector<double>{1.0, 2.0};
+    context[0] = std::string("text");
+    EXPECT_THAT(error_of(*step, context), ::testing::HasSubstr("L2: In function 'sum_series': L5: In nested function 'multiply': "));
+}
+
+TEST_F(FusedExpressionTest, ReportsErrorsThroughNestedConditionals)
+{
+    auto step = make_call({2}, "identity", 3, R"([
+        {"type": "conditional_expression", "line": 4, "condition": {"type": "variable_index", "value": 0},
+            "then_expr": {"type": "execution_assignment", "line": 5, "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 1}]},
+            "else_expr": {"type": "scalar_literal", "value": 0}}
+    ])");
+    TrialContext context = {TrialValue(true), TrialValue(0.0), TrialValue(0.0)};
+    EXPECT_EQ(error_of(*step, context), "L3: In function 'identity': L4: In nested conditional expression: L5: In nested function 'divide': Division by zero");
+
+    context[0] = 1.0;
+    EXPECT_EQ(error_of(*step, context), "L3: In function 'identity': L4: In nested conditional expression: The 'if' condition did not evaluate to a boolean value.");
+}
+
+TEST_F(FusedExpressionTest, RunsInsideBatchedPrograms)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 300, "seed": 7}, "output_variable_index": 2, "variable_registry": ["x", "y", "result"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 0.1}]},
+            {"type": "execution_assignment", "result": [1], "function": "__lt__", "args": [
+                {"type": "execution_assignment", "function": "log", "args": [{"type": "variable_index", "value": 0}]},
+                {"type": "scalar_literal", "value": 0}
+            ]},
+            {"type": "execution_assignment", "result": [2], "function": "subtract", "args": [
+                {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 3}]},
+                {"type": "execution_assignment", "function": "power", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]}
+            ]}
+        ]
+    })";
+    create_test_recipe("recipe.json", recipe);
+    SimulationEngine engine("recipe.json");
+    const auto results = engine.run();
+    ASSERT_EQ(results.size(), 300u);
+    for (const auto &result : results)
+    {
+        const double value = std::get<double>(result);
+        EXPECT_GT(value, 1.0);
+        EXPECT_LT(value, 2.5);
+    }
+}
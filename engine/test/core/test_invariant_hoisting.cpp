@@ -0,0 +1,147 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/Bytecode.h"
+#include "include/engine/core/ExecutionSteps.h"
+#include "include/engine/functions/core/operations.h"
+#include "include/engine/functions/series/operations.h"
+#include "include/engine/functions/statistics/samplers.h"
+
+class InvariantHoistingTest : public FileCleanupTest
+{
+protected:
+    void SetUp() override
+    {
+        FileCleanupTest::SetUp();
+        register_core_functions(m_registry);
+        register_series_functions(m_registry);
+        register_statistics_functions(m_registry);
+    }
+
+    // Slot 2 is assigned per trial; slots 0 and 1 are pre-trial inputs.
+    InvariantHoister make_hoister()
+    {
+        return InvariantHoister({false, false, true, false}, [this](const std::string &name)
+                                { return m_registry.is_pure(name); });
+    }
+
+    std::unique_ptr<IExecutionStep> make_call(std::vector<size_t> results, const std::string &function, int line,
+                                              const std::string &args_json, InvariantHoister *hoister)
+    {
+        const auto &factory = m_registry.get_factory_map();
+        return std::make_unique<ExecutionAssignmentStep>(
+            std::move(results), function, line, factory.at(function)(), nlohmann::json::parse(args_json), factory, hoister);
+    }
+
+    FunctionRegistry m_registry;
+};
+
+TEST_F(InvariantHoistingTest, EvaluatesInvariantCallsOnce)
+{
+    // result = x * grow_series(base, rate, 3), where only x changes between trials.
+    InvariantHoister hoister = make_hoister();
+    auto step = make_call({3}, "multiply", 1, R"([
+        {"type": "variable_index", "value": 2},
+        {"type": "execution_assignment", "function": "grow_series", "args": [
+            {"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 3}
+        ]}
+    ])",
+                          &hoister);
+    ASSERT_EQ(hoister.num_hoisted(), 1u);
+
+    TrialContext context = {TrialValue(100.0), TrialValue(0.1), TrialValue(2.0), TrialValue(0.0)};
+    EXPECT_EQ(hoister.evaluate(context), 1u);
+
+    // The grow_series call is now a constant operand of the multiplication.
+    BytecodeBuilder builder(context.size());
+    builder.add_step(*step);
+    BytecodeProgram program = builder.finish();
+    EXPECT_EQ(program.instruction_count(), 1u);
+
+    context[0] = 1.0; // Hoisted values are not re-read per trial.
+    BytecodeFrame frame = program.make_frame();
+    program.execute(context, frame);
+    const auto &values = std::get<std::vector<double>>(context[3]);
+    ASSERT_EQ(values.size(), 3u);
+    EXPECT_DOUBLE_EQ(values[0], 220.0);
+    EXPECT_DOUBLE_EQ(values[1], 242.0);
+    EXPECT_DOUBLE_EQ(values[2], 266.2);
+}
+
+TEST_F(InvariantHoistingTest, KeepsSamplersAndPerTrialInputsInTheLoop)
+{
+    InvariantHoister hoister = make_hoister();
+    auto step = make_call({3}, "add", 1, R"([
+        {"type": "execution_assignment", "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+        {"type": "execution_assignment", "function": "exp", "args": [{"type": "variable_index", "value": 2}]},
+        {"type": "execution_assignment", "function": "identity", "args": [
+            {"type": "execution_assignment", "function": "Uniform", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}]}
+        ]}
+    ])",
+                          &hoister);
+    EXPECT_EQ(hoister.num_hoisted(), 0u);
+
+    // Invariant arguments of a sampler are still hoisted.
+    auto sampler_step = make_call({3}, "Normal", 1, R"([
+        {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]},
+        {"type": "variable_index", "value": 1}
+    ])",
+                                  &hoister);
+    EXPECT_EQ(hoister.num_hoisted(), 1u);
+}
+
+TEST_F(InvariantHoistingTest, FailedEvaluationsReportErrorsPerTrial)
+{
+    const std::string args = R"([
+        {"type": "variable_index", "value": 2},
+        {"type": "execution_assignment", "line": 4, "function": "divide", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0}]}
+    ])";
+    InvariantHoister hoister = make_hoister();
+    auto hoisted_step = make_call({3}, "add", 3, args, &hoister);
+    auto plain_step = make_call({3}, "add", 3, args, nullptr);
+
+    TrialContext context = {TrialValue(1.0), TrialValue(0.0), TrialValue(2.0), TrialValue(0.0)};
+    EXPECT_EQ(hoister.evaluate(context), 0u);
+
+    for (const IExecutionStep *step : {hoisted_step.get(), plain_step.get()})
+    {
+        TrialContext trial_context = context;
+        try
+        {
+            step->execute(trial_context);
+            FAIL() << "Expected a division by zero.";
+        }
+        catch (const EngineException &e)
+        {
+            EXPECT_EQ(e.code(), EngineErrc::DivisionByZero);
+            EXPECT_STREQ(e.what(), "L3: In function 'add': L4: In nested function 'divide': Division by zero");
+        }
+    }
+}
+
+TEST_F(InvariantHoistingTest, EngineHoistsCallsOverPreTrialSlots)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 200, "seed": 3}, "output_variable_index": 2, "variable_registry": ["base", "x", "result"],
+        "pre_trial_steps": [{"type": "literal_assignment", "result": 0, "value": 10}],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [1], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+            {"type": "execution_assignment", "result": [2], "function": "add", "args": [
+                {"type": "variable_index", "value": 1},
+                {"type": "execution_assignment", "function": "sum_series", "args": [
+                    {"type": "execution_assignment", "function": "grow_series", "args": [
+                        {"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0.5}, {"type": "scalar_literal", "value": 2}
+                    ]}
+                ]}
+            ]}
+        ]
+    })";
+    create_test_recipe("recipe.json", recipe);
+    SimulationEngine engine("recipe.json", true);
+    const auto results = engine.run();
+    ASSERT_EQ(results.size(), 200u);
+    for (const auto &result : results)
+    {
+        const double value = std::get<double>(result);
+        EXPECT_GE(value, 37.5);
+        EXPECT_LE(value, 38.5);
+    }
+}
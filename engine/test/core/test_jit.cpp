@@ -0,0 +1,104 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/DeviceProgram.h"
+#include <cstdlib>
+#include <filesystem>
+
+namespace
+{
+    // Samplers, Black-Scholes, fused arithmetic, a Beta draw (no device form) and a predicated
+    // conditional. Outputs price, y and w.
+    std::string jit_recipe(const std::string &config)
+    {
+        return R"({
+            "simulation_config": {"num_trials": 3000, "seed": 5)" +
+               config + R"(},
+            "output_variable_indices": [2, 4, 6], "variable_registry": ["s", "k", "price", "b", "y", "big", "w"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Lognormal", "args": [{"type": "scalar_literal", "value": 4.6}, {"type": "scalar_literal", "value": 0.2}]},
+                {"type": "execution_assignment", "result": [1], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 90}, {"type": "scalar_literal", "value": 110}]},
+                {"type": "execution_assignment", "result": [2], "function": "BlackScholes", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 0.05}, {"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 0.2}, {"type": "string_literal", "value": "put"}]},
+                {"type": "execution_assignment", "result": [3], "function": "Beta", "args": [{"type": "scalar_literal", "value": 2}, {"type": "scalar_literal", "value": 5}]},
+                {"type": "execution_assignment", "result": [4], "function": "add", "args": [
+                    {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 2}, {"type": "execution_assignment", "function": "Bernoulli", "args": [{"type": "scalar_literal", "value": 0.4}]}]},
+                    {"type": "execution_assignment", "function": "log", "args": [{"type": "execution_assignment", "function": "divide", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}]}]},
+                    {"type": "execution_assignment", "function": "Normal", "args": [{"type": "variable_index", "value": 3}, {"type": "scalar_literal", "value": 1}]}]},
+                {"type": "execution_assignment", "result": [5], "function": "__gte__", "args": [{"type": "variable_index", "value": 4}, {"type": "scalar_literal", "value": 3}]},
+                {"type": "conditional_assignment", "result": 6, "condition": {"type": "variable_index", "value": 5},
+                    "then_expr": {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 4}, {"type": "scalar_literal", "value": 2}]},
+                    "else_expr": {"type": "execution_assignment", "function": "subtract", "args": [{"type": "variable_index", "value": 4}, {"type": "variable_index", "value": 3}]}}
+            ]
+        })";
+    }
+
+    bool have_jit()
+    {
+        try
+        {
+            return make_device_backend("jit") != nullptr;
+        }
+        catch (const EngineException &)
+        {
+            return false;
+        }
+    }
+}
+
+TEST(JitTest, JitDeviceRunsWhatTheHostDeviceRuns)
+{
+    if (!have_jit())
+        GTEST_SKIP() << "built without -DVSE_ENABLE_LLVM=ON";
+    const auto expected = SimulationEngine::from_recipe_text(jit_recipe(R"(, "device": "host")"))->run_outputs();
+    for (const std::string config : {R"(, "device": "jit")", R"(, "device": "jit", "lane_width": 77)"})
+    {
+        auto engine = SimulationEngine::from_recipe_text(jit_recipe(config));
+        ASSERT_NE(engine->get_device(), nullptr);
+        EXPECT_STREQ(engine->get_device()->name(), "jit");
+        EXPECT_EQ(engine->run_outputs(), expected) << config;
+    }
+}
+
+TEST(JitTest, LaneErrorsAreReportedByTheHost)
+{
+    if (!have_jit())
+        GTEST_SKIP() << "built without -DVSE_ENABLE_LLVM=ON";
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 500, "seed": 3, "device": "jit"},
+        "output_variable_index": 1, "variable_registry": ["hit", "x"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Bernoulli", "args": [{"type": "scalar_literal", "value": 0.5}]},
+            {"type": "execution_assignment", "result": [1], "function": "divide", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 0}]}
+        ]
+    })";
+    EXPECT_THROW(SimulationEngine::from_recipe_text(recipe)->run_outputs(), EngineException);
+}
+
+TEST(JitTest, CachesCompiledSegmentsOnDisk)
+{
+    if (!have_jit())
+        GTEST_SKIP() << "built without -DVSE_ENABLE_LLVM=ON";
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "vse_test_jit_cache";
+    std::filesystem::remove_all(directory);
+    setenv("VSE_JIT_CACHE", directory.c_str(), 1);
+    // Another Bernoulli probability, so that the segments are not already compiled by this process.
+    auto recipe = [](const std::string &config)
+    {
+        std::string text = jit_recipe(config);
+        return text.replace(text.find("0.4}"), 4, "0.45}");
+    };
+    const auto outputs = SimulationEngine::from_recipe_text(recipe(R"(, "device": "jit")"))->run_outputs();
+    unsetenv("VSE_JIT_CACHE");
+
+    size_t objects = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(directory))
+        objects += entry.path().extension() == ".o";
+    EXPECT_GT(objects, 0u);
+    EXPECT_EQ(SimulationEngine::from_recipe_text(recipe(R"(, "device": "host")"))->run_outputs(), outputs);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(JitTest, RequiresAnLlvmBuild)
+{
+    if (have_jit())
+        GTEST_SKIP() << "built with -DVSE_ENABLE_LLVM=ON";
+    EXPECT_THROW(SimulationEngine::from_recipe_text(jit_recipe(R"(, "device": "jit")")), EngineException);
+}
@@ -1,4 +1,6 @@
 #include "test/test_helpers.h"
+#include <cstring>
+#include <iterator>
 
 class EngineFileOutputTest : public FileCleanupTest
 {
@@ -76,4 +78,432 @@ TEST_F(EngineFileOutputTest, DoesNotWriteFileWhenNotSpecified)
 
     std::ifstream file("test_output.csv");
     EXPECT_FALSE(file.good());
-}
\ No newline at end of file
+}
+// --- Streaming result sinks ---
+class ResultSinkTest : public FileCleanupTest
+{
+protected:
+    void create_stochastic_recipe(const std::string &config)
+    {
+        create_test_recipe("recipe.json", R"({"simulation_config": {"num_trials": 5000, "seed": 7, )" + config + R"(},
+            "output_variable_index": 0, "variable_registry": ["A"],
+            "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": 10}, {"type": "scalar_literal", "value": 2}]}]})");
+    }
+};
+
+TEST_F(ResultSinkTest, StreamedResultsMatchMaterializedRun)
+{
+    create_stochastic_recipe(R"("threads": 4, "chunk_size": 33, "output_file": "streamed.csv")");
+    SimulationEngine engine("recipe.json");
+    const std::vector<TrialValue> expected = engine.run();
+
+    ResultCollector collector;
+    StatisticsSink statistics;
+    CsvResultWriter writer(engine.get_output_file_path());
+    engine.run({&collector, &statistics, &writer});
+
+    ASSERT_EQ(collector.results().size(), expected.size());
+    RunningStatistics reference;
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        ASSERT_EQ(std::get<double>(collector.results()[i]), std::get<double>(expected[i]));
+        reference.add(std::get<double>(expected[i]));
+    }
+
+    ASSERT_EQ(statistics.kind(), StatisticsSink::Kind::Scalar);
+    EXPECT_EQ(statistics.trials(), expected.size());
+    const RunningStatistics &moments = statistics.periods()[0].moments;
+    EXPECT_NEAR(moments.mean, reference.mean, 1e-9);
+    EXPECT_NEAR(moments.stddev(), reference.stddev(), 1e-9);
+    EXPECT_EQ(moments.min, reference.min);
+    EXPECT_EQ(moments.max, reference.max);
+
+    write_results_to_csv("materialized.csv", expected);
+    EXPECT_EQ(read_file_content("streamed.csv"), read_file_content("materialized.csv"));
+    std::remove("streamed.csv");
+    std::remove("materialized.csv");
+}
+
+TEST_F(ResultSinkTest, SummarisesVectorOutputsPerPeriod)
+{
+    create_test_recipe("recipe.json", R"({"simulation_config": {"num_trials": 10},
+        "output_variable_index": 0, "variable_registry": ["A"],
+        "per_trial_steps": [{"type": "literal_assignment", "result": 0, "value": [1.0, 2.0, 3.0]}]})");
+    SimulationEngine engine("recipe.json");
+    StatisticsSink statistics;
+    engine.run({&statistics});
+
+    ASSERT_EQ(statistics.kind(), StatisticsSink::Kind::Vector);
+    ASSERT_EQ(statistics.periods().size(), 3u);
+    for (size_t p = 0; p < 3; ++p)
+    {
+        EXPECT_EQ(statistics.periods()[p].moments.count, 10u);
+        EXPECT_DOUBLE_EQ(statistics.periods()[p].moments.mean, p + 1.0);
+        EXPECT_DOUBLE_EQ(statistics.periods()[p].moments.stddev(), 0.0);
+        EXPECT_DOUBLE_EQ(statistics.periods()[p].quantiles.quantile(0.5), p + 1.0);
+    }
+}
+
+TEST_F(ResultSinkTest, CsvKeepsFullPrecision)
+{
+    const std::vector<TrialValue> results = {1.0 / 3.0, 1e-300, -2.5};
+    write_results_to_csv("precision.csv", results);
+    EXPECT_EQ(read_file_content("precision.csv"), "Result\n0.3333333333333333\n1e-300\n-2.5\n");
+    std::remove("precision.csv");
+}
+
+TEST_F(ResultSinkTest, WritesBinaryColumns)
+{
+    create_test_recipe("recipe.json", R"({"simulation_config": {"num_trials": 1000, "seed": 11, "threads": 3, "chunk_size": 64, "output_file": "results.bin"},
+        "output_variable_index": 1, "variable_registry": ["x", "v"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+            {"type": "execution_assignment", "result": [1], "function": "compose_vector", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 5}]}
+        ]})");
+    SimulationEngine engine("recipe.json");
+    ASSERT_EQ(engine.get_output_format(), OutputFormat::Binary);
+    const std::vector<TrialValue> expected = engine.run();
+    auto writer = make_result_writer(engine.get_output_file_path(), engine.get_output_format(), engine.get_seed());
+    engine.run({writer.get()});
+    writer.reset();
+
+    std::ifstream file("results.bin", std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(bytes.size(), BinaryResultWriter::HEADER_SIZE + 2 * 1000 * sizeof(double));
+    EXPECT_EQ(std::string(bytes.data(), 8), "VSERES01");
+    uint64_t trials = 0, columns = 0, seed = 0;
+    std::memcpy(&trials, bytes.data() + 16, 8);
+    std::memcpy(&columns, bytes.data() + 24, 8);
+    std::memcpy(&seed, bytes.data() + 32, 8);
+    EXPECT_EQ(trials, 1000u);
+    EXPECT_EQ(columns, 2u);
+    EXPECT_EQ(seed, 11u);
+
+    const double *data = reinterpret_cast<const double *>(bytes.data() + BinaryResultWriter::HEADER_SIZE);
+    for (size_t t = 0; t < 1000; ++t)
+    {
+        const auto &vec = std::get<std::vector<double>>(expected[t]);
+        ASSERT_EQ(data[t], vec[0]) << "trial " << t;
+        ASSERT_EQ(data[1000 + t], 5.0);
+    }
+    file.close();
+    std::remove("results.bin");
+}
+
+TEST_F(ResultSinkTest, WritesDistributionSummaries)
+{
+    create_test_recipe("recipe.json", R"({"simulation_config": {"num_trials": 20000, "seed": 11, "threads": 3, "chunk_size": 64, "output_file": "summary.json", "summary_bins": 10},
+        "output_variable_index": 1, "variable_registry": ["x", "v"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+            {"type": "execution_assignment", "result": [1], "function": "compose_vector", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 5}]}
+        ]})");
+    SimulationEngine engine("recipe.json");
+    ASSERT_EQ(engine.get_output_format(), OutputFormat::Summary);
+    const std::vector<TrialValue> results = engine.run();
+    auto writer = make_result_writer(engine.get_output_file_path(), engine.get_output_format(), engine.get_seed(), engine.get_summary_bins());
+    engine.run({writer.get()});
+    writer.reset();
+
+    // A few kilobytes, however many trials there are.
+    EXPECT_LT(read_file_content("summary.json").size(), 4096u);
+    const nlohmann::json summary = nlohmann::json::parse(read_file_content("summary.json"));
+    EXPECT_EQ(summary["format"], "vse-summary");
+    EXPECT_EQ(summary["seed"], 11);
+    EXPECT_EQ(summary["trials"], 20000);
+    ASSERT_EQ(summary["outputs"].size(), 1u);
+    const nlohmann::json &output = summary["outputs"][0];
+    EXPECT_EQ(output["name"], "v");
+    EXPECT_EQ(output["type"], "vector");
+    ASSERT_EQ(output["periods"].size(), 2u);
+
+    const nlohmann::json &uniform = output["periods"][0];
+    EXPECT_NEAR(uniform["mean"].get<double>(), 0.5, 0.01);
+    const auto edges = uniform["histogram"]["edges"].get<std::vector<double>>();
+    const auto counts = uniform["histogram"]["counts"].get<std::vector<double>>();
+    ASSERT_EQ(edges.size(), 11u);
+    ASSERT_EQ(counts.size(), 10u);
+    EXPECT_EQ(edges.front(), uniform["min"].get<double>());
+    EXPECT_EQ(edges.back(), uniform["max"].get<double>());
+    EXPECT_NEAR(std::accumulate(counts.begin(), counts.end(), 0.0), 20000.0, 1e-6);
+    std::vector<double> exact(10, 0.0);
+    for (const TrialValue &result : results)
+    {
+        const double x = std::get<std::vector<double>>(result)[0];
+        exact[std::min<size_t>(9, static_cast<size_t>((x - edges.front()) / (edges.back() - edges.front()) * 10))] += 1.0;
+    }
+    for (size_t b = 0; b < 10; ++b)
+        EXPECT_NEAR(counts[b], exact[b], 40.0) << "bin " << b;
+    const auto values = uniform["ecdf"]["values"].get<std::vector<double>>();
+    const auto probabilities = uniform["ecdf"]["probabilities"].get<std::vector<double>>();
+    ASSERT_EQ(values.size(), 11u);
+    EXPECT_EQ(values.front(), edges.front());
+    EXPECT_EQ(values.back(), edges.back());
+    EXPECT_NEAR(values[5], 0.5, 0.01);
+    EXPECT_DOUBLE_EQ(probabilities[5], 0.5);
+
+    const nlohmann::json &constant = output["periods"][1];
+    EXPECT_EQ(constant["percentiles"]["P50"], 5.0);
+    EXPECT_EQ(constant["histogram"]["counts"][0], 20000.0);
+    std::remove("summary.json");
+}
+
+TEST_F(ResultSinkTest, RejectsUnknownOutputFormat)
+{
+    create_test_recipe("recipe.json", R"({"simulation_config": {"num_trials": 1, "output_file": "out.dat", "output_format": "parquet"},
+        "output_variable_index": 0, "variable_registry": ["A"], "per_trial_steps": [{"type": "literal_assignment", "result": 0, "value": 1}]})");
+    try
+    {
+        SimulationEngine engine("recipe.json");
+        FAIL() << "Expected EngineException";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::RecipeConfigError);
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("Unknown output_format 'parquet'"));
+    }
+    EXPECT_EQ(parse_output_format("", "results.json"), OutputFormat::Summary);
+    EXPECT_EQ(parse_output_format("summary", "results.txt"), OutputFormat::Summary);
+    EXPECT_EQ(parse_output_format("", "results.csv"), OutputFormat::Csv);
+}
+
+// --- Multi-output runs ---
+class MultiOutputTest : public FileCleanupTest
+{
+protected:
+    // y = 2x and flag = x > 10, reported in the order y, x, flag.
+    void create_recipe(const std::string &config)
+    {
+        create_test_recipe("recipe.json", R"({"simulation_config": {"num_trials": 777, "seed": 3)" + config + R"(},
+            "output_variable_indices": [1, 0, 2], "variable_registry": ["x", "y", "flag", "unused"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": 10}, {"type": "scalar_literal", "value": 2}]},
+                {"type": "execution_assignment", "result": [1], "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]},
+                {"type": "execution_assignment", "result": [2], "function": "__gt__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 10}]},
+                {"type": "execution_assignment", "result": [3], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]}
+            ]})");
+    }
+};
+
+TEST_F(MultiOutputTest, CollectsEveryOutputFromTheSameDraws)
+{
+    for (const char *lane_width : {"1", "256"})
+    {
+        create_recipe(std::string(R"(, "threads": 3, "chunk_size": 50, "lane_width": )") + lane_width);
+        SimulationEngine engine("recipe.json");
+        EXPECT_EQ(engine.get_output_names(), (std::vector<std::string>{"y", "x", "flag"}));
+        const auto outputs = engine.run_outputs();
+        ASSERT_EQ(outputs.size(), 3u);
+        for (size_t t = 0; t < 777; ++t)
+        {
+            const double x = std::get<double>(outputs[1][t]);
+            ASSERT_EQ(std::get<double>(outputs[0][t]), 2.0 * x);
+            ASSERT_EQ(std::get<bool>(outputs[2][t]), x > 10.0);
+        }
+
+        // run() keeps returning the first output, and a single-output recipe draws the same x.
+        const auto first = engine.run();
+        ASSERT_EQ(first.size(), 777u);
+        EXPECT_EQ(std::get<double>(first[5]), std::get<double>(outputs[0][5]));
+    }
+}
+
+TEST_F(MultiOutputTest, PacksEveryOutputIntoADenseArray)
+{
+    create_recipe(R"(, "threads": 3, "chunk_size": 50)");
+    SimulationEngine engine("recipe.json");
+    const auto outputs = engine.run_outputs();
+    ArrayResultSink sink;
+    engine.run({&sink});
+    const std::vector<ArrayResultSink::Array> arrays = sink.take_arrays();
+    ASSERT_EQ(arrays.size(), 3u);
+    EXPECT_EQ(arrays[0].name, "y");
+    EXPECT_EQ(arrays[2].kind, ArrayResultSink::Kind::Boolean);
+    for (const ArrayResultSink::Array &array : arrays)
+    {
+        EXPECT_EQ(array.trials, 777u);
+        EXPECT_EQ(array.width, 1u);
+        ASSERT_EQ(array.values.size(), 777u);
+    }
+    for (size_t t = 0; t < 777; ++t)
+    {
+        ASSERT_EQ(arrays[1].values[t], std::get<double>(outputs[1][t]));
+        ASSERT_EQ(arrays[2].values[t], std::get<bool>(outputs[2][t]) ? 1.0 : 0.0);
+    }
+}
+
+TEST(ArrayResultSinkTest, StoresVectorsAsRowsAndMisfitsAsNaN)
+{
+    ArrayResultSink sink;
+    sink.begin(3);
+    const std::vector<TrialValue> trials = {std::vector<double>{1, 2}, std::vector<double>{3}, std::vector<double>{4, 5}};
+    sink.consume(0, trials.data(), 2);
+    sink.consume(2, trials.data() + 2, 1);
+    const std::vector<ArrayResultSink::Array> arrays = sink.take_arrays();
+    ASSERT_EQ(arrays.size(), 1u);
+    EXPECT_EQ(arrays[0].kind, ArrayResultSink::Kind::Vector);
+    EXPECT_EQ(arrays[0].width, 2u);
+    EXPECT_EQ(arrays[0].trials, 3u);
+    ASSERT_EQ(arrays[0].values.size(), 6u);
+    EXPECT_EQ(arrays[0].values[1], 2.0);
+    EXPECT_TRUE(std::isnan(arrays[0].values[2]) && std::isnan(arrays[0].values[3]));
+    EXPECT_EQ(arrays[0].values[5], 5.0);
+}
+
+TEST_F(MultiOutputTest, WritesOneCsvColumnPerOutput)
+{
+    create_recipe(R"(, "threads": 2, "chunk_size": 64, "output_file": "multi.csv")");
+    SimulationEngine engine("recipe.json");
+    const auto outputs = engine.run_outputs();
+
+    StatisticsSink y_statistics;
+    OutputColumnSink y_column(y_statistics, 0);
+    CsvResultWriter writer(engine.get_output_file_path());
+    engine.run({&y_column, &writer});
+    EXPECT_EQ(y_statistics.trials(), 777u);
+    EXPECT_NEAR(y_statistics.periods()[0].moments.mean, 20.0, 0.5);
+
+    std::ifstream file("multi.csv");
+    std::string line;
+    std::getline(file, line);
+    EXPECT_EQ(line, "y,x,flag");
+    std::getline(file, line);
+    EXPECT_DOUBLE_EQ(std::stod(line.substr(0, line.find(','))), std::get<double>(outputs[0][0]));
+    EXPECT_DOUBLE_EQ(std::stod(line.substr(line.find(',') + 1)), std::get<double>(outputs[1][0]));
+    EXPECT_EQ(line.substr(line.rfind(',') + 1), std::get<bool>(outputs[2][0]) ? "true" : "false");
+    file.close();
+    std::remove("multi.csv");
+}
+
+TEST_F(MultiOutputTest, DescribesEveryOutputInTheBinaryHeader)
+{
+    create_recipe(R"(, "output_file": "multi.bin")");
+    SimulationEngine engine("recipe.json");
+    const auto outputs = engine.run_outputs();
+    auto writer = make_result_writer(engine.get_output_file_path(), engine.get_output_format(), engine.get_seed());
+    engine.run({writer.get()});
+    writer.reset();
+
+    std::ifstream file("multi.bin", std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const size_t header_size = BinaryResultWriter::HEADER_SIZE + 3 * BinaryResultWriter::OUTPUT_DESCRIPTOR_SIZE;
+    ASSERT_EQ(bytes.size(), header_size + 3 * 777 * sizeof(double));
+    uint32_t stored_header_size = 0, num_outputs = 0, flag_kind = 0;
+    uint64_t columns = 0;
+    std::memcpy(&stored_header_size, bytes.data() + 8, 4);
+    std::memcpy(&columns, bytes.data() + 24, 8);
+    std::memcpy(&num_outputs, bytes.data() + 44, 4);
+    std::memcpy(&flag_kind, bytes.data() + BinaryResultWriter::HEADER_SIZE + 2 * BinaryResultWriter::OUTPUT_DESCRIPTOR_SIZE, 4);
+    EXPECT_EQ(stored_header_size, header_size);
+    EXPECT_EQ(columns, 3u);
+    EXPECT_EQ(num_outputs, 3u);
+    EXPECT_EQ(flag_kind, 2u);
+
+    const double *data = reinterpret_cast<const double *>(bytes.data() + header_size);
+    for (size_t t = 0; t < 777; ++t)
+    {
+        ASSERT_EQ(data[t], std::get<double>(outputs[0][t]));
+        ASSERT_EQ(data[777 + t], std::get<double>(outputs[1][t]));
+        ASSERT_EQ(data[2 * 777 + t], std::get<bool>(outputs[2][t]) ? 1.0 : 0.0);
+    }
+    file.close();
+    std::remove("multi.bin");
+}
+
+// --- Runs with a precision target ---
+class PrecisionTargetTest : public FileCleanupTest
+{
+protected:
+    // Normal(10, 2): a standard error of 0.02 takes about 10000 trials.
+    void create_recipe(const std::string &target, const std::string &config = std::string())
+    {
+        create_test_recipe("recipe.json", R"({"simulation_config": {"num_trials": 500, "seed": 5, "threads": 3, "target_precision": )" + target + config + R"(},
+            "output_variable_index": 0, "variable_registry": ["A"],
+            "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": 10}, {"type": "scalar_literal", "value": 2}]}]})");
+    }
+};
+
+TEST_F(PrecisionTargetTest, RunsUntilTheStandardErrorIsMet)
+{
+    create_recipe("0.02", R"(, "output_file": "adaptive.bin")");
+    SimulationEngine engine("recipe.json");
+    ResultCollector collector;
+    StatisticsSink statistics;
+    auto writer = make_result_writer(engine.get_output_file_path(), engine.get_output_format(), engine.get_seed());
+    const RunReport report = engine.run({&collector, &statistics, writer.get()});
+    writer.reset();
+
+    EXPECT_TRUE(report.converged);
+    EXPECT_GT(report.rounds, 1u);
+    EXPECT_GE(report.trials, 8000u);
+    EXPECT_LT(report.trials, 20000u);
+    EXPECT_LE(report.standard_error, 0.02);
+    EXPECT_EQ(statistics.trials(), report.trials);
+    EXPECT_LE(statistics.periods()[0].moments.standard_error(), 0.02);
+    ASSERT_EQ(collector.results().size(), report.trials);
+
+    // Later rounds continue the trial sequence, so the results are those of a fixed-size run.
+    create_test_recipe("fixed.json", R"({"simulation_config": {"num_trials": )" + std::to_string(report.trials) + R"(, "seed": 5},
+        "output_variable_index": 0, "variable_registry": ["A"],
+        "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": 10}, {"type": "scalar_literal", "value": 2}]}]})");
+    const std::vector<TrialValue> expected = SimulationEngine("fixed.json").run();
+    std::ifstream file("adaptive.bin", std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(bytes.size(), BinaryResultWriter::HEADER_SIZE + report.trials * sizeof(double));
+    uint64_t trials = 0;
+    std::memcpy(&trials, bytes.data() + 16, 8);
+    EXPECT_EQ(trials, report.trials);
+    const double *data = reinterpret_cast<const double *>(bytes.data() + BinaryResultWriter::HEADER_SIZE);
+    for (size_t t = 0; t < report.trials; ++t)
+    {
+        ASSERT_EQ(std::get<double>(collector.results()[t]), std::get<double>(expected[t])) << "trial " << t;
+        ASSERT_EQ(data[t], std::get<double>(expected[t])) << "trial " << t;
+    }
+    file.close();
+    std::remove("adaptive.bin");
+    std::remove("fixed.json");
+}
+
+TEST_F(PrecisionTargetTest, StopsAtMaxTrials)
+{
+    create_recipe(R"({"standard_error": 0.0001})", R"(, "max_trials": 3000)");
+    SimulationEngine engine("recipe.json");
+    const auto outputs = engine.run_outputs();
+    ASSERT_EQ(outputs[0].size(), 3000u);
+
+    StatisticsSink statistics;
+    const RunReport report = engine.run({&statistics});
+    EXPECT_FALSE(report.converged);
+    EXPECT_EQ(report.trials, 3000u);
+    EXPECT_EQ(statistics.trials(), 3000u);
+    EXPECT_GT(report.standard_error, 0.0001);
+}
+
+TEST_F(PrecisionTargetTest, TargetsRelativeErrorsAndQuantiles)
+{
+    create_recipe(R"({"relative_error": 0.001, "quantile": 0.95, "ci_width": 0.1})");
+    SimulationEngine engine("recipe.json");
+    StatisticsSink statistics;
+    const RunReport report = engine.run({&statistics});
+    EXPECT_TRUE(report.converged);
+    EXPECT_LE(report.relative_error, 0.001);
+    EXPECT_LE(report.quantile_ci_width, 0.1);
+    EXPECT_LE(statistics.periods()[0].quantiles.confidence_width(0.95), 0.1);
+}
+
+TEST_F(PrecisionTargetTest, RejectsInvalidTargets)
+{
+    for (const std::string &config : {std::string("0"), std::string(R"({"quantile": 1.5, "ci_width": 0.1})"), std::string(R"(0.01, "variance_reduction": "lhs")")})
+    {
+        create_recipe(config);
+        try
+        {
+            SimulationEngine engine("recipe.json");
+            FAIL() << "Expected EngineException for " << config;
+        }
+        catch (const EngineException &e)
+        {
+            EXPECT_EQ(e.code(), EngineErrc::RecipeConfigError);
+        }
+    }
+}
@@ -78,4 +78,60 @@ TEST_F(EnginePreviewModeTest, OutputsErrorJsonOnRuntimeError)
     EXPECT_EQ(json_out["status"], "error");
     ASSERT_TRUE(json_out.contains("message"));
     EXPECT_THAT(json_out["message"].get<std::string>(), ::testing::HasSubstr("L42: In function 'divide': Division by zero"));
-}
\ No newline at end of file
+}
+TEST_F(EnginePreviewModeTest, TakesNoTrialsForValuesFixedBeforeTheTrials)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 100000}, "output_variable_index": 1, "variable_registry":["a", "b"],
+        "pre_trial_steps": [{"type": "literal_assignment", "result": 0, "value": 2.5}],
+        "per_trial_steps": [{"type": "execution_assignment", "result": [1], "function": "multiply", "args": [{"type":"variable_index","value":0},{"type":"scalar_literal","value":4}]}]
+    })";
+    create_test_recipe("preview_test.json", recipe);
+    SimulationEngine engine("preview_test.json", true);
+    const PreviewResult preview = engine.preview();
+    ASSERT_TRUE(preview.value);
+    EXPECT_DOUBLE_EQ(std::get<double>(*preview.value), 10.0);
+    EXPECT_EQ(preview.trials, 0u);
+    EXPECT_TRUE(preview.converged);
+}
+
+TEST_F(EnginePreviewModeTest, EvaluatesDeterministicStepsWithoutTrials)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 100000}, "output_variable_index": 1, "variable_registry":["a", "b"],
+        "per_trial_steps": [
+            {"type": "literal_assignment", "result": 0, "value": 3},
+            {"type": "execution_assignment", "result": [1], "function": "add", "args": [{"type":"variable_index","value":0},{"type":"scalar_literal","value":1}]}
+        ]
+    })";
+    create_test_recipe("preview_test.json", recipe);
+    SimulationEngine engine("preview_test.json", true);
+    const PreviewResult preview = engine.preview();
+    ASSERT_TRUE(preview.value);
+    EXPECT_DOUBLE_EQ(std::get<double>(*preview.value), 4.0);
+    EXPECT_EQ(preview.trials, 0u);
+}
+
+TEST_F(EnginePreviewModeTest, StopsSamplingOnceTheMeanHasSettled)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 1000000, "seed": 11}, "output_variable_index": 0, "variable_registry":["a"],
+        "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type":"scalar_literal","value":100},{"type":"scalar_literal","value":5}]}]
+    })";
+    create_test_recipe("preview_test.json", recipe);
+    SimulationEngine engine("preview_test.json", true);
+
+    const PreviewResult settled = engine.preview();
+    ASSERT_TRUE(settled.value);
+    EXPECT_TRUE(settled.converged);
+    EXPECT_GE(settled.trials, PreviewOptions().min_trials);
+    EXPECT_LT(settled.trials, PreviewOptions().max_trials);
+    EXPECT_NEAR(std::get<double>(*settled.value), 100.0, 1.0);
+
+    PreviewOptions strict;
+    strict.max_trials = 500;
+    strict.relative_ci_width = 1e-6;
+    const PreviewResult capped = engine.preview(strict);
+    EXPECT_FALSE(capped.converged);
+    EXPECT_EQ(capped.trials, 500u);
+}
@@ -0,0 +1,248 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/Profiler.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <sstream>
+
+namespace
+{
+    // Lines 3, 4 and 6: a draw, a comparison and a conditional over both.
+    std::string profiled_recipe(size_t lane_width, size_t trials)
+    {
+        return R"({
+            "simulation_config": {"num_trials": )" +
+               std::to_string(trials) + R"(, "lane_width": )" + std::to_string(lane_width) + R"(, "seed": 7},
+            "output_variable_index": 2, "variable_registry": ["x", "high", "result"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "line": 3, "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+                {"type": "execution_assignment", "result": [1], "line": 4, "function": "__gt__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0}]},
+                {"type": "conditional_assignment", "result": 2, "line": 6,
+                    "condition": {"type": "variable_index", "value": 1},
+                    "then_expr": {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]},
+                    "else_expr": {"type": "execution_assignment", "function": "exp", "args": [{"type": "variable_index", "value": 0}]}
+                }
+            ]
+        })";
+    }
+
+    std::unique_ptr<SimulationEngine> profiled_engine(size_t lane_width, size_t trials, size_t threads)
+    {
+        auto engine = SimulationEngine::from_recipe_text(profiled_recipe(lane_width, trials));
+        SchedulerConfig config = engine->get_scheduler_config();
+        config.threads = threads;
+        config.chunk_size = 64;
+        engine->set_scheduler_config(config);
+        engine->set_profiling(true);
+        return engine;
+    }
+}
+
+class ProfilerTest : public FileCleanupTest
+{
+};
+
+TEST_F(ProfilerTest, CountsAllocationsOfTheCallingThread)
+{
+    const uint64_t before = thread_allocation_count();
+    auto value = std::make_unique<std::vector<double>>(100, 1.0);
+    EXPECT_EQ(thread_allocation_count() - before, 2u);
+}
+
+TEST_F(ProfilerTest, StreamingToSinksDoesNotAllocatePerChunk)
+{
+    class CountingSink : public ResultSink
+    {
+    public:
+        void consume(size_t, const TrialValue *, size_t count) override { trials += count; }
+        std::atomic<size_t> trials{0};
+    };
+    // On one thread every chunk runs on the calling thread, which counts its allocations.
+    auto allocations = [](size_t chunk_size)
+    {
+        auto engine = SimulationEngine::from_recipe_text(profiled_recipe(0, 4096));
+        SchedulerConfig config = engine->get_scheduler_config();
+        config.threads = 1;
+        config.chunk_size = chunk_size;
+        engine->set_scheduler_config(config);
+        CountingSink sink;
+        engine->run({&sink});
+        const uint64_t before = thread_allocation_count();
+        engine->run({&sink});
+        const uint64_t count = thread_allocation_count() - before;
+        EXPECT_EQ(sink.trials.load(), 2 * 4096u);
+        return count;
+    };
+    // 8 chunks against 512: what remains is the setup of each window of chunks.
+    const uint64_t coarse = allocations(512);
+    const uint64_t fine = allocations(8);
+    EXPECT_LT(fine - coarse, (512u - 8u) / 4);
+}
+
+TEST_F(ProfilerTest, SensitivityRunsDoNotCopyTheContextPerTrial)
+{
+    // One chunk on one thread: only per-trial work can make the count grow with the trials.
+    auto allocations = [](size_t trials)
+    {
+        nlohmann::json recipe = nlohmann::json::parse(profiled_recipe(0, trials));
+        recipe["variable_registry"].push_back("scale");
+        recipe["pre_trial_steps"] = nlohmann::json::parse(R"([{"type": "literal_assignment", "result": 3, "value": 2}])");
+        recipe["per_trial_steps"][2]["then_expr"]["args"][1] = {{"type", "variable_index"}, {"value", 3}};
+        recipe["simulation_config"]["sensitivity"] = nlohmann::json::parse(R"([{"variable": "scale", "low": 1, "high": 3}, {"variable": "x", "low": -1, "high": 1}])");
+        auto engine = SimulationEngine::from_recipe_text(recipe.dump());
+        SchedulerConfig config = engine->get_scheduler_config();
+        config.threads = 1;
+        config.chunk_size = trials;
+        engine->set_scheduler_config(config);
+        const uint64_t before = thread_allocation_count();
+        const SensitivityReport report = engine->run_sensitivity();
+        const uint64_t count = thread_allocation_count() - before;
+        EXPECT_GT(report.bars[0].swing(), 0.0);
+        return count;
+    };
+    const uint64_t few = allocations(512);
+    const uint64_t many = allocations(4096);
+    EXPECT_LT(many, few + 64);
+}
+
+TEST_F(ProfilerTest, SeriesTemporariesDoNotAllocatePerTrial)
+{
+    // irr and npv over two instruments write into their slots' storage and take their
+    // temporaries from the thread's arena: only the first trial allocates.
+    auto engine = SimulationEngine::from_recipe_text(R"({
+        "simulation_config": {"num_trials": 4096, "seed": 3, "threads": 1},
+        "output_variable_index": 3, "variable_registry": ["x", "flows", "rates", "npvs"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 50}, {"type": "scalar_literal", "value": 70}]},
+            {"type": "execution_assignment", "result": [1], "function": "compose_vector", "args": [
+                {"type": "scalar_literal", "value": -100}, {"type": "scalar_literal", "value": -50},
+                {"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 30},
+                {"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 30}]},
+            {"type": "execution_assignment", "result": [2], "function": "irr", "args": [{"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 2}]},
+            {"type": "execution_assignment", "result": [3], "function": "npv", "args": [{"type": "variable_index", "value": 2}, {"type": "variable_index", "value": 1}]}
+        ]
+    })");
+    engine->set_profiling(true);
+    engine->run();
+    const StepProfile *profile = engine->get_profile();
+    ASSERT_NE(profile, nullptr);
+    uint64_t allocations = 0;
+    for (const StepTiming &timing : profile->timings())
+    {
+        allocations += timing.allocations;
+    }
+    EXPECT_LT(allocations, 16u);
+}
+
+TEST_F(ProfilerTest, IsOffUnlessEnabled)
+{
+    auto engine = SimulationEngine::from_recipe_text(profiled_recipe(0, 10));
+    engine->run();
+    EXPECT_EQ(engine->get_profile(), nullptr);
+}
+
+TEST_F(ProfilerTest, ScalarInterpreterChargesEveryTrialToEachTopLevelStep)
+{
+    auto engine = profiled_engine(0, 300, 2);
+    engine->run();
+    const StepProfile *profile = engine->get_profile();
+    ASSERT_NE(profile, nullptr);
+
+    size_t steps = 0;
+    for (const StepTiming &timing : profile->timings())
+    {
+        if (timing.runs == 0)
+            continue;
+        ++steps;
+        EXPECT_EQ(timing.runs, 300u);
+    }
+    EXPECT_EQ(steps, 3u);
+    EXPECT_GT(profile->total_nanoseconds(), 0u);
+
+    size_t trials = 0;
+    for (const ChunkSpan &chunk : profile->chunks())
+    {
+        EXPECT_LT(chunk.worker, 2u);
+        EXPECT_LE(chunk.begin, chunk.end);
+        trials += chunk.trials;
+    }
+    EXPECT_EQ(trials, 300u);
+}
+
+TEST_F(ProfilerTest, BatchedProgramChargesEveryBlockToEachTopLevelStep)
+{
+    auto engine = profiled_engine(64, 256, 1);
+    engine->run();
+    const StepProfile *profile = engine->get_profile();
+    ASSERT_NE(profile, nullptr);
+
+    size_t steps = 0;
+    for (const StepTiming &timing : profile->timings())
+    {
+        if (timing.runs == 0)
+            continue;
+        ++steps;
+        EXPECT_EQ(timing.runs, 4u);
+    }
+    EXPECT_EQ(steps, 3u);
+    EXPECT_EQ(profile->chunks().size(), 4u);
+}
+
+TEST_F(ProfilerTest, ProfileOfEachRunReplacesTheLast)
+{
+    auto engine = profiled_engine(0, 100, 1);
+    engine->run();
+    engine->run();
+    for (const StepTiming &timing : engine->get_profile()->timings())
+    {
+        EXPECT_TRUE(timing.runs == 0 || timing.runs == 100u);
+    }
+}
+
+TEST_F(ProfilerTest, ReportListsStepsWithTheirLines)
+{
+    auto engine = profiled_engine(0, 100, 1);
+    engine->run();
+    std::ostringstream report;
+    engine->get_profile()->print_report(report);
+    const std::string text = report.str();
+    EXPECT_THAT(text, ::testing::HasSubstr("Per-Step Profile"));
+    EXPECT_THAT(text, ::testing::ContainsRegex("3  Normal"));
+    EXPECT_THAT(text, ::testing::ContainsRegex("4  __gt__"));
+    EXPECT_THAT(text, ::testing::ContainsRegex("6  if"));
+    EXPECT_THAT(text, ::testing::HasSubstr("3 step(s)"));
+}
+
+TEST_F(ProfilerTest, ChromeTraceHasOneCompleteEventPerChunk)
+{
+    auto engine = profiled_engine(0, 256, 2);
+    engine->run();
+    std::ostringstream trace;
+    engine->get_profile()->write_chrome_trace(trace);
+    const nlohmann::json document = nlohmann::json::parse(trace.str());
+    ASSERT_TRUE(document.contains("traceEvents"));
+    size_t spans = 0;
+    size_t trials = 0;
+    for (const auto &event : document["traceEvents"])
+    {
+        if (event["ph"] != "X")
+            continue;
+        ++spans;
+        EXPECT_GE(event["ts"].get<double>(), 0.0);
+        EXPECT_GE(event["dur"].get<double>(), 0.0);
+        trials += event["args"]["trials"].get<size_t>();
+    }
+    EXPECT_EQ(spans, engine->get_profile()->chunks().size());
+    EXPECT_EQ(trials, 256u);
+}
+
+TEST_F(ProfilerTest, CliPrintsTheReportAndWritesTheTrace)
+{
+    create_test_recipe("profile_test.json", profiled_recipe(0, 200));
+    const std::string command = std::string(VSE_EXECUTABLE_PATH) + " --profile --trace profile_trace.json profile_test.json";
+    const std::string output = exec_command(command.c_str());
+    EXPECT_THAT(output, ::testing::HasSubstr("Per-Step Profile"));
+    EXPECT_THAT(output, ::testing::HasSubstr("Trace written to 'profile_trace.json'"));
+    EXPECT_TRUE(nlohmann::json::parse(read_file_content("profile_trace.json")).contains("traceEvents"));
+    std::remove("profile_test.json");
+    std::remove("profile_trace.json");
+}
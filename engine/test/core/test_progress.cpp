@@ -0,0 +1,171 @@
+#include "test/test_helpers.h"
+#include "include/engine/io/Progress.h"
+#include "include/engine/io/EngineServer.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <sstream>
+
+namespace
+{
+    std::string normal_recipe(size_t trials, const std::string &extra_steps = "", size_t output = 0)
+    {
+        return R"({
+            "simulation_config": {"num_trials": )" +
+               std::to_string(trials) + R"(, "seed": 11},
+            "output_variable_index": )" + std::to_string(output) + R"(, "variable_registry": ["x", "y"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "line": 1, "function": "Normal", "args": [{"type": "scalar_literal", "value": 5}, {"type": "scalar_literal", "value": 2}]})" +
+               extra_steps + R"(
+            ]
+        })";
+    }
+
+    std::unique_ptr<SimulationEngine> engine_with_threads(const std::string &recipe, size_t threads)
+    {
+        auto engine = SimulationEngine::from_recipe_text(recipe);
+        SchedulerConfig config = engine->get_scheduler_config();
+        config.threads = threads;
+        config.chunk_size = 100;
+        engine->set_scheduler_config(config);
+        return engine;
+    }
+}
+
+class ProgressTest : public FileCleanupTest
+{
+};
+
+TEST_F(ProgressTest, CountsEveryTrialAndMatchesTheFinalStatistics)
+{
+    auto engine = engine_with_threads(normal_recipe(5000), 4);
+    ProgressSink progress;
+    const std::vector<StatisticsSink> statistics = run_with_statistics(*engine, nullptr, {&progress});
+
+    const ProgressSnapshot snapshot = progress.snapshot();
+    EXPECT_TRUE(snapshot.finished);
+    EXPECT_EQ(snapshot.trials, 5000u);
+    EXPECT_EQ(snapshot.total_trials, 5000u);
+    EXPECT_EQ(snapshot.errors, 0u);
+    EXPECT_DOUBLE_EQ(snapshot.eta_seconds(), 0.0);
+    ASSERT_EQ(snapshot.statistics.count, 5000u);
+    const RunningStatistics &expected = statistics[0].periods()[0].moments;
+    EXPECT_NEAR(snapshot.statistics.mean, expected.mean, 1e-9);
+    EXPECT_NEAR(snapshot.statistics.stddev(), expected.stddev(), 1e-9);
+    EXPECT_DOUBLE_EQ(snapshot.statistics.min, expected.min);
+    EXPECT_DOUBLE_EQ(snapshot.statistics.max, expected.max);
+}
+
+TEST_F(ProgressTest, CountsChunksThatFail)
+{
+    // Every trial divides by zero.
+    const std::string failing = R"(,
+                {"type": "execution_assignment", "result": [1], "line": 2, "function": "divide", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0}]})";
+    auto engine = engine_with_threads(normal_recipe(1000, failing, 1), 1);
+    ProgressSink progress;
+    EXPECT_THROW(run_with_statistics(*engine, nullptr, {&progress}), EngineException);
+    const ProgressSnapshot snapshot = progress.snapshot();
+    EXPECT_FALSE(snapshot.finished);
+    EXPECT_EQ(snapshot.trials, 0u);
+    EXPECT_EQ(snapshot.errors, 1u);
+}
+
+TEST_F(ProgressTest, ReporterPublishesWhileRunningAndOnceMoreWhenStopped)
+{
+    ProgressSink progress;
+    progress.begin(100);
+    std::atomic<size_t> periodic{0};
+    std::atomic<size_t> last{0};
+    ProgressSnapshot final_snapshot;
+    {
+        ProgressReporter reporter(progress, std::chrono::milliseconds(1), [&](const ProgressSnapshot &snapshot, bool is_last)
+                                  {
+            if (is_last)
+            {
+                ++last;
+                final_snapshot = snapshot;
+            }
+            else
+            {
+                ++periodic;
+            } });
+        std::vector<TrialValue> values(100, 1.5);
+        progress.consume(0, values.data(), 100);
+        progress.finish();
+        while (periodic.load() == 0)
+            std::this_thread::yield();
+    }
+    EXPECT_EQ(last.load(), 1u);
+    EXPECT_TRUE(final_snapshot.finished);
+    EXPECT_EQ(final_snapshot.trials, 100u);
+    EXPECT_DOUBLE_EQ(final_snapshot.statistics.mean, 1.5);
+}
+
+TEST_F(ProgressTest, ExtendRaisesTheTotal)
+{
+    ProgressSink progress;
+    progress.begin(100);
+    progress.extend(400);
+    std::vector<TrialValue> values(100, 1.0);
+    progress.consume(0, values.data(), 100);
+    const ProgressSnapshot snapshot = progress.snapshot();
+    EXPECT_EQ(snapshot.total_trials, 400u);
+    EXPECT_GE(snapshot.eta_seconds(), 0.0);
+}
+
+TEST_F(ProgressTest, FormatsABarAndJsonLines)
+{
+    ProgressSnapshot snapshot;
+    snapshot.trials = 500;
+    snapshot.total_trials = 1000;
+    snapshot.elapsed_seconds = 2.0;
+    snapshot.statistics.add(1.0);
+    snapshot.statistics.add(3.0);
+
+    const std::string bar = format_progress_bar(snapshot);
+    EXPECT_THAT(bar, ::testing::StartsWith("[##########----------]  50.0%  500/1000 trials  250 trials/s  ETA 0:00:02"));
+    EXPECT_THAT(bar, ::testing::HasSubstr("mean 2"));
+
+    const nlohmann::json line = progress_to_json(snapshot);
+    EXPECT_EQ(line["event"], "progress");
+    EXPECT_EQ(line["trials"], 500);
+    EXPECT_EQ(line["total_trials"], 1000);
+    EXPECT_DOUBLE_EQ(line["trials_per_second"].get<double>(), 250.0);
+    EXPECT_DOUBLE_EQ(line["eta"].get<double>(), 2.0);
+    EXPECT_DOUBLE_EQ(line["mean"].get<double>(), 2.0);
+
+    ProgressSnapshot empty;
+    EXPECT_TRUE(progress_to_json(empty)["eta"].is_null());
+    EXPECT_FALSE(progress_to_json(empty).contains("mean"));
+}
+
+TEST_F(ProgressTest, CliWritesJsonLinesToADescriptor)
+{
+    create_test_recipe("progress_test.json", normal_recipe(2000));
+    const std::string command = std::string(VSE_EXECUTABLE_PATH) + " --progress-fd 3 --progress-interval 1 progress_test.json 3>progress_lines.jsonl";
+    exec_command(command.c_str());
+
+    std::istringstream lines(read_file_content("progress_lines.jsonl"));
+    std::string text;
+    nlohmann::json last;
+    size_t count = 0;
+    while (std::getline(lines, text))
+    {
+        last = nlohmann::json::parse(text);
+        ++count;
+    }
+    ASSERT_GE(count, 1u);
+    EXPECT_EQ(last["event"], "finished");
+    EXPECT_EQ(last["trials"], 2000);
+    EXPECT_TRUE(last.contains("mean"));
+    std::remove("progress_test.json");
+    std::remove("progress_lines.jsonl");
+}
+
+TEST_F(ProgressTest, CliDrawsTheBarOnStderr)
+{
+    create_test_recipe("progress_test.json", normal_recipe(2000));
+    const std::string command = std::string(VSE_EXECUTABLE_PATH) + " --progress progress_test.json 2>&1 >/dev/null";
+    const std::string output = exec_command(command.c_str());
+    EXPECT_THAT(output, ::testing::HasSubstr("100.0%  2000/2000 trials"));
+    std::remove("progress_test.json");
+}
@@ -0,0 +1,102 @@
+#include "test/test_helpers.h"
+#include <filesystem>
+
+class ResultCacheTest : public FileCleanupTest
+{
+protected:
+    // Relative to the test's own directory, which FileCleanupTest removes afterwards.
+    static constexpr const char *CACHE_DIR = "result_cache_test";
+
+    // Slots: x ~ N(10, 2), factor (pre-trial), path = grow_series(x, 0.05, 3), y = x * factor.
+    // The outputs are y and path.
+    static std::string recipe(const std::string &config, double factor, const std::string &y_step)
+    {
+        return R"({"simulation_config": {"num_trials": 1000, "threads": 3, "chunk_size": 41)" + config + R"(},
+            "output_variable_indices": [3, 2], "variable_registry": ["x", "factor", "path", "y"],
+            "pre_trial_steps": [{"type": "literal_assignment", "result": 1, "value": )" + std::to_string(factor) + R"(}],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": 10}, {"type": "scalar_literal", "value": 2}], "line": 1},
+                {"type": "execution_assignment", "result": [2], "function": "grow_series", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0.05}, {"type": "scalar_literal", "value": 3}], "line": 2},
+                )" + y_step + R"(
+            ]})";
+    }
+
+    static std::string scaled_y()
+    {
+        return R"({"type": "execution_assignment", "result": [3], "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}], "line": 3})";
+    }
+
+    static std::string shifted_y()
+    {
+        return R"({"type": "execution_assignment", "result": [3], "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}], "line": 3})";
+    }
+
+    static std::string cached(uint64_t seed)
+    {
+        return R"(, "seed": )" + std::to_string(seed) + R"(, "cache_dir": ")" + CACHE_DIR + R"(")";
+    }
+
+    static std::unique_ptr<SimulationEngine> engine_for(const std::string &text)
+    {
+        create_test_recipe("recipe.json", text);
+        return std::make_unique<SimulationEngine>("recipe.json");
+    }
+};
+
+TEST_F(ResultCacheTest, RerunLoadsTheOutputsFromTheCache)
+{
+    auto first = engine_for(recipe(cached(5), 2.0, scaled_y()));
+    ASSERT_TRUE(first->uses_result_cache());
+    EXPECT_EQ(first->get_cached_step_count(), 0u);
+    const auto expected = first->run_outputs();
+    EXPECT_FALSE(std::filesystem::is_empty(CACHE_DIR));
+
+    // Only the steps assigning the outputs are loaded; the sampler feeding them is not needed.
+    auto second = engine_for(recipe(cached(5), 2.0, scaled_y()));
+    EXPECT_EQ(second->get_cached_step_count(), 2u);
+    EXPECT_EQ(second->run_outputs(), expected);
+}
+
+TEST_F(ResultCacheTest, EditedStepsRerunOnTheCachedDraws)
+{
+    auto first = engine_for(recipe(cached(5), 2.0, scaled_y()));
+    StatisticsSink statistics;
+    first->run({&statistics});
+
+    // Line numbers and the edited step do not change the keys of the steps before it.
+    std::string edited = recipe(cached(5), 2.0, shifted_y());
+    edited.replace(edited.find(R"("line": 1)"), 9, R"("line": 7)");
+    auto second = engine_for(edited);
+    EXPECT_EQ(second->get_cached_step_count(), 2u);
+    const auto results = second->run_outputs();
+
+    auto uncached = engine_for(recipe(R"(, "seed": 5)", 2.0, shifted_y()));
+    EXPECT_FALSE(uncached->uses_result_cache());
+    EXPECT_EQ(results, uncached->run_outputs());
+}
+
+TEST_F(ResultCacheTest, KeysFollowPreTrialValuesAndTheSeed)
+{
+    engine_for(recipe(cached(5), 2.0, scaled_y()))->run_outputs();
+
+    // A new factor only changes y: x and path still load.
+    auto new_factor = engine_for(recipe(cached(5), 3.0, scaled_y()));
+    EXPECT_EQ(new_factor->get_cached_step_count(), 2u);
+    auto uncached = engine_for(recipe(R"(, "seed": 5)", 3.0, scaled_y()));
+    EXPECT_EQ(new_factor->run_outputs(), uncached->run_outputs());
+
+    auto new_seed = engine_for(recipe(cached(6), 2.0, scaled_y()));
+    EXPECT_EQ(new_seed->get_cached_step_count(), 0u);
+}
+
+TEST_F(ResultCacheTest, MoreTrialsThanCachedRecompute)
+{
+    engine_for(recipe(cached(5), 2.0, scaled_y()))->run_outputs();
+
+    std::string larger = recipe(cached(5), 2.0, scaled_y());
+    larger.replace(larger.find("1000"), 4, "2000");
+    EXPECT_EQ(engine_for(larger)->get_cached_step_count(), 0u);
+    std::string smaller = recipe(cached(5), 2.0, scaled_y());
+    smaller.replace(smaller.find("1000"), 4, "500");
+    EXPECT_EQ(engine_for(smaller)->get_cached_step_count(), 2u);
+}
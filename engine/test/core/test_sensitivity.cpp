@@ -0,0 +1,138 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/StepGraph.h"
+
+class SensitivityTest : public FileCleanupTest
+{
+protected:
+    // Slots: rate, factor = 1 + rate (pre-trial), noise ~ U(0, 1), x ~ N(10, 2), y = x * factor,
+    // w = y * (1 + rate) + noise, unrelated ~ U(0, 1). The output is w.
+    static std::string recipe(const std::string &rate, const std::string &x_step, const std::string &sensitivity)
+    {
+        return R"({"simulation_config": {"num_trials": 2000, "seed": 9, "threads": 3, "chunk_size": 37)" + sensitivity + R"(},
+            "output_variable_index": 5, "variable_registry": ["rate", "factor", "noise", "x", "y", "w", "unrelated"],
+            "pre_trial_steps": [
+                {"type": "literal_assignment", "result": 0, "value": )" + rate + R"(},
+                {"type": "execution_assignment", "result": [1], "function": "add", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 0}]}
+            ],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [2], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+                )" + x_step + R"(,
+                {"type": "execution_assignment", "result": [4], "function": "multiply", "args": [{"type": "variable_index", "value": 3}, {"type": "variable_index", "value": 1}]},
+                {"type": "execution_assignment", "result": [5], "function": "add", "args": [
+                    {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 4},
+                        {"type": "execution_assignment", "function": "add", "args": [{"type": "scalar_literal", "value": 1}, {"type": "variable_index", "value": 0}]}]},
+                    {"type": "variable_index", "value": 2}]},
+                {"type": "execution_assignment", "result": [6], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]}
+            ]})";
+    }
+
+    static std::string sampled_x()
+    {
+        return R"({"type": "execution_assignment", "result": [3], "function": "Normal", "args": [{"type": "scalar_literal", "value": 10}, {"type": "scalar_literal", "value": 2}]})";
+    }
+
+    static std::string fixed_x(double value)
+    {
+        return R"({"type": "literal_assignment", "result": 3, "value": )" + std::to_string(value) + "}";
+    }
+
+    // Mean of the output of a plain run of `text`.
+    static double mean_of(const std::string &text)
+    {
+        create_test_recipe("variant.json", text);
+        SimulationEngine engine("variant.json");
+        StatisticsSink statistics;
+        engine.run({&statistics});
+        std::remove("variant.json");
+        return statistics.periods()[0].moments.mean;
+    }
+};
+
+TEST(StepGraphDownstreamTest, FollowsReadsThroughLaterSteps)
+{
+    const nlohmann::json steps = nlohmann::json::parse(R"([
+        {"type": "literal_assignment", "result": 0, "value": 1},
+        {"type": "execution_assignment", "result": [1], "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+        {"type": "execution_assignment", "result": [2], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+        {"type": "execution_assignment", "result": [3], "function": "multiply", "args": [{"type": "variable_index", "value": 1}, {"type": "variable_index", "value": 2}]}
+    ])");
+    const StepGraph graph(steps);
+    std::vector<size_t> changed = {0};
+    EXPECT_EQ(graph.downstream(changed), (std::vector<bool>{false, true, false, true}));
+    EXPECT_EQ(changed, (std::vector<size_t>{0, 1, 3}));
+
+    changed = {2};
+    EXPECT_EQ(graph.downstream(changed), (std::vector<bool>{false, false, false, true}));
+}
+
+TEST_F(SensitivityTest, MatchesRerunsWithTheInputsOverridden)
+{
+    create_test_recipe("recipe.json", recipe("0.1", sampled_x(), R"(, "sensitivity": [
+        {"variable": "rate", "low": 0.0, "high": 0.3},
+        {"slot": 3, "low": 8, "high": 12},
+        {"variable": "unrelated", "low": -5, "high": 5}])"));
+    SimulationEngine engine("recipe.json");
+    ASSERT_TRUE(engine.has_sensitivity_inputs());
+    const SensitivityReport report = engine.run_sensitivity();
+
+    EXPECT_EQ(report.trials, 2000u);
+    EXPECT_NEAR(report.base.moments.mean, mean_of(recipe("0.1", sampled_x(), "")), 1e-9);
+    ASSERT_EQ(report.bars.size(), 3u);
+
+    // Widest first: rate moves the mean of w from about 10 to 16.9, x from 9.7 to 14.5.
+    EXPECT_EQ(report.bars[0].name, "rate");
+    EXPECT_NEAR(report.bars[0].at_low.moments.mean, mean_of(recipe("0.0", sampled_x(), "")), 1e-9);
+    EXPECT_NEAR(report.bars[0].at_high.moments.mean, mean_of(recipe("0.3", sampled_x(), "")), 1e-9);
+
+    // The noise drawn in each trial is the same for all variants: its call site comes first.
+    EXPECT_EQ(report.bars[1].name, "x");
+    EXPECT_EQ(report.bars[1].input.slot, 3u);
+    EXPECT_NEAR(report.bars[1].at_low.moments.mean, mean_of(recipe("0.1", fixed_x(8), "")), 1e-9);
+    EXPECT_NEAR(report.bars[1].at_high.moments.mean, mean_of(recipe("0.1", fixed_x(12), "")), 1e-9);
+
+    EXPECT_EQ(report.bars[2].name, "unrelated");
+    EXPECT_EQ(report.bars[2].swing(), 0.0);
+    EXPECT_EQ(report.bars[2].at_low.moments.mean, report.base.moments.mean);
+}
+
+TEST_F(SensitivityTest, UsesCommonRandomNumbers)
+{
+    // With x held fixed, w varies only through the noise, which both ends of x's range share:
+    // their means differ by exactly 4 x 1.1^2 and their spreads match.
+    create_test_recipe("recipe.json", recipe("0.1", sampled_x(), R"(, "sensitivity": [{"slot": 3, "low": 8, "high": 12}])"));
+    SimulationEngine engine("recipe.json");
+    const SensitivityReport report = engine.run_sensitivity();
+    const SensitivityBar &bar = report.bars[0];
+    EXPECT_NEAR(bar.at_high.moments.mean - bar.at_low.moments.mean, 4 * 1.1 * 1.1, 1e-9);
+    EXPECT_NEAR(bar.at_low.moments.stddev(), bar.at_high.moments.stddev(), 1e-12);
+}
+
+TEST_F(SensitivityTest, RejectsUnknownInputsAndVectorOutputs)
+{
+    create_test_recipe("recipe.json", recipe("0.1", sampled_x(), R"(, "sensitivity": [{"variable": "growth", "low": 0, "high": 1}])"));
+    try
+    {
+        SimulationEngine engine("recipe.json");
+        FAIL() << "Expected EngineException";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::RecipeConfigError);
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("Unknown sensitivity variable 'growth'"));
+    }
+
+    create_test_recipe("recipe.json", R"({"simulation_config": {"num_trials": 10, "sensitivity": [{"slot": 0, "low": 0, "high": 1}]},
+        "output_variable_index": 1, "variable_registry": ["a", "v"],
+        "pre_trial_steps": [{"type": "literal_assignment", "result": 0, "value": 1}],
+        "per_trial_steps": [{"type": "execution_assignment", "result": [1], "function": "compose_vector", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]}]})");
+    SimulationEngine engine("recipe.json");
+    try
+    {
+        engine.run_sensitivity();
+        FAIL() << "Expected EngineException";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::RecipeConfigError);
+    }
+}
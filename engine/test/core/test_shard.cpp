@@ -0,0 +1,201 @@
+#include "test/test_helpers.h"
+#include "include/engine/io/Shard.h"
+#include "include/engine/io/EngineServer.h"
+#include <nlohmann/json.hpp>
+#include <cstdio>
+#include <filesystem>
+
+namespace
+{
+    // x = Normal(5, 2); y = x * 3, both outputs.
+    std::string two_output_recipe(size_t trials, const std::string &config = R"(, "seed": 17)")
+    {
+        return R"({
+            "simulation_config": {"num_trials": )" +
+               std::to_string(trials) + config + R"(},
+            "output_variable_indices": [0, 1], "variable_registry": ["x", "y"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "line": 1, "function": "Normal", "args": [{"type": "scalar_literal", "value": 5}, {"type": "scalar_literal", "value": 2}]},
+                {"type": "execution_assignment", "result": [1], "line": 2, "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 3}]}
+            ]
+        })";
+    }
+
+    std::vector<std::string> run_shards(const std::string &prefix, const std::string &recipe, size_t count)
+    {
+        auto engine = SimulationEngine::from_recipe_text(recipe);
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < count; ++i)
+        {
+            paths.push_back(prefix + "." + std::to_string(i) + ".json");
+            run_shard(*engine, recipe, ShardSpec{i, count}, paths.back());
+        }
+        return paths;
+    }
+
+    void remove_shards(const std::vector<std::string> &paths)
+    {
+        for (const std::string &path : paths)
+        {
+            std::remove(path.c_str());
+            std::remove(std::filesystem::path(path).replace_extension(".bin").string().c_str());
+        }
+    }
+}
+
+class ShardTest : public FileCleanupTest
+{
+};
+
+TEST_F(ShardTest, SplitsTheTrialsIntoContiguousRanges)
+{
+    EXPECT_FALSE(parse_shard_spec("3/3"));
+    EXPECT_FALSE(parse_shard_spec("1"));
+    EXPECT_FALSE(parse_shard_spec("/2"));
+    EXPECT_FALSE(parse_shard_spec("1/2x"));
+    const std::optional<ShardSpec> shard = parse_shard_spec("2/3");
+    ASSERT_TRUE(shard);
+    EXPECT_EQ(shard->index, 2u);
+    EXPECT_EQ(shard->count, 3u);
+
+    size_t next = 0;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const TrialRange range = shard_range(ShardSpec{i, 3}, 10);
+        EXPECT_EQ(range.first, next);
+        EXPECT_EQ(range.count, i == 0 ? 4u : 3u);
+        next += range.count;
+    }
+    EXPECT_EQ(next, 10u);
+    EXPECT_EQ(shard_range(ShardSpec{4, 5}, 3).count, 0u);
+}
+
+TEST_F(ShardTest, RangesDrawWhatTheWholeRunDraws)
+{
+    for (const std::string config : {R"(, "seed": 17)", R"(, "seed": 17, "sampling": "sobol")"})
+    {
+        auto engine = SimulationEngine::from_recipe_text(two_output_recipe(1000, config));
+        const std::vector<TrialValue> whole = engine->run_outputs()[1];
+        ResultCollector collector;
+        RunOptions options;
+        options.range = TrialRange{300, 450};
+        options.outputs = {"y"};
+        engine->run(options, {&collector});
+        const std::vector<TrialValue> &part = collector.results();
+        ASSERT_EQ(part.size(), 450u);
+        for (size_t i = 0; i < part.size(); ++i)
+            EXPECT_EQ(std::get<double>(part[i]), std::get<double>(whole[300 + i])) << config << " trial " << 300 + i;
+    }
+
+    auto engine = SimulationEngine::from_recipe_text(two_output_recipe(100));
+    RunOptions options;
+    options.range = TrialRange{50, 51};
+    ResultCollector collector;
+    EXPECT_THROW(engine->run(options, {&collector}), EngineException);
+}
+
+TEST_F(ShardTest, MergedShardsMatchASingleRun)
+{
+    const std::string recipe = two_output_recipe(5000, R"(, "seed": 17, "output_file": "shard_test_results.bin")");
+    auto engine = SimulationEngine::from_recipe_text(recipe);
+    const std::vector<StatisticsSink> expected = run_with_statistics(*engine);
+    const std::string single_run = read_file_content("shard_test_results.bin");
+    std::remove("shard_test_results.bin");
+
+    const std::vector<std::string> paths = run_shards("shard_merge", recipe, 3);
+    const MergedShards merged = merge_shards({paths[2], paths[0], paths[1]});
+    EXPECT_EQ(merged.run.num_trials, 5000u);
+    EXPECT_EQ(merged.run.seed, 17u);
+    ASSERT_EQ(merged.statistics.size(), 2u);
+    for (size_t k = 0; k < 2; ++k)
+    {
+        const OutputStatistics &got = merged.statistics[k].periods()[0];
+        const OutputStatistics &want = expected[k].periods()[0];
+        EXPECT_EQ(merged.statistics[k].kind(), StatisticsSink::Kind::Scalar);
+        EXPECT_EQ(got.moments.count, 5000u);
+        EXPECT_NEAR(got.moments.mean, want.moments.mean, 1e-12);
+        EXPECT_NEAR(got.moments.stddev(), want.moments.stddev(), 1e-9);
+        EXPECT_NEAR(got.moments.skewness(), want.moments.skewness(), 1e-9);
+        EXPECT_EQ(got.moments.min, want.moments.min);
+        EXPECT_EQ(got.moments.max, want.moments.max);
+        EXPECT_NEAR(got.quantiles.quantile(0.5), want.quantiles.quantile(0.5), 0.01 * want.moments.stddev());
+        EXPECT_NEAR(got.quantiles.quantile(0.99), want.quantiles.quantile(0.99), 0.01 * want.moments.stddev());
+    }
+    // The results are copied as they are, so the output file is the single run's.
+    EXPECT_EQ(read_file_content("shard_test_results.bin"), single_run);
+    std::remove("shard_test_results.bin");
+    remove_shards(paths);
+}
+
+TEST_F(ShardTest, MergedSummariesComeFromTheShardStatistics)
+{
+    const std::string recipe = two_output_recipe(4000, R"(, "seed": 17, "output_file": "shard_summary.json")");
+    auto engine = SimulationEngine::from_recipe_text(recipe);
+    run_with_statistics(*engine);
+    const nlohmann::json single_run = nlohmann::json::parse(read_file_content("shard_summary.json"));
+    std::remove("shard_summary.json");
+
+    const std::vector<std::string> paths = run_shards("shard_summary", recipe, 2);
+    for (const std::string &path : paths)
+        EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(path).replace_extension(".bin")));
+    merge_shards(paths);
+    const nlohmann::json merged = nlohmann::json::parse(read_file_content("shard_summary.json"));
+    EXPECT_EQ(merged["trials"], 4000);
+    ASSERT_EQ(merged["outputs"].size(), 2u);
+    for (size_t k = 0; k < 2; ++k)
+    {
+        const nlohmann::json &got = merged["outputs"][k]["periods"][0];
+        const nlohmann::json &want = single_run["outputs"][k]["periods"][0];
+        EXPECT_EQ(merged["outputs"][k]["name"], single_run["outputs"][k]["name"]);
+        EXPECT_NEAR(got["mean"].get<double>(), want["mean"].get<double>(), 1e-12);
+        EXPECT_EQ(got["min"], want["min"]);
+        EXPECT_EQ(got["max"], want["max"]);
+        EXPECT_EQ(got["histogram"]["counts"].size(), DEFAULT_SUMMARY_BINS);
+    }
+    std::remove("shard_summary.json");
+    remove_shards(paths);
+}
+
+TEST_F(ShardTest, MergeRefusesIncompleteOrForeignShards)
+{
+    const std::vector<std::string> paths = run_shards("shard_refuse", two_output_recipe(100), 3);
+    EXPECT_THROW(merge_shards({paths[0], paths[2]}), EngineException);
+    EXPECT_THROW(merge_shards({paths[0], paths[1], paths[1], paths[2]}), EngineException);
+    EXPECT_THROW(merge_shards({paths[0], paths[1], "missing_shard.json"}), EngineException);
+
+    const std::string other = two_output_recipe(100, R"(, "seed": 18)");
+    auto engine = SimulationEngine::from_recipe_text(other);
+    run_shard(*engine, other, ShardSpec{2, 3}, "shard_refuse.other.json");
+    EXPECT_THROW(merge_shards({paths[0], paths[1], "shard_refuse.other.json"}), EngineException);
+    EXPECT_EQ(merge_shards(paths).statistics[0].trials(), 100u);
+    remove_shards(paths);
+    remove_shards({"shard_refuse.other.json"});
+}
+
+TEST_F(ShardTest, NeedsTheSeedFromTheRecipe)
+{
+    const std::string recipe = two_output_recipe(100, "");
+    auto engine = SimulationEngine::from_recipe_text(recipe);
+    EXPECT_THROW(run_shard(*engine, recipe, ShardSpec{0, 2}, "shard_test.unseeded.json"), EngineException);
+}
+
+TEST_F(ShardTest, CliRunsShardsAndMergesThem)
+{
+    create_test_recipe("shard_cli.json", two_output_recipe(2000, R"(, "seed": 17, "output_file": "shard_cli_results.csv")"));
+    const std::string vse = VSE_EXECUTABLE_PATH;
+    const std::string first = exec_command((vse + " --shard 0/2 shard_cli.json").c_str());
+    EXPECT_THAT(first, ::testing::HasSubstr("Shard 0/2: trials 0 to 1000 of 2000, written to 'shard_cli.shard-0-of-2.json'."));
+    exec_command((vse + " --shard 1/2 --shard-file shard_cli.second.json shard_cli.json").c_str());
+    EXPECT_TRUE(std::filesystem::exists("shard_cli.second.bin"));
+
+    const std::string merged = exec_command((vse + " merge shard_cli.shard-0-of-2.json shard_cli.second.json").c_str());
+    EXPECT_THAT(merged, ::testing::HasSubstr("Merged 2 shard(s): 2000 trials, seed 17."));
+    EXPECT_THAT(merged, ::testing::HasSubstr("Trials:     2000"));
+    const std::string csv = read_file_content("shard_cli_results.csv");
+    EXPECT_EQ(std::count(csv.begin(), csv.end(), '\n'), 2001);
+
+    const std::string missing = exec_command((vse + " merge shard_cli.second.json 2>&1").c_str());
+    EXPECT_THAT(missing, ::testing::HasSubstr("Shard 0 of 2 is missing."));
+    for (const char *path : {"shard_cli.json", "shard_cli_results.csv", "shard_cli.shard-0-of-2.json", "shard_cli.shard-0-of-2.bin", "shard_cli.second.json", "shard_cli.second.bin"})
+        std::remove(path);
+}
@@ -0,0 +1,74 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/ExecutionSteps.h"
+#include "include/engine/core/SmallVector.h"
+#include "include/engine/functions/core/operations.h"
+#include "include/engine/functions/series/operations.h"
+
+TEST(SmallVectorTest, KeepsShortContentsInline)
+{
+    SmallVector<double, 4> values;
+    for (int i = 0; i < 4; ++i)
+    {
+        values.push_back(i);
+    }
+    EXPECT_TRUE(values.is_inline());
+    EXPECT_EQ(values.capacity(), 4u);
+    EXPECT_EQ(values[3], 3.0);
+}
+
+TEST(SmallVectorTest, MovesToTheHeapPastItsCapacity)
+{
+    SmallVector<TrialValue, 2> values;
+    values.push_back(std::string("first"));
+    values.push_back(std::vector<double>{1.0, 2.0});
+    values.push_back(3.0);
+    EXPECT_FALSE(values.is_inline());
+    ASSERT_EQ(values.size(), 3u);
+    EXPECT_EQ(std::get<std::string>(values[0]), "first");
+    EXPECT_EQ(std::get<std::vector<double>>(values[1]), (std::vector<double>{1.0, 2.0}));
+
+    values.resize(1);
+    EXPECT_EQ(values.size(), 1u);
+    values.resize(2);
+    EXPECT_EQ(std::get<double>(values[1]), 0.0);
+}
+
+class TreeCallTest : public FileCleanupTest
+{
+protected:
+    void SetUp() override
+    {
+        FileCleanupTest::SetUp();
+        register_core_functions(m_registry);
+        register_series_functions(m_registry);
+    }
+
+    std::unique_ptr<IExecutionStep> make_call(std::vector<size_t> results, const std::string &function, const std::string &args_json)
+    {
+        const auto &factory = m_registry.get_factory_map();
+        return std::make_unique<ExecutionAssignmentStep>(
+            std::move(results), function, 1, factory.at(function)(), nlohmann::json::parse(args_json), factory);
+    }
+
+    FunctionRegistry m_registry;
+};
+
+TEST_F(TreeCallTest, WritesSeriesIntoTheStorageOfTheirSlot)
+{
+    auto step = make_call({1}, "grow_series", R"([{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0.1}, {"type": "scalar_literal", "value": 3}])");
+    TrialContext context = {TrialValue(100.0), TrialValue(std::vector<double>(3))};
+    const double *storage = std::get<std::vector<double>>(context[1]).data();
+    step->execute(context);
+    const auto &series = std::get<std::vector<double>>(context[1]);
+    EXPECT_EQ(series.data(), storage);
+    EXPECT_NEAR(series[2], 133.1, 1e-9);
+}
+
+TEST_F(TreeCallTest, ReadsTheSlotItAssigns)
+{
+    // x = compose_vector(x, x): the call must see x as it was before the step.
+    auto step = make_call({0}, "compose_vector", R"([{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 0}])");
+    TrialContext context = {TrialValue(std::vector<double>{1.0, 2.0})};
+    step->execute(context);
+    EXPECT_EQ(std::get<std::vector<double>>(context[0]), (std::vector<double>{1.0, 2.0, 1.0, 2.0}));
+}
@@ -0,0 +1,152 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/Statistics.h"
+#include <algorithm>
+#include <random>
+
+namespace
+{
+    std::vector<double> lognormal_sample(size_t n, unsigned seed)
+    {
+        std::mt19937 generator(seed);
+        std::lognormal_distribution<> dist(0.0, 0.75);
+        std::vector<double> values(n);
+        for (auto &value : values)
+        {
+            value = dist(generator);
+        }
+        return values;
+    }
+
+    double exact_quantile(std::vector<double> values, double q)
+    {
+        std::sort(values.begin(), values.end());
+        return values[static_cast<size_t>(q * (values.size() - 1))];
+    }
+}
+
+TEST(RunningStatisticsTest, MatchesTwoPassMoments)
+{
+    const auto values = lognormal_sample(10000, 1);
+    RunningStatistics stats;
+    for (double value : values)
+    {
+        stats.add(value);
+    }
+
+    double mean = 0.0;
+    for (double value : values)
+        mean += value;
+    mean /= values.size();
+    double m2 = 0.0, m3 = 0.0, m4 = 0.0;
+    for (double value : values)
+    {
+        const double d = value - mean;
+        m2 += d * d;
+        m3 += d * d * d;
+        m4 += d * d * d * d;
+    }
+    const double n = static_cast<double>(values.size());
+
+    EXPECT_NEAR(stats.mean, mean, 1e-12);
+    EXPECT_NEAR(stats.variance(), m2 / n, 1e-10);
+    EXPECT_NEAR(stats.skewness(), std::sqrt(n) * m3 / std::pow(m2, 1.5), 1e-9);
+    EXPECT_NEAR(stats.kurtosis(), n * m4 / (m2 * m2) - 3.0, 1e-8);
+    EXPECT_EQ(stats.min, *std::min_element(values.begin(), values.end()));
+    EXPECT_EQ(stats.max, *std::max_element(values.begin(), values.end()));
+}
+
+TEST(RunningStatisticsTest, MergeMatchesSinglePass)
+{
+    const auto values = lognormal_sample(5000, 2);
+    RunningStatistics whole, parts[3];
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        whole.add(values[i]);
+        parts[i < 100 ? 0 : (i < 3000 ? 1 : 2)].add(values[i]);
+    }
+    RunningStatistics merged;
+    for (const auto &part : parts)
+    {
+        merged.merge(part);
+    }
+    EXPECT_EQ(merged.count, whole.count);
+    EXPECT_NEAR(merged.mean, whole.mean, 1e-12);
+    EXPECT_NEAR(merged.variance(), whole.variance(), 1e-10);
+    EXPECT_NEAR(merged.skewness(), whole.skewness(), 1e-9);
+    EXPECT_NEAR(merged.kurtosis(), whole.kurtosis(), 1e-8);
+    EXPECT_EQ(merged.min, whole.min);
+    EXPECT_EQ(merged.max, whole.max);
+}
+
+TEST(QuantileSketchTest, TracksPercentilesOfSkewedData)
+{
+    const auto values = lognormal_sample(200000, 3);
+    QuantileSketch sketch;
+    for (double value : values)
+    {
+        sketch.add(value);
+    }
+    EXPECT_DOUBLE_EQ(sketch.total_weight(), 200000.0);
+    EXPECT_LT(sketch.num_centroids(), 400u);
+    for (double q : REPORTED_PERCENTILES)
+    {
+        const double exact = exact_quantile(values, q);
+        EXPECT_NEAR(sketch.quantile(q), exact, 0.01 * exact) << "q = " << q;
+    }
+    EXPECT_EQ(sketch.quantile(0.0), *std::min_element(values.begin(), values.end()));
+    EXPECT_EQ(sketch.quantile(1.0), *std::max_element(values.begin(), values.end()));
+}
+
+TEST(QuantileSketchTest, MergedSketchesMatchTheWholeSample)
+{
+    const auto values = lognormal_sample(100000, 4);
+    std::vector<QuantileSketch> parts(8);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        parts[i % parts.size()].add(values[i]);
+    }
+    QuantileSketch merged;
+    for (const auto &part : parts)
+    {
+        merged.merge(part);
+    }
+    EXPECT_DOUBLE_EQ(merged.total_weight(), 100000.0);
+    for (double q : REPORTED_PERCENTILES)
+    {
+        const double exact = exact_quantile(values, q);
+        EXPECT_NEAR(merged.quantile(q), exact, 0.01 * exact) << "q = " << q;
+    }
+}
+
+TEST(QuantileSketchTest, CdfInvertsQuantiles)
+{
+    const auto values = lognormal_sample(50000, 5);
+    QuantileSketch sketch;
+    for (double value : values)
+    {
+        sketch.add(value);
+    }
+    for (double q : {0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99})
+    {
+        EXPECT_NEAR(sketch.cdf(sketch.quantile(q)), q, 1e-9) << "q = " << q;
+        const double exact = exact_quantile(values, q);
+        EXPECT_NEAR(sketch.cdf(exact), q, 0.005) << "q = " << q;
+    }
+    EXPECT_EQ(sketch.cdf(sketch.min() - 1.0), 0.0);
+    EXPECT_EQ(sketch.cdf(sketch.max()), 1.0);
+    EXPECT_EQ(QuantileSketch().cdf(1.0), 0.0);
+}
+
+TEST(QuantileSketchTest, HandlesEmptyAndConstantInput)
+{
+    QuantileSketch empty;
+    EXPECT_EQ(empty.quantile(0.5), 0.0);
+
+    QuantileSketch constant;
+    for (int i = 0; i < 5000; ++i)
+    {
+        constant.add(42.0);
+    }
+    EXPECT_DOUBLE_EQ(constant.quantile(0.01), 42.0);
+    EXPECT_DOUBLE_EQ(constant.quantile(0.99), 42.0);
+}
@@ -0,0 +1,130 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/StepGraph.h"
+
+class StepGraphTest : public FileCleanupTest
+{
+protected:
+    // Runs the recipe and returns the message of the error it raises, or "" on success.
+    static std::string run_error(const std::string &recipe)
+    {
+        create_test_recipe("recipe.json", recipe);
+        try
+        {
+            SimulationEngine engine("recipe.json", true);
+            engine.run();
+        }
+        catch (const EngineException &e)
+        {
+            return e.what();
+        }
+        return "";
+    }
+
+    // result = x > threshold ? x / divisor : x, with a dead step dividing x by zero.
+    static std::string conditional_recipe(double threshold, double divisor = 0.0, int lane_width = 256)
+    {
+        return R"({
+            "simulation_config": {"num_trials": 64, "seed": 5, "lane_width": )" +
+               std::to_string(lane_width) + R"(}, "output_variable_index": 3,
+            "variable_registry": ["x", "flag", "helper", "result", "unused"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+                {"type": "execution_assignment", "result": [4], "line": 2, "function": "divide", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0}]},
+                {"type": "execution_assignment", "result": [1], "function": "__gt__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": )" +
+               std::to_string(threshold) + R"(}]},
+                {"type": "execution_assignment", "result": [2], "line": 4, "function": "divide", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": )" +
+               std::to_string(divisor) + R"(}]},
+                {"type": "conditional_assignment", "result": 3, "line": 5, "condition": {"type": "variable_index", "value": 1},
+                    "then_expr": {"type": "variable_index", "value": 2}, "else_expr": {"type": "variable_index", "value": 0}}
+            ]
+        })";
+    }
+};
+
+TEST_F(StepGraphTest, KeepsOnlyStepsTheOutputDependsOn)
+{
+    const StepGraph graph(nlohmann::json::parse(R"([
+        {"type": "literal_assignment", "result": 0, "value": 1},
+        {"type": "execution_assignment", "result": [1], "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+        {"type": "execution_assignment", "result": [2], "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]},
+        {"type": "execution_assignment", "result": [3, 4], "function": "SirModel", "args": [{"type": "variable_index", "value": 1}]}
+    ])"));
+    EXPECT_EQ(graph.schedule({1}).live, (std::vector<bool>{true, true, false, false}));
+    EXPECT_EQ(graph.schedule({4}).live, (std::vector<bool>{true, true, false, true}));
+    EXPECT_EQ(graph.schedule({1, 2}).live, (std::vector<bool>{true, true, true, false}));
+}
+
+TEST_F(StepGraphTest, DefersHelpersOfASingleBranch)
+{
+    // 0 feeds only the then-branch through 1; 2 is read by both branches; 3 by the condition.
+    const StepGraph graph(nlohmann::json::parse(R"([
+        {"type": "execution_assignment", "result": [0], "function": "exp", "args": [{"type": "variable_index", "value": 9}]},
+        {"type": "execution_assignment", "result": [1], "function": "log", "args": [{"type": "variable_index", "value": 0}]},
+        {"type": "execution_assignment", "result": [2], "function": "sin", "args": [{"type": "variable_index", "value": 9}]},
+        {"type": "execution_assignment", "result": [3], "function": "__gt__", "args": [{"type": "variable_index", "value": 9}, {"type": "scalar_literal", "value": 0}]},
+        {"type": "conditional_assignment", "result": 5, "condition": {"type": "variable_index", "value": 3},
+            "then_expr": {"type": "execution_assignment", "function": "add", "args": [{"type": "variable_index", "value": 1}, {"type": "variable_index", "value": 2}]},
+            "else_expr": {"type": "variable_index", "value": 2}}
+    ])"));
+    const StepGraph::Schedule schedule = graph.schedule({5});
+    EXPECT_EQ(schedule.live, (std::vector<bool>(5, true)));
+    ASSERT_TRUE(schedule.deferred[0] && schedule.deferred[1]);
+    EXPECT_EQ(schedule.deferred[0]->conditional, 4u);
+    EXPECT_TRUE(schedule.deferred[0]->then_branch);
+    EXPECT_TRUE(schedule.deferred[1]->then_branch);
+    EXPECT_FALSE(schedule.deferred[2]);
+    EXPECT_FALSE(schedule.deferred[3]);
+
+    // A helper whose result is also an output stays on every trial.
+    EXPECT_FALSE(graph.schedule({5, 1}).deferred[1]);
+}
+
+TEST_F(StepGraphTest, DoesNotDeferPastWritesToItsInputs)
+{
+    const StepGraph graph(nlohmann::json::parse(R"([
+        {"type": "execution_assignment", "result": [1], "function": "exp", "args": [{"type": "variable_index", "value": 0}]},
+        {"type": "execution_assignment", "result": [0], "function": "sin", "args": [{"type": "variable_index", "value": 9}]},
+        {"type": "conditional_assignment", "result": 2, "condition": {"type": "boolean_literal", "value": true},
+            "then_expr": {"type": "variable_index", "value": 1}, "else_expr": {"type": "variable_index", "value": 0}}
+    ])"));
+    EXPECT_FALSE(graph.schedule({2}).deferred[0]);
+}
+
+TEST_F(StepGraphTest, EngineSkipsDeadAndUntakenSteps)
+{
+    // The dead step and the helper of the untaken branch would both divide by zero.
+    EXPECT_EQ(run_error(conditional_recipe(2.0)), "");
+
+    // Once the branch is taken, the helper reports its error as the top-level step it was.
+    const std::string helper_alone = R"({
+        "simulation_config": {"num_trials": 64, "seed": 5}, "output_variable_index": 2,
+        "variable_registry": ["x", "flag", "helper"],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+            {"type": "execution_assignment", "result": [2], "line": 4, "function": "divide", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0}]}
+        ]
+    })";
+    const std::string expected = run_error(helper_alone);
+    EXPECT_THAT(expected, ::testing::HasSubstr("L4: In function 'divide'"));
+    EXPECT_EQ(run_error(conditional_recipe(-1.0)), expected);
+}
+
+TEST_F(StepGraphTest, DeferredStepsRunInBothInterpreters)
+{
+    // A lane width of 1 keeps the scalar bytecode interpreter.
+    for (int lane_width : {1, 256})
+    {
+        create_test_recipe("recipe.json", conditional_recipe(0.5, 2.0, lane_width));
+        SimulationEngine engine("recipe.json", true);
+        const auto results = engine.run();
+        ASSERT_EQ(results.size(), 64u);
+        size_t halved = 0;
+        for (const auto &result : results)
+        {
+            const double value = std::get<double>(result);
+            EXPECT_LE(value, 0.5);
+            halved += value > 0.25 ? 0 : 1;
+        }
+        EXPECT_GT(halved, 0u);
+    }
+}
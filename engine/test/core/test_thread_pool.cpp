@@ -0,0 +1,174 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/ThreadPool.h"
+#include <atomic>
+
+TEST(ThreadPoolTest, RunsEveryIndexExactlyOnce)
+{
+    ThreadPool pool(4, false);
+    std::vector<std::atomic<int>> visits(1001);
+    pool.parallel_for(visits.size(), 7, [&](size_t worker, size_t begin, size_t end)
+                      {
+        EXPECT_LT(worker, pool.size());
+        EXPECT_LE(end - begin, 7u);
+        for (size_t i = begin; i < end; ++i)
+        {
+            visits[i].fetch_add(1);
+        } });
+    for (const auto &count : visits)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST(ThreadPoolTest, IsReusableAcrossRuns)
+{
+    ThreadPool pool(3, false);
+    for (int run = 0; run < 20; ++run)
+    {
+        std::atomic<size_t> total{0};
+        pool.parallel_for(100, 1, [&](size_t, size_t begin, size_t end)
+                          { total += end - begin; });
+        EXPECT_EQ(total.load(), 100u);
+    }
+}
+
+TEST(ThreadPoolTest, RethrowsExceptionsFromWorkers)
+{
+    ThreadPool pool(4, false);
+    try
+    {
+        pool.parallel_for(64, 1, [](size_t, size_t begin, size_t)
+                          {
+            if (begin == 40)
+            {
+                throw EngineException(EngineErrc::UnknownError, "chunk " + std::to_string(begin));
+            } });
+        FAIL() << "Expected an exception.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_STREQ(e.what(), "chunk 40");
+    }
+}
+
+TEST(ThreadPoolTest, KeepsTheChunkCountWithinThePackedRange)
+{
+    const size_t max = ThreadPool::MAX_CHUNKS;
+    EXPECT_EQ(ThreadPool::effective_chunk_size(10, 0), 1u);
+    EXPECT_EQ(ThreadPool::effective_chunk_size(max, 1), 1u);
+    EXPECT_EQ(ThreadPool::effective_chunk_size(max + 1, 1), 2u);
+    EXPECT_EQ(ThreadPool::effective_chunk_size(max * 16, 16), 16u);
+    EXPECT_EQ(ThreadPool::effective_chunk_size(max * 16 + 1, 16), 32u);
+    for (size_t count : {max + 1, 3 * max + 2, max * max})
+    {
+        const size_t chunk_size = ThreadPool::effective_chunk_size(count, 1);
+        EXPECT_LE(count / chunk_size + (count % chunk_size != 0), max) << count;
+    }
+
+    // Trial indices past 32 bits, in a handful of chunks.
+    ThreadPool pool(3, false);
+    const size_t count = (size_t(1) << 34) + 5;
+    std::atomic<size_t> total{0};
+    std::atomic<size_t> last_end{0};
+    pool.parallel_for(count, size_t(1) << 32, [&](size_t, size_t begin, size_t end)
+                      {
+        total += end - begin;
+        if (end == count)
+            last_end = end; });
+    EXPECT_EQ(total.load(), count);
+    EXPECT_EQ(last_end.load(), count);
+}
+
+TEST(ThreadPoolTest, CallsFromInsideAChunkRunOnTheirThread)
+{
+    ThreadPool pool(4, false);
+    std::vector<std::atomic<int>> visits(50 * 40);
+    pool.parallel_for(50, 1, [&](size_t, size_t outer, size_t)
+                      {
+        const std::thread::id thread = std::this_thread::get_id();
+        pool.parallel_for(40, 3, [&](size_t worker, size_t begin, size_t end)
+                          {
+            EXPECT_EQ(worker, 0u);
+            EXPECT_EQ(std::this_thread::get_id(), thread);
+            for (size_t i = begin; i < end; ++i)
+                visits[outer * 40 + i].fetch_add(1); }); });
+    for (const auto &count : visits)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST_F(FileCleanupTest, EngineReadsSchedulingFromSimulationConfig)
+{
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 500, "threads": 4, "chunk_size": 3, "lane_width": 0},
+        "output_variable_index": 0, "variable_registry": ["x"],
+        "per_trial_steps": [{"type": "literal_assignment", "result": 0, "value": 5}]
+    })";
+    create_test_recipe("recipe.json", recipe);
+    SimulationEngine engine("recipe.json");
+    EXPECT_EQ(engine.get_scheduler_config().threads, 4u);
+    EXPECT_EQ(engine.get_scheduler_config().chunk_size, 3u);
+    auto results = engine.run();
+    ASSERT_EQ(results.size(), 500u);
+    for (const auto &result : results)
+    {
+        EXPECT_EQ(std::get<double>(result), 5.0);
+    }
+
+    SchedulerConfig single;
+    single.threads = 1;
+    engine.set_scheduler_config(single);
+    EXPECT_EQ(engine.run().size(), 500u);
+}
+
+TEST(ThreadPoolTest, ParsesKernelCpuLists)
+{
+    EXPECT_EQ(NumaTopology::parse_cpu_list("0-3,8,10-11\n"), (std::vector<unsigned>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(NumaTopology::parse_cpu_list("5"), (std::vector<unsigned>{5}));
+    EXPECT_TRUE(NumaTopology::parse_cpu_list("").empty());
+    EXPECT_FALSE(NumaTopology::system().nodes.empty());
+}
+
+TEST(ThreadPoolTest, SpreadsWorkersOverNodesByTheirCpus)
+{
+    NumaTopology topology;
+    topology.nodes = {{0, 1, 2, 3}, {4, 5}};
+    ThreadPool pool(6, false, topology);
+    ASSERT_EQ(pool.num_nodes(), 2u);
+    for (size_t worker = 0; worker < 6; ++worker)
+    {
+        EXPECT_EQ(pool.node_of(worker), worker < 4 ? 0u : 1u) << "worker " << worker;
+    }
+
+    std::vector<std::atomic<int>> visits(997);
+    pool.parallel_for(visits.size(), 3, [&](size_t, size_t begin, size_t end)
+                      {
+        for (size_t i = begin; i < end; ++i)
+        {
+            visits[i].fetch_add(1);
+        } });
+    for (const auto &count : visits)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST_F(FileCleanupTest, ReplicatedInputsGiveTheSameResults)
+{
+    auto run = [](const std::string &scheduling)
+    {
+        create_test_recipe("recipe.json", R"({
+            "simulation_config": {"num_trials": 2000, "seed": 5, "lane_width": 0, "threads": 4, "chunk_size": 7)" + scheduling + R"(},
+            "output_variable_index": 2, "variable_registry": ["table", "draw", "x"],
+            "pre_trial_steps": [{"type": "literal_assignment", "result": 0, "value": [1, 2, 3, 4]}],
+            "per_trial_steps": [{"type": "execution_assignment", "result": [1], "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+                {"type": "execution_assignment", "result": [2], "function": "add", "args": [{"type": "variable_index", "value": 1},
+                    {"type": "execution_assignment", "function": "sum_series", "args": [{"type": "variable_index", "value": 0}]}]}]
+        })");
+        return SimulationEngine("recipe.json").run();
+    };
+    const auto expected = run("");
+    ASSERT_EQ(expected.size(), 2000u);
+    EXPECT_EQ(run(R"(, "pin_threads": true, "replicate_inputs": true)"), expected);
+}
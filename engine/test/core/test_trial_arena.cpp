@@ -0,0 +1,84 @@
+#include "test/test_helpers.h"
+#include "include/engine/core/TrialArena.h"
+#include <cstdint>
+
+TEST(TrialArenaTest, ScopesGiveBackWhatTheyTook)
+{
+    TrialArena arena;
+    double *first = nullptr;
+    {
+        const TrialArena::Scope scope(arena);
+        first = arena.allocate<double>(10).data();
+        {
+            const TrialArena::Scope inner(arena);
+            EXPECT_EQ(arena.allocate<double>(5).data(), first + 10);
+        }
+        EXPECT_EQ(arena.allocate<double>(5).data(), first + 10);
+    }
+    const TrialArena::Scope scope(arena);
+    EXPECT_EQ(arena.allocate<double>(3).data(), first);
+}
+
+TEST(TrialArenaTest, AlignsEveryAllocation)
+{
+    TrialArena arena;
+    const TrialArena::Scope scope(arena);
+    arena.allocate<unsigned char>(3);
+    const double *values = arena.allocate<double>(2).data();
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(values) % alignof(double), 0u);
+}
+
+TEST(TrialArenaTest, MergesItsBlocksOnceEmpty)
+{
+    TrialArena arena;
+    {
+        const TrialArena::Scope scope(arena);
+        for (int i = 0; i < 8; ++i)
+        {
+            arena.allocate<double>(1000);
+        }
+        EXPECT_GT(arena.block_count(), 1u);
+    }
+    EXPECT_EQ(arena.block_count(), 1u);
+    const size_t capacity = arena.capacity();
+    EXPECT_GE(capacity, 8 * 1000 * sizeof(double));
+
+    // The next trial of the same size fits in the merged block.
+    const TrialArena::Scope scope(arena);
+    for (int i = 0; i < 8; ++i)
+    {
+        arena.allocate<double>(1000);
+    }
+    EXPECT_EQ(arena.block_count(), 1u);
+    EXPECT_EQ(arena.capacity(), capacity);
+}
+
+TEST(TrialArenaTest, SeriesFunctionsLeaveTheThreadArenaEmpty)
+{
+    // irr over two instruments and npv with a rate per instrument both take their temporaries
+    // from the arena, so the values after them start where the values before them did.
+    auto engine = SimulationEngine::from_recipe_text(R"({
+        "simulation_config": {"num_trials": 50, "threads": 1},
+        "output_variable_index": 2, "variable_registry": ["flows", "rates", "npvs"],
+        "per_trial_steps": [
+            {"type": "literal_assignment", "result": 0, "value": [-100, -50, 60, 30, 60, 30]},
+            {"type": "execution_assignment", "result": [1], "function": "irr", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 2}]},
+            {"type": "execution_assignment", "result": [2], "function": "npv", "args": [{"type": "variable_index", "value": 1}, {"type": "variable_index", "value": 0}]}
+        ]
+    })");
+    TrialArena &arena = trial_arena();
+    double *before = nullptr;
+    {
+        const TrialArena::Scope scope(arena);
+        before = arena.allocate<double>(1).data();
+    }
+    const std::vector<TrialValue> results = engine->run();
+    const TrialArena::Scope scope(arena);
+    EXPECT_EQ(arena.allocate<double>(1).data(), before);
+
+    // Discounted at their internal rates of return, both instruments are worth nothing.
+    const auto &npvs = std::get<std::vector<double>>(results[0]);
+    ASSERT_EQ(npvs.size(), 2u);
+    EXPECT_NEAR(npvs[0], 0.0, 1e-9);
+    EXPECT_NEAR(npvs[1], 0.0, 1e-9);
+}
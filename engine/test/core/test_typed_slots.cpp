@@ -0,0 +1,95 @@
+#include "test/test_helpers.h"
+
+namespace
+{
+    // Samplers, Black-Scholes, fused arithmetic, a series, a conditional and boolean logic, run
+    // by the scalar interpreter (lane_width 0). Outputs price, total and w.
+    std::string mixed_recipe(const std::string &types)
+    {
+        return R"({
+            "simulation_config": {"num_trials": 500, "seed": 11, "lane_width": 0},
+            "output_variable_indices": [2, 6, 8], "variable_registry": ["s", "k", "price", "hit", "cf", "big", "total", "both", "w"],)" +
+               types + R"(
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Lognormal", "args": [{"type": "scalar_literal", "value": 4.6}, {"type": "scalar_literal", "value": 0.2}]},
+                {"type": "execution_assignment", "result": [1], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 90}, {"type": "scalar_literal", "value": 110}]},
+                {"type": "execution_assignment", "result": [2], "function": "BlackScholes", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 0.05}, {"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 0.2}, {"type": "string_literal", "value": "call"}]},
+                {"type": "execution_assignment", "result": [3], "function": "Bernoulli", "args": [{"type": "scalar_literal", "value": 0.3}]},
+                {"type": "execution_assignment", "result": [4], "function": "grow_series", "args": [{"type": "variable_index", "value": 2}, {"type": "scalar_literal", "value": 0.1}, {"type": "scalar_literal", "value": 4}]},
+                {"type": "execution_assignment", "result": [5], "function": "__gt__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 100}]},
+                {"type": "execution_assignment", "result": [6], "function": "add", "args": [
+                    {"type": "execution_assignment", "function": "sum_series", "args": [{"type": "variable_index", "value": 4}]},
+                    {"type": "execution_assignment", "function": "multiply", "args": [{"type": "variable_index", "value": 3}, {"type": "execution_assignment", "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]}]}]},
+                {"type": "execution_assignment", "result": [7], "function": "__and__", "args": [{"type": "variable_index", "value": 5}, {"type": "execution_assignment", "function": "__lt__", "args": [{"type": "variable_index", "value": 1}, {"type": "scalar_literal", "value": 100}]}]},
+                {"type": "conditional_assignment", "result": 8, "condition": {"type": "variable_index", "value": 7},
+                    "then_expr": {"type": "execution_assignment", "function": "exp", "args": [{"type": "execution_assignment", "function": "divide", "args": [{"type": "variable_index", "value": 2}, {"type": "scalar_literal", "value": 50}]}]},
+                    "else_expr": {"type": "execution_assignment", "function": "subtract", "args": [{"type": "variable_index", "value": 6}, {"type": "variable_index", "value": 0}]}}
+            ]
+        })";
+    }
+
+    const std::string MIXED_TYPES = R"("variable_types": ["scalar", "scalar", "scalar", "scalar", "vector", "boolean", "scalar", "boolean", "scalar"],)";
+
+    std::string error_of(const std::string &recipe)
+    {
+        try
+        {
+            SimulationEngine::from_recipe_text(recipe)->run_outputs();
+        }
+        catch (const EngineException &e)
+        {
+            return e.what();
+        }
+        return "";
+    }
+}
+
+TEST(TypedSlotsTest, TypedProgramRunsWhatTheUntypedOneRuns)
+{
+    auto untyped = SimulationEngine::from_recipe_text(mixed_recipe(""));
+    EXPECT_EQ(untyped->get_typed_instruction_count(), 0u);
+
+    auto typed = SimulationEngine::from_recipe_text(mixed_recipe(MIXED_TYPES));
+    EXPECT_GT(typed->get_typed_instruction_count(), 0u);
+    EXPECT_EQ(typed->run_outputs(), untyped->run_outputs());
+}
+
+TEST(TypedSlotsTest, UnknownTypesAreLeftToRunTime)
+{
+    const std::string any_types = R"("variable_types": ["any", "any", "any", "any", "any", "any", "any", "any", "any"],)";
+    auto engine = SimulationEngine::from_recipe_text(mixed_recipe(any_types));
+    EXPECT_EQ(engine->run_outputs(), SimulationEngine::from_recipe_text(mixed_recipe(""))->run_outputs());
+}
+
+TEST(TypedSlotsTest, ValuesOfAnotherTypeThanDeclaredAreReported)
+{
+    // 'hit' is declared a boolean, but Bernoulli draws a scalar.
+    const std::string wrong_types = R"("variable_types": ["scalar", "scalar", "scalar", "boolean", "vector", "boolean", "scalar", "boolean", "scalar"],)";
+    const std::string message = error_of(mixed_recipe(wrong_types));
+    EXPECT_THAT(message, ::testing::HasSubstr("In function 'Bernoulli'"));
+    EXPECT_THAT(message, ::testing::HasSubstr("declares variable 3 a boolean, but it was assigned a scalar"));
+}
+
+TEST(TypedSlotsTest, PreTrialValuesOfAnotherTypeLeaveTheSlotUntyped)
+{
+    // 'rate' is declared a scalar but holds a vector after the pre-trial phase, so the
+    // per-trial steps read it with their run-time checks.
+    const std::string recipe = R"({
+        "simulation_config": {"num_trials": 10, "seed": 1, "lane_width": 0},
+        "output_variable_index": 1, "variable_registry": ["rate", "x"], "variable_types": ["scalar", "vector"],
+        "pre_trial_steps": [{"type": "literal_assignment", "result": 0, "value": [0.1, 0.2]}],
+        "per_trial_steps": [
+            {"type": "execution_assignment", "result": [1], "function": "multiply", "args": [{"type": "variable_index", "value": 0}, {"type": "execution_assignment", "function": "Uniform", "args": [{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 2}]}]}
+        ]
+    })";
+    const auto outputs = SimulationEngine::from_recipe_text(recipe)->run_outputs();
+    ASSERT_EQ(outputs.size(), 1u);
+    EXPECT_EQ(std::get<std::vector<double>>(outputs[0][0]).size(), 2u);
+}
+
+TEST(TypedSlotsTest, RejectsMalformedTypeLists)
+{
+    EXPECT_THAT(error_of(mixed_recipe(R"("variable_types": ["scalar"],)")), ::testing::HasSubstr("one type per entry"));
+    EXPECT_THAT(error_of(mixed_recipe(R"("variable_types": ["scalar", "scalar", "scalar", "scalar", "matrix", "boolean", "scalar", "boolean", "scalar"],)")),
+                ::testing::HasSubstr("Unknown variable type \"matrix\""));
+}
@@ -1,4 +1,5 @@
 #include "test/test_helpers.h"
+#include "include/engine/functions/core/kernels.h"
 
 using TestParam = std::tuple<std::string, TrialValue, bool>;
 
@@ -110,4 +111,70 @@ TEST_F(ArithmeticErrorTest, ThrowsOnVectorSizeMismatch)
     {
         FAIL() << "Expected EngineException for vector size mismatch, but a different exception was thrown.";
     }
-}
\ No newline at end of file
+}
+
+TEST_F(ArithmeticErrorTest, ThrowsOnVectorDivisionByZero)
+{
+    create_test_recipe("err.json", R"({"simulation_config":{"num_trials":1},"output_variable_index":2,"variable_registry":["A","B","C"],"per_trial_steps":[{"type":"literal_assignment","result":0,"value":[1,2,3,4,5,6,7,8,9]},{"type":"literal_assignment","result":1,"value":[1,1,1,1,1,1,1,1,0]},{"type":"execution_assignment","result":[2],"function":"divide","args":[{"type":"variable_index","value":0},{"type":"variable_index","value":1}]}]})");
+    SimulationEngine engine("err.json");
+    try
+    {
+        engine.run();
+        FAIL() << "Expected exception for division by zero.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::DivisionByZero);
+    }
+}
+
+// Every instruction set this CPU supports must agree with the scalar kernels, including the
+// tails left over after the last full register.
+TEST(ElementwiseKernelTest, AllLevelsMatchScalar)
+{
+    const ElementwiseKernels &scalar = elementwise_kernels(SimdLevel::Scalar);
+    const OpCode ops[] = {OpCode::ADD, OpCode::SUBTRACT, OpCode::MULTIPLY, OpCode::DIVIDE, OpCode::POWER};
+    for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::NEON})
+    {
+        if (!simd_level_supported(level))
+            continue;
+        const ElementwiseKernels &kernels = elementwise_kernels(level);
+        ASSERT_EQ(kernels.level, level);
+        for (size_t n : {0, 1, 3, 4, 7, 8, 17, 64})
+        {
+            std::vector<double> lhs(n), rhs(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                lhs[i] = 1.5 + static_cast<double>(i) * 0.25;
+                rhs[i] = 0.5 + static_cast<double>(i % 5);
+            }
+            for (OpCode op : ops)
+            {
+                const size_t k = kernel_index(op);
+                std::vector<double> expected = lhs, actual = lhs;
+                scalar.vector[k](expected.data(), rhs.data(), n);
+                kernels.vector[k](actual.data(), rhs.data(), n);
+                EXPECT_EQ(actual, expected) << simd_level_name(level) << " vector op " << k << " n=" << n;
+
+                expected = lhs;
+                actual = lhs;
+                scalar.scalar[k](expected.data(), 1.75, n);
+                kernels.scalar[k](actual.data(), 1.75, n);
+                EXPECT_EQ(actual, expected) << simd_level_name(level) << " scalar op " << k << " n=" << n;
+            }
+            EXPECT_FALSE(kernels.any_zero(rhs.data(), n));
+            if (n > 0)
+            {
+                rhs[n - 1] = 0.0;
+                EXPECT_TRUE(kernels.any_zero(rhs.data(), n)) << simd_level_name(level) << " n=" << n;
+            }
+        }
+    }
+}
+
+TEST(ElementwiseKernelTest, BestLevelIsSupported)
+{
+    EXPECT_TRUE(simd_level_supported(best_simd_level()));
+    EXPECT_EQ(elementwise_kernels().level, best_simd_level());
+    EXPECT_THROW(kernel_index(OpCode::EQ), EngineException);
+}
@@ -1,4 +1,5 @@
 #include "test/test_helpers.h"
+#include "include/engine/functions/epidemiology/SirModel.h"
 #include <numeric>
 
 class SirModelTest : public FileCleanupTest
@@ -89,4 +90,78 @@ TEST_F(SirModelTest, CorrectlyCalculatesDeterministicModel)
     EXPECT_NEAR(infected_vec[2], 1.4390, 1e-2);
     EXPECT_NEAR(infected_vec[3], 1.7251, 1e-2);
     EXPECT_NEAR(infected_vec[4], 2.0669, 1e-2);
-}
\ No newline at end of file
+}
+TEST_F(SirModelTest, WritesIntoExistingResultStorage)
+{
+    SirModelOperation op;
+    const std::vector<TrialValue> args = {999.0, 1.0, 0.0, 0.3, 0.1, 5.0, 1.0};
+    std::vector<const TrialValue *> arg_refs;
+    for (const auto &arg : args)
+        arg_refs.push_back(&arg);
+
+    TrialValue s, i, r;
+    TrialValue *result_refs[] = {&s, &i, &r};
+    op.execute_into(ArgumentSpan(arg_refs.data(), arg_refs.size()), ResultSpan(result_refs, 3));
+    const double *storage = std::get<std::vector<double>>(i).data();
+
+    op.execute_into(ArgumentSpan(arg_refs.data(), arg_refs.size()), ResultSpan(result_refs, 3));
+    EXPECT_EQ(std::get<std::vector<double>>(i).data(), storage);
+    EXPECT_NEAR(std::get<std::vector<double>>(i)[1], 1.1997, 1e-2);
+}
+
+namespace
+{
+    std::vector<std::vector<double>> run_sir(double beta, double gamma, double periods, double dt, const std::string &integrator)
+    {
+        SirModelOperation op;
+        std::vector<TrialValue> args = {990.0, 10.0, 0.0, beta, gamma, periods, dt};
+        if (!integrator.empty())
+            args.push_back(integrator);
+        std::vector<const TrialValue *> arg_refs;
+        for (const auto &arg : args)
+            arg_refs.push_back(&arg);
+        TrialValue s, i, r;
+        TrialValue *result_refs[] = {&s, &i, &r};
+        op.execute_into(ArgumentSpan(arg_refs.data(), arg_refs.size()), ResultSpan(result_refs, 3));
+        return {std::get<std::vector<double>>(s), std::get<std::vector<double>>(i), std::get<std::vector<double>>(r)};
+    }
+}
+
+TEST_F(SirModelTest, EulerIsTheDefaultIntegrator)
+{
+    EXPECT_EQ(run_sir(0.3, 0.1, 20, 1.0, ""), run_sir(0.3, 0.1, 20, 1.0, "Euler"));
+}
+
+TEST_F(SirModelTest, RungeKuttaMatchesAFineEulerSolutionAtLargeSteps)
+{
+    // Euler with 1/200 day steps as the reference, sampled once per day.
+    const auto reference = run_sir(0.4, 0.1, 40 * 200 + 1, 1.0 / 200, "euler");
+    const auto rk4 = run_sir(0.4, 0.1, 41, 1.0, "rk4");
+    const auto euler = run_sir(0.4, 0.1, 41, 1.0, "euler");
+
+    double rk4_error = 0.0, euler_error = 0.0;
+    for (size_t day = 0; day <= 40; ++day)
+    {
+        const double expected = reference[1][day * 200];
+        rk4_error = std::max(rk4_error, std::abs(rk4[1][day] - expected));
+        euler_error = std::max(euler_error, std::abs(euler[1][day] - expected));
+        // RK4 keeps the population constant.
+        EXPECT_NEAR(rk4[0][day] + rk4[1][day] + rk4[2][day], 1000.0, 1e-9);
+    }
+    EXPECT_LT(rk4_error, 1.0);
+    EXPECT_GT(euler_error, 10.0 * rk4_error);
+}
+
+TEST_F(SirModelTest, ThrowsOnUnknownIntegrator)
+{
+    try
+    {
+        run_sir(0.3, 0.1, 5, 1.0, "midpoint");
+        FAIL() << "Expected exception for an unknown integrator.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::MismatchedArgumentType);
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("Expected 'euler' or 'rk4'"));
+    }
+}
@@ -1,4 +1,5 @@
 #include "test/test_helpers.h"
+#include "include/engine/functions/financial/BlackScholes.h"
 
 class BlackScholesTest : public FileCleanupTest
 {
@@ -94,4 +95,116 @@ TEST_F(BlackScholesTest, ThrowsOnInvalidOptionType)
         EXPECT_EQ(e.code(), EngineErrc::MismatchedArgumentType);
         EXPECT_THAT(e.what(), ::testing::HasSubstr("Expected 'call' or 'put'"));
     }
-}
\ No newline at end of file
+}
+namespace
+{
+    template <typename Operation>
+    std::vector<TrialValue> call_operation(Operation &op, const std::vector<TrialValue> &args, size_t num_results)
+    {
+        std::vector<const TrialValue *> arg_refs;
+        for (const auto &arg : args)
+            arg_refs.push_back(&arg);
+        std::vector<TrialValue> results(num_results);
+        std::vector<TrialValue *> result_refs;
+        for (auto &result : results)
+            result_refs.push_back(&result);
+        op.execute_into(ArgumentSpan(arg_refs.data(), arg_refs.size()), ResultSpan(result_refs.data(), result_refs.size()));
+        return results;
+    }
+
+    double bs_price(double S, double K, double r, double T, double v, const std::string &type)
+    {
+        BlackScholesOperation op;
+        return std::get<double>(call_operation(op, {S, K, r, T, v, type}, 1)[0]);
+    }
+}
+
+TEST(NormalCdfTest, MatchesErfcToDoublePrecision)
+{
+    for (double x = -40.0; x <= 10.0; x += 0.01)
+    {
+        const double expected = 0.5 * std::erfc(-x / std::sqrt(2.0));
+        EXPECT_NEAR(normal_cdf(x), expected, 1e-14 + 1e-12 * expected) << "x = " << x;
+    }
+}
+
+TEST_F(BlackScholesTest, LiteralOptionTypeIsBoundAtPlanTime)
+{
+    BlackScholesOperation op;
+    const TrialValue put = std::string("PUT");
+    const std::vector<const TrialValue *> literals = {nullptr, nullptr, nullptr, nullptr, nullptr, &put};
+    EXPECT_EQ(op.bind_literal_arguments(literals), std::vector<size_t>{5});
+    EXPECT_TRUE(op.supports_lanes(5));
+
+    const double price = std::get<double>(call_operation(op, {100.0, 105.0, 0.05, 1.0, 0.2}, 1)[0]);
+    EXPECT_NEAR(price, 7.9004, 1e-4);
+
+    BlackScholesOperation unbound;
+    const TrialValue invalid = std::string("straddle");
+    EXPECT_TRUE(unbound.bind_literal_arguments({nullptr, nullptr, nullptr, nullptr, nullptr, &invalid}).empty());
+    EXPECT_FALSE(unbound.supports_lanes(5));
+}
+
+TEST_F(BlackScholesTest, VectorArgumentsPriceOneOptionPerElement)
+{
+    BlackScholesOperation op;
+    const std::vector<double> strikes = {90.0, 100.0, 110.0};
+    const std::vector<double> maturities = {0.5, 1.0, 2.0};
+    const auto results = call_operation(op, {100.0, strikes, 0.05, maturities, 0.2, std::string("call")}, 1);
+    const auto &prices = std::get<std::vector<double>>(results[0]);
+    ASSERT_EQ(prices.size(), 3u);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        EXPECT_DOUBLE_EQ(prices[i], bs_price(100.0, strikes[i], 0.05, maturities[i], 0.2, "call"));
+    }
+
+    try
+    {
+        call_operation(op, {100.0, strikes, 0.05, std::vector<double>{1.0, 2.0}, 0.2, std::string("call")}, 1);
+        FAIL() << "Expected exception for vectors of different lengths.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::VectorSizeMismatch);
+    }
+}
+
+TEST_F(BlackScholesTest, GreeksMatchFiniteDifferences)
+{
+    BlackScholesGreeksOperation op;
+    const double S = 100.0, K = 105.0, r = 0.05, T = 1.0, v = 0.2, h = 1e-3;
+    for (const std::string type : {"call", "put"})
+    {
+        const auto greeks = call_operation(op, {S, K, r, T, v, type}, 5);
+        EXPECT_DOUBLE_EQ(std::get<double>(greeks[0]), bs_price(S, K, r, T, v, type));
+        const double delta = (bs_price(S + h, K, r, T, v, type) - bs_price(S - h, K, r, T, v, type)) / (2 * h);
+        const double gamma = (bs_price(S + h, K, r, T, v, type) - 2 * bs_price(S, K, r, T, v, type) + bs_price(S - h, K, r, T, v, type)) / (h * h);
+        const double vega = (bs_price(S, K, r, T, v + h, type) - bs_price(S, K, r, T, v - h, type)) / (2 * h);
+        const double theta = -(bs_price(S, K, r, T + h, v, type) - bs_price(S, K, r, T - h, v, type)) / (2 * h);
+        EXPECT_NEAR(std::get<double>(greeks[1]), delta, 1e-6) << type;
+        EXPECT_NEAR(std::get<double>(greeks[2]), gamma, 1e-4) << type;
+        EXPECT_NEAR(std::get<double>(greeks[3]), vega, 1e-5) << type;
+        EXPECT_NEAR(std::get<double>(greeks[4]), theta, 1e-5) << type;
+    }
+}
+
+TEST_F(BlackScholesTest, BatchedLanesMatchTheScalarInterpreter)
+{
+    auto recipe = [](int lane_width)
+    {
+        return R"({"simulation_config": {"num_trials": 600, "seed": 3, "lane_width": )" + std::to_string(lane_width) + R"(},
+            "output_variable_index": 1, "variable_registry": ["spot", "price"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 80}, {"type": "scalar_literal", "value": 120}]},
+                {"type": "execution_assignment", "result": [1], "function": "BlackScholes", "args": [
+                    {"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 100},
+                    {"type": "scalar_literal", "value": 0.03}, {"type": "scalar_literal", "value": 0.5},
+                    {"type": "scalar_literal", "value": 0.25}, {"type": "string_literal", "value": "call"}]}
+            ]})";
+    };
+    create_test_recipe("recipe.json", recipe(64));
+    const auto batched = SimulationEngine("recipe.json").run();
+    create_test_recipe("recipe.json", recipe(1));
+    const auto scalar = SimulationEngine("recipe.json").run();
+    EXPECT_EQ(batched, scalar);
+}
@@ -1,4 +1,7 @@
 #include "test/test_helpers.h"
+#include "include/engine/functions/io/CsvTable.h"
+#include <filesystem>
+#include <thread>
 
 class CsvEngineTest : public FileCleanupTest
 {
@@ -18,6 +21,25 @@ protected:
         bad_csv_file << "NotANumber\n";
         bad_csv_file.close();
     }
+
+    void TearDown() override
+    {
+        CsvTable::set_sidecar_threshold(uint64_t(64) << 20);
+        FileCleanupTest::TearDown();
+    }
+
+    // Rows of "i,i/4,cell" with Windows line endings, blank lines and cells for the fallback parser.
+    static void write_large_file(size_t rows)
+    {
+        std::ofstream csv_file("large_data.csv", std::ios::binary);
+        csv_file << "Index,Quarter,Label\r\n";
+        for (size_t i = 0; i < rows; ++i)
+        {
+            csv_file << i << "," << (i % 1000 == 0 ? " +" : "") << i / 4 << "." << i % 4 * 25 << "," << (i % 7 == 0 ? "seven" : "other") << "\r\n";
+            if (i % 5000 == 0)
+                csv_file << "\r\n";
+        }
+    }
 };
 
 TEST_F(CsvEngineTest, ReadsVectorCorrectly)
@@ -185,6 +207,154 @@ TEST_F(CsvEngineTest, ThrowsOnNonNumericData)
     }
 }
 
+TEST_F(CsvEngineTest, ReportsTheCellThatIsNotANumber)
+{
+    std::ofstream("bad_data.csv") << "Name,Amount\nalpha,1.5\nbeta,oops\ngamma,2\n";
+    const std::string recipe_content = R"({
+        "simulation_config": {"num_trials": 1}, "output_variable_index": 0, "variable_registry": ["A"],
+        "pre_trial_steps": [{ "type": "execution_assignment", "result": [0], "function": "read_csv_scalar",
+            "args": [{"type": "string_literal", "value": "bad_data.csv"}, {"type": "string_literal", "value": "Amount"}, {"type":"scalar_literal", "value":1}]
+        }]
+    })";
+    create_test_recipe("err.json", recipe_content);
+    try
+    {
+        SimulationEngine engine("err.json");
+        FAIL() << "Expected exception";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::CsvConversionError);
+        EXPECT_THAT(e.what(), ::testing::HasSubstr("'oops' is not a number."));
+    }
+
+    // The other cells of the column still read as numbers.
+    const auto table = CsvTable::load("bad_data.csv");
+    const CsvTable::Column *amount = table->find_column("Amount");
+    ASSERT_NE(amount, nullptr);
+    EXPECT_TRUE(amount->is_number(0));
+    EXPECT_FALSE(amount->is_number(1));
+    EXPECT_DOUBLE_EQ(amount->values[2], 2.0);
+    EXPECT_EQ(table->find_column("Name")->text(2), "gamma");
+}
+
+TEST_F(CsvEngineTest, ReadsAnEditedFileAgain)
+{
+    const auto before = CsvTable::load("test_data.csv");
+    EXPECT_EQ(CsvTable::load("test_data.csv"), before);
+
+    std::ofstream("test_data.csv") << "ID,Value,Rate\n1,1.25,0.5\n";
+    const auto after = CsvTable::load("test_data.csv");
+    EXPECT_NE(after, before);
+    ASSERT_EQ(after->num_rows(), 1u);
+    EXPECT_DOUBLE_EQ(after->find_column("Value")->values[0], 1.25);
+    EXPECT_EQ(before->num_rows(), 3u); // Earlier readers keep their table.
+}
+
+TEST_F(CsvEngineTest, SharesOneTableBetweenThreads)
+{
+    std::vector<std::shared_ptr<const CsvTable>> tables(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < tables.size(); ++i)
+    {
+        threads.emplace_back([&tables, i]
+                             { tables[i] = CsvTable::load("test_data.csv"); });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    for (const auto &table : tables)
+    {
+        EXPECT_EQ(table, tables[0]);
+    }
+}
+
+TEST_F(CsvEngineTest, LoadsOnlyTheColumnsAskedFor)
+{
+    const auto table = CsvTable::load("test_data.csv", {"Rate", "Missing"});
+    EXPECT_EQ(table->header(), (std::vector<std::string>{"ID", "Value", "Rate"}));
+    EXPECT_TRUE(table->has_column("Rate"));
+    EXPECT_FALSE(table->has_column("Value"));
+    EXPECT_EQ(table->find_column("Missing"), nullptr);
+
+    // Asking for more keeps the columns already parsed.
+    const auto wider = CsvTable::load("test_data.csv", {"Value"});
+    EXPECT_EQ(CsvTable::load("test_data.csv", {"Rate"}), wider);
+    EXPECT_EQ(wider->find_column("Rate"), table->find_column("Rate"));
+    EXPECT_DOUBLE_EQ(wider->find_column("Value")->values[2], -50.25);
+}
+
+TEST_F(CsvEngineTest, ParsesLargeFilesInChunks)
+{
+    const size_t rows = 300000; // Several megabytes, so several chunks.
+    write_large_file(rows);
+    const auto table = CsvTable::load("large_data.csv");
+    ASSERT_EQ(table->num_rows(), rows);
+    const CsvTable::Column *index = table->find_column("Index");
+    const CsvTable::Column *quarter = table->find_column("Quarter");
+    const CsvTable::Column *label = table->find_column("Label");
+    ASSERT_TRUE(index && quarter && label);
+    EXPECT_TRUE(index->is_numeric());
+    EXPECT_TRUE(quarter->is_numeric());
+    for (size_t i = 0; i < rows; i += 997)
+    {
+        ASSERT_DOUBLE_EQ(index->values[i], static_cast<double>(i));
+        ASSERT_DOUBLE_EQ(quarter->values[i], i / 4.0);
+    }
+    EXPECT_EQ(label->invalid_rows.size(), rows);
+    EXPECT_EQ(label->dictionary.size(), 2u);
+    EXPECT_EQ(label->text(rows - 1), (rows - 1) % 7 == 0 ? "seven" : "other");
+}
+
+TEST_F(CsvEngineTest, ReusesTheSidecarCache)
+{
+    CsvTable::set_sidecar_threshold(0);
+    write_large_file(20000);
+    const auto parsed = CsvTable::load("large_data.csv", {"Quarter"});
+    ASSERT_TRUE(std::ifstream("large_data.csv.vsecache").good());
+
+    // A copy with the same size and time stamp stands for a later run. Its Quarter column
+    // comes from the copied sidecar, not from its text, which differs in the first row.
+    std::filesystem::copy_file("large_data.csv", "large_copy.csv", std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::copy_file("large_data.csv.vsecache", "large_copy.csv.vsecache", std::filesystem::copy_options::overwrite_existing);
+    {
+        std::fstream copy("large_copy.csv", std::ios::binary | std::ios::in | std::ios::out);
+        copy.seekp(25); // The 0 of the first row's " +0".
+        copy << '9';
+    }
+    std::filesystem::last_write_time("large_copy.csv", std::filesystem::last_write_time("large_data.csv"));
+    const auto from_sidecar = CsvTable::load("large_copy.csv", {"Quarter"});
+    EXPECT_EQ(from_sidecar->header(), parsed->header());
+    EXPECT_EQ(from_sidecar->find_column("Quarter")->values, parsed->find_column("Quarter")->values);
+
+    // Columns the sidecar lacks are parsed and added to it.
+    const auto sidecar_size = std::filesystem::file_size("large_copy.csv.vsecache");
+    EXPECT_EQ(CsvTable::load("large_copy.csv", {"Label"})->find_column("Label")->text(7), "seven");
+    EXPECT_GT(std::filesystem::file_size("large_copy.csv.vsecache"), sidecar_size);
+    std::remove("large_copy.csv");
+    std::remove("large_copy.csv.vsecache");
+}
+
+TEST_F(CsvEngineTest, CachesTablesByAbsolutePath)
+{
+    // The same relative name in two directories, with equal sizes and time stamps.
+    std::filesystem::create_directories("first");
+    std::filesystem::create_directories("second");
+    std::ofstream("first/rates.csv") << "Rate\n0.25\n";
+    std::ofstream("second/rates.csv") << "Rate\n0.75\n";
+    std::filesystem::last_write_time("second/rates.csv", std::filesystem::last_write_time("first/rates.csv"));
+
+    const std::filesystem::path directory = std::filesystem::current_path();
+    std::filesystem::current_path("first");
+    const auto first = CsvTable::load("rates.csv", {"Rate"});
+    std::filesystem::current_path(directory / "second");
+    const auto second = CsvTable::load("rates.csv", {"Rate"});
+    std::filesystem::current_path(directory);
+    EXPECT_EQ(first->find_column("Rate")->values, std::vector<double>{0.25});
+    EXPECT_EQ(second->find_column("Rate")->values, std::vector<double>{0.75});
+}
+
 class IoOpsErrorTest : public FileCleanupTest
 {
 };
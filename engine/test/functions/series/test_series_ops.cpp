@@ -1,4 +1,5 @@
 #include "test/test_helpers.h"
+#include "include/engine/functions/series/operations.h"
 
 using TestParam = std::tuple<std::string, TrialValue, bool>;
 
@@ -92,6 +93,7 @@ TEST_F(SeriesErrorTest, ThrowsOnIncorrectArgCount)
     TEST_ARITY("grow_series", R"([{"type":"scalar_literal","value":1},{"type":"scalar_literal","value":0.1}])", "Function 'grow_series' requires 3 arguments.");
     TEST_ARITY("interpolate_series", R"([{"type":"scalar_literal","value":1},{"type":"scalar_literal","value":10},{"type":"scalar_literal","value":5},{"type":"scalar_literal","value":4}])", "Function 'interpolate_series' requires 3 arguments.");
     TEST_ARITY("capitalize_expense", R"([{"type":"scalar_literal","value":1},{"type":"vector_literal","value":[2,3]}])", "Function 'capitalize_expense' requires 3 arguments.");
+    TEST_ARITY("irr", "[]", "Function 'irr' requires 1 or 2 arguments.");
 }
 
 TEST_F(SeriesErrorTest, ThrowsOnGetElementIndexOutOfBounds)
@@ -151,4 +153,110 @@ TEST_F(SeriesErrorTest, ThrowsOnDeleteElementEmptyVector)
     {
         EXPECT_EQ(e.code(), EngineErrc::EmptyVectorOperation);
     }
-}
\ No newline at end of file
+}
+// Portfolio matrices hold one row per period and one column per instrument.
+class PortfolioSeriesTest : public ::testing::Test
+{
+protected:
+    static TrialValue call(const IExecutable &operation, const std::vector<TrialValue> &args)
+    {
+        return operation.execute(args)[0];
+    }
+
+    static std::vector<double> column(const std::vector<double> &matrix, size_t instruments, size_t j)
+    {
+        std::vector<double> values;
+        for (size_t i = j; i < matrix.size(); i += instruments)
+            values.push_back(matrix[i]);
+        return values;
+    }
+};
+
+TEST_F(PortfolioSeriesTest, ColumnsMatchOneCallPerInstrument)
+{
+    const std::vector<double> bases = {100.0, 250.0, 40.0};
+    const std::vector<double> growth = {0.1, 0.02, -0.05};
+    const std::vector<double> discount = {0.08, 0.05, 0.12};
+    GrowSeriesOperation grow;
+    NpvOperation npv;
+
+    const auto matrix = std::get<std::vector<double>>(call(grow, {bases, growth, 4.0}));
+    ASSERT_EQ(matrix.size(), 12u);
+    const auto npvs = std::get<std::vector<double>>(call(npv, {discount, matrix}));
+    ASSERT_EQ(npvs.size(), 3u);
+    for (size_t j = 0; j < 3; ++j)
+    {
+        const TrialValue series = call(grow, {bases[j], growth[j], 4.0});
+        EXPECT_EQ(column(matrix, 3, j), std::get<std::vector<double>>(series));
+        EXPECT_EQ(npvs[j], std::get<double>(call(npv, {discount[j], series})));
+    }
+
+    // A scalar argument applies to every instrument.
+    const auto shared_rate = std::get<std::vector<double>>(call(grow, {bases, 0.1, 2.0}));
+    EXPECT_EQ(column(shared_rate, 3, 1), std::get<std::vector<double>>(call(grow, {250.0, 0.1, 2.0})));
+}
+
+TEST_F(PortfolioSeriesTest, CompoundSeriesTakesOneRateRowPerPeriod)
+{
+    CompoundSeriesOperation compound;
+    const auto matrix = std::get<std::vector<double>>(call(compound, {std::vector<double>{100.0, 10.0}, std::vector<double>{0.1, 0.5, 0.2, -0.5}}));
+    EXPECT_THAT(matrix, ::testing::Pointwise(::testing::DoubleEq(), std::vector<double>{110.0, 15.0, 132.0, 7.5}));
+
+    try
+    {
+        call(compound, {std::vector<double>{100.0, 10.0}, std::vector<double>{0.1, 0.5, 0.2}});
+        FAIL() << "Expected a ragged rate matrix to be rejected.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::VectorSizeMismatch);
+    }
+}
+
+TEST_F(PortfolioSeriesTest, IrrZeroesTheNpvOfEveryInstrument)
+{
+    IrrOperation irr;
+    NpvOperation npv;
+    const std::vector<double> single = {-100.0, 60.0, 60.0};
+    const double rate = std::get<double>(call(irr, {single}));
+    EXPECT_NEAR(rate, 0.130662386, 1e-9);
+
+    // Three instruments over four periods, the last losing nearly all of its investment.
+    const std::vector<double> cashflows = {
+        -100.0, -50.0, -1000.0,
+        30.0, 0.0, 0.001,
+        40.0, 20.0, 0.0,
+        50.0, 45.0, 0.0};
+    const auto rates = std::get<std::vector<double>>(call(irr, {cashflows, 3.0}));
+    ASSERT_EQ(rates.size(), 3u);
+    const auto npvs = std::get<std::vector<double>>(call(npv, {rates, cashflows}));
+    EXPECT_NEAR(npvs[0], 0.0, 1e-9);
+    EXPECT_NEAR(npvs[1], 0.0, 1e-9);
+    // Discounting by 1e-6 leaves the NPV of the last too ill-conditioned to check.
+    EXPECT_NEAR(rates[2], 1e-6 - 1.0, 1e-15);
+
+    try
+    {
+        call(irr, {std::vector<double>{10.0, 20.0}});
+        FAIL() << "Expected cash flows of one sign to have no internal rate of return.";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::InvalidSamplerParameters);
+    }
+}
+
+TEST_F(PortfolioSeriesTest, PortfolioRecipeValuesEveryProjectInOneStep)
+{
+    create_test_recipe("portfolio.json", R"({"simulation_config":{"num_trials":1},"output_variable_index":3,"variable_registry":["bases","cashflows","npvs","total"],"per_trial_steps":[
+        {"type":"literal_assignment","result":0,"value":[100,200]},
+        {"type":"execution_assignment","result":[1],"function":"grow_series","args":[{"type":"variable_index","value":0},{"type":"scalar_literal","value":0.1},{"type":"scalar_literal","value":2}]},
+        {"type":"execution_assignment","result":[2],"function":"npv","args":[{"type":"vector_literal","value":[0.1,0.1]},{"type":"variable_index","value":1}]},
+        {"type":"execution_assignment","result":[3],"function":"sum_series","args":[{"type":"variable_index","value":2}]}]})");
+    SimulationEngine engine("portfolio.json");
+    const auto results = engine.run();
+    ASSERT_EQ(results.size(), 1u);
+    // Growing and discounting at the same rate gives each project its base per period.
+    EXPECT_NEAR(std::get<double>(results[0]), 600.0, 1e-9);
+    std::remove("portfolio.json");
+}
@@ -0,0 +1,165 @@
+#include "test/test_helpers.h"
+#include <algorithm>
+
+namespace
+{
+    const char *MVN_ARGS = R"([{"type": "vector_literal", "value": [1, 2, 3]}, {"type": "vector_literal", "value": [1, 2, 0.5]},
+        {"type": "vector_literal", "value": [1, 0.8, -0.3, 0.8, 1, 0, -0.3, 0, 1]}])";
+
+    double pearson(const std::vector<double> &x, const std::vector<double> &y)
+    {
+        const double n = static_cast<double>(x.size());
+        const double mx = std::accumulate(x.begin(), x.end(), 0.0) / n;
+        const double my = std::accumulate(y.begin(), y.end(), 0.0) / n;
+        double sxy = 0.0, sxx = 0.0, syy = 0.0;
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            sxy += (x[i] - mx) * (y[i] - my);
+            sxx += (x[i] - mx) * (x[i] - mx);
+            syy += (y[i] - my) * (y[i] - my);
+        }
+        return sxy / std::sqrt(sxx * syy);
+    }
+
+    std::vector<double> ranks(const std::vector<double> &x)
+    {
+        std::vector<size_t> order(x.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                  { return x[a] < x[b]; });
+        std::vector<double> rank(x.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            rank[order[i]] = static_cast<double>(i);
+        return rank;
+    }
+}
+
+class CorrelationTest : public FileCleanupTest
+{
+protected:
+    std::vector<std::vector<double>> run_columns(const std::string &config, const std::string &registry, const std::string &steps, const std::string &outputs)
+    {
+        create_test_recipe("correlation.json", R"({"simulation_config": {"num_trials": 20000, "seed": 11)" + config + R"(}, "output_variable_indices": )" + outputs +
+                                                   R"(, "variable_registry": )" + registry + R"(, "per_trial_steps": )" + steps + "}");
+        std::vector<std::vector<double>> columns;
+        for (const auto &column : SimulationEngine("correlation.json").run_outputs())
+        {
+            columns.emplace_back();
+            for (const TrialValue &value : column)
+                columns.back().push_back(std::get<double>(value));
+        }
+        std::remove("correlation.json");
+        return columns;
+    }
+
+    std::vector<std::vector<double>> run_mvn(const std::string &config = "")
+    {
+        return run_columns(config, R"(["a", "b", "c"])", R"([{"type": "execution_assignment", "result": [0, 1, 2], "function": "MultivariateNormal", "args": )" + std::string(MVN_ARGS) + "}]", "[0, 1, 2]");
+    }
+
+    void expect_error(const std::string &recipe, EngineErrc code)
+    {
+        create_test_recipe("correlation.json", recipe);
+        try
+        {
+            SimulationEngine engine("correlation.json");
+            engine.run();
+            FAIL() << "Expected an EngineException";
+        }
+        catch (const EngineException &e)
+        {
+            EXPECT_EQ(e.code(), code) << e.what();
+        }
+        std::remove("correlation.json");
+    }
+};
+
+TEST_F(CorrelationTest, MultivariateNormalHasTheTargetMomentsAndCorrelation)
+{
+    const auto columns = run_mvn();
+    ASSERT_EQ(columns.size(), 3u);
+    EXPECT_NEAR(std::accumulate(columns[0].begin(), columns[0].end(), 0.0) / 20000, 1.0, 0.03);
+    EXPECT_NEAR(std::accumulate(columns[1].begin(), columns[1].end(), 0.0) / 20000, 2.0, 0.06);
+    EXPECT_NEAR(std::accumulate(columns[2].begin(), columns[2].end(), 0.0) / 20000, 3.0, 0.015);
+    EXPECT_NEAR(pearson(columns[0], columns[1]), 0.8, 0.02);
+    EXPECT_NEAR(pearson(columns[0], columns[2]), -0.3, 0.03);
+    EXPECT_NEAR(pearson(columns[1], columns[2]), 0.0, 0.03);
+}
+
+TEST_F(CorrelationTest, BatchedDrawsMatchTheInterpreter)
+{
+    const auto expected = run_mvn(R"(, "lane_width": 0, "threads": 1)");
+    const auto actual = run_mvn(R"(, "lane_width": 16, "threads": 3, "chunk_size": 5)");
+    ASSERT_EQ(actual, expected);
+}
+
+TEST_F(CorrelationTest, OneResultHoldsTheComponentsAsAVector)
+{
+    const auto scalars = run_mvn();
+    create_test_recipe("correlation.json", R"({"simulation_config": {"num_trials": 20000, "seed": 11}, "output_variable_index": 0, "variable_registry": ["x"],
+        "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": "MultivariateNormal", "args": )" + std::string(MVN_ARGS) + "}]}");
+    const std::vector<TrialValue> vectors = SimulationEngine("correlation.json").run();
+    ASSERT_EQ(vectors.size(), 20000u);
+    for (size_t trial = 0; trial < vectors.size(); trial += 997)
+    {
+        const auto &draw = std::get<std::vector<double>>(vectors[trial]);
+        ASSERT_EQ(draw.size(), 3u);
+        for (size_t k = 0; k < 3; ++k)
+            EXPECT_EQ(draw[k], scalars[k][trial]) << "trial " << trial << ", component " << k;
+    }
+}
+
+TEST_F(CorrelationTest, InvalidMultivariateNormalArgumentsThrow)
+{
+    auto recipe = [](const std::string &args, const std::string &result)
+    {
+        return R"({"simulation_config": {"num_trials": 4}, "output_variable_index": 0, "variable_registry": ["a", "b"],
+            "per_trial_steps": [{"type": "execution_assignment", "result": )" +
+               result + R"(, "function": "MultivariateNormal", "args": )" + args + "}]}";
+    };
+    const std::string zeros = R"({"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}, )";
+    expect_error(recipe("[" + zeros + R"({"type": "vector_literal", "value": [1, 1.5, 1.5, 1]}])", "[0, 1]"), EngineErrc::InvalidSamplerParameters);
+    expect_error(recipe("[" + zeros + R"({"type": "vector_literal", "value": [1, 0.5, 0.5]}])", "[0, 1]"), EngineErrc::InvalidSamplerParameters);
+    expect_error(recipe("[" + zeros + R"({"type": "vector_literal", "value": [1, 0.5, 0.4, 1]}])", "[0, 1]"), EngineErrc::InvalidSamplerParameters);
+    expect_error(recipe(R"([{"type": "vector_literal", "value": [0, 0, 0]}, {"type": "scalar_literal", "value": 1}, {"type": "vector_literal", "value": [1, 0, 0, 1]}])", "[0, 1]"),
+                 EngineErrc::VectorSizeMismatch);
+    expect_error(recipe(R"([{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}])", "[0, 1]"), EngineErrc::IncorrectArgumentCount);
+}
+
+TEST_F(CorrelationTest, RankCorrelationsCoupleDrawsAndKeepTheirMarginals)
+{
+    const std::string steps = R"([{"type": "execution_assignment", "result": [0], "function": "Pert", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 2}, {"type": "scalar_literal", "value": 10}]},
+        {"type": "execution_assignment", "result": [1], "function": "Lognormal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 0.5}]},
+        {"type": "execution_assignment", "result": [2], "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]}])";
+    const std::string correlations = R"(, "rank_correlations": [{"variables": ["cost", 1], "matrix": [[1, -0.6], [-0.6, 1]]}])";
+    const auto columns = run_columns(correlations, R"(["cost", "delay", "noise"])", steps, "[0, 1, 2]");
+    EXPECT_NEAR(pearson(ranks(columns[0]), ranks(columns[1])), -0.6, 0.02);
+    EXPECT_NEAR(pearson(ranks(columns[0]), ranks(columns[2])), 0.0, 0.03);
+    EXPECT_NEAR(std::accumulate(columns[0].begin(), columns[0].end(), 0.0) / 20000, 3.0, 0.03);
+    EXPECT_NEAR(std::accumulate(columns[1].begin(), columns[1].end(), 0.0) / 20000, std::exp(0.125), 0.02);
+
+    // The uncorrelated variable keeps the draws it has without the option.
+    const auto independent = run_columns("", R"(["cost", "delay", "noise"])", steps, "[0, 1, 2]");
+    EXPECT_EQ(columns[2], independent[2]);
+
+    const auto batched = run_columns(correlations + R"(, "lane_width": 16, "threads": 3, "chunk_size": 5)", R"(["cost", "delay", "noise"])", steps, "[0, 1, 2]");
+    EXPECT_EQ(batched, columns);
+    const auto sobol = run_columns(correlations + R"(, "sampling": "sobol")", R"(["cost", "delay", "noise"])", steps, "[0, 1, 2]");
+    EXPECT_NEAR(pearson(ranks(sobol[0]), ranks(sobol[1])), -0.6, 0.01);
+}
+
+TEST_F(CorrelationTest, InvalidRankCorrelationsAreConfigErrors)
+{
+    auto recipe = [](const std::string &correlations)
+    {
+        return R"({"simulation_config": {"num_trials": 4, "rank_correlations": )" + correlations + R"(}, "output_variable_index": 0, "variable_registry": ["a", "b", "c"],
+            "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+                {"type": "execution_assignment", "result": [1], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+                {"type": "execution_assignment", "result": [2], "function": "add", "args": [{"type": "variable_index", "value": 0}, {"type": "variable_index", "value": 1}]}]})";
+    };
+    expect_error(recipe(R"([{"variables": ["a", "c"], "matrix": [[1, 0.5], [0.5, 1]]}])"), EngineErrc::RecipeConfigError);
+    expect_error(recipe(R"([{"variables": ["a", "z"], "matrix": [[1, 0.5], [0.5, 1]]}])"), EngineErrc::RecipeConfigError);
+    expect_error(recipe(R"([{"variables": ["a", "b"], "matrix": [[1, 0.5], [0.4, 1]]}])"), EngineErrc::RecipeConfigError);
+    expect_error(recipe(R"([{"variables": ["a", "b"], "matrix": [[1, 0.5]]}])"), EngineErrc::RecipeConfigError);
+    expect_error(recipe(R"([{"variables": ["a", "a"], "matrix": [[1, 0.5], [0.5, 1]]}])"), EngineErrc::RecipeConfigError);
+}
@@ -0,0 +1,206 @@
+#include "test/test_helpers.h"
+
+namespace
+{
+    std::string scalar_args(const std::vector<double> &values)
+    {
+        std::string args = "[";
+        for (size_t k = 0; k < values.size(); ++k)
+        {
+            args += (k ? ", " : "") + std::string(R"({"type": "scalar_literal", "value": )") + std::to_string(values[k]) + "}";
+        }
+        return args + "]";
+    }
+
+    double mean(const std::vector<double> &values)
+    {
+        return std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+    }
+
+    double variance(const std::vector<double> &values)
+    {
+        const double m = mean(values);
+        double sum = 0.0;
+        for (double value : values)
+            sum += (value - m) * (value - m);
+        return sum / static_cast<double>(values.size() - 1);
+    }
+}
+
+class PathSamplerTest : public FileCleanupTest
+{
+protected:
+    std::vector<std::vector<double>> run_paths(const std::string &function, const std::vector<double> &args, int trials = 20000, const std::string &config = "")
+    {
+        create_test_recipe("paths.json", R"({"simulation_config": {"num_trials": )" + std::to_string(trials) + R"(, "seed": 5)" + config +
+                                             R"(}, "output_variable_index": 0, "variable_registry": ["path"], "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": ")" +
+                                             function + R"(", "args": )" + scalar_args(args) + "}]}");
+        std::vector<std::vector<double>> paths;
+        for (const TrialValue &value : SimulationEngine("paths.json").run())
+            paths.push_back(std::get<std::vector<double>>(value));
+        std::remove("paths.json");
+        return paths;
+    }
+
+    static std::vector<double> column(const std::vector<std::vector<double>> &paths, size_t period)
+    {
+        std::vector<double> values;
+        for (const auto &path : paths)
+            values.push_back(path.at(period));
+        return values;
+    }
+
+    void expect_error(const std::string &function, const std::vector<double> &args, EngineErrc code)
+    {
+        try
+        {
+            run_paths(function, args, 2);
+            FAIL() << "Expected an EngineException";
+        }
+        catch (const EngineException &e)
+        {
+            EXPECT_EQ(e.code(), code) << e.what();
+        }
+        std::remove("paths.json");
+    }
+};
+
+TEST_F(PathSamplerTest, DeterministicPathsFollowTheirDrift)
+{
+    const auto gbm = run_paths("gbm_path", {100.0, 0.05, 0.0, 4.0, 0.5}, 1);
+    ASSERT_EQ(gbm[0].size(), 4u);
+    for (size_t t = 0; t < 4; ++t)
+        EXPECT_NEAR(gbm[0][t], 100.0 * std::exp(0.05 * 0.5 * (t + 1)), 1e-9);
+
+    const auto ou = run_paths("ou_path", {10.0, 2.0, 0.7, 0.0, 3.0}, 1);
+    ASSERT_EQ(ou[0].size(), 3u);
+    for (size_t t = 0; t < 3; ++t)
+        EXPECT_NEAR(ou[0][t], 2.0 + 8.0 * std::exp(-0.7 * (t + 1)), 1e-9);
+
+    EXPECT_TRUE(run_paths("gbm_path", {100.0, 0.05, 0.2, 0.0}, 1)[0].empty());
+}
+
+TEST_F(PathSamplerTest, GbmPathHasLognormalMoments)
+{
+    const auto paths = run_paths("gbm_path", {100.0, 0.08, 0.3, 12.0, 1.0 / 12});
+    const std::vector<double> terminal = column(paths, 11);
+    EXPECT_NEAR(mean(terminal), 100.0 * std::exp(0.08), 0.6);
+    std::vector<double> log_returns;
+    for (double value : terminal)
+        log_returns.push_back(std::log(value / 100.0));
+    EXPECT_NEAR(mean(log_returns), 0.08 - 0.045, 0.006);
+    EXPECT_NEAR(variance(log_returns), 0.09, 0.003);
+}
+
+TEST_F(PathSamplerTest, OuPathRevertsToItsStationaryDistribution)
+{
+    const auto paths = run_paths("ou_path", {0.10, 0.03, 2.0, 0.02, 40.0, 0.25});
+    const std::vector<double> half_life = column(paths, 1);
+    EXPECT_NEAR(mean(half_life), 0.03 + 0.07 * std::exp(-1.0), 3e-4);
+    const std::vector<double> terminal = column(paths, 39);
+    EXPECT_NEAR(mean(terminal), 0.03, 3e-4);
+    EXPECT_NEAR(variance(terminal), 0.02 * 0.02 / 4.0, 4e-6);
+
+    const auto brownian = run_paths("ou_path", {1.0, 0.0, 0.0, 0.5, 4.0});
+    EXPECT_NEAR(mean(column(brownian, 3)), 1.0, 0.02);
+    EXPECT_NEAR(variance(column(brownian, 3)), 1.0, 0.03);
+}
+
+TEST_F(PathSamplerTest, JumpDiffusionIsCompensatedAndReducesToGbm)
+{
+    const auto jumps = run_paths("jump_diffusion_path", {100.0, 0.05, 0.2, 3.0, -0.1, 0.15, 50.0, 0.02});
+    const std::vector<double> terminal = column(jumps, 49);
+    EXPECT_NEAR(mean(terminal), 100.0 * std::exp(0.05), 0.7);
+    std::vector<double> log_returns;
+    for (double value : terminal)
+        log_returns.push_back(std::log(value / 100.0));
+    // Diffusion variance plus intensity * E[Y^2] of the log jump sizes.
+    EXPECT_NEAR(variance(log_returns), 0.04 + 3.0 * (0.01 + 0.0225), 0.005);
+
+    const auto without_jumps = run_paths("jump_diffusion_path", {100.0, 0.05, 0.2, 0.0, -0.1, 0.15, 50.0, 0.02}, 200);
+    const auto gbm = run_paths("gbm_path", {100.0, 0.05, 0.2, 50.0, 0.02}, 200);
+    ASSERT_EQ(without_jumps, gbm);
+}
+
+TEST_F(PathSamplerTest, PathsDoNotDependOnTheSchedule)
+{
+    const std::vector<double> args{100.0, 0.05, 0.2, 2.0, -0.1, 0.15, 30.0, 0.1};
+    const auto expected = run_paths("jump_diffusion_path", args, 500, R"(, "threads": 1)");
+    EXPECT_EQ(run_paths("jump_diffusion_path", args, 500, R"(, "threads": 3, "chunk_size": 7, "lane_width": 16)"), expected);
+    // Under sobol, path draws keep coming from the stream.
+    EXPECT_EQ(run_paths("jump_diffusion_path", args, 500, R"(, "sampling": "sobol")"), expected);
+}
+
+TEST_F(PathSamplerTest, AntitheticPairsMirrorTheirPaths)
+{
+    // Started at its mean level of 0, an OU path is linear in its normals: the second trial of
+    // each pair walks the first one's path upside down.
+    const std::vector<double> args{0.0, 0.0, 0.5, 1.0, 10.0};
+    const auto pseudo = run_paths("ou_path", args, 100);
+    const auto antithetic = run_paths("ou_path", args, 100, R"(, "variance_reduction": "antithetic")");
+    ASSERT_EQ(antithetic.size(), 100u);
+    for (size_t trial = 0; trial < antithetic.size(); trial += 2)
+    {
+        EXPECT_EQ(antithetic[trial], pseudo[trial]);
+        for (size_t period = 0; period < 10; ++period)
+            EXPECT_NEAR(antithetic[trial + 1][period], -antithetic[trial][period], 1e-12);
+    }
+}
+
+TEST_F(PathSamplerTest, DesignsThatSkipPathsWarn)
+{
+    const auto recipe = [](const std::string &config)
+    {
+        return R"({"simulation_config": {"num_trials": 8)" + config +
+               R"(}, "output_variable_index": 0, "variable_registry": ["path"], "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": "gbm_path", "args": )" +
+               scalar_args({100.0, 0.05, 0.2, 10.0}) + "}]}";
+    };
+    const auto warnings = [&](const std::string &config)
+    {
+        std::vector<std::string> messages;
+        SimulationEngine::from_recipe_text(recipe(config), false, [&](LogLevel level, const std::string &message)
+                                           {
+            if (level == LogLevel::Warning)
+                messages.push_back(message); });
+        return messages;
+    };
+    for (const std::string config : {R"(, "sampling": "sobol")", R"(, "variance_reduction": "lhs")"})
+    {
+        const auto messages = warnings(config);
+        ASSERT_EQ(messages.size(), 1u) << config;
+        EXPECT_NE(messages[0].find("'gbm_path'"), std::string::npos) << messages[0];
+    }
+    EXPECT_TRUE(warnings("").empty());
+    EXPECT_TRUE(warnings(R"(, "variance_reduction": "antithetic")").empty());
+}
+
+TEST_F(PathSamplerTest, PathsCannotBeRankCorrelated)
+{
+    const std::string recipe = R"({"simulation_config": {"num_trials": 8, "rank_correlations": [{"variables": ["path", "x"], "matrix": [[1, 0.5], [0.5, 1]]}]},
+        "output_variable_index": 0, "variable_registry": ["path", "x"], "per_trial_steps": [
+        {"type": "execution_assignment", "result": [0], "function": "gbm_path", "args": )" +
+                               scalar_args({100.0, 0.05, 0.2, 10.0}) + R"(},
+        {"type": "execution_assignment", "result": [1], "function": "Normal", "args": )" +
+                               scalar_args({0.0, 1.0}) + "}]}";
+    try
+    {
+        SimulationEngine::from_recipe_text(recipe);
+        FAIL() << "Expected an EngineException";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::RecipeConfigError) << e.what();
+        EXPECT_NE(std::string(e.what()).find("'path'"), std::string::npos) << e.what();
+    }
+}
+
+TEST_F(PathSamplerTest, InvalidArgumentsThrow)
+{
+    expect_error("gbm_path", {100.0, 0.05, 0.2}, EngineErrc::IncorrectArgumentCount);
+    expect_error("ou_path", {0.0, 0.0, 1.0, 1.0, 10.0, 1.0, 1.0}, EngineErrc::IncorrectArgumentCount);
+    expect_error("gbm_path", {100.0, 0.05, -0.2, 10.0}, EngineErrc::InvalidSamplerParameters);
+    expect_error("gbm_path", {100.0, 0.05, 0.2, 10.0, 0.0}, EngineErrc::InvalidSamplerParameters);
+    expect_error("ou_path", {0.0, 0.0, -1.0, 1.0, 10.0}, EngineErrc::InvalidSamplerParameters);
+    expect_error("jump_diffusion_path", {100.0, 0.05, 0.2, -1.0, 0.0, 0.1, 10.0}, EngineErrc::InvalidSamplerParameters);
+    expect_error("jump_diffusion_path", {100.0, 0.05, 0.2, 1.0, 0.0, -0.1, 10.0}, EngineErrc::InvalidSamplerParameters);
+}
@@ -1,4 +1,7 @@
 #include "test/test_helpers.h"
+#include "include/engine/core/Random.h"
+#include "include/engine/core/SamplingDesign.h"
+#include <algorithm>
 
 class EngineSamplerTest : public FileCleanupTest
 {
@@ -64,6 +67,12 @@ TEST_F(EngineSamplerTest, Beta)
     RunAndAnalyze(R"({"simulation_config":{"num_trials":20000},"output_variable_index":0,"variable_registry":["X"],"per_trial_steps":[{"type":"execution_assignment","result":[0],"function":"Beta","args":[{"type":"scalar_literal","value":2.0},{"type":"scalar_literal","value":5.0}]}]})", 20000, expected_mean, 0.01, true, 0.0, 1.0);
 }
 
+TEST_F(EngineSamplerTest, BetaWithShapeBelowOne)
+{
+    double expected_mean = 0.5 / (0.5 + 3.0); // ~0.1429, exercises the shape < 1 boost
+    RunAndAnalyze(R"({"simulation_config":{"num_trials":20000},"output_variable_index":0,"variable_registry":["X"],"per_trial_steps":[{"type":"execution_assignment","result":[0],"function":"Beta","args":[{"type":"scalar_literal","value":0.5},{"type":"scalar_literal","value":3.0}]}]})", 20000, expected_mean, 0.01, true, 0.0, 1.0);
+}
+
 TEST_F(EngineSamplerTest, Lognormal)
 {
     double log_mean = 2.0, log_stddev = 0.5;
@@ -102,4 +111,274 @@ TEST_F(SamplerErrorTest, AllSamplersThrowOnIncorrectArgCount)
     TEST_ARITY("Beta", R"([{"type":"scalar_literal","value":1.0}])", "Function 'Beta' requires 2 arguments");
     TEST_ARITY("Pert", R"([{"type":"scalar_literal","value":1.0},{"type":"scalar_literal","value":2.0}])", "Function 'Pert' requires 3 arguments");
     TEST_ARITY("Triangular", R"([{"type":"scalar_literal","value":1.0},{"type":"scalar_literal","value":2.0},{"type":"scalar_literal","value":3.0},{"type":"scalar_literal","value":4.0}])", "Function 'Triangular' requires 3 arguments");
-}
\ No newline at end of file
+}
+// --- Reproducible random streams ---
+TEST(RandomStreamTest, PhiloxMatchesKnownAnswer)
+{
+    // Known-answer vector of Philox4x32-10 for a zero counter and key (Random123).
+    const auto block = philox4x32({0, 0, 0, 0}, {0, 0});
+    EXPECT_EQ(block[0], 0x6627e8d5u);
+    EXPECT_EQ(block[1], 0xe169c58du);
+    EXPECT_EQ(block[2], 0xbc57ac4cu);
+    EXPECT_EQ(block[3], 0x9b00dbd8u);
+}
+
+class SamplerReproducibilityTest : public FileCleanupTest
+{
+protected:
+    // Two samplers on either side of a varying condition, so batched runs split lanes.
+    std::vector<TrialValue> run_with(const std::string &config)
+    {
+        create_test_recipe("seeded.json", R"({"simulation_config": {"num_trials": 300, )" + config + R"(}, "output_variable_index": 2, "variable_registry": ["x", "high", "result"],
+            "per_trial_steps": [
+                {"type": "execution_assignment", "result": [0], "function": "Normal", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]},
+                {"type": "execution_assignment", "result": [1], "function": "__gt__", "args": [{"type": "variable_index", "value": 0}, {"type": "scalar_literal", "value": 0}]},
+                {"type": "conditional_assignment", "result": 2,
+                    "condition": {"type": "variable_index", "value": 1},
+                    "then_expr": {"type": "execution_assignment", "function": "Beta", "args": [{"type": "scalar_literal", "value": 2}, {"type": "scalar_literal", "value": 5}]},
+                    "else_expr": {"type": "execution_assignment", "function": "add", "args": [{"type": "variable_index", "value": 0},
+                        {"type": "execution_assignment", "function": "Triangular", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 3}]}]}
+                }
+            ]})");
+        return SimulationEngine("seeded.json").run();
+    }
+};
+
+TEST_F(SamplerReproducibilityTest, SameSeedGivesSameTrialsWhateverTheSchedule)
+{
+    const auto expected = run_with(R"("seed": 42, "lane_width": 0, "threads": 1)");
+    for (const char *config : {R"("seed": 42, "lane_width": 0, "threads": 4, "chunk_size": 7)",
+                               R"("seed": 42, "lane_width": 16, "threads": 3, "chunk_size": 5)",
+                               R"("seed": 42, "lane_width": 256)"})
+    {
+        const auto actual = run_with(config);
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            ASSERT_EQ(std::get<double>(actual[i]), std::get<double>(expected[i])) << config << ", trial " << i;
+        }
+    }
+}
+
+TEST_F(SamplerReproducibilityTest, DifferentSeedsGiveDifferentTrials)
+{
+    const auto first = run_with(R"("seed": 1)");
+    const auto second = run_with(R"("seed": 2)");
+    size_t equal = 0;
+    for (size_t i = 0; i < first.size(); ++i)
+    {
+        equal += std::get<double>(first[i]) == std::get<double>(second[i]);
+    }
+    EXPECT_LT(equal, 5u);
+}
+
+TEST_F(SamplerReproducibilityTest, UnseededRunsDiffer)
+{
+    create_test_recipe("unseeded.json", R"({"simulation_config": {"num_trials": 1}, "output_variable_index": 0, "variable_registry": ["x"], "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": "Uniform", "args": [{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}]}]})");
+    SimulationEngine first("unseeded.json");
+    SimulationEngine second("unseeded.json");
+    EXPECT_NE(first.get_seed(), second.get_seed());
+    EXPECT_NE(std::get<double>(first.run()[0]), std::get<double>(second.run()[0]));
+}
+
+// --- Quasi-Monte Carlo sampling ---
+TEST(SobolDesignTest, FirstDimensionsMatchTheUnscrambledSequence)
+{
+    const SobolDesign sobol(2, 0);
+    const double expected_0[] = {0.0, 0.5, 0.25, 0.75, 0.125, 0.625, 0.375, 0.875};
+    const double expected_1[] = {0.0, 0.5, 0.75, 0.25, 0.625, 0.125, 0.375, 0.875};
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        EXPECT_EQ(sobol.point(i, 0) * 0x1.0p-32, expected_0[i]) << i;
+        EXPECT_EQ(sobol.point(i, 1) * 0x1.0p-32, expected_1[i]) << i;
+    }
+}
+
+TEST(SobolDesignTest, ScrambledPrefixesStratifyEveryDimension)
+{
+    const SobolDesign sobol(300, 42);
+    constexpr uint32_t N = 1024;
+    for (uint32_t site : {0u, 1u, 7u, 100u, 299u})
+    {
+        std::vector<int> cells(N, 0);
+        for (uint32_t trial = 0; trial < N; ++trial)
+        {
+            const double u = sobol.uniform(trial, site);
+            ASSERT_GT(u, 0.0);
+            ASSERT_LT(u, 1.0);
+            ++cells[static_cast<size_t>(u * N)];
+        }
+        EXPECT_EQ(std::count(cells.begin(), cells.end(), 1), static_cast<long>(N)) << "site " << site;
+    }
+}
+
+TEST(SobolDesignTest, FirstTwoDimensionsFormNets)
+{
+    // Every 2^k x 2^(10-k) grid of boxes holds one of the first 1024 points per box, scrambled or not.
+    const SobolDesign sobol(2, 7);
+    constexpr uint32_t N = 1024;
+    for (uint32_t k = 0; k <= 10; ++k)
+    {
+        std::vector<int> boxes(N, 0);
+        for (uint32_t trial = 0; trial < N; ++trial)
+        {
+            const size_t row = static_cast<size_t>(sobol.uniform(trial, 0) * (1u << k));
+            const size_t column = static_cast<size_t>(sobol.uniform(trial, 1) * (N >> k));
+            ++boxes[(row << (10 - k)) | column];
+        }
+        EXPECT_EQ(std::count(boxes.begin(), boxes.end(), 1), static_cast<long>(N)) << "k = " << k;
+    }
+}
+
+class QuasiSamplingTest : public FileCleanupTest
+{
+protected:
+    std::vector<double> run_sampler(const std::string &function, const std::string &args, const std::string &config)
+    {
+        create_test_recipe("quasi.json", R"({"simulation_config": {"num_trials": 4096, "seed": 3, )" + config + R"(}, "output_variable_index": 0, "variable_registry": ["x"],
+            "per_trial_steps": [{"type": "execution_assignment", "result": [0], "function": ")" + function + R"(", "args": )" + args + R"(}]})");
+        std::vector<double> samples;
+        for (const TrialValue &value : SimulationEngine("quasi.json").run())
+        {
+            samples.push_back(std::get<double>(value));
+        }
+        std::remove("quasi.json");
+        return samples;
+    }
+
+    static double mean_of(const std::vector<double> &samples)
+    {
+        return std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    }
+};
+
+TEST_F(QuasiSamplingTest, UnknownSamplingIsAConfigError)
+{
+    create_test_recipe("quasi.json", R"({"simulation_config": {"num_trials": 1, "sampling": "halton"}, "output_variable_index": 0, "variable_registry": ["x"], "per_trial_steps": []})");
+    try
+    {
+        SimulationEngine engine("quasi.json");
+        FAIL() << "Expected an EngineException";
+    }
+    catch (const EngineException &e)
+    {
+        EXPECT_EQ(e.code(), EngineErrc::RecipeConfigError);
+    }
+    std::remove("quasi.json");
+}
+
+TEST_F(QuasiSamplingTest, SobolMomentsAreFarMoreAccurateThanPseudo)
+{
+    const std::string normal_args = R"([{"type": "scalar_literal", "value": 100}, {"type": "scalar_literal", "value": 15}])";
+    const std::vector<double> sobol = run_sampler("Normal", normal_args, R"("sampling": "sobol")");
+    // Error of the Sobol mean is far below the pseudo-random standard error of 15 / 64.
+    EXPECT_NEAR(mean_of(sobol), 100.0, 0.01);
+    double variance = 0.0;
+    for (double x : sobol)
+        variance += (x - 100.0) * (x - 100.0);
+    EXPECT_NEAR(std::sqrt(variance / sobol.size()), 15.0, 0.05);
+
+    const std::string pert_args = R"([{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 2}, {"type": "scalar_literal", "value": 10}])";
+    EXPECT_NEAR(mean_of(run_sampler("Pert", pert_args, R"("sampling": "sobol")")), (0.0 + 4.0 * 2.0 + 10.0) / 6.0, 1e-3);
+    const std::string triangular_args = R"([{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 3}])";
+    EXPECT_NEAR(mean_of(run_sampler("Triangular", triangular_args, R"("sampling": "sobol")")), 4.0 / 3.0, 1e-3);
+    const std::string lognormal_args = R"([{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 0.5}])";
+    EXPECT_NEAR(mean_of(run_sampler("Lognormal", lognormal_args, R"("sampling": "sobol")")), std::exp(0.125), 2e-3);
+    const std::string beta_args = R"([{"type": "scalar_literal", "value": 2}, {"type": "scalar_literal", "value": 5}])";
+    EXPECT_NEAR(mean_of(run_sampler("Beta", beta_args, R"("sampling": "sobol")")), 2.0 / 7.0, 1e-4);
+}
+
+TEST_F(QuasiSamplingTest, SobolTrialsDoNotDependOnTheSchedule)
+{
+    const std::string args = R"([{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 3}])";
+    const auto expected = run_sampler("Pert", args, R"("sampling": "sobol", "lane_width": 0, "threads": 1)");
+    const auto actual = run_sampler("Pert", args, R"("sampling": "sobol", "lane_width": 16, "threads": 3, "chunk_size": 5)");
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        ASSERT_EQ(actual[i], expected[i]) << "trial " << i;
+    }
+}
+
+// --- Variance reduction ---
+TEST(LatinHypercubeDesignTest, EverySiteVisitsEveryStratumOnce)
+{
+    for (uint64_t trials : {1ull, 7ull, 1000ull, 4096ull})
+    {
+        const LatinHypercubeDesign design(trials, 11);
+        for (uint32_t site : {0u, 5u})
+        {
+            std::vector<int> strata(trials, 0);
+            for (uint64_t trial = 0; trial < trials; ++trial)
+            {
+                const double u = design.uniform(trial, site);
+                ASSERT_GT(u, 0.0);
+                ASSERT_LT(u, 1.0);
+                ++strata[static_cast<size_t>(u * static_cast<double>(trials))];
+            }
+            EXPECT_EQ(std::count(strata.begin(), strata.end(), 1), static_cast<long>(trials)) << trials << " trials, site " << site;
+        }
+    }
+    // Sites are stratified in independent orders.
+    const LatinHypercubeDesign design(1000, 11);
+    size_t same_stratum = 0;
+    for (uint64_t trial = 0; trial < 1000; ++trial)
+    {
+        same_stratum += static_cast<int>(design.uniform(trial, 0) * 1000) == static_cast<int>(design.uniform(trial, 1) * 1000);
+    }
+    EXPECT_LT(same_stratum, 10u);
+}
+
+TEST(AntitheticDesignTest, PairsMirrorEachOther)
+{
+    const AntitheticDesign design(5);
+    for (uint64_t pair = 0; pair < 100; ++pair)
+    {
+        EXPECT_DOUBLE_EQ(design.uniform(2 * pair, 3) + design.uniform(2 * pair + 1, 3), 1.0);
+    }
+    EXPECT_NE(design.uniform(0, 3), design.uniform(2, 3));
+}
+
+TEST_F(QuasiSamplingTest, VarianceReductionNeedsPseudoSampling)
+{
+    for (const char *config : {R"("sampling": "sobol", "variance_reduction": "lhs")", R"("variance_reduction": "stratified")"})
+    {
+        create_test_recipe("quasi.json", std::string(R"({"simulation_config": {"num_trials": 1, )") + config + R"(}, "output_variable_index": 0, "variable_registry": ["x"], "per_trial_steps": []})");
+        try
+        {
+            SimulationEngine engine("quasi.json");
+            FAIL() << "Expected an EngineException for " << config;
+        }
+        catch (const EngineException &e)
+        {
+            EXPECT_EQ(e.code(), EngineErrc::RecipeConfigError);
+        }
+    }
+    std::remove("quasi.json");
+}
+
+TEST_F(QuasiSamplingTest, LatinHypercubeAndAntitheticMeansBeatPseudo)
+{
+    const std::string normal_args = R"([{"type": "scalar_literal", "value": 100}, {"type": "scalar_literal", "value": 15}])";
+    // Pseudo-random standard error of the mean is 15 / 64 here.
+    EXPECT_NEAR(mean_of(run_sampler("Normal", normal_args, R"("variance_reduction": "lhs")")), 100.0, 0.02);
+
+    const std::vector<double> antithetic = run_sampler("Normal", normal_args, R"("variance_reduction": "antithetic")");
+    for (size_t i = 0; i < antithetic.size(); i += 2)
+    {
+        ASSERT_NEAR(antithetic[i] + antithetic[i + 1], 200.0, 1e-9) << "pair " << i / 2;
+    }
+    const std::string triangular_args = R"([{"type": "scalar_literal", "value": 0}, {"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 3}])";
+    EXPECT_NEAR(mean_of(run_sampler("Triangular", triangular_args, R"("variance_reduction": "lhs")")), 4.0 / 3.0, 1e-3);
+}
+
+TEST_F(QuasiSamplingTest, VarianceReducedTrialsDoNotDependOnTheSchedule)
+{
+    const std::string args = R"([{"type": "scalar_literal", "value": 1}, {"type": "scalar_literal", "value": 2}])";
+    for (const char *reduction : {R"("variance_reduction": "lhs")", R"("variance_reduction": "antithetic")"})
+    {
+        const auto expected = run_sampler("Lognormal", args, std::string(reduction) + R"(, "lane_width": 0, "threads": 1)");
+        const auto actual = run_sampler("Lognormal", args, std::string(reduction) + R"(, "lane_width": 16, "threads": 3, "chunk_size": 5)");
+        ASSERT_EQ(actual, expected) << reduction;
+    }
+}
@@ -11,6 +11,8 @@
 #include <cstdio>
 #include <memory>
 #include <array>
+#include <cctype>
+#include <filesystem>
 
 #include "include/engine/core/SimulationEngine.h"
 #include "include/engine/io/io.h"
@@ -57,30 +59,36 @@ inline std::string exec_command(const char *cmd)
     return result;
 }
 
+// Runs every test in its own empty directory under the system temp directory, named after the
+// test, so that tests writing the same relative file names can run in parallel (ctest -j).
+// The directory and everything the test wrote to it are removed afterwards.
 class FileCleanupTest : public ::testing::Test
 {
 protected:
     void SetUp() override
     {
-        std::remove("test_output.csv");
-        std::remove("recipe.json");
-        std::remove("param_test.json");
-        std::remove("sampler_test.json");
-        std::remove("err.json");
-        std::remove("preview_test.json");
-        std::remove("test_data.csv");
-        std::remove("bad_data.csv");
+        const ::testing::TestInfo *info = ::testing::UnitTest::GetInstance()->current_test_info();
+        std::string name = std::string("vse_test_") + info->test_suite_name() + "_" + info->name();
+        for (char &c : name)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)))
+                c = '_';
+        }
+        m_previous_directory = std::filesystem::current_path();
+        m_directory = std::filesystem::temp_directory_path() / name;
+        std::filesystem::remove_all(m_directory);
+        std::filesystem::create_directories(m_directory);
+        std::filesystem::current_path(m_directory);
     }
 
     void TearDown() override
     {
-        std::remove("test_output.csv");
-        std::remove("recipe.json");
-        std::remove("param_test.json");
-        std::remove("sampler_test.json");
-        std::remove("err.json");
-        std::remove("preview_test.json");
-        std::remove("test_data.csv");
-        std::remove("bad_data.csv");
+        std::filesystem::current_path(m_previous_directory);
+        std::error_code ignored;
+        std::filesystem::remove_all(m_directory, ignored);
     }
+
+private:
+    std::filesystem::path m_previous_directory;
+    std::filesystem::path m_directory;
 };
\ No newline at end of file